@@ -377,6 +377,7 @@ still allow people to get their work done."
 	$bindir/sudoreplay  	0755
 	$sbindir/sudo_sendlog   0755
 	$sbindir/sudo_logsrvd        optional,ignore
+	$sbindir/sudo_policyd   0755
 	$sbindir/visudo     	0755
 	$includedir/sudo_plugin.h 0644
 	$libexecdir/sudo/	0755
@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SUDO_LOGSRV_ARENA_H
+#define SUDO_LOGSRV_ARENA_H
+
+#include <protobuf-c/protobuf-c.h>
+
+/*
+ * Bump allocator for unpacking protobuf-c messages.
+ * Memory is only released when the arena is reset, which makes
+ * freeing an unpacked message a single operation.
+ */
+struct logsrv_arena_chunk;
+struct logsrv_arena {
+    ProtobufCAllocator allocator;
+    struct logsrv_arena_chunk *chunks;
+};
+
+/* Initial arena size, grown as needed. */
+#define LOGSRV_ARENA_SIZE	(16 * 1024)
+
+/* An arena larger than this is shrunk when it is reset. */
+#define LOGSRV_ARENA_MAX	(1024 * 1024)
+
+void logsrv_arena_init(struct logsrv_arena *arena);
+void logsrv_arena_reset(struct logsrv_arena *arena);
+void logsrv_arena_free(struct logsrv_arena *arena);
+
+#endif /* SUDO_LOGSRV_ARENA_H */
@@ -32,9 +32,10 @@ struct timeval;		/* for deprecated APIs */
 #define SUDO_EV_PERSIST		0x08	/* persist until deleted */
 #define SUDO_EV_SIGNAL		0x10	/* fire on signal receipt */
 #define SUDO_EV_SIGINFO		0x20	/* fire on signal receipt (siginfo) */
+#define SUDO_EV_EDGE		0x40	/* edge-triggered I/O, if supported */
 
 /* User-settable events for sudo_ev_init() (SUDO_EV_TIMEOUT not valid here) */
-#define SUDO_EV_MASK		(SUDO_EV_READ|SUDO_EV_WRITE|SUDO_EV_PERSIST|SUDO_EV_SIGNAL|SUDO_EV_SIGINFO)
+#define SUDO_EV_MASK		(SUDO_EV_READ|SUDO_EV_WRITE|SUDO_EV_PERSIST|SUDO_EV_SIGNAL|SUDO_EV_SIGINFO|SUDO_EV_EDGE)
 
 /* Event flags (internal) */
 #define SUDO_EVQ_INSERTED	0x01U	/* event is on the event queue */
@@ -77,7 +78,7 @@ struct sudo_event {
     short events;		/* SUDO_EV_* flags (in) */
     short revents;		/* SUDO_EV_* flags (out) */
     unsigned short flags;	/* internal event flags */
-    short pfd_idx;		/* index into pfds array (XXX) */
+    short pfd_idx;		/* index into backend fd array (XXX) */
     sudo_ev_callback_t callback;/* user-provided callback */
     struct timespec timeout;	/* for SUDO_EV_TIMEOUT */
     void *closure;		/* user-provided data pointer */
@@ -96,6 +97,15 @@ struct sudo_event_base {
     sig_atomic_t signal_caught;	/* at least one signal caught */
     int num_handlers;		/* number of installed handlers */
     int signal_pipe[2];		/* so we can wake up on signal */
+#ifdef HAVE_EPOLL_CREATE1
+    int epfd;			/* epoll instance */
+    pid_t ep_pid;		/* process that created epfd */
+    void *ep_events;		/* array of struct epoll_event (out) */
+    int ep_maxevents;		/* size of the ep_events array */
+    void *ep_fds;		/* per-fd event lists, indexed by fd */
+    int ep_nfds;		/* size of the ep_fds array */
+    int ep_nalways;		/* number of fds epoll cannot watch */
+#endif /* HAVE_EPOLL_CREATE1 */
 #if defined(HAVE_POLL) || defined(HAVE_PPOLL)
     struct pollfd *pfds;	/* array of struct pollfd */
     int pfd_max;		/* size of the pfds array */
@@ -79,11 +79,13 @@ struct timing_closure {
     } u;
 };
 
+struct iolog_codec;
 struct iolog_file {
     bool enabled;
     bool compressed;
     bool locked;
     bool writable;
+    const struct iolog_codec *codec;
     union {
 	FILE *f;
 #ifdef HAVE_ZLIB_H
@@ -93,6 +95,25 @@ struct iolog_file {
     } fd;
 };
 
+/*
+ * A checkpoint in the I/O log index, see iolog_index.c.
+ * For each file, rawoff is the offset in the file on disk and
+ * pos is the corresponding offset in the uncompressed data.
+ */
+struct iolog_index_entry {
+    struct timespec elapsed;
+    off_t rawoff[IOFD_MAX];
+    off_t pos[IOFD_MAX];
+};
+
+struct iolog_index {
+    FILE *fp;
+    struct timespec elapsed;
+    size_t pending;
+    size_t nentries;
+    struct iolog_index_entry *entries;
+};
+
 struct iolog_path_escape {
     const char *name;
     size_t (*copy_fn)(char * restrict, size_t, void * restrict );
@@ -101,6 +122,15 @@ struct iolog_path_escape {
 /* host_port.c */
 bool iolog_parse_host_port(char *str, char **hostp, char **portp, bool *tlsp, const char *defport, const char *defport_tls);
 
+/* iolog_index.c */
+bool iolog_index_create(struct iolog_index *idx, int dfd);
+bool iolog_index_reopen(struct iolog_index *idx, int dfd, const struct timespec *elapsed);
+bool iolog_index_update(struct iolog_index *idx, struct iolog_file *iolog_files, const struct timespec *delay, size_t len, const char **errstr);
+bool iolog_index_close(struct iolog_index *idx, const char **errstr);
+bool iolog_index_load(struct iolog_index *idx, int dfd);
+const struct iolog_index_entry *iolog_index_find(const struct iolog_index *idx, const struct timespec *target);
+bool iolog_index_seek(const struct iolog_index_entry *entry, struct iolog_file *iolog_files);
+
 /* iolog_path.c */
 bool expand_iolog_path(const char *inpath, char *path, size_t pathlen, const struct iolog_path_escape *escapes, void *closure);
 size_t strlcpy_no_slash(char * restrict dst, const char * restrict src, size_t size);
@@ -114,6 +144,10 @@ bool iolog_parse_loginfo_json(FILE *fp, const char *iolog_dir, struct eventlog *
 bool iolog_parse_loginfo_legacy(FILE *fp, const char *iolog_dir, struct eventlog *evlog);
 void iolog_adjust_delay(struct timespec *delay, struct timespec *max_delay, double scale_factor);
 
+/* iolog_catalog.c */
+bool iolog_catalog_add(const struct eventlog *evlog);
+int iolog_catalog_read(FILE *fp, char **bufp, size_t *bufsizep, struct eventlog *evlog);
+
 /* iolog_fileio.c */
 struct passwd;
 struct group;
@@ -134,17 +168,23 @@ void iolog_clearerr(struct iolog_file *iol);
 bool iolog_flush(struct iolog_file *iol, const char **errstr);
 void iolog_rewind(struct iolog_file *iol);
 unsigned int iolog_get_maxseq(void);
+unsigned int iolog_get_seqblock(void);
 uid_t iolog_get_uid(void);
 gid_t iolog_get_gid(void);
 mode_t iolog_get_file_mode(void);
 mode_t iolog_get_dir_mode(void);
 bool iolog_get_compress(void);
+const char *iolog_get_compress_type(void);
 bool iolog_get_flush(void);
+bool iolog_get_index(void);
 void iolog_set_compress(bool);
+bool iolog_set_compress_type(const char *name);
 void iolog_set_defaults(void);
 void iolog_set_flush(bool);
 void iolog_set_gid(gid_t gid);
+void iolog_set_index(bool);
 void iolog_set_maxseq(unsigned int maxval);
+void iolog_set_seqblock(unsigned int newval);
 void iolog_set_mode(mode_t mode);
 void iolog_set_owner(uid_t uid, uid_t gid);
 bool iolog_swapids(bool restore);
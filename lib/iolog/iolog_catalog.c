@@ -0,0 +1,308 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * The optional "catalog" file in the top-level I/O log directory has
+ * one line for each session logged there, which lets "sudoreplay -l"
+ * find matching sessions without walking the entire directory tree.
+ * Each line consists of tab-separated fields: the start time, submit
+ * user, submit host, tty, cwd, runas user, runas group, the path of the
+ * session relative to the I/O log directory and the command line.
+ * Tabs, newlines and backslashes in a field are escaped with a backslash.
+ * Lines are only ever appended to the file while it is locked.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include <compat/stdbool.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+#include <sudo_eventlog.h>
+#include <sudo_fatal.h>
+#include <sudo_gettext.h>
+#include <sudo_iolog.h>
+#include <sudo_util.h>
+
+#define CATALOG_NFIELDS	9
+
+/*
+ * Copy str to dst, escaping the field and record separators.
+ * The dst buffer must have room for 2 * strlen(str) bytes.
+ * Returns a pointer to the end of the copied string in dst.
+ */
+static char *
+catalog_escape_field(char *dst, const char *str)
+{
+    debug_decl(catalog_escape_field, SUDO_DEBUG_UTIL);
+
+    if (str != NULL) {
+	for (; *str != '\0'; str++) {
+	    switch (*str) {
+	    case '\t':
+		*dst++ = '\\';
+		*dst++ = 't';
+		break;
+	    case '\n':
+		*dst++ = '\\';
+		*dst++ = 'n';
+		break;
+	    case '\\':
+		*dst++ = '\\';
+		*dst++ = '\\';
+		break;
+	    default:
+		*dst++ = *str;
+		break;
+	    }
+	}
+    }
+
+    debug_return_str(dst);
+}
+
+/*
+ * Add the session described by evlog to the catalog in the I/O log
+ * directory that contains it.  The evlog's iolog_file must point to
+ * the part of iolog_path that is relative to that directory.
+ */
+bool
+iolog_catalog_add(const struct eventlog *evlog)
+{
+    const char *fields[CATALOG_NFIELDS - 2];
+    char pathbuf[PATH_MAX], *buf = NULL, *cp;
+    const uid_t iolog_uid = iolog_get_uid();
+    const gid_t iolog_gid = iolog_get_gid();
+    size_t i, dirlen, bufsize;
+    bool ret = false;
+    int len, fd = -1;
+    debug_decl(iolog_catalog_add, SUDO_DEBUG_UTIL);
+
+    if (evlog->iolog_path == NULL || evlog->iolog_file == NULL ||
+	    evlog->iolog_file <= evlog->iolog_path || evlog->command == NULL) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "%s: missing I/O log path or command", __func__);
+	debug_return_bool(false);
+    }
+    dirlen = (size_t)(evlog->iolog_file - evlog->iolog_path - 1);
+    len = snprintf(pathbuf, sizeof(pathbuf), "%.*s/catalog", (int)dirlen,
+	evlog->iolog_path);
+    if (len < 0 || (size_t)len >= sizeof(pathbuf)) {
+	errno = ENAMETOOLONG;
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "%s: %.*s/catalog", __func__, (int)dirlen, evlog->iolog_path);
+	debug_return_bool(false);
+    }
+
+    /* Format the entire record so it can be written all at once. */
+    fields[0] = evlog->submituser;
+    fields[1] = evlog->submithost;
+    fields[2] = evlog->ttyname;
+    fields[3] = evlog->cwd;
+    fields[4] = evlog->runuser;
+    fields[5] = evlog->rungroup;
+    fields[6] = evlog->iolog_file;
+    bufsize = (2 * STRLEN_MAX_SIGNED(long long)) + 2;
+    for (i = 0; i < nitems(fields); i++) {
+	if (fields[i] != NULL)
+	    bufsize += 2 * strlen(fields[i]);
+	bufsize++;
+    }
+    bufsize += 2 * strlen(evlog->command) + 1;
+    if (evlog->runargv != NULL && evlog->runargv[0] != NULL) {
+	for (i = 1; evlog->runargv[i] != NULL; i++)
+	    bufsize += 2 * strlen(evlog->runargv[i]) + 1;
+    }
+    if ((buf = malloc(bufsize)) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	goto done;
+    }
+    len = snprintf(buf, bufsize, "%lld.%09ld\t",
+	(long long)evlog->event_time.tv_sec, evlog->event_time.tv_nsec);
+    if (len < 0 || (size_t)len >= bufsize) {
+	sudo_warnx(U_("internal error, %s overflow"), __func__);
+	goto done;
+    }
+    cp = buf + len;
+    for (i = 0; i < nitems(fields); i++) {
+	cp = catalog_escape_field(cp, fields[i]);
+	*cp++ = '\t';
+    }
+
+    /* Command and arguments, as matched by sudoreplay's "command" search. */
+    cp = catalog_escape_field(cp, evlog->command);
+    if (evlog->runargv != NULL && evlog->runargv[0] != NULL) {
+	for (i = 1; evlog->runargv[i] != NULL; i++) {
+	    *cp++ = ' ';
+	    cp = catalog_escape_field(cp, evlog->runargv[i]);
+	}
+    }
+    *cp++ = '\n';
+
+    fd = iolog_openat(AT_FDCWD, pathbuf, O_WRONLY|O_APPEND|O_CREAT|O_NOFOLLOW);
+    if (fd == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "%s: unable to open %s", __func__, pathbuf);
+	goto done;
+    }
+    if (!sudo_lock_file(fd, SUDO_LOCK)) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "unable to lock %s", pathbuf);
+	goto done;
+    }
+    if (fchown(fd, iolog_uid, iolog_gid) != 0) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "%s: unable to fchown %d:%d %s", __func__,
+	    (int)iolog_uid, (int)iolog_gid, pathbuf);
+    }
+    if (write(fd, buf, (size_t)(cp - buf)) != (ssize_t)(cp - buf)) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "%s: unable to write %s", __func__, pathbuf);
+	goto done;
+    }
+    ret = true;
+
+done:
+    if (fd != -1)
+	close(fd);
+    free(buf);
+    debug_return_bool(ret);
+}
+
+/*
+ * Unescape a catalog field in place.
+ * Returns a pointer to the field or NULL if it is empty.
+ */
+static char *
+catalog_unescape_field(char *field)
+{
+    char *src, *dst;
+    debug_decl(catalog_unescape_field, SUDO_DEBUG_UTIL);
+
+    if (*field == '\0')
+	debug_return_str(NULL);
+
+    for (src = dst = field; *src != '\0'; src++) {
+	if (*src == '\\' && src[1] != '\0') {
+	    switch (*++src) {
+	    case 't':
+		*dst++ = '\t';
+		break;
+	    case 'n':
+		*dst++ = '\n';
+		break;
+	    default:
+		*dst++ = *src;
+		break;
+	    }
+	} else {
+	    *dst++ = *src;
+	}
+    }
+    *dst = '\0';
+
+    debug_return_str(field);
+}
+
+/*
+ * Read the next record from the catalog.  On success, the string
+ * members of evlog point into *bufp and must not be freed.
+ * The command line is stored in evlog->command, runargv is not set.
+ * Returns 1 on success, 0 on EOF and -1 on error.  A malformed or
+ * incomplete record is treated as an error.
+ */
+int
+iolog_catalog_read(FILE *fp, char **bufp, size_t *bufsizep,
+    struct eventlog *evlog)
+{
+    char *fields[CATALOG_NFIELDS];
+    char *cp, *ep, *buf;
+    ssize_t len;
+    size_t nfields = 0;
+    long long llval;
+    debug_decl(iolog_catalog_read, SUDO_DEBUG_UTIL);
+
+    len = getdelim(bufp, bufsizep, '\n', fp);
+    if (len == -1)
+	debug_return_int(feof(fp) ? 0 : -1);
+    buf = *bufp;
+    if (buf[len - 1] != '\n') {
+	/* Record is still being written. */
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: incomplete record", __func__);
+	debug_return_int(-1);
+    }
+    buf[len - 1] = '\0';
+
+    /* Split into fields, an escaped tab is never a separator. */
+    for (cp = buf; nfields < CATALOG_NFIELDS; cp++) {
+	fields[nfields++] = cp;
+	while (*cp != '\t' && *cp != '\0')
+	    cp++;
+	if (*cp == '\0')
+	    break;
+	*cp = '\0';
+    }
+    if (nfields != CATALOG_NFIELDS) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: expected %d fields, got %zu", __func__, CATALOG_NFIELDS,
+	    nfields);
+	debug_return_int(-1);
+    }
+
+    memset(evlog, 0, sizeof(*evlog));
+    errno = 0;
+    llval = strtoll(fields[0], &ep, 10);
+    if (ep == fields[0] || *ep != '.' || errno == ERANGE) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: invalid time %s", __func__, fields[0]);
+	debug_return_int(-1);
+    }
+    evlog->event_time.tv_sec = (time_t)llval;
+    evlog->event_time.tv_nsec = (long)sudo_strtonum(ep + 1, 0, 999999999,
+	NULL);
+    evlog->submituser = catalog_unescape_field(fields[1]);
+    evlog->submithost = catalog_unescape_field(fields[2]);
+    evlog->ttyname = catalog_unescape_field(fields[3]);
+    evlog->cwd = catalog_unescape_field(fields[4]);
+    evlog->runuser = catalog_unescape_field(fields[5]);
+    evlog->rungroup = catalog_unescape_field(fields[6]);
+    evlog->iolog_file = catalog_unescape_field(fields[7]);
+    evlog->command = catalog_unescape_field(fields[8]);
+    if (evlog->iolog_file == NULL || evlog->command == NULL) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: missing session path or command", __func__);
+	debug_return_int(-1);
+    }
+    evlog->exit_value = -1;
+
+    debug_return_int(1);
+}
@@ -25,16 +25,13 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 void
 iolog_clearerr(struct iolog_file *iol)
 {
     debug_decl(iolog_eof, SUDO_DEBUG_UTIL);
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed)
-	gzclearerr(iol->fd.g);
-    else
-#endif
-	clearerr(iol->fd.f);
+    iol->codec->clearerr(iol->fd.v);
     debug_return;
 }
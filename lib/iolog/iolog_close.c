@@ -33,43 +33,18 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 /*
  * Close an I/O log.
  */
 bool
 iolog_close(struct iolog_file *iol, const char **errstr)
 {
-    bool ret = true;
+    bool ret;
     debug_decl(iolog_close, SUDO_DEBUG_UTIL);
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed) {
-	int errnum;
-
-	/* Must check error indicator before closing. */
-	if (iol->writable) {
-	    if (gzflush(iol->fd.g, Z_SYNC_FLUSH) != Z_OK) {
-		ret = false;
-		if (errstr != NULL) {
-		    *errstr = gzerror(iol->fd.g, &errnum);
-		    if (errnum == Z_ERRNO)
-			*errstr = strerror(errno);
-		}
-	    }
-	}
-	errnum = gzclose(iol->fd.g);
-	if (ret && errnum != Z_OK) {
-	    ret = false;
-	    if (errstr != NULL)
-		*errstr = errnum == Z_ERRNO ? strerror(errno) : "unknown error";
-	}
-    } else
-#endif
-    if (fclose(iol->fd.f) != 0) {
-	ret = false;
-	if (errstr != NULL)
-	    *errstr = strerror(errno);
-    }
+    ret = iol->codec->close(iol->fd.v, iol->writable, errstr);
 
     debug_return_bool(ret);
 }
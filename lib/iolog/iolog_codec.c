@@ -0,0 +1,456 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include <compat/stdbool.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+#include <sudo_iolog.h>
+
+#include <iolog_codec.h>
+
+/*
+ * Uncompressed I/O log files use stdio.
+ */
+static void *
+stdio_open(int fd, const char *mode)
+{
+    return fdopen(fd, mode);
+}
+
+static ssize_t
+stdio_read(void *cookie, void *buf, size_t nbytes, const char **errstr)
+{
+    FILE *fp = cookie;
+    ssize_t nread;
+
+    nread = (ssize_t)fread(buf, 1, nbytes, fp);
+    if (nread <= 0 && ferror(fp)) {
+	nread = -1;
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+    }
+    return nread;
+}
+
+static ssize_t
+stdio_write(void *cookie, const void *buf, size_t len, const char **errstr)
+{
+    ssize_t ret;
+
+    ret = (ssize_t)fwrite(buf, 1, len, cookie);
+    if (ret != (ssize_t)len) {
+	ret = -1;
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+    }
+    return ret;
+}
+
+static char *
+stdio_gets(void *cookie, char *buf, int bufsize, const char **errstr)
+{
+    char *str;
+
+    if ((str = fgets(buf, bufsize, cookie)) == NULL) {
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+    }
+    return str;
+}
+
+static off_t
+stdio_seek(void *cookie, off_t offset, int whence)
+{
+    if (fseeko(cookie, offset, whence) == -1)
+	return -1;
+    return ftello(cookie);
+}
+
+static bool
+stdio_flush(void *cookie, const char **errstr)
+{
+    if (fflush(cookie) != 0) {
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	return false;
+    }
+    return true;
+}
+
+static bool
+stdio_eof(void *cookie)
+{
+    return feof((FILE *)cookie) != 0;
+}
+
+static void
+stdio_clearerr(void *cookie)
+{
+    clearerr((FILE *)cookie);
+}
+
+static bool
+stdio_close(void *cookie, bool writable, const char **errstr)
+{
+    if (fclose(cookie) != 0) {
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	return false;
+    }
+    return true;
+}
+
+static bool
+stdio_checkpoint(void *cookie, off_t *rawoff, off_t *pos, const char **errstr)
+{
+    if (!stdio_flush(cookie, errstr))
+	return false;
+    if ((*pos = ftello(cookie)) == -1) {
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	return false;
+    }
+    *rawoff = *pos;
+    return true;
+}
+
+static bool
+stdio_resume(void *cookie, off_t rawoff, off_t pos)
+{
+    return fseeko(cookie, pos, SEEK_SET) == 0;
+}
+
+const struct iolog_codec iolog_codec_stdio = {
+    "none", NULL, 0,
+    stdio_open,
+    stdio_read,
+    stdio_write,
+    stdio_gets,
+    stdio_seek,
+    stdio_flush,
+    stdio_eof,
+    stdio_clearerr,
+    stdio_close,
+    stdio_checkpoint,
+    stdio_resume
+};
+
+#ifdef HAVE_ZLIB_H
+/*
+ * Compressed I/O log files in gzip format use zlib.
+ * Compressed logs don't support random access, gzdopen() will
+ * fail for mode "r+".  A checkpoint ends the current gzip member,
+ * zlib reads concatenated members as a single stream.
+ */
+static unsigned char const gzip_magic[2] = {0x1f, 0x8b};
+
+struct gzip_file {
+    gzFile gz;
+    int fd;
+    off_t base;		/* uncompressed offset of the first member read */
+    off_t member_raw;	/* file offset of the current member when writing */
+    off_t member_pos;	/* uncompressed offset of the current member */
+};
+
+static const char *
+gzip_errstr(gzFile g)
+{
+    const char *errstr;
+    int errnum;
+
+    errstr = gzerror(g, &errnum);
+    if (errnum == Z_ERRNO)
+	errstr = strerror(errno);
+    return errstr;
+}
+
+static void *
+gzip_open(int fd, const char *mode)
+{
+    struct gzip_file *g;
+
+    if ((g = calloc(1, sizeof(*g))) == NULL)
+	return NULL;
+    if ((g->gz = gzdopen(fd, mode)) == NULL) {
+	free(g);
+	return NULL;
+    }
+    g->fd = fd;
+    return g;
+}
+
+static ssize_t
+gzip_read(void *cookie, void *buf, size_t nbytes, const char **errstr)
+{
+    struct gzip_file *g = cookie;
+    ssize_t nread;
+
+    nread = gzread(g->gz, buf, (unsigned int)nbytes);
+    if (nread == -1 && errstr != NULL)
+	*errstr = gzip_errstr(g->gz);
+    return nread;
+}
+
+static ssize_t
+gzip_write(void *cookie, const void *buf, size_t len, const char **errstr)
+{
+    struct gzip_file *g = cookie;
+    ssize_t ret;
+
+    ret = gzwrite(g->gz, buf, (unsigned int)len);
+    if (ret == 0) {
+	ret = -1;
+	if (errstr != NULL)
+	    *errstr = gzip_errstr(g->gz);
+    }
+    return ret;
+}
+
+static char *
+gzip_gets(void *cookie, char *buf, int bufsize, const char **errstr)
+{
+    struct gzip_file *g = cookie;
+    char *str;
+
+    if ((str = gzgets(g->gz, buf, bufsize)) == NULL) {
+	if (errstr != NULL)
+	    *errstr = gzip_errstr(g->gz);
+    }
+    return str;
+}
+
+/*
+ * Start reading a new gzip member at rawoff, which corresponds
+ * to pos in the uncompressed data.
+ */
+static bool
+gzip_resume(void *cookie, off_t rawoff, off_t pos)
+{
+    struct gzip_file *g = cookie;
+    gzFile gz;
+    int fd;
+
+    if ((fd = dup(g->fd)) == -1)
+	return false;
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1 ||
+	    lseek(fd, rawoff, SEEK_SET) == -1 ||
+	    (gz = gzdopen(fd, "r")) == NULL) {
+	close(fd);
+	return false;
+    }
+    (void)gzclose(g->gz);
+    g->gz = gz;
+    g->fd = fd;
+    g->base = pos;
+    return true;
+}
+
+static off_t
+gzip_seek(void *cookie, off_t offset, int whence)
+{
+    struct gzip_file *g = cookie;
+    off_t ret;
+
+    /* Offsets in the gzFile are relative to the member we resumed at. */
+    if (whence == SEEK_CUR) {
+	offset += gztell(g->gz) + g->base;
+	whence = SEEK_SET;
+    }
+    if (whence == SEEK_SET) {
+	if (offset < g->base && !gzip_resume(g, 0, 0))
+	    return -1;
+	offset -= g->base;
+    }
+    ret = gzseek(g->gz, offset, whence);
+    return ret == -1 ? -1 : ret + g->base;
+}
+
+static bool
+gzip_flush(void *cookie, const char **errstr)
+{
+    struct gzip_file *g = cookie;
+
+    if (gzflush(g->gz, Z_SYNC_FLUSH) != Z_OK) {
+	if (errstr != NULL)
+	    *errstr = gzip_errstr(g->gz);
+	return false;
+    }
+    return true;
+}
+
+static bool
+gzip_eof(void *cookie)
+{
+    struct gzip_file *g = cookie;
+
+    return gzeof(g->gz) != 0;
+}
+
+static void
+gzip_clearerr(void *cookie)
+{
+    struct gzip_file *g = cookie;
+
+    gzclearerr(g->gz);
+}
+
+static bool
+gzip_close(void *cookie, bool writable, const char **errstr)
+{
+    struct gzip_file *g = cookie;
+    bool ret = true;
+    int errnum;
+
+    /* Must check error indicator before closing. */
+    if (writable)
+	ret = gzip_flush(g, errstr);
+    errnum = gzclose(g->gz);
+    if (ret && errnum != Z_OK) {
+	ret = false;
+	if (errstr != NULL)
+	    *errstr = errnum == Z_ERRNO ? strerror(errno) : "unknown error";
+    }
+    free(g);
+    return ret;
+}
+
+static bool
+gzip_checkpoint(void *cookie, off_t *rawoff, off_t *pos, const char **errstr)
+{
+    struct gzip_file *g = cookie;
+    const off_t curpos = gztell(g->gz);
+
+    /* Finish the gzip member, the next write starts a new one. */
+    if (curpos != g->member_pos) {
+	if (gzflush(g->gz, Z_FINISH) != Z_OK) {
+	    if (errstr != NULL)
+		*errstr = gzip_errstr(g->gz);
+	    return false;
+	}
+	if ((g->member_raw = lseek(g->fd, 0, SEEK_CUR)) == -1) {
+	    if (errstr != NULL)
+		*errstr = strerror(errno);
+	    return false;
+	}
+	g->member_pos = curpos;
+    }
+    *rawoff = g->member_raw;
+    *pos = g->member_pos;
+    return true;
+}
+
+static const struct iolog_codec iolog_codec_gzip = {
+    "gzip", gzip_magic, sizeof(gzip_magic),
+    gzip_open,
+    gzip_read,
+    gzip_write,
+    gzip_gets,
+    gzip_seek,
+    gzip_flush,
+    gzip_eof,
+    gzip_clearerr,
+    gzip_close,
+    gzip_checkpoint,
+    gzip_resume
+};
+#endif /* HAVE_ZLIB_H */
+
+/*
+ * Compression codecs in order of preference for the default.
+ */
+static const struct iolog_codec *codecs[] = {
+#ifdef HAVE_ZLIB_H
+    &iolog_codec_gzip,
+#endif
+#ifdef HAVE_ZSTD_H
+    &iolog_codec_zstd,
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    &iolog_codec_lz4,
+#endif
+    NULL
+};
+
+/*
+ * Returns the codec to use for compressed I/O logs when none
+ * has been configured.  This is gzip for compatibility with
+ * older versions of sudo, if available.
+ */
+const struct iolog_codec *
+iolog_codec_default(void)
+{
+    if (codecs[0] != NULL)
+	return codecs[0];
+    return &iolog_codec_stdio;
+}
+
+/*
+ * Look up a compression codec by name.
+ * Returns NULL if the codec is unknown or not supported.
+ */
+const struct iolog_codec *
+iolog_codec_lookup(const char *name)
+{
+    size_t i;
+    debug_decl(iolog_codec_lookup, SUDO_DEBUG_UTIL);
+
+    for (i = 0; codecs[i] != NULL; i++) {
+	if (strcmp(name, codecs[i]->name) == 0)
+	    debug_return_const_ptr(codecs[i]);
+    }
+    debug_return_const_ptr(NULL);
+}
+
+/*
+ * Choose a codec for an existing I/O log file based on its magic number.
+ * Files that don't match any supported codec are treated as uncompressed.
+ */
+const struct iolog_codec *
+iolog_codec_detect(int fd)
+{
+    unsigned char magic[4];
+    ssize_t nread;
+    size_t i;
+    debug_decl(iolog_codec_detect, SUDO_DEBUG_UTIL);
+
+    nread = pread(fd, magic, sizeof(magic), 0);
+    for (i = 0; nread > 0 && codecs[i] != NULL; i++) {
+	const struct iolog_codec *codec = codecs[i];
+	if ((size_t)nread >= codec->magic_len &&
+		memcmp(magic, codec->magic, codec->magic_len) == 0) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO,
+		"%s: detected %s compressed file", __func__, codec->name);
+	    debug_return_const_ptr(codec);
+	}
+    }
+    debug_return_const_ptr(&iolog_codec_stdio);
+}
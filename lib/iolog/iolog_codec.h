@@ -0,0 +1,125 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef IOLOG_CODEC_H
+#define IOLOG_CODEC_H
+
+/*
+ * An I/O log codec provides stdio-like access to an I/O log file.
+ * Uncompressed files use the "none" codec, which is a thin wrapper
+ * around stdio.  When an existing file is opened
+ * for reading, the codec is chosen based on its magic number.
+ * The checkpoint and resume functions are used by the I/O log index,
+ * a checkpoint ends the compressed stream so that a reader can later
+ * resume decompressing at the returned file offset.
+ */
+struct iolog_codec {
+    const char *name;
+    const unsigned char *magic;
+    size_t magic_len;
+    void *(*open)(int fd, const char *mode);
+    ssize_t (*read)(void *cookie, void *buf, size_t nbytes, const char **errstr);
+    ssize_t (*write)(void *cookie, const void *buf, size_t len, const char **errstr);
+    char *(*gets)(void *cookie, char *buf, int bufsize, const char **errstr);
+    off_t (*seek)(void *cookie, off_t offset, int whence);
+    bool (*flush)(void *cookie, const char **errstr);
+    bool (*eof)(void *cookie);
+    void (*clearerr)(void *cookie);
+    bool (*close)(void *cookie, bool writable, const char **errstr);
+    bool (*checkpoint)(void *cookie, off_t *rawoff, off_t *pos, const char **errstr);
+    bool (*resume)(void *cookie, off_t rawoff, off_t pos);
+};
+
+/*
+ * Streaming compression back end used by the zstd and lz4 codecs.
+ * The generic iolog_stream code handles buffering, line reads and
+ * seeking, the back end only compresses and decompresses data.
+ */
+#define IOLOG_STREAM_BUFSIZ	(64 * 1024)
+
+enum iolog_stream_op {
+    IOLOG_STREAM_CONTINUE,
+    IOLOG_STREAM_FLUSH,
+    IOLOG_STREAM_END
+};
+
+struct iolog_stream;
+
+struct iolog_stream_ops {
+    bool (*init)(struct iolog_stream *s);
+    void (*free)(struct iolog_stream *s);
+    bool (*reset)(struct iolog_stream *s);
+    ssize_t (*decompress)(struct iolog_stream *s, void *dst, size_t dstlen);
+    bool (*compress)(struct iolog_stream *s, const void *src, size_t len, enum iolog_stream_op op);
+};
+
+struct iolog_stream {
+    const struct iolog_stream_ops *ops;
+    void *ctx;			/* back end state */
+    const char *errstr;		/* last error, if any */
+    off_t pos;			/* offset in the uncompressed data */
+    int fd;
+    bool writable;
+    bool eof;
+    bool error;
+    bool dirty;			/* data written since last flush */
+    bool restart;		/* next write starts a new frame */
+    off_t frame_raw;		/* file offset of the current frame */
+    off_t frame_pos;		/* uncompressed offset of the current frame */
+    /* Compressed input (reading) or output (writing). */
+    unsigned char *zbuf;
+    size_t zbufsize;
+    size_t zoff;
+    size_t zlen;
+    /* Decompressed data that has not yet been consumed (reading). */
+    unsigned char *buf;
+    size_t off;
+    size_t len;
+};
+
+/* iolog_conf.c */
+const struct iolog_codec *iolog_get_codec(void);
+
+/* iolog_codec.c */
+extern const struct iolog_codec iolog_codec_stdio;
+const struct iolog_codec *iolog_codec_detect(int fd);
+const struct iolog_codec *iolog_codec_lookup(const char *name);
+const struct iolog_codec *iolog_codec_default(void);
+
+/* iolog_stream.c */
+void *iolog_stream_open(int fd, const char *mode, const struct iolog_stream_ops *ops);
+ssize_t iolog_stream_read(void *cookie, void *buf, size_t nbytes, const char **errstr);
+ssize_t iolog_stream_write(void *cookie, const void *buf, size_t len, const char **errstr);
+char *iolog_stream_gets(void *cookie, char *buf, int bufsize, const char **errstr);
+off_t iolog_stream_seek(void *cookie, off_t offset, int whence);
+bool iolog_stream_flush(void *cookie, const char **errstr);
+bool iolog_stream_eof(void *cookie);
+void iolog_stream_clearerr(void *cookie);
+bool iolog_stream_close(void *cookie, bool writable, const char **errstr);
+bool iolog_stream_checkpoint(void *cookie, off_t *rawoff, off_t *pos, const char **errstr);
+bool iolog_stream_resume(void *cookie, off_t rawoff, off_t pos);
+ssize_t iolog_stream_fill(struct iolog_stream *s);
+bool iolog_stream_drain(struct iolog_stream *s);
+
+/* iolog_zstd.c */
+extern const struct iolog_codec iolog_codec_zstd;
+
+/* iolog_lz4.c */
+extern const struct iolog_codec iolog_codec_lz4;
+
+#endif /* IOLOG_CODEC_H */
@@ -34,7 +34,10 @@
 #include <sudo_util.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 static unsigned int sessid_max = SESSID_MAX;
+static unsigned int sessid_block = 1;
 static mode_t iolog_filemode = S_IRUSR|S_IWUSR;
 static mode_t iolog_dirmode = S_IRWXU;
 static uid_t iolog_uid = ROOT_UID;
@@ -42,6 +45,8 @@ static gid_t iolog_gid = ROOT_GID;
 static bool iolog_gid_set;
 static bool iolog_docompress;
 static bool iolog_doflush;
+static bool iolog_doindex;
+static const struct iolog_codec *iolog_compress_codec;
 
 /*
  * Reset I/O log settings to default values.
@@ -50,6 +55,7 @@ void
 iolog_set_defaults(void)
 {
     sessid_max = SESSID_MAX;
+    sessid_block = 1;
     iolog_filemode = S_IRUSR|S_IWUSR;
     iolog_dirmode = S_IRWXU;
     iolog_uid = ROOT_UID;
@@ -57,6 +63,8 @@ iolog_set_defaults(void)
     iolog_gid_set = false;
     iolog_docompress = false;
     iolog_doflush = false;
+    iolog_doindex = false;
+    iolog_compress_codec = NULL;
 }
 
 /*
@@ -75,6 +83,19 @@ iolog_set_maxseq(unsigned int newval)
     debug_return;
 }
 
+/*
+ * Set the number of session IDs to reserve from the sequence file at once.
+ */
+void
+iolog_set_seqblock(unsigned int newval)
+{
+    debug_decl(iolog_set_seqblock, SUDO_DEBUG_UTIL);
+
+    sessid_block = newval ? newval : 1;
+
+    debug_return;
+}
+
 /*
  * Set iolog_uid (and iolog_gid if gid not explicitly set).
  */
@@ -139,6 +160,28 @@ iolog_set_compress(bool newval)
     debug_return;
 }
 
+/*
+ * Set the compression method used when iolog_docompress is set.
+ * A NULL name selects the default method.
+ * Returns false if the method is not supported.
+ */
+bool
+iolog_set_compress_type(const char *name)
+{
+    const struct iolog_codec *codec = NULL;
+    debug_decl(iolog_set_compress_type, SUDO_DEBUG_UTIL);
+
+    if (name != NULL) {
+	if ((codec = iolog_codec_lookup(name)) == NULL) {
+	    sudo_debug_printf(SUDO_DEBUG_WARN,
+		"%s: unsupported compression type %s", __func__, name);
+	    debug_return_bool(false);
+	}
+    }
+    iolog_compress_codec = codec;
+    debug_return_bool(true);
+}
+
 /*
  * Set iolog_doflush
  */
@@ -150,6 +193,17 @@ iolog_set_flush(bool newval)
     debug_return;
 }
 
+/*
+ * Set iolog_doindex
+ */
+void
+iolog_set_index(bool newval)
+{
+    debug_decl(iolog_set_index, SUDO_DEBUG_UTIL);
+    iolog_doindex = newval;
+    debug_return;
+}
+
 /*
  * Getters.
  */
@@ -160,6 +214,12 @@ iolog_get_maxseq(void)
     return sessid_max;
 }
 
+unsigned int
+iolog_get_seqblock(void)
+{
+    return sessid_block;
+}
+
 uid_t
 iolog_get_uid(void)
 {
@@ -190,8 +250,33 @@ iolog_get_compress(void)
     return iolog_docompress;
 }
 
+/*
+ * Returns the codec used to write new I/O log files.
+ */
+const struct iolog_codec *
+iolog_get_codec(void)
+{
+    if (!iolog_docompress)
+	return &iolog_codec_stdio;
+    if (iolog_compress_codec != NULL)
+	return iolog_compress_codec;
+    return iolog_codec_default();
+}
+
+const char *
+iolog_get_compress_type(void)
+{
+    return iolog_get_codec()->name;
+}
+
 bool
 iolog_get_flush(void)
 {
     return iolog_doflush;
 }
+
+bool
+iolog_get_index(void)
+{
+    return iolog_doindex;
+}
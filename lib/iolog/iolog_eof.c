@@ -30,6 +30,8 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 /*
  * Returns true if at end of I/O log file, else false.
  */
@@ -39,11 +41,6 @@ iolog_eof(struct iolog_file *iol)
     bool ret;
     debug_decl(iolog_eof, SUDO_DEBUG_UTIL);
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed)
-	ret = gzeof(iol->fd.g) != 0;
-    else
-#endif
-	ret = feof(iol->fd.f) != 0;
+    ret = iol->codec->eof(iol->fd.v);
     debug_return_bool(ret);
 }
@@ -27,8 +27,10 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 /*
- * I/O log wrapper for fflush/gzflush.
+ * Flush buffered I/O log data to disk.
  */
 bool
 iolog_flush(struct iolog_file *iol, const char **errstr)
@@ -36,26 +38,7 @@ iolog_flush(struct iolog_file *iol, const char **errstr)
     debug_decl(iolog_flush, SUDO_DEBUG_UTIL);
     bool ret = true;
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed) {
-	int errnum;
-	if (gzflush(iol->fd.g, Z_SYNC_FLUSH) != Z_OK) {
-	    if (errstr != NULL) {
-		*errstr = gzerror(iol->fd.g, &errnum);
-		if (errnum == Z_ERRNO)
-		    *errstr = strerror(errno);
-	    }
-	    ret = false;
-	}
-    } else
-#endif
-    {
-	if (fflush(iol->fd.f) != 0) {
-	    if (errstr != NULL)
-		*errstr = strerror(errno);
-	    ret = false;
-	}
-    }
+    ret = iol->codec->flush(iol->fd.v, errstr);
 
     debug_return_bool(ret);
 }
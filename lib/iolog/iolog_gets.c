@@ -34,6 +34,8 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 /*
  * Like fgets() but for struct iolog_file.
  */
@@ -51,23 +53,6 @@ iolog_gets(struct iolog_file *iol, char *buf, int bufsize,
 	debug_return_str(NULL);
     }
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed) {
-	if ((str = gzgets(iol->fd.g, buf, bufsize)) == NULL) {
-	    if (errstr != NULL) {
-		int errnum;
-		*errstr = gzerror(iol->fd.g, &errnum);
-		if (errnum == Z_ERRNO)
-		    *errstr = strerror(errno);
-	    }
-	}
-    } else
-#endif
-    {
-	if ((str = fgets(buf, bufsize, iol->fd.f)) == NULL) {
-	    if (errstr != NULL)
-		*errstr = strerror(errno);
-	}
-    }
+    str = iol->codec->gets(iol->fd.v, buf, bufsize, errstr);
     debug_return_str(str);
 }
@@ -0,0 +1,405 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * The optional "index" file in an I/O log directory contains periodic
+ * checkpoints that map the elapsed time in the session to offsets in
+ * the I/O log files.  Each line consists of the elapsed time followed
+ * by a "rawoff:pos" pair for each of stdin, stdout, stderr, ttyin,
+ * ttyout and timing, where rawoff is the offset in the file on disk and
+ * pos is the corresponding offset in the uncompressed data.
+ *
+ * Compressed files are restarted at each checkpoint so decompression
+ * can begin at rawoff instead of at the start of the file.  A reader
+ * that wants to start at a given point in time finds the last checkpoint
+ * before it with a binary search and only needs to read the timing
+ * records written after that checkpoint.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include <compat/stdbool.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+#include <sudo_fatal.h>
+#include <sudo_gettext.h>
+#include <sudo_iolog.h>
+#include <sudo_util.h>
+
+#include <iolog_codec.h>
+
+/* Amount of logged data between checkpoints. */
+#define IOLOG_INDEX_INTERVAL	(1024 * 1024)
+
+/*
+ * Open the index file in the I/O log directory dfd.
+ */
+static bool
+iolog_index_open(struct iolog_index *idx, int dfd, int flags)
+{
+    const char *mode;
+    int fd;
+    debug_decl(iolog_index_open, SUDO_DEBUG_UTIL);
+
+    memset(idx, 0, sizeof(*idx));
+    fd = iolog_openat(dfd, "index", flags|O_NOFOLLOW);
+    if (fd == -1)
+	debug_return_bool(false);
+    if (ISSET(flags, O_CREAT)) {
+	if (fchown(fd, iolog_get_uid(), iolog_get_gid()) != 0) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"%s: unable to fchown %d:%d index", __func__,
+		(int)iolog_get_uid(), (int)iolog_get_gid());
+	}
+    }
+    switch (flags & O_ACCMODE) {
+    case O_RDONLY:
+	mode = "r";
+	break;
+    case O_WRONLY:
+	mode = "w";
+	break;
+    default:
+	mode = "r+";
+	break;
+    }
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1 ||
+	    (idx->fp = fdopen(fd, mode)) == NULL) {
+	close(fd);
+	debug_return_bool(false);
+    }
+
+    debug_return_bool(true);
+}
+
+/*
+ * Create a new, empty, index file in the I/O log directory dfd.
+ */
+bool
+iolog_index_create(struct iolog_index *idx, int dfd)
+{
+    debug_decl(iolog_index_create, SUDO_DEBUG_UTIL);
+
+    debug_return_bool(iolog_index_open(idx, dfd, O_CREAT|O_TRUNC|O_WRONLY));
+}
+
+/*
+ * Write an index line of the form "sec.nsec rawoff:pos ...".
+ */
+static void
+iolog_index_print(FILE *fp, const struct iolog_index_entry *entry)
+{
+    int iofd;
+
+    fprintf(fp, "%lld.%09ld", (long long)entry->elapsed.tv_sec,
+	entry->elapsed.tv_nsec);
+    for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	fprintf(fp, " %lld:%lld", (long long)entry->rawoff[iofd],
+	    (long long)entry->pos[iofd]);
+    }
+    putc('\n', fp);
+}
+
+/*
+ * Parse an index line written by iolog_index_print().
+ */
+static bool
+iolog_index_parse(const char *line, struct iolog_index_entry *entry)
+{
+    const char *cp;
+    char *ep;
+    long long llval;
+    int iofd;
+    debug_decl(iolog_index_parse, SUDO_DEBUG_UTIL);
+
+    if ((cp = iolog_parse_delay(line, &entry->elapsed, ".")) == NULL)
+	debug_return_bool(false);
+    for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	errno = 0;
+	llval = strtoll(cp, &ep, 10);
+	if (ep == cp || *ep != ':' || llval < 0 || errno == ERANGE)
+	    debug_return_bool(false);
+	entry->rawoff[iofd] = (off_t)llval;
+	cp = ep + 1;
+	llval = strtoll(cp, &ep, 10);
+	if (ep == cp || llval < 0 || errno == ERANGE)
+	    debug_return_bool(false);
+	entry->pos[iofd] = (off_t)llval;
+	cp = ep;
+	if (*cp == ' ')
+	    cp++;
+    }
+
+    debug_return_bool(*cp == '\n');
+}
+
+/*
+ * Read all the index entries from idx->fp.
+ * A partial or invalid line ends the index.
+ */
+static bool
+iolog_index_read(struct iolog_index *idx)
+{
+    struct iolog_index_entry entry, *entries;
+    size_t bufsize = 0, maxentries = 0;
+    char *buf = NULL;
+    debug_decl(iolog_index_read, SUDO_DEBUG_UTIL);
+
+    while (getdelim(&buf, &bufsize, '\n', idx->fp) != -1) {
+	if (!iolog_index_parse(buf, &entry)) {
+	    sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+		"%s: ignoring invalid index entry %zu", __func__,
+		idx->nentries);
+	    break;
+	}
+	/* Entries must be sorted for the binary search. */
+	if (idx->nentries != 0 && sudo_timespeccmp(&entry.elapsed,
+		&idx->entries[idx->nentries - 1].elapsed, <)) {
+	    sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+		"%s: index entry %zu out of order", __func__, idx->nentries);
+	    break;
+	}
+	if (idx->nentries == maxentries) {
+	    maxentries = maxentries ? maxentries * 2 : 64;
+	    entries = reallocarray(idx->entries, maxentries,
+		sizeof(*entries));
+	    if (entries == NULL) {
+		sudo_warnx(U_("%s: %s"), __func__,
+		    U_("unable to allocate memory"));
+		free(buf);
+		debug_return_bool(false);
+	    }
+	    idx->entries = entries;
+	}
+	idx->entries[idx->nentries++] = entry;
+    }
+    free(buf);
+
+    debug_return_bool(true);
+}
+
+/*
+ * Load the index for the I/O log directory dfd.
+ * Returns false if there is no index or it could not be read.
+ */
+bool
+iolog_index_load(struct iolog_index *idx, int dfd)
+{
+    bool ret;
+    debug_decl(iolog_index_load, SUDO_DEBUG_UTIL);
+
+    if (!iolog_index_open(idx, dfd, O_RDONLY))
+	debug_return_bool(false);
+    ret = iolog_index_read(idx);
+    fclose(idx->fp);
+    idx->fp = NULL;
+    if (!ret) {
+	free(idx->entries);
+	idx->entries = NULL;
+	idx->nentries = 0;
+    }
+
+    debug_return_bool(ret);
+}
+
+/*
+ * Reopen the index of a log being restarted at the specified elapsed time.
+ * Checkpoints after the restart point are discarded.
+ */
+bool
+iolog_index_reopen(struct iolog_index *idx, int dfd,
+    const struct timespec *elapsed)
+{
+    const struct iolog_index_entry *entry;
+    off_t len = 0;
+    size_t i, n;
+    debug_decl(iolog_index_reopen, SUDO_DEBUG_UTIL);
+
+    if (!iolog_index_open(idx, dfd, O_CREAT|O_RDWR))
+	debug_return_bool(false);
+    if (!iolog_index_read(idx))
+	goto bad;
+
+    /* Rewrite the checkpoints up to the restart point and truncate. */
+    entry = iolog_index_find(idx, elapsed);
+    n = entry ? (size_t)(entry - idx->entries) + 1 : 0;
+    rewind(idx->fp);
+    for (i = 0; i < n; i++)
+	iolog_index_print(idx->fp, &idx->entries[i]);
+    if (fflush(idx->fp) != 0 || (len = ftello(idx->fp)) == -1 ||
+	    ftruncate(fileno(idx->fp), len) == -1)
+	goto bad;
+
+    /* The writer doesn't need the old entries. */
+    free(idx->entries);
+    idx->entries = NULL;
+    idx->nentries = 0;
+    idx->elapsed = *elapsed;
+
+    debug_return_bool(true);
+bad:
+    iolog_index_close(idx, NULL);
+    debug_return_bool(false);
+}
+
+/*
+ * Returns the last checkpoint at or before target, or NULL if none.
+ */
+const struct iolog_index_entry *
+iolog_index_find(const struct iolog_index *idx, const struct timespec *target)
+{
+    size_t lo = 0, hi = idx->nentries;
+    debug_decl(iolog_index_find, SUDO_DEBUG_UTIL);
+
+    while (lo < hi) {
+	const size_t mid = lo + (hi - lo) / 2;
+
+	if (sudo_timespeccmp(&idx->entries[mid].elapsed, target, <=))
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    if (lo == 0)
+	debug_return_const_ptr(NULL);
+    debug_return_const_ptr(&idx->entries[lo - 1]);
+}
+
+/*
+ * Position all the open I/O log files at the specified checkpoint.
+ */
+bool
+iolog_index_seek(const struct iolog_index_entry *entry,
+    struct iolog_file *iolog_files)
+{
+    int iofd;
+    debug_decl(iolog_index_seek, SUDO_DEBUG_UTIL);
+
+    for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	struct iolog_file *iol = &iolog_files[iofd];
+
+	if (!iol->enabled)
+	    continue;
+	if (!iol->codec->resume(iol->fd.v, entry->rawoff[iofd],
+		entry->pos[iofd])) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"%s: unable to resume %s at %lld", __func__,
+		iolog_fd_to_name(iofd), (long long)entry->rawoff[iofd]);
+	    debug_return_bool(false);
+	}
+	iol->codec->clearerr(iol->fd.v);
+    }
+
+    debug_return_bool(true);
+}
+
+/*
+ * Write a checkpoint for the open I/O log files to the index.
+ */
+static bool
+iolog_index_checkpoint(struct iolog_index *idx, struct iolog_file *iolog_files,
+    const char **errstr)
+{
+    struct iolog_index_entry entry;
+    int iofd;
+    debug_decl(iolog_index_checkpoint, SUDO_DEBUG_UTIL);
+
+    memset(&entry, 0, sizeof(entry));
+    entry.elapsed = idx->elapsed;
+    for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	struct iolog_file *iol = &iolog_files[iofd];
+
+	if (!iol->enabled)
+	    continue;
+	if (!iol->codec->checkpoint(iol->fd.v, &entry.rawoff[iofd],
+		&entry.pos[iofd], errstr))
+	    debug_return_bool(false);
+    }
+
+    /* The checkpoint must not be visible before the data it refers to. */
+    iolog_index_print(idx->fp, &entry);
+    if (fflush(idx->fp) != 0) {
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	debug_return_bool(false);
+    }
+    idx->pending = 0;
+
+    debug_return_bool(true);
+}
+
+/*
+ * Update the index after a timing record has been written.
+ * The delay is that of the timing record and len is the number
+ * of bytes written to the I/O log files, including the timing file.
+ * A checkpoint is added every IOLOG_INDEX_INTERVAL bytes.
+ */
+bool
+iolog_index_update(struct iolog_index *idx, struct iolog_file *iolog_files,
+    const struct timespec *delay, size_t len, const char **errstr)
+{
+    debug_decl(iolog_index_update, SUDO_DEBUG_UTIL);
+
+    /* Nothing to do if the index is not in use. */
+    if (idx->fp == NULL)
+	debug_return_bool(true);
+
+    sudo_timespecadd(&idx->elapsed, delay, &idx->elapsed);
+    idx->pending += len;
+    if (idx->pending < IOLOG_INDEX_INTERVAL)
+	debug_return_bool(true);
+
+    debug_return_bool(iolog_index_checkpoint(idx, iolog_files, errstr));
+}
+
+/*
+ * Close the index file, if open, and free any loaded entries.
+ */
+bool
+iolog_index_close(struct iolog_index *idx, const char **errstr)
+{
+    bool ret = true;
+    debug_decl(iolog_index_close, SUDO_DEBUG_UTIL);
+
+    if (idx->fp != NULL) {
+	if (fclose(idx->fp) != 0) {
+	    if (errstr != NULL)
+		*errstr = strerror(errno);
+	    ret = false;
+	}
+	idx->fp = NULL;
+    }
+    free(idx->entries);
+    idx->entries = NULL;
+    idx->nentries = 0;
+
+    debug_return_bool(ret);
+}
@@ -0,0 +1,256 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#ifdef HAVE_LZ4FRAME_H
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include <compat/stdbool.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <lz4frame.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+#include <sudo_iolog.h>
+#include <sudo_util.h>
+
+#include <iolog_codec.h>
+
+#ifndef LZ4F_HEADER_SIZE_MAX
+# define LZ4F_HEADER_SIZE_MAX	19
+#endif
+
+/*
+ * Compressed I/O log files in lz4 frame format.
+ * Blocks are linked so a flush does not reset the compression
+ * history, at the cost of some extra framing per flush.
+ */
+static unsigned char const lz4_magic[4] = {0x04, 0x22, 0x4d, 0x18};
+
+static void
+lz4_prefs(LZ4F_preferences_t *prefs)
+{
+    memset(prefs, 0, sizeof(*prefs));
+    prefs->frameInfo.blockSizeID = LZ4F_max64KB;
+    prefs->frameInfo.blockMode = LZ4F_blockLinked;
+    prefs->frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+}
+
+/*
+ * Write the header for a new lz4 frame.
+ */
+static bool
+lz4_begin(struct iolog_stream *s)
+{
+    LZ4F_preferences_t prefs;
+    size_t ret;
+    debug_decl(lz4_begin, SUDO_DEBUG_UTIL);
+
+    lz4_prefs(&prefs);
+    ret = LZ4F_compressBegin(s->ctx, s->zbuf, s->zbufsize, &prefs);
+    if (LZ4F_isError(ret)) {
+	s->errstr = LZ4F_getErrorName(ret);
+	debug_return_bool(false);
+    }
+    s->zlen = ret;
+    debug_return_bool(iolog_stream_drain(s));
+}
+
+static bool
+lz4_init(struct iolog_stream *s)
+{
+    LZ4F_preferences_t prefs;
+    LZ4F_errorCode_t ret;
+    debug_decl(lz4_init, SUDO_DEBUG_UTIL);
+
+    if (s->writable) {
+	LZ4F_cctx *cctx;
+	size_t bound;
+	void *zbuf;
+
+	ret = LZ4F_createCompressionContext(&cctx, LZ4F_VERSION);
+	if (LZ4F_isError(ret))
+	    goto oom;
+	s->ctx = cctx;
+
+	/* Output buffer must hold a worst case block plus the header. */
+	lz4_prefs(&prefs);
+	bound = LZ4F_compressBound(IOLOG_STREAM_BUFSIZ, &prefs) +
+	    LZ4F_HEADER_SIZE_MAX;
+	if ((zbuf = realloc(s->zbuf, bound)) == NULL)
+	    goto oom;
+	s->zbuf = zbuf;
+	s->zbufsize = bound;
+
+	if (!lz4_begin(s)) {
+	    errno = EINVAL;
+	    debug_return_bool(false);
+	}
+    } else {
+	LZ4F_dctx *dctx;
+
+	ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+	if (LZ4F_isError(ret))
+	    goto oom;
+	s->ctx = dctx;
+    }
+    debug_return_bool(true);
+oom:
+    errno = ENOMEM;
+    debug_return_bool(false);
+}
+
+static void
+lz4_free(struct iolog_stream *s)
+{
+    debug_decl(lz4_free, SUDO_DEBUG_UTIL);
+
+    if (s->writable)
+	LZ4F_freeCompressionContext(s->ctx);
+    else
+	LZ4F_freeDecompressionContext(s->ctx);
+
+    debug_return;
+}
+
+static bool
+lz4_reset(struct iolog_stream *s)
+{
+    debug_decl(lz4_reset, SUDO_DEBUG_UTIL);
+
+    LZ4F_resetDecompressionContext(s->ctx);
+
+    debug_return_bool(true);
+}
+
+static ssize_t
+lz4_decompress(struct iolog_stream *s, void *dst, size_t dstlen)
+{
+    debug_decl(lz4_decompress, SUDO_DEBUG_UTIL);
+
+    for (;;) {
+	size_t dstsize = dstlen;
+	size_t srcsize = s->zlen - s->zoff;
+	ssize_t nread;
+	size_t ret;
+
+	/* The decoder may have buffered output even if there is no input. */
+	ret = LZ4F_decompress(s->ctx, dst, &dstsize, s->zbuf + s->zoff,
+	    &srcsize, NULL);
+	s->zoff += srcsize;
+	if (LZ4F_isError(ret)) {
+	    s->errstr = LZ4F_getErrorName(ret);
+	    debug_return_ssize_t(-1);
+	}
+	if (dstsize != 0)
+	    debug_return_ssize_t((ssize_t)dstsize);
+	if (s->zoff == s->zlen) {
+	    /* A partial frame at EOF is treated as EOF for "sudoreplay -f". */
+	    nread = iolog_stream_fill(s);
+	    if (nread <= 0)
+		debug_return_ssize_t(nread);
+	}
+    }
+}
+
+static bool
+lz4_compress(struct iolog_stream *s, const void *src, size_t len,
+    enum iolog_stream_op op)
+{
+    const unsigned char *cp = src;
+    size_t ret;
+    debug_decl(lz4_compress, SUDO_DEBUG_UTIL);
+
+    /* The previous frame was ended by a checkpoint. */
+    if (s->restart && op != IOLOG_STREAM_END) {
+	if (!lz4_begin(s))
+	    debug_return_bool(false);
+    }
+
+    switch (op) {
+    case IOLOG_STREAM_FLUSH:
+	ret = LZ4F_flush(s->ctx, s->zbuf, s->zbufsize, NULL);
+	break;
+    case IOLOG_STREAM_END:
+	ret = LZ4F_compressEnd(s->ctx, s->zbuf, s->zbufsize, NULL);
+	break;
+    default:
+	/* The output buffer is sized for IOLOG_STREAM_BUFSIZ of input. */
+	while (len > IOLOG_STREAM_BUFSIZ) {
+	    ret = LZ4F_compressUpdate(s->ctx, s->zbuf, s->zbufsize, cp,
+		IOLOG_STREAM_BUFSIZ, NULL);
+	    if (LZ4F_isError(ret))
+		goto bad;
+	    s->zlen = ret;
+	    if (!iolog_stream_drain(s))
+		debug_return_bool(false);
+	    cp += IOLOG_STREAM_BUFSIZ;
+	    len -= IOLOG_STREAM_BUFSIZ;
+	}
+	ret = LZ4F_compressUpdate(s->ctx, s->zbuf, s->zbufsize, cp, len, NULL);
+	break;
+    }
+    if (LZ4F_isError(ret))
+	goto bad;
+    s->zlen = ret;
+    debug_return_bool(iolog_stream_drain(s));
+bad:
+    s->errstr = LZ4F_getErrorName(ret);
+    debug_return_bool(false);
+}
+
+static const struct iolog_stream_ops lz4_ops = {
+    lz4_init,
+    lz4_free,
+    lz4_reset,
+    lz4_decompress,
+    lz4_compress
+};
+
+static void *
+lz4_open(int fd, const char *mode)
+{
+    return iolog_stream_open(fd, mode, &lz4_ops);
+}
+
+const struct iolog_codec iolog_codec_lz4 = {
+    "lz4", lz4_magic, sizeof(lz4_magic),
+    lz4_open,
+    iolog_stream_read,
+    iolog_stream_write,
+    iolog_stream_gets,
+    iolog_stream_seek,
+    iolog_stream_flush,
+    iolog_stream_eof,
+    iolog_stream_clearerr,
+    iolog_stream_close,
+    iolog_stream_checkpoint,
+    iolog_stream_resume
+};
+
+#endif /* HAVE_LZ4FRAME_H */
@@ -39,26 +39,111 @@
 #include <sudo_iolog.h>
 #include <sudo_util.h>
 
+/*
+ * Session IDs reserved by this process when the sequence block size
+ * is larger than one.  The sequence file stores the last ID in the
+ * block, so it only needs to be locked and rewritten once per block
+ * instead of once per session.  IDs that are reserved but never used
+ * (e.g. if the process exits) are simply skipped.
+ */
+static struct seq_reservation {
+    char *iolog_dir;
+    pid_t pid;
+    unsigned long next;
+    unsigned long last;
+} reserved;
+
+/*
+ * Convert id to a string and stash in sessid.
+ * Note that that least significant digits go at the end of the string.
+ */
+static void
+iolog_id_to_str(unsigned long id, char sessid[7])
+{
+    static const char b36char[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    int i;
+
+    for (i = 5; i >= 0; i--) {
+	sessid[i] = b36char[id % 36];
+	id /= 36;
+    }
+    sessid[6] = '\0';
+}
+
+/*
+ * Hand out the next ID from the block reserved by this process, if any.
+ * A forked child must not use IDs reserved by its parent.
+ */
+static bool
+iolog_reserved_id(const char *iolog_dir, char sessid[7])
+{
+    debug_decl(iolog_reserved_id, SUDO_DEBUG_UTIL);
+
+    if (reserved.iolog_dir == NULL || reserved.next > reserved.last)
+	debug_return_bool(false);
+    if (reserved.pid != getpid() || reserved.last > iolog_get_maxseq() ||
+	    strcmp(reserved.iolog_dir, iolog_dir) != 0) {
+	reserved.next = reserved.last + 1;
+	debug_return_bool(false);
+    }
+
+    iolog_id_to_str(reserved.next++, sessid);
+    debug_return_bool(true);
+}
+
+/*
+ * Remember the block of IDs from next to last (inclusive).
+ */
+static void
+iolog_reserve_ids(const char *iolog_dir, unsigned long next,
+    unsigned long last)
+{
+    debug_decl(iolog_reserve_ids, SUDO_DEBUG_UTIL);
+
+    if (reserved.iolog_dir == NULL ||
+	    strcmp(reserved.iolog_dir, iolog_dir) != 0) {
+	free(reserved.iolog_dir);
+	if ((reserved.iolog_dir = strdup(iolog_dir)) == NULL) {
+	    /* Not fatal, we just can't use the rest of the block. */
+	    sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+		"%s: unable to allocate memory", __func__);
+	    debug_return;
+	}
+    }
+    reserved.pid = getpid();
+    reserved.next = next;
+    reserved.last = last;
+
+    debug_return;
+}
+
 /*
  * Read the on-disk sequence number, set sessid to the next
  * number, and update the on-disk copy.
  * Uses file locking to avoid sequence number collisions.
+ * If the sequence block size is larger than one, a block of IDs
+ * is reserved and subsequent calls use it without the sequence file.
  */
 bool
 iolog_nextid(const char *iolog_dir, char sessid[7])
 {
     char buf[32], *ep;
-    int i, fd = -1;
-    unsigned long id = 0;
+    int fd = -1;
+    unsigned long id = 0, last;
+    const unsigned int maxseq = iolog_get_maxseq();
+    const unsigned int block = iolog_get_seqblock();
     size_t len;
     ssize_t nread;
     bool ret = false;
     char pathbuf[PATH_MAX];
-    static const char b36char[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
     const uid_t iolog_uid = iolog_get_uid();
     const gid_t iolog_gid = iolog_get_gid();
     debug_decl(iolog_nextid, SUDO_DEBUG_UTIL);
 
+    /* Use an ID we have already reserved if possible. */
+    if (block > 1 && iolog_reserved_id(iolog_dir, sessid))
+	debug_return_bool(true);
+
     /*
      * Create I/O log directory if it doesn't already exist.
      */
@@ -109,7 +194,7 @@ iolog_nextid(const char *iolog_dir, char sessid[7])
 	    nread--;
 	buf[nread] = '\0';
 	id = strtoul(buf, &ep, 36);
-	if (ep == buf || *ep != '\0' || id >= iolog_get_maxseq()) {
+	if (ep == buf || *ep != '\0' || id >= maxseq) {
 	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 		"%s: bad sequence number: %s", pathbuf, buf);
 	    id = 0;
@@ -117,26 +202,27 @@ iolog_nextid(const char *iolog_dir, char sessid[7])
     }
     id++;
 
-    /*
-     * Convert id to a string and stash in sessid.
-     * Note that that least significant digits go at the end of the string.
-     */
-    for (i = 5; i >= 0; i--) {
-	buf[i] = b36char[id % 36];
-	id /= 36;
+    /* Reserve the rest of the block, the seq file stores the last ID. */
+    last = id;
+    if (block > 1) {
+	last = id + block - 1;
+	if (last > maxseq)
+	    last = maxseq;
     }
-    buf[6] = '\n';
 
-    /* Stash id for logging purposes. */
-    memcpy(sessid, buf, 6);
-    sessid[6] = '\0';
-
-    /* Rewind and overwrite old seq file, including the NUL byte. */
+    /* Rewind and overwrite old seq file, including the newline. */
+    iolog_id_to_str(last, buf);
+    buf[6] = '\n';
     if (pwrite(fd, buf, 7, 0) != 7) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
 	    "%s: unable to write %s", __func__, pathbuf);
 	goto done;
     }
+    if (last > id)
+	iolog_reserve_ids(iolog_dir, id + 1, last);
+
+    /* Stash id for logging purposes. */
+    iolog_id_to_str(id, sessid);
     ret = true;
 
 done:
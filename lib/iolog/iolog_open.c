@@ -35,14 +35,16 @@
 #include <sudo_iolog.h>
 #include <sudo_util.h>
 
-static unsigned char const gzip_magic[2] = {0x1f, 0x8b};
+#include <iolog_codec.h>
 
 /*
  * Open the specified I/O log file and store in iol.
  * Stores the open file handle which has the close-on-exec flag set.
  * Also locks the file if iofd is IOFD_TIMING and mode is writable.
+ * New files are compressed using the configured compression type,
+ * existing files are decompressed based on their magic number.
  * The "r+" and "w+" modes are not supported for compressed logs
- * so the "+" will be stripped before calling gzdopen().
+ * so the "+" will be stripped before opening a compressed log.
  */
 bool
 iolog_open(struct iolog_file *iol, int dfd, int iofd, const char *mode)
@@ -50,7 +52,6 @@ iolog_open(struct iolog_file *iol, int dfd, int iofd, const char *mode)
     int flags;
     const char *file;
     bool lockit = false;
-    unsigned char magic[2];
     const uid_t iolog_uid = iolog_get_uid();
     const gid_t iolog_gid = iolog_get_gid();
     debug_decl(iolog_open, SUDO_DEBUG_UTIL);
@@ -79,6 +80,7 @@ iolog_open(struct iolog_file *iol, int dfd, int iofd, const char *mode)
     iol->writable = false;
     iol->compressed = false;
     iol->locked = false;
+    iol->codec = &iolog_codec_stdio;
     if (iol->enabled) {
 	int fd = iolog_openat(dfd, file, flags|O_NOFOLLOW);
 	if (lockit && fd != -1) {
@@ -98,28 +100,19 @@ iolog_open(struct iolog_file *iol, int dfd, int iofd, const char *mode)
 			"%s: unable to fchown %d:%d %s", __func__,
 			(int)iolog_uid, (int)iolog_gid, file);
 		}
-		iol->compressed = iolog_get_compress();
+		iol->codec = iolog_get_codec();
 	    } else {
-		/* check for gzip magic number */
-		if (pread(fd, magic, sizeof(magic), 0) == ssizeof(magic)) {
-		    if (magic[0] == gzip_magic[0] && magic[1] == gzip_magic[1])
-			iol->compressed = true;
-		}
+		iol->codec = iolog_codec_detect(fd);
 	    }
+	    iol->compressed = iol->codec != &iolog_codec_stdio;
 	    /*
-	     * Compressed logs don't support random access, gzdopen() will
-	     * fail for mode "r+".  Caller must check the compressed flag.
+	     * Compressed logs don't support random access, the codecs
+	     * will fail for mode "r+".  Caller must check the compressed flag.
 	     */
 	    if (iol->compressed)
 		mode = *mode == 'r' ? "r" : "w";
-	    if (fcntl(fd, F_SETFD, FD_CLOEXEC) != -1) {
-#ifdef HAVE_ZLIB_H
-		if (iol->compressed)
-		    iol->fd.g = gzdopen(fd, mode);
-		else
-#endif
-		    iol->fd.f = fdopen(fd, mode);
-	    }
+	    if (fcntl(fd, F_SETFD, FD_CLOEXEC) != -1)
+		iol->fd.v = iol->codec->open(fd, mode);
 	    if (iol->fd.v != NULL) {
 		switch ((flags & O_ACCMODE)) {
 		case O_WRONLY:
@@ -33,6 +33,8 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 /*
  * Read from a (possibly compressed) I/O log file.
  */
@@ -50,25 +52,6 @@ iolog_read(struct iolog_file *iol, void *buf, size_t nbytes,
 	debug_return_ssize_t(-1);
     }
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed) {
-	if ((nread = gzread(iol->fd.g, buf, (unsigned int)nbytes)) == -1) {
-	    if (errstr != NULL) {
-		int errnum;
-		*errstr = gzerror(iol->fd.g, &errnum);
-		if (errnum == Z_ERRNO)
-		    *errstr = strerror(errno);
-	    }
-	}
-    } else
-#endif
-    {
-	nread = (ssize_t)fread(buf, 1, nbytes, iol->fd.f);
-	if (nread <= 0 && ferror(iol->fd.f)) {
-	    nread = -1;
-	    if (errstr != NULL)
-		*errstr = strerror(errno);
-	}
-    }
+    nread = iol->codec->read(iol->fd.v, buf, nbytes, errstr);
     debug_return_ssize_t(nread);
 }
@@ -25,8 +25,11 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 /*
- * I/O log wrapper for fseek/gzseek.
+ * Seek within an I/O log file, like fseeko().
+ * Compressed files only support seeking when opened for reading.
  */
 off_t
 iolog_seek(struct iolog_file *iol, off_t offset, int whence)
@@ -34,31 +37,22 @@ iolog_seek(struct iolog_file *iol, off_t offset, int whence)
     off_t ret;
     //debug_decl(iolog_seek, SUDO_DEBUG_UTIL);
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed)
-	ret = gzseek(iol->fd.g, offset, whence);
-    else
-#endif
-	ret = fseeko(iol->fd.f, offset, whence);
+    ret = iol->codec->seek(iol->fd.v, offset, whence);
 
     //debug_return_off_t(ret);
     return ret;
 }
 
 /*
- * I/O log wrapper for rewind/gzrewind.
+ * Rewind an I/O log file to the beginning, like rewind().
  */
 void
 iolog_rewind(struct iolog_file *iol)
 {
     debug_decl(iolog_rewind, SUDO_DEBUG_UTIL);
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed)
-	(void)gzrewind(iol->fd.g);
-    else
-#endif
-	rewind(iol->fd.f);
+    (void)iol->codec->seek(iol->fd.v, 0, SEEK_SET);
+    iol->codec->clearerr(iol->fd.v);
 
     debug_return;
 }
@@ -0,0 +1,445 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include <compat/stdbool.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+#include <sudo_iolog.h>
+#include <sudo_util.h>
+
+#include <iolog_codec.h>
+
+/*
+ * Buffered stream on top of a streaming compression back end.
+ * Files are opened either for reading or for writing, never both.
+ * Seeking is supported for reading only; seeking backwards rewinds
+ * the file and decompresses it again from the start.
+ * A checkpoint ends the current frame, a reader can resume at the
+ * start of any frame since the back ends support concatenated frames.
+ */
+
+static void
+iolog_stream_free(struct iolog_stream *s)
+{
+    debug_decl(iolog_stream_free, SUDO_DEBUG_UTIL);
+
+    if (s->ctx != NULL)
+	s->ops->free(s);
+    free(s->zbuf);
+    free(s->buf);
+    free(s);
+
+    debug_return;
+}
+
+void *
+iolog_stream_open(int fd, const char *mode, const struct iolog_stream_ops *ops)
+{
+    struct iolog_stream *s;
+    debug_decl(iolog_stream_open, SUDO_DEBUG_UTIL);
+
+    if ((s = calloc(1, sizeof(*s))) == NULL)
+	debug_return_ptr(NULL);
+    s->ops = ops;
+    s->fd = fd;
+    s->writable = mode[0] == 'w';
+    s->zbufsize = IOLOG_STREAM_BUFSIZ;
+    if ((s->zbuf = malloc(s->zbufsize)) == NULL)
+	goto bad;
+    if (!s->writable) {
+	if ((s->buf = malloc(IOLOG_STREAM_BUFSIZ)) == NULL)
+	    goto bad;
+    }
+    if (!ops->init(s))
+	goto bad;
+
+    debug_return_ptr(s);
+bad:
+    iolog_stream_free(s);
+    debug_return_ptr(NULL);
+}
+
+/*
+ * Read more compressed data into the input buffer.
+ * Returns the number of bytes read, 0 on EOF or -1 on error.
+ */
+ssize_t
+iolog_stream_fill(struct iolog_stream *s)
+{
+    ssize_t nread;
+    debug_decl(iolog_stream_fill, SUDO_DEBUG_UTIL);
+
+    do {
+	nread = read(s->fd, s->zbuf, s->zbufsize);
+    } while (nread == -1 && errno == EINTR);
+    if (nread == -1) {
+	s->errstr = strerror(errno);
+	debug_return_ssize_t(-1);
+    }
+    s->zoff = 0;
+    s->zlen = (size_t)nread;
+
+    debug_return_ssize_t(nread);
+}
+
+/*
+ * Write out the compressed data in the output buffer.
+ */
+bool
+iolog_stream_drain(struct iolog_stream *s)
+{
+    size_t off = 0;
+    debug_decl(iolog_stream_drain, SUDO_DEBUG_UTIL);
+
+    while (off < s->zlen) {
+	ssize_t nwritten = write(s->fd, s->zbuf + off, s->zlen - off);
+	if (nwritten == -1) {
+	    if (errno == EINTR)
+		continue;
+	    s->errstr = strerror(errno);
+	    debug_return_bool(false);
+	}
+	off += (size_t)nwritten;
+    }
+    s->zlen = 0;
+
+    debug_return_bool(true);
+}
+
+/*
+ * Decompress the next chunk of data into the read buffer.
+ * Returns false on EOF or error.
+ */
+static bool
+iolog_stream_refill(struct iolog_stream *s)
+{
+    ssize_t len;
+    debug_decl(iolog_stream_refill, SUDO_DEBUG_UTIL);
+
+    if (s->error)
+	debug_return_bool(false);
+    len = s->ops->decompress(s, s->buf, IOLOG_STREAM_BUFSIZ);
+    if (len <= 0) {
+	if (len == 0)
+	    s->eof = true;
+	else
+	    s->error = true;
+	debug_return_bool(false);
+    }
+    s->off = 0;
+    s->len = (size_t)len;
+
+    debug_return_bool(true);
+}
+
+ssize_t
+iolog_stream_read(void *cookie, void *vbuf, size_t nbytes, const char **errstr)
+{
+    struct iolog_stream *s = cookie;
+    unsigned char *buf = vbuf;
+    size_t total = 0;
+    debug_decl(iolog_stream_read, SUDO_DEBUG_UTIL);
+
+    if (s->writable) {
+	errno = EBADF;
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	debug_return_ssize_t(-1);
+    }
+
+    while (total < nbytes) {
+	size_t n;
+
+	if (s->off == s->len && !iolog_stream_refill(s))
+	    break;
+	n = MIN(nbytes - total, s->len - s->off);
+	memcpy(buf + total, s->buf + s->off, n);
+	s->off += n;
+	s->pos += (off_t)n;
+	total += n;
+    }
+    if (total == 0 && s->error) {
+	if (errstr != NULL)
+	    *errstr = s->errstr;
+	debug_return_ssize_t(-1);
+    }
+
+    debug_return_ssize_t((ssize_t)total);
+}
+
+/*
+ * Like fgets(3), reads at most bufsize - 1 bytes, stopping after a newline.
+ */
+char *
+iolog_stream_gets(void *cookie, char *buf, int bufsize, const char **errstr)
+{
+    struct iolog_stream *s = cookie;
+    size_t total = 0;
+    debug_decl(iolog_stream_gets, SUDO_DEBUG_UTIL);
+
+    if (s->writable || bufsize <= 0) {
+	errno = s->writable ? EBADF : EINVAL;
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	debug_return_str(NULL);
+    }
+
+    while (total < (size_t)bufsize - 1) {
+	unsigned char *nl;
+	size_t n;
+
+	if (s->off == s->len && !iolog_stream_refill(s))
+	    break;
+	n = MIN((size_t)bufsize - 1 - total, s->len - s->off);
+	nl = memchr(s->buf + s->off, '\n', n);
+	if (nl != NULL)
+	    n = (size_t)(nl - (s->buf + s->off)) + 1;
+	memcpy(buf + total, s->buf + s->off, n);
+	s->off += n;
+	s->pos += (off_t)n;
+	total += n;
+	if (nl != NULL)
+	    break;
+    }
+    if (total == 0 && bufsize > 1) {
+	if (errstr != NULL)
+	    *errstr = s->error ? s->errstr : strerror(errno);
+	debug_return_str(NULL);
+    }
+    buf[total] = '\0';
+
+    debug_return_str(buf);
+}
+
+ssize_t
+iolog_stream_write(void *cookie, const void *buf, size_t len,
+    const char **errstr)
+{
+    struct iolog_stream *s = cookie;
+    debug_decl(iolog_stream_write, SUDO_DEBUG_UTIL);
+
+    if (!s->writable) {
+	errno = EBADF;
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	debug_return_ssize_t(-1);
+    }
+    if (s->error || !s->ops->compress(s, buf, len, IOLOG_STREAM_CONTINUE)) {
+	s->error = true;
+	if (errstr != NULL)
+	    *errstr = s->errstr;
+	debug_return_ssize_t(-1);
+    }
+    s->pos += (off_t)len;
+    s->dirty = true;
+    s->restart = false;
+
+    debug_return_ssize_t((ssize_t)len);
+}
+
+off_t
+iolog_stream_seek(void *cookie, off_t offset, int whence)
+{
+    struct iolog_stream *s = cookie;
+    off_t target;
+
+    switch (whence) {
+    case SEEK_SET:
+	target = offset;
+	break;
+    case SEEK_CUR:
+	target = s->pos + offset;
+	break;
+    default:
+	target = -1;
+	break;
+    }
+    if (target < 0 || (s->writable && target != s->pos)) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    if (target < s->pos) {
+	/* Start over from the beginning. */
+	if (!iolog_stream_resume(s, 0, 0))
+	    return -1;
+    }
+    while (s->pos < target) {
+	size_t n;
+
+	if (s->off == s->len && !iolog_stream_refill(s))
+	    break;
+	n = (size_t)MIN(target - s->pos, (off_t)(s->len - s->off));
+	s->off += n;
+	s->pos += (off_t)n;
+    }
+    if (s->error) {
+	errno = EIO;
+	return -1;
+    }
+
+    return s->pos;
+}
+
+bool
+iolog_stream_flush(void *cookie, const char **errstr)
+{
+    struct iolog_stream *s = cookie;
+    debug_decl(iolog_stream_flush, SUDO_DEBUG_UTIL);
+
+    /* Flushing an unchanged stream would just add empty blocks. */
+    if (!s->writable || !s->dirty)
+	debug_return_bool(true);
+    if (s->error || !s->ops->compress(s, NULL, 0, IOLOG_STREAM_FLUSH)) {
+	s->error = true;
+	if (errstr != NULL)
+	    *errstr = s->errstr;
+	debug_return_bool(false);
+    }
+    s->dirty = false;
+
+    debug_return_bool(true);
+}
+
+bool
+iolog_stream_eof(void *cookie)
+{
+    struct iolog_stream *s = cookie;
+
+    return s->eof;
+}
+
+void
+iolog_stream_clearerr(void *cookie)
+{
+    struct iolog_stream *s = cookie;
+
+    s->eof = false;
+    s->error = false;
+}
+
+bool
+iolog_stream_close(void *cookie, bool writable, const char **errstr)
+{
+    struct iolog_stream *s = cookie;
+    bool ret = true;
+    debug_decl(iolog_stream_close, SUDO_DEBUG_UTIL);
+
+    /* Finish the compressed frame before closing. */
+    if (s->writable && !s->restart) {
+	if (s->error || !s->ops->compress(s, NULL, 0, IOLOG_STREAM_END)) {
+	    if (errstr != NULL)
+		*errstr = s->errstr ? s->errstr : "unknown error";
+	    ret = false;
+	}
+    }
+    if (close(s->fd) != 0 && ret) {
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	ret = false;
+    }
+    iolog_stream_free(s);
+
+    debug_return_bool(ret);
+}
+
+/*
+ * End the current frame so that a reader can resume decompressing
+ * at the returned file offset.  The next write starts a new frame.
+ */
+bool
+iolog_stream_checkpoint(void *cookie, off_t *rawoff, off_t *pos,
+    const char **errstr)
+{
+    struct iolog_stream *s = cookie;
+    debug_decl(iolog_stream_checkpoint, SUDO_DEBUG_UTIL);
+
+    if (!s->writable) {
+	errno = EBADF;
+	if (errstr != NULL)
+	    *errstr = strerror(errno);
+	debug_return_bool(false);
+    }
+
+    /* Nothing to do if no data has been written to the current frame. */
+    if (s->pos != s->frame_pos) {
+	if (s->error || !s->ops->compress(s, NULL, 0, IOLOG_STREAM_END)) {
+	    s->error = true;
+	    if (errstr != NULL)
+		*errstr = s->errstr;
+	    debug_return_bool(false);
+	}
+	s->frame_raw = lseek(s->fd, 0, SEEK_CUR);
+	if (s->frame_raw == -1) {
+	    s->error = true;
+	    if (errstr != NULL)
+		*errstr = strerror(errno);
+	    debug_return_bool(false);
+	}
+	s->frame_pos = s->pos;
+	s->restart = true;
+	s->dirty = false;
+    }
+    *rawoff = s->frame_raw;
+    *pos = s->frame_pos;
+
+    debug_return_bool(true);
+}
+
+/*
+ * Resume reading at the start of a frame, where rawoff is the
+ * offset in the file and pos the corresponding uncompressed offset.
+ */
+bool
+iolog_stream_resume(void *cookie, off_t rawoff, off_t pos)
+{
+    struct iolog_stream *s = cookie;
+    debug_decl(iolog_stream_resume, SUDO_DEBUG_UTIL);
+
+    if (s->writable) {
+	errno = EBADF;
+	debug_return_bool(false);
+    }
+    if (lseek(s->fd, rawoff, SEEK_SET) == -1)
+	debug_return_bool(false);
+    if (!s->ops->reset(s)) {
+	errno = EIO;
+	debug_return_bool(false);
+    }
+    s->pos = pos;
+    s->off = s->len = 0;
+    s->zoff = s->zlen = 0;
+    s->eof = s->error = false;
+
+    debug_return_bool(true);
+}
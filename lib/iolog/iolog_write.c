@@ -33,6 +33,8 @@
 #include <sudo_debug.h>
 #include <sudo_iolog.h>
 
+#include <iolog_codec.h>
+
 /*
  * Write to an I/O log, optionally compressing.
  */
@@ -50,49 +52,12 @@ iolog_write(struct iolog_file *iol, const void *buf, size_t len,
 	debug_return_ssize_t(-1);
     }
 
-#ifdef HAVE_ZLIB_H
-    if (iol->compressed) {
-	int errnum;
-
-	ret = gzwrite(iol->fd.g, buf, (unsigned int)len);
-	if (ret == 0) {
-	    ret = -1;
-	    if (errstr != NULL) {
-		*errstr = gzerror(iol->fd.g, &errnum);
-		if (errnum == Z_ERRNO)
-		    *errstr = strerror(errno);
-	    }
-	    goto done;
-	}
-	if (iolog_get_flush()) {
-	    if (gzflush(iol->fd.g, Z_SYNC_FLUSH) != Z_OK) {
-		ret = -1;
-		if (errstr != NULL) {
-		    *errstr = gzerror(iol->fd.g, &errnum);
-		    if (errnum == Z_ERRNO)
-			*errstr = strerror(errno);
-		}
-		goto done;
-	    }
-	}
-    } else
-#endif
-    {
-	ret = (ssize_t)fwrite(buf, 1, len, iol->fd.f);
-	if (ret != (ssize_t)len) {
+    ret = iol->codec->write(iol->fd.v, buf, len, errstr);
+    if (ret == -1)
+	goto done;
+    if (iolog_get_flush()) {
+	if (!iol->codec->flush(iol->fd.v, errstr))
 	    ret = -1;
-	    if (errstr != NULL)
-		*errstr = strerror(errno);
-	    goto done;
-	}
-	if (iolog_get_flush()) {
-	    if (fflush(iol->fd.f) != 0) {
-		ret = -1;
-		if (errstr != NULL)
-		    *errstr = strerror(errno);
-		goto done;
-	    }
-	}
     }
 
 done:
@@ -0,0 +1,200 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#ifdef HAVE_ZSTD_H
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include <compat/stdbool.h>
+#endif
+#include <errno.h>
+#include <time.h>
+#include <zstd.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+#include <sudo_iolog.h>
+
+#include <iolog_codec.h>
+
+/*
+ * Compressed I/O log files in zstd format.
+ * A flush ends the current zstd block but keeps the compression
+ * window, so frequent flushes cost less than they do with gzip.
+ */
+static unsigned char const zstd_magic[4] = {0x28, 0xb5, 0x2f, 0xfd};
+
+static bool
+zstd_init(struct iolog_stream *s)
+{
+    debug_decl(zstd_init, SUDO_DEBUG_UTIL);
+
+    if (s->writable) {
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+	if (cctx == NULL)
+	    goto oom;
+	(void)ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel,
+	    ZSTD_CLEVEL_DEFAULT);
+	(void)ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+	s->ctx = cctx;
+    } else {
+	ZSTD_DCtx *dctx = ZSTD_createDCtx();
+	if (dctx == NULL)
+	    goto oom;
+	s->ctx = dctx;
+    }
+    debug_return_bool(true);
+oom:
+    errno = ENOMEM;
+    debug_return_bool(false);
+}
+
+static void
+zstd_free(struct iolog_stream *s)
+{
+    debug_decl(zstd_free, SUDO_DEBUG_UTIL);
+
+    if (s->writable)
+	ZSTD_freeCCtx(s->ctx);
+    else
+	ZSTD_freeDCtx(s->ctx);
+
+    debug_return;
+}
+
+static bool
+zstd_reset(struct iolog_stream *s)
+{
+    size_t ret;
+    debug_decl(zstd_reset, SUDO_DEBUG_UTIL);
+
+    ret = ZSTD_DCtx_reset(s->ctx, ZSTD_reset_session_only);
+    if (ZSTD_isError(ret)) {
+	s->errstr = ZSTD_getErrorName(ret);
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
+
+static ssize_t
+zstd_decompress(struct iolog_stream *s, void *dst, size_t dstlen)
+{
+    ZSTD_outBuffer out = { dst, dstlen, 0 };
+    debug_decl(zstd_decompress, SUDO_DEBUG_UTIL);
+
+    for (;;) {
+	ZSTD_inBuffer in = { s->zbuf + s->zoff, s->zlen - s->zoff, 0 };
+	size_t ret;
+	ssize_t nread;
+
+	/* The decoder may have buffered output even if there is no input. */
+	ret = ZSTD_decompressStream(s->ctx, &out, &in);
+	s->zoff += in.pos;
+	if (ZSTD_isError(ret)) {
+	    s->errstr = ZSTD_getErrorName(ret);
+	    debug_return_ssize_t(-1);
+	}
+	if (out.pos != 0)
+	    break;
+	if (s->zoff == s->zlen) {
+	    /* A partial frame at EOF is treated as EOF for "sudoreplay -f". */
+	    nread = iolog_stream_fill(s);
+	    if (nread <= 0)
+		debug_return_ssize_t(nread);
+	}
+    }
+
+    debug_return_ssize_t((ssize_t)out.pos);
+}
+
+static bool
+zstd_compress(struct iolog_stream *s, const void *src, size_t len,
+    enum iolog_stream_op op)
+{
+    ZSTD_inBuffer in = { src, len, 0 };
+    ZSTD_EndDirective mode;
+    debug_decl(zstd_compress, SUDO_DEBUG_UTIL);
+
+    switch (op) {
+    case IOLOG_STREAM_FLUSH:
+	mode = ZSTD_e_flush;
+	break;
+    case IOLOG_STREAM_END:
+	mode = ZSTD_e_end;
+	break;
+    default:
+	mode = ZSTD_e_continue;
+	break;
+    }
+
+    for (;;) {
+	ZSTD_outBuffer out = { s->zbuf, s->zbufsize, 0 };
+	size_t remaining;
+
+	remaining = ZSTD_compressStream2(s->ctx, &out, &in, mode);
+	if (ZSTD_isError(remaining)) {
+	    s->errstr = ZSTD_getErrorName(remaining);
+	    debug_return_bool(false);
+	}
+	s->zlen = out.pos;
+	if (!iolog_stream_drain(s))
+	    debug_return_bool(false);
+	if (mode == ZSTD_e_continue ? in.pos == in.size : remaining == 0)
+	    break;
+    }
+
+    debug_return_bool(true);
+}
+
+static const struct iolog_stream_ops zstd_ops = {
+    zstd_init,
+    zstd_free,
+    zstd_reset,
+    zstd_decompress,
+    zstd_compress
+};
+
+static void *
+zstd_open(int fd, const char *mode)
+{
+    return iolog_stream_open(fd, mode, &zstd_ops);
+}
+
+const struct iolog_codec iolog_codec_zstd = {
+    "zstd", zstd_magic, sizeof(zstd_magic),
+    zstd_open,
+    iolog_stream_read,
+    iolog_stream_write,
+    iolog_stream_gets,
+    iolog_stream_seek,
+    iolog_stream_flush,
+    iolog_stream_eof,
+    iolog_stream_clearerr,
+    iolog_stream_close,
+    iolog_stream_checkpoint,
+    iolog_stream_resume
+};
+
+#endif /* HAVE_ZSTD_H */
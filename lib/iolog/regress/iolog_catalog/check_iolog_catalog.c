@@ -0,0 +1,206 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/wait.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudo_compat.h>
+#include <sudo_eventlog.h>
+#include <sudo_fatal.h>
+#include <sudo_iolog.h>
+#include <sudo_util.h>
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+struct catalog_test {
+    const char *submituser;
+    const char *submithost;
+    const char *ttyname;
+    const char *cwd;
+    const char *runuser;
+    const char *rungroup;
+    const char *iolog_file;
+    const char *command;
+    char *runargv[5];
+    const char *expected_cmd;
+};
+
+static struct catalog_test test_data[] = {
+    {
+	"alice", "host1", "/dev/pts/0", "/home/alice", "root", NULL,
+	"00/00/01", "/bin/ls", { "ls", "-l", "/tmp", NULL },
+	"/bin/ls -l /tmp"
+    },
+    {
+	"bob", "host2", NULL, "/", "operator", "wheel",
+	"bob/session\twith\ttabs", "/usr/bin/id", { "id", NULL },
+	"/usr/bin/id"
+    },
+    {
+	"carol", "host1", "/dev/pts/3", "/tmp/a\\b", "root", NULL,
+	"00/00/03", "/bin/echo", { "echo", "line1\nline2", "back\\slash", NULL },
+	"/bin/echo line1\nline2 back\\slash"
+    },
+};
+
+static bool
+compare_field(const char *name, const char *expected, const char *got)
+{
+    if (expected == NULL && got == NULL)
+	return true;
+    if (expected != NULL && got != NULL && strcmp(expected, got) == 0)
+	return true;
+    sudo_warnx("%s: expected \"%s\", got \"%s\"", name,
+	expected ? expected : "(NULL)", got ? got : "(NULL)");
+    return false;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char testdir[] = "catalog.XXXXXX";
+    const char *rmargs[] = { "rm", "-rf", NULL, NULL };
+    char pathbuf[PATH_MAX], *buf = NULL;
+    int ch, status, ntests = 0, errors = 0;
+    size_t bufsize = 0;
+    struct eventlog evlog;
+    unsigned int i;
+    FILE *fp;
+
+    initprogname(argc > 0 ? argv[0] : "check_iolog_catalog");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    /* ignored */
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (mkdtemp(testdir) == NULL)
+	sudo_fatal("unable to create test dir");
+    rmargs[2] = testdir;
+
+    iolog_set_owner(geteuid(), getegid());
+    for (i = 0; i < nitems(test_data); i++) {
+	struct catalog_test *test = &test_data[i];
+
+	ntests++;
+	memset(&evlog, 0, sizeof(evlog));
+	if (asprintf(&evlog.iolog_path, "%s/%s", testdir, test->iolog_file) == -1)
+	    sudo_fatalx("unable to allocate memory");
+	evlog.iolog_file = evlog.iolog_path + strlen(testdir) + 1;
+	evlog.submituser = (char *)test->submituser;
+	evlog.submithost = (char *)test->submithost;
+	evlog.ttyname = (char *)test->ttyname;
+	evlog.cwd = (char *)test->cwd;
+	evlog.runuser = (char *)test->runuser;
+	evlog.rungroup = (char *)test->rungroup;
+	evlog.command = (char *)test->command;
+	evlog.runargv = test->runargv;
+	evlog.event_time.tv_sec = 1700000000 + (time_t)i;
+	evlog.event_time.tv_nsec = 123456789;
+	if (!iolog_catalog_add(&evlog)) {
+	    sudo_warnx("unable to add %s to catalog", test->iolog_file);
+	    errors++;
+	}
+	free(evlog.iolog_path);
+    }
+
+    (void)snprintf(pathbuf, sizeof(pathbuf), "%s/catalog", testdir);
+    if ((fp = fopen(pathbuf, "a+")) == NULL)
+	sudo_fatal("%s", pathbuf);
+
+    /* A partially-written record at the end must not be returned. */
+    if (fputs("1700000009.000000000\tdave", fp) == EOF || fflush(fp) != 0)
+	sudo_fatal("%s", pathbuf);
+    rewind(fp);
+
+    for (i = 0; i < nitems(test_data); i++) {
+	struct catalog_test *test = &test_data[i];
+
+	ntests++;
+	if (iolog_catalog_read(fp, &buf, &bufsize, &evlog) != 1) {
+	    sudo_warnx("unable to read catalog entry %u", i);
+	    errors++;
+	    continue;
+	}
+	if (evlog.event_time.tv_sec != 1700000000 + (time_t)i ||
+		evlog.event_time.tv_nsec != 123456789) {
+	    sudo_warnx("%u: wrong time %lld.%09ld", i,
+		(long long)evlog.event_time.tv_sec, evlog.event_time.tv_nsec);
+	    errors++;
+	    continue;
+	}
+	if (!compare_field("submituser", test->submituser, evlog.submituser) ||
+		!compare_field("submithost", test->submithost, evlog.submithost) ||
+		!compare_field("ttyname", test->ttyname, evlog.ttyname) ||
+		!compare_field("cwd", test->cwd, evlog.cwd) ||
+		!compare_field("runuser", test->runuser, evlog.runuser) ||
+		!compare_field("rungroup", test->rungroup, evlog.rungroup) ||
+		!compare_field("iolog_file", test->iolog_file, evlog.iolog_file) ||
+		!compare_field("command", test->expected_cmd, evlog.command)) {
+	    errors++;
+	}
+    }
+    ntests++;
+    if (iolog_catalog_read(fp, &buf, &bufsize, &evlog) != -1 ||
+	    iolog_catalog_read(fp, &buf, &bufsize, &evlog) != 0) {
+	sudo_warnx("incomplete record not detected");
+	errors++;
+    }
+    fclose(fp);
+    free(buf);
+
+    if (ntests != 0) {
+	printf("iolog_catalog: %d test%s run, %d errors, %d%% success rate\n",
+	    ntests, ntests == 1 ? "" : "s", errors,
+	    (ntests - errors) * 100 / ntests);
+    }
+
+    /* Clean up (avoid running via shell) */
+    switch (fork()) {
+    case -1:
+	sudo_warn("fork");
+	_exit(1);
+    case 0:
+	execvp("rm", (char **)rmargs);
+	_exit(1);
+    default:
+	wait(&status);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	    errors++;
+	break;
+    }
+
+    return errors;
+}
@@ -0,0 +1,306 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudo_compat.h>
+#include <sudo_util.h>
+#include <sudo_fatal.h>
+#include <sudo_iolog.h>
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+/* Larger than the codec buffers to exercise refills. */
+#define NLINES	20000
+
+static const char *compress_types[] = {
+    "none", "gzip", "zstd", "lz4"
+};
+
+static size_t
+fill_line(char *buf, size_t bufsize, unsigned int n)
+{
+    return (size_t)snprintf(buf, bufsize, "%u %08x line of I/O log data\n",
+	n, n * 2654435761U);
+}
+
+/*
+ * Write NLINES lines, read them back and seek within the file.
+ */
+static void
+test_roundtrip(int dfd, const char *type, int *ntests, int *nerrors)
+{
+    struct iolog_file iol;
+    const char *errstr = NULL;
+    char line[256], expected[256];
+    off_t offset = 0, seek_offset = 0;
+    size_t len;
+    unsigned int n;
+    ssize_t nread;
+
+    memset(&iol, 0, sizeof(iol));
+    iol.enabled = true;
+    (*ntests)++;
+    if (!iolog_open(&iol, dfd, IOFD_STDOUT, "w")) {
+	sudo_warn("%s: unable to open for writing", type);
+	(*nerrors)++;
+	return;
+    }
+    for (n = 0; n < NLINES; n++) {
+	len = fill_line(line, sizeof(line), n);
+	if (n == NLINES / 2)
+	    seek_offset = offset;
+	if (iolog_write(&iol, line, len, &errstr) != (ssize_t)len) {
+	    sudo_warnx("%s: write: %s", type, errstr);
+	    (*nerrors)++;
+	    break;
+	}
+	offset += (off_t)len;
+    }
+    if (!iolog_close(&iol, &errstr)) {
+	sudo_warnx("%s: close: %s", type, errstr);
+	(*nerrors)++;
+	return;
+    }
+
+    /* Read back line by line, the codec is chosen by magic number. */
+    (*ntests)++;
+    iol.enabled = true;
+    if (!iolog_open(&iol, dfd, IOFD_STDOUT, "r")) {
+	sudo_warn("%s: unable to open for reading", type);
+	(*nerrors)++;
+	return;
+    }
+    if (iol.compressed != (strcmp(type, "none") != 0)) {
+	sudo_warnx("%s: compressed flag is %d", type, iol.compressed);
+	(*nerrors)++;
+    }
+    for (n = 0; n < NLINES; n++) {
+	fill_line(expected, sizeof(expected), n);
+	if (iolog_gets(&iol, line, sizeof(line), &errstr) == NULL) {
+	    sudo_warnx("%s: line %u: %s", type, n, errstr);
+	    (*nerrors)++;
+	    break;
+	}
+	if (strcmp(line, expected) != 0) {
+	    sudo_warnx("%s: line %u: expected \"%s\", got \"%s\"", type, n,
+		expected, line);
+	    (*nerrors)++;
+	    break;
+	}
+    }
+    (*ntests)++;
+    if (iolog_gets(&iol, line, sizeof(line), &errstr) != NULL ||
+	    !iolog_eof(&iol)) {
+	sudo_warnx("%s: expected EOF", type);
+	(*nerrors)++;
+    }
+
+    /* Seek back to the middle of the file. */
+    (*ntests)++;
+    iolog_clearerr(&iol);
+    if (iolog_seek(&iol, seek_offset, SEEK_SET) != seek_offset) {
+	sudo_warnx("%s: unable to seek to %lld", type, (long long)seek_offset);
+	(*nerrors)++;
+    } else {
+	len = fill_line(expected, sizeof(expected), NLINES / 2);
+	nread = iolog_read(&iol, line, len, &errstr);
+	if (nread != (ssize_t)len || memcmp(line, expected, len) != 0) {
+	    sudo_warnx("%s: wrong data after seek", type);
+	    (*nerrors)++;
+	}
+    }
+
+    /* Skip forward one line relative to the current position. */
+    (*ntests)++;
+    len = fill_line(expected, sizeof(expected), NLINES / 2 + 1);
+    if (iolog_seek(&iol, (off_t)len, SEEK_CUR) == -1) {
+	sudo_warnx("%s: unable to seek forward", type);
+	(*nerrors)++;
+    } else {
+	len = fill_line(expected, sizeof(expected), NLINES / 2 + 2);
+	nread = iolog_read(&iol, line, len, &errstr);
+	if (nread != (ssize_t)len || memcmp(line, expected, len) != 0) {
+	    sudo_warnx("%s: wrong data after relative seek", type);
+	    (*nerrors)++;
+	}
+    }
+
+    /* Rewind and read the first line again. */
+    (*ntests)++;
+    iolog_rewind(&iol);
+    fill_line(expected, sizeof(expected), 0);
+    if (iolog_gets(&iol, line, sizeof(line), &errstr) == NULL ||
+	    strcmp(line, expected) != 0) {
+	sudo_warnx("%s: wrong data after rewind", type);
+	(*nerrors)++;
+    }
+    iolog_close(&iol, NULL);
+}
+
+/*
+ * Read flushed data while the file is still being written,
+ * like "sudoreplay -f" does.
+ */
+static void
+test_follow(int dfd, const char *type, int *ntests, int *nerrors)
+{
+    struct iolog_file wiol, riol;
+    const char *errstr = NULL;
+    char line[256], expected[256];
+    unsigned int n;
+    size_t len;
+
+    memset(&wiol, 0, sizeof(wiol));
+    wiol.enabled = true;
+    memset(&riol, 0, sizeof(riol));
+    riol.enabled = true;
+
+    (*ntests)++;
+    if (!iolog_open(&wiol, dfd, IOFD_STDERR, "w")) {
+	sudo_warn("%s: unable to open for writing", type);
+	(*nerrors)++;
+	return;
+    }
+    len = fill_line(line, sizeof(line), 0);
+    if (iolog_write(&wiol, line, len, &errstr) == -1 ||
+	    !iolog_flush(&wiol, &errstr)) {
+	sudo_warnx("%s: write: %s", type, errstr);
+	(*nerrors)++;
+	goto done;
+    }
+    if (!iolog_open(&riol, dfd, IOFD_STDERR, "r")) {
+	sudo_warn("%s: unable to open for reading", type);
+	(*nerrors)++;
+	goto done;
+    }
+
+    for (n = 0; n < 3; n++) {
+	(*ntests)++;
+	fill_line(expected, sizeof(expected), n);
+	if (iolog_gets(&riol, line, sizeof(line), &errstr) == NULL ||
+		strcmp(line, expected) != 0) {
+	    sudo_warnx("%s: follow: unable to read flushed line %u", type, n);
+	    (*nerrors)++;
+	    break;
+	}
+	if (iolog_gets(&riol, line, sizeof(line), &errstr) != NULL) {
+	    sudo_warnx("%s: follow: unexpected data after line %u", type, n);
+	    (*nerrors)++;
+	    break;
+	}
+	iolog_clearerr(&riol);
+
+	len = fill_line(line, sizeof(line), n + 1);
+	if (iolog_write(&wiol, line, len, &errstr) == -1 ||
+		!iolog_flush(&wiol, &errstr)) {
+	    sudo_warnx("%s: write: %s", type, errstr);
+	    (*nerrors)++;
+	    break;
+	}
+    }
+    iolog_close(&riol, NULL);
+done:
+    iolog_close(&wiol, NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+    char testdir[] = "codec.XXXXXX";
+    const char *rmargs[] = { "rm", "-rf", NULL, NULL };
+    int ch, dfd, status, ntests = 0, errors = 0;
+    bool verbose = false;
+    unsigned int i;
+
+    initprogname(argc > 0 ? argv[0] : "check_iolog_codec");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose = true;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (mkdtemp(testdir) == NULL)
+	sudo_fatal("unable to create test dir");
+    rmargs[2] = testdir;
+    if ((dfd = open(testdir, O_RDONLY)) == -1)
+	sudo_fatal("%s", testdir);
+
+    iolog_set_owner(geteuid(), getegid());
+    for (i = 0; i < nitems(compress_types); i++) {
+	const char *type = compress_types[i];
+
+	iolog_set_compress(strcmp(type, "none") != 0);
+	if (!iolog_set_compress_type(iolog_get_compress() ? type : NULL)) {
+	    if (verbose)
+		printf("%s: not supported, skipping\n", type);
+	    continue;
+	}
+	if (strcmp(iolog_get_compress_type(), type) != 0) {
+	    sudo_warnx("%s: compression type is %s", type,
+		iolog_get_compress_type());
+	    errors++;
+	}
+	if (verbose)
+	    printf("%s: testing\n", type);
+	test_roundtrip(dfd, type, &ntests, &errors);
+	test_follow(dfd, type, &ntests, &errors);
+    }
+    close(dfd);
+
+    if (ntests != 0) {
+	printf("iolog_codec: %d test%s run, %d errors, %d%% success rate\n",
+	    ntests, ntests == 1 ? "" : "s", errors,
+	    (ntests - errors) * 100 / ntests);
+    }
+
+    /* Clean up (avoid running via shell) */
+    switch (fork()) {
+    case -1:
+	sudo_warn("fork");
+	_exit(1);
+    case 0:
+	execvp("rm", (char **)rmargs);
+	_exit(1);
+    default:
+	wait(&status);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	    errors++;
+	break;
+    }
+
+    return errors;
+}
@@ -0,0 +1,286 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudo_compat.h>
+#include <sudo_util.h>
+#include <sudo_fatal.h>
+#include <sudo_iolog.h>
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+/* Each record is one second long, enough records for several checkpoints. */
+#define NRECORDS	1024
+#define RECSIZE		4096
+
+static const char *compress_types[] = {
+    "none", "gzip", "zstd", "lz4"
+};
+
+static void
+fill_record(char *buf, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < RECSIZE; i++)
+	buf[i] = (char)('a' + (n + i / 64) % 26);
+    snprintf(buf, RECSIZE, "record %u", n);
+}
+
+/*
+ * Write NRECORDS stdout records along with the timing file and index.
+ */
+static bool
+write_session(int dfd, struct iolog_file *iolog_files)
+{
+    struct timespec delay = { 1, 0 };
+    struct iolog_index idx;
+    const char *errstr = NULL;
+    char buf[RECSIZE], tbuf[64];
+    unsigned int n;
+    int iofd, len;
+
+    for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	iolog_files[iofd].enabled = iofd == IOFD_STDOUT || iofd == IOFD_TIMING;
+	if (!iolog_open(&iolog_files[iofd], dfd, iofd, "w")) {
+	    sudo_warn("unable to open %s", iolog_fd_to_name(iofd));
+	    return false;
+	}
+    }
+    if (!iolog_index_create(&idx, dfd)) {
+	sudo_warn("unable to create index");
+	return false;
+    }
+    for (n = 0; n < NRECORDS; n++) {
+	fill_record(buf, n);
+	len = snprintf(tbuf, sizeof(tbuf), "%d 1.000000000 %d\n",
+	    IO_EVENT_STDOUT, RECSIZE);
+	if (iolog_write(&iolog_files[IOFD_STDOUT], buf, RECSIZE, &errstr) == -1 ||
+		iolog_write(&iolog_files[IOFD_TIMING], tbuf, (size_t)len,
+		&errstr) == -1) {
+	    sudo_warnx("write: %s", errstr);
+	    return false;
+	}
+	if (!iolog_index_update(&idx, iolog_files, &delay,
+		RECSIZE + (size_t)len, &errstr)) {
+	    sudo_warnx("index: %s", errstr);
+	    return false;
+	}
+    }
+    for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	if (iolog_files[iofd].enabled)
+	    iolog_close(&iolog_files[iofd], NULL);
+    }
+    return iolog_index_close(&idx, &errstr);
+}
+
+/*
+ * Jump to target using the index and check that the next
+ * record is the one that starts at that time.
+ */
+static bool
+check_seek(const char *type, struct iolog_index *idx,
+    struct iolog_file *iolog_files, time_t target_sec)
+{
+    const struct iolog_index_entry *entry;
+    struct timespec target = { target_sec, 0 };
+    struct timespec elapsed = { 0, 0 };
+    struct timing_closure timing;
+    char buf[RECSIZE], expected[RECSIZE];
+    const char *errstr;
+    unsigned int nskipped = 0;
+
+    entry = iolog_index_find(idx, &target);
+    if (entry != NULL) {
+	if (sudo_timespeccmp(&entry->elapsed, &target, >)) {
+	    sudo_warnx("%s: checkpoint after target %lld", type,
+		(long long)target_sec);
+	    return false;
+	}
+	if (!iolog_index_seek(entry, iolog_files)) {
+	    sudo_warn("%s: unable to seek to checkpoint", type);
+	    return false;
+	}
+	elapsed = entry->elapsed;
+    } else {
+	iolog_rewind(&iolog_files[IOFD_TIMING]);
+	iolog_rewind(&iolog_files[IOFD_STDOUT]);
+    }
+
+    memset(&timing, 0, sizeof(timing));
+    timing.decimal = ".";
+    while (sudo_timespeccmp(&elapsed, &target, <)) {
+	if (iolog_read_timing_record(&iolog_files[IOFD_TIMING], &timing) != 0) {
+	    sudo_warnx("%s: unable to read timing record", type);
+	    return false;
+	}
+	sudo_timespecadd(&elapsed, &timing.delay, &elapsed);
+	if (iolog_seek(&iolog_files[IOFD_STDOUT], (off_t)timing.u.nbytes,
+		SEEK_CUR) == -1) {
+	    sudo_warn("%s: unable to skip record", type);
+	    return false;
+	}
+	nskipped++;
+    }
+
+    /* With an index, only records since the last checkpoint are read. */
+    if (entry == NULL && target_sec > NRECORDS / 2) {
+	sudo_warnx("%s: no checkpoint before %lld", type,
+	    (long long)target_sec);
+	return false;
+    }
+
+    fill_record(expected, (unsigned int)target_sec);
+    if (iolog_read(&iolog_files[IOFD_STDOUT], buf, RECSIZE, &errstr) != RECSIZE ||
+	    memcmp(buf, expected, RECSIZE) != 0) {
+	sudo_warnx("%s: wrong data at %lld after skipping %u records", type,
+	    (long long)target_sec, nskipped);
+	return false;
+    }
+    return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char testdir[] = "index.XXXXXX";
+    const char *rmargs[] = { "rm", "-rf", NULL, NULL };
+    static const time_t targets[] = {
+	0, 1, 700, 255, 1023, 512, 100, 900
+    };
+    int ch, dfd, iofd, status, ntests = 0, errors = 0;
+    struct iolog_file iolog_files[IOFD_MAX];
+    struct iolog_index idx;
+    struct timespec restart;
+    bool verbose = false;
+    unsigned int i, j;
+
+    initprogname(argc > 0 ? argv[0] : "check_iolog_index");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose = true;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (mkdtemp(testdir) == NULL)
+	sudo_fatal("unable to create test dir");
+    rmargs[2] = testdir;
+    if ((dfd = open(testdir, O_RDONLY)) == -1)
+	sudo_fatal("%s", testdir);
+
+    iolog_set_owner(geteuid(), getegid());
+    for (i = 0; i < nitems(compress_types); i++) {
+	const char *type = compress_types[i];
+
+	iolog_set_compress(strcmp(type, "none") != 0);
+	if (!iolog_set_compress_type(iolog_get_compress() ? type : NULL)) {
+	    if (verbose)
+		printf("%s: not supported, skipping\n", type);
+	    continue;
+	}
+	if (verbose)
+	    printf("%s: testing\n", type);
+
+	memset(iolog_files, 0, sizeof(iolog_files));
+	ntests++;
+	if (!write_session(dfd, iolog_files)) {
+	    errors++;
+	    continue;
+	}
+
+	ntests++;
+	for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	    iolog_files[iofd].enabled = true;
+	    (void)iolog_open(&iolog_files[iofd], dfd, iofd, "r");
+	}
+	if (!iolog_index_load(&idx, dfd) || idx.nentries < 3) {
+	    sudo_warnx("%s: unable to load index", type);
+	    errors++;
+	    continue;
+	}
+	if (verbose)
+	    printf("%s: %zu checkpoints\n", type, idx.nentries);
+	for (j = 0; j < nitems(targets); j++) {
+	    ntests++;
+	    if (!check_seek(type, &idx, iolog_files, targets[j]))
+		errors++;
+	}
+	iolog_index_close(&idx, NULL);
+	for (iofd = 0; iofd < IOFD_MAX; iofd++) {
+	    if (iolog_files[iofd].enabled)
+		iolog_close(&iolog_files[iofd], NULL);
+	}
+
+	/* Restarting discards checkpoints after the restart point. */
+	ntests++;
+	restart.tv_sec = NRECORDS / 2;
+	restart.tv_nsec = 0;
+	if (!iolog_index_reopen(&idx, dfd, &restart) ||
+		!iolog_index_close(&idx, NULL) ||
+		!iolog_index_load(&idx, dfd) || idx.nentries == 0 ||
+		sudo_timespeccmp(&idx.entries[idx.nentries - 1].elapsed,
+		&restart, >)) {
+	    sudo_warnx("%s: unable to truncate index", type);
+	    errors++;
+	}
+	iolog_index_close(&idx, NULL);
+    }
+    close(dfd);
+
+    if (ntests != 0) {
+	printf("iolog_index: %d test%s run, %d errors, %d%% success rate\n",
+	    ntests, ntests == 1 ? "" : "s", errors,
+	    (ntests - errors) * 100 / ntests);
+    }
+
+    /* Clean up (avoid running via shell) */
+    switch (fork()) {
+    case -1:
+	sudo_warn("fork");
+	_exit(1);
+    case 0:
+	execvp("rm", (char **)rmargs);
+	_exit(1);
+    default:
+	wait(&status);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	    errors++;
+	break;
+    }
+
+    return errors;
+}
@@ -0,0 +1,227 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/wait.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudo_compat.h>
+#include <sudo_fatal.h>
+#include <sudo_iolog.h>
+#include <sudo_util.h>
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+/*
+ * Several processes allocate session IDs from the same directory at
+ * the same time.  The parent reserves a block before forking to make
+ * sure children never hand out IDs from their parent's block.
+ */
+#define NPROCS	8
+#define NIDS	250
+
+static const unsigned int block_sizes[] = { 1, 7, 64 };
+
+/*
+ * Allocate NIDS session IDs and write them to the output file, one per line.
+ */
+static bool
+allocate_ids(const char *iolog_dir, const char *outfile)
+{
+    char sessid[7];
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(outfile, "w")) == NULL) {
+	sudo_warn("%s", outfile);
+	return false;
+    }
+    for (i = 0; i < NIDS; i++) {
+	if (!iolog_nextid(iolog_dir, sessid)) {
+	    sudo_warnx("unable to allocate session ID");
+	    fclose(fp);
+	    return false;
+	}
+	fprintf(fp, "%s\n", sessid);
+    }
+    return fclose(fp) == 0;
+}
+
+/*
+ * Read the IDs allocated by one process, check that they are
+ * increasing and record them in the seen array.
+ */
+static int
+check_ids(const char *outfile, unsigned char *seen, unsigned long maxid)
+{
+    unsigned long id, prev = 0;
+    char line[64], *ep;
+    int nids = 0, errors = 0;
+    FILE *fp;
+
+    if ((fp = fopen(outfile, "r")) == NULL) {
+	sudo_warn("%s", outfile);
+	return 1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	line[strcspn(line, "\n")] = '\0';
+	id = strtoul(line, &ep, 36);
+	if (ep == line || *ep != '\0' || strlen(line) != 6 || id > maxid) {
+	    sudo_warnx("%s: invalid session ID %s", outfile, line);
+	    errors++;
+	    continue;
+	}
+	if (id <= prev) {
+	    sudo_warnx("%s: session ID %s not increasing", outfile, line);
+	    errors++;
+	}
+	if (seen[id]) {
+	    sudo_warnx("%s: duplicate session ID %s", outfile, line);
+	    errors++;
+	}
+	seen[id] = 1;
+	prev = id;
+	nids++;
+    }
+    fclose(fp);
+    if (nids != NIDS) {
+	sudo_warnx("%s: expected %d session IDs, got %d", outfile, NIDS, nids);
+	errors++;
+    }
+    return errors;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char testdir[] = "nextid.XXXXXX";
+    const char *rmargs[] = { "rm", "-rf", NULL, NULL };
+    char iolog_dir[PATH_MAX], outfile[PATH_MAX], sessid[7];
+    int ch, status, ntests = 0, errors = 0;
+    bool verbose = false;
+    unsigned char *seen;
+    unsigned long maxid;
+    unsigned int i;
+    pid_t pids[NPROCS];
+    int n;
+
+    initprogname(argc > 0 ? argv[0] : "check_iolog_nextid");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose = true;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (mkdtemp(testdir) == NULL)
+	sudo_fatal("unable to create test dir");
+    rmargs[2] = testdir;
+
+    iolog_set_owner(geteuid(), getegid());
+    for (i = 0; i < nitems(block_sizes); i++) {
+	ntests++;
+	iolog_set_seqblock(block_sizes[i]);
+	(void)snprintf(iolog_dir, sizeof(iolog_dir), "%s/block%u", testdir,
+	    block_sizes[i]);
+
+	/* Reserve a block in the parent that children must not use. */
+	if (!iolog_nextid(iolog_dir, sessid)) {
+	    sudo_warnx("unable to allocate session ID");
+	    errors++;
+	    continue;
+	}
+
+	for (n = 0; n < NPROCS; n++) {
+	    (void)snprintf(outfile, sizeof(outfile), "%s/ids.%d", iolog_dir, n);
+	    switch (pids[n] = fork()) {
+	    case -1:
+		sudo_fatal("fork");
+	    case 0:
+		_exit(allocate_ids(iolog_dir, outfile) ? 0 : 1);
+	    default:
+		break;
+	    }
+	}
+	/* The parent allocates from its block at the same time. */
+	(void)snprintf(outfile, sizeof(outfile), "%s/ids.%d", iolog_dir, n);
+	if (!allocate_ids(iolog_dir, outfile))
+	    errors++;
+	for (n = 0; n < NPROCS; n++) {
+	    if (waitpid(pids[n], &status, 0) == -1 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status) != 0) {
+		sudo_warnx("child %d failed", n);
+		errors++;
+	    }
+	}
+
+	/* No ID may be used twice, including the one reserved above. */
+	maxid = (unsigned long)(NPROCS + 2) * NIDS * block_sizes[i];
+	if ((seen = calloc(maxid + 1, 1)) == NULL)
+	    sudo_fatalx("unable to allocate memory");
+	seen[strtoul(sessid, NULL, 36)] = 1;
+	for (n = 0; n <= NPROCS; n++) {
+	    (void)snprintf(outfile, sizeof(outfile), "%s/ids.%d", iolog_dir, n);
+	    ntests++;
+	    if (check_ids(outfile, seen, maxid) != 0)
+		errors++;
+	}
+	free(seen);
+	if (verbose) {
+	    printf("block size %u: %d processes allocated %d IDs each\n",
+		block_sizes[i], NPROCS + 1, NIDS);
+	}
+    }
+    iolog_set_seqblock(1);
+
+    if (ntests != 0) {
+	printf("iolog_nextid: %d test%s run, %d errors, %d%% success rate\n",
+	    ntests, ntests == 1 ? "" : "s", errors,
+	    (ntests - errors) * 100 / ntests);
+    }
+
+    /* Clean up (avoid running via shell) */
+    switch (fork()) {
+    case -1:
+	sudo_warn("fork");
+	_exit(1);
+    case 0:
+	execvp("rm", (char **)rmargs);
+	_exit(1);
+    default:
+	wait(&status);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	    errors++;
+	break;
+    }
+
+    return errors;
+}
@@ -0,0 +1,184 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Unpacking a ClientMessage with the default protobuf-c allocator
+ * results in a separate malloc(3) for the message, each sub-message,
+ * string and byte array, all of which are freed again once the message
+ * has been handled.  Instead, we allocate from a per-connection arena
+ * that is reset after each message.  The arena's memory is reused, so
+ * in the common case unpacking a message does not call malloc(3) at all.
+ */
+
+#include <config.h>
+
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <stdlib.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+
+#include <logsrv_arena.h>
+
+/* Alignment of memory returned by the arena. */
+#define ARENA_ALIGN	16
+
+struct logsrv_arena_chunk {
+    struct logsrv_arena_chunk *next;
+    size_t size;
+    size_t used;
+};
+
+/* Memory for allocations starts after the (aligned) chunk header. */
+#define ARENA_ROUNDUP(n) \
+    (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define CHUNK_HDR_SIZE	ARENA_ROUNDUP(sizeof(struct logsrv_arena_chunk))
+#define CHUNK_DATA(c)	((unsigned char *)(c) + CHUNK_HDR_SIZE)
+
+static struct logsrv_arena_chunk *
+arena_chunk_alloc(size_t size)
+{
+    struct logsrv_arena_chunk *chunk;
+
+    if (size > SIZE_MAX - CHUNK_HDR_SIZE)
+	return NULL;
+    if ((chunk = malloc(CHUNK_HDR_SIZE + size)) == NULL)
+	return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+/*
+ * ProtobufCAllocator alloc function.
+ * New chunks are added to the head of the list and are at least
+ * twice the size of the previous one.
+ */
+static void *
+arena_alloc(void *v, size_t size)
+{
+    struct logsrv_arena *arena = v;
+    struct logsrv_arena_chunk *chunk = arena->chunks;
+    void *ret;
+
+    if (size > SIZE_MAX - ARENA_ALIGN)
+	return NULL;
+    size = ARENA_ROUNDUP(size);
+
+    if (chunk == NULL || size > chunk->size - chunk->used) {
+	size_t newsize = LOGSRV_ARENA_SIZE;
+
+	if (chunk != NULL && chunk->size <= SIZE_MAX / 2 &&
+		newsize < chunk->size * 2)
+	    newsize = chunk->size * 2;
+	if (newsize < size)
+	    newsize = size;
+	if ((chunk = arena_chunk_alloc(newsize)) == NULL)
+	    return NULL;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+    }
+    ret = CHUNK_DATA(chunk) + chunk->used;
+    chunk->used += size;
+
+    return ret;
+}
+
+/*
+ * ProtobufCAllocator free function.
+ * Memory is only released when the arena is reset.
+ */
+static void
+arena_free(void *v, void *ptr)
+{
+}
+
+/*
+ * Initialize an arena, no memory is allocated until it is used.
+ */
+void
+logsrv_arena_init(struct logsrv_arena *arena)
+{
+    debug_decl(logsrv_arena_init, SUDO_DEBUG_UTIL);
+
+    arena->allocator.alloc = arena_alloc;
+    arena->allocator.free = arena_free;
+    arena->allocator.allocator_data = arena;
+    arena->chunks = NULL;
+
+    debug_return;
+}
+
+/*
+ * Release all memory allocated from the arena so it can be reused.
+ * If more than one chunk was needed, they are replaced by a single
+ * chunk large enough to hold them all, unless that would be larger
+ * than LOGSRV_ARENA_MAX.
+ */
+void
+logsrv_arena_reset(struct logsrv_arena *arena)
+{
+    struct logsrv_arena_chunk *chunk = arena->chunks;
+    size_t total = 0;
+    debug_decl(logsrv_arena_reset, SUDO_DEBUG_UTIL);
+
+    if (chunk == NULL)
+	debug_return;
+
+    if (chunk->next == NULL && chunk->size <= LOGSRV_ARENA_MAX) {
+	/* Common case, a single chunk. */
+	chunk->used = 0;
+	debug_return;
+    }
+
+    while ((chunk = arena->chunks) != NULL) {
+	arena->chunks = chunk->next;
+	if (total <= LOGSRV_ARENA_MAX)
+	    total += chunk->size;
+	free(chunk);
+    }
+    if (total <= LOGSRV_ARENA_MAX) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: resizing arena to %zu bytes", __func__, total);
+	arena->chunks = arena_chunk_alloc(total);
+    }
+
+    debug_return;
+}
+
+/*
+ * Free all memory associated with the arena.
+ */
+void
+logsrv_arena_free(struct logsrv_arena *arena)
+{
+    struct logsrv_arena_chunk *chunk;
+    debug_decl(logsrv_arena_free, SUDO_DEBUG_UTIL);
+
+    while ((chunk = arena->chunks) != NULL) {
+	arena->chunks = chunk->next;
+	free(chunk);
+    }
+
+    debug_return;
+}
@@ -0,0 +1,261 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudo_compat.h>
+#include <sudo_fatal.h>
+#include <sudo_util.h>
+
+#include <log_server.pb-c.h>
+#include <logsrv_arena.h>
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+struct packed_message {
+    const char *name;
+    uint8_t *data;
+    size_t len;
+};
+
+static uint8_t *
+pack_message(ClientMessage *msg, size_t *lenp)
+{
+    uint8_t *data;
+
+    *lenp = client_message__get_packed_size(msg);
+    if ((data = malloc(*lenp)) == NULL)
+	sudo_fatalx("unable to allocate memory");
+    client_message__pack(msg, data);
+    return data;
+}
+
+static uint8_t *
+pack_iobuf(size_t datalen, size_t *lenp)
+{
+    ClientMessage msg = CLIENT_MESSAGE__INIT;
+    IoBuffer iobuf = IO_BUFFER__INIT;
+    TimeSpec delay = TIME_SPEC__INIT;
+    uint8_t *data, *ret;
+    size_t i;
+
+    if ((data = malloc(datalen)) == NULL)
+	sudo_fatalx("unable to allocate memory");
+    for (i = 0; i < datalen; i++)
+	data[i] = (uint8_t)i;
+    delay.tv_sec = 1;
+    delay.tv_nsec = 500000000;
+    iobuf.delay = &delay;
+    iobuf.data.data = data;
+    iobuf.data.len = datalen;
+    msg.u.stdout_buf = &iobuf;
+    msg.type_case = CLIENT_MESSAGE__TYPE_STDOUT_BUF;
+    ret = pack_message(&msg, lenp);
+    free(data);
+    return ret;
+}
+
+static uint8_t *
+pack_accept(size_t *lenp)
+{
+    ClientMessage msg = CLIENT_MESSAGE__INIT;
+    AcceptMessage accept_msg = ACCEPT_MESSAGE__INIT;
+    TimeSpec submit_time = TIME_SPEC__INIT;
+    InfoMessage info[3] = { INFO_MESSAGE__INIT, INFO_MESSAGE__INIT,
+	INFO_MESSAGE__INIT };
+    InfoMessage *info_msgs[3] = { &info[0], &info[1], &info[2] };
+    InfoMessage__StringList runargv = INFO_MESSAGE__STRING_LIST__INIT;
+    char *strings[] = { "ls", "-l", "/tmp", "/var/tmp" };
+
+    submit_time.tv_sec = 1700000000;
+    info[0].key = "command";
+    info[0].u.strval = "/bin/ls";
+    info[0].value_case = INFO_MESSAGE__VALUE_STRVAL;
+    info[1].key = "lines";
+    info[1].u.numval = 24;
+    info[1].value_case = INFO_MESSAGE__VALUE_NUMVAL;
+    runargv.strings = strings;
+    runargv.n_strings = nitems(strings);
+    info[2].key = "runargv";
+    info[2].u.strlistval = &runargv;
+    info[2].value_case = INFO_MESSAGE__VALUE_STRLISTVAL;
+    accept_msg.submit_time = &submit_time;
+    accept_msg.info_msgs = info_msgs;
+    accept_msg.n_info_msgs = nitems(info_msgs);
+    accept_msg.expect_iobufs = true;
+    msg.u.accept_msg = &accept_msg;
+    msg.type_case = CLIENT_MESSAGE__TYPE_ACCEPT_MSG;
+    return pack_message(&msg, lenp);
+}
+
+static uint8_t *
+pack_winsize(size_t *lenp)
+{
+    ClientMessage msg = CLIENT_MESSAGE__INIT;
+    ChangeWindowSize winsize = CHANGE_WINDOW_SIZE__INIT;
+    TimeSpec delay = TIME_SPEC__INIT;
+
+    delay.tv_nsec = 1000;
+    winsize.delay = &delay;
+    winsize.rows = 24;
+    winsize.cols = 80;
+    msg.u.winsize_event = &winsize;
+    msg.type_case = CLIENT_MESSAGE__TYPE_WINSIZE_EVENT;
+    return pack_message(&msg, lenp);
+}
+
+/*
+ * Unpack a message using the arena, repack it and compare the result
+ * to the original.  Returns the number of errors.
+ */
+static int
+check_roundtrip(struct logsrv_arena *arena, struct packed_message *pm)
+{
+    ClientMessage *msg;
+    uint8_t *repacked = NULL;
+    size_t len;
+    int errors = 0;
+
+    msg = client_message__unpack(&arena->allocator, pm->len, pm->data);
+    if (msg == NULL) {
+	sudo_warnx("%s: unable to unpack %zu byte message", pm->name,
+	    pm->len);
+	errors++;
+	goto done;
+    }
+    if (((uintptr_t)msg & (sizeof(void *) - 1)) != 0) {
+	sudo_warnx("%s: misaligned message %p", pm->name, msg);
+	errors++;
+    }
+    len = client_message__get_packed_size(msg);
+    if (len != pm->len) {
+	sudo_warnx("%s: expected length %zu, got %zu", pm->name, pm->len, len);
+	errors++;
+	goto done;
+    }
+    if ((repacked = malloc(len)) == NULL)
+	sudo_fatalx("unable to allocate memory");
+    client_message__pack(msg, repacked);
+    if (memcmp(repacked, pm->data, len) != 0) {
+	sudo_warnx("%s: repacked message does not match", pm->name);
+	errors++;
+    }
+
+done:
+    logsrv_arena_reset(arena);
+    free(repacked);
+    return errors;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct packed_message messages[] = {
+	{ "accept" }, { "winsize" }, { "iobuf 64" }, { "iobuf 4K" },
+	{ "iobuf 100K" }, { "iobuf 1.5M" }
+    };
+    struct logsrv_arena arena;
+    int ch, round, ntests = 0, errors = 0;
+    bool verbose = false;
+    size_t i;
+
+    initprogname(argc > 0 ? argv[0] : "check_logsrv_arena");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose = true;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    messages[0].data = pack_accept(&messages[0].len);
+    messages[1].data = pack_winsize(&messages[1].len);
+    messages[2].data = pack_iobuf(64, &messages[2].len);
+    messages[3].data = pack_iobuf(4096, &messages[3].len);
+    messages[4].data = pack_iobuf(100 * 1024, &messages[4].len);
+    messages[5].data = pack_iobuf(1536 * 1024, &messages[5].len);
+
+    /* Reuse the same arena for all messages, in both directions. */
+    logsrv_arena_init(&arena);
+    for (round = 0; round < 2; round++) {
+	for (i = 0; i < nitems(messages); i++) {
+	    struct packed_message *pm = round ?
+		&messages[nitems(messages) - 1 - i] : &messages[i];
+
+	    ntests++;
+	    if (check_roundtrip(&arena, pm) != 0)
+		errors++;
+	    else if (verbose)
+		printf("%s: %zu bytes OK\n", pm->name, pm->len);
+	}
+    }
+
+    /* An arena larger than LOGSRV_ARENA_MAX is released on reset. */
+    ntests++;
+    if (check_roundtrip(&arena, &messages[nitems(messages) - 1]) != 0 ||
+	    arena.chunks != NULL) {
+	sudo_warnx("large arena not released on reset");
+	errors++;
+    }
+
+    /* Smaller arenas are kept for reuse. */
+    ntests++;
+    if (check_roundtrip(&arena, &messages[4]) != 0 || arena.chunks == NULL) {
+	sudo_warnx("arena not kept on reset");
+	errors++;
+    }
+
+    /* Truncated input must fail cleanly. */
+    ntests++;
+    if (client_message__unpack(&arena.allocator, messages[0].len - 1,
+	    messages[0].data) != NULL) {
+	sudo_warnx("truncated message unpacked successfully");
+	errors++;
+    }
+    logsrv_arena_reset(&arena);
+    logsrv_arena_free(&arena);
+
+    for (i = 0; i < nitems(messages); i++)
+	free(messages[i].data);
+
+    if (ntests != 0) {
+	printf("%s: %d test%s run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, ntests == 1 ? "" : "s", errors,
+	    (ntests - errors) * 100 / ntests);
+    }
+
+    return errors;
+}
@@ -0,0 +1,474 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Linux epoll(7) backend for the event subsystem.
+ * Unlike poll(2) and select(2), the cost of waiting for events
+ * does not depend on the number of descriptors being watched.
+ */
+
+#include <config.h>
+
+#include <sys/epoll.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sudo_compat.h>
+#include <sudo_util.h>
+#include <sudo_fatal.h>
+#include <sudo_debug.h>
+#include <sudo_event.h>
+
+/*
+ * The kernel only allows a descriptor to be added to an epoll instance
+ * once, but sudo may have separate read and write events for the same
+ * descriptor.  We keep a list of events for each fd, indexed by fd,
+ * and register the union of their interests.  An event's index in
+ * that list is stored in ev->pfd_idx.
+ */
+struct sudo_ev_epoll_fd {
+    struct sudo_event **evs;	/* events for this fd */
+    int nevs;			/* number of entries in evs */
+    int maxevs;			/* size of evs */
+    unsigned int registered;	/* EPOLL* flags registered with the kernel */
+    bool always;		/* fd not supported by epoll, always ready */
+};
+
+/*
+ * Compute the epoll interest flags for the events on fdp.
+ * Edge-triggered notification is only used if all of the events
+ * on the descriptor request it.
+ */
+static unsigned int
+sudo_ev_epoll_flags(const struct sudo_ev_epoll_fd *fdp)
+{
+    unsigned int flags = 0;
+    bool edge = true;
+    int i;
+
+    for (i = 0; i < fdp->nevs; i++) {
+	const struct sudo_event *ev = fdp->evs[i];
+	if (ISSET(ev->events, SUDO_EV_READ))
+	    flags |= EPOLLIN;
+	if (ISSET(ev->events, SUDO_EV_WRITE))
+	    flags |= EPOLLOUT;
+	if (!ISSET(ev->events, SUDO_EV_EDGE))
+	    edge = false;
+    }
+    if (flags != 0 && edge)
+	flags |= EPOLLET;
+    return flags;
+}
+
+/*
+ * Bring the kernel's interest list for fd in sync with its events.
+ * Descriptors that epoll does not support, such as regular files,
+ * are treated as always ready, like poll(2) does.
+ * Returns 0 on success, -1 on error.
+ */
+static int
+sudo_ev_epoll_update(struct sudo_event_base *base, int fd)
+{
+    struct sudo_ev_epoll_fd *fdp = (struct sudo_ev_epoll_fd *)base->ep_fds + fd;
+    struct epoll_event epev;
+    unsigned int flags;
+    int op;
+    debug_decl(sudo_ev_epoll_update, SUDO_DEBUG_EVENT);
+
+    if (fdp->nevs == 0 && fdp->always) {
+	fdp->always = false;
+	base->ep_nalways--;
+    }
+    /* Registration is deferred until the epoll fd is (re)created. */
+    if (fdp->always || base->epfd == -1)
+	debug_return_int(0);
+
+    flags = sudo_ev_epoll_flags(fdp);
+    if (flags == fdp->registered)
+	debug_return_int(0);
+
+    memset(&epev, 0, sizeof(epev));
+    epev.events = flags;
+    epev.data.fd = fd;
+    if (flags == 0) {
+	op = EPOLL_CTL_DEL;
+    } else if (fdp->registered == 0) {
+	op = EPOLL_CTL_ADD;
+    } else {
+	op = EPOLL_CTL_MOD;
+    }
+    if (epoll_ctl(base->epfd, op, fd, &epev) == -1) {
+	switch (errno) {
+	case EEXIST:
+	    /* Left over from a previous descriptor with this number. */
+	    if (epoll_ctl(base->epfd, EPOLL_CTL_MOD, fd, &epev) == 0)
+		break;
+	    goto bad;
+	case ENOENT:
+	    /* The descriptor was closed and reopened since it was added. */
+	    if (op == EPOLL_CTL_DEL ||
+		    epoll_ctl(base->epfd, EPOLL_CTL_ADD, fd, &epev) == 0)
+		break;
+	    goto bad;
+	case EBADF:
+	    /* The descriptor was closed before its events were deleted. */
+	    if (op == EPOLL_CTL_DEL)
+		break;
+	    goto bad;
+	case EPERM:
+	    /* Regular files and some devices cannot be polled by epoll. */
+	    if (op == EPOLL_CTL_ADD) {
+		sudo_debug_printf(SUDO_DEBUG_INFO,
+		    "%s: fd %d not supported by epoll, always ready",
+		    __func__, fd);
+		fdp->always = true;
+		base->ep_nalways++;
+		flags = 0;
+		break;
+	    }
+	    goto bad;
+	default:
+	    goto bad;
+	}
+    }
+    fdp->registered = flags;
+    debug_return_int(0);
+bad:
+    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	"%s: epoll_ctl(%d, %d)", __func__, op, fd);
+    debug_return_int(-1);
+}
+
+/*
+ * Create a new epoll instance and register all existing events with it.
+ * Returns 0 on success, -1 on error.
+ */
+static int
+sudo_ev_epoll_open(struct sudo_event_base *base)
+{
+    struct sudo_ev_epoll_fd *fds = base->ep_fds;
+    int fd;
+    debug_decl(sudo_ev_epoll_open, SUDO_DEBUG_EVENT);
+
+    base->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (base->epfd == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "%s: unable to create epoll fd", __func__);
+	debug_return_int(-1);
+    }
+    base->ep_pid = getpid();
+    for (fd = 0; fd < base->ep_nfds; fd++) {
+	if (fds[fd].nevs != 0 && sudo_ev_epoll_update(base, fd) != 0)
+	    debug_return_int(-1);
+    }
+
+    debug_return_int(0);
+}
+
+/*
+ * An epoll instance is shared with child processes across fork(2),
+ * so changes made by the child would affect the parent.  If we are
+ * no longer the process that created it, close our reference and
+ * create a new one the next time we wait for events.
+ */
+static void
+sudo_ev_epoll_check_fork(struct sudo_event_base *base)
+{
+    struct sudo_ev_epoll_fd *fds = base->ep_fds;
+    int fd;
+    debug_decl(sudo_ev_epoll_check_fork, SUDO_DEBUG_EVENT);
+
+    if (base->epfd == -1 || base->ep_pid == getpid())
+	debug_return;
+
+    sudo_debug_printf(SUDO_DEBUG_INFO,
+	"%s: epoll fd %d inherited from parent, will recreate", __func__,
+	base->epfd);
+    close(base->epfd);
+    base->epfd = -1;
+    for (fd = 0; fd < base->ep_nfds; fd++)
+	fds[fd].registered = 0;
+
+    debug_return;
+}
+
+int
+sudo_ev_base_alloc_impl(struct sudo_event_base *base)
+{
+    debug_decl(sudo_ev_base_alloc_impl, SUDO_DEBUG_EVENT);
+
+    base->epfd = -1;
+    base->ep_fds = NULL;
+    base->ep_nfds = 0;
+    base->ep_nalways = 0;
+    base->ep_maxevents = 32;
+    base->ep_events = reallocarray(NULL, (size_t)base->ep_maxevents,
+	sizeof(struct epoll_event));
+    if (base->ep_events == NULL) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "%s: unable to allocate %d epoll events", __func__,
+	    base->ep_maxevents);
+	base->ep_maxevents = 0;
+	debug_return_int(-1);
+    }
+    if (sudo_ev_epoll_open(base) != 0) {
+	free(base->ep_events);
+	base->ep_events = NULL;
+	base->ep_maxevents = 0;
+	debug_return_int(-1);
+    }
+
+    debug_return_int(0);
+}
+
+void
+sudo_ev_base_free_impl(struct sudo_event_base *base)
+{
+    struct sudo_ev_epoll_fd *fds = base->ep_fds;
+    int fd;
+    debug_decl(sudo_ev_base_free_impl, SUDO_DEBUG_EVENT);
+
+    if (base->epfd != -1)
+	close(base->epfd);
+    for (fd = 0; fd < base->ep_nfds; fd++)
+	free(fds[fd].evs);
+    free(base->ep_fds);
+    free(base->ep_events);
+
+    debug_return;
+}
+
+int
+sudo_ev_add_impl(struct sudo_event_base *base, struct sudo_event *ev)
+{
+    struct sudo_ev_epoll_fd *fdp;
+    debug_decl(sudo_ev_add_impl, SUDO_DEBUG_EVENT);
+
+    if (ev->fd < 0) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "%s: invalid fd %d", __func__, ev->fd);
+	debug_return_int(-1);
+    }
+    sudo_ev_epoll_check_fork(base);
+
+    /* Grow the fd table as needed. */
+    if (ev->fd >= base->ep_nfds) {
+	struct sudo_ev_epoll_fd *fds;
+	int new_nfds = base->ep_nfds ? base->ep_nfds : 32;
+
+	while (new_nfds <= ev->fd) {
+	    if (new_nfds > INT_MAX / 2) {
+		new_nfds = ev->fd + 1;
+		break;
+	    }
+	    new_nfds *= 2;
+	}
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: ep_nfds %d -> %d", __func__, base->ep_nfds, new_nfds);
+	fds = reallocarray(base->ep_fds, (size_t)new_nfds, sizeof(*fds));
+	if (fds == NULL) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		"%s: unable to allocate %d fd entries", __func__, new_nfds);
+	    debug_return_int(-1);
+	}
+	memset(fds + base->ep_nfds, 0,
+	    (size_t)(new_nfds - base->ep_nfds) * sizeof(*fds));
+	base->ep_fds = fds;
+	base->ep_nfds = new_nfds;
+    }
+    fdp = (struct sudo_ev_epoll_fd *)base->ep_fds + ev->fd;
+
+    /* Add the event to the fd's list. */
+    if (fdp->nevs == fdp->maxevs) {
+	struct sudo_event **evs;
+	int new_max = fdp->maxevs ? fdp->maxevs * 2 : 2;
+
+	if (new_max > SHRT_MAX) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		"%s: too many events for fd %d", __func__, ev->fd);
+	    debug_return_int(-1);
+	}
+	evs = reallocarray(fdp->evs, (size_t)new_max, sizeof(*evs));
+	if (evs == NULL) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		"%s: unable to allocate %d events for fd %d", __func__,
+		new_max, ev->fd);
+	    debug_return_int(-1);
+	}
+	fdp->evs = evs;
+	fdp->maxevs = new_max;
+    }
+    ev->pfd_idx = (short)fdp->nevs;
+    fdp->evs[fdp->nevs++] = ev;
+
+    if (sudo_ev_epoll_update(base, ev->fd) != 0) {
+	fdp->evs[--fdp->nevs] = NULL;
+	ev->pfd_idx = -1;
+	debug_return_int(-1);
+    }
+
+    debug_return_int(0);
+}
+
+int
+sudo_ev_del_impl(struct sudo_event_base *base, struct sudo_event *ev)
+{
+    struct sudo_ev_epoll_fd *fdp;
+    int idx = ev->pfd_idx;
+    debug_decl(sudo_ev_del_impl, SUDO_DEBUG_EVENT);
+
+    if (ev->fd < 0 || ev->fd >= base->ep_nfds || idx < 0)
+	debug_return_int(0);
+    sudo_ev_epoll_check_fork(base);
+    fdp = (struct sudo_ev_epoll_fd *)base->ep_fds + ev->fd;
+    if (idx >= fdp->nevs || fdp->evs[idx] != ev)
+	debug_return_int(0);
+
+    /* Move the last event into the free slot. */
+    fdp->evs[idx] = fdp->evs[--fdp->nevs];
+    fdp->evs[idx]->pfd_idx = (short)idx;
+    fdp->evs[fdp->nevs] = NULL;
+    ev->pfd_idx = -1;
+
+    debug_return_int(sudo_ev_epoll_update(base, ev->fd));
+}
+
+/*
+ * Activate the events for fd that match the ready flags.
+ * Returns the number of events activated.
+ */
+static int
+sudo_ev_epoll_activate(struct sudo_event_base *base, int fd,
+    unsigned int ready)
+{
+    struct sudo_ev_epoll_fd *fdp;
+    int i, nactive = 0;
+    debug_decl(sudo_ev_epoll_activate, SUDO_DEBUG_EVENT);
+
+    if (fd < 0 || fd >= base->ep_nfds)
+	debug_return_int(0);
+    fdp = (struct sudo_ev_epoll_fd *)base->ep_fds + fd;
+    for (i = 0; i < fdp->nevs; i++) {
+	struct sudo_event *ev = fdp->evs[i];
+	int what = 0;
+
+	if (ready & (EPOLLIN|EPOLLHUP|EPOLLERR))
+	    what |= (ev->events & SUDO_EV_READ);
+	if (ready & (EPOLLOUT|EPOLLHUP|EPOLLERR))
+	    what |= (ev->events & SUDO_EV_WRITE);
+	if (what == 0 || ISSET(ev->flags, SUDO_EVQ_ACTIVE))
+	    continue;
+	/* Make event active. */
+	sudo_debug_printf(SUDO_DEBUG_DEBUG,
+	    "%s: polled fd %d, events %d, activating %p",
+	    __func__, ev->fd, what, ev);
+	ev->revents = (short)what;
+	sudo_ev_activate(base, ev);
+	nactive++;
+    }
+    debug_return_int(nactive);
+}
+
+int
+sudo_ev_scan_impl(struct sudo_event_base *base, unsigned int flags)
+{
+    struct epoll_event *events;
+    struct timespec now, ts;
+    struct sudo_event *ev;
+    int i, nready, timeout;
+    debug_decl(sudo_ev_scan_impl, SUDO_DEBUG_EVENT);
+
+    sudo_ev_epoll_check_fork(base);
+    if (base->epfd == -1) {
+	if (sudo_ev_epoll_open(base) != 0)
+	    debug_return_int(-1);
+    }
+
+    if (base->ep_nalways != 0) {
+	/* Some events are always ready, don't block. */
+	timeout = 0;
+    } else if ((ev = TAILQ_FIRST(&base->timeouts)) != NULL) {
+	sudo_gettime_mono(&now);
+	sudo_timespecsub(&ev->timeout, &now, &ts);
+	if (ts.tv_sec < 0) {
+	    timeout = 0;
+	} else if (ts.tv_sec >= INT_MAX / 1000) {
+	    timeout = INT_MAX;
+	} else {
+	    /* Round up so we don't wake up before the timeout expires. */
+	    timeout = (int)(ts.tv_sec * 1000) +
+		(int)((ts.tv_nsec + 999999) / 1000000);
+	}
+    } else {
+	timeout = ISSET(flags, SUDO_EVLOOP_NONBLOCK) ? 0 : -1;
+    }
+
+    nready = epoll_wait(base->epfd, base->ep_events, base->ep_maxevents,
+	timeout);
+    if (nready == -1) {
+	/* Error: EINTR (signal) */
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "epoll_wait");
+	debug_return_int(-1);
+    }
+
+    /* Activate each I/O event that fired. */
+    events = base->ep_events;
+    for (i = 0; i < nready; i++)
+	sudo_ev_epoll_activate(base, events[i].data.fd, events[i].events);
+
+    /* If the events array was filled, grow it for next time. */
+    if (nready == base->ep_maxevents && base->ep_maxevents < INT_MAX / 2) {
+	events = reallocarray(base->ep_events,
+	    (size_t)base->ep_maxevents * 2, sizeof(struct epoll_event));
+	if (events != NULL) {
+	    base->ep_events = events;
+	    base->ep_maxevents *= 2;
+	}
+    }
+
+    /* Descriptors epoll cannot watch are always ready. */
+    if (base->ep_nalways != 0) {
+	TAILQ_FOREACH(ev, &base->events, entries) {
+	    const struct sudo_ev_epoll_fd *fdp;
+
+	    if (ev->pfd_idx == -1 || ev->fd >= base->ep_nfds)
+		continue;
+	    fdp = (struct sudo_ev_epoll_fd *)base->ep_fds + ev->fd;
+	    if (fdp->always && !ISSET(ev->flags, SUDO_EVQ_ACTIVE)) {
+		ev->revents = ev->events & (SUDO_EV_READ|SUDO_EV_WRITE);
+		sudo_ev_activate(base, ev);
+		nready++;
+	    }
+	}
+    }
+
+    if (nready == 0) {
+	/* Front end will activate timeout events. */
+	sudo_debug_printf(SUDO_DEBUG_INFO, "%s: timeout", __func__);
+    } else {
+	sudo_debug_printf(SUDO_DEBUG_INFO, "%s: %d fds ready", __func__,
+	    nready);
+    }
+    debug_return_int(nready);
+}
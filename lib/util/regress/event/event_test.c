@@ -0,0 +1,406 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudo_compat.h>
+#include <sudo_fatal.h>
+#include <sudo_util.h>
+#include <sudo_event.h>
+
+/*
+ * Exercise the event loop backend with thousands of sockets.
+ * Each round makes a single socket readable and checks that only
+ * its event fires.  The time per wakeup is measured with a small
+ * and a large number of registered descriptors to show how the
+ * loop overhead grows with the number of descriptors.
+ * Also checks read and write events on the same descriptor,
+ * descriptors that are always ready and events shared across fork().
+ *
+ * This file is also built as event_poll_test, linked with the poll
+ * backend, on systems where epoll is the default.
+ */
+
+#define NPAIRS_MAX	2048
+#define NPAIRS_SMALL	8
+#define NROUNDS		2000
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+struct sock_pair {
+    int fds[2];
+    int nfired;
+    struct sudo_event *ev;
+};
+
+static struct sock_pair *pairs;
+static int total_fired;
+static int ntests, errors;
+static int verbose;
+
+static void
+check(bool ok, const char *what)
+{
+    ntests++;
+    if (!ok) {
+	errors++;
+	sudo_warnx("%s: FAILED", what);
+    } else if (verbose) {
+	sudo_warnx("%s: OK", what);
+    }
+}
+
+static void
+read_cb(int fd, int what, void *closure)
+{
+    struct sock_pair *pair = closure;
+    char ch;
+
+    if (read(fd, &ch, 1) == 1) {
+	pair->nfired++;
+	total_fired++;
+    }
+}
+
+static void
+count_cb(int fd, int what, void *closure)
+{
+    int *nfired = closure;
+
+    (*nfired)++;
+}
+
+/*
+ * Raise the descriptor limit if possible and return the number of
+ * socket pairs we can use.
+ */
+static int
+max_pairs(void)
+{
+    struct rlimit rl;
+    int npairs = NPAIRS_MAX;
+
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+	const rlim_t want = NPAIRS_MAX * 2 + 64;
+	if (rl.rlim_cur < want) {
+	    rl.rlim_cur = rl.rlim_max < want ? rl.rlim_max : want;
+	    (void)setrlimit(RLIMIT_NOFILE, &rl);
+	    (void)getrlimit(RLIMIT_NOFILE, &rl);
+	}
+	if (rl.rlim_cur < want)
+	    npairs = ((int)rl.rlim_cur - 64) / 2;
+    }
+    return npairs;
+}
+
+/*
+ * Make a random socket readable NROUNDS times, with npairs events
+ * registered, and check that only its event fires.
+ * Returns the average time per wakeup in nanoseconds.
+ */
+static long long
+run_rounds(struct sudo_event_base *base, int npairs, int *nbad)
+{
+    struct timespec start, end, elapsed;
+    int i, idx;
+
+    sudo_gettime_mono(&start);
+    for (i = 0; i < NROUNDS; i++) {
+	idx = (int)(((unsigned int)i * 7919U) % (unsigned int)npairs);
+	pairs[idx].nfired = 0;
+	if (write(pairs[idx].fds[1], "x", 1) != 1)
+	    sudo_fatal("write");
+	sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+	if (pairs[idx].nfired != 1)
+	    (*nbad)++;
+    }
+    sudo_gettime_mono(&end);
+    sudo_timespecsub(&end, &start, &elapsed);
+
+    return (elapsed.tv_sec * 1000000000LL + elapsed.tv_nsec) / NROUNDS;
+}
+
+static void
+stress_test(int npairs)
+{
+    struct sudo_event_base *base;
+    long long small_ns, large_ns;
+    int i, prev_fired, nbad = 0;
+    char what[256];
+
+    if ((base = sudo_ev_base_alloc()) == NULL)
+	sudo_fatalx("unable to allocate event base");
+
+    /* Time wakeups with only a few events registered. */
+    for (i = 0; i < NPAIRS_SMALL; i++) {
+	pairs[i].ev = sudo_ev_alloc(pairs[i].fds[0],
+	    SUDO_EV_READ|SUDO_EV_PERSIST, read_cb, &pairs[i]);
+	if (pairs[i].ev == NULL || sudo_ev_add(base, pairs[i].ev, NULL, false) != 0)
+	    sudo_fatalx("unable to add event %d", i);
+    }
+    small_ns = run_rounds(base, NPAIRS_SMALL, &nbad);
+
+    /* Time wakeups with all of them registered. */
+    for (i = NPAIRS_SMALL; i < npairs; i++) {
+	pairs[i].ev = sudo_ev_alloc(pairs[i].fds[0],
+	    SUDO_EV_READ|SUDO_EV_PERSIST, read_cb, &pairs[i]);
+	if (pairs[i].ev == NULL || sudo_ev_add(base, pairs[i].ev, NULL, false) != 0)
+	    sudo_fatalx("unable to add event %d", i);
+    }
+    large_ns = run_rounds(base, npairs, &nbad);
+
+    (void)snprintf(what, sizeof(what), "%d wakeups with %d sockets",
+	NROUNDS * 2, npairs);
+    check(nbad == 0, what);
+    if (verbose) {
+	printf("%s: %d sockets: %lld.%03lld usec per wakeup\n", getprogname(),
+	    NPAIRS_SMALL, small_ns / 1000, small_ns % 1000);
+	printf("%s: %d sockets: %lld.%03lld usec per wakeup\n", getprogname(),
+	    npairs, large_ns / 1000, large_ns % 1000);
+    }
+
+    /* Remove every other event and make sure the rest still work. */
+    for (i = 0; i < npairs; i += 2) {
+	sudo_ev_free(pairs[i].ev);
+	pairs[i].ev = NULL;
+    }
+    nbad = 0;
+    for (i = 1; i < npairs; i += 2) {
+	pairs[i].nfired = 0;
+	if (write(pairs[i].fds[1], "x", 1) != 1)
+	    sudo_fatal("write");
+    }
+    if (write(pairs[0].fds[1], "x", 1) != 1)
+	sudo_fatal("write");
+    pairs[0].nfired = 0;
+    /* The backend may not return all ready events at once. */
+    do {
+	prev_fired = total_fired;
+	sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    } while (total_fired != prev_fired);
+    for (i = 1; i < npairs; i += 2) {
+	if (pairs[i].nfired != 1)
+	    nbad++;
+    }
+    check(nbad == 0 && pairs[0].nfired == 0, "deleted events");
+
+    /* Drain the socket whose event was deleted. */
+    (void)read(pairs[0].fds[0], what, sizeof(what));
+    for (i = 1; i < npairs; i += 2) {
+	sudo_ev_free(pairs[i].ev);
+	pairs[i].ev = NULL;
+    }
+    sudo_ev_base_free(base);
+}
+
+static void
+shared_fd_test(void)
+{
+    struct sudo_event_base *base;
+    struct sudo_event *rev, *wev;
+    int nread = 0, nwritten = 0;
+    char ch;
+
+    if ((base = sudo_ev_base_alloc()) == NULL)
+	sudo_fatalx("unable to allocate event base");
+    rev = sudo_ev_alloc(pairs[0].fds[0], SUDO_EV_READ|SUDO_EV_PERSIST,
+	count_cb, &nread);
+    wev = sudo_ev_alloc(pairs[0].fds[0], SUDO_EV_WRITE|SUDO_EV_PERSIST,
+	count_cb, &nwritten);
+    if (rev == NULL || wev == NULL)
+	sudo_fatalx("unable to allocate events");
+    check(sudo_ev_add(base, rev, NULL, false) == 0 &&
+	sudo_ev_add(base, wev, NULL, false) == 0, "add read and write events");
+
+    /* The socket is writable but not readable. */
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nread == 0 && nwritten == 1, "write event on shared fd");
+
+    /* Now it is both. */
+    if (write(pairs[0].fds[1], "x", 1) != 1)
+	sudo_fatal("write");
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nread == 1 && nwritten == 2, "read and write events on shared fd");
+
+    /* Removing the write event must leave the read event. */
+    sudo_ev_del(base, wev);
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nread == 2 && nwritten == 2, "read event after write event deleted");
+    (void)read(pairs[0].fds[0], &ch, 1);
+
+    /* One-shot event fires once. */
+    sudo_ev_free(rev);
+    nread = 0;
+    rev = sudo_ev_alloc(pairs[0].fds[0], SUDO_EV_READ, count_cb, &nread);
+    if (rev == NULL)
+	sudo_fatalx("unable to allocate event");
+    if (write(pairs[0].fds[1], "x", 1) != 1)
+	sudo_fatal("write");
+    sudo_ev_add(base, rev, NULL, false);
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    sudo_ev_add(base, wev, NULL, false);
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nread == 1, "one-shot event");
+    (void)read(pairs[0].fds[0], &ch, 1);
+
+    /* Edge-triggered event fires when data arrives. */
+    sudo_ev_free(wev);
+    sudo_ev_free(rev);
+    nread = 0;
+    rev = sudo_ev_alloc(pairs[0].fds[0],
+	SUDO_EV_READ|SUDO_EV_PERSIST|SUDO_EV_EDGE, count_cb, &nread);
+    if (rev == NULL)
+	sudo_fatalx("unable to allocate event");
+    sudo_ev_add(base, rev, NULL, false);
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nread == 0, "edge-triggered event, no data");
+    if (write(pairs[0].fds[1], "x", 1) != 1)
+	sudo_fatal("write");
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nread == 1, "edge-triggered event");
+    (void)read(pairs[0].fds[0], &ch, 1);
+
+    sudo_ev_free(rev);
+    sudo_ev_base_free(base);
+}
+
+static void
+always_ready_test(void)
+{
+    struct sudo_event_base *base;
+    struct sudo_event *ev;
+    int fd, nfired = 0;
+
+    /* Descriptors like /dev/null are always ready, even for epoll. */
+    if ((fd = open("/dev/null", O_RDONLY)) == -1)
+	sudo_fatal("/dev/null");
+    if ((base = sudo_ev_base_alloc()) == NULL)
+	sudo_fatalx("unable to allocate event base");
+    ev = sudo_ev_alloc(fd, SUDO_EV_READ|SUDO_EV_PERSIST, count_cb, &nfired);
+    if (ev == NULL)
+	sudo_fatalx("unable to allocate event");
+    check(sudo_ev_add(base, ev, NULL, false) == 0, "add /dev/null event");
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nfired == 2, "/dev/null always ready");
+    sudo_ev_free(ev);
+    sudo_ev_base_free(base);
+    close(fd);
+}
+
+static void
+fork_test(void)
+{
+    struct sudo_event_base *base;
+    struct sudo_event *ev;
+    int status, nfired = 0;
+    char ch;
+    pid_t pid;
+
+    if ((base = sudo_ev_base_alloc()) == NULL)
+	sudo_fatalx("unable to allocate event base");
+    ev = sudo_ev_alloc(pairs[1].fds[0], SUDO_EV_READ|SUDO_EV_PERSIST,
+	count_cb, &nfired);
+    if (ev == NULL || sudo_ev_add(base, ev, NULL, false) != 0)
+	sudo_fatalx("unable to add event");
+
+    /* Changes made by the child must not affect the parent. */
+    switch (pid = fork()) {
+    case -1:
+	sudo_fatal("fork");
+    case 0:
+	sudo_ev_free(ev);
+	sudo_ev_base_free(base);
+	_exit(0);
+    default:
+	while (waitpid(pid, &status, 0) == -1)
+	    continue;
+	break;
+    }
+    if (write(pairs[1].fds[1], "x", 1) != 1)
+	sudo_fatal("write");
+    sudo_ev_loop(base, SUDO_EVLOOP_ONCE|SUDO_EVLOOP_NONBLOCK);
+    check(nfired == 1, "event after child deleted it");
+    (void)read(pairs[1].fds[0], &ch, 1);
+
+    sudo_ev_free(ev);
+    sudo_ev_base_free(base);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ch, i, npairs;
+
+    initprogname(argc > 0 ? argv[0] : "event_test");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose++;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+
+    npairs = max_pairs();
+    if (npairs < NPAIRS_SMALL * 2)
+	sudo_fatalx("too few file descriptors available");
+    if ((pairs = calloc((size_t)npairs, sizeof(*pairs))) == NULL)
+	sudo_fatalx("unable to allocate memory");
+    for (i = 0; i < npairs; i++) {
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[i].fds) == -1) {
+	    /* Use what we have. */
+	    if (i < NPAIRS_SMALL * 2)
+		sudo_fatal("socketpair");
+	    npairs = i;
+	    break;
+	}
+    }
+
+    stress_test(npairs);
+    shared_fd_test();
+    always_ready_test();
+    fork_test();
+
+    for (i = 0; i < npairs; i++) {
+	close(pairs[i].fds[0]);
+	close(pairs[i].fds[1]);
+    }
+    free(pairs);
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+    return errors;
+}
@@ -98,6 +98,8 @@ sudo_conf_dump(void)
     printf("Set max_groups %d\n", sudo_conf_max_groups());
     printf("Set probe_interfaces %s\n",
 	sudo_conf_probe_interfaces() ? "true" : "false");
+    printf("Set splice_io %s\n",
+	sudo_conf_splice_io() ? "true" : "false");
     if (sudo_conf_askpass_path() != NULL)
 	printf("Path askpass %s\n", sudo_conf_askpass_path());
     if (sudo_conf_sesh_path() != NULL)
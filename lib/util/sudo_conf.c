@@ -74,6 +74,7 @@ struct sudo_conf_settings {
     bool updated;
     bool disable_coredump;
     bool probe_interfaces;
+    bool splice_io;
     int group_source;
     int max_groups;
 };
@@ -95,12 +96,14 @@ static int set_var_disable_coredump(const char *entry, const char *conf_file, un
 static int set_var_group_source(const char *entry, const char *conf_file, unsigned int);
 static int set_var_max_groups(const char *entry, const char *conf_file, unsigned int);
 static int set_var_probe_interfaces(const char *entry, const char *conf_file, unsigned int);
+static int set_var_splice_io(const char *entry, const char *conf_file, unsigned int);
 
 static struct sudo_conf_table sudo_conf_var_table[] = {
     { "disable_coredump", sizeof("disable_coredump") - 1, set_var_disable_coredump },
     { "group_source", sizeof("group_source") - 1, set_var_group_source },
     { "max_groups", sizeof("max_groups") - 1, set_var_max_groups },
     { "probe_interfaces", sizeof("probe_interfaces") - 1, set_var_probe_interfaces },
+    { "splice_io", sizeof("splice_io") - 1, set_var_splice_io },
     { NULL }
 };
 
@@ -137,6 +140,7 @@ static struct sudo_conf_table sudo_conf_var_table[] = {
     false,			/* updated */				\
     true,			/* disable_coredump */			\
     true,			/* probe_interfaces */			\
+    false,			/* splice_io */				\
     GROUP_SOURCE_DEFAULT,	/* group_source */			\
     -1				/* max_groups */			\
 }
@@ -456,6 +460,22 @@ set_var_probe_interfaces(const char *strval, const char *conf_file,
     debug_return_int(true);
 }
 
+static int
+set_var_splice_io(const char *strval, const char *conf_file,
+    unsigned int lineno)
+{
+    int val = sudo_strtobool(strval);
+    debug_decl(set_var_splice_io, SUDO_DEBUG_UTIL);
+
+    if (val == -1) {
+	sudo_warnx(U_("invalid value for %s \"%s\" in %s, line %u"),
+	    "splice_io", strval, conf_file, lineno);
+	debug_return_int(false);
+    }
+    sudo_conf_data.settings.splice_io = val;
+    debug_return_int(true);
+}
+
 const char *
 sudo_conf_askpass_path_v1(void)
 {
@@ -585,6 +605,12 @@ sudo_conf_probe_interfaces_v1(void)
     return sudo_conf_data.settings.probe_interfaces;
 }
 
+bool
+sudo_conf_splice_io_v1(void)
+{
+    return sudo_conf_data.settings.splice_io;
+}
+
 /*
  * Free dynamically allocated parts of sudo_conf_data and
  * reset to initial values.
@@ -673,6 +673,8 @@ iolog_close_all(struct connection_closure *closure)
 	    sudo_warnx(U_("error closing iofd %u: %s"), i, errstr);
 	}
     }
+    if (!iolog_index_close(&closure->iolog_index, &errstr))
+	sudo_warnx(U_("error closing index: %s"), errstr);
     if (closure->iolog_dir_fd != -1)
 	close(closure->iolog_dir_fd);
 
@@ -758,6 +760,15 @@ iolog_init(const AcceptMessage *msg, struct connection_closure *closure)
     if (!iolog_write_info_file(closure->iolog_dir_fd, evlog))
 	debug_return_bool(false);
 
+    /* Add the session to the catalog used by "sudoreplay -l". */
+    if (logsrvd_conf_iolog_catalog()) {
+	if (!iolog_catalog_add(evlog)) {
+	    sudo_warnx(U_("unable to write to %.*s/%s"),
+		(int)(evlog->iolog_file - evlog->iolog_path - 1),
+		evlog->iolog_path, "catalog");
+	}
+    }
+
     /*
      * Create timing, stdout, stderr and ttyout files for sudoreplay.
      * Others will be created on demand.
@@ -768,6 +779,14 @@ iolog_init(const AcceptMessage *msg, struct connection_closure *closure)
 	!iolog_create(IOFD_TTYOUT, closure))
 	debug_return_bool(false);
 
+    /* Create the time index, if enabled. */
+    if (iolog_get_index()) {
+	if (!iolog_index_create(&closure->iolog_index, closure->iolog_dir_fd)) {
+	    sudo_warn(U_("unable to open %s/%s"), evlog->iolog_path, "index");
+	    debug_return_bool(false);
+	}
+    }
+
     /* Ready to log I/O buffers. */
     debug_return_bool(true);
 }
@@ -997,3 +1016,64 @@ update_elapsed_time(const TimeSpec *delta, struct timespec *elapsed)
 
     debug_return;
 }
+
+/*
+ * Update the I/O log index after a timing record with the given
+ * delay has been written.  The len is the number of bytes written.
+ */
+bool
+iolog_update_index(const TimeSpec *delta, size_t len,
+    struct connection_closure *closure)
+{
+    struct timespec delay;
+    const char *errstr;
+    debug_decl(iolog_update_index, SUDO_DEBUG_UTIL);
+
+    delay.tv_sec = (time_t)delta->tv_sec;
+    delay.tv_nsec = (long)delta->tv_nsec;
+    if (!iolog_index_update(&closure->iolog_index, closure->iolog_files,
+	    &delay, len, &errstr)) {
+	sudo_warnx(U_("%s/%s: %s"), closure->evlog->iolog_path, "index",
+	    errstr);
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
+
+/*
+ * Prepare the I/O log index for a log being restarted at target.
+ * Checkpoints past the restart point no longer match the log files,
+ * nor do any checkpoints at all if the files were rewritten.
+ */
+bool
+iolog_restart_index(const struct timespec *target, bool rewritten,
+    struct connection_closure *closure)
+{
+    const struct eventlog *evlog = closure->evlog;
+    bool ok;
+    debug_decl(iolog_restart_index, SUDO_DEBUG_UTIL);
+
+    if (!iolog_get_index()) {
+	/* Remove any stale index left over from before the restart. */
+	if (unlinkat(closure->iolog_dir_fd, "index", 0) == -1 &&
+		errno != ENOENT) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"%s: unable to remove %s/index", __func__, evlog->iolog_path);
+	}
+	debug_return_bool(true);
+    }
+
+    if (rewritten) {
+	ok = iolog_index_create(&closure->iolog_index, closure->iolog_dir_fd);
+	if (ok)
+	    closure->iolog_index.elapsed = *target;
+    } else {
+	ok = iolog_index_reopen(&closure->iolog_index, closure->iolog_dir_fd,
+	    target);
+    }
+    if (!ok) {
+	sudo_warn(U_("unable to open %s/%s"), evlog->iolog_path, "index");
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
@@ -120,13 +120,16 @@ iolog_open_all(int dfd, const char *iolog_dir, struct iolog_file *iolog_files,
 
 /*
  * Seek to the specified point in time in the I/O logs.
+ * If the log has an index, start from the last checkpoint before target.
  */
 bool
 iolog_seekto(int iolog_dir_fd, const char *iolog_path,
     struct iolog_file *iolog_files, struct timespec *elapsed_time,
     const struct timespec *target)
 {
+    const struct iolog_index_entry *entry;
     struct timing_closure timing;
+    struct iolog_index idx;
     off_t pos;
     debug_decl(iolog_seekto, SUDO_DEBUG_UTIL);
 
@@ -136,6 +139,26 @@ iolog_seekto(int iolog_dir_fd, const char *iolog_path,
 	debug_return_bool(true);
     }
 
+    if (iolog_index_load(&idx, iolog_dir_fd)) {
+	entry = iolog_index_find(&idx, target);
+	if (entry != NULL) {
+	    if (!iolog_index_seek(entry, iolog_files)) {
+		sudo_warn(U_("%s/%s: unable to seek to [%lld, %ld]"),
+		    iolog_path, "index", (long long)entry->elapsed.tv_sec,
+		    entry->elapsed.tv_nsec);
+		iolog_index_close(&idx, NULL);
+		goto bad;
+	    }
+	    *elapsed_time = entry->elapsed;
+	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+		"starting at checkpoint [%lld, %ld]",
+		(long long)elapsed_time->tv_sec, elapsed_time->tv_nsec);
+	}
+	iolog_index_close(&idx, NULL);
+	if (sudo_timespeccmp(elapsed_time, target, ==))
+	    debug_return_bool(true);
+    }
+
     memset(&timing, 0, sizeof(timing));
     timing.decimal = ".";
 
@@ -89,6 +89,7 @@ static void tls_handshake_cb(int fd, int what, void *v);
 #endif
 
 static double random_drop;
+static bool reuseport;
 
 /*
  * Free a struct connection_closure container and its contents.
@@ -104,6 +105,7 @@ connection_closure_free(struct connection_closure *closure)
 	struct connection_buffer *buf;
 
 	TAILQ_REMOVE(&connections, closure, entries);
+	logsrvd_stats->active--;
 
 	if (closure->state == CONNECTING && closure->journal != NULL) {
 	    /* Failed to relay journal file, retry later. */
@@ -111,6 +113,7 @@ connection_closure_free(struct connection_closure *closure)
 	}
 	if (closure->relay_closure != NULL)
 	    relay_closure_free(closure->relay_closure);
+	journal_sync_cancel(closure);
 #if defined(HAVE_OPENSSL)
 	if (closure->ssl != NULL) {
 	    const char *errstr;
@@ -172,6 +175,7 @@ connection_closure_free(struct connection_closure *closure)
 	    free(buf->data);
 	    free(buf);
 	}
+	logsrv_arena_free(&closure->arena);
 	free(closure->journal_path);
 	if (closure->journal != NULL)
 	    fclose(closure->journal);
@@ -202,6 +206,7 @@ connection_closure_alloc(int fd, bool tls, bool relay_only,
     closure->evbase = base;
     TAILQ_INIT(&closure->write_bufs);
     TAILQ_INIT(&closure->free_bufs);
+    logsrv_arena_init(&closure->arena);
 
     /* Use different message handlers depending on the operating mode. */
     if (relay_only) {
@@ -214,6 +219,7 @@ connection_closure_alloc(int fd, bool tls, bool relay_only,
     }
 
     TAILQ_INSERT_TAIL(&connections, closure, entries);
+    logsrvd_stats->active++;
 
     closure->read_buf.size = 64 * 1024;
     closure->read_buf.data = malloc(closure->read_buf.size);
@@ -289,7 +295,10 @@ connection_close(struct connection_closure *closure)
 
 	    /* Connect to the first relay available asynchronously. */
 	    if (!connect_relay(new_closure)) {
-		sudo_warnx("%s", U_("unable to connect to relay"));
+		/* No relay available, queue the journal for later. */
+		sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+		    "queuing journal %s", new_closure->journal_path);
+		logsrvd_queue_insert(new_closure);
 		connection_closure_free(new_closure);
 	    }
 	}
@@ -308,6 +317,10 @@ connection_close(struct connection_closure *closure)
     debug_return;
 }
 
+/*
+ * Get a buffer with room for at least len bytes, either from the
+ * connection's free list or a newly-allocated one.
+ */
 struct connection_buffer *
 get_free_buf(size_t len, struct connection_closure *closure)
 {
@@ -317,6 +330,7 @@ get_free_buf(size_t len, struct connection_closure *closure)
     buf = TAILQ_FIRST(&closure->free_bufs);
     if (buf != NULL) {
         TAILQ_REMOVE(&closure->free_bufs, buf, entries);
+	closure->free_bufs_size -= buf->size;
     } else {
         if ((buf = calloc(1, sizeof(*buf))) == NULL)
 	    goto oom;
@@ -345,6 +359,126 @@ oom:
     debug_return_ptr(NULL);
 }
 
+/*
+ * Return a buffer that has been fully written to the connection's
+ * free list for reuse.  To bound the memory used by an idle connection,
+ * the buffer is freed instead if the free list is already full.
+ */
+void
+put_free_buf(struct connection_buffer *buf, struct connection_closure *closure)
+{
+    debug_decl(put_free_buf, SUDO_DEBUG_UTIL);
+
+    buf->off = 0;
+    buf->len = 0;
+    if (buf->size > FREE_BUFS_MAX - closure->free_bufs_size) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: freeing %zu byte buffer, %zu bytes in free list", __func__,
+	    buf->size, closure->free_bufs_size);
+	free(buf->data);
+	free(buf);
+	debug_return;
+    }
+    closure->free_bufs_size += buf->size;
+    TAILQ_INSERT_TAIL(&closure->free_bufs, buf, entries);
+
+    debug_return;
+}
+
+/*
+ * Get a buffer on the write queue with room for len more bytes, which
+ * the caller stores at buf->data + buf->len.  A message is appended to
+ * the last queued buffer when that buffer is not already being written
+ * so a burst of small messages can be sent with a single write.
+ */
+struct connection_buffer *
+get_write_buf(size_t len, struct connection_buffer_list *write_bufs,
+    struct connection_closure *closure)
+{
+    struct connection_buffer *buf;
+    debug_decl(get_write_buf, SUDO_DEBUG_UTIL);
+
+    buf = TAILQ_LAST(write_bufs, connection_buffer_list);
+    if (buf != NULL && buf != TAILQ_FIRST(write_bufs) &&
+	    buf->len < WRITE_COALESCE_MAX &&
+	    len <= WRITE_COALESCE_MAX - buf->len) {
+	if (!expand_buf(buf, buf->len + len)) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		"unable to expand connection_buffer");
+	    debug_return_ptr(NULL);
+	}
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "appending %zu bytes to queued buffer of %zu bytes", len, buf->len);
+	debug_return_ptr(buf);
+    }
+
+    if ((buf = get_free_buf(len, closure)) == NULL)
+	debug_return_ptr(NULL);
+    TAILQ_INSERT_TAIL(write_bufs, buf, entries);
+
+    debug_return_ptr(buf);
+}
+
+/*
+ * Fill in iov with the unwritten contents of up to iovmax buffers
+ * from the write queue.  Returns the number of iov entries used.
+ */
+int
+fill_write_iov(struct connection_buffer_list *write_bufs, struct iovec *iov,
+    int iovmax)
+{
+    struct connection_buffer *buf;
+    int iovcnt = 0;
+    debug_decl(fill_write_iov, SUDO_DEBUG_UTIL);
+
+    TAILQ_FOREACH(buf, write_bufs, entries) {
+	if (iovcnt == iovmax)
+	    break;
+	iov[iovcnt].iov_base = buf->data + buf->off;
+	iov[iovcnt].iov_len = buf->len - buf->off;
+	iovcnt++;
+    }
+
+    debug_return_int(iovcnt);
+}
+
+/*
+ * Remove nwritten bytes from the front of the write queue, moving
+ * buffers that have been completely written to the free list.
+ * Returns false if nwritten is larger than the amount queued.
+ */
+bool
+consume_write_bufs(struct connection_buffer_list *write_bufs, size_t nwritten,
+    struct connection_closure *closure)
+{
+    struct connection_buffer *buf;
+    size_t len;
+    debug_decl(consume_write_bufs, SUDO_DEBUG_UTIL);
+
+    logsrvd_stats->writes++;
+    logsrvd_stats->bytes_sent += nwritten;
+
+    while ((buf = TAILQ_FIRST(write_bufs)) != NULL) {
+	len = buf->len - buf->off;
+	if (nwritten < len) {
+	    buf->off += nwritten;
+	    debug_return_bool(true);
+	}
+	/* Sent entire buffer, move it to the free list. */
+	sudo_debug_printf(SUDO_DEBUG_INFO, "%s: finished sending %zu bytes",
+	    __func__, buf->len);
+	nwritten -= len;
+	TAILQ_REMOVE(write_bufs, buf, entries);
+	put_free_buf(buf, closure);
+    }
+    if (nwritten != 0) {
+	sudo_warnx(U_("internal error, %s overflow"), __func__);
+	debug_return_bool(false);
+    }
+
+    debug_return_bool(true);
+}
+
 bool
 fmt_server_message(struct connection_closure *closure, ServerMessage *msg)
 {
@@ -367,15 +501,15 @@ fmt_server_message(struct connection_closure *closure, ServerMessage *msg)
     sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
 	"size + server message %zu bytes", len);
 
-    if ((buf = get_free_buf(len, closure)) == NULL) {
+    if ((buf = get_write_buf(len, &closure->write_bufs, closure)) == NULL) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unable to allocate connection_buffer");
         goto done;
     }
-    memcpy(buf->data, &msg_len, sizeof(msg_len));
-    server_message__pack(msg, buf->data + sizeof(msg_len));
-    buf->len = len;
-    TAILQ_INSERT_TAIL(&closure->write_bufs, buf, entries);
+    memcpy(buf->data + buf->len, &msg_len, sizeof(msg_len));
+    server_message__pack(msg, buf->data + buf->len + sizeof(msg_len));
+    buf->len += len;
+    logsrvd_stats->messages_sent++;
 
     ret = true;
 
@@ -485,8 +619,11 @@ schedule_error_message(const char *errstr, struct connection_closure *closure)
      */
     sudo_ev_del(closure->evbase, closure->read_ev);
     if (closure->relay_closure != NULL) {
-	sudo_ev_del(closure->evbase, closure->relay_closure->read_ev);
-	sudo_ev_del(closure->evbase, closure->relay_closure->write_ev);
+	/* Relay events are not allocated until the connection completes. */
+	if (closure->relay_closure->read_ev != NULL)
+	    sudo_ev_del(closure->evbase, closure->relay_closure->read_ev);
+	if (closure->relay_closure->write_ev != NULL)
+	    sudo_ev_del(closure->evbase, closure->relay_closure->write_ev);
     }
 
     if (errstr == NULL || closure->error || closure->write_ev == NULL)
@@ -900,10 +1037,15 @@ handle_client_message(const uint8_t *buf, size_t len,
     bool ret = false;
     debug_decl(handle_client_message, SUDO_DEBUG_UTIL);
 
-    /* TODO: can we extract type_case without unpacking for relay case? */
-    msg = client_message__unpack(NULL, len, buf);
+    /*
+     * TODO: can we extract type_case without unpacking for relay case?
+     * The message is allocated from the connection's arena, which is
+     * reset once the message has been handled.
+     */
+    msg = client_message__unpack(&closure->arena.allocator, len, buf);
     if (msg == NULL) {
 	sudo_warnx(U_("unable to unpack %s size %zu"), "ClientMessage", len);
+	logsrv_arena_reset(&closure->arena);
 	debug_return_bool(false);
     }
 
@@ -953,7 +1095,7 @@ handle_client_message(const uint8_t *buf, size_t len,
 	closure->errstr = _("unrecognized ClientMessage type");
 	break;
     }
-    client_message__free_unpacked(msg, NULL);
+    logsrv_arena_reset(&closure->arena);
 
     debug_return_bool(ret);
 }
@@ -980,6 +1122,11 @@ server_shutdown(struct sudo_event_base *base)
     struct timespec tv = { 0, 0 };
     debug_decl(server_shutdown, SUDO_DEBUG_UTIL);
 
+    if (logsrvd_worker_supervisor()) {
+	logsrvd_worker_shutdown(base);
+	debug_return;
+    }
+
     if (TAILQ_EMPTY(&connections)) {
 	sudo_ev_loopbreak(base);
 	debug_return;
@@ -1054,6 +1201,7 @@ server_msg_cb(int fd, int what, void *v)
 
 #if defined(HAVE_OPENSSL)
     if (closure->ssl != NULL) {
+	/* Queued messages are coalesced, so write one buffer at a time. */
 	const int result = SSL_write_ex(closure->ssl, buf->data + buf->off,
 	    buf->len - buf->off, &nwritten);
 	if (result <= 0) {
@@ -1084,36 +1232,27 @@ server_msg_cb(int fd, int what, void *v)
     } else
 #endif
     {
-	const ssize_t n = write(fd, buf->data + buf->off, buf->len - buf->off);
+	struct iovec iov[WRITE_IOV_MAX];
+	const int iovcnt = fill_write_iov(&closure->write_bufs, iov,
+	    WRITE_IOV_MAX);
+	const ssize_t n = writev(fd, iov, iovcnt);
 	if (n < 0) {
 	    if (errno == EAGAIN || errno == EINTR)
 		debug_return;
-	    sudo_warn("%s: write", closure->ipaddr);
+	    sudo_warn("%s: writev", closure->ipaddr);
 	    goto finished;
 	}
 	nwritten = (size_t)n;
     }
-    if (nwritten > SIZE_MAX - buf->off) {
-	sudo_warnx(U_("internal error, %s overflow"), __func__);
+    if (!consume_write_bufs(&closure->write_bufs, nwritten, closure))
 	goto finished;
-    }
-    buf->off += nwritten;
 
-    if (buf->off == buf->len) {
-	/* sent entire message, move buf to free list */
-	sudo_debug_printf(SUDO_DEBUG_INFO,
-	    "%s: finished sending %zu bytes to client", __func__, buf->len);
-	buf->off = 0;
-	buf->len = 0;
-	TAILQ_REMOVE(&closure->write_bufs, buf, entries);
-	TAILQ_INSERT_TAIL(&closure->free_bufs, buf, entries);
-	if (TAILQ_EMPTY(&closure->write_bufs)) {
-	    /* Write queue empty, check state. */
-	    sudo_ev_del(closure->evbase, closure->write_ev);
-	    if (closure->error || closure->state == FINISHED ||
-		    closure->state == SHUTDOWN)
-		goto finished;
-	}
+    if (TAILQ_EMPTY(&closure->write_bufs)) {
+	/* Write queue empty, check state. */
+	sudo_ev_del(closure->evbase, closure->write_ev);
+	if (closure->error || closure->state == FINISHED ||
+		closure->state == SHUTDOWN)
+	    goto finished;
     }
     debug_return;
 
@@ -1225,6 +1364,8 @@ client_msg_cb(int fd, int what, void *v)
         goto close_connection;
     }
     buf->len += nread;
+    logsrvd_stats->reads++;
+    logsrvd_stats->bytes += nread;
 
     while (buf->len - buf->off >= sizeof(msg_len)) {
 	/* Read wire message size (uint32_t in network byte order). */
@@ -1250,6 +1391,7 @@ client_msg_cb(int fd, int what, void *v)
 	sudo_debug_printf(SUDO_DEBUG_INFO,
 	    "%s: parsing ClientMessage, size %u", __func__, msg_len);
 	buf->off += sizeof(msg_len);
+	logsrvd_stats->messages++;
 	if (!handle_client_message(buf->data + buf->off, msg_len, closure)) {
 	    /* Use specific error string if one is set. */
 	    if (closure->errstr == NULL) {
@@ -1330,6 +1472,15 @@ server_commit_cb(int unused, int what, void *v)
     TimeSpec commit_point = TIME_SPEC__INIT;
     debug_decl(server_commit_cb, SUDO_DEBUG_UTIL);
 
+    /* The commit point for a journal is sent after it has been synced. */
+    if (closure->journal != NULL && logsrvd_conf_relay_journal_sync()) {
+	if (!journal_sync_schedule(closure)) {
+	    if (!schedule_error_message(closure->errstr, closure))
+		connection_close(closure);
+	}
+	debug_return;
+    }
+
     /* Flush I/O logs before sending commit point if needed. */
     if (!iolog_get_flush())
 	iolog_flush_all(closure);
@@ -1688,6 +1839,15 @@ open_listener_socket(struct server_address *addr)
 #endif
     if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1)
 	sudo_warn("SO_REUSEADDR");
+#ifdef SO_REUSEPORT
+    /* Worker processes share the address, the kernel balances connections. */
+    if (reuseport) {
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+	    sudo_warn("SO_REUSEPORT");
+	    goto bad;
+	}
+    }
+#endif
     if (bind(sock, &addr->sa_un.sa, addr->sa_size) == -1) {
 	/* TODO: only warn once for IPv4 and IPv6 or disambiguate */
 	sudo_warn("%s (%s)", addr->sa_str, family);
@@ -1741,6 +1901,7 @@ listener_cb(int fd, int what, void *v)
     memset(&sa_un, 0, sizeof(sa_un));
     sock = accept(fd, &sa_un.sa, &salen);
     if (sock != -1) {
+	logsrvd_stats->accepted++;
 	if (logsrvd_conf_server_tcp_keepalive()) {
 	    int keepalive = 1;
 	    if (setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepalive,
@@ -1803,6 +1964,23 @@ bad:
     debug_return_bool(false);
 }
 
+/*
+ * Close all listeners.
+ */
+static void
+server_close_listeners(void)
+{
+    struct listener *l;
+    debug_decl(server_close_listeners, SUDO_DEBUG_UTIL);
+
+    while ((l = TAILQ_FIRST(&listeners)) != NULL) {
+	TAILQ_REMOVE(&listeners, l, entries);
+	free_listener(l);
+    }
+
+    debug_return;
+}
+
 /*
  * Register listeners and set the TLS verify callback.
  */
@@ -1883,9 +2061,14 @@ server_reload(struct sudo_event_base *evbase)
 
     sudo_debug_printf(SUDO_DEBUG_INFO, "reloading server config");
     if (logsrvd_conf_read(conf_file)) {
-	/* Re-initialize listeners. */
-	if (!server_setup(evbase))
-	    sudo_fatalx("%s", U_("unable to setup listen socket"));
+	if (logsrvd_worker_supervisor()) {
+	    /* Workers re-read the config and update their own listeners. */
+	    logsrvd_worker_signal(SIGHUP);
+	} else {
+	    /* Re-initialize listeners. */
+	    if (!server_setup(evbase))
+		sudo_fatalx("%s", U_("unable to setup listen socket"));
+	}
 
 	/* Re-read sudo.conf and re-initialize debugging. */
 	sudo_debug_deregister(logsrvd_debug_instance);
@@ -1902,6 +2085,8 @@ server_reload(struct sudo_event_base *evbase)
 /*
  * Dump server information to the debug file.
  * Includes information about listeners and client connections.
+ * In worker mode, the supervisor dumps the counters for each worker
+ * and the workers dump their own client connections.
  */
 static void
 server_dump_stats(void)
@@ -1938,6 +2123,13 @@ server_dump_stats(void)
 	    addr->sa_str, ipaddr);
     }
 
+    if (logsrvd_worker_supervisor()) {
+	logsrvd_worker_dump();
+	logsrvd_worker_signal(SIGUSR1);
+	debug_return;
+    }
+    logsrvd_stats_dump("", logsrvd_stats);
+
     if (!TAILQ_EMPTY(&connections)) {
 	n = 0;
 	sudo_debug_printf(SUDO_DEBUG_INFO, "client connections:");
@@ -2004,6 +2196,9 @@ signal_cb(int signo, int what, void *v)
 	case SIGUSR1:
 	    server_dump_stats();
 	    break;
+	case SIGCHLD:
+	    logsrvd_worker_reap(base);
+	    break;
 	default:
 	    sudo_warnx(U_("unexpected signal %d"), signo);
 	    break;
@@ -2027,6 +2222,45 @@ register_signal(int signo, struct sudo_event_base *base)
     debug_return;
 }
 
+/*
+ * Worker process main loop when running multiple workers.
+ * Each worker has its own event base and SO_REUSEPORT listeners.
+ */
+sudo_noreturn static void
+worker_main(unsigned int id, const sigset_t *mask)
+{
+    struct sudo_event_base *evbase;
+    debug_decl(worker_main, SUDO_DEBUG_UTIL);
+
+    if ((evbase = sudo_ev_base_alloc()) == NULL)
+	sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+
+    if (!server_setup(evbase))
+	sudo_fatalx("%s", U_("unable to setup listen socket"));
+
+    /*
+     * The first worker owns the outgoing queue.  Rescan it each time
+     * the worker is (re)started so journals queued by a worker that
+     * exited are not left unrelayed.
+     */
+    if (id == 0) {
+	if (!logsrvd_queue_scan(evbase))
+	    exit(EXIT_FAILURE);
+    }
+
+    register_signal(SIGHUP, evbase);
+    register_signal(SIGINT, evbase);
+    register_signal(SIGTERM, evbase);
+    register_signal(SIGUSR1, evbase);
+    sigprocmask(SIG_SETMASK, mask, NULL);
+
+    sudo_debug_printf(SUDO_DEBUG_INFO, "worker %u running", id);
+    sudo_ev_dispatch(evbase);
+    sudo_ev_base_free(evbase);
+    logsrvd_conf_cleanup();
+    exit(EXIT_SUCCESS);
+}
+
 static void
 logsrvd_cleanup(void)
 {
@@ -2212,6 +2446,7 @@ main(int argc, char *argv[])
 {
     struct sudo_event_base *evbase;
     bool nofork = false;
+    unsigned int nworkers;
     char *ep;
     int ch;
     debug_decl_vars(main, SUDO_DEBUG_MAIN);
@@ -2285,9 +2520,28 @@ main(int argc, char *argv[])
     if (!server_setup(evbase))
 	sudo_fatalx("%s", U_("unable to setup listen socket"));
 
-    if (!logsrvd_queue_scan(evbase)) {
-	/* Error displayed by logsrvd_queue_scan() */
-        return EXIT_FAILURE;
+    nworkers = logsrvd_conf_server_workers();
+#ifndef SO_REUSEPORT
+    if (nworkers > 1) {
+	sudo_warnx(U_("%s: not supported on this system"), "workers");
+	nworkers = 1;
+    }
+#endif
+    if (nworkers > 1) {
+	/*
+	 * The listeners were only opened to check the configuration.
+	 * Each worker opens its own with SO_REUSEPORT set.
+	 */
+	server_close_listeners();
+	reuseport = true;
+	if (!logsrvd_worker_init(nworkers, worker_main))
+	    return EXIT_FAILURE;
+	register_signal(SIGCHLD, evbase);
+    } else {
+	if (!logsrvd_queue_scan(evbase)) {
+	    /* Error displayed by logsrvd_queue_scan() */
+	    return EXIT_FAILURE;
+	}
     }
 
     register_signal(SIGHUP, evbase);
@@ -2299,6 +2553,15 @@ main(int argc, char *argv[])
     daemonize(nofork);
     signal(SIGPIPE, SIG_IGN);
 
+    if (nworkers > 1) {
+	if (!logsrvd_worker_start(evbase)) {
+	    /* Any workers that did start have been sent SIGTERM. */
+	    if (!nofork && logsrvd_conf_pid_file() != NULL)
+		unlink(logsrvd_conf_pid_file());
+	    sudo_fatalx("%s", U_("unable to start worker processes"));
+	}
+    }
+
     sudo_ev_dispatch(evbase);
     if (!nofork && logsrvd_conf_pid_file() != NULL)
 	unlink(logsrvd_conf_pid_file());
@@ -26,6 +26,9 @@
 
 #include <config.h>
 
+#include <sys/uio.h>	/* for struct iovec */
+#include <signal.h>	/* for sigset_t */
+
 #if defined(HAVE_OPENSSL)
 # if defined(HAVE_WOLFSSL)
 #  include <wolfssl/options.h>
@@ -35,6 +38,7 @@
 #endif
 
 #include "logsrv_util.h"
+#include <logsrv_arena.h>
 #include <tls_common.h>
 
 /* Default timeout value for server socket */
@@ -46,6 +50,15 @@
 /* Shutdown timeout (in seconds) in case client connections time out. */
 #define SHUTDOWN_TIMEO	10
 
+/* Largest write buffer that queued messages will be coalesced into. */
+#define WRITE_COALESCE_MAX	(64 * 1024)
+
+/* Maximum number of write buffers to send in a single writev(2). */
+#define WRITE_IOV_MAX	32
+
+/* Maximum amount of memory held in a connection's free buffer list. */
+#define FREE_BUFS_MAX	(256 * 1024)
+
 #define valid_timespec(ts) ((ts) != NULL && \
     (ts)->tv_sec >= 0 && (ts)->tv_nsec >= 0 && (ts)->tv_nsec < 1000000000)
 
@@ -62,22 +75,34 @@ enum connection_status {
     FINISHED
 };
 
+/*
+ * Order in which journals in the outgoing queue are relayed.
+ */
+enum relay_queue_order {
+    QUEUE_ORDER_OLDEST,
+    QUEUE_ORDER_SMALLEST
+};
+
 /*
  * Per-connection relay state.
  */
+struct relay_host;
 struct relay_closure {
     struct server_address_list *relays;
     struct server_address *relay_addr;
+    struct relay_host *relay_host;
     struct sudo_event *read_ev;
     struct sudo_event *write_ev;
     struct sudo_event *connect_ev;
     struct connection_buffer read_buf;
     struct connection_buffer_list write_bufs;
+    struct logsrv_arena arena;
     struct peer_info relay_name;
 #if defined(HAVE_OPENSSL)
     struct tls_client_closure tls_client;
 #endif
     int sock;
+    bool relay_host_held;
     bool read_instead_of_write;
     bool write_instead_of_read;
     bool temporary_write_event;
@@ -88,13 +113,17 @@ struct relay_closure {
  */
 struct connection_closure {
     TAILQ_ENTRY(connection_closure) entries;
+    TAILQ_ENTRY(connection_closure) sync_entries;
     struct client_message_switch *cms;
     struct relay_closure *relay_closure;
     struct eventlog *evlog;
     struct timespec elapsed_time;
+    struct timespec sync_time;
     struct connection_buffer read_buf;
     struct connection_buffer_list write_bufs;
     struct connection_buffer_list free_bufs;
+    size_t free_bufs_size;
+    struct logsrv_arena arena;
     struct sudo_event_base *evbase;
     struct sudo_event *commit_ev;
     struct sudo_event *read_ev;
@@ -108,6 +137,7 @@ struct connection_closure {
     FILE *journal;
     char *journal_path;
     struct iolog_file iolog_files[IOFD_MAX];
+    struct iolog_index iolog_index;
     int iolog_dir_fd;
     int sock;
     enum connection_status state;
@@ -115,6 +145,7 @@ struct connection_closure {
     bool tls;
     bool log_io;
     bool store_first;
+    bool sync_pending;
     bool read_instead_of_write;
     bool write_instead_of_read;
     bool temporary_write_event;
@@ -179,6 +210,29 @@ struct listener {
 };
 TAILQ_HEAD(listener_list, listener);
 
+/*
+ * Connection counters for a server process.
+ * In worker mode these live in memory shared with the supervisor.
+ */
+struct logsrvd_stats {
+    pid_t pid;
+    unsigned int restarts;
+    time_t started;
+    unsigned long long accepted;
+    unsigned long long active;
+    unsigned long long messages;
+    unsigned long long bytes;
+    unsigned long long reads;
+    unsigned long long messages_sent;
+    unsigned long long bytes_sent;
+    unsigned long long writes;
+    unsigned long long journal_syncs;
+    unsigned long long journals_synced;
+};
+
+/* Worker process entry point, does not return. */
+typedef void (*logsrvd_worker_fn_t)(unsigned int id, const sigset_t *mask);
+
 /* iolog_writer.c */
 struct eventlog *evlog_new(const TimeSpec *submit_time, InfoMessage * const *info_msgs, size_t infolen, struct connection_closure *closure);
 bool iolog_init(const AcceptMessage *msg, struct connection_closure *closure);
@@ -187,6 +241,8 @@ void iolog_close_all(struct connection_closure *closure);
 bool iolog_flush_all(struct connection_closure *closure);
 bool iolog_rewrite(const struct timespec *target, struct connection_closure *closure);
 void update_elapsed_time(const TimeSpec *delta, struct timespec *elapsed);
+bool iolog_update_index(const TimeSpec *delta, size_t len, struct connection_closure *closure);
+bool iolog_restart_index(const struct timespec *target, bool rewritten, struct connection_closure *closure);
 
 /* logsrvd.c */
 extern struct client_message_switch cms_local;
@@ -197,6 +253,10 @@ bool fmt_server_message(struct connection_closure *closure, ServerMessage *msg);
 bool fmt_log_id_message(const unsigned char uuid[restrict static 16], const char *path, struct connection_closure *closure);
 bool schedule_error_message(const char *errstr, struct connection_closure *closure);
 struct connection_buffer *get_free_buf(size_t, struct connection_closure *closure);
+struct connection_buffer *get_write_buf(size_t len, struct connection_buffer_list *write_bufs, struct connection_closure *closure);
+void put_free_buf(struct connection_buffer *buf, struct connection_closure *closure);
+int fill_write_iov(struct connection_buffer_list *write_bufs, struct iovec *iov, int iovmax);
+bool consume_write_bufs(struct connection_buffer_list *write_bufs, size_t nwritten, struct connection_closure *closure);
 struct connection_closure *connection_closure_alloc(int fd, bool tls, bool relay_only, struct sudo_event_base *base);
 
 /* logsrvd_conf.c */
@@ -204,6 +264,7 @@ bool logsrvd_conf_read(const char *path);
 const char *logsrvd_conf_iolog_base(void);
 const char *logsrvd_conf_iolog_dir(void);
 const char *logsrvd_conf_iolog_file(void);
+bool logsrvd_conf_iolog_catalog(void);
 bool logsrvd_conf_iolog_log_passwords(void);
 void *logsrvd_conf_iolog_passprompt_regex(void);
 struct server_address_list *logsrvd_conf_server_listen_address(void);
@@ -211,12 +272,19 @@ struct server_address_list *logsrvd_conf_relay_address(void);
 const char *logsrvd_conf_relay_dir(void);
 bool logsrvd_conf_relay_store_first(void);
 bool logsrvd_conf_relay_tcp_keepalive(void);
+bool logsrvd_conf_relay_journal_sync(void);
+struct timespec *logsrvd_conf_relay_journal_sync_interval(void);
+unsigned int logsrvd_conf_relay_journal_sync_max(void);
 bool logsrvd_conf_server_tcp_keepalive(void);
 const char *logsrvd_conf_pid_file(void);
+unsigned int logsrvd_conf_server_workers(void);
 struct timespec *logsrvd_conf_server_timeout(void);
 struct timespec *logsrvd_conf_relay_connect_timeout(void);
 struct timespec *logsrvd_conf_relay_timeout(void);
 time_t logsrvd_conf_relay_retry_interval(void);
+time_t logsrvd_conf_relay_max_retry_interval(void);
+unsigned int logsrvd_conf_relay_connections(void);
+enum relay_queue_order logsrvd_conf_relay_queue_order(void);
 #if defined(HAVE_OPENSSL)
 bool logsrvd_conf_server_tls_check_host(void);
 bool logsrvd_conf_server_tls_check_peer(void);
@@ -235,6 +303,8 @@ void logsrvd_warn_stderr(bool enabled);
 
 /* logsrvd_journal.c */
 extern struct client_message_switch cms_journal;
+bool journal_sync_schedule(struct connection_closure *closure);
+void journal_sync_cancel(struct connection_closure *closure);
 
 /* logsrvd_local.c */
 extern struct client_message_switch cms_local;
@@ -252,6 +322,12 @@ bool logsrvd_queue_enable(time_t timeout, struct sudo_event_base *evbase);
 bool logsrvd_queue_insert(struct connection_closure *closure);
 bool logsrvd_queue_scan(struct sudo_event_base *evbase);
 void logsrvd_queue_dump(void);
+struct relay_host *logsrvd_queue_host_get(const struct server_address *relay);
+bool logsrvd_queue_host_ready(const struct server_address *relay);
+void logsrvd_queue_host_hold(struct relay_closure *relay_closure);
+void logsrvd_queue_host_release(struct relay_closure *relay_closure);
+void logsrvd_queue_host_failed(struct relay_host *host);
+void logsrvd_queue_host_connected(struct relay_host *host);
 
 /* logsrvd_relay.c */
 extern struct client_message_switch cms_relay;
@@ -259,4 +335,15 @@ void relay_closure_free(struct relay_closure *relay_closure);
 bool connect_relay(struct connection_closure *closure);
 bool relay_shutdown(struct connection_closure *closure);
 
+/* logsrvd_worker.c */
+extern struct logsrvd_stats *logsrvd_stats;
+bool logsrvd_worker_init(unsigned int n, logsrvd_worker_fn_t fn);
+bool logsrvd_worker_start(struct sudo_event_base *evbase);
+bool logsrvd_worker_supervisor(void);
+void logsrvd_worker_dump(void);
+void logsrvd_worker_reap(struct sudo_event_base *evbase);
+void logsrvd_worker_shutdown(struct sudo_event_base *evbase);
+void logsrvd_worker_signal(int signo);
+void logsrvd_stats_dump(const char *prefix, const struct logsrvd_stats *stats);
+
 #endif /* SUDO_LOGSRVD_H */
@@ -105,6 +105,7 @@ static struct logsrvd_config {
 	FILE *log_stream;
 	char *log_file;
 	char *pid_file;
+	unsigned int workers;
 #if defined(HAVE_OPENSSL)
 	char *tls_key_path;
 	char *tls_cert_path;
@@ -122,10 +123,16 @@ static struct logsrvd_config {
         struct address_list_container relays;
         struct timespec connect_timeout;
         struct timespec timeout;
+	struct timespec journal_sync_interval;
 	time_t retry_interval;
+	time_t max_retry_interval;
+	unsigned int journal_sync_max;
+	unsigned int relay_connections;
+	enum relay_queue_order queue_order;
 	char *relay_dir;
         bool tcp_keepalive;
 	bool store_first;
+	bool journal_sync;
 #if defined(HAVE_OPENSSL)
 	char *tls_key_path;
 	char *tls_cert_path;
@@ -139,17 +146,21 @@ static struct logsrvd_config {
 #endif
     } relay;
     struct logsrvd_config_iolog {
+	bool catalog;
 	bool compress;
 	bool flush;
 	bool gid_set;
+	bool index;
 	bool log_passwords;
 	uid_t uid;
 	gid_t gid;
 	mode_t mode;
 	unsigned int maxseq;
+	unsigned int seq_block;
 	char *iolog_base;
 	char *iolog_dir;
 	char *iolog_file;
+	char *compress_type;
 	void *passprompt_regex;
     } iolog;
     struct logsrvd_config_eventlog {
@@ -218,6 +229,12 @@ logsrvd_conf_iolog_file(void)
     return logsrvd_config->iolog.iolog_file;
 }
 
+bool
+logsrvd_conf_iolog_catalog(void)
+{
+    return logsrvd_config->iolog.catalog;
+}
+
 bool
 logsrvd_conf_iolog_log_passwords(void)
 {
@@ -249,6 +266,20 @@ logsrvd_conf_pid_file(void)
     return logsrvd_config->server.pid_file;
 }
 
+/*
+ * Number of server processes to run, a value of 0 means one per CPU.
+ */
+unsigned int
+logsrvd_conf_server_workers(void)
+{
+    long ncpu;
+
+    if (logsrvd_config->server.workers != 0)
+	return logsrvd_config->server.workers;
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpu > 0 ? (unsigned int)ncpu : 1;
+}
+
 struct timespec *
 logsrvd_conf_server_timeout(void)
 {
@@ -304,6 +335,24 @@ logsrvd_conf_relay_tcp_keepalive(void)
     return logsrvd_config->relay.tcp_keepalive;
 }
 
+bool
+logsrvd_conf_relay_journal_sync(void)
+{
+    return logsrvd_config->relay.journal_sync;
+}
+
+struct timespec *
+logsrvd_conf_relay_journal_sync_interval(void)
+{
+    return &logsrvd_config->relay.journal_sync_interval;
+}
+
+unsigned int
+logsrvd_conf_relay_journal_sync_max(void)
+{
+    return logsrvd_config->relay.journal_sync_max;
+}
+
 struct timespec *
 logsrvd_conf_relay_timeout(void)
 {
@@ -330,6 +379,24 @@ logsrvd_conf_relay_retry_interval(void)
     return logsrvd_config->relay.retry_interval;
 }
 
+time_t
+logsrvd_conf_relay_max_retry_interval(void)
+{
+    return logsrvd_config->relay.max_retry_interval;
+}
+
+unsigned int
+logsrvd_conf_relay_connections(void)
+{
+    return logsrvd_config->relay.relay_connections;
+}
+
+enum relay_queue_order
+logsrvd_conf_relay_queue_order(void)
+{
+    return logsrvd_config->relay.queue_order;
+}
+
 #if defined(HAVE_OPENSSL)
 SSL_CTX *
 logsrvd_relay_tls_ctx(void)
@@ -409,6 +476,23 @@ cb_iolog_compress(struct logsrvd_config *config, const char *str, size_t offset)
     debug_return_bool(true);
 }
 
+static bool
+cb_iolog_compress_type(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    debug_decl(cb_iolog_compress_type, SUDO_DEBUG_UTIL);
+
+    if (!iolog_set_compress_type(str)) {
+	sudo_warnx(U_("unsupported I/O log compression type %s"), str);
+	debug_return_bool(false);
+    }
+    free(config->iolog.compress_type);
+    if ((config->iolog.compress_type = strdup(str)) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
+
 static bool
 cb_iolog_log_passwords(struct logsrvd_config *config, const char *str, size_t offset)
 {
@@ -435,6 +519,32 @@ cb_iolog_flush(struct logsrvd_config *config, const char *str, size_t offset)
     debug_return_bool(true);
 }
 
+static bool
+cb_iolog_catalog(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    int val;
+    debug_decl(cb_iolog_catalog, SUDO_DEBUG_UTIL);
+
+    if ((val = sudo_strtobool(str)) == -1)
+	debug_return_bool(false);
+
+    config->iolog.catalog = val;
+    debug_return_bool(true);
+}
+
+static bool
+cb_iolog_index(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    int val;
+    debug_decl(cb_iolog_index, SUDO_DEBUG_UTIL);
+
+    if ((val = sudo_strtobool(str)) == -1)
+	debug_return_bool(false);
+
+    config->iolog.index = val;
+    debug_return_bool(true);
+}
+
 static bool
 cb_iolog_user(struct logsrvd_config *config, const char *user, size_t offset)
 {
@@ -504,6 +614,22 @@ cb_iolog_maxseq(struct logsrvd_config *config, const char *str, size_t offset)
     debug_return_bool(true);
 }
 
+static bool
+cb_iolog_seq_block(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    const char *errstr;
+    unsigned int value;
+    debug_decl(cb_iolog_seq_block, SUDO_DEBUG_UTIL);
+
+    value = (unsigned int)sudo_strtonum(str, 1, SESSID_MAX, &errstr);
+    if (errstr != NULL) {
+	sudo_warnx(U_("invalid value for %s: %s"), "seq_block", errstr);
+	debug_return_bool(false);
+    }
+    config->iolog.seq_block = value;
+    debug_return_bool(true);
+}
+
 static bool
 cb_iolog_passprompt_regex(struct logsrvd_config *config, const char *str, size_t offset)
 {
@@ -633,6 +759,21 @@ cb_server_keepalive(struct logsrvd_config *config, const char *str, size_t offse
     debug_return_bool(true);
 }
 
+static bool
+cb_server_workers(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    unsigned int workers;
+    const char *errstr;
+    debug_decl(cb_server_workers, SUDO_DEBUG_UTIL);
+
+    workers = (unsigned int)sudo_strtonum(str, 0, 1024, &errstr);
+    if (errstr != NULL)
+	debug_return_bool(false);
+
+    config->server.workers = workers;
+    debug_return_bool(true);
+}
+
 static bool
 cb_server_pid_file(struct logsrvd_config *config, const char *str, size_t offset)
 {
@@ -889,6 +1030,54 @@ cb_retry_interval(struct logsrvd_config *config, const char *str, size_t offset)
     debug_return_bool(true);
 }
 
+static bool
+cb_max_retry_interval(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    time_t interval;
+    const char *errstr;
+    debug_decl(cb_max_retry_interval, SUDO_DEBUG_UTIL);
+
+    interval = (time_t)sudo_strtonum(str, 0, TIME_T_MAX, &errstr);
+    if (errstr != NULL)
+	debug_return_bool(false);
+
+    config->relay.max_retry_interval = interval;
+
+    debug_return_bool(true);
+}
+
+static bool
+cb_relay_connections(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    const char *errstr;
+    unsigned int value;
+    debug_decl(cb_relay_connections, SUDO_DEBUG_UTIL);
+
+    value = (unsigned int)sudo_strtonum(str, 1, UINT_MAX, &errstr);
+    if (errstr != NULL) {
+	sudo_warnx(U_("invalid value for %s: %s"), "relay_connections", errstr);
+	debug_return_bool(false);
+    }
+
+    config->relay.relay_connections = value;
+    debug_return_bool(true);
+}
+
+static bool
+cb_relay_queue_order(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    debug_decl(cb_relay_queue_order, SUDO_DEBUG_UTIL);
+
+    if (strcmp(str, "oldest") == 0)
+	config->relay.queue_order = QUEUE_ORDER_OLDEST;
+    else if (strcmp(str, "smallest") == 0)
+	config->relay.queue_order = QUEUE_ORDER_SMALLEST;
+    else
+	debug_return_bool(false);
+
+    debug_return_bool(true);
+}
+
 static bool
 cb_relay_store_first(struct logsrvd_config *config, const char *str, size_t offset)
 {
@@ -902,6 +1091,56 @@ cb_relay_store_first(struct logsrvd_config *config, const char *str, size_t offs
     debug_return_bool(true);
 }
 
+static bool
+cb_relay_journal_sync(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    int val;
+    debug_decl(cb_relay_journal_sync, SUDO_DEBUG_UTIL);
+
+    if ((val = sudo_strtobool(str)) == -1)
+	debug_return_bool(false);
+
+    config->relay.journal_sync = val;
+    debug_return_bool(true);
+}
+
+static bool
+cb_relay_journal_sync_interval(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    const char *errstr;
+    long long msec;
+    debug_decl(cb_relay_journal_sync_interval, SUDO_DEBUG_UTIL);
+
+    /* Interval is in milliseconds. */
+    msec = sudo_strtonum(str, 0, 60 * 1000, &errstr);
+    if (errstr != NULL) {
+	sudo_warnx(U_("invalid value for %s: %s"), "journal_sync_interval",
+	    errstr);
+	debug_return_bool(false);
+    }
+
+    config->relay.journal_sync_interval.tv_sec = (time_t)(msec / 1000);
+    config->relay.journal_sync_interval.tv_nsec = (long)(msec % 1000) * 1000000;
+    debug_return_bool(true);
+}
+
+static bool
+cb_relay_journal_sync_max(struct logsrvd_config *config, const char *str, size_t offset)
+{
+    const char *errstr;
+    unsigned int value;
+    debug_decl(cb_relay_journal_sync_max, SUDO_DEBUG_UTIL);
+
+    value = (unsigned int)sudo_strtonum(str, 1, UINT_MAX, &errstr);
+    if (errstr != NULL) {
+	sudo_warnx(U_("invalid value for %s: %s"), "journal_sync_max", errstr);
+	debug_return_bool(false);
+    }
+
+    config->relay.journal_sync_max = value;
+    debug_return_bool(true);
+}
+
 static bool
 cb_relay_keepalive(struct logsrvd_config *config, const char *str, size_t offset)
 {
@@ -1131,6 +1370,7 @@ static struct logsrvd_config_entry server_conf_entries[] = {
     { "timeout", cb_server_timeout },
     { "tcp_keepalive", cb_server_keepalive },
     { "pid_file", cb_server_pid_file },
+    { "workers", cb_server_workers },
     { "server_log", cb_server_log },
 #if defined(HAVE_OPENSSL)
     { "tls_key", cb_tls_key, offsetof(struct logsrvd_config, server.tls_key_path) },
@@ -1152,7 +1392,13 @@ static struct logsrvd_config_entry relay_conf_entries[] = {
     { "connect_timeout", cb_relay_connect_timeout },
     { "relay_dir", cb_relay_dir },
     { "retry_interval", cb_retry_interval },
+    { "max_retry_interval", cb_max_retry_interval },
+    { "relay_connections", cb_relay_connections },
+    { "queue_order", cb_relay_queue_order },
     { "store_first", cb_relay_store_first },
+    { "journal_sync", cb_relay_journal_sync },
+    { "journal_sync_interval", cb_relay_journal_sync_interval },
+    { "journal_sync_max", cb_relay_journal_sync_max },
     { "tcp_keepalive", cb_relay_keepalive },
 #if defined(HAVE_OPENSSL)
     { "tls_key", cb_tls_key, offsetof(struct logsrvd_config, relay.tls_key_path) },
@@ -1172,11 +1418,15 @@ static struct logsrvd_config_entry iolog_conf_entries[] = {
     { "iolog_file", cb_iolog_file },
     { "iolog_flush", cb_iolog_flush },
     { "iolog_compress", cb_iolog_compress },
+    { "iolog_compress_type", cb_iolog_compress_type },
+    { "iolog_index", cb_iolog_index },
+    { "iolog_catalog", cb_iolog_catalog },
     { "iolog_user", cb_iolog_user },
     { "iolog_group", cb_iolog_group },
     { "iolog_mode", cb_iolog_mode },
     { "log_passwords", cb_iolog_log_passwords },
     { "maxseq", cb_iolog_maxseq },
+    { "seq_block", cb_iolog_seq_block },
     { "passprompt_regex", cb_iolog_passprompt_regex },
     { NULL }
 };
@@ -1385,10 +1635,13 @@ logsrvd_conf_iolog_setconf(struct logsrvd_config *config)
 
     iolog_set_defaults();
     iolog_set_compress(config->iolog.compress);
+    (void)iolog_set_compress_type(config->iolog.compress_type);
     iolog_set_flush(config->iolog.flush);
+    iolog_set_index(config->iolog.index);
     iolog_set_owner(config->iolog.uid, config->iolog.gid);
     iolog_set_mode(config->iolog.mode);
     iolog_set_maxseq(config->iolog.maxseq);
+    iolog_set_seqblock(config->iolog.seq_block);
 
     debug_return;
 }
@@ -1608,6 +1861,7 @@ logsrvd_conf_free(struct logsrvd_config *config)
     free(config->iolog.iolog_base);
     free(config->iolog.iolog_dir);
     free(config->iolog.iolog_file);
+    free(config->iolog.compress_type);
     iolog_pwfilt_free(config->iolog.passprompt_regex);
 
     /* struct logsrvd_config_logfile */
@@ -1640,6 +1894,11 @@ logsrvd_conf_alloc(void)
     config->relay.connect_timeout.tv_sec = DEFAULT_SOCKET_TIMEOUT_SEC;
     config->relay.tcp_keepalive = true;
     config->relay.retry_interval = 30;
+    config->relay.max_retry_interval = 600;
+    config->relay.relay_connections = 4;
+    config->relay.queue_order = QUEUE_ORDER_OLDEST;
+    config->relay.journal_sync_interval.tv_nsec = 10 * 1000000;
+    config->relay.journal_sync_max = 64;
     if (!cb_relay_dir(config, _PATH_SUDO_RELAY_DIR, 0))
 	goto bad;
 #if defined(HAVE_OPENSSL)
@@ -1653,6 +1912,7 @@ logsrvd_conf_alloc(void)
     config->server.timeout.tv_sec = DEFAULT_SOCKET_TIMEOUT_SEC;
     config->server.tcp_keepalive = true;
     config->server.log_type = SERVER_LOG_SYSLOG;
+    config->server.workers = 1;
     config->server.pid_file = strdup(_PATH_SUDO_LOGSRVD_PID);
     if (config->server.pid_file == NULL) {
 	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
@@ -1691,8 +1951,11 @@ logsrvd_conf_alloc(void)
     /* I/O log defaults */
     config->iolog.compress = false;
     config->iolog.flush = true;
+    config->iolog.index = false;
+    config->iolog.catalog = false;
     config->iolog.mode = S_IRUSR|S_IWUSR;
     config->iolog.maxseq = SESSID_MAX;
+    config->iolog.seq_block = 1;
     if (!cb_iolog_dir(config, _PATH_SUDO_IO_LOGDIR, 0))
 	goto bad;
     if (!cb_iolog_file(config, "%{seq}", 0))
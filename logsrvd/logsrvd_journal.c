@@ -232,6 +232,164 @@ journal_finish(struct connection_closure *closure)
     debug_return_bool(true);
 }
 
+/*
+ * Journals waiting to be synced to stable storage.
+ * Instead of calling fsync(2) for every connection each time a commit
+ * point is due, connections are queued and their journals are synced
+ * as a group, either journal_sync_interval after the first one was
+ * queued or as soon as journal_sync_max journals are waiting.
+ */
+TAILQ_HEAD(journal_sync_list, connection_closure);
+static struct journal_sync_list journal_sync_queue =
+    TAILQ_HEAD_INITIALIZER(journal_sync_queue);
+static struct sudo_event *journal_sync_ev;
+static unsigned int journal_sync_pending;
+
+/*
+ * Sync the outgoing directory so that journals renamed by
+ * journal_finish() persist.
+ */
+static void
+journal_sync_outgoing(void)
+{
+    char pathbuf[PATH_MAX];
+    int len, dfd;
+    debug_decl(journal_sync_outgoing, SUDO_DEBUG_UTIL);
+
+    len = snprintf(pathbuf, sizeof(pathbuf), "%s/outgoing",
+	logsrvd_conf_relay_dir());
+    if ((size_t)len >= sizeof(pathbuf)) {
+	errno = ENAMETOOLONG;
+	sudo_warn("%s/outgoing", logsrvd_conf_relay_dir());
+	debug_return;
+    }
+    dfd = open(pathbuf, O_RDONLY|O_DIRECTORY);
+    if (dfd == -1 || fsync(dfd) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "unable to sync %s", pathbuf);
+    }
+    if (dfd != -1)
+	close(dfd);
+
+    debug_return;
+}
+
+/*
+ * Sync all queued journals, then send each connection the commit
+ * point that was current when it was queued.
+ */
+static void
+journal_sync_cb(int unused, int what, void *v)
+{
+    struct journal_sync_list batch = TAILQ_HEAD_INITIALIZER(batch);
+    struct connection_closure *closure, *next;
+    TimeSpec commit_point = TIME_SPEC__INIT;
+    bool sync_outgoing = false;
+    debug_decl(journal_sync_cb, SUDO_DEBUG_UTIL);
+
+    /* Connections queued while we are syncing go in the next batch. */
+    TAILQ_CONCAT(&batch, &journal_sync_queue, sync_entries);
+    journal_sync_pending = 0;
+
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"%s: syncing journals", __func__);
+    logsrvd_stats->journal_syncs++;
+    TAILQ_FOREACH(closure, &batch, sync_entries) {
+	logsrvd_stats->journals_synced++;
+	if (closure->state == EXITED)
+	    sync_outgoing = true;
+	if (fsync(fileno(closure->journal)) == -1) {
+	    sudo_warn(U_("unable to write to %s"), closure->journal_path);
+	    closure->errstr = _("unable to write journal file");
+	}
+    }
+    if (sync_outgoing)
+	journal_sync_outgoing();
+
+    TAILQ_FOREACH_SAFE(closure, &batch, sync_entries, next) {
+	TAILQ_REMOVE(&batch, closure, sync_entries);
+	closure->sync_pending = false;
+	if (closure->errstr != NULL) {
+	    if (!schedule_error_message(closure->errstr, closure))
+		connection_close(closure);
+	    continue;
+	}
+	commit_point.tv_sec = closure->sync_time.tv_sec;
+	commit_point.tv_nsec = (int32_t)closure->sync_time.tv_nsec;
+	if (!schedule_commit_point(&commit_point, closure))
+	    connection_close(closure);
+    }
+
+    debug_return;
+}
+
+/*
+ * Flush the connection's journal and queue it to be synced.
+ * The commit point will be sent by journal_sync_cb().
+ */
+bool
+journal_sync_schedule(struct connection_closure *closure)
+{
+    struct timespec immediate = { 0, 0 };
+    struct timespec *timeout = logsrvd_conf_relay_journal_sync_interval();
+    debug_decl(journal_sync_schedule, SUDO_DEBUG_UTIL);
+
+    if (fflush(closure->journal) != 0) {
+	closure->errstr = _("unable to write journal file");
+	debug_return_bool(false);
+    }
+    closure->sync_time = closure->elapsed_time;
+    if (closure->sync_pending)
+	debug_return_bool(true);
+
+    if (journal_sync_ev == NULL) {
+	journal_sync_ev = sudo_ev_alloc(-1, SUDO_EV_TIMEOUT, journal_sync_cb,
+	    NULL);
+	if (journal_sync_ev == NULL) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    closure->errstr = _("unable to allocate memory");
+	    debug_return_bool(false);
+	}
+    }
+
+    /* Sync right away once the batch is full. */
+    if (++journal_sync_pending >= logsrvd_conf_relay_journal_sync_max()) {
+	timeout = &immediate;
+    } else if (ISSET(journal_sync_ev->flags, SUDO_EVQ_INSERTED)) {
+	timeout = NULL;
+    }
+    if (timeout != NULL) {
+	if (sudo_ev_add(closure->evbase, journal_sync_ev, timeout, false) == -1) {
+	    sudo_warnx("%s", U_("unable to add event to queue"));
+	    journal_sync_pending--;
+	    closure->errstr = _("unable to add event to queue");
+	    debug_return_bool(false);
+	}
+    }
+    TAILQ_INSERT_TAIL(&journal_sync_queue, closure, sync_entries);
+    closure->sync_pending = true;
+
+    debug_return_bool(true);
+}
+
+/*
+ * Remove a connection from the sync queue when it is freed.
+ */
+void
+journal_sync_cancel(struct connection_closure *closure)
+{
+    debug_decl(journal_sync_cancel, SUDO_DEBUG_UTIL);
+
+    if (closure->sync_pending) {
+	TAILQ_REMOVE(&journal_sync_queue, closure, sync_entries);
+	closure->sync_pending = false;
+	if (--journal_sync_pending == 0)
+	    sudo_ev_del(NULL, journal_sync_ev);
+    }
+
+    debug_return;
+}
+
 /*
  * Seek ahead in the journal to the specified target time.
  * Returns true if we reached the target time exactly, else false.
@@ -520,6 +520,7 @@ store_restart_local(const RestartMessage *msg, const uint8_t *buf, size_t len,
     struct connection_closure *closure)
 {
     struct timespec target;
+    bool rewritten = false;
     struct stat sb;
     int iofd;
     debug_decl(store_restart_local, SUDO_DEBUG_UTIL);
@@ -576,21 +577,31 @@ store_restart_local(const RestartMessage *msg, const uint8_t *buf, size_t len,
 
     /* Compressed logs don't support random access, so rewrite them. */
     for (iofd = 0; iofd < IOFD_MAX; iofd++) {
-	if (closure->iolog_files[iofd].compressed)
-	    debug_return_bool(iolog_rewrite(&target, closure));
+	if (closure->iolog_files[iofd].compressed) {
+	    if (!iolog_rewrite(&target, closure))
+		goto bad;
+	    rewritten = true;
+	    break;
+	}
     }
 
-    /* Parse timing file until we reach the target point. */
-    if (!iolog_seekto(closure->iolog_dir_fd, closure->evlog->iolog_path,
-	    closure->iolog_files, &closure->elapsed_time, &target))
-	goto bad;
+    if (!rewritten) {
+	/* Parse timing file until we reach the target point. */
+	if (!iolog_seekto(closure->iolog_dir_fd, closure->evlog->iolog_path,
+		closure->iolog_files, &closure->elapsed_time, &target))
+	    goto bad;
 
-    /* Must seek or flush before switching from read -> write. */
-    if (iolog_seek(&closure->iolog_files[IOFD_TIMING], 0, SEEK_CUR) == -1) {
-	sudo_warn("%s/timing", closure->evlog->iolog_path);
-	goto bad;
+	/* Must seek or flush before switching from read -> write. */
+	if (iolog_seek(&closure->iolog_files[IOFD_TIMING], 0, SEEK_CUR) == -1) {
+	    sudo_warn("%s/timing", closure->evlog->iolog_path);
+	    goto bad;
+	}
     }
 
+    /* Drop index checkpoints that are past the restart point. */
+    if (!iolog_restart_index(&target, rewritten, closure))
+	goto bad;
+
     /* Ready to log I/O buffers. */
     debug_return_bool(true);
 bad:
@@ -686,6 +697,8 @@ store_iobuf_local(int iofd, const IoBuffer *iobuf, const uint8_t *buf,
     }
 
     update_elapsed_time(iobuf->delay, &closure->elapsed_time);
+    if (!iolog_update_index(iobuf->delay, data.len + (size_t)len, closure))
+	goto bad;
 
     free(newbuf);
     debug_return_bool(true);
@@ -723,6 +736,8 @@ store_winsize_local(const ChangeWindowSize *msg, const uint8_t *buf,
     }
 
     update_elapsed_time(msg->delay, &closure->elapsed_time);
+    if (!iolog_update_index(msg->delay, (size_t)len, closure))
+	goto bad;
 
     debug_return_bool(true);
 bad:
@@ -758,6 +773,8 @@ store_suspend_local(const CommandSuspend *msg, const uint8_t *buf,
     }
 
     update_elapsed_time(msg->delay, &closure->elapsed_time);
+    if (!iolog_update_index(msg->delay, (size_t)len, closure))
+	goto bad;
 
     debug_return_bool(true);
 bad:
@@ -60,21 +60,308 @@
 
 /*
  * Queue of finished journal files to be relayed.
+ * The queue is kept sorted according to the queue_order setting.
  */
 struct outgoing_journal {
     TAILQ_ENTRY(outgoing_journal) entries;
     char *journal_path;
+    struct timespec mtime;
+    off_t size;
 };
 TAILQ_HEAD(outgoing_journal_queue, outgoing_journal);
 
 static struct outgoing_journal_queue outgoing_journal_queue =
     TAILQ_HEAD_INITIALIZER(outgoing_journal_queue);
+static size_t outgoing_journal_count;
 
 static struct sudo_event *outgoing_queue_event;
 
 /*
- * Callback that runs when the outgoing queue retry timer fires.
- * Tries to relay the first entry in the outgoing queue.
+ * Per-relay host state, shared by all addresses of a relay_host entry.
+ * Limits the number of journals relayed to a host at the same time
+ * and delays new attempts after a connection failure.
+ */
+struct relay_host {
+    TAILQ_ENTRY(relay_host) entries;
+    char *sa_str;
+    struct timespec retry_time;
+    unsigned int active;
+    unsigned int failures;
+};
+TAILQ_HEAD(relay_host_list, relay_host);
+
+static struct relay_host_list relay_hosts =
+    TAILQ_HEAD_INITIALIZER(relay_hosts);
+
+/*
+ * Compare two queued journals based on the queue_order setting.
+ * Ties are broken by modification time so the order is stable.
+ */
+static int
+outgoing_journal_compare(const struct outgoing_journal *oj1,
+    const struct outgoing_journal *oj2)
+{
+    if (logsrvd_conf_relay_queue_order() == QUEUE_ORDER_SMALLEST) {
+	if (oj1->size != oj2->size)
+	    return oj1->size < oj2->size ? -1 : 1;
+    }
+    if (sudo_timespeccmp(&oj1->mtime, &oj2->mtime, !=))
+	return sudo_timespeccmp(&oj1->mtime, &oj2->mtime, <) ? -1 : 1;
+    return 0;
+}
+
+static int
+outgoing_journal_qsort_cmp(const void *v1, const void *v2)
+{
+    const struct outgoing_journal *oj1 = *(struct outgoing_journal **)v1;
+    const struct outgoing_journal *oj2 = *(struct outgoing_journal **)v2;
+
+    return outgoing_journal_compare(oj1, oj2);
+}
+
+/*
+ * Allocate a queue entry for the specified journal path.
+ * If fd is not -1 it is used to get the journal's size and mtime.
+ */
+static struct outgoing_journal *
+outgoing_journal_alloc(char *journal_path, int fd)
+{
+    struct outgoing_journal *oj;
+    struct stat sb;
+    debug_decl(outgoing_journal_alloc, SUDO_DEBUG_UTIL);
+
+    if ((oj = calloc(1, sizeof(*oj))) == NULL)
+	debug_return_ptr(NULL);
+    oj->journal_path = journal_path;
+    if ((fd != -1 ? fstat(fd, &sb) : stat(journal_path, &sb)) == 0) {
+	mtim_get(&sb, oj->mtime);
+	oj->size = sb.st_size;
+    }
+    debug_return_ptr(oj);
+}
+
+/*
+ * Insert a journal into the outgoing queue in sorted order.
+ */
+static void
+outgoing_journal_insert(struct outgoing_journal *oj)
+{
+    struct outgoing_journal *cur;
+    debug_decl(outgoing_journal_insert, SUDO_DEBUG_UTIL);
+
+    /* New journals usually sort last, search from the end. */
+    TAILQ_FOREACH_REVERSE(cur, &outgoing_journal_queue, outgoing_journal_queue,
+	    entries) {
+	if (outgoing_journal_compare(cur, oj) <= 0)
+	    break;
+    }
+    if (cur != NULL) {
+	TAILQ_INSERT_AFTER(&outgoing_journal_queue, cur, oj, entries);
+    } else {
+	TAILQ_INSERT_HEAD(&outgoing_journal_queue, oj, entries);
+    }
+    outgoing_journal_count++;
+
+    debug_return;
+}
+
+static void
+outgoing_journal_remove(struct outgoing_journal *oj)
+{
+    TAILQ_REMOVE(&outgoing_journal_queue, oj, entries);
+    outgoing_journal_count--;
+}
+
+/*
+ * Find the state for the specified relay, creating it as needed.
+ * Returns NULL on memory allocation failure.
+ */
+struct relay_host *
+logsrvd_queue_host_get(const struct server_address *relay)
+{
+    struct relay_host *host;
+    debug_decl(logsrvd_queue_host_get, SUDO_DEBUG_UTIL);
+
+    TAILQ_FOREACH(host, &relay_hosts, entries) {
+	if (strcmp(host->sa_str, relay->sa_str) == 0)
+	    debug_return_ptr(host);
+    }
+    if ((host = calloc(1, sizeof(*host))) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	debug_return_ptr(NULL);
+    }
+    if ((host->sa_str = strdup(relay->sa_str)) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	free(host);
+	debug_return_ptr(NULL);
+    }
+    TAILQ_INSERT_TAIL(&relay_hosts, host, entries);
+
+    debug_return_ptr(host);
+}
+
+/*
+ * Returns true if a journal may be relayed to the specified relay.
+ * If not and the relay is backing off, the time remaining is
+ * stored in delay, which is not modified otherwise.
+ */
+static bool
+relay_host_ready(struct relay_host *host, struct timespec *delay)
+{
+    struct timespec now, remaining;
+    debug_decl(relay_host_ready, SUDO_DEBUG_UTIL);
+
+    if (host == NULL)
+	debug_return_bool(true);
+    if (host->active >= logsrvd_conf_relay_connections())
+	debug_return_bool(false);
+    if (sudo_timespecisset(&host->retry_time)) {
+	if (sudo_gettime_mono(&now) == -1)
+	    debug_return_bool(true);
+	if (sudo_timespeccmp(&now, &host->retry_time, <)) {
+	    if (delay != NULL) {
+		sudo_timespecsub(&host->retry_time, &now, &remaining);
+		if (!sudo_timespecisset(delay) ||
+			sudo_timespeccmp(&remaining, delay, <))
+		    *delay = remaining;
+	    }
+	    debug_return_bool(false);
+	}
+    }
+    debug_return_bool(true);
+}
+
+bool
+logsrvd_queue_host_ready(const struct server_address *relay)
+{
+    return relay_host_ready(logsrvd_queue_host_get(relay), NULL);
+}
+
+/*
+ * Count a journal being relayed against the relay_closure's host.
+ */
+void
+logsrvd_queue_host_hold(struct relay_closure *relay_closure)
+{
+    debug_decl(logsrvd_queue_host_hold, SUDO_DEBUG_UTIL);
+
+    if (relay_closure->relay_host != NULL && !relay_closure->relay_host_held) {
+	relay_closure->relay_host->active++;
+	relay_closure->relay_host_held = true;
+    }
+
+    debug_return;
+}
+
+/*
+ * Release a journal slot held by the relay_closure, if any.
+ */
+void
+logsrvd_queue_host_release(struct relay_closure *relay_closure)
+{
+    debug_decl(logsrvd_queue_host_release, SUDO_DEBUG_UTIL);
+
+    if (relay_closure->relay_host_held) {
+	relay_closure->relay_host->active--;
+	relay_closure->relay_host_held = false;
+    }
+
+    debug_return;
+}
+
+/*
+ * Record a connection failure for the relay host.
+ * Journals will not be sent to the host until the retry time,
+ * which doubles for each consecutive failure, up to the value of
+ * max_retry_interval.  A random amount of up to half the interval
+ * is subtracted so that multiple servers don't retry in lockstep.
+ */
+void
+logsrvd_queue_host_failed(struct relay_host *host)
+{
+    time_t interval = logsrvd_conf_relay_retry_interval();
+    time_t max_interval = logsrvd_conf_relay_max_retry_interval();
+    struct timespec delay, now;
+    unsigned int i;
+    uint32_t msec;
+    debug_decl(logsrvd_queue_host_failed, SUDO_DEBUG_UTIL);
+
+    if (host == NULL)
+	debug_return;
+    if (sudo_gettime_mono(&now) == -1) {
+	sudo_timespecclear(&host->retry_time);
+	debug_return;
+    }
+
+    /* Concurrent connections that fail together count as one failure. */
+    if (sudo_timespeccmp(&now, &host->retry_time, <))
+	debug_return;
+
+    host->failures++;
+    if (max_interval < interval)
+	max_interval = interval;
+    if (max_interval > UINT32_MAX / 2000)
+	max_interval = UINT32_MAX / 2000;
+    if (interval > max_interval)
+	interval = max_interval;
+    for (i = 1; i < host->failures && interval < max_interval; i++)
+	interval *= 2;
+    if (interval > max_interval)
+	interval = max_interval;
+
+    /* Jitter, between half the interval and the full interval. */
+    msec = (uint32_t)interval * 1000;
+    msec -= arc4random_uniform(msec / 2 + 1);
+    delay.tv_sec = msec / 1000;
+    delay.tv_nsec = (long)(msec % 1000) * 1000000;
+    sudo_timespecadd(&now, &delay, &host->retry_time);
+
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"relay %s: %u failure(s), retry in %u ms", host->sa_str,
+	host->failures, (unsigned int)msec);
+
+    debug_return;
+}
+
+/*
+ * Reset the relay host's failure count after a successful connection.
+ */
+void
+logsrvd_queue_host_connected(struct relay_host *host)
+{
+    debug_decl(logsrvd_queue_host_connected, SUDO_DEBUG_UTIL);
+
+    if (host != NULL) {
+	host->failures = 0;
+	sudo_timespecclear(&host->retry_time);
+    }
+
+    debug_return;
+}
+
+/*
+ * Returns true if there is a relay host that can accept another journal.
+ * If not, delay is set to the time until the first host stops backing
+ * off, or cleared if all hosts are busy.
+ */
+static bool
+outgoing_queue_ready(struct timespec *delay)
+{
+    struct server_address *relay;
+    debug_decl(outgoing_queue_ready, SUDO_DEBUG_UTIL);
+
+    sudo_timespecclear(delay);
+    TAILQ_FOREACH(relay, logsrvd_conf_relay_address(), entries) {
+	if (relay_host_ready(logsrvd_queue_host_get(relay), delay))
+	    debug_return_bool(true);
+    }
+    debug_return_bool(false);
+}
+
+/*
+ * Callback that runs when the outgoing queue timer fires.
+ * Starts relaying journals from the front of the outgoing queue
+ * until there are no relay hosts available to accept them.
  */
 static void
 outgoing_queue_cb(int unused, int what, void *v)
@@ -82,22 +369,32 @@ outgoing_queue_cb(int unused, int what, void *v)
     struct connection_closure *closure;
     struct outgoing_journal *oj, *next;
     struct sudo_event_base *evbase = v;
-    bool success = false;
+    struct timespec delay;
     debug_decl(outgoing_queue_cb, SUDO_DEBUG_UTIL);
 
     /* Must have at least one relay server. */
     if (TAILQ_EMPTY(logsrvd_conf_relay_address()))
 	debug_return;
 
-    /* Process first journal. */
     TAILQ_FOREACH_SAFE(oj, &outgoing_journal_queue, entries, next) {
 	FILE *fp;
 	int fd;
 
+	if (!outgoing_queue_ready(&delay)) {
+	    /* Wait for a relay host to finish backing off. */
+	    if (sudo_timespecisset(&delay)) {
+		if (sudo_ev_add(evbase, outgoing_queue_event, &delay,
+			false) == -1) {
+		    sudo_warnx("%s", U_("unable to add event to queue"));
+		}
+	    }
+	    break;
+	}
+
 	fd = open(oj->journal_path, O_RDWR|O_NOFOLLOW);
 	if (fd == -1) {
 	    if (errno == ENOENT) {
-		TAILQ_REMOVE(&outgoing_journal_queue, oj, entries);
+		outgoing_journal_remove(oj);
 		free(oj->journal_path);
 		free(oj);
 	    }
@@ -124,17 +421,22 @@ outgoing_queue_cb(int unused, int what, void *v)
 	closure->journal = fp;
 	closure->journal_path = oj->journal_path;
 
-	/* Done with oj now, closure owns journal_path. */
-	TAILQ_REMOVE(&outgoing_journal_queue, oj, entries);
-	free(oj);
-
-	success = connect_relay(closure);
-	if (!success) {
+	if (!connect_relay(closure)) {
+	    /* Leave journal at the front of the queue and retry later. */
 	    sudo_warnx("%s", U_("unable to connect to relay"));
+	    closure->journal_path = NULL;
 	    connection_close(closure);
+	    (void)logsrvd_queue_enable(logsrvd_conf_relay_retry_interval(),
+		evbase);
+	    break;
 	}
-	break;
+
+	/* Done with oj now, closure owns journal_path. */
+	outgoing_journal_remove(oj);
+	free(oj);
     }
+
+    debug_return;
 }
 
 /*
@@ -167,7 +469,7 @@ logsrvd_queue_enable(time_t timeout, struct sudo_event_base *evbase)
 }
 
 /*
- * Allocate a queue item based on the connection and push it on
+ * Allocate a queue item based on the connection and insert it in
  * the outgoing queue.
  * Consumes journal_path from the closure.
  */
@@ -183,16 +485,17 @@ logsrvd_queue_insert(struct connection_closure *closure)
 	debug_return_bool(false);
     }
 
-    if ((oj = malloc(sizeof(*oj))) == NULL) {
+    oj = outgoing_journal_alloc(closure->journal_path,
+	closure->journal ? fileno(closure->journal) : -1);
+    if (oj == NULL) {
 	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
 	debug_return_bool(false);
     }
-    oj->journal_path = closure->journal_path;
     closure->journal_path = NULL;
-    TAILQ_INSERT_TAIL(&outgoing_journal_queue, oj, entries);
+    outgoing_journal_insert(oj);
 
-    if (!logsrvd_queue_enable(logsrvd_conf_relay_retry_interval(),
-	    closure->evbase))
+    /* The queue callback will wait for a relay host to become available. */
+    if (!logsrvd_queue_enable(0, closure->evbase))
 	debug_return_bool(false);
 
     debug_return_bool(true);
@@ -206,8 +509,11 @@ bool
 logsrvd_queue_scan(struct sudo_event_base *evbase)
 {
     const char uuid_template[] = "123e4567-e89b-12d3-a456-426655440000";
+    struct outgoing_journal **sorted = NULL;
+    struct outgoing_journal *oj;
     char path[PATH_MAX];
     struct dirent *dent;
+    size_t i, n = 0, size = 0;
     int dirlen;
     DIR *dirp;
     debug_decl(logsrvd_queue_scan, SUDO_DEBUG_UTIL);
@@ -233,26 +539,45 @@ logsrvd_queue_scan(struct sudo_event_base *evbase)
     }
     while ((dent = readdir(dirp)) != NULL) {
 	unsigned char uuid[16];
-	struct outgoing_journal *oj;
+	char *journal_path;
 
 	/* Skip anything that is not a uuid. */
 	if (sudo_uuid_from_string(dent->d_name, uuid) != 0)
 	    continue;
 
-	/* Add to queue. */
+	/* Add to the list to be sorted. */
 	path[dirlen] = '\0';
 	if (strlcat(path, dent->d_name, sizeof(path)) >= sizeof(path))
 	    continue;
-	if ((oj = malloc(sizeof(*oj))) == NULL)
+	if (n == size) {
+	    struct outgoing_journal **tmp;
+
+	    tmp = reallocarray(sorted, size ? size * 2 : 64, sizeof(*sorted));
+	    if (tmp == NULL)
+		goto oom;
+	    sorted = tmp;
+	    size = size ? size * 2 : 64;
+	}
+	if ((journal_path = strdup(path)) == NULL)
 	    goto oom;
-	if ((oj->journal_path = strdup(path)) == NULL) {
-	    free(oj);
+	if ((oj = outgoing_journal_alloc(journal_path, -1)) == NULL) {
+	    free(journal_path);
 	    goto oom;
 	}
-	TAILQ_INSERT_TAIL(&outgoing_journal_queue, oj, entries);
+	sorted[n++] = oj;
     }
     closedir(dirp);
 
+    /* Add to queue in sorted order. */
+    if (n != 0) {
+	qsort(sorted, n, sizeof(*sorted), outgoing_journal_qsort_cmp);
+	for (i = 0; i < n; i++) {
+	    TAILQ_INSERT_TAIL(&outgoing_journal_queue, sorted[i], entries);
+	    outgoing_journal_count++;
+	}
+    }
+    free(sorted);
+
     /* Process the queue immediately. */
     if (!logsrvd_queue_enable(0, evbase))
 	debug_return_bool(false);
@@ -261,23 +586,56 @@ logsrvd_queue_scan(struct sudo_event_base *evbase)
 oom:
     sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
     closedir(dirp);
+    for (i = 0; i < n; i++) {
+	free(sorted[i]->journal_path);
+	free(sorted[i]);
+    }
+    free(sorted);
     debug_return_bool(false);
 }
 
 /*
- * Dump outgoing queue in response to SIGUSR1.
+ * Dump outgoing queue and relay host state in response to SIGUSR1.
  */
 void
 logsrvd_queue_dump(void)
 {
     struct outgoing_journal *oj;
+    struct relay_host *host;
+    struct timespec now;
+    long long bytes = 0;
     debug_decl(logsrvd_queue_dump, SUDO_DEBUG_UTIL);
 
+    if (sudo_gettime_mono(&now) == -1)
+	sudo_timespecclear(&now);
+    TAILQ_FOREACH(host, &relay_hosts, entries) {
+	sudo_debug_printf(SUDO_DEBUG_INFO,
+	    "relay host %s: %u active, %u failures", host->sa_str,
+	    host->active, host->failures);
+	if (sudo_timespeccmp(&now, &host->retry_time, <)) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO, "  retry in %lld seconds",
+		(long long)(host->retry_time.tv_sec - now.tv_sec));
+	}
+    }
+
     if (TAILQ_EMPTY(&outgoing_journal_queue))
 	debug_return;
 
-    sudo_debug_printf(SUDO_DEBUG_INFO, "outgoing journal queue:");
+    TAILQ_FOREACH(oj, &outgoing_journal_queue, entries) {
+	bytes += (long long)oj->size;
+    }
+    sudo_debug_printf(SUDO_DEBUG_INFO,
+	"outgoing journal queue: %zu journals, %lld bytes",
+	outgoing_journal_count, bytes);
+    oj = TAILQ_FIRST(&outgoing_journal_queue);
+    if (logsrvd_conf_relay_queue_order() == QUEUE_ORDER_OLDEST &&
+	    sudo_gettime_real(&now) == 0 && oj->mtime.tv_sec != 0) {
+	sudo_debug_printf(SUDO_DEBUG_INFO, "  oldest journal: %lld seconds",
+	    (long long)(now.tv_sec - oj->mtime.tv_sec));
+    }
     TAILQ_FOREACH(oj, &outgoing_journal_queue, entries) {
 	sudo_debug_printf(SUDO_DEBUG_INFO, "  %s", oj->journal_path);
     }
+
+    debug_return;
 }
@@ -83,6 +83,7 @@ relay_closure_free(struct relay_closure *relay_closure)
 	SSL_free(relay_closure->tls_client.ssl);
     }
 #endif
+    logsrvd_queue_host_release(relay_closure);
     if (relay_closure->relays != NULL)
 	address_list_delref(relay_closure->relays);
     sudo_rcstr_delref(relay_closure->relay_name.name);
@@ -95,6 +96,7 @@ relay_closure_free(struct relay_closure *relay_closure)
 	free(buf->data);
 	free(buf);
     }
+    logsrv_arena_free(&relay_closure->arena);
     if (relay_closure->sock != -1) {
 	shutdown(relay_closure->sock, SHUT_RDWR);
 	close(relay_closure->sock);
@@ -122,6 +124,7 @@ relay_closure_alloc(void)
     relay_closure->relays = logsrvd_conf_relay_address();
     address_list_addref(relay_closure->relays);
     TAILQ_INIT(&relay_closure->write_bufs);
+    logsrv_arena_init(&relay_closure->arena);
 
     relay_closure->read_buf.size = 8 * 1024;
     relay_closure->read_buf.data = malloc(relay_closure->read_buf.size);
@@ -135,8 +138,7 @@ bad:
 }
 
 /*
- * Allocate a new buffer, copy buf to it and insert on the write queue.
- * On success the relay write event is enabled.
+ * Copy buf to the relay write queue and enable the relay write event.
  * The length parameter does not include space for the message's wire size.
  */
 static bool
@@ -146,7 +148,6 @@ relay_enqueue_write(const uint8_t *msgbuf, size_t len,
     struct relay_closure *relay_closure = closure->relay_closure;
     struct connection_buffer *buf;
     uint32_t msg_len;
-    bool ret = false;
     debug_decl(relay_enqueue_write, SUDO_DEBUG_UTIL);
 
     /* Wire message size is used for length encoding, precedes message. */
@@ -155,31 +156,24 @@ relay_enqueue_write(const uint8_t *msgbuf, size_t len,
     sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
 	"size + client message %zu bytes", len);
 
-    if ((buf = get_free_buf(sizeof(msg_len) + len, closure)) == NULL) {
-	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
-	    "unable to allocate connection_buffer");
-	goto done;
-    }
-    memcpy(buf->data, &msg_len, sizeof(msg_len));
-    memcpy(buf->data + sizeof(msg_len), msgbuf, len);
-    buf->len = sizeof(msg_len) + len;
-
     if (sudo_ev_add(closure->evbase, relay_closure->write_ev, NULL, false) == -1) {
 	sudo_warnx("%s", U_("unable to add event to queue"));
-	goto done;
+	debug_return_bool(false);
     }
 
-    TAILQ_INSERT_TAIL(&relay_closure->write_bufs, buf, entries);
-    buf = NULL;
-
-    ret = true;
-
-done:
-    if (buf != NULL) {
-	free(buf->data);
-	free(buf);
+    buf = get_write_buf(sizeof(msg_len) + len, &relay_closure->write_bufs,
+	closure);
+    if (buf == NULL) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "unable to allocate connection_buffer");
+	debug_return_bool(false);
     }
-    debug_return_bool(ret);
+    memcpy(buf->data + buf->len, &msg_len, sizeof(msg_len));
+    memcpy(buf->data + buf->len + sizeof(msg_len), msgbuf, len);
+    buf->len += sizeof(msg_len) + len;
+    logsrvd_stats->messages_sent++;
+
+    debug_return_bool(true);
 }
 
 /*
@@ -209,15 +203,16 @@ fmt_client_message(struct connection_closure *closure, ClientMessage *msg)
     sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
 	"size + client message %zu bytes", len);
 
-    if ((buf = get_free_buf(len, closure)) == NULL) {
+    buf = get_write_buf(len, &relay_closure->write_bufs, closure);
+    if (buf == NULL) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unable to allocate connection_buffer");
         goto done;
     }
-    memcpy(buf->data, &msg_len, sizeof(msg_len));
-    client_message__pack(msg, buf->data + sizeof(msg_len));
-    buf->len = len;
-    TAILQ_INSERT_TAIL(&relay_closure->write_bufs, buf, entries);
+    memcpy(buf->data + buf->len, &msg_len, sizeof(msg_len));
+    client_message__pack(msg, buf->data + buf->len + sizeof(msg_len));
+    buf->len += len;
+    logsrvd_stats->messages_sent++;
 
     ret = true;
 
@@ -272,6 +267,7 @@ tls_connect_error_fn(struct tls_client_closure *tls_client)
     int res;
 
     /* TLS connection failed, try next relay (if any). */
+    logsrvd_queue_host_failed(closure->relay_closure->relay_host);
     while ((res = connect_relay_next(closure)) == -1) {
 	if (errno == ENOENT || errno == EINPROGRESS) {
 	    /* Out of relays or connecting asynchronously. */
@@ -338,11 +334,20 @@ connect_relay_next(struct connection_closure *closure)
     } else {
 	relay = TAILQ_FIRST(relay_closure->relays);
     }
+    if (closure->write_ev == NULL) {
+	/* Skip relays that are busy or backing off when relaying a journal. */
+	while (relay != NULL && !logsrvd_queue_host_ready(relay))
+	    relay = TAILQ_NEXT(relay, entries);
+    }
     if (relay == NULL) {
 	errno = ENOENT;
 	goto bad;
     }
     relay_closure->relay_addr = relay;
+    logsrvd_queue_host_release(relay_closure);
+    relay_closure->relay_host = logsrvd_queue_host_get(relay);
+    if (closure->write_ev == NULL)
+	logsrvd_queue_host_hold(relay_closure);
 
     sock = socket(relay->sa_un.sa.sa_family, SOCK_STREAM, 0);
     if (sock == -1) {
@@ -363,8 +368,12 @@ connect_relay_next(struct connection_closure *closure)
     }
 
     ret = connect(sock, &relay->sa_un.sa, relay->sa_size);
-    if (ret == -1 && errno != EINPROGRESS)
+    if (ret == -1 && errno != EINPROGRESS) {
+	int serrno = errno;
+	logsrvd_queue_host_failed(relay_closure->relay_host);
+	errno = serrno;
 	goto bad;
+    }
 
     switch (relay->sa_un.sa.sa_family) {
     case AF_INET:
@@ -478,6 +487,7 @@ connect_cb(int sock, int what, void *v)
 	    "unable to connect to relay %s (%s): %s",
 	    relay_closure->relay_name.name, relay_closure->relay_name.ipaddr,
 	    strerror(errnum));
+	logsrvd_queue_host_failed(relay_closure->relay_host);
 	while ((res = connect_relay_next(closure)) == -1) {
 	    if (errno == ENOENT || errno == EINPROGRESS) {
 		/* Out of relays or connecting asynchronously. */
@@ -549,6 +559,7 @@ handle_server_hello(const ServerHello *msg, struct connection_closure *closure)
     sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
 	"relay server %s (%s) ID %s", relay_closure->relay_name.name,
 	relay_closure->relay_name.ipaddr, msg->server_id);
+    logsrvd_queue_host_connected(relay_closure->relay_host);
 
     /* TODO: handle redirect */
 
@@ -693,14 +704,16 @@ static bool
 handle_server_message(const uint8_t *buf, size_t len,
     struct connection_closure *closure)
 {
+    struct relay_closure *relay_closure = closure->relay_closure;
     ServerMessage *msg;
     bool ret = false;
     debug_decl(handle_server_message, SUDO_DEBUG_UTIL);
 
     sudo_debug_printf(SUDO_DEBUG_INFO, "%s: unpacking ServerMessage", __func__);
-    msg = server_message__unpack(NULL, len, buf);
+    msg = server_message__unpack(&relay_closure->arena.allocator, len, buf);
     if (msg == NULL) {
 	sudo_warnx(U_("unable to unpack %s size %zu"), "ServerMessage", len);
+	logsrv_arena_reset(&relay_closure->arena);
 	debug_return_bool(false);
     }
 
@@ -726,12 +739,12 @@ handle_server_message(const uint8_t *buf, size_t len,
     default:
 	sudo_warnx(U_("unexpected type_case value %d in %s from %s"),
 	    msg->type_case, "ServerMessage",
-	    closure->relay_closure->relay_name.ipaddr);
+	    relay_closure->relay_name.ipaddr);
 	closure->errstr = _("unrecognized ServerMessage type");
 	break;
     }
 
-    server_message__free_unpacked(msg, NULL);
+    logsrv_arena_reset(&relay_closure->arena);
     debug_return_bool(ret);
 }
 
@@ -985,6 +998,7 @@ relay_client_msg_cb(int fd, int what, void *v)
 
 #if defined(HAVE_OPENSSL)
     if (relay_closure->tls_client.ssl != NULL) {
+	/* Queued messages are coalesced, so write one buffer at a time. */
 	SSL *ssl = relay_closure->tls_client.ssl;
         const int result = SSL_write_ex(ssl, buf->data + buf->off,
 	    buf->len - buf->off, &nwritten);
@@ -1037,38 +1051,30 @@ relay_client_msg_cb(int fd, int what, void *v)
     } else
 #endif
     {
-	const ssize_t n = write(fd, buf->data + buf->off, buf->len - buf->off);
+	struct iovec iov[WRITE_IOV_MAX];
+	const int iovcnt = fill_write_iov(&relay_closure->write_bufs, iov,
+	    WRITE_IOV_MAX);
+	const ssize_t n = writev(fd, iov, iovcnt);
 	if (n < 0) {
 	    if (errno == EAGAIN || errno == EINTR)
 		debug_return;
-	    sudo_warn("%s: write", relay_closure->relay_name.ipaddr);
+	    sudo_warn("%s: writev", relay_closure->relay_name.ipaddr);
 	    closure->errstr = _("error writing to relay");
 	    goto send_error;
 	}
 	nwritten = (size_t)n;
     }
-    if (nwritten > SIZE_MAX - buf->off) {
-	sudo_warnx(U_("internal error, %s overflow"), __func__);
+    if (!consume_write_bufs(&relay_closure->write_bufs, nwritten, closure)) {
 	closure->errstr = _("error writing to relay");
 	goto send_error;
     }
-    buf->off += nwritten;
 
-    if (buf->off == buf->len) {
-	/* sent entire message, move buf to free list */
-	sudo_debug_printf(SUDO_DEBUG_INFO,
-	    "%s: finished sending %zu bytes to server", __func__, buf->len);
-	buf->off = 0;
-	buf->len = 0;
-	TAILQ_REMOVE(&relay_closure->write_bufs, buf, entries);
-	TAILQ_INSERT_TAIL(&closure->free_bufs, buf, entries);
-	if (TAILQ_EMPTY(&relay_closure->write_bufs)) {
-	    /* Write queue empty, check state. */
-	    sudo_ev_del(closure->evbase, relay_closure->write_ev);
-	    if (closure->error || closure->state == FINISHED ||
-		    closure->state == SHUTDOWN)
-		goto close_connection;
-	}
+    if (TAILQ_EMPTY(&relay_closure->write_bufs)) {
+	/* Write queue empty, check state. */
+	sudo_ev_del(closure->evbase, relay_closure->write_ev);
+	if (closure->error || closure->state == FINISHED ||
+		closure->state == SHUTDOWN)
+	    goto close_connection;
     }
     debug_return;
 
@@ -0,0 +1,355 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <errno.h>
+#include <signal.h>
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include <compat/stdbool.h>
+#endif /* HAVE_STDBOOL_H */
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sudo_compat.h>
+#include <sudo_debug.h>
+#include <sudo_event.h>
+#include <sudo_eventlog.h>
+#include <sudo_fatal.h>
+#include <sudo_gettext.h>
+#include <sudo_iolog.h>
+#include <sudo_queue.h>
+#include <sudo_util.h>
+
+#include <logsrvd.h>
+
+#if !defined(MAP_ANON) && defined(MAP_ANONYMOUS)
+# define MAP_ANON MAP_ANONYMOUS
+#endif
+
+/* A worker that dies within this many seconds of starting is not restarted. */
+#define WORKER_MIN_LIFETIME	5
+
+/*
+ * When more than one worker is configured, the main process becomes
+ * a supervisor that forks the workers, restarts them if they crash
+ * and forwards signals to them.  Each worker runs its own event loop
+ * and accepts connections on its own SO_REUSEPORT listen sockets.
+ * Per-worker statistics are kept in memory shared with the supervisor.
+ */
+static struct logsrvd_stats single_stats;
+struct logsrvd_stats *logsrvd_stats = &single_stats;
+
+static struct logsrvd_stats *worker_stats;
+static unsigned int nworkers;
+static bool shutting_down;
+static logsrvd_worker_fn_t worker_fn;
+
+/*
+ * Set up shared statistics for n worker processes.
+ * Must be called before logsrvd_worker_start().
+ */
+bool
+logsrvd_worker_init(unsigned int n, logsrvd_worker_fn_t fn)
+{
+    void *ptr;
+    debug_decl(logsrvd_worker_init, SUDO_DEBUG_UTIL);
+
+#ifdef MAP_ANON
+    ptr = mmap(NULL, n * sizeof(*worker_stats), PROT_READ|PROT_WRITE,
+	MAP_SHARED|MAP_ANON, -1, 0);
+#else
+    ptr = MAP_FAILED;
+    errno = ENOTSUP;
+#endif
+    if (ptr == MAP_FAILED) {
+	sudo_warn("%s: mmap", __func__);
+	debug_return_bool(false);
+    }
+    worker_stats = ptr;
+    memset(worker_stats, 0, n * sizeof(*worker_stats));
+    nworkers = n;
+    worker_fn = fn;
+
+    debug_return_bool(true);
+}
+
+/*
+ * Returns true if this process supervises worker processes.
+ */
+bool
+logsrvd_worker_supervisor(void)
+{
+    return worker_stats != NULL && logsrvd_stats == &single_stats;
+}
+
+/*
+ * Fork worker process id.  The child frees the supervisor's event
+ * base, which also restores the default signal handlers, and then
+ * runs worker_fn(), which does not return.
+ */
+static bool
+worker_spawn(unsigned int id, struct sudo_event_base *evbase)
+{
+    struct logsrvd_stats *stats = &worker_stats[id];
+    sigset_t mask, omask;
+    pid_t pid;
+    debug_decl(worker_spawn, SUDO_DEBUG_UTIL);
+
+    /* Block signals until the worker has registered its own handlers. */
+    sigfillset(&mask);
+    sigprocmask(SIG_BLOCK, &mask, &omask);
+
+    switch (pid = sudo_debug_fork()) {
+    case -1:
+	sudo_warn("fork");
+	sigprocmask(SIG_SETMASK, &omask, NULL);
+	debug_return_bool(false);
+    case 0:
+	/* child */
+	sudo_ev_base_free(evbase);
+	logsrvd_stats = stats;
+	worker_fn(id, &omask);
+	/* NOTREACHED */
+	_exit(EXIT_FAILURE);
+    default:
+	break;
+    }
+    sigprocmask(SIG_SETMASK, &omask, NULL);
+
+    stats->pid = pid;
+    stats->started = time(NULL);
+    stats->active = 0;
+    sudo_debug_printf(SUDO_DEBUG_INFO, "started worker %u, pid %d",
+	id, (int)pid);
+
+    debug_return_bool(true);
+}
+
+/*
+ * Start all worker processes.
+ */
+bool
+logsrvd_worker_start(struct sudo_event_base *evbase)
+{
+    unsigned int id;
+    debug_decl(logsrvd_worker_start, SUDO_DEBUG_UTIL);
+
+    for (id = 0; id < nworkers; id++) {
+	if (!worker_spawn(id, evbase)) {
+	    logsrvd_worker_shutdown(evbase);
+	    debug_return_bool(false);
+	}
+    }
+
+    debug_return_bool(true);
+}
+
+/*
+ * Forward a signal to all running workers.
+ */
+void
+logsrvd_worker_signal(int signo)
+{
+    unsigned int id;
+    debug_decl(logsrvd_worker_signal, SUDO_DEBUG_UTIL);
+
+    for (id = 0; id < nworkers; id++) {
+	if (worker_stats[id].pid > 0)
+	    kill(worker_stats[id].pid, signo);
+    }
+
+    debug_return;
+}
+
+/*
+ * Tell the workers to finish their client connections and exit.
+ * The supervisor's event loop exits once all workers have been reaped.
+ */
+void
+logsrvd_worker_shutdown(struct sudo_event_base *evbase)
+{
+    unsigned int id;
+    debug_decl(logsrvd_worker_shutdown, SUDO_DEBUG_UTIL);
+
+    shutting_down = true;
+    logsrvd_worker_signal(SIGTERM);
+
+    for (id = 0; id < nworkers; id++) {
+	if (worker_stats[id].pid > 0)
+	    debug_return;
+    }
+    sudo_ev_loopbreak(evbase);
+
+    debug_return;
+}
+
+/*
+ * Reap exited workers in response to SIGCHLD, restarting any
+ * that were killed by a signal or exited with a non-zero status.
+ */
+void
+logsrvd_worker_reap(struct sudo_event_base *evbase)
+{
+    unsigned int id, running = 0;
+    int status;
+    pid_t pid;
+    debug_decl(logsrvd_worker_reap, SUDO_DEBUG_UTIL);
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) != 0) {
+	struct logsrvd_stats *stats = NULL;
+
+	if (pid == -1) {
+	    if (errno == EINTR)
+		continue;
+	    break;
+	}
+	for (id = 0; id < nworkers; id++) {
+	    if (worker_stats[id].pid == pid) {
+		stats = &worker_stats[id];
+		break;
+	    }
+	}
+	if (stats == NULL)
+	    continue;
+	stats->pid = 0;
+	stats->active = 0;
+
+	if (WIFSIGNALED(status)) {
+	    sudo_warnx(U_("worker %u (pid %d) killed by signal %d"), id,
+		(int)pid, WTERMSIG(status));
+	} else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+	    sudo_warnx(U_("worker %u (pid %d) exited with status %d"), id,
+		(int)pid, WEXITSTATUS(status));
+	} else {
+	    /* Normal exit, e.g. after SIGTERM. */
+	    continue;
+	}
+	if (shutting_down)
+	    continue;
+	if (time(NULL) - stats->started < WORKER_MIN_LIFETIME) {
+	    sudo_warnx(U_("worker %u exited too quickly, not restarting"), id);
+	    continue;
+	}
+	stats->restarts++;
+	(void)worker_spawn(id, evbase);
+    }
+
+    for (id = 0; id < nworkers; id++) {
+	if (worker_stats[id].pid > 0)
+	    running++;
+    }
+    if (running == 0) {
+	if (!shutting_down)
+	    sudo_warnx("%s", U_("no worker processes remain, exiting"));
+	sudo_ev_loopbreak(evbase);
+    }
+
+    debug_return;
+}
+
+/*
+ * Dump per-worker and aggregate statistics in response to SIGUSR1.
+ */
+void
+logsrvd_worker_dump(void)
+{
+    struct logsrvd_stats total;
+    unsigned int id;
+    debug_decl(logsrvd_worker_dump, SUDO_DEBUG_UTIL);
+
+    memset(&total, 0, sizeof(total));
+    sudo_debug_printf(SUDO_DEBUG_INFO, "worker processes:");
+    for (id = 0; id < nworkers; id++) {
+	const struct logsrvd_stats *stats = &worker_stats[id];
+
+	sudo_debug_printf(SUDO_DEBUG_INFO, "  %2u: pid %d, restarts %u", id,
+	    (int)stats->pid, stats->restarts);
+	logsrvd_stats_dump("      ", stats);
+	total.accepted += stats->accepted;
+	total.active += stats->active;
+	total.messages += stats->messages;
+	total.bytes += stats->bytes;
+	total.reads += stats->reads;
+	total.messages_sent += stats->messages_sent;
+	total.bytes_sent += stats->bytes_sent;
+	total.writes += stats->writes;
+	total.journal_syncs += stats->journal_syncs;
+	total.journals_synced += stats->journals_synced;
+    }
+    sudo_debug_printf(SUDO_DEBUG_INFO, "all workers:");
+    logsrvd_stats_dump("  ", &total);
+
+    debug_return;
+}
+
+/*
+ * Dump a single set of connection counters.
+ */
+void
+logsrvd_stats_dump(const char *prefix, const struct logsrvd_stats *stats)
+{
+    debug_decl(logsrvd_stats_dump, SUDO_DEBUG_UTIL);
+
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%sconnections accepted: %llu",
+	prefix, stats->accepted);
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%sconnections active: %llu",
+	prefix, stats->active);
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%sclient messages: %llu",
+	prefix, stats->messages);
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%sbytes received: %llu",
+	prefix, stats->bytes);
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%sreads: %llu", prefix, stats->reads);
+    if (stats->reads != 0) {
+	sudo_debug_printf(SUDO_DEBUG_INFO,
+	    "%s  %llu bytes, %llu messages per read", prefix,
+	    stats->bytes / stats->reads, stats->messages / stats->reads);
+    }
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%smessages sent: %llu",
+	prefix, stats->messages_sent);
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%sbytes sent: %llu",
+	prefix, stats->bytes_sent);
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%swrites: %llu", prefix, stats->writes);
+    if (stats->writes != 0) {
+	sudo_debug_printf(SUDO_DEBUG_INFO,
+	    "%s  %llu bytes, %llu messages per write", prefix,
+	    stats->bytes_sent / stats->writes,
+	    stats->messages_sent / stats->writes);
+    }
+    if (stats->journal_syncs != 0) {
+	sudo_debug_printf(SUDO_DEBUG_INFO,
+	    "%sjournal syncs: %llu, %llu journals per sync", prefix,
+	    stats->journal_syncs, stats->journals_synced / stats->journal_syncs);
+    }
+
+    debug_return;
+}
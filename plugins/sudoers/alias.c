@@ -50,7 +50,235 @@ alias_compare(const void *v1, const void *v2)
 }
 
 /*
- * Search the tree for an alias with the specified name and type.
+ * Open-addressing hash tables of aliases, one per alias type.
+ * The tables are built from the aliases red-black tree the first time
+ * an alias is looked up and are discarded when an alias is added or
+ * removed.  Lookups use linear probing and the alias name's hash value
+ * is stored alongside it to avoid most string comparisons.
+ */
+#define ALIAS_NTYPES	4
+
+struct alias_hash_table {
+    struct alias **slots;
+    unsigned int *hashes;
+    unsigned int mask;
+    unsigned int count;
+};
+
+struct alias_hash {
+    struct alias_hash_table tables[ALIAS_NTYPES];
+    bool acyclic[ALIAS_NTYPES];		/* no alias loops, memo is safe */
+    bool memo_active;
+    unsigned int memo_generation;
+};
+
+static int
+alias_type_index(short type)
+{
+    switch (type) {
+    case USERALIAS:
+	return 0;
+    case RUNASALIAS:
+	return 1;
+    case HOSTALIAS:
+	return 2;
+    case CMNDALIAS:
+	return 3;
+    default:
+	return -1;
+    }
+}
+
+/* FNV-1a hash of an alias name. */
+static unsigned int
+alias_hash_name(const char *name)
+{
+    unsigned int h = 2166136261U;
+
+    while (*name != '\0') {
+	h ^= (unsigned char)*name++;
+	h *= 16777619U;
+    }
+    return h;
+}
+
+/*
+ * Find the slot for name in table, which is either the slot holding
+ * the alias or the empty slot where it would be inserted.
+ */
+static unsigned int
+alias_hash_slot(const struct alias_hash_table *table, const char *name,
+    unsigned int h)
+{
+    unsigned int i = h & table->mask;
+
+    while (table->slots[i] != NULL) {
+	if (table->hashes[i] == h && strcmp(table->slots[i]->name, name) == 0)
+	    break;
+	i = (i + 1) & table->mask;
+    }
+    return i;
+}
+
+static int
+alias_hash_count(void *v1, void *v2)
+{
+    struct alias *a = v1;
+    struct alias_hash *hash = v2;
+    const int idx = alias_type_index(a->type);
+
+    if (idx != -1)
+	hash->tables[idx].count++;
+    return 0;
+}
+
+static int
+alias_hash_insert(void *v1, void *v2)
+{
+    struct alias *a = v1;
+    struct alias_hash *hash = v2;
+    const int idx = alias_type_index(a->type);
+    struct alias_hash_table *table;
+    unsigned int h, i;
+
+    if (idx != -1) {
+	table = &hash->tables[idx];
+	h = alias_hash_name(a->name);
+	i = alias_hash_slot(table, a->name, h);
+	table->slots[i] = a;
+	table->hashes[i] = h;
+    }
+    return 0;
+}
+
+/*
+ * Depth-first search for a loop starting at the alias in slot i.
+ * Colors are 0 (unvisited), 1 (in progress) and 2 (done).
+ * Returns true if a loop was found.
+ */
+static bool
+alias_hash_loop(const struct alias_hash_table *table, unsigned char *colors,
+    unsigned int i)
+{
+    struct member *m;
+    unsigned int j;
+
+    colors[i] = 1;
+    TAILQ_FOREACH(m, &table->slots[i]->members, entries) {
+	if (m->type != ALIAS)
+	    continue;
+	j = alias_hash_slot(table, m->name, alias_hash_name(m->name));
+	if (table->slots[j] == NULL || colors[j] == 2)
+	    continue;
+	if (colors[j] == 1 || alias_hash_loop(table, colors, j))
+	    return true;
+    }
+    colors[i] = 2;
+    return false;
+}
+
+/*
+ * Build the alias hash tables for parse_tree.
+ * Returns the new tables or NULL on error.
+ */
+static struct alias_hash *
+alias_hash_build(const struct sudoers_parse_tree *parse_tree)
+{
+    struct alias_hash *hash;
+    unsigned char *colors;
+    unsigned int i, size;
+    int idx;
+    debug_decl(alias_hash_build, SUDOERS_DEBUG_ALIAS);
+
+    if ((hash = calloc(1, sizeof(*hash))) == NULL)
+	goto oom;
+    rbapply(parse_tree->aliases, alias_hash_count, hash, inorder);
+
+    for (idx = 0; idx < ALIAS_NTYPES; idx++) {
+	struct alias_hash_table *table = &hash->tables[idx];
+
+	/* Keep the load factor at or below 50%. */
+	for (size = 8; size < table->count * 2; size *= 2)
+	    continue;
+	table->slots = calloc(size, sizeof(struct alias *));
+	table->hashes = calloc(size, sizeof(unsigned int));
+	if (table->slots == NULL || table->hashes == NULL)
+	    goto oom;
+	table->mask = size - 1;
+    }
+    rbapply(parse_tree->aliases, alias_hash_insert, hash, inorder);
+
+    /* Match results may only be reused if no alias refers to itself. */
+    for (idx = 0; idx < ALIAS_NTYPES; idx++) {
+	struct alias_hash_table *table = &hash->tables[idx];
+
+	hash->acyclic[idx] = true;
+	if ((colors = calloc(table->mask + 1, 1)) == NULL)
+	    goto oom;
+	for (i = 0; i <= table->mask; i++) {
+	    if (table->slots[i] != NULL && colors[i] == 0) {
+		if (alias_hash_loop(table, colors, i)) {
+		    hash->acyclic[idx] = false;
+		    break;
+		}
+	    }
+	}
+	free(colors);
+    }
+
+    debug_return_ptr(hash);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    if (hash != NULL) {
+	for (idx = 0; idx < ALIAS_NTYPES; idx++) {
+	    free(hash->tables[idx].slots);
+	    free(hash->tables[idx].hashes);
+	}
+	free(hash);
+    }
+    debug_return_ptr(NULL);
+}
+
+/*
+ * Free the alias hash tables for parse_tree, if any.
+ * They will be rebuilt on the next call to alias_get().
+ */
+void
+alias_hash_free(struct sudoers_parse_tree *parse_tree)
+{
+    struct alias_hash *hash = parse_tree->alias_hash;
+    int idx;
+    debug_decl(alias_hash_free, SUDOERS_DEBUG_ALIAS);
+
+    if (hash != NULL) {
+	for (idx = 0; idx < ALIAS_NTYPES; idx++) {
+	    free(hash->tables[idx].slots);
+	    free(hash->tables[idx].hashes);
+	}
+	free(hash);
+	parse_tree->alias_hash = NULL;
+    }
+
+    debug_return;
+}
+
+/*
+ * Return the alias hash tables for parse_tree, building them if needed.
+ * Returns NULL if there are no aliases or on allocation failure.
+ */
+static struct alias_hash *
+alias_hash_get(const struct sudoers_parse_tree *parse_tree)
+{
+    if (parse_tree->alias_hash == NULL && parse_tree->aliases != NULL) {
+	/* The tables are a cache, building them does not change the tree. */
+	((struct sudoers_parse_tree *)parse_tree)->alias_hash =
+	    alias_hash_build(parse_tree);
+    }
+    return parse_tree->alias_hash;
+}
+
+/*
+ * Search for an alias with the specified name and type.
  * Returns a pointer to the alias structure or NULL if not found.
  * Caller is responsible for calling alias_put() on the returned
  * alias to mark it as unused.
@@ -59,23 +287,33 @@ struct alias *
 alias_get(const struct sudoers_parse_tree *parse_tree, const char *name,
     short type)
 {
+    struct alias_hash *hash;
     struct alias key;
     struct rbnode *node;
     struct alias *a = NULL;
+    int idx;
     debug_decl(alias_get, SUDOERS_DEBUG_ALIAS);
 
     if (parse_tree->aliases == NULL)
 	debug_return_ptr(NULL);
 
-    key.name = (char *)name;
-    key.type = type;
-    if ((node = rbfind(parse_tree->aliases, &key)) != NULL) {
+    hash = alias_hash_get(parse_tree);
+    if (hash != NULL && (idx = alias_type_index(type)) != -1) {
+	const struct alias_hash_table *table = &hash->tables[idx];
+	a = table->slots[alias_hash_slot(table, name, alias_hash_name(name))];
+    } else {
+	/* Fall back on the red-black tree. */
+	key.name = (char *)name;
+	key.type = type;
+	if ((node = rbfind(parse_tree->aliases, &key)) != NULL)
+	    a = node->data;
+    }
+    if (a != NULL) {
 	/*
 	 * Check whether this alias is already in use.
 	 * If so, we've detected a loop.  If not, set the flag,
 	 * which the caller should clear with a call to alias_put().
 	 */
-	a = node->data;
 	if (a->used) {
 	    errno = ELOOP;
 	    debug_return_ptr(NULL);
@@ -87,6 +325,102 @@ alias_get(const struct sudoers_parse_tree *parse_tree, const char *name,
     debug_return_ptr(a);
 }
 
+/*
+ * Start memoizing alias match results for parse_tree.
+ * Results stored by alias_memo_set() are only returned by
+ * alias_memo_get() until the next call to alias_memo_end().
+ */
+void
+alias_memo_begin(const struct sudoers_parse_tree *parse_tree)
+{
+    struct alias_hash *hash = alias_hash_get(parse_tree);
+    debug_decl(alias_memo_begin, SUDOERS_DEBUG_ALIAS);
+
+    if (hash != NULL) {
+	if (++hash->memo_generation == 0) {
+	    /* Generation wrapped, forget old results. */
+	    int idx;
+	    unsigned int i;
+
+	    for (idx = 0; idx < ALIAS_NTYPES; idx++) {
+		const struct alias_hash_table *table = &hash->tables[idx];
+		for (i = 0; i <= table->mask; i++) {
+		    if (table->slots[i] != NULL)
+			table->slots[i]->memo.generation = 0;
+		}
+	    }
+	    hash->memo_generation = 1;
+	}
+	hash->memo_active = true;
+    }
+
+    debug_return;
+}
+
+/*
+ * Stop memoizing alias match results for parse_tree.
+ */
+void
+alias_memo_end(const struct sudoers_parse_tree *parse_tree)
+{
+    debug_decl(alias_memo_end, SUDOERS_DEBUG_ALIAS);
+
+    if (parse_tree->alias_hash != NULL)
+	parse_tree->alias_hash->memo_active = false;
+
+    debug_return;
+}
+
+/*
+ * Look up the memoized match result for alias a, which is only valid
+ * if it was stored during the current lookup with the same keys.
+ * Returns true and fills in result if found, else false.
+ */
+bool
+alias_memo_get(const struct sudoers_parse_tree *parse_tree,
+    const struct alias *a, const void *key1, const void *key2,
+    const void *key3, int *result)
+{
+    const struct alias_hash *hash = parse_tree->alias_hash;
+    debug_decl(alias_memo_get, SUDOERS_DEBUG_ALIAS);
+
+    if (hash == NULL || !hash->memo_active)
+	debug_return_bool(false);
+    if (a->memo.generation != hash->memo_generation ||
+	    a->memo.key[0] != key1 || a->memo.key[1] != key2 ||
+	    a->memo.key[2] != key3)
+	debug_return_bool(false);
+
+    *result = a->memo.result;
+    debug_return_bool(true);
+}
+
+/*
+ * Store the match result for alias a for the rest of the current lookup.
+ * Nothing is stored if there are alias loops of the same type, since
+ * the result could then depend on where the alias was referenced from.
+ */
+void
+alias_memo_set(const struct sudoers_parse_tree *parse_tree, struct alias *a,
+    const void *key1, const void *key2, const void *key3, int result)
+{
+    const struct alias_hash *hash = parse_tree->alias_hash;
+    const int idx = alias_type_index(a->type);
+    debug_decl(alias_memo_set, SUDOERS_DEBUG_ALIAS);
+
+    if (hash == NULL || !hash->memo_active || idx == -1 ||
+	    !hash->acyclic[idx])
+	debug_return;
+
+    a->memo.generation = hash->memo_generation;
+    a->memo.key[0] = key1;
+    a->memo.key[1] = key2;
+    a->memo.key[2] = key3;
+    a->memo.result = result;
+
+    debug_return;
+}
+
 /*
  * Clear the "used" flag in an alias once the caller is done with it.
  */
@@ -115,6 +449,7 @@ alias_add(struct sudoers_parse_tree *parse_tree, char *name,
 	if ((parse_tree->aliases = alloc_aliases()) == NULL)
 	    debug_return_bool(false);
     }
+    alias_hash_free(parse_tree);
 
     a = calloc(1, sizeof(*a));
     if (a == NULL)
@@ -231,8 +566,10 @@ alias_remove(struct sudoers_parse_tree *parse_tree, const char *name,
     if (parse_tree->aliases != NULL) {
 	key.name = (char *)name;
 	key.type = type;
-	if ((node = rbfind(parse_tree->aliases, &key)) != NULL)
+	if ((node = rbfind(parse_tree->aliases, &key)) != NULL) {
+	    alias_hash_free(parse_tree);
 	    debug_return_ptr(rbdelete(parse_tree->aliases, node));
+	}
     }
     errno = ENOENT;
     debug_return_ptr(NULL);
@@ -1394,6 +1394,7 @@ alias_remove_unused(struct sudoers_parse_tree *parse_tree)
     /* Only unreferenced aliases are left, swap and free the unused ones. */
     free_aliases(parse_tree->aliases);
     parse_tree->aliases = used_aliases;
+    alias_hash_free(parse_tree);
 
     debug_return;
 }
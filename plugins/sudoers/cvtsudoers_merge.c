@@ -569,6 +569,7 @@ alias_rename(const char *old_name, char *new_name, short alias_type,
 	a->file, a->line, a->column, a->name, new_name);
     free(a->name);
     a->name = new_name;
+    alias_hash_free(parse_tree);
     switch (rbinsert(parse_tree->aliases, a, NULL)) {
     case 0:
 	/* success */
@@ -646,6 +647,7 @@ alias_resolve_conflicts(struct sudoers_parse_tree *parse_tree0, struct alias *a,
      * This is not a problem as the caller will delete the old trees
      * (without freeing the data).
      */
+    alias_hash_free(merged_tree);
     ret = rbinsert(merged_tree->aliases, a, NULL);
     switch (ret) {
     case 0:
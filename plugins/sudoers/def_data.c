@@ -49,6 +49,7 @@ static struct def_values def_data_log_format[] = {
 static struct def_values def_data_intercept_type[] = {
     { "dso", dso },
     { "trace", trace },
+    { "seccomp", seccomp },
     { NULL, 0 },
 };
 
@@ -705,7 +706,60 @@ struct sudo_defs_types sudo_defs_table[] = {
 	"cmddenial_message", T_STR,
 	N_("Command denial message: %s"),
 	NULL,
+    }, {
+	"iolog_async", T_FLAG,
+	N_("Write I/O log files from a separate process"),
+	NULL,
+    }, {
+	"iolog_flush_delay", T_UINT,
+	N_("Maximum delay in milliseconds before asynchronously written I/O log data is flushed: %u"),
+	NULL,
+    }, {
+	"iolog_compress_type", T_STR,
+	N_("Compression method used for I/O logs: %s"),
+	NULL,
+    }, {
+	"iolog_index", T_FLAG,
+	N_("Write a time index alongside I/O logs for fast seeking"),
+	NULL,
+    }, {
+	"iolog_catalog", T_FLAG,
+	N_("Add I/O log sessions to a catalog used by sudoreplay to list sessions"),
+	NULL,
+    }, {
+	"intercept_cache_timeout", T_TIMEOUT|T_BOOL,
+	N_("Time in seconds that policy decisions for intercepted commands are cached: %u"),
+	NULL,
+    }, {
+	"digest_cache_dir", T_STR|T_BOOL|T_PATH,
+	N_("Directory used to cache command digests: %s"),
+	NULL,
     }, {
 	NULL, 0, NULL
     }
 };
+
+const unsigned int sudo_defs_hash_disp[DEF_HASH_BUCKETS] = {
+    0, 2, 0, 2, 5, 1, 9, 2, 6, 4, 1, 2, 2, 15, 8, 3, 0, 8, 1, 1, 0, 2, 2, 0,
+    10, 3, 0, 1, 0, 1, 0, 3, 0, 3, 8, 7, 0, 0, 3, 4, 15, 0, 11, 21, 1, 0, 8,
+    2, 0, 0, 1, 0, 1, 0, 0, 5, 1, 0, 1, 0, 4, 6, 0, 8
+};
+
+const short sudo_defs_hash_index[DEF_HASH_SIZE] = {
+    157, -1, 6, 118, -1, 61, -1, 52, 28, 120, 130, 45, -1, -1, 150, 110,
+    163, 96, 46, -1, 15, 133, -1, -1, 56, 69, -1, -1, -1, 140, -1, -1, -1,
+    -1, 82, 126, 153, 13, 137, 165, 64, 111, -1, 139, 67, 121, 151, 102,
+    105, 161, 80, 71, 10, 16, -1, -1, 124, -1, 57, 25, 14, 66, 3, 18, 92,
+    86, 109, 138, -1, -1, -1, 95, 122, 93, 30, -1, 21, 146, 58, 144, 103,
+    70, -1, 31, -1, 4, -1, 11, 148, 90, 128, 77, -1, -1, 129, 127, -1, 135,
+    -1, -1, 91, 94, 166, 54, 168, 112, 167, 108, 75, -1, -1, -1, -1, -1, -1,
+    -1, -1, 50, 65, 51, 72, 73, 63, -1, -1, -1, -1, -1, 119, 2, 8, 158, 48,
+    -1, 104, -1, 12, -1, 53, -1, 145, 101, -1, 154, -1, -1, 159, -1, 160,
+    116, 22, -1, -1, 100, 19, 34, 39, 169, -1, 132, 40, 47, 23, 29, -1, 7,
+    -1, -1, -1, -1, 60, 74, 131, 81, 99, 36, 141, -1, -1, 83, 41, -1, 88,
+    117, 0, 123, 59, 113, 62, 125, 68, 152, 98, 26, 78, 5, 43, 114, 76, 149,
+    115, 33, 79, 17, 107, 162, 142, 1, -1, -1, -1, -1, -1, -1, -1, 97, 44,
+    27, 49, 136, 55, 106, -1, -1, 42, 20, -1, 35, -1, -1, 147, 9, -1, -1,
+    -1, 155, 164, 32, 143, -1, -1, 89, -1, 24, 134, 156, -1, -1, 37, -1, 85,
+    87, -1, 38, 84, -1
+};
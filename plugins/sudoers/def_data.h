@@ -326,6 +326,26 @@
 #define def_apparmor_profile    (sudo_defs_table[I_APPARMOR_PROFILE].sd_un.str)
 #define I_CMDDENIAL_MESSAGE     162
 #define def_cmddenial_message   (sudo_defs_table[I_CMDDENIAL_MESSAGE].sd_un.str)
+#define I_IOLOG_ASYNC           163
+#define def_iolog_async         (sudo_defs_table[I_IOLOG_ASYNC].sd_un.flag)
+#define I_IOLOG_FLUSH_DELAY     164
+#define def_iolog_flush_delay   (sudo_defs_table[I_IOLOG_FLUSH_DELAY].sd_un.uival)
+#define I_IOLOG_COMPRESS_TYPE   165
+#define def_iolog_compress_type (sudo_defs_table[I_IOLOG_COMPRESS_TYPE].sd_un.str)
+#define I_IOLOG_INDEX           166
+#define def_iolog_index         (sudo_defs_table[I_IOLOG_INDEX].sd_un.flag)
+#define I_IOLOG_CATALOG         167
+#define def_iolog_catalog       (sudo_defs_table[I_IOLOG_CATALOG].sd_un.flag)
+#define I_INTERCEPT_CACHE_TIMEOUT 168
+#define def_intercept_cache_timeout (sudo_defs_table[I_INTERCEPT_CACHE_TIMEOUT].sd_un.ival)
+#define I_DIGEST_CACHE_DIR      169
+#define def_digest_cache_dir    (sudo_defs_table[I_DIGEST_CACHE_DIR].sd_un.str)
+
+#define DEF_HASH_SIZE           256
+#define DEF_HASH_BUCKETS        64
+#define DEF_HASH_PRIME          16777213
+#define DEF_HASH_MULT1          31
+#define DEF_HASH_MULT2          37
 
 enum def_tuple {
     never,
@@ -343,5 +363,6 @@ enum def_tuple {
     json_compact,
     json_pretty,
     dso,
-    trace
+    trace,
+    seccomp
 };
@@ -52,6 +52,12 @@ static struct early_default early_defaults[] = {
     { -1 }
 };
 
+/*
+ * If set, called for each Defaults entry that update_defaults() applies.
+ * The policy daemon uses this to record the entries sent to clients.
+ */
+bool (*update_defaults_hook)(const struct defaults *d);
+
 /*
  * Local prototypes.
  */
@@ -184,6 +190,50 @@ defaults_warnx(const struct sudoers_context *ctx, const char *file, int line,
     debug_return_bool(ret);
 }
 
+/*
+ * Look up the specified Defaults name in sudo_defs_table[] using the
+ * perfect hash generated by mkdefaults.  Unlike find_default(), does
+ * not warn about unknown names.
+ * Returns the matching index or -1 if there is no such entry.
+ */
+int
+sudo_defs_index(const char *name)
+{
+    const unsigned char *cp = (const unsigned char *)name;
+    unsigned int h1 = 0, h2 = 0, disp, pos;
+    int idx;
+    debug_decl(sudo_defs_index, SUDOERS_DEBUG_DEFAULTS);
+
+    while (*cp != '\0') {
+	h1 = (h1 * DEF_HASH_MULT1 + *cp) % DEF_HASH_PRIME;
+	h2 = (h2 * DEF_HASH_MULT2 + *cp) % DEF_HASH_PRIME;
+	cp++;
+    }
+    disp = sudo_defs_hash_disp[(h1 / DEF_HASH_SIZE) % DEF_HASH_BUCKETS];
+    pos = (h1 % DEF_HASH_SIZE + disp % DEF_HASH_SIZE +
+	(disp / DEF_HASH_SIZE) * ((h2 % DEF_HASH_SIZE) | 1)) % DEF_HASH_SIZE;
+    idx = sudo_defs_hash_index[pos];
+    if (idx != -1 && strcmp(name, sudo_defs_table[idx].name) != 0)
+	idx = -1;
+    debug_return_int(idx);
+}
+
+/*
+ * Warn about an unknown Defaults name unless ignore_unknown_defaults is set.
+ */
+static void
+unknown_default(const struct sudoers_context *ctx, const char *name,
+    const char *file, int line, int column, bool quiet)
+{
+    debug_decl(unknown_default, SUDOERS_DEBUG_DEFAULTS);
+
+    if (!def_ignore_unknown_defaults) {
+	defaults_warnx(ctx, file, line, column, quiet,
+	    N_("unknown defaults entry \"%s\""), name);
+    }
+    debug_return;
+}
+
 /*
  * Find the index of the specified Defaults name in sudo_defs_table[]
  * On success, returns the matching index or -1 on failure.
@@ -192,18 +242,29 @@ static int
 find_default(const struct sudoers_context *ctx, const char *name,
     const char *file, int line, int column, bool quiet)
 {
-    int i;
+    int idx;
     debug_decl(find_default, SUDOERS_DEBUG_DEFAULTS);
 
-    for (i = 0; sudo_defs_table[i].name != NULL; i++) {
-	if (strcmp(name, sudo_defs_table[i].name) == 0)
-	    debug_return_int(i);
-    }
-    if (!def_ignore_unknown_defaults) {
-	defaults_warnx(ctx, file, line, column, quiet,
-	    N_("unknown defaults entry \"%s\""), name);
+    idx = sudo_defs_index(name);
+    if (idx == -1)
+	unknown_default(ctx, name, file, line, column, quiet);
+    debug_return_int(idx);
+}
+
+/*
+ * Like find_default() but uses the index resolved when the parsed
+ * Defaults entry was created.
+ */
+static int
+defaults_entry_index(const struct sudoers_context *ctx,
+    const struct defaults *d, bool quiet)
+{
+    debug_decl(defaults_entry_index, SUDOERS_DEBUG_DEFAULTS);
+
+    if (d->idx == -1) {
+	unknown_default(ctx, d->var, d->file, d->line, d->column, quiet);
     }
-    debug_return_int(-1);
+    debug_return_int(d->idx);
 }
 
 /*
@@ -327,14 +388,16 @@ parse_default_entry(const struct sudoers_context *ctx,
 }
 
 static struct early_default *
-is_early_default(const char *name)
+is_early_default(int idx)
 {
     struct early_default *early;
     debug_decl(is_early_default, SUDOERS_DEBUG_DEFAULTS);
 
-    for (early = early_defaults; early->idx != -1; early++) {
-	if (strcmp(name, sudo_defs_table[early->idx].name) == 0)
-	    debug_return_ptr(early);
+    if (idx != -1) {
+	for (early = early_defaults; early->idx != -1; early++) {
+	    if (early->idx == idx)
+		debug_return_ptr(early);
+	}
     }
     debug_return_ptr(NULL);
 }
@@ -350,6 +413,23 @@ run_callback(struct sudoers_context *ctx, const char *file, int line,
     debug_return_bool(def->callback(ctx, file, line, column, &def->sd_un, op));
 }
 
+/*
+ * Sets/clears the entry at the specified index in the defaults structure.
+ * Runs the callback if present on success.
+ */
+static bool
+set_default_idx(struct sudoers_context *ctx, int idx, const char *val,
+    int op, const char *file, int line, int column, bool quiet)
+{
+    /* Set parsed value in sudo_defs_table and run callback (if any). */
+    struct sudo_defs_types *def = &sudo_defs_table[idx];
+    debug_decl(set_default_idx, SUDOERS_DEBUG_DEFAULTS);
+
+    if (parse_default_entry(ctx, def, val, op, file, line, column, quiet))
+	debug_return_bool(run_callback(ctx, file, line, column, def, op));
+    debug_return_bool(false);
+}
+
 /*
  * Sets/clears an entry in the defaults structure.
  * Runs the callback if present on success.
@@ -366,39 +446,33 @@ set_default(struct sudoers_context *ctx, const char *var, const char *val,
 
     idx = find_default(ctx, var, file, line, column, quiet);
     if (idx != -1) {
-	/* Set parsed value in sudo_defs_table and run callback (if any). */
-	struct sudo_defs_types *def = &sudo_defs_table[idx];
-	if (parse_default_entry(ctx, def, val, op, file, line, column, quiet))
-	    debug_return_bool(run_callback(ctx, file, line, column, def, op));
+	debug_return_bool(set_default_idx(ctx, idx, val, op, file, line,
+	    column, quiet));
     }
     debug_return_bool(false);
 }
 
 /*
- * Like set_default() but stores the matching default value
+ * Like set_default_idx() but stores the matching default value
  * and does not run callbacks.
  */
 static bool
-set_early_default(const struct sudoers_context *ctx, const char *var,
+set_early_default(const struct sudoers_context *ctx, int idx,
     const char *val, int op, const char *file, int line, int column,
     bool quiet, struct early_default *early)
 {
-    int idx;
+    /* Set parsed value in sudo_defs_table but defer callback (if any). */
+    struct sudo_defs_types *def = &sudo_defs_table[idx];
     debug_decl(set_early_default, SUDOERS_DEBUG_DEFAULTS);
 
-    idx = find_default(ctx, var, file, line, column, quiet);
-    if (idx != -1) {
-	/* Set parsed value in sudo_defs_table but defer callback (if any). */
-	struct sudo_defs_types *def = &sudo_defs_table[idx];
-	if (parse_default_entry(ctx, def, val, op, file, line, column, quiet)) {
-	    if (early->file != NULL)
-		sudo_rcstr_delref(early->file);
-	    early->file = sudo_rcstr_addref(file);
-	    early->line = line;
-	    early->column = column;
-	    early->run_callback = true;
-	    debug_return_bool(true);
-	}
+    if (parse_default_entry(ctx, def, val, op, file, line, column, quiet)) {
+	if (early->file != NULL)
+	    sudo_rcstr_delref(early->file);
+	early->file = sudo_rcstr_addref(file);
+	early->line = line;
+	early->column = column;
+	early->run_callback = true;
+	debug_return_bool(true);
     }
     debug_return_bool(false);
 }
@@ -783,7 +857,7 @@ update_defaults(struct sudoers_context *ctx,
      */
     if (global_defaults) {
 	TAILQ_FOREACH(d, defs, entries) {
-	    struct early_default *early = is_early_default(d->var);
+	    struct early_default *early = is_early_default(d->idx);
 	    if (early == NULL)
 		continue;
 
@@ -793,8 +867,10 @@ update_defaults(struct sudoers_context *ctx,
 		continue;
 
 	    /* Copy the value to sudo_defs_table and mark as early. */
-	    if (!set_early_default(ctx, d->var, d->val, d->op, d->file, d->line,
-		d->column, quiet, early))
+	    if (!set_early_default(ctx, d->idx, d->val, d->op, d->file,
+		d->line, d->column, quiet, early))
+		ret = false;
+	    else if (update_defaults_hook != NULL && !update_defaults_hook(d))
 		ret = false;
 	}
 
@@ -809,7 +885,7 @@ update_defaults(struct sudoers_context *ctx,
     TAILQ_FOREACH(d, defs, entries) {
 	if (global_defaults) {
 	    /* Skip Defaults marked as early, we already did them. */
-	    if (is_early_default(d->var))
+	    if (is_early_default(d->idx))
 		continue;
 	}
 
@@ -819,7 +895,11 @@ update_defaults(struct sudoers_context *ctx,
 	    continue;
 
 	/* Copy the value to sudo_defs_table and run callback (if any) */
-	if (!set_default(ctx, d->var, d->val, d->op, d->file, d->line, d->column, quiet))
+	if (defaults_entry_index(ctx, d, quiet) == -1 ||
+		!set_default_idx(ctx, d->idx, d->val, d->op, d->file, d->line,
+		d->column, quiet))
+	    ret = false;
+	else if (update_defaults_hook != NULL && !update_defaults_hook(d))
 	    ret = false;
     }
 
@@ -838,8 +918,7 @@ check_defaults(const struct sudoers_parse_tree *parse_tree, bool quiet)
     debug_decl(check_defaults, SUDOERS_DEBUG_DEFAULTS);
 
     TAILQ_FOREACH(d, &parse_tree->defaults, entries) {
-	idx = find_default(parse_tree->ctx, d->var, d->file, d->line,
-	    d->column, quiet);
+	idx = defaults_entry_index(parse_tree->ctx, d, quiet);
 	if (idx != -1) {
 	    struct sudo_defs_types def = sudo_defs_table[idx];
 	    memset(&def.sd_un, 0, sizeof(def.sd_un));
@@ -855,6 +934,22 @@ check_defaults(const struct sudoers_parse_tree *parse_tree, bool quiet)
     debug_return_bool(ret);
 }
 
+/*
+ * Check whether the parse tree contains any command-specific Defaults.
+ */
+bool
+has_cmnd_defaults(const struct sudoers_parse_tree *parse_tree)
+{
+    const struct defaults *d;
+    debug_decl(has_cmnd_defaults, SUDOERS_DEBUG_DEFAULTS);
+
+    TAILQ_FOREACH(d, &parse_tree->defaults, entries) {
+	if (d->type == DEFAULTS_CMND)
+	    debug_return_bool(true);
+    }
+    debug_return_bool(false);
+}
+
 static bool
 store_int(const char *str, struct sudo_defs_types *def)
 {
@@ -1266,6 +1361,7 @@ append_default(const char *var, const char *val, int op,
     if ((def->var = strdup(var)) == NULL) {
 	goto oom;
     }
+    def->idx = sudo_defs_index(var);
     if (val != NULL) {
 	if ((def->val = strdup(val)) == NULL)
 	    goto oom;
@@ -142,6 +142,7 @@ struct early_default {
 /*
  * Prototypes
  */
+struct defaults;
 struct defaults_list;
 struct sudoers_parse_tree;
 void dump_default(void);
@@ -149,9 +150,14 @@ bool init_defaults(void);
 bool set_default(struct sudoers_context *ctx, const char *var, const char *val, int op, const char *file, int line, int column, bool quiet);
 bool update_defaults(struct sudoers_context *ctx, struct sudoers_parse_tree *parse_tree, const struct defaults_list *defs, int what, bool quiet);
 bool check_defaults(const struct sudoers_parse_tree *parse_tree, bool quiet);
+bool has_cmnd_defaults(const struct sudoers_parse_tree *parse_tree);
 bool append_default(const char *var, const char *val, int op, char *source, struct defaults_list *defs);
+int sudo_defs_index(const char *name);
 bool cb_passprompt_regex(struct sudoers_context *ctx, const char *file, int line, int column, const union sudo_defs_val *sd_un, int op);
 
 extern struct sudo_defs_types sudo_defs_table[];
+extern bool (*update_defaults_hook)(const struct defaults *d);
+extern const unsigned int sudo_defs_hash_disp[];
+extern const short sudo_defs_hash_index[];
 
 #endif /* SUDOERS_DEFAULTS_H */
@@ -0,0 +1,383 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Cache of command digests.
+ *
+ * Each entry lives in its own file in the digest_cache_dir directory,
+ * named after the device, inode and digest type of the command.  An
+ * entry is only used if the command still has the same device, inode,
+ * size, modification and change times as when the entry was written.
+ * Because the change time cannot be set by the user, any write to the
+ * command invalidates the entry.  Files changed in the last few seconds
+ * are not cached since a subsequent write could leave the times as-is.
+ *
+ * If the command has fs-verity enabled, its contents cannot change
+ * and the fs-verity measurement is used to validate the entry instead.
+ */
+
+#include <config.h>
+
+#include <sys/stat.h>
+#ifdef HAVE_LINUX_FSVERITY_H
+# include <sys/ioctl.h>
+# include <linux/fsverity.h>
+#endif
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <sudoers.h>
+#include <sudo_digest.h>
+
+#define DIGEST_CACHE_MAGIC	"SUDODGST"
+#define DIGEST_CACHE_VERSION	1
+
+/* Largest supported digest (SHA-512) and fs-verity measurement. */
+#define DIGEST_CACHE_MAXLEN	64
+
+/* Files changed more recently than this (in seconds) are not cached. */
+#define DIGEST_CACHE_SETTLE	2
+
+struct digest_cache_entry {
+    char magic[8];		/* DIGEST_CACHE_MAGIC */
+    uint32_t version;		/* DIGEST_CACHE_VERSION */
+    uint32_t digest_type;	/* SUDO_DIGEST_XXX */
+    uint32_t digest_len;	/* length of digest */
+    uint32_t verity_len;	/* length of verity, 0 if not fs-verity */
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t ctime_sec;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    unsigned char digest[DIGEST_CACHE_MAXLEN];
+    unsigned char verity[DIGEST_CACHE_MAXLEN];
+};
+
+/*
+ * Open the digest cache directory, creating it if needed.
+ * The directory must be owned by the effective uid and not be
+ * writable by group or other.
+ * Returns an fd usable with the *at() functions on success, else -1.
+ */
+static int
+digest_cache_opendir(const char *path)
+{
+    const uid_t uid = geteuid();
+    const gid_t gid = getegid();
+    int error, fd, parentfd;
+    struct stat sb;
+    mode_t omask;
+    debug_decl(digest_cache_opendir, SUDOERS_DEBUG_UTIL);
+
+    fd = sudo_secure_open_dir(path, uid, (gid_t)-1, &sb, &error);
+    if (fd != -1)
+	debug_return_int(fd);
+
+    switch (error) {
+    case SUDO_PATH_MISSING:
+	omask = umask(ACCESSPERMS & ~(S_IRWXU|S_IXGRP|S_IXOTH));
+	parentfd = sudo_open_parent_dir(path, uid, gid,
+	    S_IRWXU|S_IXGRP|S_IXOTH, true);
+	if (parentfd != -1) {
+	    const char *base = sudo_basename(path);
+	    if (mkdirat(parentfd, base, S_IRWXU) == 0 || errno == EEXIST) {
+		fd = openat(parentfd, base,
+		    O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_NOFOLLOW);
+		if (fd != -1 && (fstat(fd, &sb) != 0 || sb.st_uid != uid ||
+			ISSET(sb.st_mode, S_IWGRP|S_IWOTH))) {
+		    close(fd);
+		    fd = -1;
+		}
+	    }
+	    close(parentfd);
+	}
+	umask(omask);
+	if (fd == -1) {
+	    sudo_debug_printf(
+		SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+		"unable to create %s", path);
+	}
+	break;
+    case SUDO_PATH_BAD_TYPE:
+	errno = ENOTDIR;
+	sudo_warn("%s", path);
+	break;
+    case SUDO_PATH_WRONG_OWNER:
+	sudo_warnx(U_("%s is owned by uid %u, should be %u"),
+	    path, (unsigned int)sb.st_uid, (unsigned int)uid);
+	break;
+    case SUDO_PATH_WORLD_WRITABLE:
+	sudo_warnx(U_("%s is world writable"), path);
+	break;
+    case SUDO_PATH_GROUP_WRITABLE:
+	sudo_warnx(U_("%s is group writable"), path);
+	break;
+    default:
+	sudo_warnx("%s: internal error, unexpected error %d",
+	    __func__, error);
+	break;
+    }
+
+    debug_return_int(fd);
+}
+
+/*
+ * Store the fs-verity measurement of fd in verity.
+ * Returns the length of the measurement, or 0 if the file does
+ * not have fs-verity enabled.
+ */
+static size_t
+digest_cache_measure(int fd, unsigned char *verity, size_t size)
+{
+#if defined(HAVE_LINUX_FSVERITY_H) && defined(FS_IOC_MEASURE_VERITY)
+    union {
+	struct fsverity_digest d;
+	unsigned char buf[sizeof(struct fsverity_digest) + DIGEST_CACHE_MAXLEN];
+    } u;
+    size_t len;
+    debug_decl(digest_cache_measure, SUDOERS_DEBUG_UTIL);
+
+    u.d.digest_size = DIGEST_CACHE_MAXLEN;
+    if (ioctl(fd, FS_IOC_MEASURE_VERITY, &u.d) == -1) {
+	/* ENODATA means fs-verity is supported but not enabled. */
+	if (errno != ENODATA && errno != ENOTTY && errno != EOPNOTSUPP) {
+	    sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_ERRNO,
+		"unable to measure fs-verity digest");
+	}
+	debug_return_size_t(0);
+    }
+    len = u.d.digest_size;
+    if (len == 0 || len > size - 2) {
+	debug_return_size_t(0);
+    }
+
+    /* Include the algorithm so a measurement can't match another type. */
+    verity[0] = (unsigned char)(u.d.digest_algorithm >> 8);
+    verity[1] = (unsigned char)(u.d.digest_algorithm & 0xff);
+    memcpy(verity + 2, u.d.digest, len);
+    debug_return_size_t(len + 2);
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Fill in the part of a cache entry that identifies the file.
+ */
+static void
+digest_cache_fill(struct digest_cache_entry *entry, const struct stat *sb,
+    unsigned int digest_type, size_t digest_len,
+    const unsigned char *verity, size_t verity_len)
+{
+    struct timespec mtime;
+
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->magic, DIGEST_CACHE_MAGIC, sizeof(entry->magic));
+    entry->version = DIGEST_CACHE_VERSION;
+    entry->digest_type = digest_type;
+    entry->digest_len = (uint32_t)digest_len;
+    entry->dev = (uint64_t)sb->st_dev;
+    entry->ino = (uint64_t)sb->st_ino;
+    entry->size = (int64_t)sb->st_size;
+    entry->verity_len = (uint32_t)verity_len;
+    if (verity_len != 0) {
+	/* Contents are immutable, the measurement is sufficient. */
+	memcpy(entry->verity, verity, verity_len);
+    } else {
+	mtim_get(sb, mtime);
+	entry->ctime_sec = (int64_t)sb->st_ctime;
+	entry->mtime_sec = (int64_t)mtime.tv_sec;
+	entry->mtime_nsec = (int64_t)mtime.tv_nsec;
+    }
+}
+
+/*
+ * Read the cache entry name from dfd and check that it matches key.
+ * On success, the cached digest is copied to digest.
+ * Returns true if a matching entry was found, else false.
+ */
+static bool
+digest_cache_read(int dfd, const char *name,
+    const struct digest_cache_entry *key, unsigned char *digest)
+{
+    struct digest_cache_entry entry;
+    struct stat sb;
+    bool ret = false;
+    ssize_t nread;
+    int fd;
+    debug_decl(digest_cache_read, SUDOERS_DEBUG_UTIL);
+
+    fd = openat(dfd, name, O_RDONLY|O_NONBLOCK|O_NOFOLLOW);
+    if (fd == -1) {
+	if (errno != ENOENT) {
+	    sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_ERRNO,
+		"unable to open cache entry %s", name);
+	}
+	debug_return_bool(false);
+    }
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode) ||
+	    sb.st_uid != geteuid() || ISSET(sb.st_mode, S_IWGRP|S_IWOTH) ||
+	    sb.st_size != (off_t)sizeof(entry)) {
+	sudo_debug_printf(SUDO_DEBUG_WARN, "ignoring insecure cache entry %s",
+	    name);
+	goto done;
+    }
+    nread = read(fd, &entry, sizeof(entry));
+    if (nread != (ssize_t)sizeof(entry)) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_ERRNO,
+	    "short read from cache entry %s", name);
+	goto done;
+    }
+
+    /* The key has a zeroed digest, compare everything up to it. */
+    if (memcmp(&entry, key, offsetof(struct digest_cache_entry, digest)) != 0 ||
+	    memcmp(entry.verity, key->verity, sizeof(entry.verity)) != 0) {
+	sudo_debug_printf(SUDO_DEBUG_INFO, "stale cache entry %s", name);
+	goto done;
+    }
+    memcpy(digest, entry.digest, key->digest_len);
+    ret = true;
+
+done:
+    close(fd);
+    debug_return_bool(ret);
+}
+
+/*
+ * Atomically replace the cache entry name in dfd.
+ */
+static void
+digest_cache_write(int dfd, const char *name,
+    const struct digest_cache_entry *entry)
+{
+    char tmpname[NAME_MAX + 1];
+    ssize_t nwritten;
+    int fd, len;
+    debug_decl(digest_cache_write, SUDOERS_DEBUG_UTIL);
+
+    len = snprintf(tmpname, sizeof(tmpname), "%s.XXXXXX", name);
+    if (len < 0 || len >= ssizeof(tmpname))
+	debug_return;
+    fd = mkostempsat(dfd, tmpname, 0, O_CLOEXEC);
+    if (fd == -1) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_ERRNO,
+	    "unable to create cache entry %s", tmpname);
+	debug_return;
+    }
+    nwritten = write(fd, entry, sizeof(*entry));
+    if (close(fd) != 0 || nwritten != (ssize_t)sizeof(*entry) ||
+	    renameat(dfd, tmpname, dfd, name) != 0) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_ERRNO,
+	    "unable to write cache entry %s", name);
+	unlinkat(dfd, tmpname, 0);
+    }
+
+    debug_return;
+}
+
+/*
+ * Like sudo_filedigest() but uses the digest cache in cache_dir
+ * when it is not NULL.  The cache is only consulted for regular files.
+ */
+unsigned char *
+sudo_filedigest_cached(int fd, const char *file, unsigned int digest_type,
+    const char *cache_dir, size_t *digest_len)
+{
+    struct digest_cache_entry entry;
+    unsigned char verity[DIGEST_CACHE_MAXLEN];
+    unsigned char *file_digest = NULL;
+    char name[NAME_MAX + 1];
+    size_t verity_len;
+    struct stat sb, sb2;
+    time_t now;
+    int dfd, len;
+    debug_decl(sudo_filedigest_cached, SUDOERS_DEBUG_UTIL);
+
+    if (cache_dir == NULL)
+	debug_return_ptr(sudo_filedigest(fd, file, digest_type, digest_len));
+
+    *digest_len = sudo_digest_getlen(digest_type);
+    if (*digest_len == 0 || *digest_len > DIGEST_CACHE_MAXLEN ||
+	    fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+	debug_return_ptr(sudo_filedigest(fd, file, digest_type, digest_len));
+    }
+    len = snprintf(name, sizeof(name), "%llx-%llx-%s",
+	(unsigned long long)sb.st_dev, (unsigned long long)sb.st_ino,
+	digest_type_to_name(digest_type));
+    if (len < 0 || len >= ssizeof(name))
+	debug_return_ptr(sudo_filedigest(fd, file, digest_type, digest_len));
+    dfd = digest_cache_opendir(cache_dir);
+    if (dfd == -1)
+	debug_return_ptr(sudo_filedigest(fd, file, digest_type, digest_len));
+
+    verity_len = digest_cache_measure(fd, verity, sizeof(verity));
+    digest_cache_fill(&entry, &sb, digest_type, *digest_len, verity,
+	verity_len);
+    if ((file_digest = malloc(*digest_len)) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	goto done;
+    }
+    if (digest_cache_read(dfd, name, &entry, file_digest)) {
+	sudo_debug_printf(SUDO_DEBUG_INFO, "using cached %s digest for %s",
+	    digest_type_to_name(digest_type), file);
+	goto done;
+    }
+    free(file_digest);
+
+    file_digest = sudo_filedigest(fd, file, digest_type, digest_len);
+    if (file_digest == NULL)
+	goto done;
+
+    /*
+     * Only cache the digest if the file was not modified while
+     * we were reading it and was not changed too recently to tell.
+     */
+    if (fstat(fd, &sb2) != 0 || sb2.st_ctime != sb.st_ctime ||
+	    sb2.st_size != sb.st_size) {
+	sudo_debug_printf(SUDO_DEBUG_INFO, "%s changed while hashing", file);
+	goto done;
+    }
+    if (verity_len == 0) {
+	time(&now);
+	if (sb.st_ctime > now - DIGEST_CACHE_SETTLE ||
+		sb.st_mtime > now - DIGEST_CACHE_SETTLE) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO,
+		"not caching %s digest for recently changed %s",
+		digest_type_to_name(digest_type), file);
+	    goto done;
+	}
+    }
+    memcpy(entry.digest, file_digest, *digest_len);
+    digest_cache_write(dfd, name, &entry);
+
+done:
+    close(dfd);
+    debug_return_ptr(file_digest);
+}
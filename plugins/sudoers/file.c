@@ -102,6 +102,22 @@ sudo_file_parse(struct sudoers_context *ctx, const struct sudo_nss *nss)
 	debug_return_ptr(NULL);
     }
 
+    /* Use the precompiled policy if it is current. */
+    if (ctx->parser_conf.sudoers_cache != NULL) {
+	bool loaded = false;
+
+	if (set_perms(ctx, PERM_SUDOERS)) {
+	    loaded = sudoers_cache_read(ctx, ctx->parser_conf.sudoers_cache,
+		&handle->parse_tree);
+	    if (!restore_perms()) {
+		/* unrecoverable error */
+		debug_return_ptr(NULL);
+	    }
+	}
+	if (loaded)
+	    debug_return_ptr(&handle->parse_tree);
+    }
+
     sudoersin = handle->fp;
     error = sudoersparse();
     if (error || (parse_error && !sudoers_error_recovery())) {
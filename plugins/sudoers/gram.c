@@ -149,7 +149,9 @@ struct sudoers_parse_tree parsed_policy = {
     NULL, /* lhost */
     NULL, /* shost */
     NULL, /* nss */
-    NULL  /* ctx */
+    NULL, /* ctx */
+    NULL, /* index */
+    NULL  /* alias_hash */
 };
 
 /*
@@ -165,7 +167,7 @@ static void alias_error(const char *name, short type, int errnum);
 static void init_options(struct command_options *opts);
 static void propagate_cmndspec(struct cmndspec *cs, const struct cmndspec *prev);
 
-#line 168 "gram.c"
+#line 170 "gram.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -328,7 +330,7 @@ extern int sudoersdebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 91 "gram.y"
+#line 93 "gram.y"
 
     struct cmndspec *cmndspec;
     struct defaults *defaults;
@@ -343,7 +345,7 @@ union YYSTYPE
     const char *cstring;
     int tok;
 
-#line 346 "gram.c"
+#line 348 "gram.c"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -874,22 +876,22 @@ static const yytype_int8 yytranslate[] =
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,   205,   205,   208,   211,   212,   215,   218,   221,   229,
-     237,   243,   246,   249,   252,   255,   259,   263,   267,   271,
-     277,   280,   286,   289,   295,   296,   303,   312,   321,   331,
-     341,   353,   354,   359,   365,   382,   386,   392,   401,   409,
-     418,   427,   438,   439,   449,   513,   522,   531,   540,   551,
-     552,   559,   562,   576,   580,   586,   602,   624,   629,   633,
-     638,   643,   648,   653,   657,   662,   665,   670,   687,   699,
-     715,   733,   752,   753,   754,   755,   756,   757,   758,   759,
-     760,   761,   762,   765,   771,   774,   779,   784,   793,   802,
-     814,   819,   824,   829,   834,   841,   844,   847,   850,   853,
-     856,   859,   862,   865,   868,   871,   874,   877,   880,   883,
-     886,   889,   894,   908,   917,   938,   961,   962,   965,   965,
-     977,   980,   981,   988,   989,   992,   992,  1004,  1007,  1008,
-    1015,  1016,  1019,  1019,  1031,  1034,  1035,  1038,  1038,  1050,
-    1053,  1054,  1061,  1065,  1071,  1080,  1088,  1097,  1106,  1117,
-    1118,  1125,  1129,  1135,  1144,  1152
+       0,   207,   207,   210,   213,   214,   217,   220,   223,   231,
+     239,   245,   248,   251,   254,   257,   261,   265,   269,   273,
+     279,   282,   288,   291,   297,   298,   305,   314,   323,   333,
+     343,   355,   356,   361,   367,   384,   388,   394,   403,   411,
+     420,   429,   440,   441,   451,   515,   524,   533,   542,   553,
+     554,   561,   564,   578,   582,   588,   604,   626,   631,   635,
+     640,   645,   650,   655,   659,   664,   667,   672,   689,   701,
+     717,   735,   754,   755,   756,   757,   758,   759,   760,   761,
+     762,   763,   764,   767,   773,   776,   781,   786,   795,   804,
+     816,   821,   826,   831,   836,   843,   846,   849,   852,   855,
+     858,   861,   864,   867,   870,   873,   876,   879,   882,   885,
+     888,   891,   896,   910,   919,   940,   963,   964,   967,   967,
+     979,   982,   983,   990,   991,   994,   994,  1006,  1009,  1010,
+    1017,  1018,  1021,  1021,  1033,  1036,  1037,  1040,  1040,  1052,
+    1055,  1056,  1063,  1067,  1073,  1082,  1090,  1099,  1108,  1119,
+    1120,  1127,  1131,  1137,  1146,  1154
 };
 #endif
 
@@ -1647,31 +1649,31 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* file: %empty  */
-#line 205 "gram.y"
+#line 207 "gram.y"
                         {
 			    ; /* empty file */
 			}
-#line 1654 "gram.c"
+#line 1656 "gram.c"
     break;
 
   case 6: /* entry: '\n'  */
-#line 215 "gram.y"
+#line 217 "gram.y"
                              {
 			    ; /* blank line */
 			}
-#line 1662 "gram.c"
+#line 1664 "gram.c"
     break;
 
   case 7: /* entry: error '\n'  */
-#line 218 "gram.y"
+#line 220 "gram.y"
                                    {
 			    yyerrok;
 			}
-#line 1670 "gram.c"
+#line 1672 "gram.c"
     break;
 
   case 8: /* entry: include  */
-#line 221 "gram.y"
+#line 223 "gram.y"
                                 {
 			    const bool success = push_include((yyvsp[0].string),
 				parsed_policy.ctx->user.shost, &parser_conf);
@@ -1680,11 +1682,11 @@ yyreduce:
 			    if (!success && !parser_conf.recovery)
 				YYERROR;
 			}
-#line 1683 "gram.c"
+#line 1685 "gram.c"
     break;
 
   case 9: /* entry: includedir  */
-#line 229 "gram.y"
+#line 231 "gram.y"
                                    {
 			    const bool success = push_includedir((yyvsp[0].string),
 				parsed_policy.ctx->user.shost, &parser_conf);
@@ -1693,143 +1695,143 @@ yyreduce:
 			    if (!success && !parser_conf.recovery)
 				YYERROR;
 			}
-#line 1696 "gram.c"
+#line 1698 "gram.c"
     break;
 
   case 10: /* entry: userlist privileges '\n'  */
-#line 237 "gram.y"
+#line 239 "gram.y"
                                                  {
 			    if (!add_userspec((yyvsp[-2].member), (yyvsp[-1].privilege))) {
 				sudoerserror(N_("unable to allocate memory"));
 				YYERROR;
 			    }
 			}
-#line 1707 "gram.c"
+#line 1709 "gram.c"
     break;
 
   case 11: /* entry: USERALIAS useraliases '\n'  */
-#line 243 "gram.y"
+#line 245 "gram.y"
                                                    {
 			    ;
 			}
-#line 1715 "gram.c"
+#line 1717 "gram.c"
     break;
 
   case 12: /* entry: HOSTALIAS hostaliases '\n'  */
-#line 246 "gram.y"
+#line 248 "gram.y"
                                                    {
 			    ;
 			}
-#line 1723 "gram.c"
+#line 1725 "gram.c"
     break;
 
   case 13: /* entry: CMNDALIAS cmndaliases '\n'  */
-#line 249 "gram.y"
+#line 251 "gram.y"
                                                    {
 			    ;
 			}
-#line 1731 "gram.c"
+#line 1733 "gram.c"
     break;
 
   case 14: /* entry: RUNASALIAS runasaliases '\n'  */
-#line 252 "gram.y"
+#line 254 "gram.y"
                                                      {
 			    ;
 			}
-#line 1739 "gram.c"
+#line 1741 "gram.c"
     break;
 
   case 15: /* entry: DEFAULTS defaults_list '\n'  */
-#line 255 "gram.y"
+#line 257 "gram.y"
                                                     {
 			    if (!add_defaults(DEFAULTS, NULL, (yyvsp[-1].defaults)))
 				YYERROR;
 			}
-#line 1748 "gram.c"
+#line 1750 "gram.c"
     break;
 
   case 16: /* entry: DEFAULTS_USER userlist defaults_list '\n'  */
-#line 259 "gram.y"
+#line 261 "gram.y"
                                                                   {
 			    if (!add_defaults(DEFAULTS_USER, (yyvsp[-2].member), (yyvsp[-1].defaults)))
 				YYERROR;
 			}
-#line 1757 "gram.c"
+#line 1759 "gram.c"
     break;
 
   case 17: /* entry: DEFAULTS_RUNAS userlist defaults_list '\n'  */
-#line 263 "gram.y"
+#line 265 "gram.y"
                                                                    {
 			    if (!add_defaults(DEFAULTS_RUNAS, (yyvsp[-2].member), (yyvsp[-1].defaults)))
 				YYERROR;
 			}
-#line 1766 "gram.c"
+#line 1768 "gram.c"
     break;
 
   case 18: /* entry: DEFAULTS_HOST hostlist defaults_list '\n'  */
-#line 267 "gram.y"
+#line 269 "gram.y"
                                                                   {
 			    if (!add_defaults(DEFAULTS_HOST, (yyvsp[-2].member), (yyvsp[-1].defaults)))
 				YYERROR;
 			}
-#line 1775 "gram.c"
+#line 1777 "gram.c"
     break;
 
   case 19: /* entry: DEFAULTS_CMND cmndlist defaults_list '\n'  */
-#line 271 "gram.y"
+#line 273 "gram.y"
                                                                   {
 			    if (!add_defaults(DEFAULTS_CMND, (yyvsp[-2].member), (yyvsp[-1].defaults)))
 				YYERROR;
 			}
-#line 1784 "gram.c"
+#line 1786 "gram.c"
     break;
 
   case 20: /* include: INCLUDE WORD '\n'  */
-#line 277 "gram.y"
+#line 279 "gram.y"
                                           {
 			    (yyval.string) = (yyvsp[-1].string);
 			}
-#line 1792 "gram.c"
+#line 1794 "gram.c"
     break;
 
   case 21: /* include: INCLUDE WORD error '\n'  */
-#line 280 "gram.y"
+#line 282 "gram.y"
                                                 {
 			    yyerrok;
 			    (yyval.string) = (yyvsp[-2].string);
 			}
-#line 1801 "gram.c"
+#line 1803 "gram.c"
     break;
 
   case 22: /* includedir: INCLUDEDIR WORD '\n'  */
-#line 286 "gram.y"
+#line 288 "gram.y"
                                              {
 			    (yyval.string) = (yyvsp[-1].string);
 			}
-#line 1809 "gram.c"
+#line 1811 "gram.c"
     break;
 
   case 23: /* includedir: INCLUDEDIR WORD error '\n'  */
-#line 289 "gram.y"
+#line 291 "gram.y"
                                                    {
 			    yyerrok;
 			    (yyval.string) = (yyvsp[-2].string);
 			}
-#line 1818 "gram.c"
+#line 1820 "gram.c"
     break;
 
   case 25: /* defaults_list: defaults_list ',' defaults_entry  */
-#line 296 "gram.y"
+#line 298 "gram.y"
                                                          {
 			    parser_leak_remove(LEAK_DEFAULTS, (yyvsp[0].defaults));
 			    HLTQ_CONCAT((yyvsp[-2].defaults), (yyvsp[0].defaults), entries);
 			    (yyval.defaults) = (yyvsp[-2].defaults);
 			}
-#line 1828 "gram.c"
+#line 1830 "gram.c"
     break;
 
   case 26: /* defaults_entry: DEFVAR  */
-#line 303 "gram.y"
+#line 305 "gram.y"
                                {
 			    (yyval.defaults) = new_default((yyvsp[0].string), NULL, true);
 			    if ((yyval.defaults) == NULL) {
@@ -1839,11 +1841,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DEFAULTS, (yyval.defaults));
 			}
-#line 1842 "gram.c"
+#line 1844 "gram.c"
     break;
 
   case 27: /* defaults_entry: '!' DEFVAR  */
-#line 312 "gram.y"
+#line 314 "gram.y"
                                    {
 			    (yyval.defaults) = new_default((yyvsp[0].string), NULL, false);
 			    if ((yyval.defaults) == NULL) {
@@ -1853,11 +1855,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DEFAULTS, (yyval.defaults));
 			}
-#line 1856 "gram.c"
+#line 1858 "gram.c"
     break;
 
   case 28: /* defaults_entry: DEFVAR '=' WORD  */
-#line 321 "gram.y"
+#line 323 "gram.y"
                                         {
 			    (yyval.defaults) = new_default((yyvsp[-2].string), (yyvsp[0].string), true);
 			    if ((yyval.defaults) == NULL) {
@@ -1868,11 +1870,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DEFAULTS, (yyval.defaults));
 			}
-#line 1871 "gram.c"
+#line 1873 "gram.c"
     break;
 
   case 29: /* defaults_entry: DEFVAR '+' WORD  */
-#line 331 "gram.y"
+#line 333 "gram.y"
                                         {
 			    (yyval.defaults) = new_default((yyvsp[-2].string), (yyvsp[0].string), '+');
 			    if ((yyval.defaults) == NULL) {
@@ -1883,11 +1885,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DEFAULTS, (yyval.defaults));
 			}
-#line 1886 "gram.c"
+#line 1888 "gram.c"
     break;
 
   case 30: /* defaults_entry: DEFVAR '-' WORD  */
-#line 341 "gram.y"
+#line 343 "gram.y"
                                         {
 			    (yyval.defaults) = new_default((yyvsp[-2].string), (yyvsp[0].string), '-');
 			    if ((yyval.defaults) == NULL) {
@@ -1898,30 +1900,30 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DEFAULTS, (yyval.defaults));
 			}
-#line 1901 "gram.c"
+#line 1903 "gram.c"
     break;
 
   case 32: /* privileges: privileges ':' privilege  */
-#line 354 "gram.y"
+#line 356 "gram.y"
                                                  {
 			    parser_leak_remove(LEAK_PRIVILEGE, (yyvsp[0].privilege));
 			    HLTQ_CONCAT((yyvsp[-2].privilege), (yyvsp[0].privilege), entries);
 			    (yyval.privilege) = (yyvsp[-2].privilege);
 			}
-#line 1911 "gram.c"
+#line 1913 "gram.c"
     break;
 
   case 33: /* privileges: privileges ':' error  */
-#line 359 "gram.y"
+#line 361 "gram.y"
                                              {
 			    yyerrok;
 			    (yyval.privilege) = (yyvsp[-2].privilege);
 			}
-#line 1920 "gram.c"
+#line 1922 "gram.c"
     break;
 
   case 34: /* privilege: hostlist '=' cmndspeclist  */
-#line 365 "gram.y"
+#line 367 "gram.y"
                                                   {
 			    struct privilege *p = calloc(1, sizeof(*p));
 			    if (p == NULL) {
@@ -1937,29 +1939,29 @@ yyreduce:
 			    HLTQ_INIT(p, entries);
 			    (yyval.privilege) = p;
 			}
-#line 1940 "gram.c"
+#line 1942 "gram.c"
     break;
 
   case 35: /* ophost: host  */
-#line 382 "gram.y"
+#line 384 "gram.y"
                              {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = false;
 			}
-#line 1949 "gram.c"
+#line 1951 "gram.c"
     break;
 
   case 36: /* ophost: '!' host  */
-#line 386 "gram.y"
+#line 388 "gram.y"
                                  {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = true;
 			}
-#line 1958 "gram.c"
+#line 1960 "gram.c"
     break;
 
   case 37: /* host: ALIAS  */
-#line 392 "gram.y"
+#line 394 "gram.y"
                               {
 			    (yyval.member) = new_member((yyvsp[0].string), ALIAS);
 			    if ((yyval.member) == NULL) {
@@ -1969,11 +1971,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 1972 "gram.c"
+#line 1974 "gram.c"
     break;
 
   case 38: /* host: ALL  */
-#line 401 "gram.y"
+#line 403 "gram.y"
                             {
 			    (yyval.member) = new_member(NULL, ALL);
 			    if ((yyval.member) == NULL) {
@@ -1982,11 +1984,11 @@ yyreduce:
 			    }
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 1985 "gram.c"
+#line 1987 "gram.c"
     break;
 
   case 39: /* host: NETGROUP  */
-#line 409 "gram.y"
+#line 411 "gram.y"
                                  {
 			    (yyval.member) = new_member((yyvsp[0].string), NETGROUP);
 			    if ((yyval.member) == NULL) {
@@ -1996,11 +1998,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 1999 "gram.c"
+#line 2001 "gram.c"
     break;
 
   case 40: /* host: NTWKADDR  */
-#line 418 "gram.y"
+#line 420 "gram.y"
                                  {
 			    (yyval.member) = new_member((yyvsp[0].string), NTWKADDR);
 			    if ((yyval.member) == NULL) {
@@ -2010,11 +2012,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 2013 "gram.c"
+#line 2015 "gram.c"
     break;
 
   case 41: /* host: WORD  */
-#line 427 "gram.y"
+#line 429 "gram.y"
                              {
 			    (yyval.member) = new_member((yyvsp[0].string), WORD);
 			    if ((yyval.member) == NULL) {
@@ -2024,11 +2026,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 2027 "gram.c"
+#line 2029 "gram.c"
     break;
 
   case 43: /* cmndspeclist: cmndspeclist ',' cmndspec  */
-#line 439 "gram.y"
+#line 441 "gram.y"
                                                   {
 			    const struct cmndspec *prev =
 				HLTQ_LAST((yyvsp[-2].cmndspec), cmndspec, entries);
@@ -2037,11 +2039,11 @@ yyreduce:
 			    HLTQ_CONCAT((yyvsp[-2].cmndspec), (yyvsp[0].cmndspec), entries);
 			    (yyval.cmndspec) = (yyvsp[-2].cmndspec);
 			}
-#line 2040 "gram.c"
+#line 2042 "gram.c"
     break;
 
   case 44: /* cmndspec: runasspec options cmndtag digcmnd  */
-#line 449 "gram.y"
+#line 451 "gram.y"
                                                           {
 			    struct cmndspec *cs = calloc(1, sizeof(*cs));
 			    if (cs == NULL) {
@@ -2104,11 +2106,11 @@ yyreduce:
 				cs->tags.setenv = IMPLIED;
 			    (yyval.cmndspec) = cs;
 			}
-#line 2107 "gram.c"
+#line 2109 "gram.c"
     break;
 
   case 45: /* digestspec: SHA224_TOK ':' DIGEST  */
-#line 513 "gram.y"
+#line 515 "gram.y"
                                               {
 			    (yyval.digest) = new_digest(SUDO_DIGEST_SHA224, (yyvsp[0].string));
 			    if ((yyval.digest) == NULL) {
@@ -2118,11 +2120,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DIGEST, (yyval.digest));
 			}
-#line 2121 "gram.c"
+#line 2123 "gram.c"
     break;
 
   case 46: /* digestspec: SHA256_TOK ':' DIGEST  */
-#line 522 "gram.y"
+#line 524 "gram.y"
                                               {
 			    (yyval.digest) = new_digest(SUDO_DIGEST_SHA256, (yyvsp[0].string));
 			    if ((yyval.digest) == NULL) {
@@ -2132,11 +2134,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DIGEST, (yyval.digest));
 			}
-#line 2135 "gram.c"
+#line 2137 "gram.c"
     break;
 
   case 47: /* digestspec: SHA384_TOK ':' DIGEST  */
-#line 531 "gram.y"
+#line 533 "gram.y"
                                               {
 			    (yyval.digest) = new_digest(SUDO_DIGEST_SHA384, (yyvsp[0].string));
 			    if ((yyval.digest) == NULL) {
@@ -2146,11 +2148,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DIGEST, (yyval.digest));
 			}
-#line 2149 "gram.c"
+#line 2151 "gram.c"
     break;
 
   case 48: /* digestspec: SHA512_TOK ':' DIGEST  */
-#line 540 "gram.y"
+#line 542 "gram.y"
                                               {
 			    (yyval.digest) = new_digest(SUDO_DIGEST_SHA512, (yyvsp[0].string));
 			    if ((yyval.digest) == NULL) {
@@ -2160,29 +2162,29 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_DIGEST, (yyval.digest));
 			}
-#line 2163 "gram.c"
+#line 2165 "gram.c"
     break;
 
   case 50: /* digestlist: digestlist ',' digestspec  */
-#line 552 "gram.y"
+#line 554 "gram.y"
                                                   {
 			    parser_leak_remove(LEAK_DIGEST, (yyvsp[0].digest));
 			    HLTQ_CONCAT((yyvsp[-2].digest), (yyvsp[0].digest), entries);
 			    (yyval.digest) = (yyvsp[-2].digest);
 			}
-#line 2173 "gram.c"
+#line 2175 "gram.c"
     break;
 
   case 51: /* digcmnd: opcmnd  */
-#line 559 "gram.y"
+#line 561 "gram.y"
                                {
 			    (yyval.member) = (yyvsp[0].member);
 			}
-#line 2181 "gram.c"
+#line 2183 "gram.c"
     break;
 
   case 52: /* digcmnd: digestlist opcmnd  */
-#line 562 "gram.y"
+#line 564 "gram.y"
                                           {
 			    struct sudo_command *c =
 				(struct sudo_command *) (yyvsp[0].member)->name;
@@ -2195,29 +2197,29 @@ yyreduce:
 			    HLTQ_TO_TAILQ(&c->digests, (yyvsp[-1].digest), entries);
 			    (yyval.member) = (yyvsp[0].member);
 			}
-#line 2198 "gram.c"
+#line 2200 "gram.c"
     break;
 
   case 53: /* opcmnd: cmnd  */
-#line 576 "gram.y"
+#line 578 "gram.y"
                              {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = false;
 			}
-#line 2207 "gram.c"
+#line 2209 "gram.c"
     break;
 
   case 54: /* opcmnd: '!' cmnd  */
-#line 580 "gram.y"
+#line 582 "gram.y"
                                  {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = true;
 			}
-#line 2216 "gram.c"
+#line 2218 "gram.c"
     break;
 
   case 55: /* chdirspec: CWD '=' WORD  */
-#line 586 "gram.y"
+#line 588 "gram.y"
                                      {
 			    if ((yyvsp[0].string)[0] != '/' && (yyvsp[0].string)[0] != '~') {
 				if (strcmp((yyvsp[0].string), "*") != 0) {
@@ -2232,11 +2234,11 @@ yyreduce:
 			    }
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2235 "gram.c"
+#line 2237 "gram.c"
     break;
 
   case 56: /* chrootspec: CHROOT '=' WORD  */
-#line 602 "gram.y"
+#line 604 "gram.y"
                                         {
 			    if ((yyvsp[0].string)[0] != '/' && (yyvsp[0].string)[0] != '~') {
 				if (strcmp((yyvsp[0].string), "*") != 0) {
@@ -2257,91 +2259,91 @@ yyreduce:
 			    }
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2260 "gram.c"
+#line 2262 "gram.c"
     break;
 
   case 57: /* timeoutspec: CMND_TIMEOUT '=' WORD  */
-#line 624 "gram.y"
+#line 626 "gram.y"
                                               {
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2268 "gram.c"
+#line 2270 "gram.c"
     break;
 
   case 58: /* notbeforespec: NOTBEFORE '=' WORD  */
-#line 629 "gram.y"
+#line 631 "gram.y"
                                            {
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2276 "gram.c"
+#line 2278 "gram.c"
     break;
 
   case 59: /* notafterspec: NOTAFTER '=' WORD  */
-#line 633 "gram.y"
+#line 635 "gram.y"
                                           {
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2284 "gram.c"
+#line 2286 "gram.c"
     break;
 
   case 60: /* rolespec: ROLE '=' WORD  */
-#line 638 "gram.y"
+#line 640 "gram.y"
                                       {
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2292 "gram.c"
+#line 2294 "gram.c"
     break;
 
   case 61: /* typespec: TYPE '=' WORD  */
-#line 643 "gram.y"
+#line 645 "gram.y"
                                       {
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2300 "gram.c"
+#line 2302 "gram.c"
     break;
 
   case 62: /* apparmor_profilespec: APPARMOR_PROFILE '=' WORD  */
-#line 648 "gram.y"
+#line 650 "gram.y"
                                                           {
 				(yyval.string) = (yyvsp[0].string);
 			}
-#line 2308 "gram.c"
+#line 2310 "gram.c"
     break;
 
   case 63: /* privsspec: PRIVS '=' WORD  */
-#line 653 "gram.y"
+#line 655 "gram.y"
                                        {
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2316 "gram.c"
+#line 2318 "gram.c"
     break;
 
   case 64: /* limitprivsspec: LIMITPRIVS '=' WORD  */
-#line 657 "gram.y"
+#line 659 "gram.y"
                                             {
 			    (yyval.string) = (yyvsp[0].string);
 			}
-#line 2324 "gram.c"
+#line 2326 "gram.c"
     break;
 
   case 65: /* runasspec: %empty  */
-#line 662 "gram.y"
+#line 664 "gram.y"
                                     {
 			    (yyval.runas) = NULL;
 			}
-#line 2332 "gram.c"
+#line 2334 "gram.c"
     break;
 
   case 66: /* runasspec: '(' runaslist ')'  */
-#line 665 "gram.y"
+#line 667 "gram.y"
                                           {
 			    (yyval.runas) = (yyvsp[-1].runas);
 			}
-#line 2340 "gram.c"
+#line 2342 "gram.c"
     break;
 
   case 67: /* runaslist: %empty  */
-#line 670 "gram.y"
+#line 672 "gram.y"
                                     {
 			    /* User may run command as themselves. */
 			    (yyval.runas) = calloc(1, sizeof(struct runascontainer));
@@ -2359,11 +2361,11 @@ yyreduce:
 			    }
 			    parser_leak_add(LEAK_RUNAS, (yyval.runas));
 			}
-#line 2362 "gram.c"
+#line 2364 "gram.c"
     break;
 
   case 68: /* runaslist: userlist  */
-#line 687 "gram.y"
+#line 689 "gram.y"
                                  {
 			    /* User may run command as a user in userlist. */
 			    (yyval.runas) = calloc(1, sizeof(struct runascontainer));
@@ -2376,11 +2378,11 @@ yyreduce:
 			    (yyval.runas)->runasusers = (yyvsp[0].member);
 			    /* $$->runasgroups = NULL; */
 			}
-#line 2379 "gram.c"
+#line 2381 "gram.c"
     break;
 
   case 69: /* runaslist: userlist ':' grouplist  */
-#line 699 "gram.y"
+#line 701 "gram.y"
                                                {
 			    /*
 			     * User may run command as a user in userlist
@@ -2397,11 +2399,11 @@ yyreduce:
 			    (yyval.runas)->runasusers = (yyvsp[-2].member);
 			    (yyval.runas)->runasgroups = (yyvsp[0].member);
 			}
-#line 2400 "gram.c"
+#line 2402 "gram.c"
     break;
 
   case 70: /* runaslist: ':' grouplist  */
-#line 715 "gram.y"
+#line 717 "gram.y"
                                       {
 			    /* User may run command as a group in grouplist. */
 			    (yyval.runas) = calloc(1, sizeof(struct runascontainer));
@@ -2420,11 +2422,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			    (yyval.runas)->runasgroups = (yyvsp[0].member);
 			}
-#line 2423 "gram.c"
+#line 2425 "gram.c"
     break;
 
   case 71: /* runaslist: ':'  */
-#line 733 "gram.y"
+#line 735 "gram.y"
                             {
 			    /* User may run command as themselves. */
 			    (yyval.runas) = calloc(1, sizeof(struct runascontainer));
@@ -2442,114 +2444,114 @@ yyreduce:
 			    }
 			    parser_leak_add(LEAK_RUNAS, (yyval.runas));
 			}
-#line 2445 "gram.c"
+#line 2447 "gram.c"
     break;
 
   case 72: /* reserved_word: ALL  */
-#line 752 "gram.y"
+#line 754 "gram.y"
                                         { (yyval.cstring) = "ALL"; }
-#line 2451 "gram.c"
+#line 2453 "gram.c"
     break;
 
   case 73: /* reserved_word: CHROOT  */
-#line 753 "gram.y"
+#line 755 "gram.y"
                                         { (yyval.cstring) = "CHROOT"; }
-#line 2457 "gram.c"
+#line 2459 "gram.c"
     break;
 
   case 74: /* reserved_word: CWD  */
-#line 754 "gram.y"
+#line 756 "gram.y"
                                         { (yyval.cstring) = "CWD"; }
-#line 2463 "gram.c"
+#line 2465 "gram.c"
     break;
 
   case 75: /* reserved_word: CMND_TIMEOUT  */
-#line 755 "gram.y"
+#line 757 "gram.y"
                                         { (yyval.cstring) = "CMND_TIMEOUT"; }
-#line 2469 "gram.c"
+#line 2471 "gram.c"
     break;
 
   case 76: /* reserved_word: NOTBEFORE  */
-#line 756 "gram.y"
+#line 758 "gram.y"
                                         { (yyval.cstring) = "NOTBEFORE"; }
-#line 2475 "gram.c"
+#line 2477 "gram.c"
     break;
 
   case 77: /* reserved_word: NOTAFTER  */
-#line 757 "gram.y"
+#line 759 "gram.y"
                                         { (yyval.cstring) = "NOTAFTER"; }
-#line 2481 "gram.c"
+#line 2483 "gram.c"
     break;
 
   case 78: /* reserved_word: ROLE  */
-#line 758 "gram.y"
+#line 760 "gram.y"
                                         { (yyval.cstring) = "ROLE"; }
-#line 2487 "gram.c"
+#line 2489 "gram.c"
     break;
 
   case 79: /* reserved_word: TYPE  */
-#line 759 "gram.y"
+#line 761 "gram.y"
                                         { (yyval.cstring) = "TYPE"; }
-#line 2493 "gram.c"
+#line 2495 "gram.c"
     break;
 
   case 80: /* reserved_word: PRIVS  */
-#line 760 "gram.y"
+#line 762 "gram.y"
                                         { (yyval.cstring) = "PRIVS"; }
-#line 2499 "gram.c"
+#line 2501 "gram.c"
     break;
 
   case 81: /* reserved_word: LIMITPRIVS  */
-#line 761 "gram.y"
+#line 763 "gram.y"
                                         { (yyval.cstring) = "LIMITPRIVS"; }
-#line 2505 "gram.c"
+#line 2507 "gram.c"
     break;
 
   case 82: /* reserved_word: APPARMOR_PROFILE  */
-#line 762 "gram.y"
+#line 764 "gram.y"
                                          { (yyval.cstring) = "APPARMOR_PROFILE"; }
-#line 2511 "gram.c"
+#line 2513 "gram.c"
     break;
 
   case 83: /* reserved_alias: reserved_word  */
-#line 765 "gram.y"
+#line 767 "gram.y"
                                       {
 			    sudoerserrorf(U_("syntax error, reserved word %s used as an alias name"), (yyvsp[0].cstring));
 			    YYERROR;
 			}
-#line 2520 "gram.c"
+#line 2522 "gram.c"
     break;
 
   case 84: /* options: %empty  */
-#line 771 "gram.y"
+#line 773 "gram.y"
                                     {
 			    init_options(&(yyval.options));
 			}
-#line 2528 "gram.c"
+#line 2530 "gram.c"
     break;
 
   case 85: /* options: options chdirspec  */
-#line 774 "gram.y"
+#line 776 "gram.y"
                                           {
 			    parser_leak_remove(LEAK_PTR, (yyval.options).runcwd);
 			    free((yyval.options).runcwd);
 			    (yyval.options).runcwd = (yyvsp[0].string);
 			}
-#line 2538 "gram.c"
+#line 2540 "gram.c"
     break;
 
   case 86: /* options: options chrootspec  */
-#line 779 "gram.y"
+#line 781 "gram.y"
                                            {
 			    parser_leak_remove(LEAK_PTR, (yyval.options).runchroot);
 			    free((yyval.options).runchroot);
 			    (yyval.options).runchroot = (yyvsp[0].string);
 			}
-#line 2548 "gram.c"
+#line 2550 "gram.c"
     break;
 
   case 87: /* options: options notbeforespec  */
-#line 784 "gram.y"
+#line 786 "gram.y"
                                               {
 			    (yyval.options).notbefore = parse_gentime((yyvsp[0].string));
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
@@ -2559,11 +2561,11 @@ yyreduce:
 				YYERROR;
 			    }
 			}
-#line 2562 "gram.c"
+#line 2564 "gram.c"
     break;
 
   case 88: /* options: options notafterspec  */
-#line 793 "gram.y"
+#line 795 "gram.y"
                                              {
 			    (yyval.options).notafter = parse_gentime((yyvsp[0].string));
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
@@ -2573,11 +2575,11 @@ yyreduce:
 				YYERROR;
 			    }
 			}
-#line 2576 "gram.c"
+#line 2578 "gram.c"
     break;
 
   case 89: /* options: options timeoutspec  */
-#line 802 "gram.y"
+#line 804 "gram.y"
                                             {
 			    (yyval.options).timeout = parse_timeout((yyvsp[0].string));
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
@@ -2590,197 +2592,197 @@ yyreduce:
 				YYERROR;
 			    }
 			}
-#line 2593 "gram.c"
+#line 2595 "gram.c"
     break;
 
   case 90: /* options: options rolespec  */
-#line 814 "gram.y"
+#line 816 "gram.y"
                                          {
 			    parser_leak_remove(LEAK_PTR, (yyval.options).role);
 			    free((yyval.options).role);
 			    (yyval.options).role = (yyvsp[0].string);
 			}
-#line 2603 "gram.c"
+#line 2605 "gram.c"
     break;
 
   case 91: /* options: options typespec  */
-#line 819 "gram.y"
+#line 821 "gram.y"
                                          {
 			    parser_leak_remove(LEAK_PTR, (yyval.options).type);
 			    free((yyval.options).type);
 			    (yyval.options).type = (yyvsp[0].string);
 			}
-#line 2613 "gram.c"
+#line 2615 "gram.c"
     break;
 
   case 92: /* options: options apparmor_profilespec  */
-#line 824 "gram.y"
+#line 826 "gram.y"
                                                      {
 			    parser_leak_remove(LEAK_PTR, (yyval.options).apparmor_profile);
 			    free((yyval.options).apparmor_profile);
 			    (yyval.options).apparmor_profile = (yyvsp[0].string);
 			}
-#line 2623 "gram.c"
+#line 2625 "gram.c"
     break;
 
   case 93: /* options: options privsspec  */
-#line 829 "gram.y"
+#line 831 "gram.y"
                                           {
 			    parser_leak_remove(LEAK_PTR, (yyval.options).privs);
 			    free((yyval.options).privs);
 			    (yyval.options).privs = (yyvsp[0].string);
 			}
-#line 2633 "gram.c"
+#line 2635 "gram.c"
     break;
 
   case 94: /* options: options limitprivsspec  */
-#line 834 "gram.y"
+#line 836 "gram.y"
                                                {
 			    parser_leak_remove(LEAK_PTR, (yyval.options).limitprivs);
 			    free((yyval.options).limitprivs);
 			    (yyval.options).limitprivs = (yyvsp[0].string);
 			}
-#line 2643 "gram.c"
+#line 2645 "gram.c"
     break;
 
   case 95: /* cmndtag: %empty  */
-#line 841 "gram.y"
+#line 843 "gram.y"
                                     {
 			    TAGS_INIT(&(yyval.tag));
 			}
-#line 2651 "gram.c"
+#line 2653 "gram.c"
     break;
 
   case 96: /* cmndtag: cmndtag NOPASSWD  */
-#line 844 "gram.y"
+#line 846 "gram.y"
                                          {
 			    (yyval.tag).nopasswd = true;
 			}
-#line 2659 "gram.c"
+#line 2661 "gram.c"
     break;
 
   case 97: /* cmndtag: cmndtag PASSWD  */
-#line 847 "gram.y"
+#line 849 "gram.y"
                                        {
 			    (yyval.tag).nopasswd = false;
 			}
-#line 2667 "gram.c"
+#line 2669 "gram.c"
     break;
 
   case 98: /* cmndtag: cmndtag NOEXEC  */
-#line 850 "gram.y"
+#line 852 "gram.y"
                                        {
 			    (yyval.tag).noexec = true;
 			}
-#line 2675 "gram.c"
+#line 2677 "gram.c"
     break;
 
   case 99: /* cmndtag: cmndtag EXEC  */
-#line 853 "gram.y"
+#line 855 "gram.y"
                                      {
 			    (yyval.tag).noexec = false;
 			}
-#line 2683 "gram.c"
+#line 2685 "gram.c"
     break;
 
   case 100: /* cmndtag: cmndtag INTERCEPT  */
-#line 856 "gram.y"
+#line 858 "gram.y"
                                           {
 			    (yyval.tag).intercept = true;
 			}
-#line 2691 "gram.c"
+#line 2693 "gram.c"
     break;
 
   case 101: /* cmndtag: cmndtag NOINTERCEPT  */
-#line 859 "gram.y"
+#line 861 "gram.y"
                                             {
 			    (yyval.tag).intercept = false;
 			}
-#line 2699 "gram.c"
+#line 2701 "gram.c"
     break;
 
   case 102: /* cmndtag: cmndtag SETENV  */
-#line 862 "gram.y"
+#line 864 "gram.y"
                                        {
 			    (yyval.tag).setenv = true;
 			}
-#line 2707 "gram.c"
+#line 2709 "gram.c"
     break;
 
   case 103: /* cmndtag: cmndtag NOSETENV  */
-#line 865 "gram.y"
+#line 867 "gram.y"
                                          {
 			    (yyval.tag).setenv = false;
 			}
-#line 2715 "gram.c"
+#line 2717 "gram.c"
     break;
 
   case 104: /* cmndtag: cmndtag LOG_INPUT  */
-#line 868 "gram.y"
+#line 870 "gram.y"
                                           {
 			    (yyval.tag).log_input = true;
 			}
-#line 2723 "gram.c"
+#line 2725 "gram.c"
     break;
 
   case 105: /* cmndtag: cmndtag NOLOG_INPUT  */
-#line 871 "gram.y"
+#line 873 "gram.y"
                                             {
 			    (yyval.tag).log_input = false;
 			}
-#line 2731 "gram.c"
+#line 2733 "gram.c"
     break;
 
   case 106: /* cmndtag: cmndtag LOG_OUTPUT  */
-#line 874 "gram.y"
+#line 876 "gram.y"
                                            {
 			    (yyval.tag).log_output = true;
 			}
-#line 2739 "gram.c"
+#line 2741 "gram.c"
     break;
 
   case 107: /* cmndtag: cmndtag NOLOG_OUTPUT  */
-#line 877 "gram.y"
+#line 879 "gram.y"
                                              {
 			    (yyval.tag).log_output = false;
 			}
-#line 2747 "gram.c"
+#line 2749 "gram.c"
     break;
 
   case 108: /* cmndtag: cmndtag FOLLOWLNK  */
-#line 880 "gram.y"
+#line 882 "gram.y"
                                           {
 			    (yyval.tag).follow = true;
 			}
-#line 2755 "gram.c"
+#line 2757 "gram.c"
     break;
 
   case 109: /* cmndtag: cmndtag NOFOLLOWLNK  */
-#line 883 "gram.y"
+#line 885 "gram.y"
                                             {
 			    (yyval.tag).follow = false;
 			}
-#line 2763 "gram.c"
+#line 2765 "gram.c"
     break;
 
   case 110: /* cmndtag: cmndtag MAIL  */
-#line 886 "gram.y"
+#line 888 "gram.y"
                                      {
 			    (yyval.tag).send_mail = true;
 			}
-#line 2771 "gram.c"
+#line 2773 "gram.c"
     break;
 
   case 111: /* cmndtag: cmndtag NOMAIL  */
-#line 889 "gram.y"
+#line 891 "gram.y"
                                        {
 			    (yyval.tag).send_mail = false;
 			}
-#line 2779 "gram.c"
+#line 2781 "gram.c"
     break;
 
   case 112: /* cmnd: ALL  */
-#line 894 "gram.y"
+#line 896 "gram.y"
                             {
 			    struct sudo_command *c;
 
@@ -2795,11 +2797,11 @@ yyreduce:
 			    }
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 2798 "gram.c"
+#line 2800 "gram.c"
     break;
 
   case 113: /* cmnd: ALIAS  */
-#line 908 "gram.y"
+#line 910 "gram.y"
                               {
 			    (yyval.member) = new_member((yyvsp[0].string), ALIAS);
 			    if ((yyval.member) == NULL) {
@@ -2809,11 +2811,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 2812 "gram.c"
+#line 2814 "gram.c"
     break;
 
   case 114: /* cmnd: COMMAND  */
-#line 917 "gram.y"
+#line 919 "gram.y"
                                 {
 			    struct sudo_command *c;
 
@@ -2835,11 +2837,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].command).args);
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 2838 "gram.c"
+#line 2840 "gram.c"
     break;
 
   case 115: /* cmnd: WORD  */
-#line 938 "gram.y"
+#line 940 "gram.y"
                              {
 			    if (strcmp((yyvsp[0].string), "list") == 0) {
 				struct sudo_command *c;
@@ -2861,20 +2863,20 @@ yyreduce:
 				YYERROR;
 			    }
 			}
-#line 2864 "gram.c"
+#line 2866 "gram.c"
     break;
 
   case 118: /* $@1: %empty  */
-#line 965 "gram.y"
+#line 967 "gram.y"
                               {
 			    alias_line = this_lineno;
 			    alias_column = (int)sudolinebuf.toke_start + 1;
 			}
-#line 2873 "gram.c"
+#line 2875 "gram.c"
     break;
 
   case 119: /* hostalias: ALIAS $@1 '=' hostlist  */
-#line 968 "gram.y"
+#line 970 "gram.y"
                                        {
 			    if (!alias_add(&parsed_policy, (yyvsp[-3].string), HOSTALIAS,
 				sudoers, alias_line, alias_column, (yyvsp[0].member))) {
@@ -2884,30 +2886,30 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[-3].string));
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			}
-#line 2887 "gram.c"
+#line 2889 "gram.c"
     break;
 
   case 122: /* hostlist: hostlist ',' ophost  */
-#line 981 "gram.y"
+#line 983 "gram.y"
                                             {
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			    HLTQ_CONCAT((yyvsp[-2].member), (yyvsp[0].member), entries);
 			    (yyval.member) = (yyvsp[-2].member);
 			}
-#line 2897 "gram.c"
+#line 2899 "gram.c"
     break;
 
   case 125: /* $@2: %empty  */
-#line 992 "gram.y"
+#line 994 "gram.y"
                               {
 			    alias_line = this_lineno;
 			    alias_column = (int)sudolinebuf.toke_start + 1;
 			}
-#line 2906 "gram.c"
+#line 2908 "gram.c"
     break;
 
   case 126: /* cmndalias: ALIAS $@2 '=' cmndlist  */
-#line 995 "gram.y"
+#line 997 "gram.y"
                                        {
 			    if (!alias_add(&parsed_policy, (yyvsp[-3].string), CMNDALIAS,
 				sudoers, alias_line, alias_column, (yyvsp[0].member))) {
@@ -2917,30 +2919,30 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[-3].string));
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			}
-#line 2920 "gram.c"
+#line 2922 "gram.c"
     break;
 
   case 129: /* cmndlist: cmndlist ',' digcmnd  */
-#line 1008 "gram.y"
+#line 1010 "gram.y"
                                              {
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			    HLTQ_CONCAT((yyvsp[-2].member), (yyvsp[0].member), entries);
 			    (yyval.member) = (yyvsp[-2].member);
 			}
-#line 2930 "gram.c"
+#line 2932 "gram.c"
     break;
 
   case 132: /* $@3: %empty  */
-#line 1019 "gram.y"
+#line 1021 "gram.y"
                               {
 			    alias_line = this_lineno;
 			    alias_column = (int)sudolinebuf.toke_start + 1;
 			}
-#line 2939 "gram.c"
+#line 2941 "gram.c"
     break;
 
   case 133: /* runasalias: ALIAS $@3 '=' userlist  */
-#line 1022 "gram.y"
+#line 1024 "gram.y"
                                        {
 			    if (!alias_add(&parsed_policy, (yyvsp[-3].string), RUNASALIAS,
 				sudoers, alias_line, alias_column, (yyvsp[0].member))) {
@@ -2950,20 +2952,20 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[-3].string));
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			}
-#line 2953 "gram.c"
+#line 2955 "gram.c"
     break;
 
   case 137: /* $@4: %empty  */
-#line 1038 "gram.y"
+#line 1040 "gram.y"
                               {
 			    alias_line = this_lineno;
 			    alias_column = (int)sudolinebuf.toke_start + 1;
 			}
-#line 2962 "gram.c"
+#line 2964 "gram.c"
     break;
 
   case 138: /* useralias: ALIAS $@4 '=' userlist  */
-#line 1041 "gram.y"
+#line 1043 "gram.y"
                                        {
 			    if (!alias_add(&parsed_policy, (yyvsp[-3].string), USERALIAS,
 				sudoers, alias_line, alias_column, (yyvsp[0].member))) {
@@ -2973,39 +2975,39 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[-3].string));
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			}
-#line 2976 "gram.c"
+#line 2978 "gram.c"
     break;
 
   case 141: /* userlist: userlist ',' opuser  */
-#line 1054 "gram.y"
+#line 1056 "gram.y"
                                             {
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			    HLTQ_CONCAT((yyvsp[-2].member), (yyvsp[0].member), entries);
 			    (yyval.member) = (yyvsp[-2].member);
 			}
-#line 2986 "gram.c"
+#line 2988 "gram.c"
     break;
 
   case 142: /* opuser: user  */
-#line 1061 "gram.y"
+#line 1063 "gram.y"
                              {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = false;
 			}
-#line 2995 "gram.c"
+#line 2997 "gram.c"
     break;
 
   case 143: /* opuser: '!' user  */
-#line 1065 "gram.y"
+#line 1067 "gram.y"
                                  {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = true;
 			}
-#line 3004 "gram.c"
+#line 3006 "gram.c"
     break;
 
   case 144: /* user: ALIAS  */
-#line 1071 "gram.y"
+#line 1073 "gram.y"
                               {
 			    (yyval.member) = new_member((yyvsp[0].string), ALIAS);
 			    if ((yyval.member) == NULL) {
@@ -3015,11 +3017,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3018 "gram.c"
+#line 3020 "gram.c"
     break;
 
   case 145: /* user: ALL  */
-#line 1080 "gram.y"
+#line 1082 "gram.y"
                             {
 			    (yyval.member) = new_member(NULL, ALL);
 			    if ((yyval.member) == NULL) {
@@ -3028,11 +3030,11 @@ yyreduce:
 			    }
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3031 "gram.c"
+#line 3033 "gram.c"
     break;
 
   case 146: /* user: NETGROUP  */
-#line 1088 "gram.y"
+#line 1090 "gram.y"
                                  {
 			    (yyval.member) = new_member((yyvsp[0].string), NETGROUP);
 			    if ((yyval.member) == NULL) {
@@ -3042,11 +3044,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3045 "gram.c"
+#line 3047 "gram.c"
     break;
 
   case 147: /* user: USERGROUP  */
-#line 1097 "gram.y"
+#line 1099 "gram.y"
                                   {
 			    (yyval.member) = new_member((yyvsp[0].string), USERGROUP);
 			    if ((yyval.member) == NULL) {
@@ -3056,11 +3058,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3059 "gram.c"
+#line 3061 "gram.c"
     break;
 
   case 148: /* user: WORD  */
-#line 1106 "gram.y"
+#line 1108 "gram.y"
                              {
 			    (yyval.member) = new_member((yyvsp[0].string), WORD);
 			    if ((yyval.member) == NULL) {
@@ -3070,39 +3072,39 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3073 "gram.c"
+#line 3075 "gram.c"
     break;
 
   case 150: /* grouplist: grouplist ',' opgroup  */
-#line 1118 "gram.y"
+#line 1120 "gram.y"
                                               {
 			    parser_leak_remove(LEAK_MEMBER, (yyvsp[0].member));
 			    HLTQ_CONCAT((yyvsp[-2].member), (yyvsp[0].member), entries);
 			    (yyval.member) = (yyvsp[-2].member);
 			}
-#line 3083 "gram.c"
+#line 3085 "gram.c"
     break;
 
   case 151: /* opgroup: group  */
-#line 1125 "gram.y"
+#line 1127 "gram.y"
                               {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = false;
 			}
-#line 3092 "gram.c"
+#line 3094 "gram.c"
     break;
 
   case 152: /* opgroup: '!' group  */
-#line 1129 "gram.y"
+#line 1131 "gram.y"
                                   {
 			    (yyval.member) = (yyvsp[0].member);
 			    (yyval.member)->negated = true;
 			}
-#line 3101 "gram.c"
+#line 3103 "gram.c"
     break;
 
   case 153: /* group: ALIAS  */
-#line 1135 "gram.y"
+#line 1137 "gram.y"
                               {
 			    (yyval.member) = new_member((yyvsp[0].string), ALIAS);
 			    if ((yyval.member) == NULL) {
@@ -3112,11 +3114,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3115 "gram.c"
+#line 3117 "gram.c"
     break;
 
   case 154: /* group: ALL  */
-#line 1144 "gram.y"
+#line 1146 "gram.y"
                             {
 			    (yyval.member) = new_member(NULL, ALL);
 			    if ((yyval.member) == NULL) {
@@ -3125,11 +3127,11 @@ yyreduce:
 			    }
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3128 "gram.c"
+#line 3130 "gram.c"
     break;
 
   case 155: /* group: WORD  */
-#line 1152 "gram.y"
+#line 1154 "gram.y"
                              {
 			    (yyval.member) = new_member((yyvsp[0].string), WORD);
 			    if ((yyval.member) == NULL) {
@@ -3139,11 +3141,11 @@ yyreduce:
 			    parser_leak_remove(LEAK_PTR, (yyvsp[0].string));
 			    parser_leak_add(LEAK_MEMBER, (yyval.member));
 			}
-#line 3142 "gram.c"
+#line 3144 "gram.c"
     break;
 
 
-#line 3146 "gram.c"
+#line 3148 "gram.c"
 
       default: break;
     }
@@ -3336,7 +3338,7 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 1162 "gram.y"
+#line 1164 "gram.y"
 
 /* Like yyerror() but takes a printf-style format string. */
 void
@@ -3463,6 +3465,7 @@ new_default(char *var, char *val, short op)
 
     d->var = var;
     d->val = val;
+    d->idx = sudo_defs_index(var);
     /* d->type = 0; */
     d->op = op;
     /* d->binding = NULL; */
@@ -3898,6 +3901,8 @@ init_parse_tree(struct sudoers_parse_tree *parse_tree, char *lhost, char *shost,
     parse_tree->lhost = lhost;
     parse_tree->ctx = ctx;
     parse_tree->nss = nss;
+    parse_tree->index = NULL;
+    parse_tree->alias_hash = NULL;
 }
 
 /*
@@ -3910,6 +3915,10 @@ reparent_parse_tree(struct sudoers_parse_tree *new_tree)
     TAILQ_CONCAT(&new_tree->defaults, &parsed_policy.defaults, entries);
     new_tree->aliases = parsed_policy.aliases;
     parsed_policy.aliases = NULL;
+    alias_hash_free(&parsed_policy);
+    alias_hash_free(new_tree);
+    sudoers_index_free(new_tree->index);
+    new_tree->index = NULL;
 }
 
 /*
@@ -3922,6 +3931,9 @@ free_parse_tree(struct sudoers_parse_tree *parse_tree)
     free_defaults(&parse_tree->defaults);
     free_aliases(parse_tree->aliases);
     parse_tree->aliases = NULL;
+    alias_hash_free(parse_tree);
+    sudoers_index_free(parse_tree->index);
+    parse_tree->index = NULL;
     free(parse_tree->lhost);
     if (parse_tree->shost != parse_tree->lhost)
 	free(parse_tree->shost);
@@ -173,7 +173,7 @@ extern int sudoersdebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 91 "gram.y"
+#line 93 "gram.y"
 
     struct cmndspec *cmndspec;
     struct defaults *defaults;
@@ -71,7 +71,9 @@ struct sudoers_parse_tree parsed_policy = {
     NULL, /* lhost */
     NULL, /* shost */
     NULL, /* nss */
-    NULL  /* ctx */
+    NULL, /* ctx */
+    NULL, /* index */
+    NULL  /* alias_hash */
 };
 
 /*
@@ -1285,6 +1287,7 @@ new_default(char *var, char *val, short op)
 
     d->var = var;
     d->val = val;
+    d->idx = sudo_defs_index(var);
     /* d->type = 0; */
     d->op = op;
     /* d->binding = NULL; */
@@ -1720,6 +1723,8 @@ init_parse_tree(struct sudoers_parse_tree *parse_tree, char *lhost, char *shost,
     parse_tree->lhost = lhost;
     parse_tree->ctx = ctx;
     parse_tree->nss = nss;
+    parse_tree->index = NULL;
+    parse_tree->alias_hash = NULL;
 }
 
 /*
@@ -1732,6 +1737,10 @@ reparent_parse_tree(struct sudoers_parse_tree *new_tree)
     TAILQ_CONCAT(&new_tree->defaults, &parsed_policy.defaults, entries);
     new_tree->aliases = parsed_policy.aliases;
     parsed_policy.aliases = NULL;
+    alias_hash_free(&parsed_policy);
+    alias_hash_free(new_tree);
+    sudoers_index_free(new_tree->index);
+    new_tree->index = NULL;
 }
 
 /*
@@ -1744,6 +1753,9 @@ free_parse_tree(struct sudoers_parse_tree *parse_tree)
     free_defaults(&parse_tree->defaults);
     free_aliases(parse_tree->aliases);
     parse_tree->aliases = NULL;
+    alias_hash_free(parse_tree);
+    sudoers_index_free(parse_tree->index);
+    parse_tree->index = NULL;
     free(parse_tree->lhost);
     if (parse_tree->shost != parse_tree->lhost)
 	free(parse_tree->shost);
@@ -65,8 +65,12 @@ static struct sudoers_io_operations {
 static struct log_details iolog_details;
 static bool warned = false;
 static bool log_passwords = false;
+static bool iolog_async = false;
+static unsigned int iolog_flush_delay;
 static int iolog_dir_fd = -1;
 static struct timespec last_time;
+static struct iolog_index iolog_index;
+static char *iolog_catalog_dir;
 static void *passprompt_regex_handle;
 static void sudoers_io_setops(void);
 
@@ -200,12 +204,19 @@ free_iolog_details(void)
     free(iolog_details.evlog.submitenv);
     iolog_details.evlog.submitenv = NULL;
     eventlog_free_contents(&iolog_details.evlog);
+    memset(&iolog_details.evlog, 0, sizeof(iolog_details.evlog));
 
     str_list_free(iolog_details.log_servers);
+    iolog_details.log_servers = NULL;
+    free(iolog_catalog_dir);
+    iolog_catalog_dir = NULL;
 #if defined(HAVE_OPENSSL)
     free(iolog_details.ca_bundle);
+    iolog_details.ca_bundle = NULL;
     free(iolog_details.cert_file);
+    iolog_details.cert_file = NULL;
     free(iolog_details.key_file);
+    iolog_details.key_file = NULL;
 #endif /* HAVE_OPENSSL */
 
     debug_return;
@@ -307,6 +318,12 @@ iolog_deserialize_info(struct log_details *details, char * const user_info[],
     evlog->runuid = ROOT_UID;
     evlog->rungid = 0;
     sudo_gettime_real(&evlog->event_time);
+    iolog_async = false;
+    iolog_flush_delay = 0;
+    iolog_set_index(false);
+    free(iolog_catalog_dir);
+    iolog_catalog_dir = NULL;
+    (void)iolog_set_compress_type(NULL);
 
     for (cur = user_info; *cur != NULL; cur++) {
 	switch (**cur) {
@@ -421,6 +438,13 @@ iolog_deserialize_info(struct log_details *details, char * const user_info[],
 		    iolog_files[IOFD_TTYOUT].enabled = true;
 		continue;
 	    }
+	    if (strncmp(*cur, "iolog_catalog=", sizeof("iolog_catalog=") - 1) == 0) {
+		free(iolog_catalog_dir);
+		iolog_catalog_dir = strdup(*cur + sizeof("iolog_catalog=") - 1);
+		if (iolog_catalog_dir == NULL)
+		    goto oom;
+		continue;
+	    }
 	    if (strncmp(*cur, "iolog_compress=", sizeof("iolog_compress=") - 1) == 0) {
 		int val = sudo_strtobool(*cur + sizeof("iolog_compress=") - 1);
 		if (val != -1) {
@@ -431,6 +455,23 @@ iolog_deserialize_info(struct log_details *details, char * const user_info[],
 		}
 		continue;
 	    }
+	    if (strncmp(*cur, "iolog_compress_type=", sizeof("iolog_compress_type=") - 1) == 0) {
+		if (!iolog_set_compress_type(*cur + sizeof("iolog_compress_type=") - 1)) {
+		    sudo_debug_printf(SUDO_DEBUG_WARN,
+			"%s: unsupported compression type %s", __func__, *cur);
+		}
+		continue;
+	    }
+	    if (strncmp(*cur, "iolog_async=", sizeof("iolog_async=") - 1) == 0) {
+		int val = sudo_strtobool(*cur + sizeof("iolog_async=") - 1);
+		if (val != -1) {
+		    iolog_async = val;
+		} else {
+		    sudo_debug_printf(SUDO_DEBUG_WARN,
+			"%s: unable to parse %s", __func__, *cur);
+		}
+		continue;
+	    }
 	    if (strncmp(*cur, "iolog_flush=", sizeof("iolog_flush=") - 1) == 0) {
 		int val = sudo_strtobool(*cur + sizeof("iolog_flush=") - 1);
 		if (val != -1) {
@@ -441,6 +482,28 @@ iolog_deserialize_info(struct log_details *details, char * const user_info[],
 		}
 		continue;
 	    }
+	    if (strncmp(*cur, "iolog_flush_delay=", sizeof("iolog_flush_delay=") - 1) == 0) {
+		unsigned int val = (unsigned int)sudo_strtonum(
+		    *cur + sizeof("iolog_flush_delay=") - 1, 0, UINT_MAX,
+		    &errstr);
+		if (errstr == NULL) {
+		    iolog_flush_delay = val;
+		} else {
+		    sudo_debug_printf(SUDO_DEBUG_WARN,
+			"%s: unable to parse %s: %s", __func__, *cur, errstr);
+		}
+		continue;
+	    }
+	    if (strncmp(*cur, "iolog_index=", sizeof("iolog_index=") - 1) == 0) {
+		int val = sudo_strtobool(*cur + sizeof("iolog_index=") - 1);
+		if (val != -1) {
+		    iolog_set_index(val);
+		} else {
+		    sudo_debug_printf(SUDO_DEBUG_WARN,
+			"%s: unable to parse %s", __func__, *cur);
+		}
+		continue;
+	    }
 	    if (strncmp(*cur, "iolog_mode=", sizeof("iolog_mode=") - 1) == 0) {
 		mode_t mode = sudo_strtomode(*cur + sizeof("iolog_mode=") - 1, &errstr);
 		if (errstr == NULL) {
@@ -731,11 +794,47 @@ sudoers_io_open_local(struct timespec *start_time)
 	goto bad;
     }
 
-    /* Create the timing and I/O log files. */
-    for (i = 0; i < IOFD_MAX; i++) {
-	if (!iolog_open(&iolog_files[i], iolog_dir_fd, i, "w")) {
+    /* Add the session to the catalog used by "sudoreplay -l". */
+    if (iolog_catalog_dir != NULL) {
+	const size_t dirlen = strlen(iolog_catalog_dir);
+
+	if (strncmp(evlog->iolog_path, iolog_catalog_dir, dirlen) == 0 &&
+		evlog->iolog_path[dirlen] == '/') {
+	    evlog->iolog_file = evlog->iolog_path + dirlen + 1;
+	    if (!iolog_catalog_add(evlog)) {
+		log_warning(ctx, SLOG_SEND_MAIL, N_("unable to write to %s/%s"),
+		    iolog_catalog_dir, "catalog");
+	    }
+	}
+    }
+
+    /* Create the timing and I/O log files, possibly in a writer process. */
+    if (iolog_async) {
+	if (!iolog_writer_open(iolog_dir_fd, iolog_files, iolog_flush_delay,
+		&i)) {
+	    if (i < IOFD_MAX) {
+		log_warning(ctx, SLOG_SEND_MAIL, N_("unable to create %s/%s"),
+		    evlog->iolog_path, iolog_fd_to_name(i));
+	    } else {
+		log_warning(ctx, SLOG_SEND_MAIL,
+		    N_("unable to start I/O log writer"));
+	    }
+	    warned = true;
+	    goto bad;
+	}
+    } else {
+	for (i = 0; i < IOFD_MAX; i++) {
+	    if (!iolog_open(&iolog_files[i], iolog_dir_fd, i, "w")) {
+		log_warning(ctx, SLOG_SEND_MAIL, N_("unable to create %s/%s"),
+		    evlog->iolog_path, iolog_fd_to_name(i));
+		warned = true;
+		goto bad;
+	    }
+	}
+	if (iolog_get_index() && !iolog_index_create(&iolog_index,
+		iolog_dir_fd)) {
 	    log_warning(ctx, SLOG_SEND_MAIL, N_("unable to create %s/%s"),
-		evlog->iolog_path, iolog_fd_to_name(i));
+		evlog->iolog_path, "index");
 	    warned = true;
 	    goto bad;
 	}
@@ -751,6 +850,7 @@ bad:
 	    iolog_close(&iolog_files[i], NULL);
 	    iolog_files[i].fd.v = NULL;
 	}
+	iolog_index_close(&iolog_index, NULL);
 	close(iolog_dir_fd);
 	iolog_dir_fd = -1;
     }
@@ -875,12 +975,18 @@ sudoers_io_close_local(int exit_status, int error, const char **errstr)
     unsigned int i;
     debug_decl(sudoers_io_close_local, SUDOERS_DEBUG_PLUGIN);
 
+    /* Wait for the writer process to close the files. */
+    if (iolog_writer_active())
+	(void)iolog_writer_close(errstr);
+
     /* Close the files. */
     for (i = 0; i < IOFD_MAX; i++) {
 	if (iolog_files[i].fd.v == NULL)
 	    continue;
 	iolog_close(&iolog_files[i], errstr);
+	iolog_files[i].fd.v = NULL;
     }
+    iolog_index_close(&iolog_index, errstr);
 
     /* Clear write bits from I/O timing file to indicate completion. */
     if (iolog_dir_fd != -1) {
@@ -962,6 +1068,7 @@ sudoers_io_log_local(int event, const char *buf, unsigned int len,
     struct iolog_file *iol;
     char tbuf[1024];
     char *newbuf = NULL;
+    unsigned int tlen;
     int ret = -1;
     debug_decl(sudoers_io_log_local, SUDOERS_DEBUG_PLUGIN);
 
@@ -983,20 +1090,34 @@ sudoers_io_log_local(int event, const char *buf, unsigned int len,
 	    debug_return_int(-1);
     }
 
-    /* Write I/O log file entry. */
-    if (iolog_write(iol, newbuf ? newbuf : buf, len, errstr) == -1)
-	goto done;
-
-    /* Write timing file entry. */
-    len = (unsigned int)snprintf(tbuf, sizeof(tbuf), "%d %lld.%09ld %u\n",
+    /* Format timing file entry. */
+    tlen = (unsigned int)snprintf(tbuf, sizeof(tbuf), "%d %lld.%09ld %u\n",
 	event, (long long)delay->tv_sec, delay->tv_nsec, len);
-    if (len >= sizeof(tbuf)) {
+    if (tlen >= sizeof(tbuf)) {
 	/* Not actually possible due to the size of tbuf[]. */
 	*errstr = strerror(EOVERFLOW);
 	goto done;
     }
-    if (iolog_write(&iolog_files[IOFD_TIMING], tbuf, len, errstr) == -1)
-	goto done;
+
+    if (iolog_writer_active()) {
+	/* Hand off both entries to the writer process. */
+	if (!iolog_writer_write(event, delay, newbuf ? newbuf : buf, len,
+		tbuf, tlen, errstr))
+	    goto done;
+    } else {
+	/* Write I/O log file entry. */
+	if (iolog_write(iol, newbuf ? newbuf : buf, len, errstr) == -1)
+	    goto done;
+
+	/* Write timing file entry. */
+	if (iolog_write(&iolog_files[IOFD_TIMING], tbuf, tlen, errstr) == -1)
+	    goto done;
+
+	/* Add a checkpoint to the index if needed. */
+	if (!iolog_index_update(&iolog_index, iolog_files, delay,
+		(size_t)len + tlen, errstr))
+	    goto done;
+    }
 
     /* Success. */
     ret = 1;
@@ -1135,6 +1256,28 @@ sudoers_io_log_ttyout(const char *buf, unsigned int len, const char **errstr)
     return sudoers_io_log(buf, len, IO_EVENT_TTYOUT, errstr);
 }
 
+/*
+ * Write an entry to the local timing file and update the index,
+ * or hand it off to the writer process.
+ * Returns true on success and false on error.
+ * Fills in errstr on error.
+ */
+static bool
+sudoers_io_write_timing(const char *tbuf, unsigned int len,
+    struct timespec *delay, const char **errstr)
+{
+    debug_decl(sudoers_io_write_timing, SUDOERS_DEBUG_PLUGIN);
+
+    if (iolog_writer_active()) {
+	debug_return_bool(iolog_writer_write(IOFD_TIMING, delay, NULL, 0,
+	    tbuf, len, errstr));
+    }
+    if (iolog_write(&iolog_files[IOFD_TIMING], tbuf, len, errstr) == -1)
+	debug_return_bool(false);
+    debug_return_bool(iolog_index_update(&iolog_index, iolog_files, delay,
+	len, errstr));
+}
+
 static int
 sudoers_io_change_winsize_local(unsigned int lines, unsigned int cols,
     struct timespec *delay, const char **errstr)
@@ -1152,7 +1295,7 @@ sudoers_io_change_winsize_local(unsigned int lines, unsigned int cols,
 	*errstr = strerror(EOVERFLOW);
 	goto done;
     }
-    if (iolog_write(&iolog_files[IOFD_TIMING], tbuf, (size_t)len, errstr) == -1)
+    if (!sudoers_io_write_timing(tbuf, (unsigned int)len, delay, errstr))
 	goto done;
 
     /* Success. */
@@ -1248,7 +1391,7 @@ sudoers_io_suspend_local(const char *signame, struct timespec *delay,
 	*errstr = strerror(EOVERFLOW);
 	goto done;
     }
-    if (iolog_write(&iolog_files[IOFD_TIMING], tbuf, len, errstr) == -1)
+    if (!sudoers_io_write_timing(tbuf, len, delay, errstr))
 	goto done;
 
     /* Success. */
@@ -0,0 +1,562 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Asynchronous I/O log writer.
+ *
+ * When the iolog_async flag is set, the I/O log files are opened and
+ * written by a separate writer process instead of by sudo itself.
+ * Log records are handed off through a pipe, which acts as a bounded
+ * ring buffer between sudo and the writer.  The writer reads records
+ * in batches and only flushes the log files when iolog_flush is set
+ * or when iolog_flush_delay milliseconds have passed since unflushed
+ * data was first written.  A slow I/O log file system only stalls
+ * sudo once the pipe is full.  If iolog_index is set, the writer
+ * also maintains the I/O log's time index.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sudoers.h>
+#include <sudo_iolog.h>
+
+/* Pipe size to request for the record pipe, if supported. */
+#define IOLOG_WRITER_PIPE_SIZE	(1024 * 1024)
+
+/* Initial size of the writer's read buffer. */
+#define IOLOG_WRITER_BUFSIZ	(256 * 1024)
+
+/* Special event for the record sent by iolog_writer_close(). */
+#define IOLOG_WRITER_EOF	-1
+
+/*
+ * Each record consists of a header followed by len bytes of I/O log
+ * data for the event's file and tlen bytes to write to the timing file.
+ * The delay is that of the timing entry, it is used to update the index.
+ * Sudo and the writer are the same binary, so native byte order is used.
+ */
+struct iolog_writer_record {
+    struct timespec delay;
+    int event;
+    unsigned int len;
+    unsigned int tlen;
+};
+
+/*
+ * Status sent by the writer, once after the log files have been opened,
+ * on the first write error and once when all records have been written.
+ * On success, iofd is -1 and error is 0.
+ */
+struct iolog_writer_status {
+    int iofd;
+    int error;
+};
+
+static struct iolog_writer {
+    pid_t pid;
+    int rec_fd;
+    int status_fd;
+    int error;
+} writer = { -1, -1, -1, 0 };
+
+/*
+ * Write the contents of iov to fd, retrying on short writes.
+ * Returns true on success, false on error.
+ */
+static bool
+write_all(int fd, const struct iovec *iov_in, int iovcnt)
+{
+    struct iovec iov[3];
+    ssize_t nwritten;
+    int i;
+
+    memcpy(iov, iov_in, (size_t)iovcnt * sizeof(*iov));
+    i = 0;
+    while (i < iovcnt) {
+	nwritten = writev(fd, iov + i, iovcnt - i);
+	if (nwritten == -1) {
+	    if (errno == EINTR)
+		continue;
+	    return false;
+	}
+	while (i < iovcnt && (size_t)nwritten >= iov[i].iov_len) {
+	    nwritten -= (ssize_t)iov[i].iov_len;
+	    i++;
+	}
+	if (i < iovcnt) {
+	    iov[i].iov_base = (char *)iov[i].iov_base + nwritten;
+	    iov[i].iov_len -= (size_t)nwritten;
+	}
+    }
+    return true;
+}
+
+static void
+send_status(int fd, int iofd, int error)
+{
+    struct iolog_writer_status status;
+    struct iovec iov[1];
+
+    status.iofd = iofd;
+    status.error = error;
+    iov[0].iov_base = &status;
+    iov[0].iov_len = sizeof(status);
+    (void)write_all(fd, iov, 1);
+}
+
+/*
+ * Flush all open I/O log files.
+ */
+static bool
+writer_flush(struct iolog_file *iolog_files, const char **errstr)
+{
+    int i;
+    debug_decl(writer_flush, SUDOERS_DEBUG_UTIL);
+
+    for (i = 0; i < IOFD_MAX; i++) {
+	if (iolog_files[i].fd.v == NULL)
+	    continue;
+	if (!iolog_flush(&iolog_files[i], errstr))
+	    debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
+
+/*
+ * Write a single record to the I/O log files.
+ */
+static bool
+writer_record(struct iolog_file *iolog_files, struct iolog_index *idx,
+    const struct iolog_writer_record *rec, const char *data,
+    const char **errstr)
+{
+    debug_decl(writer_record, SUDOERS_DEBUG_UTIL);
+
+    if (rec->len != 0) {
+	if (rec->event < 0 || rec->event >= IOFD_TIMING ||
+		iolog_files[rec->event].fd.v == NULL) {
+	    *errstr = strerror(EINVAL);
+	    debug_return_bool(false);
+	}
+	if (iolog_write(&iolog_files[rec->event], data, rec->len, errstr) == -1)
+	    debug_return_bool(false);
+    }
+    if (rec->tlen != 0) {
+	if (iolog_write(&iolog_files[IOFD_TIMING], data + rec->len,
+		rec->tlen, errstr) == -1)
+	    debug_return_bool(false);
+	if (!iolog_index_update(idx, iolog_files, &rec->delay,
+		rec->len + rec->tlen, errstr))
+	    debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
+
+/*
+ * Main loop of the writer process, does not return.
+ * Reads records from rfd and writes them to the I/O log files.
+ */
+static void
+writer_main(int dfd, struct iolog_file *iolog_files, unsigned int flush_delay,
+    int rfd, int sfd)
+{
+    const bool flush_always = iolog_get_flush();
+    struct iolog_index idx = { NULL };
+    struct timespec now, deadline;
+    const char *errstr = NULL;
+    size_t bufsize = IOLOG_WRITER_BUFSIZ;
+    size_t len = 0, off;
+    bool dirty = false, done = false;
+    int i, error = 0;
+    char *buf;
+    debug_decl(writer_main, SUDOERS_DEBUG_UTIL);
+
+    /* Create the timing and I/O log files. */
+    for (i = 0; i < IOFD_MAX; i++) {
+	if (!iolog_open(&iolog_files[i], dfd, i, "w")) {
+	    send_status(sfd, i, errno ? errno : EIO);
+	    _exit(EXIT_FAILURE);
+	}
+    }
+    if (iolog_get_index() && !iolog_index_create(&idx, dfd)) {
+	send_status(sfd, IOFD_MAX, errno ? errno : EIO);
+	_exit(EXIT_FAILURE);
+    }
+    if ((buf = malloc(bufsize)) == NULL) {
+	send_status(sfd, IOFD_MAX, errno);
+	_exit(EXIT_FAILURE);
+    }
+    send_status(sfd, -1, 0);
+
+    /* The writer flushes on its own schedule. */
+    iolog_set_flush(false);
+
+    while (!done) {
+	struct pollfd pfd;
+	int timeout = -1;
+	ssize_t nread;
+
+	if (dirty) {
+	    if (sudo_gettime_awake(&now) == -1) {
+		timeout = 0;
+	    } else if (sudo_timespeccmp(&now, &deadline, >=)) {
+		timeout = 0;
+	    } else {
+		struct timespec ts;
+
+		sudo_timespecsub(&deadline, &now, &ts);
+		timeout = (int)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000) + 1;
+	    }
+	}
+	pfd.fd = rfd;
+	pfd.events = POLLIN;
+	switch (poll(&pfd, 1, timeout)) {
+	case -1:
+	    if (errno == EINTR)
+		continue;
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"%s: poll", __func__);
+	    done = true;
+	    continue;
+	case 0:
+	    /* Flush delay expired. */
+	    if (error == 0 && !writer_flush(iolog_files, &errstr)) {
+		error = errno ? errno : EIO;
+		send_status(sfd, IOFD_TIMING, error);
+	    }
+	    dirty = false;
+	    continue;
+	}
+
+	/* Make room for a complete record. */
+	if (len == bufsize) {
+	    char *newbuf = realloc(buf, bufsize * 2);
+	    if (newbuf == NULL) {
+		sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		    "%s: unable to grow buffer", __func__);
+		break;
+	    }
+	    buf = newbuf;
+	    bufsize *= 2;
+	}
+	nread = read(rfd, buf + len, bufsize - len);
+	if (nread <= 0) {
+	    if (nread == -1 && (errno == EINTR || errno == EAGAIN))
+		continue;
+	    /* Sudo exited without closing the log. */
+	    break;
+	}
+	len += (size_t)nread;
+
+	/* Write out all the complete records we have read. */
+	for (off = 0; len - off >= sizeof(struct iolog_writer_record); ) {
+	    struct iolog_writer_record rec;
+
+	    memcpy(&rec, buf + off, sizeof(rec));
+	    if (rec.event == IOLOG_WRITER_EOF) {
+		done = true;
+		off += sizeof(rec);
+		break;
+	    }
+	    if (len - off < sizeof(rec) + rec.len + rec.tlen)
+		break;
+	    if (error == 0 && !writer_record(iolog_files, &idx, &rec,
+		    buf + off + sizeof(rec), &errstr)) {
+		error = errno ? errno : EIO;
+		send_status(sfd, rec.event, error);
+	    }
+	    off += sizeof(rec) + rec.len + rec.tlen;
+	}
+	if (off != 0) {
+	    len -= off;
+	    memmove(buf, buf + off, len);
+
+	    if (error == 0) {
+		if (flush_always) {
+		    if (!writer_flush(iolog_files, &errstr)) {
+			error = errno ? errno : EIO;
+			send_status(sfd, IOFD_TIMING, error);
+		    }
+		} else if (flush_delay != 0 && !dirty) {
+		    /* Flush no later than flush_delay ms from now. */
+		    if (sudo_gettime_awake(&deadline) != -1) {
+			now.tv_sec = flush_delay / 1000;
+			now.tv_nsec = (flush_delay % 1000) * 1000000;
+			sudo_timespecadd(&deadline, &now, &deadline);
+			dirty = true;
+		    }
+		}
+	    }
+	}
+    }
+    free(buf);
+
+    /* Close the files, flushing any buffered data. */
+    for (i = 0; i < IOFD_MAX; i++) {
+	if (iolog_files[i].fd.v == NULL)
+	    continue;
+	if (!iolog_close(&iolog_files[i], &errstr) && error == 0)
+	    error = errno ? errno : EIO;
+    }
+    if (!iolog_index_close(&idx, &errstr) && error == 0)
+	error = errno ? errno : EIO;
+    send_status(sfd, error ? IOFD_MAX : -1, error);
+
+    sudo_debug_exit(__func__, __FILE__, __LINE__, sudo_debug_subsys);
+    _exit(error ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*
+ * Read a status message from the writer.
+ * Returns true on success, false on error or EOF.
+ */
+static bool
+read_status(struct iolog_writer_status *status)
+{
+    char *cp = (char *)status;
+    size_t len = sizeof(*status);
+    ssize_t nread;
+
+    while (len != 0) {
+	nread = read(writer.status_fd, cp, len);
+	if (nread == -1) {
+	    if (errno == EINTR)
+		continue;
+	    return false;
+	}
+	if (nread == 0) {
+	    errno = EPIPE;
+	    return false;
+	}
+	cp += nread;
+	len -= (size_t)nread;
+    }
+    return true;
+}
+
+/*
+ * Fork a writer process that opens the I/O log files in dfd and
+ * writes the records sent by iolog_writer_write().
+ * On failure, sets errno and stores the index of the I/O log file
+ * that could not be opened in iofd (IOFD_MAX if not file-specific).
+ */
+bool
+iolog_writer_open(int dfd, struct iolog_file *iolog_files,
+    unsigned int flush_delay, int *iofd)
+{
+    struct iolog_writer_status status = { -1, 0 };
+    int rec_pipe[2], status_pipe[2];
+    struct sigaction sa;
+    sigset_t mask;
+    debug_decl(iolog_writer_open, SUDOERS_DEBUG_UTIL);
+
+    *iofd = IOFD_MAX;
+    if (pipe2(rec_pipe, O_CLOEXEC) == -1)
+	debug_return_bool(false);
+    if (pipe2(status_pipe, O_CLOEXEC) == -1) {
+	close(rec_pipe[0]);
+	close(rec_pipe[1]);
+	debug_return_bool(false);
+    }
+#ifdef F_SETPIPE_SZ
+    /* A larger pipe lets the writer fall further behind without blocking. */
+    if (fcntl(rec_pipe[1], F_SETPIPE_SZ, IOLOG_WRITER_PIPE_SIZE) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_ERRNO,
+	    "%s: unable to set pipe size to %d", __func__,
+	    IOLOG_WRITER_PIPE_SIZE);
+    }
+#endif
+
+    switch (writer.pid = sudo_debug_fork()) {
+    case -1:
+	close(rec_pipe[0]);
+	close(rec_pipe[1]);
+	close(status_pipe[0]);
+	close(status_pipe[1]);
+	debug_return_bool(false);
+    case 0:
+	/* Child, detach from the terminal so we don't get tty signals. */
+	close(rec_pipe[1]);
+	close(status_pipe[0]);
+	(void)setsid();
+	memset(&sa, 0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_handler = SIG_IGN;
+	(void)sigaction(SIGHUP, &sa, NULL);
+	(void)sigaction(SIGINT, &sa, NULL);
+	(void)sigaction(SIGQUIT, &sa, NULL);
+	(void)sigaction(SIGPIPE, &sa, NULL);
+	(void)sigaction(SIGTSTP, &sa, NULL);
+	sa.sa_handler = SIG_DFL;
+	(void)sigaction(SIGTERM, &sa, NULL);
+	(void)sigaction(SIGCHLD, &sa, NULL);
+	sigemptyset(&mask);
+	(void)sigprocmask(SIG_SETMASK, &mask, NULL);
+	writer_main(dfd, iolog_files, flush_delay, rec_pipe[0],
+	    status_pipe[1]);
+	/* NOTREACHED */
+    }
+    close(rec_pipe[0]);
+    close(status_pipe[1]);
+    writer.rec_fd = rec_pipe[1];
+    writer.status_fd = status_pipe[0];
+    writer.error = 0;
+
+    /* Wait for the writer to open the files. */
+    if (!read_status(&status) || status.error != 0) {
+	const int error = status.error != 0 ? status.error : errno;
+	if (status.error != 0)
+	    *iofd = status.iofd;
+	/* The writer has exited, don't send it an EOF record. */
+	close(writer.rec_fd);
+	writer.rec_fd = -1;
+	iolog_writer_close(NULL);
+	errno = error;
+	debug_return_bool(false);
+    }
+
+    /* Errors will be checked for without blocking as records are sent. */
+    if (fcntl(writer.status_fd, F_SETFL, O_NONBLOCK) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "%s: unable to set O_NONBLOCK on status pipe", __func__);
+    }
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: started I/O log writer %d",
+	__func__, (int)writer.pid);
+
+    debug_return_bool(true);
+}
+
+/*
+ * Returns true if an I/O log writer process is running.
+ */
+bool
+iolog_writer_active(void)
+{
+    return writer.rec_fd != -1;
+}
+
+/*
+ * Hand off len bytes of I/O log data for iofd and tlen bytes of
+ * timing data with the specified delay to the writer.
+ * Only blocks if the pipe is full.
+ * Returns true on success, false on error.
+ * Fills in errstr on error.
+ */
+bool
+iolog_writer_write(int iofd, const struct timespec *delay, const char *buf,
+    unsigned int len, const char *tbuf, unsigned int tlen, const char **errstr)
+{
+    struct iolog_writer_record rec;
+    struct iolog_writer_status status;
+    struct iovec iov[3];
+    debug_decl(iolog_writer_write, SUDOERS_DEBUG_UTIL);
+
+    /* Check for an error reported by the writer. */
+    if (writer.error == 0 && read_status(&status) && status.error != 0)
+	writer.error = status.error;
+    if (writer.error != 0) {
+	*errstr = strerror(writer.error);
+	debug_return_bool(false);
+    }
+
+    rec.delay = *delay;
+    rec.event = iofd;
+    rec.len = len;
+    rec.tlen = tlen;
+    iov[0].iov_base = &rec;
+    iov[0].iov_len = sizeof(rec);
+    iov[1].iov_base = (void *)buf;
+    iov[1].iov_len = len;
+    iov[2].iov_base = (void *)tbuf;
+    iov[2].iov_len = tlen;
+    if (!write_all(writer.rec_fd, iov, 3)) {
+	writer.error = errno;
+	*errstr = strerror(errno);
+	debug_return_bool(false);
+    }
+
+    debug_return_bool(true);
+}
+
+/*
+ * Tell the writer to finish writing and close the I/O log files,
+ * then wait for it to exit.
+ * Returns true on success, false on error.
+ * Fills in errstr on error if it is not NULL.
+ */
+bool
+iolog_writer_close(const char **errstr)
+{
+    struct iolog_writer_record rec;
+    struct iolog_writer_status status;
+    struct iovec iov[1];
+    int flags, error = writer.error;
+    debug_decl(iolog_writer_close, SUDOERS_DEBUG_UTIL);
+
+    if (writer.pid == -1)
+	debug_return_bool(true);
+
+    if (writer.rec_fd != -1) {
+	memset(&rec, 0, sizeof(rec));
+	rec.event = IOLOG_WRITER_EOF;
+	iov[0].iov_base = &rec;
+	iov[0].iov_len = sizeof(rec);
+	(void)write_all(writer.rec_fd, iov, 1);
+	close(writer.rec_fd);
+	writer.rec_fd = -1;
+    }
+
+    /* Wait for the final status, the writer exits after sending it. */
+    flags = fcntl(writer.status_fd, F_GETFL, 0);
+    if (flags != -1 && ISSET(flags, O_NONBLOCK))
+	(void)fcntl(writer.status_fd, F_SETFL, flags & ~O_NONBLOCK);
+    while (read_status(&status)) {
+	if (error == 0)
+	    error = status.error;
+    }
+    close(writer.status_fd);
+    writer.status_fd = -1;
+
+    /* Sudo's SIGCHLD handler may have already reaped the writer. */
+    while (waitpid(writer.pid, NULL, 0) == -1 && errno == EINTR)
+	continue;
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: I/O log writer %d finished: %s",
+	__func__, (int)writer.pid, error ? strerror(error) : "success");
+    writer.pid = -1;
+    writer.error = 0;
+
+    if (error != 0) {
+	if (errstr != NULL)
+	    *errstr = strerror(error);
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
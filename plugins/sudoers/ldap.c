@@ -1942,8 +1942,10 @@ sudo_ldap_query(struct sudoers_context *ctx, const struct sudo_nss *nss,
 	handle->pw = NULL;
     }
 
-    /* Free old userspecs, if any. */
+    /* Free old userspecs and the index built from them, if any. */
     free_userspecs(&handle->parse_tree.userspecs);
+    sudoers_index_free(handle->parse_tree.index);
+    handle->parse_tree.index = NULL;
 
     DPRINTF1("%s: ldap search user %s, host %s", __func__, pw->pw_name,
 	ctx->runas.host);
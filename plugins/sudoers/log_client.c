@@ -696,6 +696,7 @@ client_closure_free_contents(struct client_closure *closure)
     }
     free(closure->read_buf.data);
     closure->read_buf.data = NULL;
+    logsrv_arena_free(&closure->arena);
     free(closure->iolog_id);
     closure->iolog_id = NULL;
 
@@ -1681,9 +1682,10 @@ handle_server_message(const uint8_t *buf, size_t len,
     debug_decl(handle_server_message, SUDOERS_DEBUG_UTIL);
 
     sudo_debug_printf(SUDO_DEBUG_INFO, "%s: unpacking ServerMessage", __func__);
-    msg = server_message__unpack(NULL, len, buf);
+    msg = server_message__unpack(&closure->arena.allocator, len, buf);
     if (msg == NULL) {
 	sudo_warnx(U_("unable to unpack %s size %zu"), "ServerMessage", len);
+	logsrv_arena_reset(&closure->arena);
 	debug_return_bool(false);
     }
 
@@ -1719,7 +1721,7 @@ handle_server_message(const uint8_t *buf, size_t len,
 	break;
     }
 
-    server_message__free_unpacked(msg, NULL);
+    logsrv_arena_reset(&closure->arena);
     debug_return_bool(ret);
 }
 
@@ -2078,6 +2080,7 @@ client_closure_alloc(struct log_details *details, struct timespec *start_time,
 
     TAILQ_INIT(&closure->write_bufs);
     TAILQ_INIT(&closure->free_bufs);
+    logsrv_arena_init(&closure->arena);
 
     closure->read_buf.size = 64 * 1024;
     closure->read_buf.data = malloc(closure->read_buf.size);
@@ -29,6 +29,7 @@
 #endif /* HAVE_OPENSSL */
 
 #include <log_server.pb-c.h>
+#include <logsrv_arena.h>
 
 #ifndef INET_ADDRSTRLEN
 # define INET_ADDRSTRLEN 16
@@ -95,6 +96,7 @@ struct client_closure {
     struct connection_buffer_list write_bufs;
     struct connection_buffer_list free_bufs;
     struct connection_buffer read_buf;
+    struct logsrv_arena arena;
     struct sudo_plugin_event *read_ev;
     struct sudo_plugin_event *write_ev;
     struct log_details *log_details;
@@ -87,6 +87,10 @@ sudoers_lookup_pseudo(struct sudo_nss_list *snl, struct sudoers_context *ctx,
 	    break;
 	}
 
+	/* Each alias and member only needs to be matched once per source. */
+	alias_memo_begin(nss->parse_tree);
+	member_memo_begin();
+
 	/*
 	 * We have to traverse the policy forwards, not in reverse,
 	 * to support the "pwcheck == all" case.
@@ -202,6 +206,8 @@ sudoers_lookup_pseudo(struct sudo_nss_list *snl, struct sudoers_context *ctx,
 		}
 	    }
 	}
+	alias_memo_end(nss->parse_tree);
+	member_memo_end();
 	if (!sudo_nss_can_continue(nss, match))
 	    break;
     }
@@ -225,38 +231,107 @@ sudoers_lookup_pseudo(struct sudo_nss_list *snl, struct sudoers_context *ctx,
     debug_return_uint(validated);
 }
 
+/*
+ * Return the index for the parse tree with the candidates for the
+ * current user and command selected, building it first if needed.
+ * Returns NULL if the index cannot be used.
+ */
+static struct sudoers_index *
+lookup_index(struct sudoers_parse_tree *parse_tree,
+    const struct sudoers_context *ctx)
+{
+    debug_decl(lookup_index, SUDOERS_DEBUG_PARSER);
+
+    if (parse_tree->index == NULL)
+	parse_tree->index = sudoers_index_build(parse_tree);
+    if (parse_tree->index != NULL) {
+	if (!sudoers_index_select(parse_tree->index, parse_tree,
+		ctx->user.pw, ctx->user.cmnd_base))
+	    debug_return_ptr(NULL);
+    }
+    debug_return_ptr(parse_tree->index);
+}
+
+/*
+ * Return the userspec to check before us, or the last userspec if
+ * us is NULL.  If idx is not NULL, only the candidate userspecs are
+ * returned and *np is set to the position in idx->candidates.
+ */
+static struct userspec *
+prev_userspec(const struct sudoers_parse_tree *parse_tree,
+    const struct sudoers_index *idx, struct userspec *us, unsigned int *np)
+{
+    if (idx != NULL) {
+	if (us == NULL)
+	    *np = idx->ncandidates;
+	if (*np == 0)
+	    return NULL;
+	return idx->userspecs[idx->candidates[--(*np)]];
+    }
+    if (us == NULL)
+	return TAILQ_LAST(&parse_tree->userspecs, userspec_list);
+    return TAILQ_PREV(us, userspec_list, entries);
+}
+
 static int
 sudoers_lookup_check(struct sudo_nss *nss, struct sudoers_context *ctx,
     unsigned int *validated, struct cmnd_info *info, time_t now,
     sudoers_lookup_callback_fn_t callback, void *cb_data,
-    struct cmndspec **matching_cs, struct defaults_list **defs)
+    struct cmndspec **matching_cs, struct defaults_list **defs,
+    bool use_index)
 {
+    struct sudoers_parse_tree *parse_tree = nss->parse_tree;
+    struct sudoers_index *idx = NULL;
     struct cmndspec *cs;
     struct privilege *priv;
     struct userspec *us;
+    unsigned int n = 0, p = 0, c = 0;
     debug_decl(sudoers_lookup_check, SUDOERS_DEBUG_PARSER);
 
     memset(info, 0, sizeof(*info));
 
-    TAILQ_FOREACH_REVERSE(us, &nss->parse_tree->userspecs, userspec_list, entries) {
-	const int user_match = userlist_matches(nss->parse_tree, ctx->user.pw,
+    /* Each alias and member only needs to be matched once per lookup. */
+    alias_memo_begin(parse_tree);
+    member_memo_begin();
+
+    /*
+     * The index skips userspecs, privileges and cmndspecs that cannot
+     * match.  Skipped entries would have matched as UNSPEC so the
+     * result, and the callbacks made, are the same either way.
+     */
+    if (use_index)
+	idx = lookup_index(parse_tree, ctx);
+
+    for (us = prev_userspec(parse_tree, idx, NULL, &n); us != NULL;
+	    us = prev_userspec(parse_tree, idx, us, &n)) {
+	const int user_match = userlist_matches(parse_tree, ctx->user.pw,
 	    &us->users);
 	if (user_match != ALLOW) {
 	    if (callback != NULL && user_match == DENY) {
-		callback(nss->parse_tree, us, user_match, NULL, UNSPEC, NULL,
+		callback(parse_tree, us, user_match, NULL, UNSPEC, NULL,
 		    UNSPEC, UNSPEC, UNSPEC, cb_data);
 	    }
 	    continue;
 	}
 	CLR(*validated, FLAG_NO_USER);
+	if (idx != NULL)
+	    p = idx->priv_start[idx->candidates[n] + 1];
 	TAILQ_FOREACH_REVERSE(priv, &us->privileges, privilege_list, entries) {
-	    const int host_match = hostlist_matches(nss->parse_tree,
-		ctx->user.pw, &priv->hostlist);
+	    int host_match = UNSPEC;
+
+	    if (idx != NULL) {
+		p--;
+		c = idx->cs_start[p + 1];
+	    }
+	    if (idx == NULL || sudoers_index_host_candidate(idx, p)) {
+		host_match = hostlist_matches(parse_tree, ctx->user.pw,
+		    &priv->hostlist);
+	    }
 	    if (host_match == ALLOW) {
 		CLR(*validated, FLAG_NO_HOST);
 	    } else {
 		if (callback != NULL) {
-		    callback(nss->parse_tree, us, user_match, priv, host_match,
+		    callback(parse_tree, us, user_match, priv, host_match,
 			NULL, UNSPEC, UNSPEC, UNSPEC, cb_data);
 		}
 		continue;
@@ -266,6 +341,8 @@ sudoers_lookup_check(struct sudo_nss *nss, struct sudoers_context *ctx,
 		int date_match = UNSPEC;
 		int runas_match = UNSPEC;
 
+		if (idx != NULL)
+		    c--;
 		if (cs->notbefore != UNSPEC) {
 		    date_match = now < cs->notbefore ? DENY : ALLOW;
 		}
@@ -273,15 +350,16 @@ sudoers_lookup_check(struct sudo_nss *nss, struct sudoers_context *ctx,
 		    date_match = now > cs->notafter ? DENY : ALLOW;
 		}
 		if (date_match != DENY) {
-		    runas_match = runaslist_matches(nss->parse_tree,
+		    runas_match = runaslist_matches(parse_tree,
 			cs->runasuserlist, cs->runasgrouplist);
-		    if (runas_match == ALLOW) {
-			cmnd_match = cmnd_matches(nss->parse_tree, cs->cmnd,
+		    if (runas_match == ALLOW && (idx == NULL ||
+			    sudoers_index_cmnd_candidate(idx, c))) {
+			cmnd_match = cmnd_matches(parse_tree, cs->cmnd,
 			    cs->runchroot, info);
 		    }
 		}
 		if (callback != NULL) {
-		    callback(nss->parse_tree, us, user_match, priv, host_match,
+		    callback(parse_tree, us, user_match, priv, host_match,
 			cs, date_match, runas_match, cmnd_match, cb_data);
 		}
 
@@ -292,6 +370,8 @@ sudoers_lookup_check(struct sudo_nss *nss, struct sudoers_context *ctx,
 			"userspec matched @ %s:%d:%d: %s",
 			us->file ? us->file : "???", us->line, us->column,
 			cmnd_match ? "allowed" : "denied");
+		    alias_memo_end(parse_tree);
+		    member_memo_end();
 		    debug_return_int(cmnd_match);
 		}
 		free(info->cmnd_path);
@@ -299,6 +379,8 @@ sudoers_lookup_check(struct sudo_nss *nss, struct sudoers_context *ctx,
 	    }
 	}
     }
+    alias_memo_end(parse_tree);
+    member_memo_end();
     debug_return_int(UNSPEC);
 }
 
@@ -306,7 +388,7 @@ sudoers_lookup_check(struct sudo_nss *nss, struct sudoers_context *ctx,
  * Apply cmndspec-specific settings including SELinux role/type,
  * AppArmor profile, Solaris privs, and command tags.
  */
-static bool
+bool
 apply_cmndspec(struct sudoers_context *ctx, struct cmndspec *cs)
 {
     debug_decl(apply_cmndspec, SUDOERS_DEBUG_PARSER);
@@ -522,7 +604,7 @@ sudoers_lookup(struct sudo_nss_list *snl, struct sudoers_context *ctx,
 	}
 
 	m = sudoers_lookup_check(nss, ctx, &validated, &info, now, callback,
-	    cb_data, &cs, &defs);
+	    cb_data, &cs, &defs, true);
 	if (SPECIFIED(m)) {
 	    match = m;
 	    parse_tree = nss->parse_tree;
@@ -553,3 +635,76 @@ sudoers_lookup(struct sudo_nss_list *snl, struct sudoers_context *ctx,
 	SET(validated, VALIDATE_ERROR);
     debug_return_uint(validated);
 }
+
+/*
+ * Time iterations lookups of the command in ctx, first with a linear
+ * scan of each sudoers source and then using the index.  The elapsed
+ * times are stored in unindexed and indexed.  No callback is used and
+ * the parse tree settings are not applied to ctx.
+ * Returns false if the two methods do not produce the same result.
+ */
+bool
+sudoers_lookup_timing(struct sudo_nss_list *snl, struct sudoers_context *ctx,
+    time_t now, unsigned int iterations, struct timespec *unindexed,
+    struct timespec *indexed)
+{
+    struct cmndspec *cs[2] = { NULL, NULL };
+    struct defaults_list *defs;
+    struct timespec start, end;
+    struct sudo_nss *nss;
+    struct cmnd_info info;
+    unsigned int validated[2];
+    unsigned int i, pass;
+    int m, match[2];
+    bool ret = true;
+    debug_decl(sudoers_lookup_timing, SUDOERS_DEBUG_PARSER);
+
+    /* Need to be runas user while stat'ing things. */
+    if (!set_perms(ctx, PERM_RUNAS))
+	debug_return_bool(false);
+
+    /* Pass 0 is unindexed, pass 1 uses the index. */
+    for (pass = 0; pass < 2; pass++) {
+	if (sudo_gettime_mono(&start) == -1) {
+	    ret = false;
+	    break;
+	}
+	for (i = 0; i < iterations; i++) {
+	    validated[pass] = FLAG_NO_USER | FLAG_NO_HOST;
+	    match[pass] = UNSPEC;
+	    cs[pass] = NULL;
+	    TAILQ_FOREACH(nss, snl, entries) {
+		struct cmndspec *ncs = NULL;
+
+		if (nss->query(ctx, nss, ctx->user.pw) == -1) {
+		    SET(validated[pass], VALIDATE_ERROR);
+		    break;
+		}
+		m = sudoers_lookup_check(nss, ctx, &validated[pass], &info,
+		    now, NULL, NULL, &ncs, &defs, pass != 0);
+		free(info.cmnd_path);
+		if (SPECIFIED(m)) {
+		    match[pass] = m;
+		    cs[pass] = ncs;
+		}
+		if (!sudo_nss_can_continue(nss, m))
+		    break;
+	    }
+	}
+	if (sudo_gettime_mono(&end) == -1) {
+	    ret = false;
+	    break;
+	}
+	sudo_timespecsub(&end, &start, pass ? indexed : unindexed);
+    }
+    if (ret && iterations != 0) {
+	if (match[0] != match[1] || cs[0] != cs[1] ||
+		validated[0] != validated[1]) {
+	    sudo_warnx("indexed lookup does not match unindexed lookup");
+	    ret = false;
+	}
+    }
+    if (!restore_perms())
+	ret = false;
+    debug_return_bool(ret);
+}
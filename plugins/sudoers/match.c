@@ -53,6 +53,198 @@
 #include <sudoers.h>
 #include <gram.h>
 
+/*
+ * Member match results are memoized for the duration of a single
+ * policy check.  The same netgroup, group, host name or network
+ * address is often referenced by many rules and evaluating it may
+ * require an NSS or LDAP query.  The key is the member type and name
+ * along with the user and host being matched; the stored result
+ * does not include the member's negation.
+ */
+#define MEMBER_MEMO_USER	0
+#define MEMBER_MEMO_HOST	1
+
+struct member_memo_entry {
+    const char *name;
+    const void *pw;
+    const char *lhost;
+    const char *shost;
+    const void *nss;
+    unsigned int hash;
+    short kind;
+    short type;
+    int result;
+};
+
+static struct member_memo {
+    struct member_memo_entry *entries;
+    unsigned int size;
+    unsigned int count;
+    unsigned int hits;
+    unsigned int misses;
+    bool active;
+} member_memo;
+
+/*
+ * Start memoizing member match results.
+ */
+void
+member_memo_begin(void)
+{
+    debug_decl(member_memo_begin, SUDOERS_DEBUG_MATCH);
+
+    free(member_memo.entries);
+    memset(&member_memo, 0, sizeof(member_memo));
+    member_memo.active = true;
+
+    debug_return;
+}
+
+/*
+ * Stop memoizing member match results and free the memo table.
+ */
+void
+member_memo_end(void)
+{
+    debug_decl(member_memo_end, SUDOERS_DEBUG_MATCH);
+
+    if (member_memo.active) {
+	sudo_debug_printf(SUDO_DEBUG_INFO,
+	    "member match memo: %u hits, %u misses, %u entries",
+	    member_memo.hits, member_memo.misses, member_memo.count);
+    }
+    free(member_memo.entries);
+    memset(&member_memo, 0, sizeof(member_memo));
+
+    debug_return;
+}
+
+/* FNV-1a hash of the member name, type and kind. */
+static unsigned int
+member_memo_hash(short kind, const struct member *m)
+{
+    const char *cp;
+    unsigned int h = 2166136261U;
+
+    for (cp = m->name; *cp != '\0'; cp++) {
+	h ^= (unsigned char)*cp;
+	h *= 16777619U;
+    }
+    h ^= (unsigned int)(m->type << 1 | kind);
+    h *= 16777619U;
+    return h;
+}
+
+/*
+ * Find the slot for the specified key, which is either the slot
+ * holding it or the empty slot where it would be stored.
+ */
+static struct member_memo_entry *
+member_memo_slot(unsigned int h, short kind, const struct member *m,
+    const void *pw, const char *lhost, const char *shost, const void *nss)
+{
+    const unsigned int mask = member_memo.size - 1;
+    unsigned int i = h & mask;
+
+    for (;;) {
+	struct member_memo_entry *e = &member_memo.entries[i];
+	if (e->name == NULL)
+	    return e;
+	if (e->hash == h && e->kind == kind && e->type == m->type &&
+		e->pw == pw && e->lhost == lhost && e->shost == shost &&
+		e->nss == nss && strcmp(e->name, m->name) == 0)
+	    return e;
+	i = (i + 1) & mask;
+    }
+}
+
+/*
+ * Look up the memoized result of matching member m.
+ * Returns true and fills in result if found, else false.
+ */
+static bool
+member_memo_get(short kind, const struct member *m, const void *pw,
+    const char *lhost, const char *shost, const void *nss, int *result)
+{
+    struct member_memo_entry *e;
+    debug_decl(member_memo_get, SUDOERS_DEBUG_MATCH);
+
+    if (!member_memo.active || m->name == NULL)
+	debug_return_bool(false);
+    if (member_memo.count != 0) {
+	e = member_memo_slot(member_memo_hash(kind, m), kind, m, pw,
+	    lhost, shost, nss);
+	if (e->name != NULL) {
+	    member_memo.hits++;
+	    *result = e->result;
+	    debug_return_bool(true);
+	}
+    }
+    member_memo.misses++;
+    debug_return_bool(false);
+}
+
+/*
+ * Store the result of matching member m, growing the table as needed.
+ * The result is simply not stored if memory cannot be allocated.
+ */
+static void
+member_memo_set(short kind, const struct member *m, const void *pw,
+    const char *lhost, const char *shost, const void *nss, int result)
+{
+    struct member_memo_entry *e;
+    unsigned int h, i;
+    debug_decl(member_memo_set, SUDOERS_DEBUG_MATCH);
+
+    if (!member_memo.active || m->name == NULL)
+	debug_return;
+
+    /* Keep the load factor at or below 50%. */
+    if ((member_memo.count + 1) * 2 > member_memo.size) {
+	struct member_memo_entry *old = member_memo.entries;
+	const unsigned int old_size = member_memo.size;
+	const unsigned int new_size = old_size ? old_size * 2 : 64;
+
+	member_memo.entries = calloc(new_size, sizeof(*e));
+	if (member_memo.entries == NULL) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		"unable to allocate memory");
+	    member_memo.entries = old;
+	    debug_return;
+	}
+	member_memo.size = new_size;
+	for (i = 0; i < old_size; i++) {
+	    if (old[i].name == NULL)
+		continue;
+	    h = old[i].hash;
+	    e = &member_memo.entries[h & (new_size - 1)];
+	    while (e->name != NULL) {
+		if (++e == member_memo.entries + new_size)
+		    e = member_memo.entries;
+	    }
+	    *e = old[i];
+	}
+	free(old);
+    }
+
+    h = member_memo_hash(kind, m);
+    e = member_memo_slot(h, kind, m, pw, lhost, shost, nss);
+    if (e->name == NULL) {
+	e->name = m->name;
+	e->pw = pw;
+	e->lhost = lhost;
+	e->shost = shost;
+	e->nss = nss;
+	e->hash = h;
+	e->kind = kind;
+	e->type = m->type;
+	member_memo.count++;
+    }
+    e->result = result;
+
+    debug_return;
+}
+
 /*
  * Check whether user described by pw matches member.
  * Returns ALLOW, DENY or UNSPEC.
@@ -64,7 +256,7 @@ user_matches(const struct sudoers_parse_tree *parse_tree,
     const struct sudoers_context *ctx = parse_tree->ctx;
     const char *lhost = parse_tree->lhost ? parse_tree->lhost : ctx->runas.host;
     const char *shost = parse_tree->shost ? parse_tree->shost : ctx->runas.shost;
-    int matched = UNSPEC;
+    int rc, matched = UNSPEC;
     struct alias *a;
     debug_decl(user_matches, SUDOERS_DEBUG_MATCH);
 
@@ -73,19 +265,33 @@ user_matches(const struct sudoers_parse_tree *parse_tree,
 	    matched = m->negated ? DENY : ALLOW;
 	    break;
 	case NETGROUP:
-	    if (netgr_matches(parse_tree->nss, m->name,
-		def_netgroup_tuple ? lhost : NULL,
-		def_netgroup_tuple ? shost : NULL, pw->pw_name) == ALLOW)
+	    if (!member_memo_get(MEMBER_MEMO_USER, m, pw, lhost, shost,
+		    parse_tree->nss, &rc)) {
+		rc = netgr_matches(parse_tree->nss, m->name,
+		    def_netgroup_tuple ? lhost : NULL,
+		    def_netgroup_tuple ? shost : NULL, pw->pw_name);
+		member_memo_set(MEMBER_MEMO_USER, m, pw, lhost, shost,
+		    parse_tree->nss, rc);
+	    }
+	    if (rc == ALLOW)
 		matched = m->negated ? DENY : ALLOW;
 	    break;
 	case USERGROUP:
-	    if (usergr_matches(m->name, pw->pw_name, pw) == ALLOW)
+	    if (!member_memo_get(MEMBER_MEMO_USER, m, pw, NULL, NULL, NULL,
+		    &rc)) {
+		rc = usergr_matches(m->name, pw->pw_name, pw);
+		member_memo_set(MEMBER_MEMO_USER, m, pw, NULL, NULL, NULL, rc);
+	    }
+	    if (rc == ALLOW)
 		matched = m->negated ? DENY : ALLOW;
 	    break;
 	case ALIAS:
 	    if ((a = alias_get(parse_tree, m->name, USERALIAS)) != NULL) {
 		/* XXX */
-		const int rc = userlist_matches(parse_tree, pw, &a->members);
+		if (!alias_memo_get(parse_tree, a, pw, lhost, shost, &rc)) {
+		    rc = userlist_matches(parse_tree, pw, &a->members);
+		    alias_memo_set(parse_tree, a, pw, lhost, shost, rc);
+		}
 		if (SPECIFIED(rc)) {
 		    if (m->negated) {
 			matched = rc == ALLOW ? DENY : ALLOW;
@@ -154,7 +360,7 @@ runas_userlist_matches(const struct sudoers_parse_tree *parse_tree,
     const struct sudoers_context *ctx = parse_tree->ctx;
     const char *lhost = parse_tree->lhost ? parse_tree->lhost : ctx->runas.host;
     const char *shost = parse_tree->shost ? parse_tree->shost : ctx->runas.shost;
-    int user_matched = UNSPEC;
+    int rc, user_matched = UNSPEC;
     struct member *m;
     struct alias *a;
     debug_decl(runas_userlist_matches, SUDOERS_DEBUG_MATCH);
@@ -165,21 +371,38 @@ runas_userlist_matches(const struct sudoers_parse_tree *parse_tree,
 		user_matched = m->negated ? DENY : ALLOW;
 		break;
 	    case NETGROUP:
-		if (netgr_matches(parse_tree->nss, m->name,
-		    def_netgroup_tuple ? lhost : NULL,
-		    def_netgroup_tuple ? shost : NULL,
-		    ctx->runas.pw->pw_name) == ALLOW)
+		if (!member_memo_get(MEMBER_MEMO_USER, m, ctx->runas.pw,
+			lhost, shost, parse_tree->nss, &rc)) {
+		    rc = netgr_matches(parse_tree->nss, m->name,
+			def_netgroup_tuple ? lhost : NULL,
+			def_netgroup_tuple ? shost : NULL,
+			ctx->runas.pw->pw_name);
+		    member_memo_set(MEMBER_MEMO_USER, m, ctx->runas.pw,
+			lhost, shost, parse_tree->nss, rc);
+		}
+		if (rc == ALLOW)
 		    user_matched = m->negated ? DENY : ALLOW;
 		break;
 	    case USERGROUP:
-		if (usergr_matches(m->name, ctx->runas.pw->pw_name, ctx->runas.pw) == ALLOW)
+		if (!member_memo_get(MEMBER_MEMO_USER, m, ctx->runas.pw,
+			NULL, NULL, NULL, &rc)) {
+		    rc = usergr_matches(m->name, ctx->runas.pw->pw_name,
+			ctx->runas.pw);
+		    member_memo_set(MEMBER_MEMO_USER, m, ctx->runas.pw,
+			NULL, NULL, NULL, rc);
+		}
+		if (rc == ALLOW)
 		    user_matched = m->negated ? DENY : ALLOW;
 		break;
 	    case ALIAS:
 		a = alias_get(parse_tree, m->name, RUNASALIAS);
 		if (a != NULL) {
-		    const int rc = runas_userlist_matches(parse_tree,
-			&a->members);
+		    if (!alias_memo_get(parse_tree, a, ctx->runas.pw, lhost,
+			    shost, &rc)) {
+			rc = runas_userlist_matches(parse_tree, &a->members);
+			alias_memo_set(parse_tree, a, ctx->runas.pw, lhost,
+			    shost, rc);
+		    }
 		    if (SPECIFIED(rc)) {
 			if (m->negated) {
 			    user_matched = rc == ALLOW ? DENY : ALLOW;
@@ -376,7 +599,7 @@ host_matches(const struct sudoers_parse_tree *parse_tree,
     const struct member *m)
 {
     struct alias *a;
-    int ret = UNSPEC;
+    int rc, ret = UNSPEC;
     debug_decl(host_matches, SUDOERS_DEBUG_MATCH);
 
     switch (m->type) {
@@ -384,20 +607,34 @@ host_matches(const struct sudoers_parse_tree *parse_tree,
 	    ret = m->negated ? DENY : ALLOW;
 	    break;
 	case NETGROUP:
-	    if (netgr_matches(parse_tree->nss, m->name, lhost, shost,
-		def_netgroup_tuple ? pw->pw_name : NULL) == ALLOW)
+	    if (!member_memo_get(MEMBER_MEMO_HOST, m, pw, lhost, shost,
+		    parse_tree->nss, &rc)) {
+		rc = netgr_matches(parse_tree->nss, m->name, lhost, shost,
+		    def_netgroup_tuple ? pw->pw_name : NULL);
+		member_memo_set(MEMBER_MEMO_HOST, m, pw, lhost, shost,
+		    parse_tree->nss, rc);
+	    }
+	    if (rc == ALLOW)
 		ret = m->negated ? DENY : ALLOW;
 	    break;
 	case NTWKADDR:
-	    if (addr_matches(m->name) == ALLOW)
+	    if (!member_memo_get(MEMBER_MEMO_HOST, m, NULL, NULL, NULL, NULL,
+		    &rc)) {
+		rc = addr_matches(m->name);
+		member_memo_set(MEMBER_MEMO_HOST, m, NULL, NULL, NULL, NULL, rc);
+	    }
+	    if (rc == ALLOW)
 		ret = m->negated ? DENY : ALLOW;
 	    break;
 	case ALIAS:
 	    a = alias_get(parse_tree, m->name, HOSTALIAS);
 	    if (a != NULL) {
 		/* XXX */
-		const int rc = hostlist_matches_int(parse_tree, pw, lhost,
-		    shost, &a->members);
+		if (!alias_memo_get(parse_tree, a, pw, lhost, shost, &rc)) {
+		    rc = hostlist_matches_int(parse_tree, pw, lhost, shost,
+			&a->members);
+		    alias_memo_set(parse_tree, a, pw, lhost, shost, rc);
+		}
 		if (SPECIFIED(rc)) {
 		    if (m->negated) {
 			ret = rc == ALLOW ? DENY : ALLOW;
@@ -410,7 +647,13 @@ host_matches(const struct sudoers_parse_tree *parse_tree,
 	    }
 	    FALLTHROUGH;
 	case WORD:
-	    if (hostname_matches(shost, lhost, m->name) == ALLOW)
+	    if (!member_memo_get(MEMBER_MEMO_HOST, m, NULL, lhost, shost, NULL,
+		    &rc)) {
+		rc = hostname_matches(shost, lhost, m->name);
+		member_memo_set(MEMBER_MEMO_HOST, m, NULL, lhost, shost, NULL,
+		    rc);
+	    }
+	    if (rc == ALLOW)
 		ret = m->negated ? DENY : ALLOW;
 	    break;
     }
@@ -78,8 +78,8 @@ digest_matches(int fd, const char *path, const char *runchroot,
 	/* Compute file digest if needed. */
 	if (digest->digest_type != digest_type) {
 	    free(file_digest);
-	    file_digest = sudo_filedigest(fd, path, digest->digest_type,
-		&digest_len);
+	    file_digest = sudo_filedigest_cached(fd, path,
+		digest->digest_type, def_digest_cache_dir, &digest_len);
 	    if (lseek(fd, (off_t)0, SEEK_SET) == -1) {
 		sudo_debug_printf(
 		    SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
@@ -88,7 +88,7 @@ digest_matches(int fd, const char *path, const char *runchroot,
 	    digest_type = digest->digest_type;
 	}
 	if (file_digest == NULL) {
-	    /* Warning (if any) printed by sudo_filedigest() */
+	    /* Warning (if any) printed by sudo_filedigest_cached() */
 	    goto done;
 	}
 
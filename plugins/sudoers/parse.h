@@ -282,6 +282,11 @@ struct alias {
     int column;				/* column number of alias entry */
     char *file;				/* file the alias entry was in */
     struct member_list members;		/* list of alias members */
+    struct alias_memo {			/* match result for current lookup */
+	unsigned int generation;
+	const void *key[3];
+	int result;
+    } memo;
 };
 
 /*
@@ -297,6 +302,7 @@ struct defaults {
     int op;				/* true, false, '+', '-' */
     int line;				/* line number of Defaults entry */
     int column;				/* column number of Defaults entry */
+    int idx;				/* sudo_defs_table[] index or -1 */
 };
 
 struct sudoers_match_info {
@@ -306,9 +312,49 @@ struct sudoers_match_info {
     const struct cmndspec *cs;		/* matching cmndspec */
 };
 
+/*
+ * Index over the userspecs in a parse tree, see sudoers_index.c.
+ * Userspecs, privileges and cmndspecs are identified by their
+ * position in the parse tree.  An entry is a candidate for the
+ * current lookup if its stamp matches the current generation.
+ */
+struct sudoers_index {
+    struct rbtree *users;		/* user name -> userspecs */
+    struct rbtree *groups;		/* %group -> userspecs */
+    struct rbtree *group_names;		/* plain group name -> userspecs */
+    struct rbtree *special_groups;	/* %#gid, %:group -> userspecs */
+    struct rbtree *hosts;		/* host name -> privileges */
+    struct rbtree *cmnds;		/* command base name -> cmndspecs */
+    struct userspec **userspecs;	/* userspecs in parse tree order */
+    struct privilege **privs;		/* privileges in parse tree order */
+    struct cmndspec **cmndspecs;	/* cmndspecs in parse tree order */
+    unsigned int *priv_start;		/* first privilege of each userspec */
+    unsigned int *cs_start;		/* first cmndspec of each privilege */
+    unsigned int *always;		/* userspecs not indexed by name */
+    unsigned int *candidates;		/* userspecs for the current lookup */
+    unsigned int *userspec_stamp;
+    unsigned int *host_stamp;
+    unsigned int *cmnd_stamp;
+    bool *host_literal;			/* privilege only has literal hosts */
+    bool *cmnd_literal;			/* cmndspec only has literal commands */
+    unsigned int nuserspecs;
+    unsigned int nprivs;
+    unsigned int ncmndspecs;
+    unsigned int nalways;
+    unsigned int always_size;
+    unsigned int ncandidates;
+    unsigned int generation;
+};
+
+#define sudoers_index_host_candidate(_i, _p) \
+    (!(_i)->host_literal[_p] || (_i)->host_stamp[_p] == (_i)->generation)
+#define sudoers_index_cmnd_candidate(_i, _c) \
+    (!(_i)->cmnd_literal[_c] || (_i)->cmnd_stamp[_c] == (_i)->generation)
+
 /*
  * Parsed sudoers policy.
  */
+struct alias_hash;
 struct sudo_nss;
 struct sudoers_parse_tree {
     TAILQ_ENTRY(sudoers_parse_tree) entries;
@@ -318,6 +364,8 @@ struct sudoers_parse_tree {
     char *shost, *lhost;
     struct sudo_nss *nss;
     struct sudoers_context *ctx;
+    struct sudoers_index *index;
+    struct alias_hash *alias_hash;
 };
 
 /*
@@ -379,6 +427,11 @@ bool alias_find_used(struct sudoers_parse_tree *parse_tree, struct rbtree *used_
 bool alias_apply(struct sudoers_parse_tree *parse_tree, int (*func)(struct sudoers_parse_tree *, struct alias *, void *), void *cookie);
 void alias_free(void *a);
 void alias_put(struct alias *a);
+void alias_hash_free(struct sudoers_parse_tree *parse_tree);
+void alias_memo_begin(const struct sudoers_parse_tree *parse_tree);
+void alias_memo_end(const struct sudoers_parse_tree *parse_tree);
+bool alias_memo_get(const struct sudoers_parse_tree *parse_tree, const struct alias *a, const void *key1, const void *key2, const void *key3, int *result);
+void alias_memo_set(const struct sudoers_parse_tree *parse_tree, struct alias *a, const void *key1, const void *key2, const void *key3, int result);
 
 /* check_aliases.c */
 int check_aliases(struct sudoers_parse_tree *parse_tree, bool strict, bool quiet, int (*cb_unused)(struct sudoers_parse_tree *, struct alias *, void *));
@@ -435,6 +488,8 @@ int host_matches(const struct sudoers_parse_tree *parse_tree, const struct passw
 int hostlist_matches(const struct sudoers_parse_tree *parse_tree, const struct passwd *pw, const struct member_list *list);
 int runaslist_matches(const struct sudoers_parse_tree *parse_tree, const struct member_list *user_list, const struct member_list *group_list);
 int user_matches(const struct sudoers_parse_tree *parse_tree, const struct passwd *pw, const struct member *m);
+void member_memo_begin(void);
+void member_memo_end(void);
 int userlist_matches(const struct sudoers_parse_tree *parse_tree, const struct passwd *pw, const struct member_list *list);
 const char *sudo_getdomainname(void);
 struct gid_list *runas_getgroups(const struct sudoers_context *ctx);
@@ -454,12 +509,17 @@ time_t parse_gentime(const char *expstr);
 /* filedigest.c */
 unsigned char *sudo_filedigest(int fd, const char *file, unsigned int digest_type, size_t *digest_len);
 
+/* digest_cache.c */
+unsigned char *sudo_filedigest_cached(int fd, const char *file, unsigned int digest_type, const char *cache_dir, size_t *digest_len);
+
 /* digestname.c */
 const char *digest_type_to_name(unsigned int digest_type);
 
 /* parse.c */
 struct sudo_nss_list;
 unsigned int sudoers_lookup(struct sudo_nss_list *snl, struct sudoers_context *ctx, time_t now, sudoers_lookup_callback_fn_t callback, void *cb_data, int *cmnd_status, int pwflag);
+bool sudoers_lookup_timing(struct sudo_nss_list *snl, struct sudoers_context *ctx, time_t now, unsigned int iterations, struct timespec *unindexed, struct timespec *indexed);
+bool apply_cmndspec(struct sudoers_context *ctx, struct cmndspec *cs);
 
 /* display.c */
 int display_privs(struct sudoers_context *ctx, const struct sudo_nss_list *snl, struct passwd *pw, int verbose);
@@ -486,4 +546,17 @@ bool sudoers_format_default_line(struct sudo_lbuf *lbuf, const struct sudoers_pa
 bool parser_warnx(const struct sudoers_context *ctx, const char *file, int line, int column, bool strict, bool quiet, const char * restrict fmt, ...) sudo_printflike(7, 8);
 bool parser_vwarnx(const struct sudoers_context *ctx, const char *file, int line, int column, bool strict, bool quiet, const char * restrict fmt, va_list ap) sudo_printflike(7, 0);
 
+/* sudoers_cache.c */
+void sudoers_cache_track(bool enable);
+bool sudoers_cache_add_source(const char *path, int fd);
+bool sudoers_cache_add_skipped(const char *path);
+bool sudoers_cache_sources_changed(void);
+bool sudoers_cache_read(const struct sudoers_context *ctx, const char *path, struct sudoers_parse_tree *parse_tree);
+bool sudoers_cache_write(const struct sudoers_context *ctx, const char *path, const struct sudoers_parse_tree *parse_tree);
+
+/* sudoers_index.c */
+struct sudoers_index *sudoers_index_build(const struct sudoers_parse_tree *parse_tree);
+bool sudoers_index_select(struct sudoers_index *idx, const struct sudoers_parse_tree *parse_tree, const struct passwd *pw, const char *cmnd_base);
+void sudoers_index_free(struct sudoers_index *idx);
+
 #endif /* SUDOERS_PARSE_H */
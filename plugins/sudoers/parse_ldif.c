@@ -262,6 +262,7 @@ ldif_store_options(struct sudoers_parse_tree *parse_tree,
 	    sudo_fatalx(U_("%s: %s"), __func__,
 		U_("unable to allocate memory"));
 	}
+	d->idx = sudo_defs_index(var);
 	if (val != NULL) {
 	    if ((d->val = strdup(val)) == NULL) {
 		sudo_fatalx(U_("%s: %s"), __func__,
@@ -32,6 +32,7 @@
 
 #include <sudoers.h>
 #include <sudoers_version.h>
+#include <pwutil.h>
 #include <timestamp.h>
 #include <interfaces.h>
 #include "auth/sudo_auth.h"
@@ -91,6 +92,8 @@ sudoers_policy_deserialize_info(struct sudoers_context *ctx, void *v,
     struct defaults_list *defaults)
 {
     const char *p, *errstr, *groups = NULL;
+    const char *pwutil_cache = NULL;
+    unsigned int pwutil_cache_ttl = PWUTIL_CACHE_TTL;
     struct sudoers_open_info *info = v;
     unsigned int flags = MODE_UPDATE_TICKET;
     const char *host = NULL;
@@ -140,6 +143,12 @@ sudoers_policy_deserialize_info(struct sudoers_context *ctx, void *v,
 		path_sudoers = *cur + sizeof("sudoers_file=") - 1;
 		continue;
 	    }
+	    if (MATCHES(*cur, "sudoers_cache=")) {
+		CHECK(*cur, "sudoers_cache=");
+		ctx->parser_conf.sudoers_cache =
+		    *cur + sizeof("sudoers_cache=") - 1;
+		continue;
+	    }
 	    if (MATCHES(*cur, "sudoers_uid=")) {
 		p = *cur + sizeof("sudoers_uid=") - 1;
 		ctx->parser_conf.sudoers_uid = (uid_t)sudo_strtoid(p, &errstr);
@@ -167,6 +176,27 @@ sudoers_policy_deserialize_info(struct sudoers_context *ctx, void *v,
 		}
 		continue;
 	    }
+	    if (MATCHES(*cur, "pwutil_cache=")) {
+		CHECK(*cur, "pwutil_cache=");
+		pwutil_cache = *cur + sizeof("pwutil_cache=") - 1;
+		continue;
+	    }
+	    if (MATCHES(*cur, "pwutil_cache_ttl=")) {
+		p = *cur + sizeof("pwutil_cache_ttl=") - 1;
+		pwutil_cache_ttl =
+		    (unsigned int)sudo_strtonum(p, 0, INT_MAX, &errstr);
+		if (errstr != NULL) {
+		    sudo_warnx(U_("%s: %s"), *cur, U_(errstr));
+		    goto bad;
+		}
+		continue;
+	    }
+	    if (MATCHES(*cur, "policyd_socket=")) {
+		CHECK(*cur, "policyd_socket=");
+		ctx->settings.policyd_socket =
+		    *cur + sizeof("policyd_socket=") - 1;
+		continue;
+	    }
 	    if (MATCHES(*cur, "ldap_conf=")) {
 		CHECK(*cur, "ldap_conf=");
 		ctx->settings.ldap_conf = *cur + sizeof("ldap_conf=") - 1;
@@ -181,6 +211,15 @@ sudoers_policy_deserialize_info(struct sudoers_context *ctx, void *v,
     }
     ctx->parser_conf.sudoers_path = path_sudoers;
 
+    /* Share passwd and group lookups with other sudo processes. */
+    if (pwutil_cache != NULL) {
+	if (sudo_pwutil_shared_open(pwutil_cache, pwutil_cache_ttl)) {
+	    sudo_pwutil_set_backend(sudo_shared_make_pwitem,
+		sudo_shared_make_gritem, sudo_shared_make_gidlist_item,
+		NULL, NULL);
+	}
+    }
+
     /* Parse command line settings. */
     ctx->settings.flags = 0;
     ctx->user.closefrom = -1;
@@ -681,7 +720,7 @@ sudoers_policy_store_result(struct sudoers_context *ctx, bool accepted,
     }
 
     /* Increase the length of command_info as needed, it is *not* checked. */
-    command_info = calloc(74, sizeof(char *));
+    command_info = calloc(80, sizeof(char *));
     if (command_info == NULL)
 	goto oom;
 
@@ -720,11 +759,42 @@ sudoers_policy_store_result(struct sudoers_context *ctx, bool accepted,
 	if (def_compress_io) {
 	    if ((command_info[info_len++] = strdup("iolog_compress=true")) == NULL)
 		goto oom;
+	    if (def_iolog_compress_type != NULL) {
+		if ((command_info[info_len++] = sudo_new_key_val("iolog_compress_type",
+			def_iolog_compress_type)) == NULL)
+		    goto oom;
+	    }
 	}
 	if (def_iolog_flush) {
 	    if ((command_info[info_len++] = strdup("iolog_flush=true")) == NULL)
 		goto oom;
 	}
+	if (def_iolog_async) {
+	    if ((command_info[info_len++] = strdup("iolog_async=true")) == NULL)
+		goto oom;
+	}
+	if (def_iolog_flush_delay != 0) {
+	    if (asprintf(&command_info[info_len++], "iolog_flush_delay=%u",
+		    def_iolog_flush_delay) == -1)
+		goto oom;
+	}
+	if (def_iolog_index) {
+	    if ((command_info[info_len++] = strdup("iolog_index=true")) == NULL)
+		goto oom;
+	}
+	if (def_iolog_catalog) {
+	    /* The catalog lives in the top-level I/O log directory. */
+	    if (iolog_path != NULL && ctx->iolog_file != NULL) {
+		if (asprintf(&command_info[info_len++], "iolog_catalog=%.*s",
+			(int)(ctx->iolog_file - ctx->iolog_path - 1),
+			ctx->iolog_path) == -1)
+		    goto oom;
+	    } else {
+		if ((command_info[info_len++] = sudo_new_key_val("iolog_catalog",
+			_PATH_SUDO_IO_LOGDIR)) == NULL)
+		    goto oom;
+	    }
+	}
 	if ((command_info[info_len++] = sudo_new_key_val("log_passwords",
 		def_log_passwords ? "true" : "false")) == NULL)
 	    goto oom;
@@ -868,9 +938,18 @@ sudoers_policy_store_result(struct sudoers_context *ctx, bool accepted,
 	if ((command_info[info_len++] = strdup("intercept=true")) == NULL)
 	    goto oom;
     }
+    if (def_intercept && def_intercept_cache_timeout > 0 &&
+	    !def_intercept_authenticate) {
+	if (asprintf(&command_info[info_len++], "intercept_cache_timeout=%u",
+		def_intercept_cache_timeout) == -1)
+	    goto oom;
+    }
     if (def_intercept_type == trace) {
 	if ((command_info[info_len++] = strdup("use_ptrace=true")) == NULL)
 	    goto oom;
+    } else if (def_intercept_type == seccomp) {
+	if ((command_info[info_len++] = strdup("use_seccomp=true")) == NULL)
+	    goto oom;
     }
     if (def_intercept_verify) {
 	if ((command_info[info_len++] = strdup("intercept_verify=true")) == NULL)
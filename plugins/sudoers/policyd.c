@@ -0,0 +1,1010 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * sudo_policyd keeps a parsed copy of the sudoers file and answers
+ * policy questions from the sudoers plugin over a Unix domain socket.
+ * This saves each sudo invocation from having to parse sudoers itself.
+ * The sudoers file is parsed again when it changes or when SIGHUP is
+ * received.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pwd.h>
+#include <grp.h>
+#include <signal.h>
+#include <time.h>
+
+#include <sudoers.h>
+#include <interfaces.h>
+#include <toke.h>
+#include <policyd.h>
+#include <sudo_conf.h>
+#include <sudo_event.h>
+#include <gram.h>
+
+/* The matching sudoers rule, if any. */
+struct policyd_match {
+    const struct userspec *us;
+    const struct cmndspec *cs;
+};
+
+/*
+ * Function Prototypes
+ */
+static bool policyd_setup(struct sudo_event_base *base);
+static void policyd_reload(void);
+static void daemonize(bool nofork);
+static bool record_default(const struct defaults *d);
+static void set_runaspw(struct sudoers_context *ctx, const char *user);
+static void set_runasgr(struct sudoers_context *ctx, const char *group);
+static int policyd_query(struct sudoers_context *ctx, const struct sudo_nss *nss, struct passwd *pw);
+sudo_noreturn static void usage(void);
+
+/*
+ * Globals
+ */
+static struct sudoers_parser_config policyd_conf =
+    SUDOERS_PARSER_CONFIG_INITIALIZER;
+static struct sudoers_parse_tree policy;
+static bool policy_loaded;
+static bool reload_pending;
+static const char *socket_path;
+
+/* Where update_defaults_hook records the Defaults entries it sees. */
+static struct policyd_msg *defaults_reply;
+static const char *defaults_name;
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+int
+main(int argc, char *argv[])
+{
+    struct sudo_event_base *evbase;
+    bool nofork = false;
+    char *cp;
+    int ch;
+    debug_decl(main, SUDOERS_DEBUG_MAIN);
+
+    initprogname(argc > 0 ? argv[0] : "sudo_policyd");
+
+    if (!sudoers_initlocale(setlocale(LC_ALL, ""), def_sudoers_locale))
+	sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    sudo_warn_set_locale_func(sudoers_warn_setlocale);
+    bindtextdomain("sudoers", LOCALEDIR); /* XXX - should have own domain */
+    textdomain("sudoers");
+
+    /* Create the socket readable/writable only by owner. */
+    umask(S_IRWXG|S_IRWXO);
+
+    /* Read sudo.conf and initialize the debug subsystem. */
+    if (sudo_conf_read(NULL, SUDO_CONF_DEBUG) == -1)
+	exit(EXIT_FAILURE);
+    if (!sudoers_debug_register(getprogname(), sudo_conf_debug_files(getprogname())))
+	exit(EXIT_FAILURE);
+
+    policyd_conf.sudoers_path = _PATH_SUDOERS;
+    while ((ch = getopt(argc, argv, "f:ns:V")) != -1) {
+	switch (ch) {
+	case 'f':
+	    policyd_conf.sudoers_path = optarg;
+	    break;
+	case 'n':
+	    nofork = true;
+	    break;
+	case 's':
+	    socket_path = optarg;
+	    break;
+	case 'V':
+	    (void)printf(_("%s version %s\n"), getprogname(),
+		PACKAGE_VERSION);
+	    exit(EXIT_SUCCESS);
+	default:
+	    usage();
+	}
+    }
+    if (socket_path == NULL || argc != optind)
+	usage();
+
+    if (geteuid() != ROOT_UID)
+	sudo_fatalx(U_("%s must be run as root"), getprogname());
+
+    /* Load ip addr/mask for each interface. */
+    if (get_net_ifs(&cp) > 0) {
+	if (!set_interfaces(cp))
+	    sudo_fatal("%s", U_("unable to parse network address list"));
+	free(cp);
+    }
+
+    /* Record the Defaults entries that apply to each request. */
+    update_defaults_hook = record_default;
+
+    /* Parse sudoers before accepting connections. */
+    policyd_reload();
+    if (!policy_loaded)
+	exit(EXIT_FAILURE);
+
+    if ((evbase = sudo_ev_base_alloc()) == NULL)
+	sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    if (!policyd_setup(evbase))
+	exit(EXIT_FAILURE);
+
+    /* Point of no return. */
+    daemonize(nofork);
+    signal(SIGPIPE, SIG_IGN);
+
+    sudo_ev_dispatch(evbase);
+
+    unlink(socket_path);
+    free_parse_tree(&policy);
+    sudo_freepwcache();
+    sudo_freegrcache();
+    sudo_ev_base_free(evbase);
+
+    debug_return_int(EXIT_SUCCESS);
+}
+
+/*
+ * Parse the sudoers file, replacing the current policy on success.
+ * On failure, the old policy is discarded too since it is out of date.
+ */
+static void
+policyd_reload(void)
+{
+    struct sudoers_context ctx = SUDOERS_CONTEXT_INITIALIZER;
+    char *outfile = NULL;
+    FILE *fp;
+    debug_decl(policyd_reload, SUDOERS_DEBUG_MAIN);
+
+    reload_pending = false;
+    free_parse_tree(&policy);
+    init_parse_tree(&policy, NULL, NULL, NULL, NULL);
+    policy_loaded = false;
+
+    /* Record the files we parse so we can tell when they change. */
+    sudoers_cache_track(true);
+
+    ctx.parser_conf = policyd_conf;
+    if (!init_parser(&ctx, NULL))
+	goto done;
+    fp = open_sudoers(policyd_conf.sudoers_path, &outfile, false, NULL);
+    if (fp == NULL)
+	goto done;
+    if (outfile != NULL) {
+	/* Update path to open sudoers file. */
+	sudo_rcstr_delref(sudoers);
+	sudoers = outfile;
+    }
+    if (!sudoers_cache_add_source(sudoers, fileno(fp))) {
+	fclose(fp);
+	goto done;
+    }
+
+    sudoers_setlocale(SUDOERS_LOCALE_SUDOERS, NULL);
+    sudoersin = fp;
+    if (sudoersparse() == 0 && !parse_error) {
+	reparent_parse_tree(&policy);
+	policy_loaded = true;
+    } else {
+	sudo_warnx(U_("parse error in %s"), policyd_conf.sudoers_path);
+    }
+    sudoersin = NULL;
+    fclose(fp);
+
+done:
+    if (!policy_loaded)
+	sudoers_cache_track(false);
+    init_parser(NULL, NULL);
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: policy %s",
+	policyd_conf.sudoers_path, policy_loaded ? "loaded" : "not loaded");
+
+    debug_return;
+}
+
+/*
+ * Called by update_defaults() for each Defaults entry that is set.
+ */
+static bool
+record_default(const struct defaults *d)
+{
+    if (defaults_reply == NULL)
+	return true;
+    return policyd_msg_add_default(defaults_reply, defaults_name, d);
+}
+
+/*
+ * Set runas passwd/group entries based on the request or sudoers.
+ * Note that if runas_group was specified without runas_user we
+ * run the command as the invoking user.
+ */
+static void
+set_runaspw(struct sudoers_context *ctx, const char *user)
+{
+    struct passwd *pw = NULL;
+    debug_decl(set_runaspw, SUDOERS_DEBUG_MAIN);
+
+    if (*user == '#') {
+	const char *errstr;
+	uid_t uid = sudo_strtoid(user + 1, &errstr);
+	if (errstr == NULL) {
+	    if ((pw = sudo_getpwuid(uid)) == NULL)
+		pw = sudo_fakepwnam(user, ctx->user.gid);
+	}
+    }
+    if (pw == NULL)
+	pw = sudo_getpwnam(user);
+    if (pw != NULL) {
+	if (ctx->runas.pw != NULL)
+	    sudo_pw_delref(ctx->runas.pw);
+	ctx->runas.pw = pw;
+    }
+    debug_return;
+}
+
+static void
+set_runasgr(struct sudoers_context *ctx, const char *group)
+{
+    struct group *gr = NULL;
+    debug_decl(set_runasgr, SUDOERS_DEBUG_MAIN);
+
+    if (*group == '#') {
+	const char *errstr;
+	gid_t gid = sudo_strtoid(group + 1, &errstr);
+	if (errstr == NULL) {
+	    if ((gr = sudo_getgrgid(gid)) == NULL)
+		gr = sudo_fakegrnam(group);
+	}
+    }
+    if (gr == NULL)
+	gr = sudo_getgrnam(group);
+    if (gr != NULL) {
+	if (ctx->runas.gr != NULL)
+	    sudo_gr_delref(ctx->runas.gr);
+	ctx->runas.gr = gr;
+    }
+    debug_return;
+}
+
+/*
+ * Callback for runas_default sudoers setting.
+ */
+bool
+cb_runas_default(struct sudoers_context *ctx, const char *file,
+    int line, int column, const union sudo_defs_val *sd_un, int op)
+{
+    debug_decl(cb_runas_default, SUDOERS_DEBUG_MAIN);
+
+    /* Only reset runaspw if user didn't specify one. */
+    if (ctx->runas.user == NULL && ctx->runas.group == NULL)
+	set_runaspw(ctx, sd_un->str);
+    debug_return_bool(true);
+}
+
+static void
+cb_lookup(const struct sudoers_parse_tree *parse_tree,
+    const struct userspec *us, int user_match, const struct privilege *priv,
+    int host_match, const struct cmndspec *cs, int date_match, int runas_match,
+    int cmnd_match, void *closure)
+{
+    struct policyd_match *match = closure;
+
+    if (cmnd_match != UNSPEC) {
+	match->us = us;
+	match->cs = cs;
+    }
+}
+
+/*
+ * Fill in the parts of ctx used to match the command in a check request.
+ * Returns true on success, else false.
+ */
+static bool
+policyd_set_cmnd(struct sudoers_context *ctx, char * const req[],
+    int *cmnd_status)
+{
+    const char *cmnd, *errstr, *val;
+    char *slash;
+    debug_decl(policyd_set_cmnd, SUDOERS_DEBUG_MAIN);
+
+    if ((cmnd = policyd_getval(req, "cmnd")) == NULL)
+	debug_return_bool(false);
+    if ((val = policyd_getval(req, "cmnd_status")) == NULL)
+	debug_return_bool(false);
+    *cmnd_status = (int)sudo_strtonum(val, INT_MIN, INT_MAX, &errstr);
+    if (errstr != NULL)
+	debug_return_bool(false);
+
+    /* The argument vector is only used to resolve the command again. */
+    if ((ctx->runas.argv = calloc(2, sizeof(char *))) == NULL)
+	goto oom;
+    ctx->runas.argv[0] = (char *)policyd_getval(req, "argv0");
+    if (ctx->runas.argv[0] == NULL)
+	ctx->runas.argv[0] = (char *)cmnd;
+    ctx->runas.argc = 1;
+
+    if ((ctx->user.cmnd = strdup(cmnd)) == NULL)
+	goto oom;
+    ctx->user.cmnd_base = sudo_basename(ctx->user.cmnd);
+    if ((val = policyd_getval(req, "cmnd_args")) != NULL) {
+	if ((ctx->user.cmnd_args = strdup(val)) == NULL)
+	    goto oom;
+    }
+    if ((ctx->user.cmnd_stat = calloc(1, sizeof(struct stat))) == NULL)
+	goto oom;
+    if (*cmnd_status == FOUND) {
+	if (stat(ctx->user.cmnd, ctx->user.cmnd_stat) == -1)
+	    memset(ctx->user.cmnd_stat, 0, sizeof(struct stat));
+	if ((slash = strrchr(ctx->user.cmnd, '/')) != NULL) {
+	    *slash = '\0';
+	    ctx->user.cmnd_dir = canon_path(ctx->user.cmnd);
+	    *slash = '/';
+	    if (ctx->user.cmnd_dir == NULL && errno == ENOMEM)
+		goto oom;
+	}
+    }
+
+    debug_return_bool(true);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    debug_return_bool(false);
+}
+
+/*
+ * Add the result of a sudoers lookup to the reply.
+ */
+static void
+policyd_add_match(struct policyd_msg *reply, const struct policyd_match *match)
+{
+    const struct cmndspec *cs = match->cs;
+    debug_decl(policyd_add_match, SUDOERS_DEBUG_MAIN);
+
+    if (match->us != NULL && match->us->file != NULL) {
+	if (match->us->line != 0) {
+	    policyd_msg_add(reply, "source=%s:%d:%d", match->us->file,
+		match->us->line, match->us->column);
+	} else {
+	    policyd_msg_add(reply, "source=%s", match->us->file);
+	}
+    }
+    if (cs == NULL)
+	debug_return;
+
+    policyd_msg_add(reply, "cmndspec=1");
+    if (cs->role != NULL)
+	policyd_msg_add(reply, "role=%s", cs->role);
+    if (cs->type != NULL)
+	policyd_msg_add(reply, "type=%s", cs->type);
+    if (cs->apparmor_profile != NULL)
+	policyd_msg_add(reply, "apparmor_profile=%s", cs->apparmor_profile);
+    if (cs->privs != NULL)
+	policyd_msg_add(reply, "privs=%s", cs->privs);
+    if (cs->limitprivs != NULL)
+	policyd_msg_add(reply, "limitprivs=%s", cs->limitprivs);
+    if (cs->runcwd != NULL)
+	policyd_msg_add(reply, "runcwd=%s", cs->runcwd);
+    if (cs->runchroot != NULL)
+	policyd_msg_add(reply, "runchroot=%s", cs->runchroot);
+    if (cs->timeout > 0)
+	policyd_msg_add(reply, "timeout=%d", cs->timeout);
+#define ADD_TAG(t) do {							\
+    if (cs->tags.t != UNSPEC)						\
+	policyd_msg_add(reply, "tag_" #t "=%d", cs->tags.t ? 1 : 0);	\
+} while (0)
+    ADD_TAG(follow);
+    ADD_TAG(intercept);
+    ADD_TAG(log_input);
+    ADD_TAG(log_output);
+    ADD_TAG(noexec);
+    ADD_TAG(nopasswd);
+    ADD_TAG(send_mail);
+    ADD_TAG(setenv);
+#undef ADD_TAG
+
+    debug_return;
+}
+
+/*
+ * Evaluate a request against the current policy, filling in reply.
+ * Returns NULL on success or an error message on failure.
+ */
+static const char *
+policyd_eval(char * const req[], struct policyd_msg *reply)
+{
+    struct sudoers_context ctx = SUDOERS_CONTEXT_INITIALIZER;
+    struct sudo_nss_list snl = TAILQ_HEAD_INITIALIZER(snl);
+    struct policyd_match match = { NULL };
+    struct sudo_nss policyd_nss;
+    const char *errstr, *request, *val;
+    const char *ret = "invalid request";
+    int cmnd_status = FOUND;
+    unsigned int validated;
+    uid_t uid;
+    time_t now;
+    debug_decl(policyd_eval, SUDOERS_DEBUG_MAIN);
+
+    if ((val = policyd_getval(req, "version")) == NULL ||
+	    sudo_strtonum(val, 1, INT_MAX, &errstr) != POLICYD_PROTOCOL_VERSION) {
+	debug_return_const_str("unsupported protocol version");
+    }
+    if ((request = policyd_getval(req, "request")) == NULL)
+	debug_return_const_str(ret);
+    if (strcmp(request, "defaults") != 0 && strcmp(request, "check") != 0)
+	debug_return_const_str(ret);
+
+    /* The policy must be current and for the same sudoers file. */
+    if (reload_pending || !policy_loaded || sudoers_cache_sources_changed())
+	policyd_reload();
+    if (!policy_loaded)
+	debug_return_const_str("sudoers not loaded");
+    val = policyd_getval(req, "sudoers_file");
+    if (val == NULL || strcmp(val, policyd_conf.sudoers_path) != 0)
+	debug_return_const_str("sudoers file mismatch");
+
+    /*
+     * Passwd and group entries are looked up again for each request
+     * so changes to group membership take effect immediately, just
+     * as they would for a sudo process that parsed sudoers itself.
+     */
+    sudo_freepwcache();
+    sudo_freegrcache();
+
+    /* Invoking user, which must exist in the passwd database. */
+    ctx.parser_conf = policyd_conf;
+    ctx.runas.execfd = -1;
+    if ((val = policyd_getval(req, "user")) == NULL)
+	goto done;
+    if ((ctx.user.name = strdup(val)) == NULL)
+	goto oom;
+    if ((val = policyd_getval(req, "uid")) == NULL)
+	goto done;
+    uid = sudo_strtoid(val, &errstr);
+    if (errstr != NULL)
+	goto done;
+    if ((val = policyd_getval(req, "gid")) == NULL)
+	goto done;
+    ctx.user.gid = sudo_strtoid(val, &errstr);
+    if (errstr != NULL)
+	goto done;
+    ctx.user.pw = sudo_getpwnam(ctx.user.name);
+    if (ctx.user.pw == NULL || ctx.user.pw->pw_uid != uid) {
+	ret = "unknown user";
+	goto done;
+    }
+    ctx.user.uid = uid;
+    if ((val = policyd_getval(req, "groups")) != NULL) {
+	/* Match group rules against the front end's group list. */
+	GETGROUPS_T *gids;
+	int ngids = sudo_parse_gids(val, &ctx.user.gid, &gids);
+	if (ngids == -1)
+	    goto done;
+
+	/* sudo_set_gidlist will adopt gids[] */
+	if (sudo_set_gidlist(ctx.user.pw, ngids, gids, NULL,
+		ENTRY_TYPE_FRONTEND) == -1) {
+	    free(gids);
+	    goto done;
+	}
+    }
+    ctx.user.gid_list = sudo_get_gidlist(ctx.user.pw, ENTRY_TYPE_ANY);
+    if ((val = policyd_getval(req, "mode")) != NULL) {
+	ctx.mode = (unsigned int)sudo_strtonum(val, 0, UINT_MAX, &errstr);
+	if (errstr != NULL)
+	    goto done;
+    }
+    if ((val = policyd_getval(req, "cwd")) != NULL) {
+	if ((ctx.user.cwd = strdup(val)) == NULL)
+	    goto oom;
+    }
+    ctx.user.path = (char *)policyd_getval(req, "path");
+    ctx.runas.user = (char *)policyd_getval(req, "runas_user");
+    ctx.runas.group = (char *)policyd_getval(req, "runas_group");
+    ctx.runas.cwd = (char *)policyd_getval(req, "runas_cwd");
+    ctx.runas.chroot = (char *)policyd_getval(req, "runas_chroot");
+    /* Whether -u and -g were used affects runas matching. */
+    if ((val = policyd_getval(req, "runas_user_specified")) != NULL &&
+	    *val == '1')
+	SET(ctx.settings.flags, RUNAS_USER_SPECIFIED);
+    if ((val = policyd_getval(req, "runas_group_specified")) != NULL &&
+	    *val == '1')
+	SET(ctx.settings.flags, RUNAS_GROUP_SPECIFIED);
+    if ((val = policyd_getval(req, "host")) == NULL)
+	goto done;
+    if (!sudoers_sethost(&ctx, val, NULL))
+	goto oom;
+
+    /* Start from the compiled-in defaults for each request. */
+    if (!init_defaults()) {
+	ret = "unable to initialize sudoers default values";
+	goto done;
+    }
+    sudo_defs_table[I_GROUP_PLUGIN].callback = cb_group_plugin;
+    sudo_defs_table[I_RUNAS_DEFAULT].callback = cb_runas_default;
+    sudo_defs_table[I_SUDOERS_LOCALE].callback = sudoers_locale_callback;
+
+    if (ctx.runas.group != NULL) {
+	set_runasgr(&ctx, ctx.runas.group);
+	set_runaspw(&ctx, ctx.runas.user ? ctx.runas.user : ctx.user.name);
+    } else {
+	set_runaspw(&ctx, ctx.runas.user ? ctx.runas.user : def_runas_default);
+    }
+    if (ctx.runas.pw == NULL ||
+	    (ctx.runas.group != NULL && ctx.runas.gr == NULL)) {
+	/* The plugin handles unknown runas users and groups itself. */
+	ret = "unknown runas user or group";
+	goto done;
+    }
+
+    /* Global Defaults settings. */
+    policy.ctx = &ctx;
+    defaults_reply = reply;
+    defaults_name = "default";
+    (void)update_defaults(&ctx, &policy, NULL,
+	SETDEF_GENERIC|SETDEF_HOST|SETDEF_USER|SETDEF_RUNAS, true);
+    if (def_fqdn) {
+	/* Host name resolution is left to the plugin. */
+	ret = "fqdn not supported";
+	goto done;
+    }
+
+    if (strcmp(request, "check") == 0) {
+	if (!policyd_set_cmnd(&ctx, req, &cmnd_status))
+	    goto done;
+
+	/* Command-specific Defaults settings. */
+	defaults_name = "cmnd_default";
+	(void)update_defaults(&ctx, &policy, NULL, SETDEF_CMND, true);
+
+	/* Fake up a minimal sudo nss list with the parsed policy. */
+	memset(&policyd_nss, 0, sizeof(policyd_nss));
+	policyd_nss.query = policyd_query;
+	policyd_nss.parse_tree = &policy;
+	TAILQ_INSERT_TAIL(&snl, &policyd_nss, entries);
+
+	defaults_name = "lookup_default";
+	time(&now);
+	validated = sudoers_lookup(&snl, &ctx, now, cb_lookup, &match,
+	    &cmnd_status, 0);
+	if (ISSET(validated, VALIDATE_ERROR)) {
+	    ret = "error evaluating sudoers";
+	    goto done;
+	}
+	policyd_msg_add(reply, "validated=%u", validated);
+	policyd_msg_add(reply, "cmnd_status=%d", cmnd_status);
+	policyd_msg_add(reply, "cmnd=%s", ctx.user.cmnd);
+	if (has_cmnd_defaults(&policy))
+	    policyd_msg_add(reply, "cmnd_defaults=1");
+	policyd_add_match(reply, &match);
+    }
+    ret = NULL;
+    goto done;
+
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    ret = "unable to allocate memory";
+done:
+    defaults_reply = NULL;
+    policy.ctx = NULL;
+    /* Command matching may have opened the command for fexecve(). */
+    if (ctx.runas.execfd != -1)
+	close(ctx.runas.execfd);
+    free(ctx.runas.argv);
+    sudoers_ctx_free(&ctx);
+    debug_return_const_str(ret);
+}
+
+/*
+ * Handle a single request on a new connection.
+ */
+static void
+policyd_accept(int fd, int what, void *v)
+{
+    struct policyd_msg reply = { NULL };
+    const char *errstr;
+    char **req = NULL;
+    int sock;
+    uid_t uid;
+    debug_decl(policyd_accept, SUDOERS_DEBUG_MAIN);
+
+    if ((sock = accept(fd, NULL, NULL)) == -1) {
+	if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+	    sudo_warn("accept");
+	debug_return;
+    }
+    (void)fcntl(sock, F_SETFD, FD_CLOEXEC);
+    (void)policyd_set_timeout(sock, POLICYD_TIMEOUT);
+
+    /* Only root may ask about the policy. */
+    if (!policyd_peer_uid(sock, &uid) || uid != ROOT_UID) {
+	sudo_debug_printf(SUDO_DEBUG_WARN,
+	    "rejecting connection from uid %u", (unsigned int)uid);
+	goto done;
+    }
+    if ((req = policyd_read_msg(sock)) == NULL)
+	goto done;
+
+    errstr = policyd_eval(req, &reply);
+    if (errstr != NULL || reply.error) {
+	sudo_debug_printf(SUDO_DEBUG_INFO, "request failed: %s",
+	    errstr ? errstr : "unable to allocate memory");
+	policyd_msg_free(&reply);
+	policyd_msg_add(&reply, "error=%s",
+	    errstr ? errstr : "unable to allocate memory");
+    }
+    (void)policyd_write_msg(sock, &reply);
+
+done:
+    policyd_msg_free(&reply);
+    free(req);
+    close(sock);
+    debug_return;
+}
+
+static void
+signal_cb(int signo, int what, void *v)
+{
+    struct sudo_event_base *base = v;
+    debug_decl(signal_cb, SUDOERS_DEBUG_MAIN);
+
+    switch (signo) {
+	case SIGHUP:
+	    /* Parse sudoers again before the next request. */
+	    reload_pending = true;
+	    break;
+	case SIGINT:
+	case SIGTERM:
+	    sudo_ev_loopexit(base);
+	    break;
+	default:
+	    sudo_warnx(U_("unexpected signal %d"), signo);
+	    break;
+    }
+
+    debug_return;
+}
+
+static void
+register_signal(int signo, struct sudo_event_base *base)
+{
+    struct sudo_event *ev;
+    debug_decl(register_signal, SUDOERS_DEBUG_MAIN);
+
+    ev = sudo_ev_alloc(signo, SUDO_EV_SIGNAL, signal_cb, base);
+    if (ev == NULL)
+	sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    if (sudo_ev_add(base, ev, NULL, false) == -1)
+	sudo_fatal("%s", U_("unable to add event to queue"));
+
+    debug_return;
+}
+
+/*
+ * Create the listening socket and register events.
+ * Returns true on success, else false.
+ */
+static bool
+policyd_setup(struct sudo_event_base *base)
+{
+    struct sockaddr_un sun;
+    struct sudo_event *ev;
+    struct stat sb;
+    int sock;
+    debug_decl(policyd_setup, SUDOERS_DEBUG_MAIN);
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    if (strlcpy(sun.sun_path, socket_path, sizeof(sun.sun_path)) >= sizeof(sun.sun_path)) {
+	errno = ENAMETOOLONG;
+	sudo_warn("%s", socket_path);
+	debug_return_bool(false);
+    }
+
+    /* Remove a stale socket but nothing else. */
+    if (lstat(socket_path, &sb) == 0) {
+	if (!S_ISSOCK(sb.st_mode)) {
+	    sudo_warnx(U_("%s exists but is not a socket"), socket_path);
+	    debug_return_bool(false);
+	}
+	(void)unlink(socket_path);
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == -1) {
+	sudo_warn("socket");
+	debug_return_bool(false);
+    }
+    if (bind(sock, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+	sudo_warn(U_("unable to bind to %s"), socket_path);
+	goto bad;
+    }
+    if (listen(sock, SOMAXCONN) == -1) {
+	sudo_warn("listen");
+	goto bad;
+    }
+    (void)fcntl(sock, F_SETFD, FD_CLOEXEC);
+    if (fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK) == -1) {
+	sudo_warn("fcntl(O_NONBLOCK)");
+	goto bad;
+    }
+
+    ev = sudo_ev_alloc(sock, SUDO_EV_READ|SUDO_EV_PERSIST, policyd_accept,
+	NULL);
+    if (ev == NULL || sudo_ev_add(base, ev, NULL, false) == -1)
+	goto bad;
+
+    register_signal(SIGHUP, base);
+    register_signal(SIGINT, base);
+    register_signal(SIGTERM, base);
+
+    debug_return_bool(true);
+bad:
+    close(sock);
+    (void)unlink(socket_path);
+    debug_return_bool(false);
+}
+
+static void
+daemonize(bool nofork)
+{
+    int fd;
+    debug_decl(daemonize, SUDOERS_DEBUG_MAIN);
+
+    if (chdir("/") == -1)
+	sudo_warn("chdir(\"/\")");
+
+    if (!nofork) {
+	switch (sudo_debug_fork()) {
+	case -1:
+	    sudo_fatal("fork");
+	case 0:
+	    /* child */
+	    break;
+	default:
+	    /* parent, exit */
+	    _exit(EXIT_SUCCESS);
+	}
+
+	/* detach from terminal */
+	if (setsid() == -1)
+	    sudo_fatal("setsid");
+    }
+
+    if ((fd = open(_PATH_DEVNULL, O_RDWR)) != -1) {
+	(void) dup2(fd, STDIN_FILENO);
+	if (!nofork || fcntl(STDOUT_FILENO, F_GETFL) == -1)
+	    (void) dup2(fd, STDOUT_FILENO);
+	if (!nofork || fcntl(STDERR_FILENO, F_GETFL) == -1)
+	    (void) dup2(fd, STDERR_FILENO);
+	if (fd > STDERR_FILENO)
+	    (void) close(fd);
+    }
+
+    debug_return;
+}
+
+static int
+policyd_query(struct sudoers_context *ctx, const struct sudo_nss *nss,
+    struct passwd *pw)
+{
+    /* Nothing to do. */
+    return 0;
+}
+
+/*
+ * Open the sudoers file, checking its ownership and permissions.
+ * Errors are reported using sudo_warn().
+ */
+FILE *
+open_sudoers(const char *path, char **outfile, bool doedit, bool *keepopen)
+{
+    char fnamebuf[PATH_MAX];
+    const char *fname = fnamebuf;
+    FILE *fp = NULL;
+    struct stat sb;
+    int error, fd;
+    debug_decl(open_sudoers, SUDOERS_DEBUG_MAIN);
+
+    if (outfile == NULL) {
+	/* Single file, do not treat as a path. */
+	fname = path;
+	fd = open(fname, O_RDONLY|O_NONBLOCK);
+	if (fd != -1)
+	    (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    } else {
+	/* Could be a colon-separated path of file names. */
+	fd = sudo_open_conf_path(path, fnamebuf, sizeof(fnamebuf), NULL);
+    }
+    error = sudo_secure_fd(fd, S_IFREG, sudoers_file_uid(),
+	sudoers_file_gid(), &sb);
+    switch (error) {
+    case SUDO_PATH_SECURE:
+	if ((fp = fdopen(fd, "r")) == NULL) {
+	    sudo_warn(U_("unable to open %s"), fname);
+	} else {
+	    fd = -1;
+	    (void)fcntl(fileno(fp), F_SETFD, FD_CLOEXEC);
+	    if (outfile != NULL) {
+		*outfile = sudo_rcstr_dup(fname);
+		if (*outfile == NULL) {
+		    sudo_warnx(U_("%s: %s"), __func__,
+			U_("unable to allocate memory"));
+		    fclose(fp);
+		    fp = NULL;
+		}
+	    }
+	}
+	break;
+    case SUDO_PATH_MISSING:
+	sudo_warn(U_("unable to open %s"), path);
+	break;
+    case SUDO_PATH_BAD_TYPE:
+	sudo_warnx(U_("%s is not a regular file"), fname);
+	break;
+    case SUDO_PATH_WRONG_OWNER:
+	sudo_warnx(U_("%s is owned by uid %u, should be %u"), fname,
+	    (unsigned int)sb.st_uid, (unsigned int)sudoers_file_uid());
+	break;
+    case SUDO_PATH_WORLD_WRITABLE:
+	sudo_warnx(U_("%s is world writable"), fname);
+	break;
+    case SUDO_PATH_GROUP_WRITABLE:
+	sudo_warnx(U_("%s is owned by gid %u, should be %u"), fname,
+	    (unsigned int)sb.st_gid, (unsigned int)sudoers_file_gid());
+	break;
+    default:
+	sudo_warnx("%s: internal error, unexpected error %d", __func__, error);
+	break;
+    }
+
+    if (fp == NULL && fd != -1)
+	close(fd);
+
+    debug_return_ptr(fp);
+}
+
+/*
+ * Resolve the command again, for a sudoers rule with a chroot.
+ * This mirrors the version in sudoers.c.
+ */
+int
+set_cmnd_path(struct sudoers_context *ctx, const char *runchroot)
+{
+    char *cmnd_out = NULL;
+    char *path = ctx->user.path;
+    int ret;
+    debug_decl(set_cmnd_path, SUDOERS_DEBUG_MAIN);
+
+    free(ctx->user.cmnd);
+    ctx->user.cmnd = NULL;
+    canon_path_free(ctx->user.cmnd_dir);
+    ctx->user.cmnd_dir = NULL;
+    if (def_secure_path && !user_is_exempt(ctx))
+	path = def_secure_path;
+
+    ret = resolve_cmnd(ctx, ctx->runas.argv[0], &cmnd_out, path, runchroot);
+    if (ret == FOUND) {
+	char *slash = strrchr(cmnd_out, '/');
+	if (slash != NULL) {
+	    *slash = '\0';
+	    ctx->user.cmnd_dir = canon_path(cmnd_out);
+	    *slash = '/';
+	    if (ctx->user.cmnd_dir == NULL && errno == ENOMEM) {
+		free(cmnd_out);
+		debug_return_int(NOT_FOUND_ERROR);
+	    }
+	}
+    }
+    ctx->user.cmnd = cmnd_out;
+
+    debug_return_int(ret);
+}
+
+bool
+user_is_exempt(const struct sudoers_context *ctx)
+{
+    bool ret = false;
+    debug_decl(user_is_exempt, SUDOERS_DEBUG_MAIN);
+
+    if (def_exempt_group) {
+	if (user_in_group(ctx->user.pw, def_exempt_group))
+	    ret = true;
+    }
+    debug_return_bool(ret);
+}
+
+/*
+ * The plugin applies the settings in the reply, so the callbacks
+ * below are not needed here.
+ */
+bool
+cb_log_input(struct sudoers_context *ctx, const char *file,
+    int line, int column, const union sudo_defs_val *sd_un, int op)
+{
+    return true;
+}
+
+bool
+cb_log_output(struct sudoers_context *ctx, const char *file,
+    int line, int column, const union sudo_defs_val *sd_un, int op)
+{
+    return true;
+}
+
+bool
+init_envtables(void)
+{
+    return true;
+}
+
+void
+init_eventlog_config(void)
+{
+    return;
+}
+
+/* The daemon already runs as root. */
+bool
+set_perms(const struct sudoers_context *ctx, int perm)
+{
+    return true;
+}
+
+bool
+restore_perms(void)
+{
+    return true;
+}
+
+bool
+sudo_nss_can_continue(const struct sudo_nss *nss, int match)
+{
+    return true;
+}
+
+void
+sudo_setspent(void)
+{
+    return;
+}
+
+void
+sudo_endspent(void)
+{
+    return;
+}
+
+sudo_noreturn static void
+usage(void)
+{
+    (void) fprintf(stderr, "usage: %s [-nV] [-f sudoers] -s socket\n",
+	getprogname());
+    exit(EXIT_FAILURE);
+}
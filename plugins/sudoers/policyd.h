@@ -0,0 +1,61 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SUDOERS_POLICYD_H
+#define SUDOERS_POLICYD_H
+
+/*
+ * Messages exchanged with sudo_policyd consist of a 32-bit length in
+ * network byte order followed by that many bytes of NUL-terminated
+ * "name=value" strings, much like the settings the sudo front-end
+ * passes to a plugin.  There is one request and one reply per
+ * connection.  Both ends must be running as root.
+ */
+#define POLICYD_PROTOCOL_VERSION	1
+#define POLICYD_MSG_MAX			(1024 * 1024)
+#define POLICYD_TIMEOUT			5	/* seconds */
+
+/* Growable list of strings used to build a message. */
+struct policyd_msg {
+    char **strv;
+    size_t len;
+    size_t size;
+    bool error;
+};
+
+/* Result of a "check" request, see policyd_client.c. */
+struct policyd_check_result;
+
+/* policyd_proto.c */
+bool policyd_msg_add(struct policyd_msg *msg, const char * restrict fmt, ...) sudo_printflike(2, 3);
+bool policyd_msg_add_default(struct policyd_msg *msg, const char *name, const struct defaults *d);
+void policyd_msg_free(struct policyd_msg *msg);
+bool policyd_write_msg(int fd, const struct policyd_msg *msg);
+char **policyd_read_msg(int fd);
+const char *policyd_getval(char * const strv[], const char *name);
+bool policyd_parse_default(const char *str, const char **namep, size_t *namelenp, const char **valp, int *opp);
+bool policyd_peer_uid(int fd, uid_t *uidp);
+bool policyd_set_timeout(int fd, int secs);
+
+/* policyd_client.c */
+bool sudoers_policyd_defaults(struct sudoers_context *ctx, const char *path);
+struct policyd_check_result *sudoers_policyd_check(struct sudoers_context *ctx, const char *path, int cmnd_status);
+unsigned int sudoers_policyd_lookup(struct sudoers_context *ctx, struct policyd_check_result *res, int *cmnd_status);
+void sudoers_policyd_free(struct policyd_check_result *res);
+
+#endif /* SUDOERS_POLICYD_H */
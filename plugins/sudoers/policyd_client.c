@@ -0,0 +1,434 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Client side of the sudo_policyd protocol.
+ *
+ * Instead of parsing sudoers, the plugin asks the daemon for the
+ * Defaults entries that apply to the invoking user, host and runas
+ * user when it is initialized.  Once the command has been resolved,
+ * a second request returns the command-specific Defaults entries
+ * along with the result of the sudoers lookup and the settings of
+ * the matching command specification.  The entries are applied here
+ * exactly as if they had been read from sudoers.  Any error causes
+ * the caller to fall back on parsing sudoers itself.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <sudoers.h>
+#include <policyd.h>
+
+struct policyd_check_result {
+    char **reply;
+    unsigned int validated;
+};
+
+/*
+ * Connect to the daemon and verify that it is running as root.
+ * Returns the connected socket or -1 on error.
+ */
+static int
+policyd_connect(const char *path)
+{
+    struct sockaddr_un sun;
+    int sock = -1;
+    uid_t uid;
+    debug_decl(policyd_connect, SUDOERS_DEBUG_PLUGIN);
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    if (strlcpy(sun.sun_path, path, sizeof(sun.sun_path)) >= sizeof(sun.sun_path)) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR, "%s: %s", path,
+	    strerror(ENAMETOOLONG));
+	debug_return_int(-1);
+    }
+
+    /* The socket is only accessible by root. */
+    if (!set_perms(NULL, PERM_ROOT))
+	debug_return_int(-1);
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock != -1) {
+	if (connect(sock, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_ERRNO,
+		"unable to connect to %s", path);
+	    close(sock);
+	    sock = -1;
+	}
+    }
+    if (!restore_perms()) {
+	if (sock != -1)
+	    close(sock);
+	debug_return_int(-1);
+    }
+    if (sock == -1)
+	debug_return_int(-1);
+
+    if (!policyd_peer_uid(sock, &uid) || uid != ROOT_UID) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR,
+	    "%s: policy daemon is not running as root", path);
+	close(sock);
+	debug_return_int(-1);
+    }
+    (void)policyd_set_timeout(sock, POLICYD_TIMEOUT);
+
+    debug_return_int(sock);
+}
+
+/*
+ * Add the invoking user's group-IDs to msg as a comma-separated list
+ * so the daemon matches group rules against the same groups we would.
+ * Returns true on success, else false.
+ */
+static bool
+policyd_add_groups(struct policyd_msg *msg, const struct gid_list *gidlist)
+{
+    char *cp, *groups;
+    size_t glsize;
+    int i, len;
+    debug_decl(policyd_add_groups, SUDOERS_DEBUG_PLUGIN);
+
+    if (gidlist == NULL || gidlist->ngids == 0)
+	debug_return_bool(true);
+
+    glsize = (size_t)gidlist->ngids * (STRLEN_MAX_UNSIGNED(gid_t) + 1);
+    if ((groups = malloc(glsize)) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	msg->error = true;
+	debug_return_bool(false);
+    }
+    cp = groups;
+    for (i = 0; i < gidlist->ngids; i++) {
+	len = snprintf(cp, glsize, "%s%u", i ? "," : "",
+	    (unsigned int)gidlist->gids[i]);
+	if (len < 0 || (size_t)len >= glsize) {
+	    sudo_warnx(U_("internal error, %s overflow"), __func__);
+	    free(groups);
+	    msg->error = true;
+	    debug_return_bool(false);
+	}
+	cp += len;
+	glsize -= (size_t)len;
+    }
+    policyd_msg_add(msg, "groups=%s", groups);
+    free(groups);
+
+    debug_return_bool(!msg->error);
+}
+
+/*
+ * Add the settings common to all requests to msg.
+ */
+static bool
+policyd_add_common(const struct sudoers_context *ctx, struct policyd_msg *msg,
+    const char *request)
+{
+    debug_decl(policyd_add_common, SUDOERS_DEBUG_PLUGIN);
+
+    policyd_msg_add(msg, "version=%d", POLICYD_PROTOCOL_VERSION);
+    policyd_msg_add(msg, "request=%s", request);
+    policyd_msg_add(msg, "sudoers_file=%s", ctx->parser_conf.sudoers_path);
+    policyd_msg_add(msg, "user=%s", ctx->user.name);
+    policyd_msg_add(msg, "uid=%u", (unsigned int)ctx->user.uid);
+    policyd_msg_add(msg, "gid=%u", (unsigned int)ctx->user.gid);
+    policyd_add_groups(msg, ctx->user.gid_list);
+    policyd_msg_add(msg, "host=%s", ctx->user.host);
+    policyd_msg_add(msg, "mode=%u", ctx->mode);
+    if (ctx->runas.user != NULL)
+	policyd_msg_add(msg, "runas_user=%s", ctx->runas.user);
+    if (ctx->runas.group != NULL)
+	policyd_msg_add(msg, "runas_group=%s", ctx->runas.group);
+    if (ISSET(ctx->settings.flags, RUNAS_USER_SPECIFIED))
+	policyd_msg_add(msg, "runas_user_specified=1");
+    if (ISSET(ctx->settings.flags, RUNAS_GROUP_SPECIFIED))
+	policyd_msg_add(msg, "runas_group_specified=1");
+    if (ctx->user.cwd != NULL)
+	policyd_msg_add(msg, "cwd=%s", ctx->user.cwd);
+
+    debug_return_bool(!msg->error);
+}
+
+/*
+ * Send a request and read the reply.
+ * Returns the reply on success, else NULL.
+ */
+static char **
+policyd_request(const char *path, const struct policyd_msg *msg)
+{
+    char **reply = NULL;
+    const char *errstr;
+    int sock;
+    debug_decl(policyd_request, SUDOERS_DEBUG_PLUGIN);
+
+    if ((sock = policyd_connect(path)) == -1)
+	debug_return_ptr(NULL);
+    if (policyd_write_msg(sock, msg))
+	reply = policyd_read_msg(sock);
+    close(sock);
+
+    if (reply != NULL && (errstr = policyd_getval(reply, "error")) != NULL) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR, "%s: %s", path, errstr);
+	free(reply);
+	reply = NULL;
+    }
+    debug_return_ptr(reply);
+}
+
+/*
+ * Apply the Defaults entries named "name" in reply.
+ * Returns true on success, else false.
+ */
+static bool
+policyd_apply_defaults(struct sudoers_context *ctx, char * const reply[],
+    const char *name)
+{
+    struct defaults_list defs = TAILQ_HEAD_INITIALIZER(defs);
+    size_t len = strlen(name);
+    char * const *cur;
+    bool ret = false;
+    debug_decl(policyd_apply_defaults, SUDOERS_DEBUG_PLUGIN);
+
+    for (cur = reply; *cur != NULL; cur++) {
+	const char *var, *val;
+	size_t varlen;
+	char *copy;
+	int op;
+	bool ok;
+
+	if (strncmp(*cur, name, len) != 0 || (*cur)[len] != '=')
+	    continue;
+	if (!policyd_parse_default(*cur + len + 1, &var, &varlen, &val, &op)) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR, "invalid Defaults entry %s",
+		*cur);
+	    goto done;
+	}
+	if ((copy = strndup(var, varlen)) == NULL) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    goto done;
+	}
+	ok = append_default(copy, val, op, NULL, &defs);
+	free(copy);
+	if (!ok) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    goto done;
+	}
+    }
+
+    /* The daemon has already matched the bindings. */
+    ret = update_defaults(ctx, NULL, &defs, SETDEF_GENERIC, false);
+
+done:
+    free_defaults(&defs);
+    debug_return_bool(ret);
+}
+
+/*
+ * Get the sudoers Defaults settings for the invoking user, host and
+ * runas user from the daemon and apply them.
+ * Returns true on success, else false.
+ */
+bool
+sudoers_policyd_defaults(struct sudoers_context *ctx, const char *path)
+{
+    struct policyd_msg msg = { NULL };
+    char **reply = NULL;
+    bool ret = false;
+    debug_decl(sudoers_policyd_defaults, SUDOERS_DEBUG_PLUGIN);
+
+    if (policyd_add_common(ctx, &msg, "defaults"))
+	reply = policyd_request(path, &msg);
+    policyd_msg_free(&msg);
+    if (reply != NULL) {
+	ret = policyd_apply_defaults(ctx, reply, "default");
+	free(reply);
+    }
+
+    debug_return_bool(ret);
+}
+
+/*
+ * Ask the daemon whether the user may run the command in ctx and
+ * apply the command-specific Defaults settings.  The rest of the
+ * result is applied by sudoers_policyd_lookup().
+ * Returns the result on success, else NULL.
+ */
+struct policyd_check_result *
+sudoers_policyd_check(struct sudoers_context *ctx, const char *path,
+    int cmnd_status)
+{
+    struct policyd_check_result *res = NULL;
+    struct policyd_msg msg = { NULL };
+    const char *errstr, *val;
+    char **reply = NULL;
+    debug_decl(sudoers_policyd_check, SUDOERS_DEBUG_PLUGIN);
+
+    if (policyd_add_common(ctx, &msg, "check")) {
+	policyd_msg_add(&msg, "cmnd=%s", ctx->user.cmnd);
+	policyd_msg_add(&msg, "cmnd_status=%d", cmnd_status);
+	policyd_msg_add(&msg, "argv0=%s", ctx->runas.argv[0]);
+	if (ctx->user.cmnd_args != NULL)
+	    policyd_msg_add(&msg, "cmnd_args=%s", ctx->user.cmnd_args);
+	if (ctx->user.path != NULL)
+	    policyd_msg_add(&msg, "path=%s", ctx->user.path);
+	if (ctx->runas.cwd != NULL)
+	    policyd_msg_add(&msg, "runas_cwd=%s", ctx->runas.cwd);
+	if (ctx->runas.chroot != NULL)
+	    policyd_msg_add(&msg, "runas_chroot=%s", ctx->runas.chroot);
+	reply = policyd_request(path, &msg);
+    }
+    policyd_msg_free(&msg);
+    if (reply == NULL)
+	debug_return_ptr(NULL);
+
+    if ((res = calloc(1, sizeof(*res))) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	goto bad;
+    }
+    res->reply = reply;
+    if ((val = policyd_getval(reply, "validated")) == NULL)
+	goto bad;
+    res->validated =
+	(unsigned int)sudo_strtonum(val, 0, UINT_MAX, &errstr);
+    if (errstr != NULL)
+	goto bad;
+    if (!policyd_apply_defaults(ctx, reply, "cmnd_default"))
+	goto bad;
+    /* Command-specific Defaults disable the intercept cache. */
+    if ((val = policyd_getval(reply, "cmnd_defaults")) != NULL && *val == '1')
+	def_intercept_cache_timeout = 0;
+
+    debug_return_ptr(res);
+bad:
+    sudo_debug_printf(SUDO_DEBUG_ERROR, "invalid reply from %s", path);
+    free(res);
+    free(reply);
+    debug_return_ptr(NULL);
+}
+
+/*
+ * Return the value of a command tag in reply, or UNSPEC.
+ */
+static int
+policyd_tag(char * const reply[], const char *name)
+{
+    const char *val = policyd_getval(reply, name);
+    debug_decl(policyd_tag, SUDOERS_DEBUG_PLUGIN);
+
+    if (val == NULL)
+	debug_return_int(UNSPEC);
+    debug_return_int(*val == '1' ? true : false);
+}
+
+/*
+ * Apply the result of a sudoers lookup done by the daemon to ctx.
+ * Returns the VALIDATE_* and FLAG_* bits like sudoers_lookup().
+ */
+unsigned int
+sudoers_policyd_lookup(struct sudoers_context *ctx,
+    struct policyd_check_result *res, int *cmnd_status)
+{
+    char * const *reply = res->reply;
+    unsigned int validated = res->validated;
+    const char *errstr, *val;
+    struct cmndspec cs;
+    debug_decl(sudoers_policyd_lookup, SUDOERS_DEBUG_PLUGIN);
+
+    /* The command may have been resolved again for a sudoers chroot. */
+    if ((val = policyd_getval(reply, "cmnd")) != NULL &&
+	    strcmp(val, ctx->user.cmnd) != 0) {
+	char *cmnd = strdup(val);
+	if (cmnd == NULL)
+	    goto oom;
+	free(ctx->user.cmnd);
+	ctx->user.cmnd = cmnd;
+	if (ctx->user.cmnd_stat != NULL && stat(cmnd, ctx->user.cmnd_stat) == -1)
+	    memset(ctx->user.cmnd_stat, 0, sizeof(struct stat));
+    }
+    if ((val = policyd_getval(reply, "cmnd_status")) != NULL) {
+	int status = (int)sudo_strtonum(val, INT_MIN, INT_MAX, &errstr);
+	if (errstr == NULL)
+	    *cmnd_status = status;
+    }
+    if ((val = policyd_getval(reply, "source")) != NULL) {
+	free(ctx->source);
+	if ((ctx->source = strdup(val)) == NULL)
+	    goto oom;
+    }
+
+    if (policyd_getval(reply, "cmndspec") != NULL) {
+	if (!policyd_apply_defaults(ctx, reply, "lookup_default"))
+	    SET(validated, VALIDATE_ERROR);
+
+	/* Only the fields used by apply_cmndspec() are needed. */
+	memset(&cs, 0, sizeof(cs));
+	cs.role = (char *)policyd_getval(reply, "role");
+	cs.type = (char *)policyd_getval(reply, "type");
+	cs.apparmor_profile = (char *)policyd_getval(reply, "apparmor_profile");
+	cs.privs = (char *)policyd_getval(reply, "privs");
+	cs.limitprivs = (char *)policyd_getval(reply, "limitprivs");
+	cs.runcwd = (char *)policyd_getval(reply, "runcwd");
+	cs.runchroot = (char *)policyd_getval(reply, "runchroot");
+	if ((val = policyd_getval(reply, "timeout")) != NULL) {
+	    cs.timeout = (int)sudo_strtonum(val, 0, INT_MAX, &errstr);
+	    if (errstr != NULL) {
+		sudo_warnx(U_("%s: %s"), val, U_("invalid timeout value"));
+		SET(validated, VALIDATE_ERROR);
+		cs.timeout = 0;
+	    }
+	}
+	cs.tags.follow = policyd_tag(reply, "tag_follow");
+	cs.tags.intercept = policyd_tag(reply, "tag_intercept");
+	cs.tags.log_input = policyd_tag(reply, "tag_log_input");
+	cs.tags.log_output = policyd_tag(reply, "tag_log_output");
+	cs.tags.noexec = policyd_tag(reply, "tag_noexec");
+	cs.tags.nopasswd = policyd_tag(reply, "tag_nopasswd");
+	cs.tags.send_mail = policyd_tag(reply, "tag_send_mail");
+	cs.tags.setenv = policyd_tag(reply, "tag_setenv");
+	if (!apply_cmndspec(ctx, &cs))
+	    SET(validated, VALIDATE_ERROR);
+    }
+
+    debug_return_uint(validated);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    debug_return_uint(validated|VALIDATE_ERROR);
+}
+
+void
+sudoers_policyd_free(struct policyd_check_result *res)
+{
+    debug_decl(sudoers_policyd_free, SUDOERS_DEBUG_PLUGIN);
+
+    if (res != NULL) {
+	free(res->reply);
+	free(res);
+    }
+
+    debug_return;
+}
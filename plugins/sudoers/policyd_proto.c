@@ -0,0 +1,350 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Message framing shared by sudo_policyd and the sudoers plugin.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sudoers.h>
+#include <policyd.h>
+
+/*
+ * Append a formatted string to msg.  Errors are sticky.
+ * Returns true on success, else false.
+ */
+bool
+policyd_msg_add(struct policyd_msg *msg, const char * restrict fmt, ...)
+{
+    va_list ap;
+    char *str;
+    int len;
+    debug_decl(policyd_msg_add, SUDOERS_DEBUG_UTIL);
+
+    if (msg->error)
+	debug_return_bool(false);
+
+    if (msg->len + 1 >= msg->size) {
+	size_t newsize = msg->size ? msg->size * 2 : 32;
+	char **strv = reallocarray(msg->strv, newsize, sizeof(char *));
+	if (strv == NULL)
+	    goto oom;
+	msg->strv = strv;
+	msg->size = newsize;
+    }
+    va_start(ap, fmt);
+    len = vasprintf(&str, fmt, ap);
+    va_end(ap);
+    if (len == -1)
+	goto oom;
+    msg->strv[msg->len++] = str;
+    msg->strv[msg->len] = NULL;
+
+    debug_return_bool(true);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    msg->error = true;
+    debug_return_bool(false);
+}
+
+/*
+ * Append a Defaults entry to msg in sudoers syntax: "name=[!]var",
+ * "name=var=value", "name=var+=value" or "name=var-=value".
+ */
+bool
+policyd_msg_add_default(struct policyd_msg *msg, const char *name,
+    const struct defaults *d)
+{
+    debug_decl(policyd_msg_add_default, SUDOERS_DEBUG_UTIL);
+
+    if (d->val == NULL) {
+	debug_return_bool(policyd_msg_add(msg, "%s=%s%s", name,
+	    d->op == false ? "!" : "", d->var));
+    }
+    debug_return_bool(policyd_msg_add(msg, "%s=%s%s=%s", name, d->var,
+	d->op == '+' ? "+" : d->op == '-' ? "-" : "", d->val));
+}
+
+void
+policyd_msg_free(struct policyd_msg *msg)
+{
+    size_t i;
+    debug_decl(policyd_msg_free, SUDOERS_DEBUG_UTIL);
+
+    for (i = 0; i < msg->len; i++)
+	free(msg->strv[i]);
+    free(msg->strv);
+    memset(msg, 0, sizeof(*msg));
+
+    debug_return;
+}
+
+/*
+ * Split a Defaults entry encoded by policyd_msg_add_default().
+ * The name is not NUL-terminated, its length is stored in namelenp.
+ * Returns true on success, else false.
+ */
+bool
+policyd_parse_default(const char *str, const char **namep, size_t *namelenp,
+    const char **valp, int *opp)
+{
+    const char *cp;
+    debug_decl(policyd_parse_default, SUDOERS_DEBUG_UTIL);
+
+    *valp = NULL;
+    *opp = true;
+    if (*str == '!') {
+	*opp = false;
+	str++;
+    }
+    for (cp = str; *cp == '_' || isalnum((unsigned char)*cp); cp++)
+	continue;
+    if (cp == str)
+	debug_return_bool(false);
+    *namep = str;
+    *namelenp = (size_t)(cp - str);
+    if (*cp == '\0')
+	debug_return_bool(true);
+    if (*opp == false)
+	debug_return_bool(false);
+    if ((cp[0] == '+' || cp[0] == '-') && cp[1] == '=') {
+	*opp = *cp++;
+    } else if (*cp != '=') {
+	debug_return_bool(false);
+    }
+    *valp = cp + 1;
+    debug_return_bool(true);
+}
+
+/*
+ * Write exactly len bytes, retrying on EINTR.
+ */
+static bool
+policyd_write_all(int fd, const void *buf, size_t len)
+{
+    const char *cp = buf;
+    ssize_t nwritten;
+    debug_decl(policyd_write_all, SUDOERS_DEBUG_UTIL);
+
+    while (len > 0) {
+	nwritten = write(fd, cp, len);
+	if (nwritten == -1) {
+	    if (errno == EINTR)
+		continue;
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"unable to write %zu bytes", len);
+	    debug_return_bool(false);
+	}
+	cp += nwritten;
+	len -= (size_t)nwritten;
+    }
+    debug_return_bool(true);
+}
+
+/*
+ * Read exactly len bytes, retrying on EINTR.
+ */
+static bool
+policyd_read_all(int fd, void *buf, size_t len)
+{
+    char *cp = buf;
+    ssize_t nread;
+    debug_decl(policyd_read_all, SUDOERS_DEBUG_UTIL);
+
+    while (len > 0) {
+	nread = read(fd, cp, len);
+	if (nread == -1) {
+	    if (errno == EINTR)
+		continue;
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"unable to read %zu bytes", len);
+	    debug_return_bool(false);
+	}
+	if (nread == 0) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR, "unexpected EOF");
+	    debug_return_bool(false);
+	}
+	cp += nread;
+	len -= (size_t)nread;
+    }
+    debug_return_bool(true);
+}
+
+/*
+ * Send the strings in msg as a single message.
+ * Returns true on success, else false.
+ */
+bool
+policyd_write_msg(int fd, const struct policyd_msg *msg)
+{
+    char *buf, *cp;
+    size_t i, len = 0;
+    uint32_t msg_len;
+    bool ret;
+    debug_decl(policyd_write_msg, SUDOERS_DEBUG_UTIL);
+
+    if (msg->error)
+	debug_return_bool(false);
+
+    for (i = 0; i < msg->len; i++)
+	len += strlen(msg->strv[i]) + 1;
+    if (len > POLICYD_MSG_MAX) {
+	sudo_warnx(U_("%s: message too large (%zu bytes)"), __func__, len);
+	debug_return_bool(false);
+    }
+    if ((buf = malloc(sizeof(msg_len) + len)) == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	debug_return_bool(false);
+    }
+    msg_len = htonl((uint32_t)len);
+    memcpy(buf, &msg_len, sizeof(msg_len));
+    cp = buf + sizeof(msg_len);
+    for (i = 0; i < msg->len; i++) {
+	size_t n = strlen(msg->strv[i]) + 1;
+	memcpy(cp, msg->strv[i], n);
+	cp += n;
+    }
+    ret = policyd_write_all(fd, buf, sizeof(msg_len) + len);
+    free(buf);
+
+    debug_return_bool(ret);
+}
+
+/*
+ * Read a message and return it as a NULL-terminated vector of strings.
+ * The vector and strings are a single allocation, freed by the caller.
+ * Returns NULL on error.
+ */
+char **
+policyd_read_msg(int fd)
+{
+    char **strv = NULL, *buf, *cp, *end;
+    size_t count = 0;
+    uint32_t msg_len;
+    debug_decl(policyd_read_msg, SUDOERS_DEBUG_UTIL);
+
+    if (!policyd_read_all(fd, &msg_len, sizeof(msg_len)))
+	debug_return_ptr(NULL);
+    msg_len = ntohl(msg_len);
+    if (msg_len > POLICYD_MSG_MAX) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR,
+	    "message too large (%u bytes)", msg_len);
+	debug_return_ptr(NULL);
+    }
+
+    /* Read into a buffer with room for the largest possible vector. */
+    strv = malloc(((size_t)msg_len + 1) * sizeof(char *) + msg_len);
+    if (strv == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	debug_return_ptr(NULL);
+    }
+    buf = (char *)(strv + msg_len + 1);
+    if (!policyd_read_all(fd, buf, msg_len))
+	goto bad;
+    if (msg_len != 0 && buf[msg_len - 1] != '\0') {
+	sudo_debug_printf(SUDO_DEBUG_ERROR, "message not NUL-terminated");
+	goto bad;
+    }
+    for (cp = buf, end = buf + msg_len; cp < end; cp += strlen(cp) + 1)
+	strv[count++] = cp;
+    strv[count] = NULL;
+
+    debug_return_ptr(strv);
+bad:
+    free(strv);
+    debug_return_ptr(NULL);
+}
+
+/*
+ * Return the value of the first "name=value" string in strv, or NULL.
+ */
+const char *
+policyd_getval(char * const strv[], const char *name)
+{
+    size_t len = strlen(name);
+    char * const *cur;
+    debug_decl(policyd_getval, SUDOERS_DEBUG_UTIL);
+
+    for (cur = strv; *cur != NULL; cur++) {
+	if (strncmp(*cur, name, len) == 0 && (*cur)[len] == '=')
+	    debug_return_const_str(*cur + len + 1);
+    }
+    debug_return_const_str(NULL);
+}
+
+/*
+ * Get the effective user-ID of the process connected to a Unix socket.
+ * Returns true on success, else false.
+ */
+bool
+policyd_peer_uid(int fd, uid_t *uidp)
+{
+    debug_decl(policyd_peer_uid, SUDOERS_DEBUG_UTIL);
+
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "unable to get peer credentials");
+	debug_return_bool(false);
+    }
+    *uidp = cred.uid;
+    debug_return_bool(true);
+#else
+    sudo_debug_printf(SUDO_DEBUG_ERROR,
+	"peer credentials not supported on this system");
+    errno = ENOTSUP;
+    debug_return_bool(false);
+#endif
+}
+
+/*
+ * Set the send and receive timeouts on fd so that a stalled peer
+ * cannot block the other end indefinitely.
+ */
+bool
+policyd_set_timeout(int fd, int secs)
+{
+    struct timeval tv;
+    debug_decl(policyd_set_timeout, SUDOERS_DEBUG_UTIL);
+
+    tv.tv_sec = secs;
+    tv.tv_usec = 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == -1 ||
+	    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "unable to set socket timeout");
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
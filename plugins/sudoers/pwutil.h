@@ -19,6 +19,9 @@
 #ifndef SUDOERS_PWUTIL_H
 #define SUDOERS_PWUTIL_H
 
+/* Default lifetime of a shared passwd/group cache entry in seconds. */
+#define PWUTIL_CACHE_TTL	300
+
 #define ptr_to_item(p) ((struct cache_item *)((char *)p - offsetof(struct cache_item_##p, p)))
 
 /*
@@ -75,4 +78,9 @@ struct cache_item *sudo_make_gidlist_item(const struct passwd *pw, int ngids, GE
 struct cache_item *sudo_make_pwitem(uid_t uid, const char *user);
 bool sudo_valid_shell(const char *shell);
 
+/* pwutil_shared.c */
+struct cache_item *sudo_shared_make_gritem(gid_t gid, const char *group);
+struct cache_item *sudo_shared_make_gidlist_item(const struct passwd *pw, int ngids, GETGROUPS_T *gids, char * const *gidstrs, unsigned int type);
+struct cache_item *sudo_shared_make_pwitem(uid_t uid, const char *user);
+
 #endif /* SUDOERS_PWUTIL_H */
@@ -0,0 +1,746 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Persistent passwd and group cache shared between sudo processes.
+ *
+ * The cache is a fixed-size file that is mapped into memory.  It starts
+ * with a header, followed by a hash table of slots and a data area that
+ * holds the records.  Each record contains a key, an expiration time and
+ * a copy of a cache item as built by sudo_make_pwitem(), sudo_make_gritem()
+ * or sudo_make_gidlist_item().  Pointers inside the item are stored as a
+ * list of relocations so the copy can be used by another process.
+ * A record without an item stores a negative lookup result.
+ *
+ * All access to the file is serialized with an exclusive lock.  The lock
+ * is not held while the passwd or group database is queried.  When the
+ * data area or hash table fills up, the cache is simply emptied.
+ */
+
+#include <config.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pwd.h>
+#include <grp.h>
+
+#include <sudoers.h>
+#include <pwutil.h>
+
+#define PWCACHE_MAGIC		"SUDOPWC"
+#define PWCACHE_VERSION		1
+#define PWCACHE_NSLOTS		16384U
+#define PWCACHE_DATA_SIZE	(4U * 1024U * 1024U)
+#define PWCACHE_MAX_RECORD	(PWCACHE_DATA_SIZE / 16U)
+#define PWCACHE_MAX_KEY		(2U * 1024U)
+
+#define PWCACHE_ALIGN(n)	(((n) + 7U) & ~7U)
+
+struct pwcache_header {
+    char magic[8];		/* PWCACHE_MAGIC */
+    uint32_t version;		/* PWCACHE_VERSION */
+    uint32_t hdrsize;		/* sizeof(struct pwcache_header) */
+    uint32_t abi;		/* size of pointers and structs we store */
+    uint32_t nslots;		/* PWCACHE_NSLOTS */
+    uint32_t data_size;		/* PWCACHE_DATA_SIZE */
+    uint32_t data_used;		/* bytes of the data area in use */
+    uint32_t nentries;		/* slots in use */
+    uint32_t pad;
+};
+
+struct pwcache_slot {
+    uint32_t hash;
+    uint32_t offset;		/* offset into data area, 0 if unused */
+};
+
+/*
+ * Followed by the key (including the NUL terminator), the relocation
+ * pairs and the item itself, each starting on an 8-byte boundary.
+ */
+struct pwcache_record {
+    int64_t expires;		/* time after which the record is stale */
+    uint32_t size;		/* total size of the record */
+    uint32_t keylen;		/* length of key including NUL */
+    uint32_t nrelocs;		/* number of (field, target) offset pairs */
+    uint32_t itemsize;		/* size of the item, 0 if not found */
+};
+
+struct pwcache_relocs {
+    uint32_t *pairs;
+    uint32_t count;
+    uint32_t size;
+    size_t end;			/* end of the item's data */
+    bool error;
+};
+
+static struct pwcache {
+    unsigned char *base;
+    struct pwcache_header *hdr;
+    struct pwcache_slot *slots;
+    unsigned char *data;
+    size_t map_size;
+    unsigned int ttl;
+    unsigned int hits;
+    unsigned int misses;
+    int fd;
+} pwcache = { NULL, NULL, NULL, NULL, 0, 0, 0, 0, -1 };
+
+/*
+ * Value stored in the header to detect a cache written by a sudo with
+ * an incompatible memory layout.
+ */
+static uint32_t
+pwcache_abi(void)
+{
+    return (uint32_t)(sizeof(void *) | sizeof(struct passwd) << 4 |
+	sizeof(struct group) << 12 | sizeof(struct cache_item) << 20);
+}
+
+/* FNV-1a hash of a cache key. */
+static uint32_t
+pwcache_hash(const char *key)
+{
+    uint32_t h = 2166136261U;
+
+    while (*key != '\0') {
+	h ^= (unsigned char)*key++;
+	h *= 16777619U;
+    }
+    return h;
+}
+
+/*
+ * Empty the cache, caller must hold the lock.
+ */
+static void
+pwcache_reset(void)
+{
+    debug_decl(pwcache_reset, SUDOERS_DEBUG_NSS);
+
+    memset(pwcache.slots, 0, sizeof(struct pwcache_slot) * PWCACHE_NSLOTS);
+    /* Offset 0 is reserved to mark an unused slot. */
+    pwcache.hdr->data_used = 8;
+    pwcache.hdr->nentries = 0;
+
+    debug_return;
+}
+
+/*
+ * Initialize the header if the cache file is new or was written
+ * by an incompatible version of sudo, caller must hold the lock.
+ */
+static void
+pwcache_check_header(void)
+{
+    struct pwcache_header *hdr = pwcache.hdr;
+    debug_decl(pwcache_check_header, SUDOERS_DEBUG_NSS);
+
+    if (memcmp(hdr->magic, PWCACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != PWCACHE_VERSION || hdr->hdrsize != sizeof(*hdr) ||
+	    hdr->abi != pwcache_abi() || hdr->nslots != PWCACHE_NSLOTS ||
+	    hdr->data_size != PWCACHE_DATA_SIZE ||
+	    hdr->data_used < 8 || hdr->data_used > PWCACHE_DATA_SIZE) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "initializing passwd/group cache");
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->magic, PWCACHE_MAGIC, sizeof(hdr->magic));
+	hdr->version = PWCACHE_VERSION;
+	hdr->hdrsize = sizeof(*hdr);
+	hdr->abi = pwcache_abi();
+	hdr->nslots = PWCACHE_NSLOTS;
+	hdr->data_size = PWCACHE_DATA_SIZE;
+	pwcache_reset();
+    }
+
+    debug_return;
+}
+
+/*
+ * Open and map the shared passwd/group cache at path.
+ * The file is created if it does not exist.  It must be a regular
+ * file owned by root with no group or other permissions.  The cache
+ * is only used when running with an effective uid of root.
+ * Records are considered stale ttl seconds after they are stored.
+ * Returns true on success, false if the cache cannot be used.
+ */
+bool
+sudo_pwutil_shared_open(const char *path, unsigned int ttl)
+{
+    const size_t map_size = sizeof(struct pwcache_header) +
+	sizeof(struct pwcache_slot) * PWCACHE_NSLOTS + PWCACHE_DATA_SIZE;
+    const char *base;
+    struct stat sb;
+    int dfd, fd = -1;
+    void *map;
+    debug_decl(sudo_pwutil_shared_open, SUDOERS_DEBUG_NSS);
+
+    sudo_pwutil_shared_close();
+
+#ifdef HAVE_SETAUTHDB
+    /* Lookups depend on the authentication registry, not supported. */
+    sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	"shared passwd/group cache not supported with authentication "
+	"registries");
+    debug_return_bool(false);
+#endif
+
+    if (ttl == 0)
+	debug_return_bool(false);
+    if (geteuid() != ROOT_UID) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: not running as root, ignoring", path);
+	debug_return_bool(false);
+    }
+
+    dfd = sudo_open_parent_dir(path, ROOT_UID, ROOT_GID,
+	S_IRWXU|S_IXGRP|S_IXOTH, true);
+    if (dfd == -1)
+	goto bad;
+    if (fstat(dfd, &sb) == -1 || sb.st_uid != ROOT_UID ||
+	    (sb.st_mode & (S_IWGRP|S_IWOTH)) != 0) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: parent directory is not secure, ignoring", path);
+	close(dfd);
+	goto bad;
+    }
+    base = sudo_basename(path);
+    fd = openat(dfd, base, O_RDWR|O_CREAT|O_NOFOLLOW|O_NONBLOCK,
+	S_IRUSR|S_IWUSR);
+    close(dfd);
+    if (fd == -1)
+	goto bad;
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (fstat(fd, &sb) == -1)
+	goto bad;
+    if (!S_ISREG(sb.st_mode) || sb.st_uid != ROOT_UID || sb.st_nlink != 1 ||
+	    (sb.st_mode & (S_IRWXG|S_IRWXO)) != 0) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: bad owner, mode or type, ignoring", path);
+	goto bad;
+    }
+
+    if (!sudo_lock_file(fd, SUDO_LOCK))
+	goto bad;
+    if (sb.st_size != (off_t)map_size) {
+	/* New file or one written by a different version of sudo. */
+	if (ftruncate(fd, 0) == -1 || ftruncate(fd, (off_t)map_size) == -1) {
+	    sudo_lock_file(fd, SUDO_UNLOCK);
+	    goto bad;
+	}
+    }
+    map = mmap(NULL, map_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+	sudo_lock_file(fd, SUDO_UNLOCK);
+	goto bad;
+    }
+    pwcache.base = map;
+    pwcache.hdr = map;
+    pwcache.slots = (struct pwcache_slot *)(pwcache.base +
+	sizeof(struct pwcache_header));
+    pwcache.data = (unsigned char *)(pwcache.slots + PWCACHE_NSLOTS);
+    pwcache.map_size = map_size;
+    pwcache.ttl = ttl;
+    pwcache.fd = fd;
+    pwcache_check_header();
+    sudo_lock_file(fd, SUDO_UNLOCK);
+
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"using shared passwd/group cache %s, ttl %u", path, ttl);
+    debug_return_bool(true);
+bad:
+    sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	"unable to use shared passwd/group cache %s", path);
+    if (fd != -1)
+	close(fd);
+    debug_return_bool(false);
+}
+
+/*
+ * Unmap and close the shared passwd/group cache, if open.
+ */
+void
+sudo_pwutil_shared_close(void)
+{
+    debug_decl(sudo_pwutil_shared_close, SUDOERS_DEBUG_NSS);
+
+    if (pwcache.fd != -1) {
+	sudo_debug_printf(SUDO_DEBUG_INFO,
+	    "shared passwd/group cache: %u hits, %u misses",
+	    pwcache.hits, pwcache.misses);
+	munmap(pwcache.base, pwcache.map_size);
+	close(pwcache.fd);
+    }
+    memset(&pwcache, 0, sizeof(pwcache));
+    pwcache.fd = -1;
+
+    debug_return;
+}
+
+/*
+ * Return the number of shared cache hits and misses so far.
+ */
+void
+sudo_pwutil_shared_stats(unsigned int *hits, unsigned int *misses)
+{
+    *hits = pwcache.hits;
+    *misses = pwcache.misses;
+}
+
+/*
+ * Return the record at offset in the data area or NULL if it is
+ * not valid.  Caller must hold the lock.
+ */
+static struct pwcache_record *
+pwcache_record(uint32_t offset)
+{
+    struct pwcache_record *rec;
+    size_t hdrlen;
+
+    if (offset < 8 || (offset & 7U) != 0 ||
+	    (size_t)offset + sizeof(*rec) > pwcache.hdr->data_used)
+	return NULL;
+    rec = (struct pwcache_record *)(pwcache.data + offset);
+    if (rec->size > pwcache.hdr->data_used - offset ||
+	    rec->keylen == 0 || rec->keylen > PWCACHE_MAX_KEY)
+	return NULL;
+    hdrlen = PWCACHE_ALIGN(sizeof(*rec) + rec->keylen) +
+	PWCACHE_ALIGN(sizeof(uint32_t) * 2 * (size_t)rec->nrelocs);
+    if (rec->nrelocs > PWCACHE_MAX_RECORD || hdrlen > rec->size ||
+	    rec->itemsize > rec->size - hdrlen)
+	return NULL;
+    if (((char *)(rec + 1))[rec->keylen - 1] != '\0')
+	return NULL;
+    return rec;
+}
+
+/*
+ * Find the slot for key, which is either the slot that holds its
+ * record or the first unused slot.  Returns NULL if the table is full.
+ * Caller must hold the lock.
+ */
+static struct pwcache_slot *
+pwcache_find(const char *key, uint32_t h)
+{
+    struct pwcache_record *rec;
+    uint32_t i, n;
+
+    for (n = 0, i = h & (PWCACHE_NSLOTS - 1); n < PWCACHE_NSLOTS;
+	    n++, i = (i + 1) & (PWCACHE_NSLOTS - 1)) {
+	struct pwcache_slot *slot = &pwcache.slots[i];
+	if (slot->offset == 0)
+	    return slot;
+	if (slot->hash != h)
+	    continue;
+	rec = pwcache_record(slot->offset);
+	if (rec != NULL && strcmp((char *)(rec + 1), key) == 0)
+	    return slot;
+    }
+    return NULL;
+}
+
+/*
+ * Rebuild a cache item from a record.
+ * Returns the new item or NULL with errno set.
+ */
+static struct cache_item *
+pwcache_decode(const struct pwcache_record *rec)
+{
+    const unsigned char *cp = (const unsigned char *)(rec + 1);
+    const uint32_t *pairs;
+    unsigned char *item;
+    uint32_t n;
+    debug_decl(pwcache_decode, SUDOERS_DEBUG_NSS);
+
+    if (rec->itemsize == 0) {
+	errno = ENOENT;
+	debug_return_ptr(NULL);
+    }
+    cp += PWCACHE_ALIGN(sizeof(*rec) + rec->keylen) - sizeof(*rec);
+    pairs = (const uint32_t *)cp;
+    cp += PWCACHE_ALIGN(sizeof(uint32_t) * 2 * (size_t)rec->nrelocs);
+
+    /* Strings must not run past the end of the item. */
+    if (rec->itemsize < sizeof(struct cache_item) ||
+	    cp[rec->itemsize - 1] != '\0') {
+	errno = EINVAL;
+	debug_return_ptr(NULL);
+    }
+    if ((item = malloc(rec->itemsize)) == NULL) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "unable to allocate memory");
+	debug_return_ptr(NULL);
+    }
+    memcpy(item, cp, rec->itemsize);
+    for (n = 0; n < rec->nrelocs; n++) {
+	const uint32_t field = pairs[n * 2];
+	const uint32_t target = pairs[n * 2 + 1];
+	void *ptr = item + target;
+
+	if (field > rec->itemsize - sizeof(void *) ||
+		target >= rec->itemsize) {
+	    free(item);
+	    errno = EINVAL;
+	    debug_return_ptr(NULL);
+	}
+	memcpy(item + field, &ptr, sizeof(ptr));
+    }
+    ((struct cache_item *)item)->refcnt = 1;
+
+    debug_return_ptr((struct cache_item *)item);
+}
+
+/*
+ * Look up key in the shared cache.  Returns true if a fresh record
+ * was found, in which case *itemp is set to the item or to NULL
+ * (with errno set to ENOENT) for a negative entry.
+ */
+static bool
+pwcache_get(const char *key, struct cache_item **itemp)
+{
+    const time_t now = time(NULL);
+    struct pwcache_record *rec;
+    struct pwcache_slot *slot;
+    bool ret = false;
+    debug_decl(pwcache_get, SUDOERS_DEBUG_NSS);
+
+    if (!sudo_lock_file(pwcache.fd, SUDO_LOCK))
+	debug_return_bool(false);
+    slot = pwcache_find(key, pwcache_hash(key));
+    if (slot != NULL && slot->offset != 0) {
+	rec = pwcache_record(slot->offset);
+	/* Ignore stale records and those from the future. */
+	if (rec != NULL && rec->expires >= now &&
+		rec->expires - now <= (int64_t)pwcache.ttl) {
+	    *itemp = pwcache_decode(rec);
+	    ret = *itemp != NULL || errno == ENOENT;
+	}
+    }
+    sudo_lock_file(pwcache.fd, SUDO_UNLOCK);
+
+    if (ret)
+	pwcache.hits++;
+    else
+	pwcache.misses++;
+    sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+	"%s: %s", key, ret ? "hit" : "miss");
+    debug_return_bool(ret);
+}
+
+/*
+ * Record that the pointer at field points to target, which is len
+ * bytes long.  Both must be inside the item starting at base.
+ */
+static void
+pwcache_reloc(struct pwcache_relocs *relocs, const void *base,
+    const void *field, const void *target, size_t len)
+{
+    const size_t field_off = (size_t)((const char *)field - (const char *)base);
+    size_t target_off;
+
+    if (target == NULL || relocs->error)
+	return;
+    target_off = (size_t)((const char *)target - (const char *)base);
+    if ((const char *)target < (const char *)base ||
+	    target_off + len > PWCACHE_MAX_RECORD) {
+	/* Not part of the item, cannot be stored. */
+	relocs->error = true;
+	return;
+    }
+    if (relocs->count + 2 > relocs->size) {
+	uint32_t *pairs;
+	const uint32_t size = relocs->size ? relocs->size * 2 : 32;
+
+	pairs = reallocarray(relocs->pairs, size, sizeof(uint32_t));
+	if (pairs == NULL) {
+	    relocs->error = true;
+	    return;
+	}
+	relocs->pairs = pairs;
+	relocs->size = size;
+    }
+    relocs->pairs[relocs->count++] = (uint32_t)field_off;
+    relocs->pairs[relocs->count++] = (uint32_t)target_off;
+    if (target_off + len > relocs->end)
+	relocs->end = target_off + len;
+}
+
+#define RELOC_STR(r, b, f) \
+    pwcache_reloc((r), (b), &(f), (f), (f) ? strlen(f) + 1 : 0)
+
+/*
+ * Collect the pointers in a passwd, group or gid list item.
+ */
+static void
+pwcache_relocs_pw(struct pwcache_relocs *relocs, struct cache_item *item,
+    bool byname)
+{
+    struct cache_item_pw *pwitem = (struct cache_item_pw *)item;
+    struct passwd *pw = &pwitem->pw;
+
+    relocs->end = sizeof(*pwitem);
+    if (byname)
+	RELOC_STR(relocs, item, item->k.name);
+    pwcache_reloc(relocs, item, &item->d.pw, pw, sizeof(*pw));
+    RELOC_STR(relocs, item, pw->pw_name);
+    RELOC_STR(relocs, item, pw->pw_passwd);
+#ifdef HAVE_LOGIN_CAP_H
+    RELOC_STR(relocs, item, pw->pw_class);
+#endif
+    RELOC_STR(relocs, item, pw->pw_gecos);
+    RELOC_STR(relocs, item, pw->pw_dir);
+    RELOC_STR(relocs, item, pw->pw_shell);
+}
+
+static void
+pwcache_relocs_gr(struct pwcache_relocs *relocs, struct cache_item *item,
+    bool byname)
+{
+    struct cache_item_gr *gritem = (struct cache_item_gr *)item;
+    struct group *gr = &gritem->gr;
+    size_t n;
+
+    relocs->end = sizeof(*gritem);
+    if (byname)
+	RELOC_STR(relocs, item, item->k.name);
+    pwcache_reloc(relocs, item, &item->d.gr, gr, sizeof(*gr));
+    RELOC_STR(relocs, item, gr->gr_name);
+    RELOC_STR(relocs, item, gr->gr_passwd);
+    if (gr->gr_mem != NULL) {
+	for (n = 0; gr->gr_mem[n] != NULL; n++)
+	    RELOC_STR(relocs, item, gr->gr_mem[n]);
+	pwcache_reloc(relocs, item, &gr->gr_mem, gr->gr_mem,
+	    sizeof(char *) * (n + 1));
+    }
+}
+
+static void
+pwcache_relocs_gidlist(struct pwcache_relocs *relocs, struct cache_item *item)
+{
+    struct cache_item_gidlist *glitem = (struct cache_item_gidlist *)item;
+    struct gid_list *gidlist = &glitem->gidlist;
+
+    relocs->end = sizeof(*glitem);
+    RELOC_STR(relocs, item, item->k.name);
+    pwcache_reloc(relocs, item, &item->d.gidlist, gidlist, sizeof(*gidlist));
+    pwcache_reloc(relocs, item, &gidlist->gids, gidlist->gids,
+	sizeof(gid_t) * (size_t)gidlist->ngids);
+}
+
+/*
+ * Store item (or a negative entry if item is NULL) for key.
+ * The relocations must have been collected for item already.
+ */
+static void
+pwcache_put(const char *key, const struct cache_item *item,
+    const struct pwcache_relocs *relocs)
+{
+    const size_t keylen = strlen(key) + 1;
+    const size_t itemsize = item ? relocs->end : 0;
+    const uint32_t h = pwcache_hash(key);
+    struct pwcache_record *rec;
+    struct pwcache_slot *slot;
+    unsigned char *cp;
+    size_t hdrlen, size;
+    debug_decl(pwcache_put, SUDOERS_DEBUG_NSS);
+
+    if (keylen > PWCACHE_MAX_KEY || (item != NULL && relocs->error))
+	debug_return;
+    hdrlen = PWCACHE_ALIGN(sizeof(*rec) + keylen) +
+	PWCACHE_ALIGN(sizeof(uint32_t) * (item ? relocs->count : 0));
+    size = PWCACHE_ALIGN(hdrlen + itemsize);
+    if (size > PWCACHE_MAX_RECORD) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: record too large to cache (%zu bytes)", key, size);
+	debug_return;
+    }
+
+    if (!sudo_lock_file(pwcache.fd, SUDO_LOCK))
+	debug_return;
+    pwcache_check_header();
+    if (pwcache.hdr->nentries >= PWCACHE_NSLOTS / 4 * 3 ||
+	    size > PWCACHE_DATA_SIZE - pwcache.hdr->data_used) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "shared passwd/group cache full, emptying");
+	pwcache_reset();
+    }
+    slot = pwcache_find(key, h);
+    if (slot != NULL) {
+	rec = (struct pwcache_record *)(pwcache.data + pwcache.hdr->data_used);
+	memset(rec, 0, size);
+	rec->expires = (int64_t)time(NULL) + pwcache.ttl;
+	rec->size = (uint32_t)size;
+	rec->keylen = (uint32_t)keylen;
+	rec->itemsize = (uint32_t)itemsize;
+	cp = (unsigned char *)rec;
+	memcpy(cp + sizeof(*rec), key, keylen);
+	if (item != NULL) {
+	    rec->nrelocs = relocs->count / 2;
+	    cp += PWCACHE_ALIGN(sizeof(*rec) + keylen);
+	    memcpy(cp, relocs->pairs, sizeof(uint32_t) * relocs->count);
+	    memcpy((unsigned char *)rec + hdrlen, item, itemsize);
+	    /* The reference count is per-process. */
+	    ((struct cache_item *)((unsigned char *)rec + hdrlen))->refcnt = 0;
+	}
+	if (slot->offset == 0)
+	    pwcache.hdr->nentries++;
+	slot->hash = h;
+	slot->offset = pwcache.hdr->data_used;
+	pwcache.hdr->data_used += (uint32_t)size;
+    }
+    sudo_lock_file(pwcache.fd, SUDO_UNLOCK);
+
+    debug_return;
+}
+
+/*
+ * Store a newly-built item, or a negative entry if the lookup
+ * failed because the entry does not exist.
+ */
+static void
+pwcache_store(const char *key, struct cache_item *item, int kind,
+    bool byname)
+{
+    struct pwcache_relocs relocs = { NULL, 0, 0, 0, false };
+    const int serrno = errno;
+    debug_decl(pwcache_store, SUDOERS_DEBUG_NSS);
+
+    if (item == NULL) {
+	if (serrno == ENOENT)
+	    pwcache_put(key, NULL, &relocs);
+    } else {
+	switch (kind) {
+	case 'u':
+	    pwcache_relocs_pw(&relocs, item, byname);
+	    break;
+	case 'g':
+	    pwcache_relocs_gr(&relocs, item, byname);
+	    break;
+	case 'l':
+	    pwcache_relocs_gidlist(&relocs, item);
+	    break;
+	}
+	pwcache_put(key, item, &relocs);
+	free(relocs.pairs);
+    }
+    errno = serrno;
+
+    debug_return;
+}
+
+/*
+ * Shared cache front end for sudo_make_pwitem().
+ */
+struct cache_item *
+sudo_shared_make_pwitem(uid_t uid, const char *name)
+{
+    struct cache_item *item;
+    char key[PWCACHE_MAX_KEY];
+    int len;
+    debug_decl(sudo_shared_make_pwitem, SUDOERS_DEBUG_NSS);
+
+    if (pwcache.fd == -1)
+	debug_return_ptr(sudo_make_pwitem(uid, name));
+
+    if (name != NULL)
+	len = snprintf(key, sizeof(key), "u:%s", name);
+    else
+	len = snprintf(key, sizeof(key), "U:%u", (unsigned int)uid);
+    if (len < 0 || (size_t)len >= sizeof(key))
+	debug_return_ptr(sudo_make_pwitem(uid, name));
+    if (pwcache_get(key, &item))
+	debug_return_ptr(item);
+
+    item = sudo_make_pwitem(uid, name);
+    pwcache_store(key, item, 'u', name != NULL);
+    debug_return_ptr(item);
+}
+
+/*
+ * Shared cache front end for sudo_make_gritem().
+ */
+struct cache_item *
+sudo_shared_make_gritem(gid_t gid, const char *name)
+{
+    struct cache_item *item;
+    char key[PWCACHE_MAX_KEY];
+    int len;
+    debug_decl(sudo_shared_make_gritem, SUDOERS_DEBUG_NSS);
+
+    if (pwcache.fd == -1)
+	debug_return_ptr(sudo_make_gritem(gid, name));
+
+    if (name != NULL)
+	len = snprintf(key, sizeof(key), "g:%s", name);
+    else
+	len = snprintf(key, sizeof(key), "G:%u", (unsigned int)gid);
+    if (len < 0 || (size_t)len >= sizeof(key))
+	debug_return_ptr(sudo_make_gritem(gid, name));
+    if (pwcache_get(key, &item))
+	debug_return_ptr(item);
+
+    item = sudo_make_gritem(gid, name);
+    pwcache_store(key, item, 'g', name != NULL);
+    debug_return_ptr(item);
+}
+
+/*
+ * Shared cache front end for sudo_make_gidlist_item().
+ * Only group lists queried from the group database are shared,
+ * not those passed in by the sudo front-end.
+ */
+struct cache_item *
+sudo_shared_make_gidlist_item(const struct passwd *pw, int ngids,
+    GETGROUPS_T *gids, char * const *gidstrs, unsigned int type)
+{
+    struct cache_item *item;
+    char key[PWCACHE_MAX_KEY];
+    int len;
+    debug_decl(sudo_shared_make_gidlist_item, SUDOERS_DEBUG_NSS);
+
+    if (pwcache.fd == -1 ||
+	    (type != ENTRY_TYPE_QUERIED && (gids != NULL || gidstrs != NULL))) {
+	debug_return_ptr(sudo_make_gidlist_item(pw, ngids, gids, gidstrs,
+	    type));
+    }
+
+    /* The list depends on the primary group and the max_groups setting. */
+    len = snprintf(key, sizeof(key), "l:%d:%u:%s",
+	sudo_pwutil_get_max_groups(), (unsigned int)pw->pw_gid, pw->pw_name);
+    if (len < 0 || (size_t)len >= sizeof(key)) {
+	debug_return_ptr(sudo_make_gidlist_item(pw, ngids, gids, gidstrs,
+	    type));
+    }
+    if (pwcache_get(key, &item))
+	debug_return_ptr(item);
+
+    item = sudo_make_gidlist_item(pw, ngids, gids, gidstrs, type);
+    pwcache_store(key, item, 'l', true);
+    debug_return_ptr(item);
+}
@@ -0,0 +1,346 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+
+#include <sudo_compat.h>
+#include <sudo_fatal.h>
+#include <sudo_queue.h>
+#include <sudo_digest.h>
+#include <sudo_util.h>
+#include <parse.h>
+
+/*
+ * Check that digests are stored in and read from the digest cache,
+ * that recently changed files are not cached and that entries with
+ * the wrong mode are ignored.  The source file is used as the cached
+ * file since its change time is not recent.
+ * With -b, time hashing a large file with and without the cache.
+ */
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+static char cache_dir[PATH_MAX];
+static const char *cache;
+static int verbose;
+
+/*
+ * Return the path to the only entry in the cache directory, or
+ * NULL if the cache directory does not contain exactly one entry.
+ */
+static char *
+cache_entry(void)
+{
+    static char path[PATH_MAX];
+    struct dirent *dp;
+    int nentries = 0;
+    DIR *dirp;
+
+    if ((dirp = opendir(cache_dir)) == NULL)
+	return NULL;
+    while ((dp = readdir(dirp)) != NULL) {
+	if (dp->d_name[0] == '.')
+	    continue;
+	(void)snprintf(path, sizeof(path), "%s/%s", cache_dir, dp->d_name);
+	nentries++;
+    }
+    closedir(dirp);
+    return nentries == 1 ? path : NULL;
+}
+
+/*
+ * Invert the digest stored in the cache entry so we can tell
+ * whether the cached value was used.
+ */
+static bool
+corrupt_entry(const char *path, const unsigned char *digest,
+    size_t digest_len)
+{
+    unsigned char buf[1024];
+    bool ret = false;
+    ssize_t nread;
+    size_t i, off;
+    int fd;
+
+    if ((fd = open(path, O_RDWR)) == -1)
+	return false;
+    nread = read(fd, buf, sizeof(buf));
+    for (off = 0; nread > 0 && off + digest_len <= (size_t)nread; off++) {
+	if (memcmp(buf + off, digest, digest_len) == 0) {
+	    for (i = 0; i < digest_len; i++)
+		buf[off + i] ^= 0xff;
+	    ret = pwrite(fd, buf + off, digest_len, (off_t)off) ==
+		(ssize_t)digest_len;
+	    break;
+	}
+    }
+    close(fd);
+    return ret;
+}
+
+static unsigned char *
+cached_digest(const char *path, unsigned int digest_type, size_t *digest_len)
+{
+    unsigned char *digest;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) == -1) {
+	sudo_warn_nodebug("%s", path);
+	return NULL;
+    }
+    digest = sudo_filedigest_cached(fd, path, digest_type, cache, digest_len);
+    close(fd);
+    return digest;
+}
+
+static void
+test_cache(const char *scratch, const char *source, int *ntests, int *errors)
+{
+    unsigned char *expected = NULL, *digest = NULL;
+    char fresh[PATH_MAX], *entry;
+    size_t digest_len, expected_len;
+    struct stat sb;
+    int fd;
+
+    /* Reference digest, computed without the cache. */
+    cache = NULL;
+    expected = cached_digest(source, SUDO_DIGEST_SHA256, &expected_len);
+    if (expected == NULL) {
+	(*errors)++;
+	return;
+    }
+    if (stat(source, &sb) == 0 && sb.st_ctime > time(NULL) - 3)
+	sleep(3);
+
+    /* A freshly written file is hashed but not cached. */
+    (void)snprintf(fresh, sizeof(fresh), "%s/fresh", scratch);
+    fd = open(fresh, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR);
+    if (fd == -1 || write(fd, "fresh\n", 6) != 6) {
+	sudo_warn_nodebug("%s", fresh);
+	(*errors)++;
+	goto done;
+    }
+    close(fd);
+    cache = cache_dir;
+    (*ntests)++;
+    digest = cached_digest(fresh, SUDO_DIGEST_SHA256, &digest_len);
+    if (digest == NULL || cache_entry() != NULL) {
+	sudo_warnx_nodebug("%s: recently changed file was cached", fresh);
+	(*errors)++;
+    }
+    free(digest);
+    unlink(fresh);
+
+    /* Cache miss, the digest is stored in a new entry. */
+    (*ntests)++;
+    digest = cached_digest(source, SUDO_DIGEST_SHA256, &digest_len);
+    entry = cache_entry();
+    if (digest == NULL || digest_len != expected_len ||
+	    memcmp(digest, expected, expected_len) != 0 || entry == NULL) {
+	sudo_warnx_nodebug("%s: digest not cached", source);
+	(*errors)++;
+	goto done;
+    }
+    free(digest);
+    if (verbose)
+	printf("%s: cached in %s\n", source, entry);
+
+    /* Cache hit, the (modified) cached digest is returned. */
+    (*ntests)++;
+    if (!corrupt_entry(entry, expected, expected_len)) {
+	sudo_warnx_nodebug("%s: unable to modify cache entry", entry);
+	(*errors)++;
+	goto done;
+    }
+    digest = cached_digest(source, SUDO_DIGEST_SHA256, &digest_len);
+    if (digest == NULL || memcmp(digest, expected, expected_len) == 0) {
+	sudo_warnx_nodebug("%s: cache entry not used", entry);
+	(*errors)++;
+    }
+    free(digest);
+
+    /* A different digest type does not use the same entry. */
+    (*ntests)++;
+    digest = cached_digest(source, SUDO_DIGEST_SHA512, &digest_len);
+    if (digest == NULL || digest_len == expected_len) {
+	sudo_warnx_nodebug("%s: wrong digest type returned", source);
+	(*errors)++;
+    }
+    free(digest);
+
+    /* Writable entries are ignored. */
+    (*ntests)++;
+    if (chmod(entry, S_IRUSR|S_IWUSR|S_IWGRP|S_IWOTH) != 0) {
+	sudo_warn_nodebug("%s", entry);
+	(*errors)++;
+	goto done;
+    }
+    digest = cached_digest(source, SUDO_DIGEST_SHA256, &digest_len);
+    if (digest == NULL || memcmp(digest, expected, expected_len) != 0) {
+	sudo_warnx_nodebug("%s: insecure cache entry used", entry);
+	(*errors)++;
+    }
+
+done:
+    free(digest);
+    free(expected);
+    cache = NULL;
+}
+
+static double
+elapsed_ms(const struct timespec *start, const struct timespec *end)
+{
+    struct timespec diff;
+
+    sudo_timespecsub(end, start, &diff);
+    return (double)diff.tv_sec * 1000.0 + (double)diff.tv_nsec / 1000000.0;
+}
+
+/*
+ * Time computing the SHA-256 digest of path with and without the cache.
+ */
+static int
+benchmark(const char *path, unsigned int iterations)
+{
+    struct timespec start, end;
+    double hash_ms = 0.0, cache_ms = 0.0;
+    unsigned char *digest;
+    size_t digest_len;
+    struct stat sb;
+    unsigned int i;
+
+    if (stat(path, &sb) != 0) {
+	sudo_warn_nodebug("%s", path);
+	return EXIT_FAILURE;
+    }
+    if (sb.st_ctime > time(NULL) - 3)
+	sleep(3);
+
+    for (i = 0; i < iterations; i++) {
+	cache = NULL;
+	sudo_gettime_mono(&start);
+	digest = cached_digest(path, SUDO_DIGEST_SHA256, &digest_len);
+	sudo_gettime_mono(&end);
+	if (digest == NULL)
+	    return EXIT_FAILURE;
+	free(digest);
+	hash_ms += elapsed_ms(&start, &end);
+
+	cache = cache_dir;
+	sudo_gettime_mono(&start);
+	digest = cached_digest(path, SUDO_DIGEST_SHA256, &digest_len);
+	sudo_gettime_mono(&end);
+	if (digest == NULL)
+	    return EXIT_FAILURE;
+	free(digest);
+	/* The first lookup fills the cache. */
+	if (i != 0)
+	    cache_ms += elapsed_ms(&start, &end);
+    }
+    cache = NULL;
+
+    printf("%s: %lld bytes, %u iterations: hash %.3f ms, cache %.3f ms\n",
+	path, (long long)sb.st_size, iterations, hash_ms / iterations,
+	iterations > 1 ? cache_ms / (iterations - 1) : 0.0);
+    return EXIT_SUCCESS;
+}
+
+static void
+cleanup(void)
+{
+    char path[PATH_MAX];
+    struct dirent *dp;
+    DIR *dirp;
+
+    if ((dirp = opendir(cache_dir)) != NULL) {
+	while ((dp = readdir(dirp)) != NULL) {
+	    if (dp->d_name[0] == '.')
+		continue;
+	    (void)snprintf(path, sizeof(path), "%s/%s", cache_dir,
+		dp->d_name);
+	    unlink(path);
+	}
+	closedir(dirp);
+    }
+    rmdir(cache_dir);
+}
+
+sudo_noreturn static void
+usage(void)
+{
+    fprintf(stderr, "usage: %s [-v] [-b file] scratch_dir source_file\n",
+	getprogname());
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ch, ret, ntests = 0, errors = 0;
+    const char *bench_file = NULL;
+
+    initprogname(argc > 0 ? argv[0] : "check_digest_cache");
+
+    while ((ch = getopt(argc, argv, "b:v")) != -1) {
+	switch (ch) {
+	case 'b':
+	    bench_file = optarg;
+	    break;
+	case 'v':
+	    verbose = 1;
+	    break;
+	default:
+	    usage();
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc != (bench_file != NULL ? 1 : 2))
+	usage();
+
+    /* The cache directory is created on first use. */
+    (void)snprintf(cache_dir, sizeof(cache_dir), "%s/cache", argv[0]);
+    cleanup();
+
+    if (bench_file != NULL) {
+	ret = benchmark(bench_file, 10);
+	cleanup();
+	return ret;
+    }
+
+    test_cache(argv[0], argv[1], &ntests, &errors);
+    cleanup();
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+
+    return errors;
+}
@@ -820,6 +820,13 @@ sudoers_lookup(struct sudo_nss_list *snl, struct sudoers_context *ctx,
     return VALIDATE_SUCCESS;
 }
 
+/* STUB */
+bool
+apply_cmndspec(struct sudoers_context *ctx, struct cmndspec *cs)
+{
+    return true;
+}
+
 /* STUB */
 int
 display_cmnd(struct sudoers_context *ctx, const struct sudo_nss_list *snl,
@@ -205,10 +205,11 @@ validate_timing(FILE *fp, int recno, int type, unsigned int p1, unsigned int p2)
 
 /*
  * Test sudoers I/O log plugin endpoints.
+ * If async is set, the log files are written by a separate process.
  */
 static void
 test_endpoints(const struct sudoers_context *ctx, int *ntests, int *nerrors,
-    const char *iolog_dir, char *envp[])
+    const char *iolog_dir, char *envp[], bool async)
 {
     int rc, cmnd_argc = 1;
     const char *errstr = NULL;
@@ -240,6 +241,7 @@ test_endpoints(const struct sudoers_context *ctx, int *ntests, int *nerrors,
 	"iolog_mode=0644",
 	runas_gid,
 	runas_uid,
+	async ? "iolog_async=true" : NULL,
 	NULL
     };
     char *settings[] = {
@@ -361,6 +363,7 @@ main(int argc, char *argv[], char *envp[])
 {
     struct passwd *tpw;
     int ch, tests = 0, errors = 0;
+    char async_dir[PATH_MAX];
     const char *iolog_dir;
 
     initprogname(argc > 0 ? argv[0] : "check_iolog_plugin");
@@ -397,7 +400,13 @@ main(int argc, char *argv[], char *envp[])
     /* Set iolog uid/gid to invoking user. */
     iolog_set_owner(io_ctx.user.pw->pw_uid, io_ctx.user.pw->pw_gid);
 
-    test_endpoints(&io_ctx, &tests, &errors, iolog_dir, envp);
+    test_endpoints(&io_ctx, &tests, &errors, iolog_dir, envp, false);
+
+    /* Same tests with an I/O log writer process. */
+    if (snprintf(async_dir, sizeof(async_dir), "%s/async", iolog_dir) >=
+	    ssizeof(async_dir))
+	sudo_fatalx("%s/async: %s", iolog_dir, strerror(ENAMETOOLONG));
+    test_endpoints(&io_ctx, &tests, &errors, async_dir, envp, true);
 
     if (tests != 0) {
 	printf("check_iolog_plugin: %d test%s run, %d errors, %d%% success rate\n",
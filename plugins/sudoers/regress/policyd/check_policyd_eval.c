@@ -0,0 +1,204 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Evaluate "check" requests the way sudo_policyd does and verify
+ * that runas matching honors whether -u and -g were specified and
+ * that group matching uses the group list sent by the front end.
+ * Also verify that the reply reports command-specific Defaults,
+ * which disable the intercept cache.
+ */
+
+/* Use our own main() instead of the daemon's. */
+#define main policyd_main
+#include "policyd.c"
+#undef main
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+static int ntests, errors;
+static int verbose;
+static struct passwd *test_pw;
+
+/*
+ * Send a check request for cmnd with the given runas user and group
+ * and front end group list (any may be NULL), storing the reply.
+ * Returns NULL on success, else an error string.
+ */
+static const char *
+send_check(const char *cmnd, const char *runas_user, const char *runas_group,
+    const char *groups, struct policyd_msg *reply)
+{
+    struct policyd_msg req = { NULL };
+    const char *errstr;
+
+    policyd_msg_add(&req, "version=%d", POLICYD_PROTOCOL_VERSION);
+    policyd_msg_add(&req, "request=check");
+    policyd_msg_add(&req, "sudoers_file=%s", policyd_conf.sudoers_path);
+    policyd_msg_add(&req, "user=%s", test_pw->pw_name);
+    policyd_msg_add(&req, "uid=%u", (unsigned int)test_pw->pw_uid);
+    policyd_msg_add(&req, "gid=%u", (unsigned int)test_pw->pw_gid);
+    if (groups != NULL)
+	policyd_msg_add(&req, "groups=%s", groups);
+    policyd_msg_add(&req, "host=localhost");
+    policyd_msg_add(&req, "mode=%u", MODE_RUN);
+    if (runas_user != NULL) {
+	policyd_msg_add(&req, "runas_user=%s", runas_user);
+	policyd_msg_add(&req, "runas_user_specified=1");
+    }
+    if (runas_group != NULL) {
+	policyd_msg_add(&req, "runas_group=%s", runas_group);
+	policyd_msg_add(&req, "runas_group_specified=1");
+    }
+    policyd_msg_add(&req, "cmnd=%s", cmnd);
+    policyd_msg_add(&req, "cmnd_status=%d", FOUND);
+    if (req.error)
+	sudo_fatalx_nodebug("unable to allocate memory");
+
+    errstr = policyd_eval(req.strv, reply);
+    if (errstr != NULL)
+	sudo_warnx_nodebug("%s: %s", cmnd, errstr);
+    policyd_msg_free(&req);
+
+    return errstr;
+}
+
+/*
+ * Returns true if the daemon allowed cmnd, see send_check().
+ */
+static bool
+check_cmnd(const char *cmnd, const char *runas_user, const char *runas_group,
+    const char *groups)
+{
+    struct policyd_msg reply = { NULL };
+    const char *errstr, *val;
+    unsigned int validated = 0;
+
+    if (send_check(cmnd, runas_user, runas_group, groups, &reply) == NULL &&
+	    (val = policyd_getval(reply.strv, "validated")) != NULL) {
+	validated = (unsigned int)sudo_strtonum(val, 0, UINT_MAX, &errstr);
+	if (errstr != NULL)
+	    validated = 0;
+    }
+    policyd_msg_free(&reply);
+
+    return ISSET(validated, VALIDATE_SUCCESS);
+}
+
+/*
+ * Returns true if the daemon reported command-specific Defaults
+ * in the policy when checking cmnd.
+ */
+static bool
+check_cmnd_defaults(const char *cmnd)
+{
+    struct policyd_msg reply = { NULL };
+    const char *val;
+    bool ret = false;
+
+    if (send_check(cmnd, NULL, NULL, NULL, &reply) == NULL) {
+	val = policyd_getval(reply.strv, "cmnd_defaults");
+	ret = val != NULL && *val == '1';
+    }
+    policyd_msg_free(&reply);
+
+    return ret;
+}
+
+static void
+check(bool ok, const char *what)
+{
+    ntests++;
+    if (!ok) {
+	errors++;
+	sudo_warnx_nodebug("%s: FAILED", what);
+    } else if (verbose) {
+	sudo_warnx_nodebug("%s: OK", what);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    char groups[STRLEN_MAX_UNSIGNED(gid_t) * 2 + 2];
+    struct stat sb;
+    int ch;
+
+    initprogname(argc > 0 ? argv[0] : "check_policyd_eval");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose++;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v] sudoers_file\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 1) {
+	fprintf(stderr, "usage: %s [-v] sudoers_file\n", getprogname());
+	return EXIT_FAILURE;
+    }
+
+    if (!sudoers_initlocale(setlocale(LC_ALL, ""), def_sudoers_locale))
+	sudo_fatalx_nodebug("unable to allocate memory");
+    if ((test_pw = sudo_getpwuid(getuid())) == NULL)
+	sudo_fatalx_nodebug("unknown uid %u", (unsigned int)getuid());
+
+    /* The test sudoers file is owned by whoever built sudo. */
+    if (stat(argv[0], &sb) == -1)
+	sudo_fatal_nodebug("%s", argv[0]);
+    policyd_conf.sudoers_path = argv[0];
+    policyd_conf.sudoers_uid = sb.st_uid;
+    policyd_conf.sudoers_gid = sb.st_gid;
+    update_defaults_hook = record_default;
+    policyd_reload();
+    if (!policy_loaded)
+	sudo_fatalx_nodebug("unable to load %s", argv[0]);
+
+    /* sudo -g */
+    check(check_cmnd("/bin/ls", NULL, "#0", NULL), "-g matching group");
+    check(!check_cmnd("/bin/ls", NULL, "#1", NULL), "-g non-matching group");
+
+    /* sudo -u -g */
+    check(check_cmnd("/bin/sh", "#0", "#0", NULL),
+	"-u -g matching user and group");
+    check(!check_cmnd("/bin/sh", "#0", "#1", NULL),
+	"-u -g non-matching group");
+
+    /* Supplementary group from the front end, not the group database. */
+    (void)snprintf(groups, sizeof(groups), "%u,54321",
+	(unsigned int)test_pw->pw_gid);
+    check(check_cmnd("/bin/cat", NULL, NULL, groups),
+	"front end supplementary group");
+    check(!check_cmnd("/bin/cat", NULL, NULL, NULL),
+	"no front end supplementary group");
+
+    /* Command-specific Defaults must disable the intercept cache. */
+    check(check_cmnd_defaults("/bin/ls"), "command-specific Defaults");
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+
+    return errors;
+}
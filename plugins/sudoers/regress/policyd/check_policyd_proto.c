@@ -0,0 +1,188 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudoers.h>
+#include <policyd.h>
+
+/*
+ * Send messages to sudo_policyd over a socket pair and verify that
+ * they are received intact, that Defaults entries survive encoding
+ * and decoding and that malformed messages are rejected.
+ */
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+static int ntests, errors;
+static int verbose;
+
+static void
+check(bool ok, const char *what)
+{
+    ntests++;
+    if (!ok) {
+	errors++;
+	sudo_warnx("%s: FAILED", what);
+    } else if (verbose) {
+	sudo_warnx("%s: OK", what);
+    }
+}
+
+static bool
+check_default(const char *op_str, int op, const char *val, const char *want)
+{
+    struct defaults d;
+    struct policyd_msg msg = { NULL };
+    const char *name, *pval;
+    size_t namelen;
+    int pop;
+    bool ret = false;
+
+    memset(&d, 0, sizeof(d));
+    d.var = (char *)"secure_path";
+    d.val = (char *)val;
+    d.op = (char)op;
+    if (!policyd_msg_add_default(&msg, "default", &d))
+	goto done;
+    if (strcmp(msg.strv[0], want) != 0) {
+	sudo_warnx("%s: got %s, want %s", op_str, msg.strv[0], want);
+	goto done;
+    }
+    if (!policyd_parse_default(msg.strv[0] + sizeof("default"), &name,
+	    &namelen, &pval, &pop))
+	goto done;
+    if (namelen != strlen(d.var) || strncmp(name, d.var, namelen) != 0)
+	goto done;
+    if (pop != op)
+	goto done;
+    if (val == NULL ? pval != NULL : (pval == NULL || strcmp(pval, val) != 0))
+	goto done;
+    ret = true;
+done:
+    policyd_msg_free(&msg);
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct policyd_msg msg = { NULL };
+    const char *name, *val;
+    char **strv;
+    size_t namelen;
+    uint32_t len;
+    int ch, op, sv[2];
+
+    initprogname(argc > 0 ? argv[0] : "check_policyd_proto");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose++;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+	sudo_fatal_nodebug("socketpair");
+
+    /* round trip */
+    check(policyd_msg_add(&msg, "version=%d", POLICYD_PROTOCOL_VERSION),
+	"add version");
+    check(policyd_msg_add(&msg, "request=%s", "check"), "add request");
+    check(policyd_msg_add(&msg, "cmnd_args=%s", ""), "add empty value");
+    check(policyd_write_msg(sv[0], &msg), "write message");
+    strv = policyd_read_msg(sv[1]);
+    check(strv != NULL, "read message");
+    if (strv != NULL) {
+	val = policyd_getval(strv, "version");
+	check(val != NULL && strcmp(val, "1") == 0, "get version");
+	val = policyd_getval(strv, "request");
+	check(val != NULL && strcmp(val, "check") == 0, "get request");
+	val = policyd_getval(strv, "cmnd_args");
+	check(val != NULL && *val == '\0', "get empty value");
+	check(policyd_getval(strv, "cmnd") == NULL, "missing value");
+	check(policyd_getval(strv, "versio") == NULL, "name prefix");
+	free(strv);
+    }
+    policyd_msg_free(&msg);
+
+    /* an empty message is valid */
+    check(policyd_write_msg(sv[0], &msg), "write empty message");
+    strv = policyd_read_msg(sv[1]);
+    check(strv != NULL && strv[0] == NULL, "read empty message");
+    free(strv);
+
+    /* message that is not NUL-terminated */
+    len = htonl(3);
+    check(write(sv[0], &len, sizeof(len)) == sizeof(len) &&
+	write(sv[0], "a=b", 3) == 3 && policyd_read_msg(sv[1]) == NULL,
+	"unterminated message rejected");
+
+    /* message that is too large */
+    len = htonl(POLICYD_MSG_MAX + 1);
+    check(write(sv[0], &len, sizeof(len)) == sizeof(len) &&
+	policyd_read_msg(sv[1]) == NULL, "large message rejected");
+
+    /* truncated message */
+    len = htonl(16);
+    check(write(sv[0], &len, sizeof(len)) == sizeof(len) &&
+	write(sv[0], "a=b", 4) == 4 && close(sv[0]) == 0 &&
+	policyd_read_msg(sv[1]) == NULL, "truncated message rejected");
+    close(sv[1]);
+
+    /* Defaults entries */
+    check(check_default("boolean", true, NULL, "default=secure_path"),
+	"boolean default");
+    check(check_default("negated", false, NULL, "default=!secure_path"),
+	"negated default");
+    check(check_default("assign", true, "/bin:/usr/bin",
+	"default=secure_path=/bin:/usr/bin"), "assigned default");
+    check(check_default("append", '+', "/sbin",
+	"default=secure_path+=/sbin"), "appended default");
+    check(check_default("remove", '-', "/sbin",
+	"default=secure_path-=/sbin"), "removed default");
+    check(check_default("value with equals", true, "a=b",
+	"default=secure_path=a=b"), "default value containing '='");
+    check(!policyd_parse_default("!env_keep=FOO", &name, &namelen, &val, &op),
+	"negated default with value rejected");
+    check(!policyd_parse_default("=foo", &name, &namelen, &val, &op),
+	"default without a name rejected");
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+
+    return errors;
+}
@@ -0,0 +1,279 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <pwd.h>
+#include <grp.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudoers.h>
+#include <pwutil.h>
+
+#include <def_data.c>
+
+/*
+ * Store passwd, group and group list entries for the invoking user
+ * in a shared cache and verify that they are returned intact from
+ * the cache, both in the same process and after the cache is reopened.
+ * Also check negative entries, expiration and that a cache file with
+ * unsafe permissions is ignored.
+ */
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+static int ntests, errors;
+static int verbose;
+
+static void
+check(bool ok, const char *what)
+{
+    ntests++;
+    if (!ok) {
+	errors++;
+	sudo_warnx("%s: FAILED", what);
+    } else if (verbose) {
+	sudo_warnx("%s: OK", what);
+    }
+}
+
+/*
+ * Returns true if the lookup was a cache hit.
+ */
+static bool
+was_hit(unsigned int *prev_hits)
+{
+    unsigned int hits, misses;
+    bool ret;
+
+    sudo_pwutil_shared_stats(&hits, &misses);
+    ret = hits > *prev_hits;
+    *prev_hits = hits;
+    return ret;
+}
+
+static bool
+same_pw(const struct cache_item *item, const struct passwd *pw)
+{
+    const struct passwd *cpw;
+
+    if (item == NULL || pw == NULL)
+	return false;
+    cpw = item->d.pw;
+    return cpw->pw_uid == pw->pw_uid && cpw->pw_gid == pw->pw_gid &&
+	strcmp(cpw->pw_name, pw->pw_name) == 0 &&
+	strcmp(cpw->pw_dir, pw->pw_dir) == 0 && item->refcnt == 1;
+}
+
+static bool
+same_gr(const struct cache_item *item, const struct group *gr)
+{
+    const struct group *cgr;
+    size_t n;
+
+    if (item == NULL || gr == NULL)
+	return false;
+    cgr = item->d.gr;
+    if (cgr->gr_gid != gr->gr_gid || strcmp(cgr->gr_name, gr->gr_name) != 0)
+	return false;
+    for (n = 0; gr->gr_mem[n] != NULL; n++) {
+	if (cgr->gr_mem[n] == NULL || strcmp(cgr->gr_mem[n], gr->gr_mem[n]) != 0)
+	    return false;
+    }
+    return cgr->gr_mem[n] == NULL;
+}
+
+static bool
+same_gidlist(const struct cache_item *a, const struct cache_item *b)
+{
+    const struct gid_list *ga, *gb;
+    int n;
+
+    if (a == NULL || b == NULL)
+	return false;
+    ga = a->d.gidlist;
+    gb = b->d.gidlist;
+    if (ga->ngids != gb->ngids || a->type != b->type)
+	return false;
+    for (n = 0; n < ga->ngids; n++) {
+	if (ga->gids[n] != gb->gids[n])
+	    return false;
+    }
+    return true;
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr, "usage: %s [-v] scratch_dir\n", getprogname());
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct cache_item *pwitem, *gritem, *item2;
+    unsigned int hits = 0;
+    struct passwd *pw;
+    struct group *gr;
+    char path[PATH_MAX];
+    int ch, len;
+
+    initprogname(argc > 0 ? argv[0] : "check_pwutil_shared");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose = 1;
+	    break;
+	default:
+	    usage();
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 1)
+	usage();
+
+    len = snprintf(path, sizeof(path), "%s/pwcache", argv[0]);
+    if (len < 0 || (size_t)len >= sizeof(path))
+	sudo_fatalx("%s/pwcache: %s", argv[0], strerror(ENAMETOOLONG));
+    unlink(path);
+
+    /* Copy the invoking user's entries, getpwuid() reuses its buffer. */
+    if ((pwitem = sudo_make_pwitem(getuid(), NULL)) == NULL)
+	sudo_fatalx("unable to look up uid %u", (unsigned int)getuid());
+    pw = pwitem->d.pw;
+    if ((gritem = sudo_make_gritem(pw->pw_gid, NULL)) == NULL)
+	sudo_fatalx("unable to look up gid %u", (unsigned int)pw->pw_gid);
+    gr = gritem->d.gr;
+
+    if (geteuid() != ROOT_UID) {
+	/* The cache must be owned by root, it is ignored otherwise. */
+	check(!sudo_pwutil_shared_open(path, 60), "non-root cache ignored");
+	goto done;
+    }
+
+    check(sudo_pwutil_shared_open(path, 60), "open new cache");
+
+    /* passwd by uid and name */
+    item2 = sudo_shared_make_pwitem(pw->pw_uid, NULL);
+    check(same_pw(item2, pw) && !was_hit(&hits), "uid miss");
+    free(item2);
+    item2 = sudo_shared_make_pwitem(pw->pw_uid, NULL);
+    check(same_pw(item2, pw) && was_hit(&hits), "uid hit");
+    check(item2 != NULL && item2->k.uid == pw->pw_uid, "uid key");
+    free(item2);
+    item2 = sudo_shared_make_pwitem(0, pw->pw_name);
+    check(same_pw(item2, pw) && !was_hit(&hits), "user name miss");
+    free(item2);
+    item2 = sudo_shared_make_pwitem(0, pw->pw_name);
+    check(same_pw(item2, pw) && was_hit(&hits), "user name hit");
+    check(item2 != NULL && strcmp(item2->k.name, pw->pw_name) == 0,
+	"user name key");
+    free(item2);
+
+    /* group by gid and name */
+    item2 = sudo_shared_make_gritem(gr->gr_gid, NULL);
+    check(same_gr(item2, gr) && !was_hit(&hits), "gid miss");
+    free(item2);
+    item2 = sudo_shared_make_gritem(gr->gr_gid, NULL);
+    check(same_gr(item2, gr) && was_hit(&hits), "gid hit");
+    free(item2);
+    item2 = sudo_shared_make_gritem(0, gr->gr_name);
+    check(same_gr(item2, gr) && !was_hit(&hits), "group name miss");
+    free(item2);
+    item2 = sudo_shared_make_gritem(0, gr->gr_name);
+    check(same_gr(item2, gr) && was_hit(&hits), "group name hit");
+    free(item2);
+
+    /* group list, only queried lists are shared */
+    {
+	struct cache_item *gl1, *gl2;
+
+	gl1 = sudo_shared_make_gidlist_item(pw, -1, NULL, NULL,
+	    ENTRY_TYPE_QUERIED);
+	(void)was_hit(&hits);
+	gl2 = sudo_shared_make_gidlist_item(pw, -1, NULL, NULL,
+	    ENTRY_TYPE_QUERIED);
+	check(same_gidlist(gl1, gl2) && was_hit(&hits), "group list hit");
+	free(gl1);
+	free(gl2);
+    }
+
+    /* negative entries */
+    errno = 0;
+    item2 = sudo_shared_make_pwitem(0, "no-such-user.pwutil");
+    check(item2 == NULL && errno == ENOENT && !was_hit(&hits),
+	"unknown user miss");
+    errno = 0;
+    item2 = sudo_shared_make_pwitem(0, "no-such-user.pwutil");
+    check(item2 == NULL && errno == ENOENT && was_hit(&hits),
+	"unknown user hit");
+
+    /* entries are still there after reopening */
+    sudo_pwutil_shared_close();
+    check(sudo_pwutil_shared_open(path, 60), "reopen cache");
+    hits = 0;
+    item2 = sudo_shared_make_pwitem(0, pw->pw_name);
+    check(same_pw(item2, pw) && was_hit(&hits), "user name hit after reopen");
+    free(item2);
+
+    /* expired entries are looked up again */
+    sudo_pwutil_shared_close();
+    unlink(path);
+    check(sudo_pwutil_shared_open(path, 1), "open cache with short ttl");
+    hits = 0;
+    item2 = sudo_shared_make_gritem(gr->gr_gid, NULL);
+    free(item2);
+    sleep(2);
+    item2 = sudo_shared_make_gritem(gr->gr_gid, NULL);
+    check(same_gr(item2, gr) && !was_hit(&hits), "expired entry");
+    free(item2);
+
+    /* unsafe permissions */
+    sudo_pwutil_shared_close();
+    check(chmod(path, S_IRUSR|S_IWUSR|S_IROTH) == 0 &&
+	!sudo_pwutil_shared_open(path, 60), "world-readable cache ignored");
+
+    /* with no cache, lookups go straight to the database */
+    item2 = sudo_shared_make_pwitem(pw->pw_uid, NULL);
+    check(same_pw(item2, pw), "lookup without cache");
+    free(item2);
+
+done:
+    unlink(path);
+    free(gritem);
+    free(pwitem);
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+
+    return errors;
+}
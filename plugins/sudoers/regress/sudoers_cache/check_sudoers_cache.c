@@ -0,0 +1,553 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pwd.h>
+#include <time.h>
+
+#define SUDO_ERROR_WRAP 0
+
+#include <sudoers.h>
+#include <sudo_lbuf.h>
+#include <gram.h>
+
+/*
+ * Parse sudoers files, write them to a binary cache and verify that
+ * the cached parse tree formats identically to the parsed one and
+ * that the cache is rejected once the source file, or a skipped
+ * include dir entry, changes.
+ * With -b, time a cold parse against a cache load of a large,
+ * generated sudoers file instead.
+ */
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+static struct sudoers_context test_ctx = SUDOERS_CONTEXT_INITIALIZER;
+static const char *scratch_dir;
+static int verbose;
+
+/* Formatted parse tree, filled in by the lbuf output function. */
+static char *format_buf;
+static size_t format_len;
+static bool format_error;
+
+bool
+set_perms(const struct sudoers_context *ctx, int perm)
+{
+    return true;
+}
+
+bool
+restore_perms(void)
+{
+    return true;
+}
+
+bool
+sudo_nss_can_continue(const struct sudo_nss *nss, int match)
+{
+    return true;
+}
+
+FILE *
+open_sudoers(const char *file, char **outfile, bool doedit, bool *keepopen)
+{
+    /* Includes are not supported. */
+    return NULL;
+}
+
+static int
+format_output(const char *str)
+{
+    const size_t len = strlen(str);
+    char *newbuf;
+
+    newbuf = realloc(format_buf, format_len + len + 1);
+    if (newbuf == NULL) {
+	format_error = true;
+	return -1;
+    }
+    format_buf = newbuf;
+    memcpy(format_buf + format_len, str, len + 1);
+    format_len += len;
+    return (int)len;
+}
+
+static bool
+append_default_lines(struct sudo_lbuf *lbuf,
+    struct sudoers_parse_tree *parse_tree)
+{
+    struct defaults *def, *next;
+
+    TAILQ_FOREACH_SAFE(def, &parse_tree->defaults, entries, next)
+	sudoers_format_default_line(lbuf, parse_tree, def, &next, false);
+
+    return !sudo_lbuf_error(lbuf);
+}
+
+static int
+append_alias(struct sudoers_parse_tree *parse_tree, struct alias *a, void *v)
+{
+    struct sudo_lbuf *lbuf = v;
+    struct member *m;
+
+    sudo_lbuf_append(lbuf, "%s %s = ", alias_type_to_string(a->type),
+	a->name);
+    TAILQ_FOREACH(m, &a->members, entries) {
+	if (m != TAILQ_FIRST(&a->members))
+	    sudo_lbuf_append(lbuf, ", ");
+	sudoers_format_member(lbuf, parse_tree, m, NULL, UNSPEC);
+    }
+    sudo_lbuf_append(lbuf, "\n");
+
+    return sudo_lbuf_error(lbuf) ? -1 : 0;
+}
+
+/*
+ * Format a parse tree as a string, expanding aliases so that
+ * the alias tree of the cached policy is exercised too.
+ * Returns a newly-allocated string or NULL on error.
+ */
+static char *
+format_parse_tree(struct sudoers_parse_tree *parse_tree)
+{
+    struct sudo_lbuf lbuf;
+    char *ret = NULL;
+
+    format_buf = NULL;
+    format_len = 0;
+    format_error = false;
+
+    /* No word wrap on output. */
+    sudo_lbuf_init(&lbuf, format_output, 0, NULL, 0);
+    if (!append_default_lines(&lbuf, parse_tree))
+	goto done;
+    if (alias_apply(parse_tree, append_alias, &lbuf) == false)
+	goto done;
+    sudo_lbuf_print(&lbuf);
+    if (!sudoers_format_userspecs(&lbuf, parse_tree, NULL, false, true))
+	goto done;
+    if (!sudoers_format_userspecs(&lbuf, parse_tree, NULL, true, true))
+	goto done;
+    sudo_lbuf_print(&lbuf);
+    if (!format_error)
+	ret = format_buf ? format_buf : strdup("");
+    else
+	free(format_buf);
+    format_buf = NULL;
+done:
+    sudo_lbuf_destroy(&lbuf);
+    return ret;
+}
+
+/*
+ * Parse path into parse_tree, recording it as a cache source.
+ * Returns true on success, else false.
+ */
+static bool
+parse_file(const char *path, struct sudoers_parse_tree *parse_tree)
+{
+    FILE *fp;
+    bool ret = false;
+
+    if ((fp = fopen(path, "r")) == NULL) {
+	sudo_warn("%s", path);
+	return false;
+    }
+    sudoers_cache_track(true);
+    if (sudoers_cache_add_source(path, fileno(fp))) {
+	init_parser(&test_ctx, path);
+	sudoersin = fp;
+	if (sudoersparse() == 0 && !parse_error) {
+	    reparent_parse_tree(parse_tree);
+	    ret = true;
+	}
+    }
+    init_parser(NULL, NULL);
+    sudoersin = NULL;
+    fclose(fp);
+    return ret;
+}
+
+/*
+ * Copy the contents of src to dst.
+ */
+static bool
+copy_file(const char *src, const char *dst)
+{
+    FILE *ifp, *ofp;
+    char buf[8192];
+    size_t nread;
+    bool ret = true;
+
+    if ((ifp = fopen(src, "r")) == NULL) {
+	sudo_warn("%s", src);
+	return false;
+    }
+    if ((ofp = fopen(dst, "w")) == NULL) {
+	sudo_warn("%s", dst);
+	fclose(ifp);
+	return false;
+    }
+    while ((nread = fread(buf, 1, sizeof(buf), ifp)) != 0) {
+	if (fwrite(buf, 1, nread, ofp) != nread) {
+	    ret = false;
+	    break;
+	}
+    }
+    if (ferror(ifp))
+	ret = false;
+    fclose(ifp);
+    if (fclose(ofp) != 0)
+	ret = false;
+    return ret;
+}
+
+static void
+test_cache(const char *input, int *ntests_out, int *errors_out)
+{
+    struct sudoers_parse_tree parsed, cached;
+    char path[PATH_MAX], cache_path[PATH_MAX];
+    char *parsed_str = NULL, *cached_str = NULL;
+    int ntests = *ntests_out;
+    int errors = *errors_out;
+    FILE *fp;
+
+    init_parse_tree(&parsed, NULL, NULL, &test_ctx, NULL);
+    init_parse_tree(&cached, NULL, NULL, &test_ctx, NULL);
+
+    (void)snprintf(path, sizeof(path), "%s/%s", scratch_dir,
+	sudo_basename(input));
+    (void)snprintf(cache_path, sizeof(cache_path), "%s.cache", path);
+    if (!copy_file(input, path)) {
+	errors++;
+	goto done;
+    }
+
+    /* Files with parse errors cannot be cached, skip them. */
+    if (!parse_file(path, &parsed)) {
+	if (verbose)
+	    printf("%s: skipped (parse error)\n", input);
+	goto done;
+    }
+
+    ntests++;
+    if (!sudoers_cache_write(&test_ctx, cache_path, &parsed)) {
+	sudo_warnx("%s: unable to write cache", input);
+	errors++;
+	goto done;
+    }
+    ntests++;
+    if (!sudoers_cache_read(&test_ctx, cache_path, &cached)) {
+	sudo_warnx("%s: unable to read cache", input);
+	errors++;
+	goto done;
+    }
+
+    ntests++;
+    parsed_str = format_parse_tree(&parsed);
+    cached_str = format_parse_tree(&cached);
+    if (parsed_str == NULL || cached_str == NULL) {
+	sudo_warnx("%s: unable to format parse tree", input);
+	errors++;
+	goto done;
+    }
+    if (strcmp(parsed_str, cached_str) != 0) {
+	sudo_warnx("%s: cached policy differs\n--- parsed\n%s--- cached\n%s",
+	    input, parsed_str, cached_str);
+	errors++;
+	goto done;
+    }
+
+    /* A modified source must invalidate the cache. */
+    ntests++;
+    free_parse_tree(&cached);
+    init_parse_tree(&cached, NULL, NULL, &test_ctx, NULL);
+    if ((fp = fopen(path, "a")) == NULL || fputs("# modified\n", fp) == EOF) {
+	sudo_warn("%s", path);
+	errors++;
+	if (fp != NULL)
+	    fclose(fp);
+	goto done;
+    }
+    fclose(fp);
+    if (sudoers_cache_read(&test_ctx, cache_path, &cached)) {
+	sudo_warnx("%s: stale cache was not rejected", input);
+	errors++;
+	goto done;
+    }
+    if (verbose)
+	printf("%s: OK\n", input);
+
+done:
+    sudoers_cache_track(false);
+    free_parse_tree(&parsed);
+    free_parse_tree(&cached);
+    free(parsed_str);
+    free(cached_str);
+    unlink(cache_path);
+    unlink(path);
+    *ntests_out = ntests;
+    *errors_out = errors;
+}
+
+/*
+ * Verify that changing the mode of an include dir entry that the
+ * parser skipped invalidates the cache.
+ */
+static void
+test_skipped(int *ntests_out, int *errors_out)
+{
+    struct sudoers_parse_tree parsed, cached;
+    char path[PATH_MAX], skipped_path[PATH_MAX], cache_path[PATH_MAX];
+    int ntests = *ntests_out;
+    int errors = *errors_out;
+    FILE *fp;
+
+    init_parse_tree(&parsed, NULL, NULL, &test_ctx, NULL);
+    init_parse_tree(&cached, NULL, NULL, &test_ctx, NULL);
+
+    (void)snprintf(path, sizeof(path), "%s/skipped.sudoers", scratch_dir);
+    (void)snprintf(skipped_path, sizeof(skipped_path), "%s/skipped.d",
+	scratch_dir);
+    (void)snprintf(cache_path, sizeof(cache_path), "%s.cache", path);
+    if ((fp = fopen(path, "w")) == NULL ||
+	    fputs("root ALL = (ALL) ALL\n", fp) == EOF || fclose(fp) != 0) {
+	sudo_warn("%s", path);
+	errors++;
+	goto done;
+    }
+    if ((fp = fopen(skipped_path, "w")) == NULL ||
+	    fputs("ALL ALL = (ALL) NOPASSWD: ALL\n", fp) == EOF ||
+	    fclose(fp) != 0 || chmod(skipped_path, 0666) == -1) {
+	sudo_warn("%s", skipped_path);
+	errors++;
+	goto done;
+    }
+
+    ntests++;
+    if (!parse_file(path, &parsed) ||
+	    !sudoers_cache_add_skipped(skipped_path) ||
+	    !sudoers_cache_write(&test_ctx, cache_path, &parsed) ||
+	    !sudoers_cache_read(&test_ctx, cache_path, &cached)) {
+	sudo_warnx("%s: unable to cache skipped source", skipped_path);
+	errors++;
+	goto done;
+    }
+
+    ntests++;
+    free_parse_tree(&cached);
+    init_parse_tree(&cached, NULL, NULL, &test_ctx, NULL);
+    if (chmod(skipped_path, 0440) == -1) {
+	sudo_warn("%s", skipped_path);
+	errors++;
+	goto done;
+    }
+    if (sudoers_cache_read(&test_ctx, cache_path, &cached)) {
+	sudo_warnx("%s: stale cache was not rejected", skipped_path);
+	errors++;
+	goto done;
+    }
+    if (verbose)
+	printf("%s: OK\n", skipped_path);
+
+done:
+    sudoers_cache_track(false);
+    free_parse_tree(&parsed);
+    free_parse_tree(&cached);
+    unlink(cache_path);
+    unlink(skipped_path);
+    unlink(path);
+    *ntests_out = ntests;
+    *errors_out = errors;
+}
+
+/*
+ * Generate a sudoers file with roughly nlines lines of aliases,
+ * Defaults and user specifications.
+ */
+static bool
+generate_sudoers(const char *path, unsigned int nlines)
+{
+    unsigned int i;
+    FILE *fp;
+
+    if ((fp = fopen(path, "w")) == NULL) {
+	sudo_warn("%s", path);
+	return false;
+    }
+    fputs("Defaults env_reset, !lecture\n", fp);
+    for (i = 0; i * 6 < nlines; i++) {
+	fprintf(fp, "User_Alias USERS%u = user%u, %%group%u, #%u\n",
+	    i, i, i, 10000 + i);
+	fprintf(fp, "Host_Alias HOSTS%u = host%u.example.com, 10.%u.%u.0/24\n",
+	    i, i, (i >> 8) & 0xff, i & 0xff);
+	fprintf(fp, "Cmnd_Alias CMNDS%u = /usr/bin/cmd%u, /usr/sbin/cmd%u -a *\n",
+	    i, i, i);
+	fprintf(fp, "Defaults:USERS%u !requiretty, timestamp_timeout=%u\n",
+	    i, i % 60);
+	fprintf(fp, "USERS%u HOSTS%u = (root) NOPASSWD: CMNDS%u, "
+	    "(ALL : wheel) /bin/ls /home/user%u/*\n", i, i, i, i);
+	fprintf(fp, "user%u ALL = (ALL) CWD=/tmp !/usr/bin/su, "
+	    "/usr/bin/sudoedit /etc/app%u.conf\n", i, i);
+    }
+    if (fclose(fp) != 0) {
+	sudo_warn("%s", path);
+	return false;
+    }
+    return true;
+}
+
+static double
+elapsed_ms(const struct timespec *start, const struct timespec *end)
+{
+    struct timespec diff;
+
+    sudo_timespecsub(end, start, &diff);
+    return (double)diff.tv_sec * 1000.0 + (double)diff.tv_nsec / 1000000.0;
+}
+
+/*
+ * Compare parsing a generated sudoers file with loading it from a cache.
+ */
+static int
+benchmark(unsigned int nlines, unsigned int iterations)
+{
+    struct sudoers_parse_tree parse_tree;
+    struct timespec start, end;
+    char path[PATH_MAX], cache_path[PATH_MAX];
+    double parse_ms = 0.0, cache_ms = 0.0;
+    unsigned int i;
+    int ret = EXIT_FAILURE;
+
+    (void)snprintf(path, sizeof(path), "%s/bench.sudoers", scratch_dir);
+    (void)snprintf(cache_path, sizeof(cache_path), "%s.cache", path);
+    if (!generate_sudoers(path, nlines))
+	return EXIT_FAILURE;
+
+    for (i = 0; i < iterations; i++) {
+	init_parse_tree(&parse_tree, NULL, NULL, &test_ctx, NULL);
+	sudo_gettime_mono(&start);
+	if (!parse_file(path, &parse_tree)) {
+	    sudo_warnx("%s: parse error", path);
+	    goto done;
+	}
+	sudo_gettime_mono(&end);
+	parse_ms += elapsed_ms(&start, &end);
+	if (i == 0 && !sudoers_cache_write(&test_ctx, cache_path, &parse_tree)) {
+	    sudo_warnx("%s: unable to write cache", cache_path);
+	    free_parse_tree(&parse_tree);
+	    goto done;
+	}
+	free_parse_tree(&parse_tree);
+    }
+    sudoers_cache_track(false);
+
+    for (i = 0; i < iterations; i++) {
+	init_parse_tree(&parse_tree, NULL, NULL, &test_ctx, NULL);
+	sudo_gettime_mono(&start);
+	if (!sudoers_cache_read(&test_ctx, cache_path, &parse_tree)) {
+	    sudo_warnx("%s: unable to read cache", cache_path);
+	    goto done;
+	}
+	sudo_gettime_mono(&end);
+	cache_ms += elapsed_ms(&start, &end);
+	free_parse_tree(&parse_tree);
+    }
+
+    printf("%u lines, %u iterations: parse %.3f ms, cache %.3f ms (%.1fx)\n",
+	nlines, iterations, parse_ms / iterations, cache_ms / iterations,
+	cache_ms > 0.0 ? parse_ms / cache_ms : 0.0);
+    ret = EXIT_SUCCESS;
+
+done:
+    sudoers_cache_track(false);
+    unlink(cache_path);
+    unlink(path);
+    return ret;
+}
+
+sudo_noreturn static void
+usage(void)
+{
+    fprintf(stderr, "usage: %s [-v] [-b lines] scratch_dir [file ...]\n",
+	getprogname());
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ch, ntests = 0, errors = 0;
+    unsigned int nlines = 0;
+    const char *errstr;
+
+    initprogname(argc > 0 ? argv[0] : "check_sudoers_cache");
+
+    while ((ch = getopt(argc, argv, "b:v")) != -1) {
+	switch (ch) {
+	case 'b':
+	    nlines = (unsigned int)sudo_strtonum(optarg, 1, INT_MAX, &errstr);
+	    if (errstr != NULL) {
+		sudo_warnx("%s: %s", optarg, errstr);
+		usage();
+	    }
+	    break;
+	case 'v':
+	    verbose = 1;
+	    break;
+	default:
+	    usage();
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc < 1)
+	usage();
+    scratch_dir = argv[0];
+    argc--;
+    argv++;
+
+    /* Source files are owned by the invoking user. */
+    test_ctx.parser_conf.ignore_perms = true;
+    test_ctx.parser_conf.verbose = verbose;
+    test_ctx.user.shost = test_ctx.user.host = (char *)"localhost";
+
+    if (nlines != 0)
+	return benchmark(nlines, 10);
+
+    while (argc--)
+	test_cache(*argv++, &ntests, &errors);
+    test_skipped(&ntests, &errors);
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+
+    return errors;
+}
@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# Verify that indexed and unindexed lookups produce the same result.
+# The lookup times vary from run to run so they are not displayed.
+#
+
+: ${TESTSUDOERS=testsudoers}
+
+exec 2>&1
+
+cat >"regress/testsudoers/test34.inc" <<'EOF'
+User_Alias ADMINS = admin, %wheel
+Host_Alias SERVERS = server1, server2.example.com
+Cmnd_Alias LS = /bin/ls, /usr/bin/ls
+daemon ALL = ALL
+%staff SERVERS = /usr/bin/id
+ADMINS ALL = LS
+ALL, !admin ALL = /bin/cat
+root localhost = !/bin/ls
+bin, operator ALL = /bin/ls
+EOF
+
+for args in "-h server1 root /bin/ls" "-h localhost root /bin/ls" \
+	"-h server2.example.com root /usr/bin/id" \
+	"-h server2.example.com admin /usr/bin/id" "-h server1 admin /bin/cat" \
+	"-h server1 daemon /bin/cat"; do
+    echo "Testing $args"
+    $TESTSUDOERS -b 10 -p ${TESTDIR}/passwd -P ${TESTDIR}/group $args \
+	< regress/testsudoers/test34.inc | \
+	sed -e 's/: *[0-9][0-9.]* seconds$/: N seconds/'
+    echo ""
+done
+
+rm -f regress/testsudoers/test34.inc
+exit 0
@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Verify that aliases used by more than one rule match the same way
+# each time when alias match results are reused within a lookup.
+#
+
+: ${TESTSUDOERS=testsudoers}
+
+exec 2>&1
+
+cat >"regress/testsudoers/test35.inc" <<'EOF'
+User_Alias OPS = operator, %wheel
+User_Alias STAFF = OPS, admin, !root
+Runas_Alias DB = daemon, OPS
+Host_Alias SERVERS = server1, server2
+Host_Alias ALLSERVERS = SERVERS, localhost
+STAFF ALLSERVERS = (DB) /bin/ls
+OPS SERVERS = (DB) /usr/bin/id
+STAFF, root !SERVERS = /bin/cat
+EOF
+
+for args in "-h server1 -u daemon operator /bin/ls" \
+	"-h server1 -u operator admin /usr/bin/id" \
+	"-h localhost root /bin/cat" "-h server2 root /bin/cat" \
+	"-h server2 -u root admin /bin/ls"; do
+    echo "Testing $args"
+    $TESTSUDOERS -p ${TESTDIR}/passwd -P ${TESTDIR}/group $args \
+	< regress/testsudoers/test35.inc
+    echo ""
+done
+
+rm -f regress/testsudoers/test35.inc
+exit 0
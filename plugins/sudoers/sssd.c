@@ -670,8 +670,10 @@ sudo_sss_query(struct sudoers_context *ctx, const struct sudo_nss *nss,
 	handle->pw = NULL;
     }
 
-    /* Free old userspecs, if any. */
+    /* Free old userspecs and the index built from them, if any. */
     free_userspecs(&handle->parse_tree.userspecs);
+    sudoers_index_free(handle->parse_tree.index);
+    handle->parse_tree.index = NULL;
 
     /* Fetch list of sudoRole entries that match user and host. */
     sss_result = sudo_sss_result_get(nss, pw);
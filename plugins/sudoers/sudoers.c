@@ -58,6 +58,7 @@
 
 #include <sudoers.h>
 #include <timestamp.h>
+#include <policyd.h>
 #include <sudo_iolog.h>
 
 /*
@@ -78,6 +79,8 @@ static struct sudo_nss_list *snl;
 static bool unknown_runas_uid;
 static bool unknown_runas_gid;
 static int cmnd_status = NOT_FOUND_ERROR;
+static bool use_policyd;
+static struct policyd_check_result *policyd_result;
 static struct defaults_list initial_defaults = TAILQ_HEAD_INITIALIZER(initial_defaults);
 
 #ifdef __linux__
@@ -130,6 +133,100 @@ restore_nproc(void)
 #endif /* __linux__ */
 }
 
+/*
+ * Open and parse the sudoers sources, setting global defaults.
+ * Sources that cannot be opened or parsed are removed from snl.
+ * The caller is responsible for setting the permissions and locale.
+ * Returns the number of sources that were successfully parsed.
+ */
+static int
+sudoers_open_sources(struct sudoers_context *ctx)
+{
+    struct sudo_nss *nss, *nss_next;
+    int sources = 0;
+    debug_decl(sudoers_open_sources, SUDOERS_DEBUG_PLUGIN);
+
+    TAILQ_FOREACH_SAFE(nss, snl, entries, nss_next) {
+	if (nss->open(ctx, nss) == -1 || (nss->parse_tree = nss->parse(ctx, nss)) == NULL) {
+	    TAILQ_REMOVE(snl, nss, entries);
+	    continue;
+	}
+	sources++;
+
+	/* Missing/invalid defaults is not a fatal error. */
+	if (nss->getdefs(ctx, nss) == -1) {
+	    log_warningx(ctx, SLOG_PARSE_ERROR|SLOG_NO_STDERR,
+		N_("unable to get defaults from %s"), nss->source);
+	} else {
+	    (void)update_defaults(ctx, nss->parse_tree, NULL,
+		SETDEF_GENERIC|SETDEF_HOST|SETDEF_USER|SETDEF_RUNAS, false);
+	}
+    }
+
+    debug_return_int(sources);
+}
+
+/*
+ * The policy daemon is only used to run a command when sudoers is
+ * stored in a local file.  Other sudoers sources and modes, such as
+ * sudoedit or listing privileges, are always handled locally.
+ */
+static bool
+sudoers_policyd_usable(const struct sudoers_context *ctx)
+{
+    const struct sudo_nss *nss = TAILQ_FIRST(snl);
+    debug_decl(sudoers_policyd_usable, SUDOERS_DEBUG_PLUGIN);
+
+    if (ctx->settings.policyd_socket == NULL)
+	debug_return_bool(false);
+    if (ISSET(ctx->mode, MODE_EDIT))
+	debug_return_bool(false);
+    if (nss == NULL || nss != TAILQ_LAST(snl, sudo_nss_list) ||
+	    strcmp(nss->source, "sudoers") != 0)
+	debug_return_bool(false);
+    debug_return_bool(true);
+}
+
+/*
+ * Stop using the policy daemon and parse the sudoers sources instead.
+ * Any Defaults settings received from the daemon are discarded.
+ * Returns true on success, else false.
+ */
+static bool
+sudoers_policyd_fallback(struct sudoers_context *ctx)
+{
+    int oldlocale, sources;
+    debug_decl(sudoers_policyd_fallback, SUDOERS_DEBUG_PLUGIN);
+
+    sudo_debug_printf(SUDO_DEBUG_INFO,
+	"policy daemon unavailable, parsing sudoers directly");
+    use_policyd = false;
+    sudoers_policyd_free(policyd_result);
+    policyd_result = NULL;
+
+    if (!init_defaults()) {
+	sudo_warnx("%s", U_("unable to initialize sudoers default values"));
+	debug_return_bool(false);
+    }
+    if (!update_defaults(ctx, NULL, &initial_defaults,
+	    SETDEF_GENERIC|SETDEF_HOST|SETDEF_USER|SETDEF_RUNAS, false))
+	debug_return_bool(false);
+
+    if (!set_perms(NULL, PERM_ROOT))
+	debug_return_bool(false);
+    sudoers_setlocale(SUDOERS_LOCALE_SUDOERS, &oldlocale);
+    sources = sudoers_open_sources(ctx);
+    sudoers_setlocale(oldlocale, NULL);
+    if (!restore_perms() || sources == 0)
+	debug_return_bool(false);
+
+    /* The -P option is applied before the command-specific Defaults. */
+    if (ISSET(ctx->mode, MODE_PRESERVE_GROUPS))
+	def_preserve_groups = true;
+
+    debug_return_bool(true);
+}
+
 /*
  * Re-initialize Defaults settings.
  * We do not warn, log or send mail for errors when reinitializing,
@@ -155,11 +252,20 @@ sudoers_reinit_defaults(struct sudoers_context *ctx)
     /* Disable error logging while re-processing defaults. */
     sudoers_error_hook = NULL;
 
-    TAILQ_FOREACH_SAFE(nss, snl, entries, nss_next) {
-	/* Missing/invalid defaults is not a fatal error. */
-	if (nss->getdefs(ctx, nss) != -1) {
-	    (void)update_defaults(ctx, nss->parse_tree, NULL,
-		SETDEF_GENERIC|SETDEF_HOST|SETDEF_USER|SETDEF_RUNAS, true);
+    if (use_policyd) {
+	if (!sudoers_policyd_defaults(ctx, ctx->settings.policyd_socket)) {
+	    if (!sudoers_policyd_fallback(ctx)) {
+		sudoers_error_hook = logger;
+		debug_return_bool(false);
+	    }
+	}
+    } else {
+	TAILQ_FOREACH_SAFE(nss, snl, entries, nss_next) {
+	    /* Missing/invalid defaults is not a fatal error. */
+	    if (nss->getdefs(ctx, nss) != -1) {
+		(void)update_defaults(ctx, nss->parse_tree, NULL,
+		    SETDEF_GENERIC|SETDEF_HOST|SETDEF_USER|SETDEF_RUNAS, true);
+	    }
 	}
     }
 
@@ -184,7 +290,6 @@ static bool sudoers_initialized;
 int
 sudoers_init(void *info, sudoers_logger_t logger, char * const envp[])
 {
-    struct sudo_nss *nss, *nss_next;
     int oldlocale, sources = 0;
     static int ret;
     debug_decl(sudoers_init, SUDOERS_DEBUG_PLUGIN);
@@ -239,23 +344,29 @@ sudoers_init(void *info, sudoers_logger_t logger, char * const envp[])
 	goto cleanup;
     }
 
-    /* Open and parse sudoers, set global defaults.  */
-    TAILQ_FOREACH_SAFE(nss, snl, entries, nss_next) {
-	if (nss->open(&sudoers_ctx, nss) == -1 || (nss->parse_tree = nss->parse(&sudoers_ctx, nss)) == NULL) {
-	    TAILQ_REMOVE(snl, nss, entries);
-	    continue;
-	}
-	sources++;
-
-	/* Missing/invalid defaults is not a fatal error. */
-	if (nss->getdefs(&sudoers_ctx, nss) == -1) {
-	    log_warningx(&sudoers_ctx, SLOG_PARSE_ERROR|SLOG_NO_STDERR,
-		N_("unable to get defaults from %s"), nss->source);
+    /* Get global defaults from the policy daemon if possible. */
+    if (sudoers_policyd_usable(&sudoers_ctx)) {
+	use_policyd = sudoers_policyd_defaults(&sudoers_ctx,
+	    sudoers_ctx.settings.policyd_socket);
+	if (use_policyd) {
+	    sources = 1;
 	} else {
-	    (void)update_defaults(&sudoers_ctx, nss->parse_tree, NULL,
-		SETDEF_GENERIC|SETDEF_HOST|SETDEF_USER|SETDEF_RUNAS, false);
+	    /* Discard any settings that were partially applied. */
+	    if (!init_defaults()) {
+		sudo_warnx("%s",
+		    U_("unable to initialize sudoers default values"));
+		goto cleanup;
+	    }
+	    if (!update_defaults(&sudoers_ctx, NULL, &initial_defaults,
+		    SETDEF_GENERIC|SETDEF_HOST|SETDEF_USER|SETDEF_RUNAS, false)) {
+		goto cleanup;
+	    }
 	}
     }
+
+    /* Open and parse sudoers, set global defaults.  */
+    if (!use_policyd)
+	sources = sudoers_open_sources(&sudoers_ctx);
     if (sources == 0) {
 	/* Display an extra warning if there are multiple sudoers sources. */
 	if (TAILQ_FIRST(snl) != TAILQ_LAST(snl, sudo_nss_list))
@@ -399,8 +510,15 @@ sudoers_check_common(struct sudoers_context *ctx, int pwflag)
      */
     time(&now);
     sudoers_setlocale(SUDOERS_LOCALE_SUDOERS, &oldlocale);
-    validated = sudoers_lookup(snl, ctx, now, cb_lookup, &match_info,
-	&cmnd_status, pwflag);
+    if (policyd_result != NULL && !pwflag) {
+	/* The lookup was performed by the policy daemon. */
+	validated = sudoers_policyd_lookup(ctx, policyd_result, &cmnd_status);
+	sudoers_policyd_free(policyd_result);
+	policyd_result = NULL;
+    } else {
+	validated = sudoers_lookup(snl, ctx, now, cb_lookup, &match_info,
+	    &cmnd_status, pwflag);
+    }
     sudoers_setlocale(oldlocale, NULL);
     if (ISSET(validated, VALIDATE_ERROR)) {
 	/* The lookup function should have printed an error. */
@@ -1265,9 +1383,31 @@ set_cmnd(struct sudoers_context *ctx)
 	ctx->user.cmnd_base = ctx->user.cmnd = new_cmnd;
     }
 
+    if (use_policyd) {
+	/* The policy daemon only checks commands to be run. */
+	sudoers_policyd_free(policyd_result);
+	policyd_result = NULL;
+	if (ISSET(ctx->mode, MODE_RUN) && !ISSET(ctx->mode,
+		MODE_EDIT|MODE_CHECK|MODE_LIST|MODE_VALIDATE)) {
+	    policyd_result = sudoers_policyd_check(ctx,
+		ctx->settings.policyd_socket, ret);
+	    if (policyd_result != NULL)
+		debug_return_int(ret);
+	}
+	if (!sudoers_policyd_fallback(ctx))
+	    debug_return_int(NOT_FOUND_ERROR);
+    }
+
     TAILQ_FOREACH(nss, snl, entries) {
 	/* Missing/invalid defaults is not a fatal error. */
 	(void)update_defaults(ctx, nss->parse_tree, NULL, SETDEF_CMND, false);
+
+	/*
+	 * A cached intercept decision would skip the command-specific
+	 * Defaults of later commands, such as their logging settings.
+	 */
+	if (has_cmnd_defaults(nss->parse_tree))
+	    def_intercept_cache_timeout = 0;
     }
 
     debug_return_int(ret);
@@ -1564,11 +1704,15 @@ sudoers_cleanup(void)
     }
     sudoers_initialized = false;
     need_reinit = false;
+    use_policyd = false;
+    sudoers_policyd_free(policyd_result);
+    policyd_result = NULL;
     if (def_group_plugin)
 	group_plugin_unload();
     sudoers_ctx_free(&sudoers_ctx);
     sudo_freepwcache();
     sudo_freegrcache();
+    sudo_pwutil_shared_close();
     canon_path_free_cache();
 
     /* We must free the cached environment before running g/c. */
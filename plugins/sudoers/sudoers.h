@@ -80,6 +80,7 @@ struct group_list {
  */
 struct sudoers_parser_config {
     const char *sudoers_path;
+    const char *sudoers_cache;
     int strict;
     int verbose;
     bool recovery;
@@ -90,6 +91,7 @@ struct sudoers_parser_config {
 };
 #define SUDOERS_PARSER_CONFIG_INITIALIZER {				\
     .sudoers_path = NULL,						\
+    .sudoers_cache = NULL,						\
     .strict = false,							\
     .verbose = 1,							\
     .recovery = true,							\
@@ -106,6 +108,7 @@ struct sudoers_plugin_settings {
     const char *plugin_dir;
     const char *ldap_conf;
     const char *ldap_secret;
+    const char *policyd_socket;
     unsigned int flags;
 };
 #define SUDOERS_PLUGIN_SETTINGS_INITIALIZER {				\
@@ -396,6 +399,11 @@ void sudo_pwutil_set_backend(sudo_make_pwitem_t, sudo_make_gritem_t, sudo_make_g
 void sudo_setspent(void);
 bool user_shell_valid(const struct passwd *pw);
 
+/* pwutil_shared.c */
+bool sudo_pwutil_shared_open(const char *path, unsigned int ttl);
+void sudo_pwutil_shared_close(void);
+void sudo_pwutil_shared_stats(unsigned int *hits, unsigned int *misses);
+
 /* timestr.c */
 char *get_timestr(time_t, int);
 
@@ -412,6 +420,13 @@ bool cb_iolog_mode(struct sudoers_context *ctx, const char *file, int line, int
 struct iolog_path_escape;
 extern const struct iolog_path_escape *sudoers_iolog_path_escapes;
 
+/* iolog_writer.c */
+struct iolog_file;
+bool iolog_writer_open(int dfd, struct iolog_file *iolog_files, unsigned int flush_delay, int *iofd);
+bool iolog_writer_active(void);
+bool iolog_writer_write(int iofd, const struct timespec *delay, const char *buf, unsigned int len, const char *tbuf, unsigned int tlen, const char **errstr);
+bool iolog_writer_close(const char **errstr);
+
 /* env.c */
 char **env_get(void);
 bool env_merge(const struct sudoers_context *ctx, char * const envp[]);
@@ -0,0 +1,1476 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Binary cache of a parsed sudoers policy.
+ *
+ * The cache file starts with a fixed header followed by the list of
+ * files and include directories that were read by the parser, a table
+ * of file names and the serialized parse tree.  A cache is only used
+ * if every source still has the same device, inode, owner, mode, size,
+ * modification and change times as when the cache was written and the
+ * contents of each file match the stored digest.  Otherwise, the caller
+ * falls back to parsing the sudoers file as usual.
+ */
+
+#include <config.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <sudoers.h>
+#include <sudoers_version.h>
+#include <sudo_digest.h>
+#include <redblack.h>
+#include <gram.h>
+
+#define SUDOERS_CACHE_MAGIC	"SUDOCACH"
+#define SUDOERS_CACHE_VERSION	1
+#define SUDOERS_CACHE_BYTEORDER	0x01020304U
+#define SUDOERS_CACHE_DIGEST	SUDO_DIGEST_SHA256
+
+/* Types of sources the cache depends on. */
+#define CACHE_SOURCE_FILE	0x01U
+#define CACHE_SOURCE_DIR	0x02U
+#define CACHE_SOURCE_SKIPPED	0x04U
+
+/* Defaults binding: none, shared with the previous entry or a new one. */
+#define CACHE_BINDING_NONE	0x00U
+#define CACHE_BINDING_PREV	0x01U
+#define CACHE_BINDING_NEW	0x02U
+
+/* Member name is a plain string or a struct sudo_command. */
+#define CACHE_MEMBER_STR	0x00U
+#define CACHE_MEMBER_CMND	0x01U
+
+/* Cmndspec fields that are shared with the previous cmndspec. */
+#define CACHE_SHARE_RUNASUSER	0x0001U
+#define CACHE_SHARE_RUNASGROUP	0x0002U
+#define CACHE_SHARE_RUNCWD	0x0004U
+#define CACHE_SHARE_RUNCHROOT	0x0008U
+#define CACHE_SHARE_ROLE	0x0010U
+#define CACHE_SHARE_TYPE	0x0020U
+#define CACHE_SHARE_APPARMOR	0x0040U
+#define CACHE_SHARE_PRIVS	0x0080U
+#define CACHE_SHARE_LIMITPRIVS	0x0100U
+
+/* Strings are stored as a 32-bit length followed by the bytes. */
+#define CACHE_NULL_STR		UINT32_MAX
+
+struct sudoers_cache_header {
+    char magic[8];		/* SUDOERS_CACHE_MAGIC */
+    uint32_t version;		/* SUDOERS_CACHE_VERSION */
+    uint32_t grammar_version;	/* SUDOERS_GRAMMAR_VERSION */
+    uint32_t byteorder;		/* SUDOERS_CACHE_BYTEORDER */
+    uint32_t hdrsize;		/* sizeof(struct sudoers_cache_header) */
+    uint64_t size;		/* size of the data following the header */
+};
+
+/*
+ * A file or directory read (or skipped) by the parser.
+ */
+struct cache_source {
+    TAILQ_ENTRY(cache_source) entries;
+    char *path;
+    unsigned char *digest;
+    size_t digest_len;
+    unsigned int type;
+    struct stat sb;
+};
+TAILQ_HEAD(cache_source_list, cache_source);
+
+/*
+ * Growable output buffer, errors are sticky.
+ */
+struct cache_buf {
+    unsigned char *buf;
+    size_t len;
+    size_t size;
+    bool error;
+};
+
+/*
+ * Table of file names used by userspecs, defaults and aliases.
+ */
+struct cache_files {
+    const char **names;
+    uint32_t count;
+    uint32_t size;
+    uint32_t last;
+};
+
+/*
+ * Input state when decoding a cache file, errors are sticky.
+ */
+struct cache_reader {
+    const unsigned char *cur;
+    const unsigned char *end;
+    char **files;
+    uint32_t nfiles;
+    bool error;
+};
+
+static struct cache_source_list cache_sources =
+    TAILQ_HEAD_INITIALIZER(cache_sources);
+static bool cache_tracking;
+
+/*
+ * Compute the digest of the file open on fd without changing
+ * the file offset.  Returns the digest on success, else NULL.
+ */
+static unsigned char *
+cache_digest_fd(int fd, const char *path, size_t *digest_lenp)
+{
+    struct sudo_digest *dig;
+    unsigned char buf[32 * 1024];
+    unsigned char *digest = NULL;
+    size_t digest_len;
+    off_t off = 0;
+    ssize_t nread;
+    debug_decl(cache_digest_fd, SUDOERS_DEBUG_PARSER);
+
+    digest_len = sudo_digest_getlen(SUDOERS_CACHE_DIGEST);
+    if ((dig = sudo_digest_alloc(SUDOERS_CACHE_DIGEST)) == NULL)
+	goto oom;
+    if ((digest = malloc(digest_len)) == NULL)
+	goto oom;
+    for (;;) {
+	nread = pread(fd, buf, sizeof(buf), off);
+	if (nread == -1) {
+	    if (errno == EINTR)
+		continue;
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"unable to read %s", path);
+	    goto bad;
+	}
+	if (nread == 0)
+	    break;
+	sudo_digest_update(dig, buf, (size_t)nread);
+	off += nread;
+    }
+    sudo_digest_final(dig, digest);
+    sudo_digest_free(dig);
+
+    *digest_lenp = digest_len;
+    debug_return_ptr(digest);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+bad:
+    sudo_digest_free(dig);
+    free(digest);
+    debug_return_ptr(NULL);
+}
+
+static void
+cache_source_free(struct cache_source *src)
+{
+    debug_decl(cache_source_free, SUDOERS_DEBUG_PARSER);
+
+    free(src->path);
+    free(src->digest);
+    free(src);
+
+    debug_return;
+}
+
+/*
+ * Enable or disable tracking of the files and directories read by
+ * the parser.  Any previously tracked sources are discarded.
+ */
+void
+sudoers_cache_track(bool enable)
+{
+    struct cache_source *src;
+    debug_decl(sudoers_cache_track, SUDOERS_DEBUG_PARSER);
+
+    while ((src = TAILQ_FIRST(&cache_sources)) != NULL) {
+	TAILQ_REMOVE(&cache_sources, src, entries);
+	cache_source_free(src);
+    }
+    cache_tracking = enable;
+
+    debug_return;
+}
+
+/*
+ * Record a file or directory read by the parser.
+ * This is a no-op unless tracking has been enabled.
+ * Returns true on success, else false.
+ */
+bool
+sudoers_cache_add_source(const char *path, int fd)
+{
+    struct cache_source *src;
+    debug_decl(sudoers_cache_add_source, SUDOERS_DEBUG_PARSER);
+
+    if (!cache_tracking)
+	debug_return_bool(true);
+
+    if ((src = calloc(1, sizeof(*src))) == NULL)
+	goto oom;
+    if ((src->path = strdup(path)) == NULL)
+	goto oom;
+    if (fstat(fd, &src->sb) == -1) {
+	sudo_warn("%s", path);
+	goto bad;
+    }
+    if (S_ISDIR(src->sb.st_mode)) {
+	src->type = CACHE_SOURCE_DIR;
+    } else {
+	src->type = CACHE_SOURCE_FILE;
+	src->digest = cache_digest_fd(fd, path, &src->digest_len);
+	if (src->digest == NULL)
+	    goto bad;
+    }
+    TAILQ_INSERT_TAIL(&cache_sources, src, entries);
+
+    debug_return_bool(true);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+bad:
+    if (src != NULL)
+	cache_source_free(src);
+    /* The cache cannot be trusted if a source is missing. */
+    sudoers_cache_track(false);
+    debug_return_bool(false);
+}
+
+/*
+ * Record an include dir entry that the parser skipped, e.g. due to
+ * its ownership or mode.  Fixing the file's permissions does not
+ * change the directory's mtime so the file itself must be tracked.
+ * This is a no-op unless tracking has been enabled.
+ * Returns true on success, else false.
+ */
+bool
+sudoers_cache_add_skipped(const char *path)
+{
+    struct cache_source *src;
+    debug_decl(sudoers_cache_add_skipped, SUDOERS_DEBUG_PARSER);
+
+    if (!cache_tracking)
+	debug_return_bool(true);
+
+    if ((src = calloc(1, sizeof(*src))) == NULL)
+	goto oom;
+    if ((src->path = strdup(path)) == NULL)
+	goto oom;
+    if (stat(path, &src->sb) == -1) {
+	/* Cannot detect when a dangling symlink's target is created. */
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "unable to stat %s", path);
+	goto bad;
+    }
+    src->type = CACHE_SOURCE_SKIPPED;
+    TAILQ_INSERT_TAIL(&cache_sources, src, entries);
+
+    debug_return_bool(true);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+bad:
+    if (src != NULL)
+	cache_source_free(src);
+    sudoers_cache_track(false);
+    debug_return_bool(false);
+}
+
+/*
+ * Check whether any of the tracked sources has been modified or
+ * replaced since it was read, based on its stat(2) information.
+ * Returns true if a source changed or if no sources are tracked.
+ */
+bool
+sudoers_cache_sources_changed(void)
+{
+    struct cache_source *src;
+    struct timespec mtime, cur_mtime;
+    struct stat sb;
+    debug_decl(sudoers_cache_sources_changed, SUDOERS_DEBUG_PARSER);
+
+    if (!cache_tracking || TAILQ_EMPTY(&cache_sources))
+	debug_return_bool(true);
+
+    TAILQ_FOREACH(src, &cache_sources, entries) {
+	if (stat(src->path, &sb) == -1) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+		"unable to stat %s", src->path);
+	    debug_return_bool(true);
+	}
+	mtim_get(&src->sb, mtime);
+	mtim_get(&sb, cur_mtime);
+	if (sb.st_dev != src->sb.st_dev || sb.st_ino != src->sb.st_ino ||
+		sb.st_size != src->sb.st_size || sb.st_mode != src->sb.st_mode ||
+		sb.st_uid != src->sb.st_uid || sb.st_gid != src->sb.st_gid ||
+		sb.st_ctime != src->sb.st_ctime ||
+		sudo_timespeccmp(&mtime, &cur_mtime, !=)) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+		"%s: modified since it was read", src->path);
+	    debug_return_bool(true);
+	}
+    }
+    debug_return_bool(false);
+}
+
+static void
+cache_put(struct cache_buf *cb, const void *data, size_t len)
+{
+    if (cb->error)
+	return;
+
+    if (len > cb->size - cb->len) {
+	size_t newsize = cb->size ? cb->size : 64 * 1024;
+	unsigned char *newbuf;
+
+	while (len > newsize - cb->len) {
+	    if (newsize > SIZE_MAX / 2) {
+		cb->error = true;
+		return;
+	    }
+	    newsize *= 2;
+	}
+	if ((newbuf = realloc(cb->buf, newsize)) == NULL) {
+	    cb->error = true;
+	    return;
+	}
+	cb->buf = newbuf;
+	cb->size = newsize;
+    }
+    memcpy(cb->buf + cb->len, data, len);
+    cb->len += len;
+}
+
+static void
+cache_put_u32(struct cache_buf *cb, uint32_t val)
+{
+    cache_put(cb, &val, sizeof(val));
+}
+
+static void
+cache_put_int(struct cache_buf *cb, int val)
+{
+    const int32_t v32 = (int32_t)val;
+    cache_put(cb, &v32, sizeof(v32));
+}
+
+static void
+cache_put_i64(struct cache_buf *cb, int64_t val)
+{
+    cache_put(cb, &val, sizeof(val));
+}
+
+static void
+cache_put_str(struct cache_buf *cb, const char *str)
+{
+    size_t len;
+
+    if (str == NULL) {
+	cache_put_u32(cb, CACHE_NULL_STR);
+	return;
+    }
+    len = strlen(str);
+    if (len >= CACHE_NULL_STR) {
+	cb->error = true;
+	return;
+    }
+    cache_put_u32(cb, (uint32_t)len);
+    cache_put(cb, str, len);
+}
+
+/*
+ * Store the index of file in the file table, adding it if needed.
+ * File names are reference-counted strings so we check the pointer
+ * first, most consecutive entries come from the same file.
+ */
+static void
+cache_put_file(struct cache_buf *cb, struct cache_files *cf, const char *file)
+{
+    uint32_t i;
+
+    if (file == NULL) {
+	cache_put_u32(cb, CACHE_NULL_STR);
+	return;
+    }
+    if (cf->count != 0 && cf->names[cf->last] == file) {
+	cache_put_u32(cb, cf->last);
+	return;
+    }
+    for (i = 0; i < cf->count; i++) {
+	if (strcmp(cf->names[i], file) == 0)
+	    break;
+    }
+    if (i == cf->count) {
+	if (cf->count == cf->size) {
+	    const char **names;
+	    const uint32_t newsize = cf->size ? cf->size * 2 : 16;
+
+	    names = reallocarray(cf->names, newsize, sizeof(*names));
+	    if (names == NULL) {
+		cb->error = true;
+		return;
+	    }
+	    cf->names = names;
+	    cf->size = newsize;
+	}
+	cf->names[cf->count++] = file;
+    }
+    cf->last = i;
+    cache_put_u32(cb, i);
+}
+
+static void
+cache_put_member(struct cache_buf *cb, const struct member *m)
+{
+    cache_put_int(cb, m->type);
+    cache_put_int(cb, m->negated);
+    if (m->type == COMMAND || (m->type == ALL && m->name != NULL)) {
+	const struct sudo_command *c = (struct sudo_command *)m->name;
+	const struct command_digest *digest;
+	uint32_t ndigests = 0;
+
+	cache_put_u32(cb, CACHE_MEMBER_CMND);
+	cache_put_str(cb, c->cmnd);
+	cache_put_str(cb, c->args);
+	TAILQ_FOREACH(digest, &c->digests, entries)
+	    ndigests++;
+	cache_put_u32(cb, ndigests);
+	TAILQ_FOREACH(digest, &c->digests, entries) {
+	    cache_put_u32(cb, digest->digest_type);
+	    cache_put_str(cb, digest->digest_str);
+	}
+    } else {
+	cache_put_u32(cb, CACHE_MEMBER_STR);
+	cache_put_str(cb, m->name);
+    }
+}
+
+static void
+cache_put_members(struct cache_buf *cb, const struct member_list *members)
+{
+    const struct member *m;
+    uint32_t count = 0;
+
+    TAILQ_FOREACH(m, members, entries)
+	count++;
+    cache_put_u32(cb, count);
+    TAILQ_FOREACH(m, members, entries)
+	cache_put_member(cb, m);
+}
+
+static void
+cache_put_defaults(struct cache_buf *cb, struct cache_files *cf,
+    const struct defaults_list *defs)
+{
+    const struct defaults_binding *binding = NULL;
+    const struct defaults *d;
+    uint32_t count = 0;
+
+    TAILQ_FOREACH(d, defs, entries)
+	count++;
+    cache_put_u32(cb, count);
+    TAILQ_FOREACH(d, defs, entries) {
+	cache_put_str(cb, d->var);
+	cache_put_str(cb, d->val);
+	cache_put_int(cb, d->type);
+	cache_put_int(cb, d->op);
+	cache_put_int(cb, d->line);
+	cache_put_int(cb, d->column);
+	cache_put_file(cb, cf, d->file);
+	if (d->binding == NULL) {
+	    cache_put_u32(cb, CACHE_BINDING_NONE);
+	} else if (d->binding == binding) {
+	    cache_put_u32(cb, CACHE_BINDING_PREV);
+	} else {
+	    cache_put_u32(cb, CACHE_BINDING_NEW);
+	    cache_put_members(cb, &d->binding->members);
+	}
+	binding = d->binding;
+    }
+}
+
+/*
+ * Cmndspecs may share pointers with the previous entry, see
+ * propagate_cmndspec() in gram.y.  We preserve this in the cache
+ * so free_cmndspecs() works as expected on a loaded parse tree.
+ */
+static void
+cache_put_cmndspec(struct cache_buf *cb, const struct cmndspec *cs,
+    const struct cmndspec *prev)
+{
+    uint32_t shared = 0;
+
+#define CACHE_SHARED(_f, _flag) do {					\
+    if (prev != NULL && cs->_f != NULL && cs->_f == prev->_f)		\
+	shared |= (_flag);						\
+} while (0)
+
+    CACHE_SHARED(runasuserlist, CACHE_SHARE_RUNASUSER);
+    CACHE_SHARED(runasgrouplist, CACHE_SHARE_RUNASGROUP);
+    CACHE_SHARED(runcwd, CACHE_SHARE_RUNCWD);
+    CACHE_SHARED(runchroot, CACHE_SHARE_RUNCHROOT);
+    CACHE_SHARED(role, CACHE_SHARE_ROLE);
+    CACHE_SHARED(type, CACHE_SHARE_TYPE);
+    CACHE_SHARED(apparmor_profile, CACHE_SHARE_APPARMOR);
+    CACHE_SHARED(privs, CACHE_SHARE_PRIVS);
+    CACHE_SHARED(limitprivs, CACHE_SHARE_LIMITPRIVS);
+#undef CACHE_SHARED
+
+    cache_put_member(cb, cs->cmnd);
+    cache_put_u32(cb, shared);
+    if (!ISSET(shared, CACHE_SHARE_RUNASUSER)) {
+	cache_put_u32(cb, cs->runasuserlist != NULL);
+	if (cs->runasuserlist != NULL)
+	    cache_put_members(cb, cs->runasuserlist);
+    }
+    if (!ISSET(shared, CACHE_SHARE_RUNASGROUP)) {
+	cache_put_u32(cb, cs->runasgrouplist != NULL);
+	if (cs->runasgrouplist != NULL)
+	    cache_put_members(cb, cs->runasgrouplist);
+    }
+    if (!ISSET(shared, CACHE_SHARE_RUNCWD))
+	cache_put_str(cb, cs->runcwd);
+    if (!ISSET(shared, CACHE_SHARE_RUNCHROOT))
+	cache_put_str(cb, cs->runchroot);
+    if (!ISSET(shared, CACHE_SHARE_ROLE))
+	cache_put_str(cb, cs->role);
+    if (!ISSET(shared, CACHE_SHARE_TYPE))
+	cache_put_str(cb, cs->type);
+    if (!ISSET(shared, CACHE_SHARE_APPARMOR))
+	cache_put_str(cb, cs->apparmor_profile);
+    if (!ISSET(shared, CACHE_SHARE_PRIVS))
+	cache_put_str(cb, cs->privs);
+    if (!ISSET(shared, CACHE_SHARE_LIMITPRIVS))
+	cache_put_str(cb, cs->limitprivs);
+    cache_put_int(cb, cs->tags.follow);
+    cache_put_int(cb, cs->tags.intercept);
+    cache_put_int(cb, cs->tags.log_input);
+    cache_put_int(cb, cs->tags.log_output);
+    cache_put_int(cb, cs->tags.noexec);
+    cache_put_int(cb, cs->tags.nopasswd);
+    cache_put_int(cb, cs->tags.send_mail);
+    cache_put_int(cb, cs->tags.setenv);
+    cache_put_int(cb, cs->timeout);
+    cache_put_i64(cb, (int64_t)cs->notbefore);
+    cache_put_i64(cb, (int64_t)cs->notafter);
+}
+
+static void
+cache_put_privilege(struct cache_buf *cb, struct cache_files *cf,
+    const struct privilege *priv)
+{
+    const struct cmndspec *cs, *prev = NULL;
+    uint32_t count = 0;
+
+    cache_put_str(cb, priv->ldap_role);
+    cache_put_members(cb, &priv->hostlist);
+    TAILQ_FOREACH(cs, &priv->cmndlist, entries)
+	count++;
+    cache_put_u32(cb, count);
+    TAILQ_FOREACH(cs, &priv->cmndlist, entries) {
+	cache_put_cmndspec(cb, cs, prev);
+	prev = cs;
+    }
+    cache_put_defaults(cb, cf, &priv->defaults);
+}
+
+static void
+cache_put_userspec(struct cache_buf *cb, struct cache_files *cf,
+    const struct userspec *us)
+{
+    const struct sudoers_comment *comment;
+    const struct privilege *priv;
+    uint32_t count = 0;
+
+    cache_put_members(cb, &us->users);
+    TAILQ_FOREACH(priv, &us->privileges, entries)
+	count++;
+    cache_put_u32(cb, count);
+    TAILQ_FOREACH(priv, &us->privileges, entries)
+	cache_put_privilege(cb, cf, priv);
+    count = 0;
+    STAILQ_FOREACH(comment, &us->comments, entries)
+	count++;
+    cache_put_u32(cb, count);
+    STAILQ_FOREACH(comment, &us->comments, entries)
+	cache_put_str(cb, comment->str);
+    cache_put_int(cb, us->line);
+    cache_put_int(cb, us->column);
+    cache_put_file(cb, cf, us->file);
+}
+
+struct cache_alias_closure {
+    struct cache_buf *cb;
+    struct cache_files *cf;
+    uint32_t count;
+};
+
+static int
+cache_count_alias(struct sudoers_parse_tree *parse_tree, struct alias *a,
+    void *v)
+{
+    struct cache_alias_closure *closure = v;
+
+    closure->count++;
+    return 0;
+}
+
+static int
+cache_put_alias(struct sudoers_parse_tree *parse_tree, struct alias *a,
+    void *v)
+{
+    struct cache_alias_closure *closure = v;
+
+    cache_put_str(closure->cb, a->name);
+    cache_put_int(closure->cb, a->type);
+    cache_put_int(closure->cb, a->line);
+    cache_put_int(closure->cb, a->column);
+    cache_put_file(closure->cb, closure->cf, a->file);
+    cache_put_members(closure->cb, &a->members);
+    return closure->cb->error;
+}
+
+static void
+cache_put_source(struct cache_buf *cb, const struct cache_source *src)
+{
+    cache_put_str(cb, src->path);
+    cache_put_u32(cb, src->type);
+    cache_put_i64(cb, (int64_t)src->sb.st_dev);
+    cache_put_i64(cb, (int64_t)src->sb.st_ino);
+    cache_put_i64(cb, (int64_t)src->sb.st_size);
+    cache_put_u32(cb, (uint32_t)src->sb.st_mode);
+    cache_put_u32(cb, (uint32_t)src->sb.st_uid);
+    cache_put_u32(cb, (uint32_t)src->sb.st_gid);
+    cache_put_i64(cb, (int64_t)src->sb.st_ctime);
+    cache_put_i64(cb, (int64_t)src->sb.st_mtime);
+    cache_put_u32(cb, (uint32_t)src->digest_len);
+    if (src->digest_len != 0)
+	cache_put(cb, src->digest, src->digest_len);
+}
+
+/*
+ * Write parse_tree to a binary cache file at path.
+ * The sources it depends on must have been recorded via
+ * sudoers_cache_add_source() while parsing.
+ * The cache is written to a temporary file which is then
+ * renamed into place.  Returns true on success, else false.
+ */
+bool
+sudoers_cache_write(const struct sudoers_context *ctx, const char *path,
+    const struct sudoers_parse_tree *parse_tree)
+{
+    struct cache_alias_closure closure;
+    struct cache_buf body = { NULL }, hdrbuf = { NULL };
+    struct cache_files cf = { NULL };
+    struct sudoers_cache_header hdr;
+    struct cache_source *src;
+    const struct userspec *us;
+    char *tpath = NULL;
+    uint32_t i, count;
+    bool ret = false;
+    int fd = -1;
+    debug_decl(sudoers_cache_write, SUDOERS_DEBUG_PARSER);
+
+    if (!cache_tracking || TAILQ_EMPTY(&cache_sources)) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: no sources tracked, not writing cache", __func__);
+	debug_return_bool(false);
+    }
+
+    /* Serialize the parse tree, collecting file names as we go. */
+    cache_put_defaults(&body, &cf, &parse_tree->defaults);
+    count = 0;
+    TAILQ_FOREACH(us, &parse_tree->userspecs, entries)
+	count++;
+    cache_put_u32(&body, count);
+    TAILQ_FOREACH(us, &parse_tree->userspecs, entries)
+	cache_put_userspec(&body, &cf, us);
+    closure.cb = &body;
+    closure.cf = &cf;
+    closure.count = 0;
+    alias_apply((struct sudoers_parse_tree *)parse_tree, cache_count_alias,
+	&closure);
+    cache_put_u32(&body, closure.count);
+    alias_apply((struct sudoers_parse_tree *)parse_tree, cache_put_alias,
+	&closure);
+
+    /* Host name used to expand %h in include paths, sources, file names. */
+    cache_put_str(&hdrbuf, ctx->user.shost);
+    count = 0;
+    TAILQ_FOREACH(src, &cache_sources, entries)
+	count++;
+    cache_put_u32(&hdrbuf, count);
+    TAILQ_FOREACH(src, &cache_sources, entries)
+	cache_put_source(&hdrbuf, src);
+    cache_put_u32(&hdrbuf, cf.count);
+    for (i = 0; i < cf.count; i++)
+	cache_put_str(&hdrbuf, cf.names[i]);
+    if (body.error || hdrbuf.error) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	goto done;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SUDOERS_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = SUDOERS_CACHE_VERSION;
+    hdr.grammar_version = SUDOERS_GRAMMAR_VERSION;
+    hdr.byteorder = SUDOERS_CACHE_BYTEORDER;
+    hdr.hdrsize = sizeof(hdr);
+    hdr.size = (uint64_t)hdrbuf.len + (uint64_t)body.len;
+
+    if (asprintf(&tpath, "%s.XXXXXX", path) == -1) {
+	tpath = NULL;
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	goto done;
+    }
+    if ((fd = mkstemp(tpath)) == -1) {
+	sudo_warn(U_("unable to open %s"), tpath);
+	free(tpath);
+	tpath = NULL;
+	goto done;
+    }
+    if (fchown(fd, sudoers_file_uid(), sudoers_file_gid()) == -1 &&
+	    geteuid() == ROOT_UID) {
+	sudo_warn(U_("unable to set (uid, gid) of %s to (%u, %u)"), tpath,
+	    (unsigned int)sudoers_file_uid(), (unsigned int)sudoers_file_gid());
+	goto done;
+    }
+    if (fchmod(fd, sudoers_file_mode()) == -1) {
+	sudo_warn(U_("unable to change mode of %s to 0%o"), tpath,
+	    (unsigned int)sudoers_file_mode());
+	goto done;
+    }
+    if (write(fd, &hdr, sizeof(hdr)) != ssizeof(hdr) ||
+	    write(fd, hdrbuf.buf, hdrbuf.len) != (ssize_t)hdrbuf.len ||
+	    write(fd, body.buf, body.len) != (ssize_t)body.len ||
+	    fsync(fd) == -1) {
+	sudo_warn(U_("unable to write to %s"), tpath);
+	goto done;
+    }
+    if (close(fd) == -1) {
+	fd = -1;
+	sudo_warn(U_("unable to write to %s"), tpath);
+	goto done;
+    }
+    fd = -1;
+    if (rename(tpath, path) == -1) {
+	sudo_warn(U_("unable to rename %s to %s"), tpath, path);
+	goto done;
+    }
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"wrote %s: %u sources, %zu bytes", path, (unsigned int)count,
+	sizeof(hdr) + hdrbuf.len + body.len);
+    ret = true;
+
+done:
+    if (fd != -1)
+	close(fd);
+    if (tpath != NULL) {
+	if (!ret)
+	    unlink(tpath);
+	free(tpath);
+    }
+    free(cf.names);
+    free(hdrbuf.buf);
+    free(body.buf);
+    debug_return_bool(ret);
+}
+
+static bool
+cache_get(struct cache_reader *cr, void *data, size_t len)
+{
+    if (cr->error || len > (size_t)(cr->end - cr->cur)) {
+	cr->error = true;
+	memset(data, 0, len);
+	return false;
+    }
+    memcpy(data, cr->cur, len);
+    cr->cur += len;
+    return true;
+}
+
+static uint32_t
+cache_get_u32(struct cache_reader *cr)
+{
+    uint32_t val;
+
+    cache_get(cr, &val, sizeof(val));
+    return val;
+}
+
+static int
+cache_get_int(struct cache_reader *cr)
+{
+    int32_t val;
+
+    cache_get(cr, &val, sizeof(val));
+    return (int)val;
+}
+
+static int64_t
+cache_get_i64(struct cache_reader *cr)
+{
+    int64_t val;
+
+    cache_get(cr, &val, sizeof(val));
+    return val;
+}
+
+/*
+ * Return a pointer to the next string in the cache without copying it.
+ * A NULL string is not an error, the caller must check cr->error.
+ */
+static const char *
+cache_peek_str(struct cache_reader *cr, size_t *lenp)
+{
+    const char *str;
+    uint32_t len;
+
+    len = cache_get_u32(cr);
+    if (cr->error || len == CACHE_NULL_STR) {
+	*lenp = 0;
+	return NULL;
+    }
+    if (len > (size_t)(cr->end - cr->cur)) {
+	cr->error = true;
+	*lenp = 0;
+	return NULL;
+    }
+    str = (const char *)cr->cur;
+    cr->cur += len;
+    *lenp = len;
+    return str;
+}
+
+/*
+ * Return a copy of the next string in the cache.
+ * A NULL string is not an error, the caller must check cr->error.
+ */
+static char *
+cache_get_str(struct cache_reader *cr)
+{
+    const char *str;
+    char *copy;
+    size_t len;
+
+    str = cache_peek_str(cr, &len);
+    if (str == NULL)
+	return NULL;
+    if ((copy = strndup(str, len)) == NULL)
+	cr->error = true;
+    return copy;
+}
+
+/*
+ * Return a new reference to the next file name in the cache.
+ */
+static char *
+cache_get_file(struct cache_reader *cr)
+{
+    const uint32_t idx = cache_get_u32(cr);
+
+    if (cr->error || idx == CACHE_NULL_STR)
+	return NULL;
+    if (idx >= cr->nfiles) {
+	cr->error = true;
+	return NULL;
+    }
+    return sudo_rcstr_addref(cr->files[idx]);
+}
+
+static struct member *
+cache_get_member(struct cache_reader *cr)
+{
+    struct member *m;
+    bool is_cmnd = false;
+    debug_decl(cache_get_member, SUDOERS_DEBUG_PARSER);
+
+    if ((m = calloc(1, sizeof(*m))) == NULL) {
+	cr->error = true;
+	debug_return_ptr(NULL);
+    }
+    m->type = (short)cache_get_int(cr);
+    m->negated = (short)cache_get_int(cr);
+    switch (cache_get_u32(cr)) {
+    case CACHE_MEMBER_CMND: {
+	struct command_digest *digest;
+	struct sudo_command *c;
+	uint32_t ndigests;
+
+	/* free_member() only expects a struct sudo_command for these. */
+	if (m->type != COMMAND && m->type != ALL) {
+	    cr->error = true;
+	    break;
+	}
+	if ((c = calloc(1, sizeof(*c))) == NULL) {
+	    cr->error = true;
+	    break;
+	}
+	TAILQ_INIT(&c->digests);
+	m->name = (char *)c;
+	is_cmnd = true;
+	c->cmnd = cache_get_str(cr);
+	c->args = cache_get_str(cr);
+	ndigests = cache_get_u32(cr);
+	while (!cr->error && ndigests--) {
+	    if ((digest = calloc(1, sizeof(*digest))) == NULL) {
+		cr->error = true;
+		break;
+	    }
+	    TAILQ_INSERT_TAIL(&c->digests, digest, entries);
+	    digest->digest_type = cache_get_u32(cr);
+	    digest->digest_str = cache_get_str(cr);
+	}
+	break;
+    }
+    case CACHE_MEMBER_STR:
+	/* Don't let free_member() treat the name as a struct sudo_command. */
+	if (m->type == COMMAND) {
+	    cr->error = true;
+	    break;
+	}
+	m->name = cache_get_str(cr);
+	if (m->type == ALL && m->name != NULL)
+	    cr->error = true;
+	break;
+    default:
+	cr->error = true;
+	break;
+    }
+    if (cr->error) {
+	if (is_cmnd) {
+	    free_member(m);
+	} else {
+	    free(m->name);
+	    free(m);
+	}
+	debug_return_ptr(NULL);
+    }
+
+    debug_return_ptr(m);
+}
+
+static void
+cache_get_members(struct cache_reader *cr, struct member_list *members)
+{
+    struct member *m;
+    uint32_t count;
+    debug_decl(cache_get_members, SUDOERS_DEBUG_PARSER);
+
+    count = cache_get_u32(cr);
+    while (!cr->error && count--) {
+	if ((m = cache_get_member(cr)) == NULL)
+	    break;
+	TAILQ_INSERT_TAIL(members, m, entries);
+    }
+
+    debug_return;
+}
+
+static void
+cache_get_defaults(struct cache_reader *cr, struct defaults_list *defs)
+{
+    struct defaults_binding *binding = NULL;
+    struct defaults *d;
+    uint32_t count;
+    debug_decl(cache_get_defaults, SUDOERS_DEBUG_PARSER);
+
+    count = cache_get_u32(cr);
+    while (!cr->error && count--) {
+	if ((d = calloc(1, sizeof(*d))) == NULL) {
+	    cr->error = true;
+	    break;
+	}
+	TAILQ_INSERT_TAIL(defs, d, entries);
+	d->var = cache_get_str(cr);
+	d->val = cache_get_str(cr);
+	d->type = cache_get_int(cr);
+	d->op = cache_get_int(cr);
+	d->line = cache_get_int(cr);
+	d->column = cache_get_int(cr);
+	d->file = cache_get_file(cr);
+	switch (cache_get_u32(cr)) {
+	case CACHE_BINDING_NONE:
+	    binding = NULL;
+	    break;
+	case CACHE_BINDING_PREV:
+	    if (binding == NULL) {
+		cr->error = true;
+		break;
+	    }
+	    binding->refcnt++;
+	    d->binding = binding;
+	    break;
+	case CACHE_BINDING_NEW:
+	    if ((binding = malloc(sizeof(*binding))) == NULL) {
+		cr->error = true;
+		break;
+	    }
+	    TAILQ_INIT(&binding->members);
+	    binding->refcnt = 1;
+	    d->binding = binding;
+	    cache_get_members(cr, &binding->members);
+	    break;
+	default:
+	    cr->error = true;
+	    break;
+	}
+	if (d->var == NULL)
+	    cr->error = true;
+	else
+	    d->idx = sudo_defs_index(d->var);
+    }
+
+    debug_return;
+}
+
+/*
+ * Decode a runas user or group list, which may be NULL.
+ */
+static struct member_list *
+cache_get_runaslist(struct cache_reader *cr)
+{
+    struct member_list *list;
+    debug_decl(cache_get_runaslist, SUDOERS_DEBUG_PARSER);
+
+    if (cache_get_u32(cr) == 0 || cr->error)
+	debug_return_ptr(NULL);
+    if ((list = malloc(sizeof(*list))) == NULL) {
+	cr->error = true;
+	debug_return_ptr(NULL);
+    }
+    TAILQ_INIT(list);
+    cache_get_members(cr, list);
+
+    debug_return_ptr(list);
+}
+
+static void
+cache_get_cmndspec(struct cache_reader *cr, struct cmndspec_list *csl)
+{
+    struct cmndspec *cs, *prev = TAILQ_LAST(csl, cmndspec_list);
+    struct member *m;
+    uint32_t shared;
+    debug_decl(cache_get_cmndspec, SUDOERS_DEBUG_PARSER);
+
+    if ((m = cache_get_member(cr)) == NULL)
+	debug_return;
+    if ((cs = calloc(1, sizeof(*cs))) == NULL) {
+	free_member(m);
+	cr->error = true;
+	debug_return;
+    }
+    cs->cmnd = m;
+    TAILQ_INSERT_TAIL(csl, cs, entries);
+
+    shared = cache_get_u32(cr);
+    if (shared != 0 && prev == NULL) {
+	cr->error = true;
+	debug_return;
+    }
+
+#define CACHE_GET_SHARED(_f, _flag, _get) do {				\
+    if (!cr->error) {							\
+	if (ISSET(shared, (_flag)))					\
+	    cs->_f = prev->_f;						\
+	else								\
+	    cs->_f = _get(cr);						\
+    }									\
+} while (0)
+
+    CACHE_GET_SHARED(runasuserlist, CACHE_SHARE_RUNASUSER, cache_get_runaslist);
+    CACHE_GET_SHARED(runasgrouplist, CACHE_SHARE_RUNASGROUP, cache_get_runaslist);
+    CACHE_GET_SHARED(runcwd, CACHE_SHARE_RUNCWD, cache_get_str);
+    CACHE_GET_SHARED(runchroot, CACHE_SHARE_RUNCHROOT, cache_get_str);
+    CACHE_GET_SHARED(role, CACHE_SHARE_ROLE, cache_get_str);
+    CACHE_GET_SHARED(type, CACHE_SHARE_TYPE, cache_get_str);
+    CACHE_GET_SHARED(apparmor_profile, CACHE_SHARE_APPARMOR, cache_get_str);
+    CACHE_GET_SHARED(privs, CACHE_SHARE_PRIVS, cache_get_str);
+    CACHE_GET_SHARED(limitprivs, CACHE_SHARE_LIMITPRIVS, cache_get_str);
+#undef CACHE_GET_SHARED
+
+    cs->tags.follow = cache_get_int(cr);
+    cs->tags.intercept = cache_get_int(cr);
+    cs->tags.log_input = cache_get_int(cr);
+    cs->tags.log_output = cache_get_int(cr);
+    cs->tags.noexec = cache_get_int(cr);
+    cs->tags.nopasswd = cache_get_int(cr);
+    cs->tags.send_mail = cache_get_int(cr);
+    cs->tags.setenv = cache_get_int(cr);
+    cs->timeout = cache_get_int(cr);
+    cs->notbefore = (time_t)cache_get_i64(cr);
+    cs->notafter = (time_t)cache_get_i64(cr);
+
+    debug_return;
+}
+
+static void
+cache_get_privilege(struct cache_reader *cr, struct privilege_list *privs)
+{
+    struct privilege *priv;
+    uint32_t count;
+    debug_decl(cache_get_privilege, SUDOERS_DEBUG_PARSER);
+
+    if ((priv = calloc(1, sizeof(*priv))) == NULL) {
+	cr->error = true;
+	debug_return;
+    }
+    TAILQ_INIT(&priv->hostlist);
+    TAILQ_INIT(&priv->cmndlist);
+    TAILQ_INIT(&priv->defaults);
+    TAILQ_INSERT_TAIL(privs, priv, entries);
+
+    priv->ldap_role = cache_get_str(cr);
+    cache_get_members(cr, &priv->hostlist);
+    count = cache_get_u32(cr);
+    while (!cr->error && count--)
+	cache_get_cmndspec(cr, &priv->cmndlist);
+    cache_get_defaults(cr, &priv->defaults);
+
+    debug_return;
+}
+
+static void
+cache_get_userspec(struct cache_reader *cr, struct userspec_list *usl)
+{
+    struct sudoers_comment *comment;
+    struct userspec *us;
+    uint32_t count;
+    debug_decl(cache_get_userspec, SUDOERS_DEBUG_PARSER);
+
+    if ((us = calloc(1, sizeof(*us))) == NULL) {
+	cr->error = true;
+	debug_return;
+    }
+    TAILQ_INIT(&us->users);
+    TAILQ_INIT(&us->privileges);
+    STAILQ_INIT(&us->comments);
+    TAILQ_INSERT_TAIL(usl, us, entries);
+
+    cache_get_members(cr, &us->users);
+    count = cache_get_u32(cr);
+    while (!cr->error && count--)
+	cache_get_privilege(cr, &us->privileges);
+    count = cache_get_u32(cr);
+    while (!cr->error && count--) {
+	if ((comment = calloc(1, sizeof(*comment))) == NULL) {
+	    cr->error = true;
+	    break;
+	}
+	STAILQ_INSERT_TAIL(&us->comments, comment, entries);
+	comment->str = cache_get_str(cr);
+    }
+    us->line = cache_get_int(cr);
+    us->column = cache_get_int(cr);
+    us->file = cache_get_file(cr);
+
+    debug_return;
+}
+
+static void
+cache_get_alias(struct cache_reader *cr, struct rbtree *aliases)
+{
+    struct alias *a;
+    char *name;
+    short type;
+    debug_decl(cache_get_alias, SUDOERS_DEBUG_PARSER);
+
+    name = cache_get_str(cr);
+    type = (short)cache_get_int(cr);
+    if (cr->error || name == NULL) {
+	free(name);
+	cr->error = true;
+	debug_return;
+    }
+    if ((a = calloc(1, sizeof(*a))) == NULL) {
+	free(name);
+	cr->error = true;
+	debug_return;
+    }
+    a->name = name;
+    a->type = type;
+    TAILQ_INIT(&a->members);
+    if (rbinsert(aliases, a, NULL) != 0) {
+	/* Duplicate alias or out of memory. */
+	alias_free(a);
+	cr->error = true;
+	debug_return;
+    }
+    a->line = cache_get_int(cr);
+    a->column = cache_get_int(cr);
+    a->file = cache_get_file(cr);
+    cache_get_members(cr, &a->members);
+
+    debug_return;
+}
+
+/*
+ * Check that a source recorded in the cache is unchanged.
+ * Returns true if the source is current, else false.
+ */
+static bool
+cache_check_source(struct cache_reader *cr, bool ignore_perms)
+{
+    const unsigned char *digest;
+    unsigned char *cur_digest = NULL;
+    size_t cur_digest_len, len;
+    const char *str;
+    char path[PATH_MAX];
+    struct stat sb;
+    unsigned int type;
+    int64_t dev, ino, size, ctime_sec, mtime_sec;
+    uint32_t mode, uid, gid, digest_len;
+    int fd, status;
+    bool ret = false;
+    debug_decl(cache_check_source, SUDOERS_DEBUG_PARSER);
+
+    str = cache_peek_str(cr, &len);
+    if (str == NULL || len >= sizeof(path)) {
+	cr->error = true;
+	debug_return_bool(false);
+    }
+    memcpy(path, str, len);
+    path[len] = '\0';
+    type = cache_get_u32(cr);
+    dev = cache_get_i64(cr);
+    ino = cache_get_i64(cr);
+    size = cache_get_i64(cr);
+    mode = cache_get_u32(cr);
+    uid = cache_get_u32(cr);
+    gid = cache_get_u32(cr);
+    ctime_sec = cache_get_i64(cr);
+    mtime_sec = cache_get_i64(cr);
+    digest_len = cache_get_u32(cr);
+    digest = cr->cur;
+    if (cr->error || digest_len > (size_t)(cr->end - cr->cur)) {
+	cr->error = true;
+	debug_return_bool(false);
+    }
+    cr->cur += digest_len;
+
+    /*
+     * Sources must pass the same security checks as the parser uses.
+     * Skipped sources only need to be unchanged.
+     */
+    if (ignore_perms || type == CACHE_SOURCE_SKIPPED) {
+	status = stat(path, &sb) == 0 ? SUDO_PATH_SECURE : SUDO_PATH_MISSING;
+    } else if (type == CACHE_SOURCE_DIR) {
+	status = sudo_secure_dir(path, sudoers_file_uid(), sudoers_file_gid(),
+	    &sb);
+    } else {
+	status = sudo_secure_file(path, sudoers_file_uid(), sudoers_file_gid(),
+	    &sb);
+    }
+    if (status != SUDO_PATH_SECURE) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: missing or insecure (%d)", path, status);
+	debug_return_bool(false);
+    }
+    if ((int64_t)sb.st_dev != dev || (int64_t)sb.st_ino != ino ||
+	    (int64_t)sb.st_size != size || (uint32_t)sb.st_mode != mode ||
+	    (uint32_t)sb.st_uid != uid || (uint32_t)sb.st_gid != gid ||
+	    (int64_t)sb.st_ctime != ctime_sec || (int64_t)sb.st_mtime != mtime_sec) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: modified since cache was written", path);
+	debug_return_bool(false);
+    }
+    if (type != CACHE_SOURCE_FILE)
+	debug_return_bool(true);
+
+    /* Verify that the contents match too. */
+    fd = open(path, O_RDONLY|O_NONBLOCK);
+    if (fd == -1) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "unable to open %s", path);
+	debug_return_bool(false);
+    }
+    cur_digest = cache_digest_fd(fd, path, &cur_digest_len);
+    close(fd);
+    if (cur_digest != NULL) {
+	if (cur_digest_len == digest_len &&
+		memcmp(cur_digest, digest, digest_len) == 0) {
+	    ret = true;
+	} else {
+	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+		"%s: digest mismatch", path);
+	}
+	free(cur_digest);
+    }
+
+    debug_return_bool(ret);
+}
+
+/*
+ * Load a parse tree from the binary cache file at path.
+ * The parse tree must be initialized but empty.
+ * Returns true if the cache was current and loaded, else false,
+ * in which case the caller should parse sudoers normally.
+ */
+bool
+sudoers_cache_read(const struct sudoers_context *ctx, const char *path,
+    struct sudoers_parse_tree *parse_tree)
+{
+    struct sudoers_parse_tree tree;
+    struct sudoers_cache_header hdr;
+    struct cache_reader cr = { NULL };
+    void *map = MAP_FAILED;
+    struct stat sb;
+    const char *str;
+    uint32_t i, count;
+    size_t len;
+    int fd, status;
+    bool ret = false;
+    debug_decl(sudoers_cache_read, SUDOERS_DEBUG_PARSER);
+
+    init_parse_tree(&tree, NULL, NULL, parse_tree->ctx, parse_tree->nss);
+
+    fd = open(path, O_RDONLY|O_NONBLOCK);
+    if (ctx->parser_conf.ignore_perms) {
+	if (fd == -1 || fstat(fd, &sb) == -1)
+	    status = SUDO_PATH_MISSING;
+	else
+	    status = SUDO_PATH_SECURE;
+    } else {
+	status = sudo_secure_fd(fd, S_IFREG, sudoers_file_uid(),
+	    sudoers_file_gid(), &sb);
+    }
+    if (status != SUDO_PATH_SECURE) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: missing or insecure (%d)", path, status);
+	goto done;
+    }
+    if (sb.st_size < ssizeof(hdr) || (uintmax_t)sb.st_size > SIZE_MAX) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "%s: invalid size %lld", path, (long long)sb.st_size);
+	goto done;
+    }
+    map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "unable to mmap %s", path);
+	goto done;
+    }
+
+    memcpy(&hdr, map, sizeof(hdr));
+    if (memcmp(hdr.magic, SUDOERS_CACHE_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.byteorder != SUDOERS_CACHE_BYTEORDER ||
+	    hdr.version != SUDOERS_CACHE_VERSION ||
+	    hdr.grammar_version != SUDOERS_GRAMMAR_VERSION ||
+	    hdr.hdrsize != sizeof(hdr) ||
+	    hdr.size != (uint64_t)sb.st_size - sizeof(hdr)) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: unsupported cache version or format", path);
+	goto done;
+    }
+    cr.cur = (const unsigned char *)map + sizeof(hdr);
+    cr.end = cr.cur + hdr.size;
+
+    /* Include paths may depend on the host name. */
+    str = cache_peek_str(&cr, &len);
+    if (str == NULL || ctx->user.shost == NULL ||
+	    strlen(ctx->user.shost) != len ||
+	    strncmp(ctx->user.shost, str, len) != 0) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s: host name mismatch", path);
+	goto done;
+    }
+
+    /* Make sure none of the sources have changed. */
+    count = cache_get_u32(&cr);
+    if (count == 0)
+	cr.error = true;
+    for (i = 0; i < count && !cr.error; i++) {
+	if (!cache_check_source(&cr, ctx->parser_conf.ignore_perms)) {
+	    if (!cr.error) {
+		sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+		    "%s: cache is stale", path);
+		goto done;
+	    }
+	}
+    }
+
+    /* File names are reference-counted strings. */
+    cr.nfiles = cache_get_u32(&cr);
+    if (!cr.error && cr.nfiles > (size_t)(cr.end - cr.cur) / sizeof(uint32_t))
+	cr.error = true;
+    if (!cr.error && cr.nfiles != 0) {
+	cr.files = calloc(cr.nfiles, sizeof(char *));
+	if (cr.files == NULL)
+	    cr.error = true;
+    }
+    for (i = 0; i < cr.nfiles && !cr.error; i++) {
+	str = cache_peek_str(&cr, &len);
+	if (str == NULL || (cr.files[i] = sudo_rcstr_alloc(len)) == NULL) {
+	    cr.error = true;
+	    break;
+	}
+	memcpy(cr.files[i], str, len);
+	cr.files[i][len] = '\0';
+    }
+
+    /* Decode the parse tree itself. */
+    cache_get_defaults(&cr, &tree.defaults);
+    count = cache_get_u32(&cr);
+    while (!cr.error && count--)
+	cache_get_userspec(&cr, &tree.userspecs);
+    count = cache_get_u32(&cr);
+    if (!cr.error && count != 0) {
+	if ((tree.aliases = alloc_aliases()) == NULL)
+	    cr.error = true;
+    }
+    while (!cr.error && count--)
+	cache_get_alias(&cr, tree.aliases);
+    if (!cr.error && cr.cur != cr.end)
+	cr.error = true;
+
+    if (cr.error) {
+	sudo_warnx(U_("%s: invalid sudoers cache, ignoring"), path);
+	goto done;
+    }
+
+    /* Move the loaded policy to the caller's parse tree. */
+    TAILQ_CONCAT(&parse_tree->userspecs, &tree.userspecs, entries);
+    TAILQ_CONCAT(&parse_tree->defaults, &tree.defaults, entries);
+    parse_tree->aliases = tree.aliases;
+    tree.aliases = NULL;
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"loaded sudoers policy from cache %s", path);
+    ret = true;
+
+done:
+    free_parse_tree(&tree);
+    if (cr.files != NULL) {
+	for (i = 0; i < cr.nfiles; i++)
+	    sudo_rcstr_delref(cr.files[i]);
+	free(cr.files);
+    }
+    if (map != MAP_FAILED)
+	munmap(map, (size_t)sb.st_size);
+    if (fd != -1)
+	close(fd);
+    debug_return_bool(ret);
+}
@@ -0,0 +1,669 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2025 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Pre-computed index over a sudoers parse tree.
+ *
+ * Most rules in a large sudoers file name a specific user or group,
+ * host and command.  The index maps literal user names and %groups to
+ * the userspecs that contain them, and literal host names and command
+ * base names to the privileges and cmndspecs that contain them.
+ * Anything that cannot be decided by name alone (ALL, negation,
+ * netgroups, uids, wildcards, etc.) is always checked.
+ *
+ * The index only selects candidates, the normal matching functions
+ * still make the final decision.  A userspec, privilege or cmndspec
+ * that is not a candidate cannot match so the result of the lookup
+ * is the same as that of a linear scan.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pwd.h>
+
+#include <sudoers.h>
+#include <redblack.h>
+#include <gram.h>
+
+/*
+ * A single index key and the ordinals of the entries that contain it.
+ */
+struct index_entry {
+    char *key;
+    unsigned int *ids;
+    unsigned int nids;
+    unsigned int ids_size;
+};
+
+/* Result of classifying a member list. */
+#define INDEX_LITERAL	0	/* only literal names, all indexed */
+#define INDEX_COMPLEX	1	/* must always be checked */
+
+/*
+ * Maximum number of members, including those of nested aliases, that
+ * are indexed for a single list.  Expanding a large alias for every
+ * rule that uses it is quadratic; such rules are always checked instead
+ * and rely on the alias match being memoized.
+ */
+#define INDEX_MAX_MEMBERS	128
+
+struct index_closure {
+    struct sudoers_index *idx;
+    const struct passwd *pw;
+};
+
+static int
+index_entry_compare(const void *v1, const void *v2)
+{
+    const struct index_entry *e1 = v1;
+    const struct index_entry *e2 = v2;
+
+    return strcmp(e1->key, e2->key);
+}
+
+static void
+index_entry_free(void *v)
+{
+    struct index_entry *entry = v;
+
+    free(entry->key);
+    free(entry->ids);
+    free(entry);
+}
+
+/*
+ * Append id to an array of unsigned ints, growing it as needed.
+ * Duplicate ids are only stored once since ids are added in order.
+ */
+static bool
+index_append(unsigned int **ids, unsigned int *nids, unsigned int *ids_size,
+    unsigned int id)
+{
+    debug_decl(index_append, SUDOERS_DEBUG_PARSER);
+
+    if (*nids > 0 && (*ids)[*nids - 1] == id)
+	debug_return_bool(true);
+    if (*nids == *ids_size) {
+	const unsigned int new_size = *ids_size ? *ids_size * 2 : 8;
+	unsigned int *new_ids;
+
+	new_ids = reallocarray(*ids, new_size, sizeof(unsigned int));
+	if (new_ids == NULL) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    debug_return_bool(false);
+	}
+	*ids = new_ids;
+	*ids_size = new_size;
+    }
+    (*ids)[(*nids)++] = id;
+    debug_return_bool(true);
+}
+
+/*
+ * Add id to the list for key in tree, creating a new entry if needed.
+ * If fold is set, the key is stored in lower case.
+ */
+static bool
+index_add(struct rbtree *tree, const char *key, bool fold, unsigned int id)
+{
+    struct index_entry *entry;
+    struct rbnode *node;
+    char *copy;
+    debug_decl(index_add, SUDOERS_DEBUG_PARSER);
+
+    if ((copy = strdup(key)) == NULL)
+	goto oom;
+    if (fold) {
+	char *cp;
+	for (cp = copy; *cp != '\0'; cp++)
+	    *cp = (char)tolower((unsigned char)*cp);
+    }
+
+    if ((entry = calloc(1, sizeof(*entry))) == NULL) {
+	free(copy);
+	goto oom;
+    }
+    entry->key = copy;
+    switch (rbinsert(tree, entry, &node)) {
+    case 0:
+	break;
+    case 1:
+	/* Already present, use the existing entry. */
+	index_entry_free(entry);
+	entry = node->data;
+	break;
+    default:
+	index_entry_free(entry);
+	goto oom;
+    }
+    debug_return_bool(index_append(&entry->ids, &entry->nids,
+	&entry->ids_size, id));
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+    debug_return_bool(false);
+}
+
+/*
+ * Look up key in tree, folding it to lower case if fold is set.
+ * Stores the matching entry, or NULL if there is none, in entryp.
+ * Returns false on allocation failure, else true.
+ */
+static bool
+index_find(struct rbtree *tree, const char *key, bool fold,
+    struct index_entry **entryp)
+{
+    struct index_entry search;
+    struct rbnode *node;
+    char *copy = NULL;
+    debug_decl(index_find, SUDOERS_DEBUG_PARSER);
+
+    *entryp = NULL;
+    if (key == NULL)
+	debug_return_bool(true);
+    if (fold) {
+	char *cp;
+
+	if ((copy = strdup(key)) == NULL) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    debug_return_bool(false);
+	}
+	for (cp = copy; *cp != '\0'; cp++)
+	    *cp = (char)tolower((unsigned char)*cp);
+	key = copy;
+    }
+    search.key = (char *)key;
+    if ((node = rbfind(tree, &search)) != NULL)
+	*entryp = node->data;
+    free(copy);
+    debug_return_bool(true);
+}
+
+/*
+ * Add the user names and groups in list to the index for userspec id.
+ * Mirrors user_matches(), including the fall back to a user name
+ * when an alias is not defined.
+ * Returns INDEX_LITERAL, INDEX_COMPLEX or -1 on error.
+ */
+static int
+index_userlist(const struct sudoers_parse_tree *parse_tree,
+    struct sudoers_index *idx, const struct member_list *list, unsigned int id,
+    unsigned int *budget)
+{
+    struct member *m;
+    struct alias *a;
+    int ret = INDEX_LITERAL;
+    debug_decl(index_userlist, SUDOERS_DEBUG_PARSER);
+
+    TAILQ_FOREACH(m, list, entries) {
+	if (m->negated || (*budget)-- == 0)
+	    debug_return_int(INDEX_COMPLEX);
+	switch (m->type) {
+	case USERGROUP:
+	    if (!index_add(idx->groups, m->name, false, id))
+		debug_return_int(-1);
+	    if (m->name[1] == '#' || m->name[1] == ':') {
+		if (!index_add(idx->special_groups, m->name, false, id))
+		    debug_return_int(-1);
+	    } else {
+		/* Case-folded in case def_case_insensitive_group is set. */
+		if (!index_add(idx->group_names, m->name + 1, true, id))
+		    debug_return_int(-1);
+	    }
+	    break;
+	case ALIAS:
+	    a = alias_get(parse_tree, m->name, USERALIAS);
+	    if (a != NULL) {
+		ret = index_userlist(parse_tree, idx, &a->members, id, budget);
+		alias_put(a);
+		if (ret != INDEX_LITERAL)
+		    debug_return_int(ret);
+		break;
+	    }
+	    FALLTHROUGH;
+	case WORD:
+	    /* A uid must be matched numerically. */
+	    if (m->name[0] == '#')
+		debug_return_int(INDEX_COMPLEX);
+	    /* Case-folded in case def_case_insensitive_user is set. */
+	    if (!index_add(idx->users, m->name, true, id))
+		debug_return_int(-1);
+	    break;
+	default:
+	    /* ALL, NETGROUP */
+	    debug_return_int(INDEX_COMPLEX);
+	}
+    }
+    debug_return_int(ret);
+}
+
+/*
+ * Add the host names in list to the index for privilege id.
+ * Returns INDEX_LITERAL, INDEX_COMPLEX or -1 on error.
+ */
+static int
+index_hostlist(const struct sudoers_parse_tree *parse_tree,
+    struct sudoers_index *idx, const struct member_list *list, unsigned int id,
+    unsigned int *budget)
+{
+    struct member *m;
+    struct alias *a;
+    int ret = INDEX_LITERAL;
+    debug_decl(index_hostlist, SUDOERS_DEBUG_PARSER);
+
+    TAILQ_FOREACH(m, list, entries) {
+	if (m->negated || (*budget)-- == 0)
+	    debug_return_int(INDEX_COMPLEX);
+	switch (m->type) {
+	case ALIAS:
+	    a = alias_get(parse_tree, m->name, HOSTALIAS);
+	    if (a != NULL) {
+		ret = index_hostlist(parse_tree, idx, &a->members, id, budget);
+		alias_put(a);
+		if (ret != INDEX_LITERAL)
+		    debug_return_int(ret);
+		break;
+	    }
+	    FALLTHROUGH;
+	case WORD:
+	    if (has_meta(m->name))
+		debug_return_int(INDEX_COMPLEX);
+	    /* Host names are matched without regard to case. */
+	    if (!index_add(idx->hosts, m->name, true, id))
+		debug_return_int(-1);
+	    break;
+	default:
+	    /* ALL, NETGROUP, NTWKADDR */
+	    debug_return_int(INDEX_COMPLEX);
+	}
+    }
+    debug_return_int(ret);
+}
+
+/*
+ * Add the command base name(s) in m to the index for cmndspec id.
+ * Only fully-qualified paths without wildcards are indexed;
+ * command_matches_normal() rejects those unless the base name matches.
+ * Negated commands are fine, a command that does not match
+ * returns UNSPEC whether or not it is negated.
+ * Returns INDEX_LITERAL, INDEX_COMPLEX or -1 on error.
+ */
+static int
+index_cmnd(const struct sudoers_parse_tree *parse_tree,
+    struct sudoers_index *idx, const struct member *m, unsigned int id,
+    unsigned int *budget)
+{
+    struct sudo_command *c;
+    struct member *am;
+    struct alias *a;
+    size_t len;
+    int ret = INDEX_LITERAL;
+    debug_decl(index_cmnd, SUDOERS_DEBUG_PARSER);
+
+    if ((*budget)-- == 0)
+	debug_return_int(INDEX_COMPLEX);
+
+    switch (m->type) {
+    case COMMAND:
+	c = (struct sudo_command *)m->name;
+	if (c->cmnd == NULL || c->cmnd[0] != '/' || has_meta(c->cmnd))
+	    debug_return_int(INDEX_COMPLEX);
+	len = strlen(c->cmnd);
+	if (c->cmnd[len - 1] == '/')
+	    debug_return_int(INDEX_COMPLEX);
+	if (!index_add(idx->cmnds, sudo_basename(c->cmnd), false, id))
+	    debug_return_int(-1);
+	break;
+    case ALIAS:
+	/* An undefined alias never matches, there is nothing to add. */
+	a = alias_get(parse_tree, m->name, CMNDALIAS);
+	if (a != NULL) {
+	    TAILQ_FOREACH(am, &a->members, entries) {
+		ret = index_cmnd(parse_tree, idx, am, id, budget);
+		if (ret != INDEX_LITERAL)
+		    break;
+	    }
+	    alias_put(a);
+	}
+	break;
+    default:
+	/* ALL */
+	ret = INDEX_COMPLEX;
+	break;
+    }
+    debug_return_int(ret);
+}
+
+static unsigned int
+count_entries(const struct sudoers_parse_tree *parse_tree,
+    unsigned int *nprivs, unsigned int *ncmndspecs)
+{
+    struct userspec *us;
+    struct privilege *priv;
+    struct cmndspec *cs;
+    unsigned int nuserspecs = 0;
+
+    *nprivs = *ncmndspecs = 0;
+    TAILQ_FOREACH(us, &parse_tree->userspecs, entries) {
+	nuserspecs++;
+	TAILQ_FOREACH(priv, &us->privileges, entries) {
+	    (*nprivs)++;
+	    TAILQ_FOREACH(cs, &priv->cmndlist, entries)
+		(*ncmndspecs)++;
+	}
+    }
+    return nuserspecs;
+}
+
+/*
+ * Build an index for the userspecs in parse_tree.
+ * Returns the new index or NULL on error.
+ */
+struct sudoers_index *
+sudoers_index_build(const struct sudoers_parse_tree *parse_tree)
+{
+    struct sudoers_index *idx;
+    struct userspec *us;
+    struct privilege *priv;
+    struct cmndspec *cs;
+    unsigned int i, p, c, budget;
+    int rc;
+    debug_decl(sudoers_index_build, SUDOERS_DEBUG_PARSER);
+
+    if ((idx = calloc(1, sizeof(*idx))) == NULL)
+	goto oom;
+    idx->nuserspecs = count_entries(parse_tree, &idx->nprivs,
+	&idx->ncmndspecs);
+
+    idx->users = rbcreate(index_entry_compare);
+    idx->groups = rbcreate(index_entry_compare);
+    idx->group_names = rbcreate(index_entry_compare);
+    idx->special_groups = rbcreate(index_entry_compare);
+    idx->hosts = rbcreate(index_entry_compare);
+    idx->cmnds = rbcreate(index_entry_compare);
+    if (idx->users == NULL || idx->groups == NULL ||
+	    idx->group_names == NULL || idx->special_groups == NULL ||
+	    idx->hosts == NULL || idx->cmnds == NULL)
+	goto oom;
+
+    /* Arrays are allocated with an extra element so they are never empty. */
+    idx->userspecs = reallocarray(NULL, idx->nuserspecs + 1,
+	sizeof(struct userspec *));
+    idx->privs = reallocarray(NULL, idx->nprivs + 1,
+	sizeof(struct privilege *));
+    idx->cmndspecs = reallocarray(NULL, idx->ncmndspecs + 1,
+	sizeof(struct cmndspec *));
+    idx->priv_start = reallocarray(NULL, idx->nuserspecs + 1,
+	sizeof(unsigned int));
+    idx->cs_start = reallocarray(NULL, idx->nprivs + 1,
+	sizeof(unsigned int));
+    idx->candidates = reallocarray(NULL, idx->nuserspecs + 1,
+	sizeof(unsigned int));
+    idx->userspec_stamp = calloc(idx->nuserspecs + 1, sizeof(unsigned int));
+    idx->host_stamp = calloc(idx->nprivs + 1, sizeof(unsigned int));
+    idx->cmnd_stamp = calloc(idx->ncmndspecs + 1, sizeof(unsigned int));
+    idx->host_literal = calloc(idx->nprivs + 1, sizeof(bool));
+    idx->cmnd_literal = calloc(idx->ncmndspecs + 1, sizeof(bool));
+    if (idx->userspecs == NULL || idx->privs == NULL ||
+	    idx->cmndspecs == NULL || idx->priv_start == NULL ||
+	    idx->cs_start == NULL || idx->candidates == NULL ||
+	    idx->userspec_stamp == NULL || idx->host_stamp == NULL ||
+	    idx->cmnd_stamp == NULL ||
+	    idx->host_literal == NULL || idx->cmnd_literal == NULL)
+	goto oom;
+
+    i = p = c = 0;
+    TAILQ_FOREACH(us, &parse_tree->userspecs, entries) {
+	idx->userspecs[i] = us;
+	idx->priv_start[i] = p;
+	budget = INDEX_MAX_MEMBERS;
+	rc = index_userlist(parse_tree, idx, &us->users, i, &budget);
+	if (rc == -1)
+	    goto bad;
+	if (rc == INDEX_COMPLEX) {
+	    if (!index_append(&idx->always, &idx->nalways, &idx->always_size, i))
+		goto bad;
+	}
+
+	TAILQ_FOREACH(priv, &us->privileges, entries) {
+	    idx->privs[p] = priv;
+	    idx->cs_start[p] = c;
+	    budget = INDEX_MAX_MEMBERS;
+	    rc = index_hostlist(parse_tree, idx, &priv->hostlist, p, &budget);
+	    if (rc == -1)
+		goto bad;
+	    idx->host_literal[p] = rc == INDEX_LITERAL;
+
+	    TAILQ_FOREACH(cs, &priv->cmndlist, entries) {
+		idx->cmndspecs[c] = cs;
+		/* A rule-specific chroot changes the command path. */
+		if (cs->runchroot == NULL) {
+		    budget = INDEX_MAX_MEMBERS;
+		    rc = index_cmnd(parse_tree, idx, cs->cmnd, c, &budget);
+		    if (rc == -1)
+			goto bad;
+		    idx->cmnd_literal[c] = rc == INDEX_LITERAL;
+		}
+		c++;
+	    }
+	    p++;
+	}
+	i++;
+    }
+    idx->priv_start[i] = p;
+    idx->cs_start[p] = c;
+
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"indexed %u userspecs (%u always checked), %u privileges, "
+	"%u cmndspecs", idx->nuserspecs, idx->nalways, idx->nprivs,
+	idx->ncmndspecs);
+
+    debug_return_ptr(idx);
+oom:
+    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+bad:
+    sudoers_index_free(idx);
+    debug_return_ptr(NULL);
+}
+
+static void
+stamp_entry(struct index_entry *entry, unsigned int *stamps,
+    unsigned int generation)
+{
+    unsigned int n;
+
+    if (entry != NULL) {
+	for (n = 0; n < entry->nids; n++)
+	    stamps[entry->ids[n]] = generation;
+    }
+}
+
+static void
+add_candidates(struct sudoers_index *idx, const unsigned int *ids,
+    unsigned int nids)
+{
+    unsigned int n;
+
+    for (n = 0; n < nids; n++) {
+	/* Each userspec is only added once per lookup. */
+	if (idx->userspec_stamp[ids[n]] == idx->generation)
+	    continue;
+	idx->userspec_stamp[ids[n]] = idx->generation;
+	idx->candidates[idx->ncandidates++] = ids[n];
+    }
+}
+
+/*
+ * rbapply() callback to add the userspecs for each group the user
+ * belongs to.  Each group is only checked once, not once per rule.
+ */
+static int
+select_groups(void *v1, void *v2)
+{
+    struct index_entry *entry = v1;
+    struct index_closure *closure = v2;
+
+    if (usergr_matches(entry->key, closure->pw->pw_name, closure->pw) == ALLOW)
+	add_candidates(closure->idx, entry->ids, entry->nids);
+    return 0;
+}
+
+static int
+compare_ids(const void *v1, const void *v2)
+{
+    const unsigned int id1 = *(const unsigned int *)v1;
+    const unsigned int id2 = *(const unsigned int *)v2;
+
+    return id1 < id2 ? -1 : id1 > id2;
+}
+
+/*
+ * Select the candidate userspecs, privileges and cmndspecs for
+ * a lookup of the user described by pw running cmnd_base.
+ * The candidate userspecs are stored in idx->candidates in
+ * parse tree order; use sudoers_index_host_candidate() and
+ * sudoers_index_cmnd_candidate() for privileges and cmndspecs.
+ * If cmnd_base is NULL, all cmndspecs are candidates.
+ * Returns false on error, in which case the index must not be used.
+ */
+bool
+sudoers_index_select(struct sudoers_index *idx,
+    const struct sudoers_parse_tree *parse_tree, const struct passwd *pw,
+    const char *cmnd_base)
+{
+    const struct sudoers_context *ctx = parse_tree->ctx;
+    const char *lhost = parse_tree->lhost ? parse_tree->lhost : ctx->runas.host;
+    const char *shost = parse_tree->shost ? parse_tree->shost : ctx->runas.shost;
+    struct index_closure closure;
+    struct index_entry *entry;
+    unsigned int n;
+    debug_decl(sudoers_index_select, SUDOERS_DEBUG_PARSER);
+
+    /* Stamps from a previous generation are stale. */
+    if (++idx->generation == 0) {
+	memset(idx->userspec_stamp, 0, idx->nuserspecs * sizeof(unsigned int));
+	memset(idx->host_stamp, 0, idx->nprivs * sizeof(unsigned int));
+	memset(idx->cmnd_stamp, 0, idx->ncmndspecs * sizeof(unsigned int));
+	idx->generation = 1;
+    }
+    idx->ncandidates = 0;
+
+    /* Userspecs that name the user or one of the user's groups. */
+    add_candidates(idx, idx->always, idx->nalways);
+    if (pw != NULL) {
+	if (!index_find(idx->users, pw->pw_name, true, &entry))
+	    debug_return_bool(false);
+	if (entry != NULL)
+	    add_candidates(idx, entry->ids, entry->nids);
+	closure.idx = idx;
+	closure.pw = pw;
+	if (def_match_group_by_gid ||
+		(def_group_plugin && def_always_query_group_plugin)) {
+	    /* Group names must be resolved, check each one. */
+	    rbapply(idx->groups, select_groups, &closure, inorder);
+	} else {
+	    /*
+	     * Look up the user's groups by name instead of checking
+	     * each group in sudoers, see user_in_group().
+	     */
+	    struct group_list *grlist = sudo_get_grlist(pw);
+	    if (grlist != NULL) {
+		int i;
+		for (i = 0; i < grlist->ngroups; i++) {
+		    if (!index_find(idx->group_names, grlist->groups[i], true,
+			    &entry)) {
+			sudo_grlist_delref(grlist);
+			debug_return_bool(false);
+		    }
+		    if (entry != NULL)
+			add_candidates(idx, entry->ids, entry->nids);
+		}
+		sudo_grlist_delref(grlist);
+	    }
+	    rbapply(idx->special_groups, select_groups, &closure, inorder);
+	}
+    }
+    qsort(idx->candidates, idx->ncandidates, sizeof(unsigned int),
+	compare_ids);
+
+    /* Privileges that name this host, by short or long name. */
+    if (!index_find(idx->hosts, shost, true, &entry))
+	debug_return_bool(false);
+    stamp_entry(entry, idx->host_stamp, idx->generation);
+    if (lhost != shost) {
+	if (!index_find(idx->hosts, lhost, true, &entry))
+	    debug_return_bool(false);
+	stamp_entry(entry, idx->host_stamp, idx->generation);
+    }
+
+    /* Cmndspecs that name this command. */
+    if (cmnd_base != NULL) {
+	if (!index_find(idx->cmnds, cmnd_base, false, &entry))
+	    debug_return_bool(false);
+	stamp_entry(entry, idx->cmnd_stamp, idx->generation);
+    } else {
+	for (n = 0; n < idx->ncmndspecs; n++)
+	    idx->cmnd_stamp[n] = idx->generation;
+    }
+
+    sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+	"%u of %u userspecs are candidates", idx->ncandidates,
+	idx->nuserspecs);
+
+    debug_return_bool(true);
+}
+
+void
+sudoers_index_free(struct sudoers_index *idx)
+{
+    debug_decl(sudoers_index_free, SUDOERS_DEBUG_PARSER);
+
+    if (idx != NULL) {
+	if (idx->users != NULL)
+	    rbdestroy(idx->users, index_entry_free);
+	if (idx->groups != NULL)
+	    rbdestroy(idx->groups, index_entry_free);
+	if (idx->group_names != NULL)
+	    rbdestroy(idx->group_names, index_entry_free);
+	if (idx->special_groups != NULL)
+	    rbdestroy(idx->special_groups, index_entry_free);
+	if (idx->hosts != NULL)
+	    rbdestroy(idx->hosts, index_entry_free);
+	if (idx->cmnds != NULL)
+	    rbdestroy(idx->cmnds, index_entry_free);
+	free(idx->userspecs);
+	free(idx->privs);
+	free(idx->cmndspecs);
+	free(idx->priv_start);
+	free(idx->cs_start);
+	free(idx->always);
+	free(idx->candidates);
+	free(idx->userspec_stamp);
+	free(idx->host_stamp);
+	free(idx->cmnd_stamp);
+	free(idx->host_literal);
+	free(idx->cmnd_literal);
+	free(idx);
+    }
+
+    debug_return;
+}
@@ -135,6 +135,8 @@ static const char *session_dir = _PATH_SUDO_IO_LOGDIR;
 
 static bool terminal_can_resize, terminal_was_resized, follow_mode;
 
+static bool skip_to_offset;
+
 static int terminal_lines, terminal_cols;
 
 static int ttyfd = -1;
@@ -148,7 +150,7 @@ static struct iolog_file iolog_files[] = {
     { true, },	/* IOFD_TIMING */
 };
 
-static const char short_opts[] =  "d:f:Fhlm:nRSs:V";
+static const char short_opts[] =  "d:f:Fhlm:no:RSs:V";
 static struct option long_opts[] = {
     { "directory",	required_argument,	NULL,	'd' },
     { "filter",		required_argument,	NULL,	'f' },
@@ -157,6 +159,7 @@ static struct option long_opts[] = {
     { "list",		no_argument,		NULL,	'l' },
     { "max-wait",	required_argument,	NULL,	'm' },
     { "non-interactive", no_argument,		NULL,	'n' },
+    { "offset",		required_argument,	NULL,	'o' },
     { "no-resize",	no_argument,		NULL,	'R' },
     { "suspend-wait",	no_argument,		NULL,	'S' },
     { "speed",		required_argument,	NULL,	's' },
@@ -169,6 +172,7 @@ extern char *get_timestr(time_t, int);
 extern time_t get_date(char *);
 
 static int list_sessions(int, char **, const char *, const char *, const char *);
+static void index_seek(int iolog_dir_fd, const char *iolog_dir, struct timespec *offset);
 static int parse_expr(struct search_node_list *, char **, bool);
 static void read_keyboard(int fd, int what, void *v);
 static int replay_session(int iolog_dir_fd, const char *iolog_dir,
@@ -273,6 +277,12 @@ main(int argc, char *argv[])
 	case 'n':
 	    interactive = false;
 	    break;
+	case 'o':
+	    ep = iolog_parse_delay(optarg, &offset, decimal);
+	    if (ep == NULL || *ep != '\0')
+		sudo_fatalx(U_("invalid time offset %s"), optarg);
+	    skip_to_offset = true;
+	    break;
 	case 'R':
 	    resize = false;
 	    break;
@@ -316,6 +326,8 @@ main(int argc, char *argv[])
     /* Check for offset in @sec.nsec form at the end of the id. */
     id = argv[0];
     if ((cp = strchr(id, '@')) != NULL) {
+	if (skip_to_offset)
+	    usage();
 	ep = iolog_parse_delay(cp + 1, &offset, decimal);
 	if (ep == NULL || *ep != '\0')
 	    sudo_fatalx(U_("invalid time offset %s"), cp + 1);
@@ -359,6 +371,10 @@ main(int argc, char *argv[])
 	    iolog_fd_to_name(IOFD_TIMING));
     }
 
+    /* Start at the closest index checkpoint when jumping to an offset. */
+    if (skip_to_offset)
+	index_seek(iolog_dir_fd, iolog_dir, &offset);
+
     /* Parse log file. */
     if ((evlog = iolog_parse_loginfo(iolog_dir_fd, iolog_dir)) == NULL)
 	goto done;
@@ -736,6 +752,38 @@ iolog_complete(struct replay_closure *closure)
     debug_return_bool(true);
 }
 
+/*
+ * Skip over the current timing record without displaying it.
+ * Window size changes are still applied.
+ * Returns true on success, false on error.
+ */
+static bool
+skip_timing_record(struct replay_closure *closure)
+{
+    struct timing_closure *timing = &closure->timing;
+    debug_decl(skip_timing_record, SUDO_DEBUG_UTIL);
+
+    switch (timing->event) {
+    case IO_EVENT_WINSIZE:
+	resize_terminal(timing->u.winsize.lines, timing->u.winsize.cols);
+	break;
+    case IO_EVENT_SUSPEND:
+	break;
+    default:
+	if (timing->event < IOFD_TIMING && iolog_files[timing->event].enabled) {
+	    if (iolog_seek(&iolog_files[timing->event],
+		    (off_t)timing->u.nbytes, SEEK_CUR) == -1) {
+		sudo_warn(U_("%s/%s: unable to seek forward %zu"),
+		    closure->iolog_dir, iolog_fd_to_name(timing->event),
+		    timing->u.nbytes);
+		debug_return_bool(false);
+	    }
+	}
+	break;
+    }
+    debug_return_bool(true);
+}
+
 /*
  * Read the next record from the timing file and schedule a delay
  * event with the specified timeout.
@@ -754,6 +802,7 @@ get_timing_record(struct replay_closure *closure)
 	nodelay = true;
     }
 
+again:
     switch (iolog_read_timing_record(&iolog_files[IOFD_TIMING], timing)) {
     case -1:
 	/* error */
@@ -780,6 +829,15 @@ get_timing_record(struct replay_closure *closure)
 	    closure->iobuf.toread = timing->u.nbytes;
 	}
 
+	/* When jumping to the offset, records before it are not displayed. */
+	if (skip_to_offset && sudo_timespecisset(closure->offset) &&
+		sudo_timespeccmp(&timing->delay, closure->offset, <)) {
+	    sudo_timespecsub(closure->offset, &timing->delay, closure->offset);
+	    if (!skip_timing_record(closure))
+		debug_return_int(-1);
+	    goto again;
+	}
+
 	if (sudo_timespecisset(closure->offset)) {
 	    if (sudo_timespeccmp(&timing->delay, closure->offset, >)) {
 		sudo_timespecsub(&timing->delay, closure->offset, &timing->delay);
@@ -1057,6 +1115,33 @@ bad:
     debug_return_ptr(NULL);
 }
 
+/*
+ * If the I/O log has an index, position the log files at the last
+ * checkpoint at or before offset and subtract its time from offset.
+ */
+static void
+index_seek(int iolog_dir_fd, const char *iolog_dir, struct timespec *offset)
+{
+    const struct iolog_index_entry *entry;
+    struct iolog_index idx;
+    debug_decl(index_seek, SUDO_DEBUG_UTIL);
+
+    if (!iolog_index_load(&idx, iolog_dir_fd))
+	debug_return;
+    entry = iolog_index_find(&idx, offset);
+    if (entry != NULL) {
+	if (!iolog_index_seek(entry, iolog_files)) {
+	    sudo_fatal(U_("%s/%s: unable to seek to [%lld, %ld]"), iolog_dir,
+		"index", (long long)entry->elapsed.tv_sec,
+		entry->elapsed.tv_nsec);
+	}
+	sudo_timespecsub(offset, &entry->elapsed, offset);
+    }
+    iolog_index_close(&idx, NULL);
+
+    debug_return;
+}
+
 static int
 replay_session(int iolog_dir_fd, const char *iolog_dir, struct timespec *offset,
     struct timespec *max_delay, const char *decimal, bool interactive,
@@ -1494,7 +1579,7 @@ find_sessions(const char *dir, regex_t *re, const char *user, const char *tty)
     if (d == NULL)
 	sudo_fatal(U_("unable to open %s"), dir);
 
-    /* XXX - would be faster to use openat() and relative names */
+    /* Session names are checked relative to the directory. */
     sdlen = strlcpy(pathbuf, dir, sizeof(pathbuf));
     if (sdlen + 1 >= sizeof(pathbuf)) {
 	errno = ENAMETOOLONG;
@@ -1533,7 +1618,6 @@ find_sessions(const char *dir, regex_t *re, const char *user, const char *tty)
 	    sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
 	sessions_len++;
     }
-    closedir(d);
 
     /* Sort and list the sessions. */
     if (sessions != NULL) {
@@ -1548,24 +1632,105 @@ find_sessions(const char *dir, regex_t *re, const char *user, const char *tty)
 	    free(sessions[i]);
 
 	    /* Check for dir with a log file. */
-	    if (lstat(pathbuf, &sb) == 0 && S_ISREG(sb.st_mode)) {
+	    if (fstatat(dirfd(d), &pathbuf[sdlen], &sb,
+		    AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(sb.st_mode)) {
 		pathbuf[sdlen + (size_t)len - 4] = '\0';
 		list_session(&lbuf, pathbuf, re, user, tty);
 	    } else {
 		/* Strip off "/log" and recurse if a non-log dir. */
 		pathbuf[sdlen + (size_t)len - 4] = '\0';
-		if (checked_type ||
-		    (lstat(pathbuf, &sb) == 0 && S_ISDIR(sb.st_mode)))
+		if (checked_type || (fstatat(dirfd(d), &pathbuf[sdlen], &sb,
+			AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(sb.st_mode)))
 		    find_sessions(pathbuf, re, user, tty);
 	    }
 	}
 	free(sessions);
     }
+    closedir(d);
     sudo_lbuf_destroy(&lbuf);
 
     debug_return_int(0);
 }
 
+/*
+ * List the sessions in the catalog that match the search expression.
+ * Only the log files of matching sessions need to be read.
+ * Returns false if there is no catalog in dir.
+ */
+static bool
+find_sessions_catalog(const char *dir, regex_t *re, const char *user,
+    const char *tty)
+{
+    struct eventlog evlog;
+    struct sudo_lbuf lbuf;
+    size_t bufsize = 0, sessions_len = 0, sessions_size = 0;
+    size_t i;
+    char pathbuf[PATH_MAX], *buf = NULL, **sessions = NULL;
+    FILE *fp;
+    int len, rc;
+    debug_decl(find_sessions_catalog, SUDO_DEBUG_UTIL);
+
+    len = snprintf(pathbuf, sizeof(pathbuf), "%s/catalog", dir);
+    if (len < 0 || (size_t)len >= sizeof(pathbuf)) {
+	errno = ENAMETOOLONG;
+	sudo_fatal("%s/catalog", dir);
+    }
+    if ((fp = fopen(pathbuf, "r")) == NULL) {
+	if (errno != ENOENT)
+	    sudo_warn(U_("unable to open %s"), pathbuf);
+	debug_return_bool(false);
+    }
+
+    while ((rc = iolog_catalog_read(fp, &buf, &bufsize, &evlog)) != 0) {
+	if (rc == -1) {
+	    if (ferror(fp))
+		sudo_fatal(U_("unable to read %s"), pathbuf);
+	    /* Skip malformed or partially-written records. */
+	    continue;
+	}
+
+	/* The catalog has every field the search expression can use. */
+	if (!STAILQ_EMPTY(&search_expr) && !match_expr(&search_expr, &evlog, true))
+	    continue;
+
+	if (sessions_len + 1 > sessions_size) {
+	    if (sessions_size == 0)
+		sessions_size = 36 * 36 / 2;
+	    sessions = reallocarray(sessions, sessions_size, 2 * sizeof(char *));
+	    if (sessions == NULL)
+		sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    sessions_size *= 2;
+	}
+	if ((sessions[sessions_len] = strdup(evlog.iolog_file)) == NULL)
+	    sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	sessions_len++;
+    }
+    free(buf);
+    fclose(fp);
+
+    /* Sort and list the sessions, the log file has the full details. */
+    if (sessions != NULL) {
+	sudo_lbuf_init(&lbuf, NULL, 0, NULL, 0);
+	qsort(sessions, sessions_len, sizeof(char *), session_compare);
+	for (i = 0; i < sessions_len; i++) {
+	    if (i > 0 && strcmp(sessions[i], sessions[i - 1]) == 0)
+		continue;
+	    len = snprintf(pathbuf, sizeof(pathbuf), "%s/%s", dir, sessions[i]);
+	    if (len < 0 || (size_t)len >= sizeof(pathbuf)) {
+		errno = ENAMETOOLONG;
+		sudo_fatal("%s/%s", dir, sessions[i]);
+	    }
+	    list_session(&lbuf, pathbuf, re, user, tty);
+	}
+	for (i = 0; i < sessions_len; i++)
+	    free(sessions[i]);
+	free(sessions);
+	sudo_lbuf_destroy(&lbuf);
+    }
+
+    debug_return_bool(true);
+}
+
 /* XXX - always returns 0, calls sudo_fatal() on failure */
 static int
 list_sessions(int argc, char **argv, const char *pattern, const char *user,
@@ -1587,6 +1752,9 @@ list_sessions(int argc, char **argv, const char *pattern, const char *user,
 	}
     }
 
+    /* Use the session catalog if there is one, else search the tree. */
+    if (find_sessions_catalog(session_dir, re, user, tty))
+	debug_return_int(0);
     debug_return_int(find_sessions(session_dir, re, user, tty));
 }
 
@@ -1674,7 +1842,7 @@ read_keyboard(int fd, int what, void *v)
 static void
 display_usage(FILE *fp)
 {
-    fprintf(fp, "usage: %s [-hnRS] [-d dir] [-m num] [-s num] ID\n",
+    fprintf(fp, "usage: %s [-hnRS] [-d dir] [-m num] [-o offset] [-s num] ID\n",
 	getprogname());
     fprintf(fp, "usage: %s [-h] [-d dir] -l [search expression]\n",
 	getprogname());
@@ -1699,6 +1867,7 @@ help(void)
 	"  -l, --list             list available session IDs, with optional expression\n"
 	"  -m, --max-wait=num     max number of seconds to wait between events\n"
 	"  -n, --non-interactive  no prompts, session is sent to the standard output\n"
+	"  -o, --offset=time      skip to the specified time offset in the session\n"
 	"  -R, --no-resize        do not attempt to re-size the terminal\n"
 	"  -S, --suspend-wait     wait while the command was suspended\n"
 	"  -s, --speed=num        speed up or slow down output\n"
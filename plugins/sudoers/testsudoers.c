@@ -40,6 +40,8 @@
 #endif /* HAVE_STRINGS_H */
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+#include <time.h>
 
 #include <testsudoers_pwutil.h>
 #include <toke.h>
@@ -94,6 +96,7 @@ main(int argc, char *argv[])
     const char *host = NULL;
     const char *errstr;
     int ch, dflag, exitcode = EXIT_FAILURE;
+    unsigned int iterations = 0;
     unsigned int validated;
     int status = FOUND;
     int pwflag = 0;
@@ -127,8 +130,14 @@ main(int argc, char *argv[])
     dflag = 0;
     grfile = pwfile = shells = NULL;
     test_ctx.mode = MODE_RUN;
-    while ((ch = getopt(argc, argv, "+D:dg:G:h:i:L:lP:p:R:S:T:tu:U:v")) != -1) {
+    while ((ch = getopt(argc, argv, "+b:D:dg:G:h:i:L:lP:p:R:S:T:tu:U:v")) != -1) {
 	switch (ch) {
+	    case 'b':
+		iterations = (unsigned int)sudo_strtonum(optarg, 1, UINT_MAX,
+		    &errstr);
+		if (errstr != NULL)
+		    sudo_fatalx("iterations %s: %s", optarg, errstr);
+		break;
 	    case 'D':
 		test_ctx.runas.cwd = optarg;
 		break;
@@ -381,6 +390,22 @@ main(int argc, char *argv[])
     validated = sudoers_lookup(&snl, &test_ctx, now, cb_lookup, NULL,
 	&status, pwflag);
 
+    /* Compare the time taken by indexed and unindexed lookups. */
+    if (iterations != 0 && pwflag == 0) {
+	struct timespec unindexed, indexed;
+
+	if (!sudoers_lookup_timing(&snl, &test_ctx, now, iterations,
+		&unindexed, &indexed)) {
+	    SET(validated, VALIDATE_ERROR);
+	} else {
+	    printf("\nLookup time for %u iterations:\n", iterations);
+	    printf("    unindexed: %lld.%06ld seconds\n",
+		(long long)unindexed.tv_sec, unindexed.tv_nsec / 1000);
+	    printf("    indexed:   %lld.%06ld seconds\n",
+		(long long)indexed.tv_sec, indexed.tv_nsec / 1000);
+	}
+    }
+
     /* Validate user-specified chroot or cwd (if any) and runas user shell. */
     if (ISSET(validated, VALIDATE_SUCCESS)) {
 	if (!user_shell_valid(test_ctx.runas.pw)) {
@@ -758,6 +783,6 @@ testsudoers_error(const char *buf)
 sudo_noreturn static void
 usage(void)
 {
-    (void) fprintf(stderr, "usage: %s [-dltv] [-G sudoers_gid] [-g group] [-h host] [-i input_format] [-L list_user] [-P grfile] [-p pwfile] [-S shells] [-U sudoers_uid] [-u user] <user> <command> [args]\n", getprogname());
+    (void) fprintf(stderr, "usage: %s [-dltv] [-b iterations] [-G sudoers_gid] [-g group] [-h host] [-i input_format] [-L list_user] [-P grfile] [-p pwfile] [-S shells] [-U sudoers_uid] [-u user] <user> <command> [args]\n", getprogname());
     exit(EXIT_FAILURE);
 }
@@ -18,6 +18,7 @@
 
 #include <config.h>
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <stddef.h>
@@ -50,6 +51,11 @@
  * access to create new records.  This is a short-term lock and sudo
  * should not sleep while holding it (or the user will not be able to sudo).
  * The TS_LOCKEXCL entry must be unlocked before locking the actual record.
+ *
+ * The TS_LOCKEXCL record is followed by a hash table of records which
+ * is mapped into memory so a record can be found without reading the
+ * entire file.  Time stamp files in the older linear format are converted
+ * when they are first locked.
  */
 
 struct ts_cookie {
@@ -58,9 +64,16 @@ struct ts_cookie {
     int fd;
     bool locked;
     off_t pos;
+    void *map;				/* mapped header and hash table */
+    size_t maplen;
+    unsigned int nslots;
+    struct timestamp_entry *slots;	/* hash table in map */
     struct timestamp_entry key;
 };
 
+/* File offset of a hash table slot, the header occupies the first record. */
+#define TS_SLOT_POS(_n)	((off_t)((_n) + 1) * (off_t)sizeof(struct timestamp_entry))
+
 static uid_t timestamp_uid = ROOT_UID;
 static gid_t timestamp_gid = ROOT_GID;
 
@@ -461,6 +474,362 @@ ts_init_key_nonglobal(const struct sudoers_context *ctx,
 	def_timestamp_type == ppid ? ppid : tty);
 }
 
+/*
+ * Returns the number of hash table slots if hdr is the lock record
+ * of an indexed time stamp file, else 0.
+ */
+static unsigned int
+ts_index_nslots(const struct timestamp_entry *hdr)
+{
+    struct timestamp_index_header ih;
+    debug_decl(ts_index_nslots, SUDOERS_DEBUG_AUTH);
+
+    if (hdr->version != TS_VERSION || hdr->size != sizeof(*hdr) ||
+	    hdr->type != TS_LOCKEXCL || !ISSET(hdr->flags, TS_INDEXED))
+	debug_return_uint(0);
+    memcpy(&ih, hdr, sizeof(ih));
+    if (ih.nslots == 0 || ih.nslots > TS_INDEX_MAXSLOTS) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "invalid number of hash slots %u", ih.nslots);
+	debug_return_uint(0);
+    }
+    debug_return_uint(ih.nslots);
+}
+
+/*
+ * Hash the fields of a time stamp record that ts_match_record() compares
+ * for equality.  The sid, start time and time stamp are not included.
+ */
+static unsigned int
+ts_index_hash(const struct timestamp_entry *key, unsigned int nslots)
+{
+    uint64_t val = 0;
+    unsigned int h = 2166136261U;
+
+    h = (h ^ key->type) * 16777619U;
+    h = (h ^ (unsigned int)key->auth_uid) * 16777619U;
+    switch (key->type) {
+    case TS_TTY:
+	val = (uint64_t)key->u.ttydev;
+	break;
+    case TS_PPID:
+	val = (uint64_t)key->u.ppid;
+	break;
+    }
+    h = (h ^ (unsigned int)(val & 0xffffffff)) * 16777619U;
+    h = (h ^ (unsigned int)(val >> 32)) * 16777619U;
+    return h % nslots;
+}
+
+/*
+ * Returns true if the record in the specified slot may be replaced
+ * by key.  That is the case for a corrupt record or one for the same
+ * tty or parent process left over from a previous login session, as
+ * long as it is not currently locked by another process.
+ */
+static bool
+ts_slot_reusable(struct ts_cookie *cookie, const struct timestamp_entry *key,
+    const struct timestamp_entry *entry, unsigned int slot)
+{
+    debug_decl(ts_slot_reusable, SUDOERS_DEBUG_AUTH);
+
+    if (entry->version == TS_VERSION && entry->size == sizeof(*entry)) {
+	if (entry->type != key->type || entry->auth_uid != key->auth_uid)
+	    debug_return_bool(false);
+	switch (entry->type) {
+	case TS_TTY:
+	    if (entry->u.ttydev != key->u.ttydev)
+		debug_return_bool(false);
+	    break;
+	case TS_PPID:
+	    if (entry->u.ppid != key->u.ppid)
+		debug_return_bool(false);
+	    break;
+	default:
+	    debug_return_bool(false);
+	}
+	/* Same tty or ppid, the start time must not have matched. */
+    }
+
+    /* Make sure no one is using the record. */
+    if (lseek(cookie->fd, TS_SLOT_POS(slot), SEEK_SET) == -1)
+	debug_return_bool(false);
+    if (!sudo_lock_region(cookie->fd, SUDO_TLOCK, sizeof(*entry)))
+	debug_return_bool(false);
+    (void)sudo_lock_region(cookie->fd, SUDO_UNLOCK, sizeof(*entry));
+
+    sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+	"reusing stale time stamp record in slot %u", slot);
+    debug_return_bool(true);
+}
+
+/*
+ * Search the hash table for a record that matches key.
+ * On success, sets found to true and returns the matching slot.
+ * Otherwise, sets found to false and returns the slot where a
+ * new record may be stored or -1 if the hash table is full.
+ */
+static long
+ts_index_lookup(struct ts_cookie *cookie, struct timestamp_entry *key,
+    bool *found)
+{
+    unsigned int i, slot, maxprobe;
+    long avail = -1;
+    debug_decl(ts_index_lookup, SUDOERS_DEBUG_AUTH);
+
+    *found = false;
+    maxprobe = MIN(cookie->nslots, TS_INDEX_MAXPROBE);
+    slot = ts_index_hash(key, cookie->nslots);
+    for (i = 0; i < maxprobe; i++) {
+	struct timestamp_entry *entry = &cookie->slots[slot];
+
+	if (entry->version == 0 && entry->size == 0) {
+	    /* Unused slot, the key is not in the table. */
+	    if (avail == -1)
+		avail = (long)slot;
+	    break;
+	}
+	if (ts_match_record(key, entry, slot + 1)) {
+	    *found = true;
+	    debug_return_long((long)slot);
+	}
+	if (avail == -1 && ts_slot_reusable(cookie, key, entry, slot))
+	    avail = (long)slot;
+	if (++slot == cookie->nslots)
+	    slot = 0;
+    }
+    debug_return_long(avail);
+}
+
+/*
+ * Find the record matching key in an indexed time stamp file,
+ * adding it if necessary.  Records that do not fit in the hash
+ * table are stored after it.
+ * Returns true on success, filling in the record's file position.
+ */
+static bool
+ts_index_find(struct ts_cookie *cookie, struct timestamp_entry *key,
+    off_t *posp)
+{
+    const char *what = key->type == TS_GLOBAL ? "global" :
+	key->type == TS_PPID ? "ppid" : "tty";
+    struct timestamp_entry entry;
+    bool found;
+    off_t pos;
+    long slot;
+    debug_decl(ts_index_find, SUDOERS_DEBUG_AUTH);
+
+    slot = ts_index_lookup(cookie, key, &found);
+    if (slot != -1) {
+	if (found) {
+	    sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+		"found existing %s time stamp record in slot %ld", what, slot);
+	} else {
+	    sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+		"adding new %s time stamp record in slot %ld", what, slot);
+	    memcpy(&cookie->slots[slot], key, sizeof(*key));
+	}
+	*posp = TS_SLOT_POS(slot);
+	debug_return_bool(true);
+    }
+
+    /* Hash table is full, fall back on a linear search after it. */
+    if (lseek(cookie->fd, (off_t)cookie->maplen, SEEK_SET) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	    "unable to seek to %zu", cookie->maplen);
+	debug_return_bool(false);
+    }
+    if (ts_find_record(cookie->fd, key, &entry)) {
+	sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+	    "found existing %s time stamp record", what);
+	pos = lseek(cookie->fd, 0, SEEK_CUR) - (off_t)entry.size;
+    } else {
+	sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+	    "appending new %s time stamp record", what);
+	pos = lseek(cookie->fd, 0, SEEK_CUR);
+	if (ts_write(cookie->ctx, cookie->fd, cookie->fname, key, -1) == -1)
+	    debug_return_bool(false);
+    }
+    *posp = pos;
+    debug_return_bool(true);
+}
+
+/*
+ * Extend the time stamp file to len bytes by writing zeros.
+ * The blocks must be allocated before the file is mapped, storing
+ * to a hole in a mapped file on a full file system raises SIGBUS.
+ * Returns true on success, else false.
+ */
+static bool
+ts_index_extend(struct ts_cookie *cookie, off_t old_eof, off_t len)
+{
+    char zeros[4096];
+    ssize_t nwritten;
+    off_t pos = old_eof;
+    size_t todo;
+    debug_decl(ts_index_extend, SUDOERS_DEBUG_AUTH);
+
+    memset(zeros, 0, sizeof(zeros));
+    while (pos < len) {
+	todo = MIN(sizeof(zeros), (size_t)(len - pos));
+	nwritten = pwrite(cookie->fd, zeros, todo, pos);
+	if (nwritten <= 0) {
+	    log_warning(cookie->ctx, SLOG_SEND_MAIL,
+		N_("unable to write to %s"), cookie->fname);
+	    /* Don't leave a partial hash table behind. */
+	    if (ftruncate(cookie->fd, old_eof) != 0) {
+		sudo_warn(U_("unable to truncate time stamp file to %lld bytes"),
+		    (long long)old_eof);
+	    }
+	    debug_return_bool(false);
+	}
+	pos += nwritten;
+    }
+    debug_return_bool(true);
+}
+
+/*
+ * Map the header and hash table of an indexed time stamp file,
+ * extending the file if it is too short.
+ * Returns true on success, else false.
+ */
+static bool
+ts_index_map(struct ts_cookie *cookie, unsigned int nslots)
+{
+    size_t maplen = ((size_t)nslots + 1) * sizeof(struct timestamp_entry);
+    struct stat sb;
+    void *map;
+    debug_decl(ts_index_map, SUDOERS_DEBUG_AUTH);
+
+    if (fstat(cookie->fd, &sb) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	    "unable to stat %s", cookie->fname);
+	debug_return_bool(false);
+    }
+    if (sb.st_size < (off_t)maplen) {
+	if (!ts_index_extend(cookie, sb.st_size, (off_t)maplen))
+	    debug_return_bool(false);
+    }
+    map = mmap(NULL, maplen, PROT_READ|PROT_WRITE, MAP_SHARED, cookie->fd, 0);
+    if (map == MAP_FAILED) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	    "unable to map %s", cookie->fname);
+	debug_return_bool(false);
+    }
+    cookie->map = map;
+    cookie->maplen = maplen;
+    cookie->nslots = nslots;
+    cookie->slots = (struct timestamp_entry *)map + 1;
+
+    debug_return_bool(true);
+}
+
+/*
+ * Truncate the time stamp file and write the header of an empty
+ * indexed time stamp file, then map it.
+ * Returns true on success, else false.
+ */
+static bool
+ts_index_create(struct ts_cookie *cookie)
+{
+    struct timestamp_index_header ih;
+    struct timestamp_entry hdr;
+    debug_decl(ts_index_create, SUDOERS_DEBUG_AUTH);
+
+    if (ftruncate(cookie->fd, 0) != 0) {
+	sudo_warn(U_("unable to truncate time stamp file to %lld bytes"),
+	    0LL);
+	debug_return_bool(false);
+    }
+    memset(&ih, 0, sizeof(ih));
+    ih.version = TS_VERSION;
+    ih.size = sizeof(struct timestamp_entry);
+    ih.type = TS_LOCKEXCL;
+    ih.flags = TS_INDEXED;
+    ih.nslots = TS_INDEX_SLOTS;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(&hdr, &ih, sizeof(ih));
+    if (ts_write(cookie->ctx, cookie->fd, cookie->fname, &hdr, 0) == -1)
+	debug_return_bool(false);
+
+    debug_return_bool(ts_index_map(cookie, TS_INDEX_SLOTS));
+}
+
+/*
+ * Convert a time stamp file in the linear format used by older versions
+ * of sudo to an indexed one.  Only current version records are kept.
+ * Returns true on success, else false.
+ */
+static bool
+ts_index_convert(struct ts_cookie *cookie)
+{
+    struct timestamp_entry entry, *records = NULL;
+    size_t i, nrecords = 0, maxrecords = 0;
+    bool found, ret = false;
+    long slot;
+    debug_decl(ts_index_convert, SUDOERS_DEBUG_AUTH);
+
+    if (lseek(cookie->fd, 0, SEEK_SET) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	    "unable to rewind fd");
+	debug_return_bool(false);
+    }
+    while (read(cookie->fd, &entry, sizeof(entry)) == sizeof(entry)) {
+	if (entry.size != sizeof(entry)) {
+	    /* wrong size, seek to start of next record */
+	    if (entry.size == 0)
+		break;
+	    if (lseek(cookie->fd, (off_t)entry.size - (off_t)sizeof(entry),
+		    SEEK_CUR) == -1)
+		break;
+	    continue;
+	}
+	if (entry.version != TS_VERSION)
+	    continue;
+	if (entry.type != TS_GLOBAL && entry.type != TS_TTY &&
+		entry.type != TS_PPID)
+	    continue;
+	if (nrecords == maxrecords) {
+	    struct timestamp_entry *tmp;
+
+	    tmp = reallocarray(records, maxrecords + 32, sizeof(*records));
+	    if (tmp == NULL) {
+		sudo_warnx(U_("%s: %s"), __func__,
+		    U_("unable to allocate memory"));
+		goto done;
+	    }
+	    records = tmp;
+	    maxrecords += 32;
+	}
+	records[nrecords++] = entry;
+    }
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"converting %zu records to indexed format", nrecords);
+
+    if (!ts_index_create(cookie))
+	goto done;
+    for (i = 0; i < nrecords; i++) {
+	slot = ts_index_lookup(cookie, &records[i], &found);
+	if (found)
+	    continue;
+	if (slot != -1) {
+	    memcpy(&cookie->slots[slot], &records[i], sizeof(records[i]));
+	    continue;
+	}
+	/* No room in the hash table, append it. */
+	if (lseek(cookie->fd, 0, SEEK_END) == -1)
+	    goto done;
+	if (ts_write(cookie->ctx, cookie->fd, cookie->fname, &records[i],
+		-1) == -1)
+	    goto done;
+    }
+    ret = true;
+
+done:
+    free(records);
+    debug_return_bool(ret);
+}
+
 /*
  * Open the user's time stamp file.
  * Returns a cookie or NULL on error, does not lock the file.
@@ -545,6 +914,10 @@ timestamp_open(const struct sudoers_context *ctx)
     cookie->fd = fd;
     cookie->fname = fname;
     cookie->pos = -1;
+    cookie->map = NULL;
+    cookie->maplen = 0;
+    cookie->nslots = 0;
+    cookie->slots = NULL;
 
     close(dfd);
     debug_return_ptr(cookie);
@@ -646,8 +1019,13 @@ ts_read(struct ts_cookie *cookie, struct timestamp_entry *entry)
 	should_unlock = true;
     }
 
-    /* Seek to the record position and read it.  */
-    nread = pread(cookie->fd, entry, sizeof(*entry), cookie->pos);
+    /* Copy the record from the hash table or read it from the file. */
+    if (cookie->pos < (off_t)cookie->maplen) {
+	memcpy(entry, (char *)cookie->map + cookie->pos, sizeof(*entry));
+	nread = sizeof(*entry);
+    } else {
+	nread = pread(cookie->fd, entry, sizeof(*entry), cookie->pos);
+    }
     if (nread != sizeof(*entry)) {
 	/* short read, should not happen */
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
@@ -667,22 +1045,22 @@ done:
 }
 
 /*
- * Write a TS_LOCKEXCL record at the beginning of the time stamp file.
+ * Write the record at the cookie's position, either to the
+ * hash table or the file.  The record must already be locked.
  */
 static bool
-timestamp_lock_write(struct ts_cookie *cookie)
+ts_write_record(struct ts_cookie *cookie, struct timestamp_entry *entry)
 {
-    struct timestamp_entry entry;
-    bool ret = true;
-    debug_decl(timestamp_lock_write, SUDOERS_DEBUG_AUTH);
-
-    memset(&entry, 0, sizeof(entry));
-    entry.version = TS_VERSION;
-    entry.size = sizeof(entry);
-    entry.type = TS_LOCKEXCL;
-    if (ts_write(cookie->ctx, cookie->fd, cookie->fname, &entry, -1) == -1)
-	ret = false;
-    debug_return_bool(ret);
+    debug_decl(ts_write_record, SUDOERS_DEBUG_AUTH);
+
+    if (cookie->pos < (off_t)cookie->maplen) {
+	memcpy((char *)cookie->map + cookie->pos, entry, sizeof(*entry));
+	debug_return_bool(true);
+    }
+    if (ts_write(cookie->ctx, cookie->fd, cookie->fname, entry,
+	    cookie->pos) == -1)
+	debug_return_bool(false);
+    debug_return_bool(true);
 }
 
 /*
@@ -694,7 +1072,7 @@ timestamp_lock(void *vcookie, struct passwd *pw)
 {
     struct ts_cookie *cookie = vcookie;
     struct timestamp_entry entry;
-    bool overwrite = false;
+    unsigned int nslots;
     off_t lock_pos;
     ssize_t nread;
     debug_decl(timestamp_lock, SUDOERS_DEBUG_AUTH);
@@ -707,70 +1085,44 @@ timestamp_lock(void *vcookie, struct passwd *pw)
 
     /*
      * Take a lock on the "write" record (the first record in the file).
-     * This will let us seek for the record or extend as needed
+     * This will let us search for the record or add one as needed
      * without colliding with anyone else.
      */
     if (!timestamp_lock_record(cookie->fd, 0, sizeof(struct timestamp_entry)))
 	debug_return_bool(false);
 
-    /* Make sure the first record is of type TS_LOCKEXCL. */
-    memset(&entry, 0, sizeof(entry));
-    nread = read(cookie->fd, &entry, sizeof(entry));
-    if (nread < ssizeof(struct timestamp_entry_v1)) {
-	/* New or invalid time stamp file. */
-	overwrite = true;
-    } else if (entry.type != TS_LOCKEXCL) {
-	if (entry.size == sizeof(struct timestamp_entry_v1)) {
-	    /* Old sudo record, convert it to TS_LOCKEXCL. */
-	    entry.type = TS_LOCKEXCL;
-	    memset((char *)&entry + offsetof(struct timestamp_entry, flags), 0,
-		(size_t)nread - offsetof(struct timestamp_entry, flags));
-	    if (ts_write(cookie->ctx, cookie->fd, cookie->fname, &entry, 0) == -1)
+    /* Make sure the file starts with the header of an indexed file. */
+    if (cookie->map == NULL) {
+	memset(&entry, 0, sizeof(entry));
+	nread = read(cookie->fd, &entry, sizeof(entry));
+	if (nread == ssizeof(entry) && (nslots = ts_index_nslots(&entry)) != 0) {
+	    if (!ts_index_map(cookie, nslots))
+		debug_return_bool(false);
+	} else if (nread >= ssizeof(struct timestamp_entry_v1) &&
+		(entry.type == TS_LOCKEXCL ||
+		entry.size == sizeof(struct timestamp_entry_v1))) {
+	    /* Time stamp file from an older sudo, convert it. */
+	    if (!ts_index_convert(cookie))
 		debug_return_bool(false);
 	} else {
-	    /* Corrupted time stamp file?  Just overwrite it. */
-	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
-		"corrupt initial record, type: %hu, size: %hu (expected %zu)",
-		entry.type, entry.size, sizeof(struct timestamp_entry_v1));
-	    overwrite = true;
-	}
-    }
-    if (overwrite) {
-	/* Rewrite existing time stamp file or create new one. */
-	if (ftruncate(cookie->fd, 0) != 0) {
-	    sudo_warn(U_("unable to truncate time stamp file to %lld bytes"),
-		0LL);
-	    debug_return_bool(false);
-	}
-	if (!timestamp_lock_write(cookie))
-	    debug_return_bool(false);
-    } else if (entry.size != sizeof(entry)) {
-	/* Reset position if the lock record has an unexpected size. */
-	if (lseek(cookie->fd, entry.size, SEEK_SET) == -1) {
-	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
-		"unable to seek to %hu", entry.size);
-	    debug_return_bool(false);
+	    /* New or corrupted time stamp file, just overwrite it. */
+	    if (nread > 0) {
+		sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		    "corrupt initial record, type: %hu, size: %hu (expected %zu)",
+		    entry.type, entry.size, sizeof(entry));
+	    }
+	    if (!ts_index_create(cookie))
+		debug_return_bool(false);
 	}
     }
 
-    /* Search for a tty/ppid-based record or append a new one. */
+    /* Search for a tty/ppid-based record or add a new one. */
     sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
 	"searching for %s time stamp record",
 	def_timestamp_type == ppid ? "ppid" : "tty");
     ts_init_key_nonglobal(cookie->ctx, &cookie->key, pw, TS_DISABLED);
-    if (ts_find_record(cookie->fd, &cookie->key, &entry)) {
-	sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
-	    "found existing %s time stamp record",
-	    def_timestamp_type == ppid ? "ppid" : "tty");
-	lock_pos = lseek(cookie->fd, 0, SEEK_CUR) - (off_t)entry.size;
-    } else {
-	sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
-	    "appending new %s time stamp record",
-	    def_timestamp_type == ppid ? "ppid" : "tty");
-	lock_pos = lseek(cookie->fd, 0, SEEK_CUR);
-	if (ts_write(cookie->ctx, cookie->fd, cookie->fname, &cookie->key, -1) == -1)
-	    debug_return_bool(false);
-    }
+    if (!ts_index_find(cookie, &cookie->key, &lock_pos))
+	debug_return_bool(false);
     sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
 	"%s time stamp position is %lld",
 	def_timestamp_type == ppid ? "ppid" : "tty", (long long)lock_pos);
@@ -782,23 +1134,8 @@ timestamp_lock(void *vcookie, struct passwd *pw)
 	 */
 	cookie->locked = false;
 	cookie->key.type = TS_GLOBAL;	/* find a global record */
-
-	if (lseek(cookie->fd, 0, SEEK_SET) == -1) {
-	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
-		"unable to rewind fd");
+	if (!ts_index_find(cookie, &cookie->key, &cookie->pos))
 	    debug_return_bool(false);
-	}
-	if (ts_find_record(cookie->fd, &cookie->key, &entry)) {
-	    sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
-		"found existing global record");
-	    cookie->pos = lseek(cookie->fd, 0, SEEK_CUR) - (off_t)entry.size;
-	} else {
-	    sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
-		"appending new global record");
-	    cookie->pos = lseek(cookie->fd, 0, SEEK_CUR);
-	    if (ts_write(cookie->ctx, cookie->fd, cookie->fname, &cookie->key, -1) == -1)
-		debug_return_bool(false);
-	}
     } else {
 	/* For tty/ppid tickets the tty lock is the same as the record lock. */
 	cookie->pos = lock_pos;
@@ -822,6 +1159,8 @@ timestamp_close(void *vcookie)
     debug_decl(timestamp_close, SUDOERS_DEBUG_AUTH);
 
     if (cookie != NULL) {
+	if (cookie->map != NULL)
+	    munmap(cookie->map, cookie->maplen);
 	close(cookie->fd);
 	free(cookie->fname);
 	free(cookie);
@@ -938,7 +1277,7 @@ timestamp_status(void *vcookie, struct passwd *pw)
 		N_("ignoring time stamp from the future"));
 	    status = TS_OLD;
 	    SET(entry.flags, TS_DISABLED);
-	    (void)ts_write(cookie->ctx, cookie->fd, cookie->fname, &entry, cookie->pos);
+	    (void)ts_write_record(cookie, &entry);
 	}
 #else
 	/*
@@ -962,7 +1301,7 @@ timestamp_status(void *vcookie, struct passwd *pw)
 		4 + ctime(&tv_sec));
 	    status = TS_OLD;
 	    SET(entry.flags, TS_DISABLED);
-	    (void)ts_write(cookie->ctx, cookie->fd, cookie->fname, &entry, cookie->pos);
+	    (void)ts_write_record(cookie, &entry);
 	}
 #endif /* CLOCK_MONOTONIC */
     } else {
@@ -1024,8 +1363,7 @@ timestamp_update(void *vcookie, struct passwd *pw)
     sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
 	"writing %zu byte record at %lld", sizeof(cookie->key),
 	(long long)cookie->pos);
-    if (ts_write(cookie->ctx, cookie->fd, cookie->fname, &cookie->key, cookie->pos) != -1)
-	ret = true;
+    ret = ts_write_record(cookie, &cookie->key);
 
 done:
     debug_return_bool(ret);
@@ -1040,6 +1378,8 @@ int
 timestamp_remove(const struct sudoers_context *ctx, bool unlink_it)
 {
     struct timestamp_entry key, entry;
+    struct ts_cookie cookie;
+    unsigned int i, nslots;
     int len, pass, dfd = -1, fd = -1, ret = true;
     char uidstr[STRLEN_MAX_UNSIGNED(uid_t) + 1];
     char *fname = NULL;
@@ -1099,6 +1439,20 @@ timestamp_remove(const struct sudoers_context *ctx, bool unlink_it)
 	goto done;
     }
 
+    /* Map the hash table of an indexed file, if present. */
+    memset(&cookie, 0, sizeof(cookie));
+    cookie.ctx = ctx;
+    cookie.fd = fd;
+    cookie.fname = fname;
+    if (pread(fd, &entry, sizeof(entry), 0) == ssizeof(entry)) {
+	if ((nslots = ts_index_nslots(&entry)) != 0) {
+	    if (!ts_index_map(&cookie, nslots)) {
+		ret = -1;
+		goto done;
+	    }
+	}
+    }
+
     /*
      * Find matching timestamp entries and invalidate them.
      * We do 3 passes to invalidate all possible timestamp entries
@@ -1116,7 +1470,17 @@ timestamp_remove(const struct sudoers_context *ctx, bool unlink_it)
 	    ts_init_key(ctx, &key, NULL, 0, global);
 	    break;
 	}
-	if (lseek(fd, 0, SEEK_SET) == -1) {
+	for (i = 0; i < cookie.nslots; i++) {
+	    struct timestamp_entry *slot = &cookie.slots[i];
+
+	    if (slot->size == 0 || ISSET(slot->flags, TS_DISABLED))
+		continue;
+	    if (ts_match_record(&key, slot, i + 1))
+		SET(slot->flags, TS_DISABLED);
+	}
+
+	/* Search the linear file or the overflow records. */
+	if (lseek(fd, (off_t)cookie.maplen, SEEK_SET) == -1) {
 	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
 		"unable to rewind timestamp fd");
 	    break;
@@ -1132,6 +1496,8 @@ timestamp_remove(const struct sudoers_context *ctx, bool unlink_it)
 	    }
 	}
     }
+    if (cookie.map != NULL)
+	munmap(cookie.map, cookie.maplen);
 
 done:
     if (dfd != -1)
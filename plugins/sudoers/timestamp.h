@@ -56,6 +56,26 @@ struct getpass_closure {
 /* Time stamp flags */
 #define TS_DISABLED		0x01U	/* entry disabled */
 #define TS_ANYUID		0x02U	/* ignore uid, only valid in the key */
+#define TS_INDEXED		0x04U	/* lock record of an indexed file */
+
+/*
+ * An indexed time stamp file starts with a TS_LOCKEXCL record that has
+ * the TS_INDEXED flag set, followed by a hash table of nslots records
+ * keyed by record type, auth uid and tty or ppid.  Unused slots are
+ * zero-filled.  Records that do not fit in the hash table are appended
+ * after it, as in the older linear format.
+ */
+#define TS_INDEX_SLOTS		1024	/* hash slots in a new file */
+#define TS_INDEX_MAXSLOTS	65536	/* sanity check when reading */
+#define TS_INDEX_MAXPROBE	32	/* max slots searched per lookup */
+
+struct timestamp_index_header {
+    unsigned short version;	/* TS_VERSION */
+    unsigned short size;	/* sizeof(struct timestamp_entry) */
+    unsigned short type;	/* TS_LOCKEXCL */
+    unsigned short flags;	/* TS_INDEXED */
+    unsigned int nslots;	/* number of hash table slots */
+};
 
 struct timestamp_entry_v1 {
     unsigned short version;	/* version number */
@@ -6113,6 +6113,13 @@ push_include_int(const char *opath, const char *host, bool isdir,
 	    status = sudo_secure_fd(fd, S_IFDIR, sudoers_file_uid(),
 		sudoers_file_gid(), &sb);
 	}
+	if (status == SUDO_PATH_SECURE) {
+	    /* Adding or removing files changes the dir's mtime. */
+	    sudoers_cache_add_source(dname, fd);
+	} else {
+	    /* Cannot detect when a missing include dir is created. */
+	    sudoers_cache_track(false);
+	}
 	if (fd != -1)
 	    close(fd); /* XXX use in read_dir_files? */
 	if (status != SUDO_PATH_SECURE) {
@@ -6166,7 +6173,10 @@ push_include_int(const char *opath, const char *host, bool isdir,
 	    /* The file and path and the same for sudoers.d files. */
 	    file = path;
 	    sudo_rcstr_addref(file);
-	} while ((fp = open_sudoers(file, NULL, false, &keepopen)) == NULL);
+	    fp = open_sudoers(file, NULL, false, &keepopen);
+	    if (fp == NULL)
+		sudoers_cache_add_skipped(file);
+	} while (fp == NULL);
     } else {
 	if ((fp = open_sudoers(path, &file, true, &keepopen)) == NULL) {
 	    /* The error was already printed by open_sudoers() */
@@ -6175,6 +6185,7 @@ push_include_int(const char *opath, const char *host, bool isdir,
 	    debug_return_bool(false);
 	}
     }
+    sudoers_cache_add_source(file, fileno(fp));
     /*
      * Push the old (current) file and open the new one.
      * We use the existing refs of sudoers and sudoers_search_path.
@@ -6232,6 +6243,7 @@ pop_include(void)
 	SLIST_REMOVE_HEAD(&istack[idepth - 1].more, entries);
 	fp = open_sudoers(pl->path, NULL, false, &keepopen);
 	if (fp != NULL) {
+	    sudoers_cache_add_source(pl->path, fileno(fp));
 	    sudolinebuf.len = sudolinebuf.off = 0;
 	    sudolinebuf.toke_start = sudolinebuf.toke_end = 0;
 	    sudo_rcstr_delref(sudoers);
@@ -6245,6 +6257,7 @@ pop_include(void)
 	    break;
 	}
 	/* Unable to open path in include dir, go to next one. */
+	sudoers_cache_add_skipped(pl->path);
 	sudo_rcstr_delref(pl->path);
 	free(pl);
     }
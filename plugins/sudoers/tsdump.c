@@ -145,6 +145,10 @@ main(int argc, char *argv[])
 	if (nread < 0)
 	    sudo_fatal(U_("unable to read %s"), fname);
 
+	/* Skip unused hash table slots in an indexed file. */
+	if (cur.common.version == 0 && cur.common.size == 0)
+	    continue;
+
 	valid = valid_entry(&cur, pos);
 	if (cur.common.size != 0 && cur.common.size != sizeof(cur)) {
 	    off_t offset = (off_t)cur.common.size - (off_t)sizeof(cur);
@@ -230,6 +234,11 @@ print_flags(unsigned int flags)
 	CLR(flags, TS_ANYUID);
 	first = false;
     }
+    if (ISSET(flags, TS_INDEXED)) {
+	printf("%sTS_INDEXED", first ? "" : ", ");
+	CLR(flags, TS_INDEXED);
+	first = false;
+    }
     if (flags != 0)
 	printf("%s0x%x", first ? "" : ", ", flags);
     putchar('\n');
@@ -290,6 +299,14 @@ dump_entry(struct timestamp_entry *entry, off_t pos)
     printf("size: %hu\n", entry->size);
     printf("type: %s\n", type2string(entry->type));
     print_flags(entry->flags);
+    if (entry->type == TS_LOCKEXCL && ISSET(entry->flags, TS_INDEXED)) {
+	struct timestamp_index_header ih;
+
+	memcpy(&ih, entry, sizeof(ih));
+	printf("hash slots: %u\n", ih.nslots);
+	putchar('\n');
+	debug_return;
+    }
     printf("auth uid: %u\n", (unsigned int)entry->auth_uid);
     printf("session ID: %d\n", (int)entry->sid);
     if (sudo_timespecisset(&entry->start_time))
@@ -92,6 +92,7 @@ static int print_unused(struct sudoers_parse_tree *, struct alias *, void *);
 static bool reparse_sudoers(struct sudoers_context *ctx, char *, int, char **);
 static int run_command(const char *, char *const *);
 static void parse_sudoers_options(struct sudoers_context *ctx);
+static void update_sudoers_cache(struct sudoers_context *ctx);
 static void setup_signals(void);
 static void visudo_cleanup(void);
 sudo_noreturn static void export_sudoers(const char *infile, const char *outfile);
@@ -105,6 +106,7 @@ static const char *path_sudoers = _PATH_SUDOERS;
 static struct sudoersfile_list sudoerslist = TAILQ_HEAD_INITIALIZER(sudoerslist);
 static bool checkonly;
 static bool edit_includes = true;
+static bool update_cache;
 static unsigned int errors;
 static const char short_opts[] =  "cf:hIOPqsVx:";
 static struct option long_opts[] = {
@@ -241,6 +243,9 @@ main(int argc, char *argv[])
 	/* Check/set owner and mode for installed sudoers file. */
 	use_owner = true;
 	use_perms = true;
+
+	/* Only the installed sudoers file is cached. */
+	update_cache = ctx.parser_conf.sudoers_cache != NULL;
     }
 
     if (export_path != NULL) {
@@ -325,6 +330,8 @@ main(int argc, char *argv[])
 		exitcode = 1;
 	    }
 	}
+	if (exitcode == 0 && update_cache)
+	    update_sudoers_cache(&ctx);
     } else {
 	/* Remove temporary files. */
 	visudo_cleanup();
@@ -1024,6 +1031,11 @@ check_syntax(struct sudoers_context *ctx, const char *path, bool check_owner,
 		close(fd);
 	    goto done;
 	}
+	if (update_cache) {
+	    /* Record the files we parse for the sudoers cache. */
+	    sudoers_cache_track(true);
+	    sudoers_cache_add_source(fname, fd);
+	}
     }
     init_parser(ctx, fname);
     sudoers_setlocale(SUDOERS_LOCALE_SUDOERS, &oldlocale);
@@ -1059,11 +1071,46 @@ check_syntax(struct sudoers_context *ctx, const char *path, bool check_owner,
 	    }
 	}
     }
+    if (ok && update_cache) {
+	if (!sudoers_cache_write(ctx, ctx->parser_conf.sudoers_cache,
+		&parsed_policy)) {
+	    sudo_warnx(U_("unable to update sudoers cache %s"),
+		ctx->parser_conf.sudoers_cache);
+	}
+    }
+    sudoers_cache_track(false);
 
 done:
     debug_return_bool(ok);
 }
 
+/*
+ * Rebuild the sudoers cache from the newly-installed sudoers file(s).
+ * The original files may have been replaced so we start from scratch.
+ */
+static void
+update_sudoers_cache(struct sudoers_context *ctx)
+{
+    struct sudoersfile *sp;
+    debug_decl(update_sudoers_cache, SUDOERS_DEBUG_UTIL);
+
+    while ((sp = TAILQ_FIRST(&sudoerslist)) != NULL) {
+	TAILQ_REMOVE(&sudoerslist, sp, entries);
+	if (sp->fd != -1)
+	    close(sp->fd);
+	free(sp->opath);
+	free(sp->dpath);
+	free(sp->tpath);
+	free(sp);
+    }
+
+    checkonly = true;
+    ctx->parser_conf.verbose = 0;
+    (void)check_syntax(ctx, path_sudoers, false, false);
+
+    debug_return;
+}
+
 static bool
 lock_sudoers(struct sudoersfile *entry)
 {
@@ -1294,6 +1341,11 @@ parse_sudoers_options(struct sudoers_context *ctx)
 		    path_sudoers = *cur + sizeof("sudoers_file=") - 1;
 		    continue;
 		}
+		if (MATCHES(*cur, "sudoers_cache=")) {
+		    ctx->parser_conf.sudoers_cache =
+			*cur + sizeof("sudoers_cache=") - 1;
+		    continue;
+		}
 		if (MATCHES(*cur, "sudoers_uid=")) {
 		    p = *cur + sizeof("sudoers_uid=") - 1;
 		    id = sudo_strtoid(p, &errstr);
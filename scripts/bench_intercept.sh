@@ -0,0 +1,137 @@
+#!/bin/sh
+#
+# Measure the overhead of intercept mode on a parallel build.
+#
+# A Makefile is generated in a temporary directory with a number of
+# targets, each of which runs a shell that executes a number of
+# short-lived commands.  The build is timed when run directly and
+# when run via sudo, the difference is the cost of the policy checks.
+# For the second run, sudoers must enable intercept for make (and sh
+# when using -s), for example:
+#
+#     Defaults!/usr/bin/make intercept, intercept_type=dso
+#
+# GNU make uses posix_spawn(3) when available, which is not intercepted
+# by sudo_intercept.so.  Use a make built with --disable-posix-spawn or
+# use the -s option to run the jobs in waves from a shell script instead.
+# The -e option exports additional 64-byte environment variables to the
+# jobs to measure the cost of reading a large environment for each exec.
+# All files are stored in a temporary directory that is removed on exit.
+#
+# Usage: bench_intercept.sh [-c commands] [-e envvars] [-j jobs]
+#                           [-n samples] [-s] [-t targets]
+#
+# Example:
+# ./scripts/bench_intercept.sh -j 8 -t 500
+
+COMMANDS=5
+ENVVARS=0
+JOBS=8
+SAMPLES=3
+TARGETS=200
+USE_SH=false
+MAKE=${MAKE:-make}
+SUDO=${SUDO:-sudo}
+TRUE=${TRUE:-/bin/true}
+
+usage() {
+    echo "usage: $0 [-c commands] [-e envvars] [-j jobs] [-n samples] [-s] [-t targets]" 1>&2
+    exit 1
+}
+
+while getopts c:e:j:n:st: ch; do
+    case "$ch" in
+    c)	COMMANDS="$OPTARG";;
+    e)	ENVVARS="$OPTARG";;
+    j)	JOBS="$OPTARG";;
+    n)	SAMPLES="$OPTARG";;
+    s)	USE_SH=true;;
+    t)	TARGETS="$OPTARG";;
+    *)	usage;;
+    esac
+done
+shift `expr $OPTIND - 1`
+if [ $# -ne 0 ]; then
+    usage
+fi
+
+TMPDIR=`mktemp -d "${TMPDIR:-/tmp}/bench_intercept.XXXXXX"` || exit 1
+trap 'rm -rf "$TMPDIR"' 0
+trap 'exit 1' 1 2 15
+
+# Current time in milliseconds.
+now() {
+    date +%s%N | sed 's/......$//'
+}
+
+# Each target runs COMMANDS copies of TRUE from a single shell.
+recipe="$TRUE"
+i=1
+while [ $i -lt $COMMANDS ]; do
+    recipe="$recipe && $TRUE"
+    i=`expr $i + 1`
+done
+
+# The Makefile and equivalent shell script, which runs JOBS at a time.
+# Extra environment variables are exported by both since sudo resets
+# the environment of the build itself.
+echo "#!/bin/sh" > "$TMPDIR/build.sh"
+: > "$TMPDIR/Makefile.env"
+i=0
+while [ $i -lt $ENVVARS ]; do
+    value=`printf "%064d" $i`
+    echo "BENCH_ENV_$i=$value; export BENCH_ENV_$i" >> "$TMPDIR/build.sh"
+    echo "export BENCH_ENV_$i = $value" >> "$TMPDIR/Makefile.env"
+    i=`expr $i + 1`
+done
+i=0
+targets=
+while [ $i -lt $TARGETS ]; do
+    targets="$targets t$i"
+    echo "t$i:" >> "$TMPDIR/Makefile.in"
+    echo "	@$recipe" >> "$TMPDIR/Makefile.in"
+    echo "/bin/sh -c '$recipe' &" >> "$TMPDIR/build.sh"
+    i=`expr $i + 1`
+    if [ `expr $i % $JOBS` -eq 0 ]; then
+	echo "wait" >> "$TMPDIR/build.sh"
+    fi
+done
+echo "wait" >> "$TMPDIR/build.sh"
+cat "$TMPDIR/Makefile.env" > "$TMPDIR/Makefile"
+echo "all:$targets" >> "$TMPDIR/Makefile"
+cat "$TMPDIR/Makefile.in" >> "$TMPDIR/Makefile"
+chmod 755 "$TMPDIR/build.sh"
+
+if $USE_SH; then
+    BUILD="/bin/sh $TMPDIR/build.sh"
+else
+    BUILD="$MAKE -s -j $JOBS -f $TMPDIR/Makefile"
+fi
+
+# Run the build SAMPLES times, print the average time in milliseconds.
+run_build() {
+    total=0
+    i=0
+    while [ $i -lt $SAMPLES ]; do
+	start=`now`
+	if ! $* >/dev/null; then
+	    echo "$0: $*: build failed" 1>&2
+	    exit 1
+	fi
+	end=`now`
+	total=`expr $total + $end - $start`
+	i=`expr $i + 1`
+    done
+    expr $total / $SAMPLES
+}
+
+plain_ms=`run_build $BUILD` || exit 1
+sudo_ms=`run_build $SUDO $BUILD` || exit 1
+
+echo "$plain_ms $sudo_ms" | awk -v n=`expr $TARGETS \* \( $COMMANDS + 1 \)` '{
+    printf("plain    %8d ms\n", $1)
+    printf("sudo     %8d ms\n", $2)
+    printf("overhead %8.1f us/exec (%d execs)\n", ($2 - $1) * 1000 / n, n)
+}'
+
+exit 0
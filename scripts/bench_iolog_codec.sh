@@ -0,0 +1,116 @@
+#!/bin/sh
+#
+# Compare the CPU time and disk usage of the I/O log compression codecs.
+#
+# For each codec, a private sudo_logsrvd is started on the loopback
+# interface and sudo_sendlog is used to send an existing I/O log
+# over a number of connections.  The CPU time used by sudo_logsrvd
+# is read from /proc (Linux only) and the size of the stored logs
+# is measured with du.  The I/O logs received by the server are
+# stored in a temporary directory that is removed on exit.
+#
+# Usage: bench_iolog_codec.sh [-F] [-c "codecs ..."] [-t connections]
+#                             /path/to/iolog
+#
+# Example:
+# ./scripts/bench_iolog_codec.sh -F -t 50 /var/log/sudo-io/00/00/01
+#
+# The -F flag enables iolog_flush, which is where the codecs differ most.
+# A codec of "none" stores the logs uncompressed.
+
+CODECS="none gzip zstd lz4"
+CONNECTIONS=25
+FLUSH=false
+PORT=${PORT:-30399}
+LOGSRVD=${LOGSRVD:-sudo_logsrvd}
+SENDLOG=${SENDLOG:-sudo_sendlog}
+
+usage() {
+    echo "usage: $0 [-F] [-c \"codecs ...\"] [-t connections] /path/to/iolog" 1>&2
+    exit 1
+}
+
+while getopts Fc:t: ch; do
+    case "$ch" in
+    F)	FLUSH=true;;
+    c)	CODECS="$OPTARG";;
+    t)	CONNECTIONS="$OPTARG";;
+    *)	usage;;
+    esac
+done
+shift `expr $OPTIND - 1`
+if [ $# -ne 1 ]; then
+    usage
+fi
+IOLOG="$1"
+if [ ! -f "$IOLOG/log" ]; then
+    echo "$0: $IOLOG: not an I/O log directory" 1>&2
+    exit 1
+fi
+CLK_TCK=`getconf CLK_TCK 2>/dev/null || echo 100`
+
+TMPDIR=`mktemp -d "${TMPDIR:-/tmp}/bench_iolog_codec.XXXXXX"` || exit 1
+LOGSRVD_PID=
+cleanup() {
+    if [ -n "$LOGSRVD_PID" ]; then
+	kill "$LOGSRVD_PID" 2>/dev/null
+	wait "$LOGSRVD_PID" 2>/dev/null
+    fi
+    rm -rf "$TMPDIR"
+}
+trap cleanup 0
+trap 'exit 1' 1 2 15
+
+for codec in $CODECS; do
+    rm -rf "$TMPDIR/io"
+    if [ "$codec" = "none" ]; then
+	compress=false
+	compress_type=
+    else
+	compress=true
+	compress_type="iolog_compress_type = $codec"
+    fi
+    cat > "$TMPDIR/sudo_logsrvd.conf" <<-EOF
+	[server]
+	listen_address = 127.0.0.1:$PORT
+	pid_file =
+	server_log = stderr
+
+	[iolog]
+	iolog_dir = $TMPDIR/io
+	iolog_file = %{seq}
+	iolog_user = `id -un`
+	iolog_group = `id -gn`
+	iolog_compress = $compress
+	iolog_flush = $FLUSH
+	$compress_type
+
+	[eventlog]
+	log_type = none
+	EOF
+
+    "$LOGSRVD" -n -f "$TMPDIR/sudo_logsrvd.conf" &
+    LOGSRVD_PID=$!
+    sleep 1
+    if ! kill -0 "$LOGSRVD_PID" 2>/dev/null; then
+	echo "$0: $LOGSRVD did not start with codec $codec" 1>&2
+	LOGSRVD_PID=
+	continue
+    fi
+
+    "$SENDLOG" -h 127.0.0.1 -p $PORT -t $CONNECTIONS "$IOLOG" >/dev/null 2>&1
+
+    # Fields 14 and 15 of /proc/PID/stat are utime and stime in ticks.
+    ticks=`sed 's/.*) //' "/proc/$LOGSRVD_PID/stat" | awk '{ print $12 + $13 }'`
+    kill "$LOGSRVD_PID"
+    wait "$LOGSRVD_PID" 2>/dev/null
+    LOGSRVD_PID=
+
+    kbytes=`du -sk "$TMPDIR/io" | awk '{ print $1 }'`
+    echo "$codec $ticks $kbytes" | awk -v n=$CONNECTIONS -v hz=$CLK_TCK '{
+	printf("%-5s %8.3f ms CPU/session, %8.1f KiB/session\n",
+	    $1, $2 * 1000 / hz / n, $3 / n)
+    }'
+done
+
+exit 0
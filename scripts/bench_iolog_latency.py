@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+#
+# Measure keystroke round-trip latency through sudo with I/O logging.
+#
+# For each mode, "sudo cat" is run in raw mode on a new pseudo-terminal
+# with log_input and log_output enabled.  A single byte is written to
+# the terminal and the time until cat echoes it back is recorded.  The
+# latency distribution is printed as a histogram with percentiles.
+#
+# This script must be run as root on a system with sudo installed.
+# It temporarily replaces the sudoers Plugin lines in sudo.conf with
+# ones that use a private sudoers file; the original sudo.conf is
+# restored on exit.
+#
+# Usage: bench_iolog_latency.py [-n samples] [-d iolog_dir] [-F]
+#                               [-f flush_delay_ms] [mode ...]
+#
+# The modes are "nolog", "sync" (the default I/O logging) and "async"
+# (the iolog_async flag).  The -d option can be used to put the I/O
+# logs on a slow file system and -F sets the iolog_flush flag.
+#
+# Example:
+# ./scripts/bench_iolog_latency.py -n 2000 -F -d /mnt/nfs/sudo-io sync async
+
+import getopt
+import os
+import pty
+import select
+import shutil
+import signal
+import sys
+import tempfile
+import time
+import tty
+
+SUDO = os.environ.get("SUDO", "sudo")
+SUDOERS_PLUGIN = os.environ.get("SUDOERS_PLUGIN", "sudoers.so")
+SUDO_CONF = os.environ.get("SUDO_CONF", "/etc/sudo.conf")
+
+
+def usage():
+    sys.stderr.write("usage: %s [-n samples] [-d iolog_dir] [-F] "
+                     "[-f flush_delay_ms] [mode ...]\n" % sys.argv[0])
+    sys.exit(1)
+
+
+def write_sudoers(path, mode, iolog_dir, flush, flush_delay):
+    if mode == "nolog":
+        defaults = "!log_input, !log_output"
+    else:
+        defaults = "log_input, log_output, iolog_dir=%s, iolog_file=%%{seq}" \
+            % iolog_dir
+        if flush:
+            defaults += ", iolog_flush"
+        if mode == "async":
+            defaults += ", iolog_async, iolog_flush_delay=%d" % flush_delay
+    with open(path, "w") as f:
+        f.write("Defaults %s\nroot ALL=(ALL) NOPASSWD: ALL\n" % defaults)
+    os.chmod(path, 0o440)
+
+
+def read_byte(fd, timeout):
+    r, _, _ = select.select([fd], [], [], timeout)
+    if not r:
+        raise RuntimeError("timed out waiting for echo")
+    return os.read(fd, 1)
+
+
+def run(nsamples):
+    pid, fd = pty.fork()
+    if pid == 0:
+        os.execvp(SUDO, [SUDO, "-n", "sh", "-c",
+                         "stty raw -echo && echo ready && exec cat"])
+    try:
+        tty.setraw(fd)
+        # Wait for the command to start.
+        buf = b""
+        while not buf.endswith(b"ready\r\n") and not buf.endswith(b"ready\n"):
+            c = read_byte(fd, 10)
+            if not c:
+                raise RuntimeError("sudo exited")
+            buf += c
+        samples = []
+        for i in range(nsamples):
+            ch = bytes([ord("a") + i % 26])
+            start = time.perf_counter()
+            os.write(fd, ch)
+            if read_byte(fd, 10) != ch:
+                raise RuntimeError("unexpected echo")
+            samples.append((time.perf_counter() - start) * 1e6)
+        return samples
+    finally:
+        os.kill(pid, signal.SIGTERM)
+        try:
+            while os.read(fd, 4096):
+                pass
+        except OSError:
+            pass
+        os.waitpid(pid, 0)
+        os.close(fd)
+
+
+def report(mode, samples):
+    samples.sort()
+    n = len(samples)
+
+    def pct(p):
+        return samples[min(n - 1, int(n * p / 100))]
+
+    print("%s: %d samples, p50 %.0fus, p90 %.0fus, p99 %.0fus, max %.0fus"
+          % (mode, n, pct(50), pct(90), pct(99), samples[-1]))
+    buckets = {}
+    for s in samples:
+        b = 1
+        while b < s:
+            b *= 2
+        buckets[b] = buckets.get(b, 0) + 1
+    for b in sorted(buckets):
+        count = buckets[b]
+        print("  <= %7dus %6d %s" % (b, count, "#" * (count * 60 // n)))
+
+
+def main():
+    nsamples = 1000
+    iolog_dir = None
+    flush = False
+    flush_delay = 100
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], "d:f:Fn:")
+    except getopt.GetoptError:
+        usage()
+    for opt, val in opts:
+        if opt == "-d":
+            iolog_dir = val
+        elif opt == "-f":
+            flush_delay = int(val)
+        elif opt == "-F":
+            flush = True
+        elif opt == "-n":
+            nsamples = int(val)
+    modes = args or ["nolog", "sync", "async"]
+    for mode in modes:
+        if mode not in ("nolog", "sync", "async"):
+            usage()
+    if os.getuid() != 0:
+        sys.stderr.write("%s: must be run as root\n" % sys.argv[0])
+        sys.exit(1)
+
+    tmpdir = tempfile.mkdtemp(prefix="bench_iolog_latency.")
+    orig_conf = None
+    if os.path.exists(SUDO_CONF):
+        with open(SUDO_CONF) as f:
+            orig_conf = f.read()
+    try:
+        for mode in modes:
+            logdir = iolog_dir or os.path.join(tmpdir, "io")
+            sudoers = os.path.join(tmpdir, "sudoers." + mode)
+            write_sudoers(sudoers, mode, logdir, flush, flush_delay)
+            with open(SUDO_CONF, "w") as f:
+                for line in (orig_conf or "").splitlines():
+                    if not line.startswith("Plugin") or \
+                            "sudoers_" not in line:
+                        f.write(line + "\n")
+                f.write("Plugin sudoers_policy %s sudoers_file=%s "
+                        "sudoers_uid=0 sudoers_gid=0 sudoers_mode=0440\n"
+                        % (SUDOERS_PLUGIN, sudoers))
+                f.write("Plugin sudoers_io %s\n" % SUDOERS_PLUGIN)
+            report(mode, run(nsamples))
+    finally:
+        if orig_conf is not None:
+            with open(SUDO_CONF, "w") as f:
+                f.write(orig_conf)
+        else:
+            os.unlink(SUDO_CONF)
+        shutil.rmtree(tmpdir)
+
+
+if __name__ == "__main__":
+    main()
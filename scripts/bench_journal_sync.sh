@@ -0,0 +1,166 @@
+#!/bin/sh
+#
+# Measure the effect of journal_sync on store-and-forward relaying.
+#
+# A private sudo_logsrvd is started on the loopback interface to store
+# the logs and a second one in store_first mode relays to it.  For each
+# journal_sync_interval, sudo_sendlog is used to send an existing I/O
+# log to the relay, first over a number of concurrent connections to
+# measure throughput and then one connection at a time to measure the
+# latency of the final commit point.  An interval of "off" disables
+# journal_sync.  All files are stored in a temporary directory that is
+# removed on exit.
+#
+# Usage: bench_journal_sync.sh [-i "intervals ..."] [-m sync_max]
+#                              [-n samples] [-t connections] /path/to/iolog
+#
+# Example:
+# TMPDIR=/var/tmp ./scripts/bench_journal_sync.sh -t 200 /var/log/sudo-io/00/00/01
+#
+# Set TMPDIR to a directory on the file system to be measured,
+# syncing is much cheaper on tmpfs than on a real disk.
+
+INTERVALS="off 0 2 10 50"
+SYNC_MAX=64
+SAMPLES=20
+CONNECTIONS=100
+PORT=${PORT:-30399}
+LOGSRVD=${LOGSRVD:-sudo_logsrvd}
+SENDLOG=${SENDLOG:-sudo_sendlog}
+
+usage() {
+    echo "usage: $0 [-i \"intervals ...\"] [-m sync_max] [-n samples] [-t connections] /path/to/iolog" 1>&2
+    exit 1
+}
+
+while getopts i:m:n:t: ch; do
+    case "$ch" in
+    i)	INTERVALS="$OPTARG";;
+    m)	SYNC_MAX="$OPTARG";;
+    n)	SAMPLES="$OPTARG";;
+    t)	CONNECTIONS="$OPTARG";;
+    *)	usage;;
+    esac
+done
+shift `expr $OPTIND - 1`
+if [ $# -ne 1 ]; then
+    usage
+fi
+IOLOG="$1"
+if [ ! -f "$IOLOG/log" ]; then
+    echo "$0: $IOLOG: not an I/O log directory" 1>&2
+    exit 1
+fi
+SERVER_PORT=`expr $PORT + 1`
+
+TMPDIR=`mktemp -d "${TMPDIR:-/tmp}/bench_journal_sync.XXXXXX"` || exit 1
+SERVER_PID=
+RELAY_PID=
+stop_relay() {
+    if [ -n "$RELAY_PID" ]; then
+	kill "$RELAY_PID" 2>/dev/null
+	wait "$RELAY_PID" 2>/dev/null
+	RELAY_PID=
+    fi
+}
+cleanup() {
+    stop_relay
+    if [ -n "$SERVER_PID" ]; then
+	kill "$SERVER_PID" 2>/dev/null
+	wait "$SERVER_PID" 2>/dev/null
+    fi
+    rm -rf "$TMPDIR"
+}
+trap cleanup 0
+trap 'exit 1' 1 2 15
+
+# Current time in milliseconds.
+now() {
+    date +%s%N | sed 's/......$//'
+}
+
+cat > "$TMPDIR/server.conf" <<-EOF
+	[server]
+	listen_address = 127.0.0.1:$SERVER_PORT
+	pid_file =
+	server_log = stderr
+
+	[iolog]
+	iolog_dir = $TMPDIR/io
+	iolog_file = %{seq}
+	iolog_user = `id -un`
+	iolog_group = `id -gn`
+
+	[eventlog]
+	log_type = none
+	EOF
+
+"$LOGSRVD" -n -f "$TMPDIR/server.conf" &
+SERVER_PID=$!
+sleep 1
+if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+    echo "$0: unable to start $LOGSRVD" 1>&2
+    SERVER_PID=
+    exit 1
+fi
+
+for interval in $INTERVALS; do
+    if [ "$interval" = "off" ]; then
+	sync="journal_sync = false"
+    else
+	sync="journal_sync = true
+journal_sync_interval = $interval
+journal_sync_max = $SYNC_MAX"
+    fi
+    rm -rf "$TMPDIR/relay"
+    mkdir -p "$TMPDIR/relay/incoming" "$TMPDIR/relay/outgoing"
+    cat > "$TMPDIR/relay.conf" <<-EOF
+	[server]
+	listen_address = 127.0.0.1:$PORT
+	pid_file =
+	server_log = stderr
+
+	[relay]
+	relay_host = 127.0.0.1:$SERVER_PORT
+	relay_dir = $TMPDIR/relay
+	store_first = true
+	$sync
+
+	[eventlog]
+	log_type = none
+	EOF
+
+    "$LOGSRVD" -n -f "$TMPDIR/relay.conf" &
+    RELAY_PID=$!
+    sleep 1
+    if ! kill -0 "$RELAY_PID" 2>/dev/null; then
+	echo "$0: $LOGSRVD did not start with interval $interval" 1>&2
+	RELAY_PID=
+	continue
+    fi
+
+    # Throughput: all connections at once.
+    start=`now`
+    "$SENDLOG" -h 127.0.0.1 -p $PORT -t $CONNECTIONS "$IOLOG" >/dev/null 2>&1
+    end=`now`
+    tput_ms=`expr $end - $start`
+
+    # Latency: one connection at a time, each waits for its commit point.
+    start=`now`
+    i=0
+    while [ $i -lt $SAMPLES ]; do
+	"$SENDLOG" -h 127.0.0.1 -p $PORT "$IOLOG" >/dev/null 2>&1
+	i=`expr $i + 1`
+    done
+    end=`now`
+    lat_ms=`expr $end - $start`
+
+    stop_relay
+
+    echo "$interval $tput_ms $lat_ms" | awk -v n=$CONNECTIONS -v s=$SAMPLES '{
+	printf("%-4s %8.1f sessions/sec, %8.2f ms/session sequential\n",
+	    $1, $2 ? n * 1000 / $2 : 0, $3 / s)
+    }'
+done
+
+exit 0
@@ -0,0 +1,120 @@
+#!/bin/sh
+#
+# Measure sudo_logsrvd throughput with an increasing number of workers.
+#
+# For each worker count, a private sudo_logsrvd is started on the
+# loopback interface and sudo_sendlog is used to send an existing
+# I/O log over many concurrent connections.  The I/O logs received
+# by the server are stored in a temporary directory that is removed
+# on exit.
+#
+# Usage: bench_logsrvd.sh [-c clients] [-t connections] [-w "workers ..."]
+#                         /path/to/iolog
+#
+# Example:
+# ./scripts/bench_logsrvd.sh -c 8 -t 50 -w "1 2 4 8" /var/log/sudo-io/00/00/01
+#
+# Each of the clients runs "sudo_sendlog -t connections", so the
+# server handles clients * connections sessions per run.
+
+CLIENTS=4
+CONNECTIONS=25
+WORKERS=
+PORT=${PORT:-30399}
+LOGSRVD=${LOGSRVD:-sudo_logsrvd}
+SENDLOG=${SENDLOG:-sudo_sendlog}
+
+while getopts c:t:w: ch; do
+    case "$ch" in
+    c)	CLIENTS="$OPTARG";;
+    t)	CONNECTIONS="$OPTARG";;
+    w)	WORKERS="$OPTARG";;
+    *)	echo "usage: $0 [-c clients] [-t connections] [-w \"workers ...\"] /path/to/iolog" 1>&2
+	exit 1;;
+    esac
+done
+shift `expr $OPTIND - 1`
+if [ $# -ne 1 ]; then
+    echo "usage: $0 [-c clients] [-t connections] [-w \"workers ...\"] /path/to/iolog" 1>&2
+    exit 1
+fi
+IOLOG="$1"
+if [ ! -f "$IOLOG/log" ]; then
+    echo "$0: $IOLOG: not an I/O log directory" 1>&2
+    exit 1
+fi
+
+# Default to powers of two up to the number of CPUs.
+if [ -z "$WORKERS" ]; then
+    NCPU=`getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1`
+    n=1
+    while [ $n -lt $NCPU ]; do
+	WORKERS="$WORKERS $n"
+	n=`expr $n \* 2`
+    done
+    WORKERS="$WORKERS $NCPU"
+fi
+
+TMPDIR=`mktemp -d "${TMPDIR:-/tmp}/bench_logsrvd.XXXXXX"` || exit 1
+LOGSRVD_PID=
+cleanup() {
+    if [ -n "$LOGSRVD_PID" ]; then
+	kill "$LOGSRVD_PID" 2>/dev/null
+	wait "$LOGSRVD_PID" 2>/dev/null
+    fi
+    rm -rf "$TMPDIR"
+}
+trap cleanup 0
+trap 'exit 1' 1 2 15
+
+for w in $WORKERS; do
+    rm -rf "$TMPDIR/io"
+    cat > "$TMPDIR/sudo_logsrvd.conf" <<-EOF
+	[server]
+	listen_address = 127.0.0.1:$PORT
+	pid_file =
+	server_log = stderr
+	workers = $w
+
+	[iolog]
+	iolog_dir = $TMPDIR/io
+	iolog_file = %{seq}
+	iolog_user = `id -un`
+	iolog_group = `id -gn`
+
+	[eventlog]
+	log_type = none
+	EOF
+
+    "$LOGSRVD" -n -f "$TMPDIR/sudo_logsrvd.conf" &
+    LOGSRVD_PID=$!
+    sleep 1
+    if ! kill -0 "$LOGSRVD_PID" 2>/dev/null; then
+	echo "$0: $LOGSRVD did not start" 1>&2
+	LOGSRVD_PID=
+	exit 1
+    fi
+
+    start=`date +%s.%N`
+    pids=
+    i=0
+    while [ $i -lt $CLIENTS ]; do
+	"$SENDLOG" -h 127.0.0.1 -p $PORT -t $CONNECTIONS "$IOLOG" >/dev/null 2>&1 &
+	pids="$pids $!"
+	i=`expr $i + 1`
+    done
+    wait $pids
+    end=`date +%s.%N`
+
+    kill "$LOGSRVD_PID"
+    wait "$LOGSRVD_PID" 2>/dev/null
+    LOGSRVD_PID=
+
+    echo "$w $start $end" | awk -v n=`expr $CLIENTS \* $CONNECTIONS` '{
+	elapsed = $3 - $2
+	printf("%3d worker(s): %d sessions in %.3f seconds, %.1f sessions/sec\n",
+	    $1, n, elapsed, n / elapsed)
+    }'
+done
+
+exit 0
@@ -0,0 +1,111 @@
+#!/bin/sh
+#
+# Measure end-to-end sudo latency with and without sudo_policyd.
+#
+# This script must be run as root on a system with sudo installed.
+# It temporarily adds a policyd_socket argument to the sudoers Plugin
+# line in sudo.conf and starts sudo_policyd; the original sudo.conf
+# is restored on exit.
+#
+# Usage: bench_policyd.sh [-n iterations] [-u user] [command ...]
+#
+# Example:
+# ./scripts/bench_policyd.sh -n 5000 -u nobody /bin/true
+#
+# The user must be allowed to run the command without a password.
+
+ITERATIONS=1000
+USER=root
+SUDO=${SUDO:-sudo}
+POLICYD=${POLICYD:-sudo_policyd}
+SUDO_CONF=${SUDO_CONF:-/etc/sudo.conf}
+SUDOERS=${SUDOERS:-/etc/sudoers}
+SOCKET=${SOCKET:-/run/sudo_policyd.bench}
+
+while getopts n:u: ch; do
+    case "$ch" in
+    n)	ITERATIONS="$OPTARG";;
+    u)	USER="$OPTARG";;
+    *)	echo "usage: $0 [-n iterations] [-u user] [command ...]" 1>&2
+	exit 1;;
+    esac
+done
+shift `expr $OPTIND - 1`
+if [ $# -eq 0 ]; then
+    set -- /bin/true
+fi
+
+if [ "`id -u`" != "0" ]; then
+    echo "$0: must be run as root" 1>&2
+    exit 1
+fi
+
+TMPDIR=`mktemp -d "${TMPDIR:-/tmp}/bench_policyd.XXXXXX"` || exit 1
+POLICYD_PID=
+cleanup() {
+    if [ -n "$POLICYD_PID" ]; then
+	kill "$POLICYD_PID" 2>/dev/null
+    fi
+    if [ -f "$TMPDIR/sudo.conf.orig" ]; then
+	cp -p "$TMPDIR/sudo.conf.orig" "$SUDO_CONF"
+    elif [ -f "$TMPDIR/sudo.conf.none" ]; then
+	rm -f "$SUDO_CONF"
+    fi
+    rm -f "$SOCKET"
+    rm -rf "$TMPDIR"
+}
+trap cleanup 0
+trap 'exit 1' 1 2 15
+
+if [ -f "$SUDO_CONF" ]; then
+    cp -p "$SUDO_CONF" "$TMPDIR/sudo.conf.orig" || exit 1
+    grep -v '^Plugin[ 	][ 	]*sudoers_policy' "$SUDO_CONF" > "$TMPDIR/sudo.conf"
+else
+    : > "$TMPDIR/sudo.conf.none"
+    : > "$TMPDIR/sudo.conf"
+fi
+
+# Run the command ITERATIONS times via sudo, printing the elapsed time.
+run() {
+    start=`date +%s.%N`
+    i=0
+    while [ $i -lt $ITERATIONS ]; do
+	su "$USER" -s /bin/sh -c "$SUDO -n $*" </dev/null >/dev/null 2>&1 || {
+	    echo "$0: sudo -n $* failed for $USER" 1>&2
+	    exit 1
+	}
+	i=`expr $i + 1`
+    done
+    end=`date +%s.%N`
+    echo "$start $end $ITERATIONS" | awk '{
+	elapsed = $2 - $1
+	printf("%.3f seconds, %.3f ms per command\n", elapsed,
+	    elapsed * 1000 / $3)
+    }'
+}
+
+# Baseline: sudoers is parsed by every sudo invocation.
+cp "$TMPDIR/sudo.conf" "$SUDO_CONF"
+echo "Plugin sudoers_policy sudoers.so" >> "$SUDO_CONF"
+printf "in-process (%d iterations): " "$ITERATIONS"
+run "$@"
+
+# With the policy daemon.
+rm -f "$SOCKET"
+"$POLICYD" -n -f "$SUDOERS" -s "$SOCKET" &
+POLICYD_PID=$!
+i=0
+while [ ! -S "$SOCKET" ]; do
+    i=`expr $i + 1`
+    if [ $i -gt 50 ]; then
+	echo "$0: $POLICYD did not start" 1>&2
+	exit 1
+    fi
+    sleep 0.1
+done
+cp "$TMPDIR/sudo.conf" "$SUDO_CONF"
+echo "Plugin sudoers_policy sudoers.so policyd_socket=$SOCKET" >> "$SUDO_CONF"
+printf "sudo_policyd (%d iterations): " "$ITERATIONS"
+run "$@"
+
+exit 0
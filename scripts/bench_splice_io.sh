@@ -0,0 +1,104 @@
+#!/bin/sh
+#
+# Measure the cost of logging a command's output when it is sent
+# to a pipe, with and without the sudo.conf splice_io setting.
+#
+# This script must be run as root on a system with sudo installed.
+# It temporarily replaces the sudoers Plugin lines in sudo.conf with
+# ones that use a private sudoers file which enables output logging
+# to a temporary directory; the original sudo.conf is restored on exit.
+#
+# Usage: bench_splice_io.sh [-n iterations] [-s size_in_mb]
+#
+# Example:
+# ./scripts/bench_splice_io.sh -n 10 -s 512
+
+ITERATIONS=5
+SIZE=256
+SUDO=${SUDO:-sudo}
+SUDOERS_PLUGIN=${SUDOERS_PLUGIN:-sudoers.so}
+SUDO_CONF=${SUDO_CONF:-/etc/sudo.conf}
+
+while getopts n:s: ch; do
+    case "$ch" in
+    n)	ITERATIONS="$OPTARG";;
+    s)	SIZE="$OPTARG";;
+    *)	echo "usage: $0 [-n iterations] [-s size_in_mb]" 1>&2
+	exit 1;;
+    esac
+done
+shift `expr $OPTIND - 1`
+
+if [ "`id -u`" != "0" ]; then
+    echo "$0: must be run as root" 1>&2
+    exit 1
+fi
+
+TMPDIR=`mktemp -d "${TMPDIR:-/tmp}/bench_splice_io.XXXXXX"` || exit 1
+cleanup() {
+    if [ -f "$TMPDIR/sudo.conf.orig" ]; then
+	cp -p "$TMPDIR/sudo.conf.orig" "$SUDO_CONF"
+    elif [ -f "$TMPDIR/sudo.conf.none" ]; then
+	rm -f "$SUDO_CONF"
+    fi
+    rm -rf "$TMPDIR"
+}
+trap cleanup 0
+trap 'exit 1' 1 2 15
+
+if [ -f "$SUDO_CONF" ]; then
+    cp -p "$SUDO_CONF" "$TMPDIR/sudo.conf.orig" || exit 1
+    grep -v -e '^Plugin[ 	][ 	]*sudoers_' -e '^Set[ 	][ 	]*splice_io' \
+	"$SUDO_CONF" > "$TMPDIR/sudo.conf"
+else
+    : > "$TMPDIR/sudo.conf.none"
+    : > "$TMPDIR/sudo.conf"
+fi
+
+dd if=/dev/zero of="$TMPDIR/data" bs=1048576 count="$SIZE" 2>/dev/null || exit 1
+mkdir -m 0700 "$TMPDIR/io" || exit 1
+for log in nolog log; do
+    if [ "$log" = "log" ]; then
+	defaults="log_output, iolog_dir=$TMPDIR/io, iolog_file=%{seq}"
+    else
+	defaults="!log_output"
+    fi
+    cat > "$TMPDIR/sudoers.$log" <<-EOF
+	Defaults $defaults
+	root ALL=(ALL) NOPASSWD: ALL
+	EOF
+    chmod 0440 "$TMPDIR/sudoers.$log"
+done
+
+# Run "cat data" via sudo ITERATIONS times, printing the throughput.
+run() {
+    cp "$TMPDIR/sudo.conf" "$SUDO_CONF"
+    echo "Set splice_io $2" >> "$SUDO_CONF"
+    echo "Plugin sudoers_policy $SUDOERS_PLUGIN sudoers_file=$TMPDIR/sudoers.$1 sudoers_uid=0 sudoers_gid=0 sudoers_mode=0440" >> "$SUDO_CONF"
+    echo "Plugin sudoers_io $SUDOERS_PLUGIN" >> "$SUDO_CONF"
+
+    start=`date +%s.%N`
+    i=0
+    while [ $i -lt $ITERATIONS ]; do
+	$SUDO -n cat "$TMPDIR/data" </dev/null | cat >/dev/null || {
+	    echo "$0: sudo -n cat failed" 1>&2
+	    exit 1
+	}
+	rm -rf "$TMPDIR/io/"*
+	i=`expr $i + 1`
+    done
+    end=`date +%s.%N`
+    echo "$start $end $ITERATIONS $SIZE" | awk '{
+	elapsed = $2 - $1
+	printf("%.3f seconds, %.1f MB/s\n", elapsed, $3 * $4 / elapsed)
+    }'
+}
+
+printf "no logging (%d x %d MB): " "$ITERATIONS" "$SIZE"
+run nolog false
+printf "log_output, splice_io false (%d x %d MB): " "$ITERATIONS" "$SIZE"
+run log false
+printf "log_output, splice_io true (%d x %d MB): " "$ITERATIONS" "$SIZE"
+run log true
+
+exit 0
@@ -86,6 +86,9 @@ exec_setup(struct command_details *details, int intercept_fd, int errfd)
     if (ISSET(details->flags, CD_USE_PTRACE)) {
 	if (!set_exec_filter())
 	    goto done;
+    } else if (ISSET(details->flags, CD_USE_SECCOMP)) {
+	if (!set_exec_notify_filter(intercept_fd))
+	    goto done;
     }
 #endif /* HAVE_PTRACE_INTERCEPT */
 
@@ -385,7 +388,9 @@ direct_exec_allowed(const struct command_details *details)
 	debug_return_bool(false);
     if (ISSET(details->flags, CD_RBAC_ENABLED|CD_SET_TIMEOUT|CD_SUDOEDIT))
 	debug_return_bool(false);
-    if (ISSET(details->flags, CD_INTERCEPT|CD_LOG_SUBCMDS|CD_USE_PTRACE))
+    if (ISSET(details->flags, CD_INTERCEPT|CD_LOG_SUBCMDS))
+	debug_return_bool(false);
+    if (ISSET(details->flags, CD_USE_PTRACE|CD_USE_SECCOMP))
 	debug_return_bool(false);
 
     TAILQ_FOREACH(plugin, &audit_plugins, entries) {
@@ -100,7 +100,7 @@ sudo_execve(int fd, const char *path, char *const argv[], char *envp[],
     if (ISSET(flags, CD_NOEXEC))
 	envp = disable_execute(envp, sudo_conf_noexec_path());
     if (ISSET(flags, CD_INTERCEPT|CD_LOG_SUBCMDS)) {
-	if (!ISSET(flags, CD_USE_PTRACE)) {
+	if (!ISSET(flags, CD_USE_PTRACE|CD_USE_SECCOMP)) {
 	    envp = enable_intercept(envp, sudo_conf_intercept_path(),
 		intercept_fd);
 	}
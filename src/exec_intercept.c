@@ -18,7 +18,9 @@
 
 #include <config.h>
 
+#include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
@@ -45,8 +47,11 @@
 #ifdef _PATH_SUDO_INTERCEPT
 static union sudo_token_un intercept_token;
 static in_port_t intercept_listen_port;
+static int intercept_channel[2] = { -1, -1 };
 static struct intercept_closure *accept_closure;
+static struct intercept_closure *channel_closure;
 static void intercept_accept_cb(int fd, int what, void *v);
+static void intercept_channel_cb(int fd, int what, void *v);
 static void intercept_cb(int fd, int what, void *v);
 
 /*
@@ -87,6 +92,55 @@ enable_write_event(int fd, sudo_ev_callback_t callback,
 	INVALID_STATE, callback, closure);
 }
 
+/*
+ * Allocate a new intercept closure that uses the specified event base.
+ */
+static struct intercept_closure *
+intercept_closure_alloc(struct sudo_event_base *evbase,
+    const struct command_details *details)
+{
+    struct intercept_closure *closure;
+    debug_decl(intercept_closure_alloc, SUDO_DEBUG_EXEC);
+
+    closure = calloc(1, sizeof(*closure));
+    if (closure == NULL) {
+	sudo_warnx("%s", U_("unable to allocate memory"));
+	debug_return_ptr(NULL);
+    }
+    closure->details = details;
+    closure->listen_sock = -1;
+    sudo_ev_set_base(&closure->ev, evbase);
+
+    debug_return_ptr(closure);
+}
+
+/*
+ * Create an intercept closure for a new connection from sudo_intercept.so
+ * and register a read event for it in the specified state.
+ */
+static struct intercept_closure *
+intercept_connection_setup(int fd, struct sudo_event_base *evbase,
+    const struct command_details *details, enum intercept_state state,
+    sudo_ev_callback_t callback, bool pass_channel)
+{
+    struct intercept_closure *closure;
+    debug_decl(intercept_connection_setup, SUDO_DEBUG_EXEC);
+
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"intercept fd %d, state %d", fd, state);
+
+    closure = intercept_closure_alloc(evbase, details);
+    if (closure == NULL)
+	debug_return_ptr(NULL);
+    closure->pass_channel = pass_channel;
+    if (!enable_read_event(fd, state, callback, closure)) {
+	free(closure);
+	debug_return_ptr(NULL);
+    }
+
+    debug_return_ptr(closure);
+}
+
 /*
  * Create an intercept closure.
  * Returns an opaque pointer to the closure, which is also
@@ -102,20 +156,18 @@ intercept_setup(int fd, struct sudo_event_base *evbase,
     sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
 	"intercept fd %d\n", fd);
 
-    closure = calloc(1, sizeof(*closure));
-    if (closure == NULL) {
-	sudo_warnx("%s", U_("unable to allocate memory"));
+    closure = intercept_closure_alloc(evbase, details);
+    if (closure == NULL)
 	goto bad;
-    }
-    closure->details = details;
-    closure->listen_sock = -1;
-    sudo_ev_set_base(&closure->ev, evbase);
 
-    if (ISSET(details->flags, CD_USE_PTRACE)) {
+    if (details->intercept_cache_timeout > 0)
+	intercept_cache_init(details->intercept_cache_timeout);
+
+    if (ISSET(details->flags, CD_USE_PTRACE|CD_USE_SECCOMP)) {
 	/*
 	 * We can perform a policy check immediately using ptrace(2)
-	 * but should ignore the execve(2) of the initial command
-	 * (and sesh for SELinux RBAC).
+	 * or seccomp(2) but should ignore the execve(2) of the initial
+	 * command (and sesh for SELinux RBAC).
 	 */
 	closure->state = RECV_POLICY_CHECK;
 	closure->initial_command = 1;
@@ -128,6 +180,7 @@ intercept_setup(int fd, struct sudo_event_base *evbase,
 	 */
 	const int new_state = sudo_token_isset(intercept_token) ?
 	    RECV_SECRET : RECV_HELLO_INITIAL;
+	closure->pass_channel = true;
 	if (!enable_read_event(fd, new_state, intercept_cb, closure))
 	    goto bad;
     }
@@ -140,19 +193,14 @@ bad:
 }
 
 /*
- * Reset intercept_closure so it can be reused.
+ * Free the results of the previous policy check, if any.
  */
-void
-intercept_closure_reset(struct intercept_closure *closure)
+static void
+intercept_closure_clear(struct intercept_closure *closure)
 {
     size_t n;
-    debug_decl(intercept_closure_reset, SUDO_DEBUG_EXEC);
+    debug_decl(intercept_closure_clear, SUDO_DEBUG_EXEC);
 
-    if (closure->listen_sock != -1) {
-	close(closure->listen_sock);
-	closure->listen_sock = -1;
-    }
-    free(closure->buf);
     free(closure->command);
     if (closure->run_argv != NULL) {
 	for (n = 0; closure->run_argv[n] != NULL; n++)
@@ -168,6 +216,24 @@ intercept_closure_reset(struct intercept_closure *closure)
     closure->command = NULL;
     closure->run_argv = NULL;
     closure->run_envp = NULL;
+
+    debug_return;
+}
+
+/*
+ * Reset intercept_closure so it can be reused.
+ */
+void
+intercept_closure_reset(struct intercept_closure *closure)
+{
+    debug_decl(intercept_closure_reset, SUDO_DEBUG_EXEC);
+
+    if (closure->listen_sock != -1) {
+	close(closure->listen_sock);
+	closure->listen_sock = -1;
+    }
+    free(closure->buf);
+    intercept_closure_clear(closure);
     closure->buf = NULL;
     closure->len = 0;
     closure->off = 0;
@@ -199,12 +265,23 @@ intercept_cleanup(struct exec_closure *ec)
 {
     debug_decl(intercept_cleanup, SUDO_DEBUG_EXEC);
 
+    intercept_cache_free();
+    if (channel_closure != NULL) {
+	intercept_connection_close(channel_closure);
+	channel_closure = NULL;
+	intercept_channel[0] = -1;
+    }
+    if (intercept_channel[1] != -1) {
+	close(intercept_channel[1]);
+	intercept_channel[1] = -1;
+    }
     if (accept_closure != NULL) {
 	/* DSO-based intercept. */
 	intercept_connection_close(accept_closure);
 	accept_closure = NULL;
     } else if (ec->intercept != NULL) {
-	/* ptrace-based intercept. */
+	/* ptrace or seccomp-based intercept. */
+	exec_seccomp_cleanup();
 	intercept_closure_reset(ec->intercept);
 	free(ec->intercept);
 	ec->intercept = NULL;
@@ -213,6 +290,39 @@ intercept_cleanup(struct exec_closure *ec)
     debug_return;
 }
 
+/*
+ * Create the channel sudo_intercept.so uses to pass us new connections.
+ * The client end is sent along with each HelloResponse and is inherited
+ * (via fork, not exec) by the command's descendants.  This avoids a
+ * TCP connection and token exchange for each execve(2); the listener
+ * is still used when the channel is not available.
+ * Sets intercept_channel as a side effect.
+ */
+static bool
+prepare_channel(void)
+{
+#ifdef SCM_RIGHTS
+    int flags;
+    debug_decl(prepare_channel, SUDO_DEBUG_EXEC);
+
+    if (socketpair(PF_UNIX, SOCK_DGRAM, 0, intercept_channel) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	    "%s: unable to create socketpair", __func__);
+	intercept_channel[0] = intercept_channel[1] = -1;
+	debug_return_bool(false);
+    }
+    (void)fcntl(intercept_channel[0], F_SETFD, FD_CLOEXEC);
+    (void)fcntl(intercept_channel[1], F_SETFD, FD_CLOEXEC);
+    flags = fcntl(intercept_channel[0], F_GETFL, 0);
+    if (flags != -1)
+	(void)fcntl(intercept_channel[0], F_SETFL, flags | O_NONBLOCK);
+
+    debug_return_bool(true);
+#else
+    return false;
+#endif /* SCM_RIGHTS */
+}
+
 /*
  * Prepare to listen on localhost using an ephemeral port.
  * Sets intercept_token and intercept_listen_port as side effects.
@@ -258,6 +368,9 @@ prepare_listener(struct intercept_closure *closure)
     sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
 	"%s: listening on port %hu", __func__, intercept_listen_port);
 
+    /* Not fatal, clients fall back to the listener. */
+    (void)prepare_channel();
+
     debug_return_bool(true);
 
 bad:
@@ -415,13 +528,23 @@ intercept_check_policy(const char *command, int argc, char **argv, int envc,
     }
 
     if (ISSET(closure->details->flags, CD_INTERCEPT)) {
-	/* We don't currently have a good way to validate the environment. */
-	sudo_debug_set_active_instance(policy_plugin.debug_instance);
-	rc = policy_plugin.u.policy->check_policy(argc, argv, NULL,
-	    &command_info, &run_argv, &user_env_out, &closure->errstr);
-	sudo_debug_set_active_instance(sudo_debug_instance);
-	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
-	    "check_policy returns %d", rc);
+	/* Reuse a previous decision for the same (unchanged) command. */
+	if (intercept_cache_lookup(command, &sb, argc, argv, runcwd,
+		&command_info, &run_argv)) {
+	    rc = 1;
+	} else {
+	    /* We don't currently have a good way to validate the environment. */
+	    sudo_debug_set_active_instance(policy_plugin.debug_instance);
+	    rc = policy_plugin.u.policy->check_policy(argc, argv, NULL,
+		&command_info, &run_argv, &user_env_out, &closure->errstr);
+	    sudo_debug_set_active_instance(sudo_debug_instance);
+	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+		"check_policy returns %d", rc);
+	    if (rc == 1) {
+		intercept_cache_store(command, &sb, argc, argv, runcwd,
+		    command_info, run_argv);
+	    }
+	}
 
 	switch (rc) {
 	case 1:
@@ -559,6 +682,9 @@ intercept_check_policy_req(PolicyCheckRequest *req,
     size_t n;
     debug_decl(intercept_check_policy_req, SUDO_DEBUG_EXEC);
 
+    /* The connection may be reused for more than one policy check. */
+    intercept_closure_clear(closure);
+
     if (req->command == NULL || req->n_argv > INT_MAX || req->n_envp > INT_MAX) {
 	closure->errstr = N_("invalid PolicyCheckRequest");
 	goto done;
@@ -760,8 +886,13 @@ unpack:
 
     switch (req->type_case) {
     case INTERCEPT_REQUEST__TYPE_POLICY_CHECK_REQ:
-	if (closure->state != RECV_POLICY_CHECK) {
-	    /* Only a single policy check request is allowed. */
+	if (closure->state != RECV_POLICY_CHECK &&
+		closure->state != RECV_HELLO) {
+	    /*
+	     * Only one policy check may be outstanding at a time.
+	     * If execve(2) of an accepted command fails, the client
+	     * may send a new request instead of InterceptHello.
+	     */
 	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 		"state mismatch, expected RECV_POLICY_CHECK (%d), got %d",
 		RECV_POLICY_CHECK, closure->state);
@@ -915,6 +1046,43 @@ fmt_error_message(struct intercept_closure *closure)
     debug_return_bool(fmt_intercept_response(&resp, closure));
 }
 
+/*
+ * Send buf to sudo_intercept.so along with the client end of the
+ * intercept channel.  Only used for HelloResponse.
+ */
+static ssize_t
+send_with_channel(int fd, const void *buf, size_t len)
+{
+#ifdef SCM_RIGHTS
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int))];
+    } cmsgbuf;
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov;
+    debug_decl(send_with_channel, SUDO_DEBUG_EXEC);
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+    iov.iov_base = (void *)buf;
+    iov.iov_len = len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsgbuf.buf;
+    msg.msg_controllen = sizeof(cmsgbuf.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &intercept_channel[1], sizeof(int));
+
+    debug_return_ssize_t(sendmsg(fd, &msg, 0));
+#else
+    return send(fd, buf, len, 0);
+#endif /* SCM_RIGHTS */
+}
+
 /*
  * Write a response to sudo_intercept.so.
  */
@@ -953,8 +1121,15 @@ intercept_write(int fd, struct intercept_closure *closure)
 
     sudo_debug_printf(SUDO_DEBUG_INFO, "%s: sending %u bytes to client",
 	__func__, closure->len - closure->off);
-    nwritten = send(fd, closure->buf + closure->off,
-	closure->len - closure->off, 0);
+    if (closure->off == 0 && closure->pass_channel &&
+	    intercept_channel[1] != -1 &&
+	    (closure->state == RECV_HELLO_INITIAL ||
+	    closure->state == RECV_HELLO)) {
+	nwritten = send_with_channel(fd, closure->buf, closure->len);
+    } else {
+	nwritten = send(fd, closure->buf + closure->off,
+	    closure->len - closure->off, 0);
+    }
     if (nwritten == -1) {
 	if (errno == EINTR || errno == EAGAIN) {
 	    sudo_debug_printf(
@@ -981,9 +1156,28 @@ intercept_write(int fd, struct intercept_closure *closure)
     closure->off = 0;
 
     switch (closure->state) {
-    case RECV_HELLO_INITIAL:
+    case RECV_HELLO_INITIAL: {
+	struct sudo_event_base *evbase = sudo_ev_get_base(&closure->ev);
+
+	/* The command's ctor keeps the socket open for policy checks. */
+	if (intercept_connection_setup(fd, evbase, closure->details,
+		RECV_POLICY_CHECK, intercept_cb, true) == NULL) {
+	    close(fd);
+	}
+
+	/* Listen for new connections on the channel. */
+	if (intercept_channel[0] != -1) {
+	    channel_closure = intercept_connection_setup(intercept_channel[0],
+		evbase, closure->details, RECV_CONNECTION,
+		intercept_channel_cb, false);
+	    if (channel_closure == NULL) {
+		close(intercept_channel[0]);
+		close(intercept_channel[1]);
+		intercept_channel[0] = intercept_channel[1] = -1;
+	    }
+	}
+
 	/* Reuse the listener event. */
-	close(fd);
 	if (!enable_read_event(closure->listen_sock, RECV_CONNECTION,
 		intercept_accept_cb, closure))
 	    goto done;
@@ -991,11 +1185,18 @@ intercept_write(int fd, struct intercept_closure *closure)
 	closure->state = RECV_CONNECTION;
 	accept_closure = closure;
 	break;
+    }
     case POLICY_ACCEPT:
 	/* Reuse event to read InterceptHello from sudo_intercept.so ctor. */
 	if (!enable_read_event(fd, RECV_HELLO, intercept_cb, closure))
 	    goto done;
 	break;
+    case RECV_HELLO:
+    case POLICY_REJECT:
+	/* Keep the connection open for the next policy check. */
+	if (!enable_read_event(fd, RECV_POLICY_CHECK, intercept_cb, closure))
+	    goto done;
+	break;
     default:
 	/* Done with this connection. */
 	intercept_connection_close(closure);
@@ -1069,7 +1270,8 @@ intercept_accept_cb(int fd, int what, void *v)
     /*
      * Create a new intercept closure and register an event for client_sock.
      */
-    if (intercept_setup(client_sock, evbase, closure->details) == NULL) {
+    if (intercept_connection_setup(client_sock, evbase, closure->details,
+	    RECV_SECRET, intercept_cb, false) == NULL) {
 	goto bad;
     }
 
@@ -1080,6 +1282,85 @@ bad:
 	close(client_sock);
     debug_return;
 }
+
+/*
+ * Receive a new connection from the client over the intercept channel
+ * and register a new event for it.  Each message contains the token
+ * and one end of a socketpair created by the client.
+ */
+static void
+intercept_channel_cb(int fd, int what, void *v)
+{
+#ifdef SCM_RIGHTS
+    struct intercept_closure *closure = v;
+    struct sudo_event_base *evbase = sudo_ev_get_base(&closure->ev);
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int))];
+    } cmsgbuf;
+    union sudo_token_un token;
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov;
+    int client_sock = -1, flags, type;
+    socklen_t optlen = sizeof(type);
+    ssize_t nread;
+    debug_decl(intercept_channel_cb, SUDO_DEBUG_EXEC);
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &token;
+    iov.iov_len = sizeof(token);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsgbuf.buf;
+    msg.msg_controllen = sizeof(cmsgbuf.buf);
+    nread = recvmsg(fd, &msg, 0);
+    if (nread == -1) {
+	if (errno != EINTR && errno != EAGAIN)
+	    sudo_warn("recvmsg");
+	debug_return;
+    }
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+	    cmsg->cmsg_type == SCM_RIGHTS &&
+	    cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+	memcpy(&client_sock, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (client_sock == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "no socket in intercept channel message");
+	debug_return;
+    }
+    if (nread != ssizeof(token) ||
+	    ISSET(msg.msg_flags, MSG_TRUNC|MSG_CTRUNC) ||
+	    memcmp(&token, &intercept_token, sizeof(token)) != 0) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "invalid intercept channel message");
+	goto bad;
+    }
+    if (getsockopt(client_sock, SOL_SOCKET, SO_TYPE, &type, &optlen) == -1 ||
+	    type != SOCK_STREAM) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "intercept channel message did not contain a stream socket");
+	goto bad;
+    }
+    flags = fcntl(client_sock, F_GETFL, 0);
+    if (flags != -1)
+	(void)fcntl(client_sock, F_SETFL, flags | O_NONBLOCK);
+
+    /* The token has already been verified. */
+    if (intercept_connection_setup(client_sock, evbase, closure->details,
+	    RECV_POLICY_CHECK, intercept_cb, true) == NULL) {
+	goto bad;
+    }
+
+    debug_return;
+
+bad:
+    close(client_sock);
+    debug_return;
+#endif /* SCM_RIGHTS */
+}
 #else /* _PATH_SUDO_INTERCEPT */
 void *
 intercept_setup(int fd, struct sudo_event_base *evbase,
@@ -47,9 +47,16 @@ struct intercept_closure {
     int listen_sock;
     enum intercept_state state;
     int initial_command;
+    bool pass_channel;		/* send channel with HelloResponse */
 };
 
 void intercept_closure_reset(struct intercept_closure *closure);
 bool intercept_check_policy(const char *command, int argc, char **argv, int envc, char **envp, const char *runcwd, int *oldcwd, void *closure);
 
+/* intercept_cache.c */
+void intercept_cache_init(unsigned int timeout);
+bool intercept_cache_lookup(const char *command, const struct stat *sb, int argc, char * const argv[], const char *runcwd, char ***command_info, char ***run_argv);
+bool intercept_cache_store(const char *command, const struct stat *sb, int argc, char * const argv[], const char *runcwd, char * const command_info[], char * const run_argv[]);
+void intercept_cache_free(void);
+
 #endif /* SUDO_EXEC_INTERCEPT_H */
@@ -18,6 +18,7 @@
 
 #include <config.h>
 
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <stdlib.h>
 #include <string.h>
@@ -94,7 +95,7 @@ safe_close(int fd)
 /*
  * Allocate a new I/O buffer and associated read/write events.
  */
-void
+struct io_buffer *
 io_buf_new(int rfd, int wfd,
     bool (*action)(const char *, unsigned int, struct io_buffer *),
     void (*read_cb)(int fd, int what, void *v),
@@ -123,14 +124,139 @@ io_buf_new(int rfd, int wfd,
     iob->len = 0;
     iob->off = 0;
     iob->action = action;
+    iob->tee_pipe[0] = iob->tee_pipe[1] = -1;
+    iob->splice = false;
     iob->buf[0] = '\0';
     if (iob->revent == NULL || iob->wevent == NULL)
 	sudo_fatalx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
     SLIST_INSERT_HEAD(&iobufs, iob, entries);
 
-    debug_return;
+    debug_return_ptr(iob);
 }
 
+/*
+ * Enable splice mode for an I/O buffer if "Set splice_io true" is
+ * present in sudo.conf and the reader is a pipe.  Data is left in
+ * the pipe until it can be moved to the writer with splice(2), the
+ * copy passed to the I/O plugins is made with tee(2).
+ * Returns true if splice mode was enabled, else false.
+ */
+bool
+io_buf_splice(struct io_buffer *iob)
+{
+    debug_decl(io_buf_splice, SUDO_DEBUG_EXEC);
+
+#ifdef HAVE_SPLICE
+    if (sudo_conf_splice_io()) {
+	struct stat sb;
+
+	if (fstat(sudo_ev_get_fd(iob->revent), &sb) == -1 ||
+		!S_ISFIFO(sb.st_mode)) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO,
+		"%s: fd %d is not a pipe", __func__,
+		sudo_ev_get_fd(iob->revent));
+	    debug_return_bool(false);
+	}
+	if (pipe2(iob->tee_pipe, O_CLOEXEC|O_NONBLOCK) != 0) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"%s: unable to create pipe", __func__);
+	    debug_return_bool(false);
+	}
+	sudo_debug_printf(SUDO_DEBUG_INFO, "%s: splicing fd %d to fd %d",
+	    __func__, sudo_ev_get_fd(iob->revent),
+	    sudo_ev_get_fd(iob->wevent));
+	iob->splice = true;
+	debug_return_bool(true);
+    }
+#endif /* HAVE_SPLICE */
+    debug_return_bool(false);
+}
+
+#ifdef HAVE_SPLICE
+/*
+ * Copy the data at the head of pipe fd into iob->buf without
+ * consuming it.  The data is moved to the writer by io_buf_splice_write().
+ * Returns the number of bytes copied, 0 on EOF or -1 on error.
+ */
+ssize_t
+io_buf_splice_read(int fd, struct io_buffer *iob)
+{
+    ssize_t n, nread = 0;
+    debug_decl(io_buf_splice_read, SUDO_DEBUG_EXEC);
+
+    /* Since tee(2) starts at the head of the pipe, wait for the writer. */
+    if (iob->len != 0) {
+	sudo_ev_del(NULL, iob->revent);
+	errno = EAGAIN;
+	debug_return_ssize_t(-1);
+    }
+
+    n = tee(fd, iob->tee_pipe[1], sizeof(iob->buf), SPLICE_F_NONBLOCK);
+    if (n <= 0)
+	debug_return_ssize_t(n);
+
+    /* The copy is already in the tee pipe so this will not block. */
+    while (nread < n) {
+	const ssize_t nr = read(iob->tee_pipe[0], iob->buf + nread,
+	    (size_t)(n - nread));
+	if (nr <= 0) {
+	    if (nr == -1 && errno == EINTR)
+		continue;
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"%s: unable to read tee pipe", __func__);
+	    if (nr == 0)
+		errno = EIO;
+	    debug_return_ssize_t(-1);
+	}
+	nread += nr;
+    }
+
+    debug_return_ssize_t(n);
+}
+
+/*
+ * Move data that has already been logged from the reader's pipe to fd.
+ * If fd does not support splice(2), discard the data from the pipe and
+ * fall back to writing the copy in iob->buf.
+ */
+ssize_t
+io_buf_splice_write(int fd, struct io_buffer *iob)
+{
+    const size_t len = iob->len - iob->off;
+    ssize_t n, nread = 0;
+    int rfd;
+    debug_decl(io_buf_splice_write, SUDO_DEBUG_EXEC);
+
+    if (iob->revent == NULL) {
+	/* Should not happen, the reader is closed only after we finish. */
+	errno = EBADF;
+	debug_return_ssize_t(-1);
+    }
+    rfd = sudo_ev_get_fd(iob->revent);
+
+    n = splice(rfd, NULL, fd, NULL, len, SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+    if (n != -1 || errno != EINVAL)
+	debug_return_ssize_t(n);
+
+    sudo_debug_printf(SUDO_DEBUG_INFO,
+	"%s: fd %d does not support splice, disabling", __func__, fd);
+    while ((size_t)nread < len) {
+	n = read(rfd, iob->buf + iob->off + nread, len - (size_t)nread);
+	if (n <= 0) {
+	    if (n == -1 && errno == EINTR)
+		continue;
+	    if (n == 0)
+		errno = EIO;
+	    debug_return_ssize_t(-1);
+	}
+	nread += n;
+    }
+    iob->splice = false;
+
+    debug_return_ssize_t(write(fd, iob->buf + iob->off, len));
+}
+#endif /* HAVE_SPLICE */
+
 /*
  * Schedule I/O events before starting the main event loop or
  * resuming from suspend.
@@ -150,7 +276,7 @@ add_io_events(struct exec_closure *ec)
 	/* Don't read from /dev/tty if we are not in the foreground. */
 	if (iob->revent != NULL &&
 	    (ec->term_raw || !USERTTY_EVENT(iob->revent))) {
-	    if (iob->len != sizeof(iob->buf)) {
+	    if (!IOB_FULL(iob)) {
 		sudo_debug_printf(SUDO_DEBUG_INFO,
 		    "added I/O revent %p, fd %d, events %d",
 		    iob->revent, iob->revent->fd, iob->revent->events);
@@ -208,7 +334,7 @@ del_io_events(bool nonblocking)
     SLIST_FOREACH(iob, &iobufs, entries) {
 	/* Don't read from /dev/tty while flushing. */
 	if (iob->revent != NULL && !USERTTY_EVENT(iob->revent)) {
-	    if (iob->len != sizeof(iob->buf)) {
+	    if (!IOB_FULL(iob)) {
 		if (sudo_ev_add(evbase, iob->revent, NULL, false) == -1)
 		    sudo_fatal("%s", U_("unable to add event to queue"));
 	    }
@@ -285,6 +411,10 @@ free_io_bufs(void)
 	    sudo_ev_free(iob->revent);
 	if (iob->wevent != NULL)
 	    sudo_ev_free(iob->wevent);
+	if (iob->tee_pipe[0] != -1) {
+	    close(iob->tee_pipe[0]);
+	    close(iob->tee_pipe[1]);
+	}
 	free(iob);
     }
 
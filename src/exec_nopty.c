@@ -349,7 +349,12 @@ read_callback(int fd, int what, void *v)
     ssize_t n;
     debug_decl(read_callback, SUDO_DEBUG_EXEC);
 
-    n = read(fd, iob->buf + iob->len, sizeof(iob->buf) - iob->len);
+#ifdef HAVE_SPLICE
+    if (iob->splice)
+	n = io_buf_splice_read(fd, iob);
+    else
+#endif
+	n = read(fd, iob->buf + iob->len, sizeof(iob->buf) - iob->len);
     switch (n) {
 	case -1:
 	    if (errno == EAGAIN || errno == EINTR) {
@@ -384,7 +389,7 @@ read_callback(int fd, int what, void *v)
 	    }
 	    iob->len += (unsigned int)n;
 	    /* Disable reader if buffer is full. */
-	    if (iob->len == sizeof(iob->buf))
+	    if (IOB_FULL(iob))
 		sudo_ev_del(evbase, iob->revent);
 	    /* Enable writer now that there is new data in the buffer. */
 	    if (iob->wevent != NULL) {
@@ -408,7 +413,12 @@ write_callback(int fd, int what, void *v)
     ssize_t n;
     debug_decl(write_callback, SUDO_DEBUG_EXEC);
 
-    n = write(fd, iob->buf + iob->off, iob->len - iob->off);
+#ifdef HAVE_SPLICE
+    if (iob->splice)
+	n = io_buf_splice_write(fd, iob);
+    else
+#endif
+	n = write(fd, iob->buf + iob->off, iob->len - iob->off);
     if (n == -1) {
 	switch (errno) {
 	case EPIPE:
@@ -456,7 +466,7 @@ write_callback(int fd, int what, void *v)
 	 * Enable reader if buffer is not full but avoid reading
 	 * /dev/tty if the command is no longer running.
 	 */
-	if (iob->revent != NULL && iob->len != sizeof(iob->buf)) {
+	if (iob->revent != NULL && !IOB_FULL(iob)) {
 	    if (!USERTTY_EVENT(iob->revent) || iob->ec->cmnd_pid != -1) {
 		if (sudo_ev_add(evbase, iob->revent, NULL, false) == -1)
 		    sudo_fatal("%s", U_("unable to add event to queue"));
@@ -476,6 +486,7 @@ interpose_pipes(struct exec_closure *ec, const char *tty, int io_pipe[3][2])
 {
     bool interpose[3] = { false, false, false };
     struct plugin_container *plugin;
+    struct io_buffer *iob;
     const pid_t pgrp = getpgrp();
     bool want_winch = false;
     struct stat sb;
@@ -508,8 +519,9 @@ interpose_pipes(struct exec_closure *ec, const char *tty, int io_pipe[3][2])
 		"stdin not user's tty, creating a pipe");
 	    if (pipe2(io_pipe[STDIN_FILENO], O_CLOEXEC) != 0)
 		sudo_fatal("%s", U_("unable to create pipe"));
-	    io_buf_new(STDIN_FILENO, io_pipe[STDIN_FILENO][1],
+	    iob = io_buf_new(STDIN_FILENO, io_pipe[STDIN_FILENO][1],
 		log_stdin, read_callback, write_callback, ec);
+	    (void)io_buf_splice(iob);
 	}
     }
     if (interpose[STDOUT_FILENO]) {
@@ -518,8 +530,9 @@ interpose_pipes(struct exec_closure *ec, const char *tty, int io_pipe[3][2])
 		"stdout not user's tty, creating a pipe");
 	    if (pipe2(io_pipe[STDOUT_FILENO], O_CLOEXEC) != 0)
 		sudo_fatal("%s", U_("unable to create pipe"));
-	    io_buf_new(io_pipe[STDOUT_FILENO][0], STDOUT_FILENO,
+	    iob = io_buf_new(io_pipe[STDOUT_FILENO][0], STDOUT_FILENO,
 		log_stdout, read_callback, write_callback, ec);
+	    (void)io_buf_splice(iob);
 	}
     }
     if (interpose[STDERR_FILENO]) {
@@ -528,8 +541,9 @@ interpose_pipes(struct exec_closure *ec, const char *tty, int io_pipe[3][2])
 		"stderr not user's tty, creating a pipe");
 	    if (pipe2(io_pipe[STDERR_FILENO], O_CLOEXEC) != 0)
 		sudo_fatal("%s", U_("unable to create pipe"));
-	    io_buf_new(io_pipe[STDERR_FILENO][0], STDERR_FILENO,
+	    iob = io_buf_new(io_pipe[STDERR_FILENO][0], STDERR_FILENO,
 		log_stderr, read_callback, write_callback, ec);
+	    (void)io_buf_splice(iob);
 	}
     }
     if (want_winch) {
@@ -575,7 +589,7 @@ exec_nopty(struct command_details *details,
 	 */
 	if (socketpair(PF_UNIX, SOCK_STREAM, 0, intercept_sv) == -1)
 	    sudo_fatal("%s", U_("unable to create sockets"));
-	if (ISSET(details->flags, CD_USE_PTRACE)) {
+	if (ISSET(details->flags, CD_USE_PTRACE|CD_USE_SECCOMP)) {
 	    if (fcntl(intercept_sv[0], F_SETFD, FD_CLOEXEC) == -1 ||
 		    fcntl(intercept_sv[1], F_SETFD, FD_CLOEXEC) == -1) {
 		sudo_fatal("%s", U_("unable to create sockets"));
@@ -693,6 +707,13 @@ exec_nopty(struct command_details *details,
 		/* There is another tracer present. */
 		CLR(details->flags, CD_INTERCEPT|CD_LOG_SUBCMDS|CD_USE_PTRACE);
 	    }
+	} else if (ISSET(details->flags, CD_USE_SECCOMP)) {
+	    /* Receive the seccomp(2) notification fd from the command. */
+	    rc = exec_seccomp_listen(intercept_sv[0], ec.evbase, ec.intercept);
+	    if (rc == 0) {
+		/* The command is already being intercepted. */
+		CLR(details->flags, CD_INTERCEPT|CD_LOG_SUBCMDS|CD_USE_SECCOMP);
+	    }
 	}
 	if (rc == -1)
 	    terminate_command(ec.cmnd_pid, false);
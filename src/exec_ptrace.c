@@ -16,10 +16,12 @@
 
 #include <config.h>
 
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <sys/utsname.h>
 #include <sys/wait.h>
 
 #include <ctype.h>
@@ -71,11 +73,30 @@
 #  define PTRACE_O_EXITKILL 0
 # endif
 
+/*
+ * Seccomp user notification was added in Linux 5.0 but we also need
+ * SECCOMP_USER_NOTIF_FLAG_CONTINUE (Linux 5.5).  Since the process
+ * is not stopped by a tracer, its memory is read via process_vm_readv(2).
+ */
+# if defined(SECCOMP_RET_USER_NOTIF) && \
+    defined(SECCOMP_USER_NOTIF_FLAG_CONTINUE) && \
+    defined(HAVE_PROCESS_VM_READV)
+#  define SECCOMP_NOTIFY_SUPPORTED
+# endif
+
 static int seccomp_trap_supported = -1;
 # ifdef HAVE_PROCESS_VM_READV
 static size_t page_size;
 # endif
 static size_t arg_max;
+# ifdef SECCOMP_NOTIFY_SUPPORTED
+static int seccomp_notify_supported = -1;
+static struct seccomp_notif_sizes notify_sizes;
+static struct seccomp_notif *notify_req;
+static struct seccomp_notif_resp *notify_resp;
+static struct sudo_event *notify_ev;
+static int notify_fd = -1;
+# endif /* SECCOMP_NOTIFY_SUPPORTED */
 
 /* Register getters and setters. */
 # ifdef SECCOMP_AUDIT_ARCH_COMPAT
@@ -517,6 +538,135 @@ ptrace_read_string(pid_t pid, unsigned long addr, char *buf, size_t bufsize)
     }
 }
 
+/*
+ * Read a single (native or compat) word at addr and store it in wordp.
+ * Unlike ptrace(2), process_vm_readv(2) does not require the process
+ * to be stopped by a tracer.
+ * Returns true on success, else false.
+ */
+static bool
+ptrace_read_word(pid_t pid, struct sudo_ptrace_regs *regs, unsigned long addr,
+    unsigned long *wordp)
+{
+    unsigned long word;
+    debug_decl(ptrace_read_word, SUDO_DEBUG_EXEC);
+
+#ifdef HAVE_PROCESS_VM_READV
+    struct iovec local, remote;
+    uint32_t word32;
+    ssize_t nread;
+
+    local.iov_base = regs->wordsize == sizeof(word32) ?
+	(void *)&word32 : (void *)&word;
+    local.iov_len = regs->wordsize;
+    remote.iov_base = (void *)addr;
+    remote.iov_len = regs->wordsize;
+    nread = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    if (nread == (ssize_t)regs->wordsize) {
+	*wordp = regs->wordsize == sizeof(word32) ? word32 : word;
+	debug_return_bool(true);
+    }
+    if (nread != -1 || errno != ENOSYS) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "process_vm_readv(%d, [%p, %zu], 1, [0x%lx, %zu], 1, 0) -> %zd",
+	    (int)pid, local.iov_base, local.iov_len, addr, remote.iov_len,
+	    nread);
+	debug_return_bool(false);
+    }
+#endif /* HAVE_PROCESS_VM_READV */
+
+    errno = 0;
+    word = (unsigned long)ptrace(PTRACE_PEEKDATA, pid, addr, NULL);
+    if (word == (unsigned long)-1 && errno != 0) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+	    "ptrace(PTRACE_PEEKDATA, %d, 0x%lx, NULL)", (int)pid, addr);
+	debug_return_bool(false);
+    }
+# ifdef SECCOMP_AUDIT_ARCH_COMPAT
+    if (regs->compat) {
+	/* PTRACE_PEEKDATA reads a native word, we only want 32 bits. */
+#  if BYTE_ORDER == BIG_ENDIAN
+	word >>= 32;
+#  else
+	word &= 0xffffffffU;
+#  endif
+    }
+# endif /* SECCOMP_AUDIT_ARCH_COMPAT */
+    *wordp = word;
+    debug_return_bool(true);
+}
+
+/*
+ * Cache of tracee pages read via process_vm_readv(2), sorted by address.
+ * Used to read the execve(2) argument and environment vectors with as
+ * few system calls as possible.
+ */
+struct remote_page {
+    unsigned long addr;		/* page-aligned address in the tracee */
+    char *data;			/* copy of the page contents */
+    char *chunk;		/* allocation to free, if any */
+};
+
+struct remote_pages {
+    struct remote_page *pages;
+    size_t count;
+    size_t size;
+};
+
+/*
+ * Free the contents of the page cache.
+ */
+static void
+remote_pages_free(struct remote_pages *rp)
+{
+    size_t i;
+    debug_decl(remote_pages_free, SUDO_DEBUG_EXEC);
+
+    for (i = 0; i < rp->count; i++)
+	free(rp->pages[i].chunk);
+    free(rp->pages);
+    memset(rp, 0, sizeof(*rp));
+
+    debug_return;
+}
+
+#ifdef HAVE_PROCESS_VM_READV
+static int
+ulong_cmp(const void *v1, const void *v2)
+{
+    const unsigned long u1 = *(const unsigned long *)v1;
+    const unsigned long u2 = *(const unsigned long *)v2;
+
+    return u1 < u2 ? -1 : u1 > u2;
+}
+
+static int
+remote_page_cmp(const void *v1, const void *v2)
+{
+    const struct remote_page *p1 = v1;
+    const struct remote_page *p2 = v2;
+
+    return ulong_cmp(&p1->addr, &p2->addr);
+}
+
+/*
+ * Look up the page at addr (which must be page-aligned) in the cache.
+ * Returns a pointer to the page contents or NULL if not present.
+ */
+static const char *
+remote_pages_find(struct remote_pages *rp, unsigned long addr)
+{
+    struct remote_page key, *page;
+
+    if (rp->count == 0)
+	return NULL;
+    key.addr = addr;
+    page = bsearch(&key, rp->pages, rp->count, sizeof(*rp->pages),
+	remote_page_cmp);
+    return page ? page->data : NULL;
+}
+#endif /* HAVE_PROCESS_VM_READV */
+
 /*
  * Expand buf by doubling its size.
  * Updates bufp and bufsizep and recalculates curp and remp if non-NULL.
@@ -606,6 +756,320 @@ strtab_to_vec(char *strtab, size_t strtab_len, int *countp, char ***vecp,
     debug_return_ssize_t((char *)vp - strend);
 }
 
+#ifdef HAVE_PROCESS_VM_READV
+/*
+ * Maximum number of pages to read in a single process_vm_readv(2) call
+ * and the number of pages to read ahead when scanning a vector.
+ */
+# define REMOTE_PAGES_BATCH	64
+# define REMOTE_PAGES_AHEAD	4
+
+/*
+ * Read the pages in want[], which must be sorted and not already cached,
+ * using as few process_vm_readv(2) calls as possible.  Each remote iovec
+ * is a single page so a partial read always ends on a page boundary.
+ * Reading stops at the first page that cannot be read, the caller must
+ * check that the pages it needs are present.
+ * Returns true on success, false on a fatal error (errno is preserved).
+ */
+static bool
+remote_pages_read(pid_t pid, struct remote_pages *rp,
+    const unsigned long *want, size_t nwant)
+{
+    struct iovec local[REMOTE_PAGES_BATCH], remote[REMOTE_PAGES_BATCH];
+    size_t batch, i, j, n;
+    ssize_t nread;
+    char *chunk;
+    debug_decl(remote_pages_read, SUDO_DEBUG_EXEC);
+
+    if (rp->count + nwant > rp->size) {
+	struct remote_page *pages = reallocarray(rp->pages,
+	    rp->count + nwant, sizeof(*pages));
+	if (pages == NULL) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    debug_return_bool(false);
+	}
+	rp->pages = pages;
+	rp->size = rp->count + nwant;
+    }
+
+    for (i = 0; i < nwant; i += batch) {
+	batch = MIN(nwant - i, REMOTE_PAGES_BATCH);
+	chunk = reallocarray(NULL, batch, page_size);
+	if (chunk == NULL) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    debug_return_bool(false);
+	}
+	for (j = 0; j < batch; j++) {
+	    local[j].iov_base = chunk + (j * page_size);
+	    local[j].iov_len = page_size;
+	    remote[j].iov_base = (void *)want[i + j];
+	    remote[j].iov_len = page_size;
+	}
+	nread = process_vm_readv(pid, local, batch, remote, batch, 0);
+	if (nread == -1) {
+	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_ERRNO,
+		"process_vm_readv(%d, [0x%lx, ...], %zu, ...)", (int)pid,
+		want[i], batch);
+	    if (errno != EFAULT) {
+		free(chunk);
+		debug_return_bool(false);
+	    }
+	    nread = 0;
+	}
+	n = (size_t)nread / page_size;
+	if (n == 0) {
+	    free(chunk);
+	    break;
+	}
+
+	/* The first page in the batch owns the chunk. */
+	for (j = 0; j < n; j++) {
+	    struct remote_page *page = &rp->pages[rp->count++];
+	    page->addr = want[i + j];
+	    page->data = chunk + (j * page_size);
+	    page->chunk = j ? NULL : chunk;
+	}
+	if (n != batch)
+	    break;
+    }
+    qsort(rp->pages, rp->count, sizeof(*rp->pages), remote_page_cmp);
+
+    debug_return_bool(true);
+}
+
+/*
+ * Copy len bytes at addr in the tracee from the page cache to dst.
+ * Returns true on success, else false and the address of the first
+ * missing page is stored in missingp.
+ */
+static bool
+remote_pages_copy(struct remote_pages *rp, unsigned long addr, void *dst,
+    size_t len, unsigned long *missingp)
+{
+    char *cp = dst;
+    debug_decl(remote_pages_copy, SUDO_DEBUG_EXEC);
+
+    while (len > 0) {
+	const unsigned long page = addr & ~((unsigned long)page_size - 1);
+	const size_t off = (size_t)(addr - page);
+	const size_t n = MIN(len, page_size - off);
+	const char *data = remote_pages_find(rp, page);
+
+	if (data == NULL) {
+	    *missingp = page;
+	    debug_return_bool(false);
+	}
+	memcpy(cp, data + off, n);
+	cp += n;
+	addr += n;
+	len -= n;
+    }
+    debug_return_bool(true);
+}
+
+/*
+ * Find the length of the string at addr in the tracee using the page
+ * cache.  Strings longer than the kernel allows fail with E2BIG.
+ * Returns the length including the NUL, or -1 if a page is missing,
+ * in which case its address is stored in missingp.
+ */
+static ssize_t
+remote_pages_strlen(struct remote_pages *rp, unsigned long addr,
+    unsigned long *missingp)
+{
+    const size_t maxlen = 32 * page_size;	/* MAX_ARG_STRLEN */
+    size_t len = 0;
+    debug_decl(remote_pages_strlen, SUDO_DEBUG_EXEC);
+
+    while (len < maxlen) {
+	const unsigned long page = addr & ~((unsigned long)page_size - 1);
+	const size_t off = (size_t)(addr - page);
+	const char *data = remote_pages_find(rp, page);
+	const char *nul;
+
+	if (data == NULL) {
+	    *missingp = page;
+	    errno = EAGAIN;
+	    debug_return_ssize_t(-1);
+	}
+	nul = memchr(data + off, '\0', page_size - off);
+	if (nul != NULL)
+	    debug_return_ssize_t((ssize_t)(len + (size_t)(nul - data - off) + 1));
+	len += page_size - off;
+	addr += page_size - off;
+    }
+    *missingp = 0;
+    errno = E2BIG;
+    debug_return_ssize_t(-1);
+}
+
+/*
+ * Read the pointer table at addr in the tracee via the page cache,
+ * reading ahead a few pages at a time.
+ * Returns the number of non-NULL pointers stored in ptrsp, or -1 on error.
+ */
+static ssize_t
+remote_pages_read_ptrs(pid_t pid, struct sudo_ptrace_regs *regs,
+    struct remote_pages *rp, unsigned long addr, unsigned long **ptrsp)
+{
+    unsigned long want[REMOTE_PAGES_AHEAD], missing, word, *ptrs = NULL;
+    size_t i, nptrs = 0, ptrs_size = 0, nwant;
+    uint32_t word32;
+    debug_decl(remote_pages_read_ptrs, SUDO_DEBUG_EXEC);
+
+    for (;;) {
+	void *wordp = regs->wordsize == sizeof(word32) ?
+	    (void *)&word32 : (void *)&word;
+	if (!remote_pages_copy(rp, addr, wordp, regs->wordsize, &missing)) {
+	    /* Read the missing page and the ones after it. */
+	    for (nwant = 0, i = 0; i < REMOTE_PAGES_AHEAD; i++) {
+		const unsigned long page = missing + (i * page_size);
+		if (page < missing)
+		    break;
+		if (remote_pages_find(rp, page) == NULL)
+		    want[nwant++] = page;
+	    }
+	    if (!remote_pages_read(pid, rp, want, nwant))
+		goto bad;
+	    if (remote_pages_find(rp, missing) == NULL) {
+		errno = EFAULT;
+		goto bad;
+	    }
+	    continue;
+	}
+	if (regs->wordsize == sizeof(word32))
+	    word = word32;
+	if (word == 0)
+	    break;
+	if (nptrs == ptrs_size) {
+	    unsigned long *newptrs;
+	    ptrs_size = ptrs_size ? ptrs_size * 2 : 128;
+	    newptrs = reallocarray(ptrs, ptrs_size, sizeof(*ptrs));
+	    if (newptrs == NULL) {
+		sudo_warnx(U_("%s: %s"), __func__,
+		    U_("unable to allocate memory"));
+		goto bad;
+	    }
+	    ptrs = newptrs;
+	}
+	ptrs[nptrs++] = word;
+	addr += regs->wordsize;
+    }
+
+    *ptrsp = ptrs;
+    debug_return_ssize_t((ssize_t)nptrs);
+bad:
+    free(ptrs);
+    debug_return_ssize_t(-1);
+}
+
+/*
+ * Read the string vector at addr using the page cache.  Rather than
+ * reading each pointer and string individually, all the pages holding
+ * the pointer table and the strings it refers to are read in batches.
+ * Since the strings are usually stored contiguously, this typically
+ * takes only a few process_vm_readv(2) calls for the entire vector.
+ * Returns the number of bytes in buf consumed (including NULs) or -1.
+ * See ptrace_read_vec() for details.
+ */
+static ssize_t
+ptrace_readv_vec(pid_t pid, struct sudo_ptrace_regs *regs,
+    struct remote_pages *rp, unsigned long addr, int *countp, char ***vecp,
+    char **bufp, size_t *bufsizep, size_t off)
+{
+    size_t i, j, nwant, strtab_len, remainder = *bufsizep - off;
+    unsigned long missing, *ptrs = NULL, *want = NULL;
+    char *strtab = *bufp + off;
+    ssize_t len, nptrs;
+    debug_decl(ptrace_readv_vec, SUDO_DEBUG_EXEC);
+
+    nptrs = remote_pages_read_ptrs(pid, regs, rp, addr, &ptrs);
+    if (nptrs == -1)
+	goto bad;
+    if (nptrs > INT_MAX) {
+	errno = E2BIG;
+	goto bad;
+    }
+
+    if (nptrs != 0) {
+	want = reallocarray(NULL, (size_t)nptrs, sizeof(*want));
+	if (want == NULL) {
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	    goto bad;
+	}
+    }
+
+    /*
+     * Read the pages the strings start on, then any pages they
+     * continue on to, until all strings are present.
+     */
+    for (;;) {
+	nwant = 0;
+	for (i = 0; i < (size_t)nptrs; i++) {
+	    if (remote_pages_strlen(rp, ptrs[i], &missing) == -1) {
+		if (errno != EAGAIN)
+		    goto bad;
+		want[nwant++] = missing;
+	    }
+	}
+	if (nwant == 0)
+	    break;
+
+	/* Sort and remove duplicates, strings often share a page. */
+	qsort(want, nwant, sizeof(*want), ulong_cmp);
+	for (i = 1, j = 1; i < nwant; i++) {
+	    if (want[i] != want[j - 1])
+		want[j++] = want[i];
+	}
+	nwant = j;
+	if (!remote_pages_read(pid, rp, want, nwant))
+	    goto bad;
+	for (i = 0; i < nwant; i++) {
+	    if (remote_pages_find(rp, want[i]) == NULL) {
+		errno = EFAULT;
+		goto bad;
+	    }
+	}
+    }
+
+    /* Fill in string table from the page cache. */
+    for (i = 0; i < (size_t)nptrs; i++) {
+	len = remote_pages_strlen(rp, ptrs[i], &missing);
+	if (len == -1)
+	    goto bad;
+	while (remainder < (size_t)len) {
+	    if (!growbuf(bufp, bufsizep, &strtab, &remainder))
+		goto bad;
+	}
+	if (!remote_pages_copy(rp, ptrs[i], strtab, (size_t)len, &missing)) {
+	    errno = EFAULT;
+	    goto bad;
+	}
+	strtab += len;
+	remainder -= (size_t)len;
+    }
+    free(ptrs);
+    free(want);
+    sudo_debug_printf(SUDO_DEBUG_DEBUG, "%s: %d: %zd strings, %zu pages",
+	__func__, (int)pid, nptrs, rp->count);
+
+    /* Store strings in a vector after the string table. */
+    strtab_len = (size_t)(strtab - (*bufp + off));
+    strtab = *bufp + off;
+    len = strtab_to_vec(strtab, strtab_len, countp, vecp, bufp, bufsizep,
+	remainder);
+    if (len == -1)
+	debug_return_ssize_t(-1);
+
+    debug_return_ssize_t((ssize_t)strtab_len + len);
+bad:
+    free(ptrs);
+    free(want);
+    debug_return_ssize_t(-1);
+}
+#endif /* HAVE_PROCESS_VM_READV */
+
 /*
  * Read the string vector at addr and store it in bufp, which
  * is reallocated as needed.  The actual vector is returned in vecp.
@@ -616,12 +1080,10 @@ strtab_to_vec(char *strtab, size_t strtab_len, int *countp, char ***vecp,
  * Returns the number of bytes in buf consumed (including NULs).
  */
 static ssize_t
-ptrace_read_vec(pid_t pid, struct sudo_ptrace_regs *regs, unsigned long addr,
-    int *countp, char ***vecp, char **bufp, size_t *bufsizep, size_t off)
+ptrace_read_vec(pid_t pid, struct sudo_ptrace_regs *regs,
+    struct remote_pages *rp, unsigned long addr, int *countp, char ***vecp,
+    char **bufp, size_t *bufsizep, size_t off)
 {
-# ifdef SECCOMP_AUDIT_ARCH_COMPAT
-    unsigned long next_word = (unsigned long)-1;
-# endif
     size_t strtab_len, remainder = *bufsizep - off;
     char *strtab = *bufp + off;
     unsigned long word;
@@ -643,53 +1105,36 @@ ptrace_read_vec(pid_t pid, struct sudo_ptrace_regs *regs, unsigned long addr,
 	debug_return_ssize_t((char *)vp - strtab);
     }
 
+#ifdef HAVE_PROCESS_VM_READV
+    len = ptrace_readv_vec(pid, regs, rp, addr, countp, vecp, bufp,
+	bufsizep, off);
+    if (len != -1 || errno != ENOSYS)
+	debug_return_ssize_t(len);
+#endif /* HAVE_PROCESS_VM_READV */
+
     /* Fill in string table. */
-    do {
-# ifdef SECCOMP_AUDIT_ARCH_COMPAT
-	if (next_word == (unsigned long)-1) {
-	    word = ptrace(PTRACE_PEEKDATA, pid, addr, NULL);
-	    if (regs->compat) {
-		/* Stash the next compat word in next_word. */
-#  if BYTE_ORDER == BIG_ENDIAN
-		next_word = word & 0xffffffffU;
-		word >>= 32;
-#  else
-		next_word = word >> 32;
-		word &= 0xffffffffU;
-#  endif
-	    }
-	} else {
-	    /* Use the stashed value of the next word. */
-	    word = next_word;
-	    next_word = (unsigned long)-1;
-	}
-# else /* SECCOMP_AUDIT_ARCH_COMPAT */
-	word = ptrace(PTRACE_PEEKDATA, pid, addr, NULL);
-# endif /* SECCOMP_AUDIT_ARCH_COMPAT */
-	switch (word) {
-	case -1:
-	    sudo_warn("%s: ptrace(PTRACE_PEEKDATA, %d, 0x%lx, NULL)",
-		__func__, (int)pid, addr);
+    for (;;) {
+	if (!ptrace_read_word(pid, regs, addr, &word)) {
+	    sudo_warn(U_("unable to read memory of process %d"), (int)pid);
 	    debug_return_ssize_t(-1);
-	case 0:
+	}
+	if (word == 0) {
 	    /* NULL terminator */
 	    break;
-	default:
-	    for (;;) {
-		len = ptrace_read_string(pid, word, strtab, remainder);
-		if (len != -1)
-		    break;
-		if (errno != ENOSPC)
-		    debug_return_ssize_t(-1);
-		if (!growbuf(bufp, bufsizep, &strtab, &remainder))
-		    debug_return_ssize_t(-1);
-	    }
-	    strtab += len;
-	    remainder -= (size_t)len;
-	    addr += regs->wordsize;
-	    continue;
 	}
-    } while (word != 0);
+	for (;;) {
+	    len = ptrace_read_string(pid, word, strtab, remainder);
+	    if (len != -1)
+		break;
+	    if (errno != ENOSPC)
+		debug_return_ssize_t(-1);
+	    if (!growbuf(bufp, bufsizep, &strtab, &remainder))
+		debug_return_ssize_t(-1);
+	}
+	strtab += len;
+	remainder -= (size_t)len;
+	addr += regs->wordsize;
+    }
 
     /* Store strings in a vector after the string table. */
     strtab_len = (size_t)(strtab - (*bufp + off));
@@ -807,6 +1252,28 @@ ptrace_write_string(pid_t pid, unsigned long addr, const char *str)
 }
 
 #ifdef HAVE_PROCESS_VM_READV
+/*
+ * Advance the iovec array iovp with *cntp entries past n bytes.
+ */
+static void
+iov_advance(struct iovec **iovp, unsigned long *cntp, size_t n)
+{
+    struct iovec *iov = *iovp;
+    unsigned long cnt = *cntp;
+
+    while (cnt > 0 && n >= iov->iov_len) {
+	n -= iov->iov_len;
+	iov++;
+	cnt--;
+    }
+    if (cnt > 0 && n > 0) {
+	iov->iov_base = (char *)iov->iov_base + n;
+	iov->iov_len -= n;
+    }
+    *iovp = iov;
+    *cntp = cnt;
+}
+
 /*
  * Write the string vector vec to addr in the tracee which must have
  * sufficient space.  Strings are written to strtab.
@@ -819,34 +1286,35 @@ ptrace_writev_vec(pid_t pid, struct sudo_ptrace_regs *regs, char **vec,
 {
     const unsigned long addr0 = addr;
     const unsigned long strtab0 = strtab;
-    unsigned long *addrbuf = NULL;
-    struct iovec *local, *remote;
-    struct iovec local_addrs, remote_addrs;
-    size_t i, j, len, off = 0;
-    ssize_t expected = -1, nwritten, total_written = 0;
+    unsigned long *addrbuf = NULL, nlocal = 2, nremote = 2;
+    struct iovec local[2], remote[2], *lp = local, *rp = remote;
+    char *strbuf = NULL, *cp;
+    size_t i, j, len, size;
+    ssize_t nwritten, ret = -1;
     debug_decl(ptrace_writev_vec, SUDO_DEBUG_EXEC);
 
-    /* Build up local and remote iovecs for process_vm_writev(2). */
-    for (len = 0; vec[len] != NULL; len++)
-	continue;
-    local = reallocarray(NULL, len, sizeof(struct iovec));
-    remote = reallocarray(NULL, len, sizeof(struct iovec));
+    /*
+     * The string addresses and the strings themselves are each stored
+     * contiguously in the tracee so we gather them into two local
+     * buffers and write everything with a single process_vm_writev(2).
+     */
+    for (len = 0, size = 0; vec[len] != NULL; len++)
+	size += strlen(vec[len]) + 1;
     j = regs->compat && (len & 1) == 0;	/* pad for final NULL in compat */
     addrbuf = reallocarray(NULL, len + 1 + j, regs->wordsize);
-    if (local == NULL || remote == NULL || addrbuf == NULL) {
+    strbuf = malloc(size ? size : 1);
+    if (addrbuf == NULL || strbuf == NULL) {
 	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
 	goto done;
     }
-    for (i = 0, j = 0; i < len; i++) {
+    for (i = 0, j = 0, cp = strbuf; i < len; i++) {
 	unsigned long word = strtab;
 
-	/* Store remote string. */
-	const size_t size = strlen(vec[i]) + 1;
-	local[i].iov_base = vec[i];
-	local[i].iov_len = size;
-	remote[i].iov_base = (void *)strtab;
-	remote[i].iov_len = size;
-	strtab += size;
+	/* Store string in the local copy of the remote string table. */
+	const size_t n = strlen(vec[i]) + 1;
+	memcpy(cp, vec[i], n);
+	cp += n;
+	strtab += n;
 
 	/* Store address of remote string. */
 # ifdef SECCOMP_AUDIT_ARCH_COMPAT
@@ -877,63 +1345,48 @@ ptrace_writev_vec(pid_t pid, struct sudo_ptrace_regs *regs, char **vec,
 	addrbuf[j] = 0;
     }
 
-    /* Write strings addresses to addr0 on remote. */
-    local_addrs.iov_base = addrbuf;
-    local_addrs.iov_len = (len + 1) * regs->wordsize;
-    remote_addrs.iov_base = (void *)addr0;
-    remote_addrs.iov_len = local_addrs.iov_len;
-    if (process_vm_writev(pid, &local_addrs, 1, &remote_addrs, 1, 0) == -1)
-	goto done;
+    /* String addresses go to addr0, the strings to strtab0. */
+    local[0].iov_base = addrbuf;
+    local[0].iov_len = (len + 1) * regs->wordsize;
+    remote[0].iov_base = (void *)addr0;
+    remote[0].iov_len = local[0].iov_len;
+    local[1].iov_base = strbuf;
+    local[1].iov_len = size;
+    remote[1].iov_base = (void *)strtab0;
+    remote[1].iov_len = size;
 
-    /* Copy the strings to the (remote) string table. */
-    expected = (ssize_t)(strtab - strtab0);
-    for (;;) {
-	nwritten = process_vm_writev(pid, local + off, len - off,
-	    remote + off, len - off, 0);
+    /* Resume after a partial write, if needed. */
+    while (nlocal > 0) {
+	nwritten = process_vm_writev(pid, lp, nlocal, rp, nremote, 0);
 	switch (nwritten) {
 	case -1:
 	    sudo_debug_printf(
 		SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
-		"process_vm_writev(%d, 0x%lx, %zu, 0x%lx, %zu, 0)",
-		(int)pid, (unsigned long)local + off, len - off,
-		(unsigned long)remote + off, len - off);
+		"process_vm_writev(%d, [0x%lx, %zu], %lu, [0x%lx, %zu], %lu, 0)",
+		(int)pid, (unsigned long)lp->iov_base, lp->iov_len, nlocal,
+		(unsigned long)rp->iov_base, rp->iov_len, nremote);
 	    goto done;
 	case 0:
 	    sudo_debug_printf(
 		SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
-		"process_vm_writev(%d, 0x%lx, %zu, 0x%lx, %zu, 0): %s",
-		(int)pid, (unsigned long)local + off, len - off,
-		(unsigned long)remote + off, len - off,
+		"process_vm_writev(%d, [0x%lx, %zu], %lu, [0x%lx, %zu], %lu, 0):"
+		" %s", (int)pid, (unsigned long)lp->iov_base, lp->iov_len,
+		nlocal, (unsigned long)rp->iov_base, rp->iov_len, nremote,
 		"zero bytes written");
+	    errno = EFAULT;
 	    goto done;
 	default:
-	    total_written += nwritten;
-	    if (total_written >= expected)
-		goto done;
-
-	    /* Adjust offset for partial write (doesn't cross iov boundary). */
-	    while (off < len) {
-		nwritten -= (ssize_t)local[off].iov_len;
-		off++;
-		if (nwritten <= 0)
-		    break;
-	    }
-	    if (off == len) {
-		sudo_debug_printf(
-		    SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
-		    "overflow while resuming process_vm_writev()");
-		goto done;
-	    }
+	    iov_advance(&lp, &nlocal, (size_t)nwritten);
+	    iov_advance(&rp, &nremote, (size_t)nwritten);
 	    break;
 	}
     }
+    ret = (ssize_t)(strtab - strtab0);
+
 done:
-    free(local);
-    free(remote);
     free(addrbuf);
-    if (total_written == expected)
-	debug_return_ssize_t(total_written);
-    debug_return_ssize_t(-1);
+    free(strbuf);
+    debug_return_ssize_t(ret);
 }
 #endif /* HAVE_PROCESS_VM_READV */
 
@@ -1036,20 +1489,23 @@ proc_read_link(pid_t pid, const char *name, char *buf, size_t bufsize)
 }
 
 /*
- * Read execve(2) or execveat(2) system call arguments from pid.
+ * Read the execve(2) or execveat(2) pathname, argv and envp from pid.
+ * The raw system call arguments are stored in args[], which may come
+ * from the tracee's registers or from a seccomp notification.
  * Returns a dynamically allocated buffer the parent is responsible for.
  */
 static char *
-get_exec_info(pid_t pid, bool is_execveat, struct sudo_ptrace_regs *regs,
-    char **pathname_out, int *argc_out, char ***argv_out, int *envc_out,
-    char ***envp_out)
+read_exec_info(pid_t pid, bool is_execveat, struct sudo_ptrace_regs *regs,
+    const unsigned long args[5], char **pathname_out, int *argc_out,
+    char ***argv_out, int *envc_out, char ***envp_out)
 {
     char *argbuf, **argv, **envp, *pathname = NULL;
     unsigned long argv_addr, envp_addr, path_addr;
+    struct remote_pages pages = { NULL, 0, 0 };
     size_t bufsize, off = 0;
     int i, argc, dirfd = -1, flags = 0, envc = 0;
     ssize_t nread;
-    debug_decl(get_exec_info, SUDO_DEBUG_EXEC);
+    debug_decl(read_exec_info, SUDO_DEBUG_EXEC);
 
     bufsize = PATH_MAX + arg_max;
     argbuf = malloc(bufsize);
@@ -1060,16 +1516,16 @@ get_exec_info(pid_t pid, bool is_execveat, struct sudo_ptrace_regs *regs,
 
     if (is_execveat) {
 	/* execveat(2) takes five arguments */
-	dirfd = get_sc_arg1(pid, regs) & 0xffffffff;
-	path_addr = get_sc_arg2(pid, regs);
-	argv_addr = get_sc_arg3(pid, regs);
-	envp_addr = get_sc_arg4(pid, regs);
-	flags = get_sc_arg5(pid, regs) & 0xffffffff;
+	dirfd = (int)(args[0] & 0xffffffff);
+	path_addr = args[1];
+	argv_addr = args[2];
+	envp_addr = args[3];
+	flags = (int)(args[4] & 0xffffffff);
     } else {
 	/* execve(2) takes three arguments */
-	path_addr = get_sc_arg1(pid, regs);
-	argv_addr = get_sc_arg2(pid, regs);
-	envp_addr = get_sc_arg3(pid, regs);
+	path_addr = args[0];
+	argv_addr = args[1];
+	envp_addr = args[2];
     }
     sudo_debug_printf(SUDO_DEBUG_INFO,
 	"%s: %d: dirfd %d, path 0x%lx, argv 0x%lx, envp 0x%lx, flags: 0x%x",
@@ -1159,8 +1615,8 @@ get_exec_info(pid_t pid, bool is_execveat, struct sudo_ptrace_regs *regs,
     }
 
     /* Read argv */
-    nread = ptrace_read_vec(pid, regs, argv_addr, &argc, &argv, &argbuf,
-	&bufsize, off);
+    nread = ptrace_read_vec(pid, regs, &pages, argv_addr, &argc, &argv,
+	&argbuf, &bufsize, off);
     if (nread == -1) {
 	sudo_debug_printf(
 	    SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
@@ -1179,8 +1635,8 @@ get_exec_info(pid_t pid, bool is_execveat, struct sudo_ptrace_regs *regs,
     }
 
     /* Read envp */
-    nread = ptrace_read_vec(pid, regs, envp_addr, &envc, &envp, &argbuf,
-	&bufsize, off);
+    nread = ptrace_read_vec(pid, regs, &pages, envp_addr, &envc, &envp,
+	&argbuf, &bufsize, off);
     if (nread == -1) {
 	sudo_debug_printf(
 	    SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
@@ -1210,18 +1666,44 @@ get_exec_info(pid_t pid, bool is_execveat, struct sudo_ptrace_regs *regs,
     *envc_out = envc;
     *envp_out = envp;
 
+    remote_pages_free(&pages);
     debug_return_ptr(argbuf);
 bad:
+    remote_pages_free(&pages);
     free(argbuf);
     debug_return_ptr(NULL);
 }
 
 /*
- * Cause the current syscall to fail and set the error value to ecode.
+ * Read execve(2) or execveat(2) system call arguments from pid.
+ * Returns a dynamically allocated buffer the parent is responsible for.
  */
-static bool
-ptrace_fail_syscall(pid_t pid, struct sudo_ptrace_regs *regs, int ecode)
-{
+static char *
+get_exec_info(pid_t pid, bool is_execveat, struct sudo_ptrace_regs *regs,
+    char **pathname_out, int *argc_out, char ***argv_out, int *envc_out,
+    char ***envp_out)
+{
+    unsigned long args[5] = { 0 };
+    debug_decl(get_exec_info, SUDO_DEBUG_EXEC);
+
+    args[0] = get_sc_arg1(pid, regs);
+    args[1] = get_sc_arg2(pid, regs);
+    args[2] = get_sc_arg3(pid, regs);
+    if (is_execveat) {
+	args[3] = get_sc_arg4(pid, regs);
+	args[4] = get_sc_arg5(pid, regs);
+    }
+
+    debug_return_ptr(read_exec_info(pid, is_execveat, regs, args,
+	pathname_out, argc_out, argv_out, envc_out, envp_out));
+}
+
+/*
+ * Cause the current syscall to fail and set the error value to ecode.
+ */
+static bool
+ptrace_fail_syscall(pid_t pid, struct sudo_ptrace_regs *regs, int ecode)
+{
     sigset_t chldmask;
     bool ret = false;
     int status;
@@ -1298,12 +1780,16 @@ have_seccomp_action(const char *action)
 }
 
 /*
- * Intercept execve(2) and execveat(2) using seccomp(2) and ptrace(2).
- * If no tracer is present, execve(2) and execveat(2) will fail with ENOSYS.
+ * Install a seccomp(2) filter that returns action for execve(2) and
+ * execveat(2), or compat_action for their compat equivalents.
+ * If listenerp is not NULL, the filter is installed with a new
+ * user notification listener which is stored in listenerp.
  * Must be called with CAP_SYS_ADMIN, before privs are dropped.
+ * Returns true on success, else false.
  */
-bool
-set_exec_filter(void)
+static bool
+install_exec_filter(unsigned int action, unsigned int compat_action,
+    int *listenerp)
 {
     struct sock_filter exec_filter[] = {
 	/* Load architecture value (AUDIT_ARCH_*) into the accumulator. */
@@ -1316,8 +1802,8 @@ set_exec_filter(void)
 	/* Jump to trace for compat2 execve(2)/execveat(2), else allow. */
 /*03*/	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, COMPAT2_execve, 1, 0),
 /*04*/	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, COMPAT2_execveat, 0, 14),
-	/* Trace execve(2)/execveat(2) syscalls (w/ compat flag) */
-/*05*/	BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRACE | COMPAT_FLAG),
+	/* Trace or notify on compat execve(2)/execveat(2) syscalls */
+/*05*/	BPF_STMT(BPF_RET | BPF_K, compat_action),
 # endif /* SECCOMP_AUDIT_ARCH_COMPAT2 */
 # ifdef SECCOMP_AUDIT_ARCH_COMPAT
 	/* Match on the compat architecture or jump to the native arch check. */
@@ -1327,8 +1813,8 @@ set_exec_filter(void)
 	/* Jump to trace for compat execve(2)/execveat(2), else allow. */
 /*08*/	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, COMPAT_execve, 1, 0),
 /*09*/	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, COMPAT_execveat, 0, 9),
-	/* Trace execve(2)/execveat(2) syscalls (w/ compat flag) */
-/*10*/	BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRACE | COMPAT_FLAG),
+	/* Trace or notify on compat execve(2)/execveat(2) syscalls */
+/*10*/	BPF_STMT(BPF_RET | BPF_K, compat_action),
 # endif /* SECCOMP_AUDIT_ARCH_COMPAT */
 	/* Kill the process unless the (native) architecture matches. */
 /*11*/	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0),
@@ -1347,8 +1833,8 @@ set_exec_filter(void)
 	/* If no x32 support, these two instructions are never reached. */
 /*16*/	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_execve, 1, 0),
 /*17*/	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_execveat, 0, 1),
-	/* Trace execve(2)/execveat(2) syscalls */
-/*18*/	BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRACE),
+	/* Trace or notify on execve(2)/execveat(2) syscalls */
+/*18*/	BPF_STMT(BPF_RET | BPF_K, action),
 	/* Allow non-matching syscalls */
 /*19*/	BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW)
     };
@@ -1356,16 +1842,123 @@ set_exec_filter(void)
 	nitems(exec_filter),
 	exec_filter
     };
-    debug_decl(set_exec_filter, SUDO_DEBUG_EXEC);
+    debug_decl(install_exec_filter, SUDO_DEBUG_EXEC);
+
+# ifdef SECCOMP_NOTIFY_SUPPORTED
+    if (listenerp != NULL) {
+	/* The listener can only be created via seccomp(2) directly. */
+	const int fd = (int)syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER,
+	    SECCOMP_FILTER_FLAG_NEW_LISTENER, &exec_fprog);
+	if (fd == -1)
+	    debug_return_bool(false);
+	*listenerp = fd;
+	debug_return_bool(true);
+    }
+# endif /* SECCOMP_NOTIFY_SUPPORTED */
 
     /* We must set SECCOMP_MODE_FILTER before dropping privileges. */
-    if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &exec_fprog) == -1) {
+    if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &exec_fprog) == -1)
+	debug_return_bool(false);
+    debug_return_bool(true);
+}
+
+/*
+ * Intercept execve(2) and execveat(2) using seccomp(2) and ptrace(2).
+ * If no tracer is present, execve(2) and execveat(2) will fail with ENOSYS.
+ * Must be called with CAP_SYS_ADMIN, before privs are dropped.
+ */
+bool
+set_exec_filter(void)
+{
+    debug_decl(set_exec_filter, SUDO_DEBUG_EXEC);
+
+    if (!install_exec_filter(SECCOMP_RET_TRACE,
+	    SECCOMP_RET_TRACE | COMPAT_FLAG, NULL)) {
 	sudo_warn("%s", U_("unable to set seccomp filter"));
 	debug_return_bool(false);
     }
     debug_return_bool(true);
 }
 
+# ifdef SECCOMP_NOTIFY_SUPPORTED
+/*
+ * Intercept execve(2) and execveat(2) using seccomp(2) user notification.
+ * The notification fd is passed to the parent over intercept_fd.
+ * If a listener is already installed (we are running under another
+ * sudo in seccomp mode), the parent is told to leave us alone.
+ * Must be called with CAP_SYS_ADMIN, before privs are dropped.
+ */
+bool
+set_exec_notify_filter(int intercept_fd)
+{
+    char cmsgbuf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov[1];
+    int listener = -1;
+    char ch = '\0';
+    ssize_t nsent;
+    debug_decl(set_exec_notify_filter, SUDO_DEBUG_EXEC);
+
+    if (!install_exec_filter(SECCOMP_RET_USER_NOTIF, SECCOMP_RET_USER_NOTIF,
+	    &listener)) {
+	/* Only one listener is allowed per filter chain. */
+	if (errno != EBUSY) {
+	    sudo_warn("%s", U_("unable to set seccomp filter"));
+	    debug_return_bool(false);
+	}
+	sudo_debug_printf(SUDO_DEBUG_WARN,
+	    "%s: seccomp listener already present", __func__);
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    iov[0].iov_base = &ch;
+    iov[0].iov_len = 1;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    if (listener != -1) {
+	memset(cmsgbuf, 0, sizeof(cmsgbuf));
+	msg.msg_control = cmsgbuf;
+	msg.msg_controllen = sizeof(cmsgbuf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	memcpy(CMSG_DATA(cmsg), &listener, sizeof(int));
+    }
+    do {
+	nsent = sendmsg(intercept_fd, &msg, 0);
+    } while (nsent == -1 && errno == EINTR);
+    if (listener != -1)
+	close(listener);
+    if (nsent == -1) {
+	sudo_warn("%s", U_("unable to send message to parent"));
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
+# endif /* SECCOMP_NOTIFY_SUPPORTED */
+
+/*
+ * Initialize the page size and maximum argument size.
+ */
+static void
+init_limits(void)
+{
+    debug_decl(init_limits, SUDO_DEBUG_EXEC);
+
+#ifdef HAVE_PROCESS_VM_READV
+    page_size = (size_t)sysconf(_SC_PAGESIZE);
+    if (page_size == (size_t)-1)
+	page_size = 4096;
+#endif
+    arg_max = (size_t)sysconf(_SC_ARG_MAX);
+    if (arg_max == (size_t)-1)
+	arg_max = 128 * 1024;
+
+    debug_return;
+}
+
 /*
  * Seize control of the specified child process which must be in
  * ptrace wait.  Returns true on success, false if child is already
@@ -1381,14 +1974,7 @@ exec_ptrace_seize(pid_t child, int intercept_fd)
     int ret = true;
     debug_decl(exec_ptrace_seize, SUDO_DEBUG_EXEC);
 
-#ifdef HAVE_PROCESS_VM_READV
-    page_size = (size_t)sysconf(_SC_PAGESIZE);
-    if (page_size == (size_t)-1)
-	page_size = 4096;
-#endif
-    arg_max = (size_t)sysconf(_SC_ARG_MAX);
-    if (arg_max == (size_t)-1)
-	arg_max = 128 * 1024;
+    init_limits();
 
     /* Seize control of the child process. */
     if (ptrace(PTRACE_SEIZE, child, NULL, ptrace_opts) == -1) {
@@ -2221,6 +2807,395 @@ exec_ptrace_stopped(pid_t pid, int status, void *intercept)
     debug_return_bool(group_stop);
 }
 
+# ifdef SECCOMP_NOTIFY_SUPPORTED
+/*
+ * Determine whether the system call in a seccomp(2) notification is
+ * execve(2) or execveat(2) and fill in the machine-dependent parameters.
+ * Returns true on success, false for an unexpected system call.
+ */
+static bool
+seccomp_get_syscall(const struct seccomp_data *data,
+    struct sudo_ptrace_regs *regs, bool *is_execveat)
+{
+    debug_decl(seccomp_get_syscall, SUDO_DEBUG_EXEC);
+
+    memset(regs, 0, sizeof(*regs));
+    regs->wordsize = sizeof(long);
+
+#  ifdef SECCOMP_AUDIT_ARCH_COMPAT2
+    if (data->arch == SECCOMP_AUDIT_ARCH_COMPAT2) {
+	regs->compat = true;
+	regs->wordsize = sizeof(int);
+	switch (data->nr) {
+	case COMPAT2_execve:
+	    *is_execveat = false;
+	    debug_return_bool(true);
+	case COMPAT2_execveat:
+	    *is_execveat = true;
+	    debug_return_bool(true);
+	}
+	debug_return_bool(false);
+    }
+#  endif /* SECCOMP_AUDIT_ARCH_COMPAT2 */
+#  ifdef SECCOMP_AUDIT_ARCH_COMPAT
+    if (data->arch == SECCOMP_AUDIT_ARCH_COMPAT) {
+	regs->compat = true;
+	regs->wordsize = sizeof(int);
+	switch (data->nr) {
+	case COMPAT_execve:
+	    *is_execveat = false;
+	    debug_return_bool(true);
+	case COMPAT_execveat:
+	    *is_execveat = true;
+	    debug_return_bool(true);
+	}
+	debug_return_bool(false);
+    }
+#  endif /* SECCOMP_AUDIT_ARCH_COMPAT */
+    switch (data->nr) {
+#  ifdef X32_execve
+    case X32_execve:
+#  endif
+    case __NR_execve:
+	*is_execveat = false;
+	debug_return_bool(true);
+#  ifdef X32_execveat
+    case X32_execveat:
+#  endif
+    case __NR_execveat:
+	*is_execveat = true;
+	debug_return_bool(true);
+    }
+    debug_return_bool(false);
+}
+
+/*
+ * Intercept execve(2) via a seccomp(2) user notification and perform
+ * a policy check.  Unlike ptrace(2), the process is not stopped by a
+ * tracer so we cannot rewrite its arguments.  If the policy changed
+ * the command or its arguments in intercept mode, the command is
+ * rejected instead.
+ * Returns 0 if the system call should proceed, -1 if the notification
+ * is no longer valid, else the errno value to fail the system call with.
+ */
+static int
+seccomp_intercept_execve(int fd, const struct seccomp_notif *req,
+    struct intercept_closure *closure)
+{
+    char *pathname, **argv, **envp, *buf = NULL;
+    const unsigned int flags = closure->details->flags;
+    const pid_t pid = (pid_t)req->pid;
+    struct sudo_ptrace_regs regs;
+    char cwd[PATH_MAX], *orig_argv0;
+    unsigned long args[5];
+    bool is_execveat;
+    int argc, envc, i, oldcwd = -1;
+    int ret = EACCES;
+    debug_decl(seccomp_intercept_execve, SUDO_DEBUG_EXEC);
+
+    /* Do not check the policy if we are executing the initial command. */
+    if (closure->initial_command != 0) {
+	closure->initial_command--;
+	debug_return_int(0);
+    }
+
+    if (!seccomp_get_syscall(&req->data, &regs, &is_execveat)) {
+	sudo_warnx("%s: unexpected system call %d", __func__, req->data.nr);
+	debug_return_int(EACCES);
+    }
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: %d: compat: %s, wordsize: %u",
+	__func__, (int)pid, regs.compat ? "true" : "false", regs.wordsize);
+    for (i = 0; i < 5; i++)
+	args[i] = (unsigned long)req->data.args[i];
+    if (regs.compat) {
+	for (i = 0; i < 5; i++)
+	    args[i] &= 0xffffffff;
+    }
+
+    /* Get the current working directory and execve info. */
+    if (proc_read_link(pid, "cwd", cwd, sizeof(cwd)) == -1)
+	(void)strlcpy(cwd, "unknown", sizeof(cwd));
+    buf = read_exec_info(pid, is_execveat, &regs, args, &pathname, &argc,
+	&argv, &envc, &envp);
+
+    /* The pid may have been reused if the notification is no longer valid. */
+    if (ioctl(fd, SECCOMP_IOCTL_NOTIF_ID_VALID, &req->id) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_ERRNO,
+	    "%s: %d: notification no longer valid", __func__, (int)pid);
+	ret = -1;
+	goto done;
+    }
+
+    if (buf == NULL) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+	    "%s: %d: unable to get execve info", __func__, (int)pid);
+	ret = errno == ENOMEM ? ENOMEM : EFAULT;
+	goto done;
+    }
+
+    /* Must have a pathname. */
+    if (pathname == NULL) {
+	ret = EINVAL;
+	goto done;
+    }
+
+    /* We can only pass the pathname to execute via argv[0] (plugin API). */
+    orig_argv0 = argv[0] ? argv[0] : (char *)"";
+    argv[0] = pathname;
+    if (argc == 0) {
+	/* Treat an empty argv[] as the path to execute. */
+	argv[1] = NULL;
+	argc = 1;
+    }
+
+    /* Perform a policy check. */
+    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: %d: checking policy for %s",
+	__func__, (int)pid, pathname);
+    if (!intercept_check_policy(pathname, argc, argv, envc, envp, cwd,
+	    &oldcwd, closure)) {
+	if (closure->errstr != NULL)
+	    sudo_warnx("%s", U_(closure->errstr));
+    }
+
+    /* Restore original argv[0] after policy check (if set). */
+    if (*orig_argv0 != '\0')
+	argv[0] = orig_argv0;
+
+    switch (closure->state) {
+    case POLICY_TEST:
+    case POLICY_ACCEPT:
+	ret = 0;
+	if (!ISSET(flags, CD_INTERCEPT) || closure->command == NULL ||
+		closure->run_argv == NULL)
+	    break;
+
+	/*
+	 * We cannot update the pathname or argv in the process.
+	 * The policy may resolve the path differently (symbolic links)
+	 * and argv[0] is not checked since it is not used to find the
+	 * command, but anything else must match exactly.
+	 */
+	if (!pathname_matches(pathname, closure->command, true)) {
+	    sudo_warnx(U_("%s mismatch, expected \"%s\", got \"%s\""),
+		"pathname", closure->command, pathname);
+	    ret = EACCES;
+	    break;
+	}
+	for (i = 1; i < argc; i++) {
+	    if (closure->run_argv[i] == NULL ||
+		    strcmp(closure->run_argv[i], argv[i]) != 0)
+		break;
+	}
+	if (i != argc || closure->run_argv[i] != NULL) {
+	    sudo_warnx(U_("unable to update arguments for %s"), pathname);
+	    ret = EACCES;
+	}
+	break;
+    case POLICY_REJECT:
+	/* If rejected, fail the syscall with EACCES */
+	ret = EACCES;
+	break;
+    default:
+	ret = errno ? errno : EACCES;
+	break;
+    }
+
+done:
+    if (oldcwd != -1) {
+	if (fchdir(oldcwd) == -1) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO,
+		"%s: unable to restore saved cwd", __func__);
+	}
+	close(oldcwd);
+    }
+    free(buf);
+    intercept_closure_reset(closure);
+
+    debug_return_int(ret);
+}
+
+/*
+ * Handle a seccomp(2) user notification for execve(2) or execveat(2).
+ * The system call either continues or fails with the error we inject.
+ */
+static void
+seccomp_notify_cb(int fd, int what, void *v)
+{
+    struct intercept_closure *closure = v;
+    int rc;
+    debug_decl(seccomp_notify_cb, SUDO_DEBUG_EXEC);
+
+    memset(notify_req, 0, notify_sizes.seccomp_notif);
+    if (ioctl(fd, SECCOMP_IOCTL_NOTIF_RECV, notify_req) == -1) {
+	/* The process may have been killed before we got the notification. */
+	if (errno != EINTR && errno != ENOENT) {
+	    /*
+	     * Stop listening and close the listener so that any execve(2)
+	     * from the command fails with ENOSYS instead of blocking.
+	     */
+	    sudo_warn("%s: ioctl(SECCOMP_IOCTL_NOTIF_RECV)", __func__);
+	    sudo_ev_del(NULL, notify_ev);
+	    if (notify_fd != -1) {
+		close(notify_fd);
+		notify_fd = -1;
+	    }
+	}
+	debug_return;
+    }
+
+    rc = seccomp_intercept_execve(fd, notify_req, closure);
+    if (rc == -1)
+	debug_return;
+
+    memset(notify_resp, 0, notify_sizes.seccomp_notif_resp);
+    notify_resp->id = notify_req->id;
+    if (rc == 0) {
+	notify_resp->flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+    } else {
+	notify_resp->error = -rc;
+    }
+    if (ioctl(fd, SECCOMP_IOCTL_NOTIF_SEND, notify_resp) == -1) {
+	if (errno != ENOENT)
+	    sudo_warn("%s: ioctl(SECCOMP_IOCTL_NOTIF_SEND)", __func__);
+    }
+
+    debug_return;
+}
+
+/*
+ * Receive the seccomp(2) notification fd from the command over
+ * intercept_fd and add an event for it to evbase.
+ * Returns true on success, false if the command is already being
+ * intercepted by another sudo and -1 on error.
+ */
+int
+exec_seccomp_listen(int intercept_fd, struct sudo_event_base *evbase,
+    void *intercept)
+{
+    char cmsgbuf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov[1];
+    ssize_t nread;
+    int fd = -1;
+    char ch;
+    debug_decl(exec_seccomp_listen, SUDO_DEBUG_EXEC);
+
+    /* The command sends the listener before it is executed. */
+    memset(&msg, 0, sizeof(msg));
+    iov[0].iov_base = &ch;
+    iov[0].iov_len = 1;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsgbuf;
+    msg.msg_controllen = sizeof(cmsgbuf);
+    do {
+	nread = recvmsg(intercept_fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (nread == -1 && errno == EINTR);
+    if (nread <= 0) {
+	if (nread == 0) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR,
+		"%s: command exited before sending seccomp listener",
+		__func__);
+	    errno = ECONNRESET;
+	} else {
+	    sudo_warn("%s", U_("unable to receive message from child"));
+	}
+	debug_return_int(-1);
+    }
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+	    cmsg->cmsg_type == SCM_RIGHTS &&
+	    cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (fd == -1) {
+	sudo_debug_printf(SUDO_DEBUG_WARN,
+	    "%s: no seccomp listener, already being intercepted?", __func__);
+	debug_return_int(false);
+    }
+
+    init_limits();
+    if (syscall(__NR_seccomp, SECCOMP_GET_NOTIF_SIZES, 0,
+	    &notify_sizes) == -1) {
+	sudo_warn("%s: seccomp(SECCOMP_GET_NOTIF_SIZES)", __func__);
+	goto bad;
+    }
+    free(notify_req);
+    free(notify_resp);
+    notify_req = calloc(1, notify_sizes.seccomp_notif);
+    notify_resp = calloc(1, notify_sizes.seccomp_notif_resp);
+    if (notify_req == NULL || notify_resp == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	goto bad;
+    }
+
+    sudo_ev_free(notify_ev);
+    notify_ev = sudo_ev_alloc(fd, SUDO_EV_READ|SUDO_EV_PERSIST,
+	seccomp_notify_cb, intercept);
+    if (notify_ev == NULL) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	goto bad;
+    }
+    if (sudo_ev_add(evbase, notify_ev, NULL, false) == -1) {
+	sudo_warn("%s", U_("unable to add event to queue"));
+	goto bad;
+    }
+    if (notify_fd != -1)
+	close(notify_fd);
+    notify_fd = fd;
+
+    debug_return_int(true);
+bad:
+    close(fd);
+    debug_return_int(-1);
+}
+
+/*
+ * Free the seccomp(2) notification event and close the listener.
+ */
+void
+exec_seccomp_cleanup(void)
+{
+    debug_decl(exec_seccomp_cleanup, SUDO_DEBUG_EXEC);
+
+    sudo_ev_free(notify_ev);
+    notify_ev = NULL;
+    if (notify_fd != -1) {
+	close(notify_fd);
+	notify_fd = -1;
+    }
+    free(notify_req);
+    notify_req = NULL;
+    free(notify_resp);
+    notify_resp = NULL;
+
+    debug_return;
+}
+
+/*
+ * Check whether seccomp(2) user notification can be used to intercept
+ * commands.  SECCOMP_USER_NOTIF_FLAG_CONTINUE requires Linux 5.5.
+ */
+bool
+exec_seccomp_notify_supported(void)
+{
+    struct utsname un;
+    unsigned int major = 0, minor = 0;
+    debug_decl(exec_seccomp_notify_supported, SUDO_DEBUG_EXEC);
+
+    if (seccomp_notify_supported == -1) {
+	seccomp_notify_supported = false;
+	if (uname(&un) == 0 &&
+		sscanf(un.release, "%u.%u", &major, &minor) == 2 &&
+		(major > 5 || (major == 5 && minor >= 5))) {
+	    seccomp_notify_supported = have_seccomp_action("user_notif");
+	}
+    }
+    debug_return_bool(seccomp_notify_supported == true);
+}
+# endif /* SECCOMP_NOTIFY_SUPPORTED */
+
 bool
 exec_ptrace_intercept_supported(void)
 {
@@ -2273,14 +3248,61 @@ exec_ptrace_subcmds_supported(void)
 }
 #endif /* HAVE_PTRACE_INTERCEPT */
 
+#ifndef SECCOMP_NOTIFY_SUPPORTED
+/* STUB */
+bool
+set_exec_notify_filter(int intercept_fd)
+{
+    return false;
+}
+
+/* STUB */
+int
+exec_seccomp_listen(int intercept_fd, struct sudo_event_base *evbase,
+    void *intercept)
+{
+    return true;
+}
+
+/* STUB */
+void
+exec_seccomp_cleanup(void)
+{
+    return;
+}
+
+/* STUB */
+bool
+exec_seccomp_notify_supported(void)
+{
+    return false;
+}
+#endif /* SECCOMP_NOTIFY_SUPPORTED */
+
 /*
- * Adjust flags based on the availability of ptrace support.
+ * Adjust flags based on the availability of ptrace and seccomp support.
  */
 void
 exec_ptrace_fix_flags(struct command_details *details)
 {
     debug_decl(exec_ptrace_fix_flags, SUDO_DEBUG_EXEC);
 
+    if (ISSET(details->flags, CD_USE_SECCOMP)) {
+	CLR(details->flags, CD_USE_SECCOMP);
+	if (!ISSET(details->flags, CD_INTERCEPT|CD_LOG_SUBCMDS)) {
+	    CLR(details->flags, CD_USE_PTRACE);
+	} else if (ISSET(details->flags, CD_INTERCEPT) &&
+		ISSET(details->flags, CD_INTERCEPT_VERIFY)) {
+	    /* Verifying the command after execve(2) requires ptrace. */
+	    SET(details->flags, CD_USE_PTRACE);
+	} else if (!exec_seccomp_notify_supported()) {
+	    /* Fall back to ptrace if seccomp notification is unavailable. */
+	    SET(details->flags, CD_USE_PTRACE);
+	} else {
+	    SET(details->flags, CD_USE_SECCOMP);
+	    CLR(details->flags, CD_USE_PTRACE);
+	}
+    }
     if (ISSET(details->flags, CD_USE_PTRACE)) {
 	/* If both CD_INTERCEPT and CD_LOG_SUBCMDS set, CD_INTERCEPT wins. */
 	if (ISSET(details->flags, CD_INTERCEPT)) {
@@ -383,7 +383,12 @@ read_callback(int fd, int what, void *v)
     sa.sa_handler = sigttin;
     got_sigttin = 0;
     sigaction(SIGTTIN, &sa, &osa);
-    n = read(fd, iob->buf + iob->len, sizeof(iob->buf) - iob->len);
+#ifdef HAVE_SPLICE
+    if (iob->splice)
+	n = io_buf_splice_read(fd, iob);
+    else
+#endif
+	n = read(fd, iob->buf + iob->len, sizeof(iob->buf) - iob->len);
     saved_errno = errno;
     sigaction(SIGTTIN, &osa, NULL);
     errno = saved_errno;
@@ -435,7 +440,7 @@ read_callback(int fd, int what, void *v)
 	    }
 	    iob->len += (unsigned int)n;
 	    /* Disable reader if buffer is full. */
-	    if (iob->len == sizeof(iob->buf))
+	    if (IOB_FULL(iob))
 		sudo_ev_del(evbase, iob->revent);
 	    /* Enable writer now that there is new data in the buffer. */
 	    if (iob->wevent != NULL) {
@@ -482,7 +487,12 @@ write_callback(int fd, int what, void *v)
     sa.sa_handler = sigttou;
     got_sigttou = 0;
     sigaction(SIGTTOU, &sa, &osa);
-    n = write(fd, iob->buf + iob->off, iob->len - iob->off);
+#ifdef HAVE_SPLICE
+    if (iob->splice)
+	n = io_buf_splice_write(fd, iob);
+    else
+#endif
+	n = write(fd, iob->buf + iob->off, iob->len - iob->off);
     saved_errno = errno;
     sigaction(SIGTTOU, &osa, NULL);
     errno = saved_errno;
@@ -550,7 +560,7 @@ write_callback(int fd, int what, void *v)
 	 * Enable reader if buffer is not full but avoid reading /dev/tty
 	 * if not in raw mode or the command is no longer running.
 	 */
-	if (iob->revent != NULL && iob->len != sizeof(iob->buf)) {
+	if (iob->revent != NULL && !IOB_FULL(iob)) {
 	    if (!USERTTY_EVENT(iob->revent) ||
 		    (iob->ec->term_raw && iob->ec->cmnd_pid != -1)) {
 		if (sudo_ev_add(evbase, iob->revent, NULL, false) == -1)
@@ -727,6 +737,21 @@ backchannel_cb(int fd, int what, void *v)
 		    }
 		    sudo_ev_loopbreak(ec->evbase);
 		}
+	    } else if (ISSET(ec->details->flags, CD_USE_SECCOMP)) {
+		/* Receive the seccomp(2) notification fd from the command. */
+		const int rc = exec_seccomp_listen(ec->intercept_fd, ec->evbase,
+		    ec->intercept);
+		if (rc == 0) {
+		    /* The command is already being intercepted. */
+		    CLR(ec->details->flags,
+			CD_INTERCEPT|CD_LOG_SUBCMDS|CD_USE_SECCOMP);
+		} else if (rc == -1) {
+		    if (ec->cstat->type == CMD_INVALID) {
+			ec->cstat->type = CMD_ERRNO;
+			ec->cstat->val = errno;
+		    }
+		    sudo_ev_loopbreak(ec->evbase);
+		}
 	    }
 	    break;
 	case CMD_WSTATUS:
@@ -1110,6 +1135,7 @@ exec_pty(struct command_details *details,
     int sv[2], intercept_sv[2] = { -1, -1 };
     struct exec_closure *ec = &pty_ec;
     struct plugin_container *plugin;
+    struct io_buffer *iob;
     const pid_t sudo_pid = getpid();
     const pid_t ppgrp = getpgrp();
     int evloop_retries = -1;
@@ -1142,7 +1168,7 @@ exec_pty(struct command_details *details,
 	 */
 	if (socketpair(PF_UNIX, SOCK_STREAM, 0, intercept_sv) == -1)
 	    sudo_fatal("%s", U_("unable to create sockets"));
-        if (ISSET(details->flags, CD_USE_PTRACE)) {
+        if (ISSET(details->flags, CD_USE_PTRACE|CD_USE_SECCOMP)) {
 	    if (fcntl(intercept_sv[0], F_SETFD, FD_CLOEXEC) == -1 ||
 		    fcntl(intercept_sv[1], F_SETFD, FD_CLOEXEC) == -1) {
 		sudo_fatal("%s", U_("unable to create sockets"));
@@ -1225,8 +1251,9 @@ exec_pty(struct command_details *details,
 	    SET(details->flags, CD_EXEC_BG);
 	    if (pipe2(io_pipe[STDIN_FILENO], O_CLOEXEC) != 0)
 		sudo_fatal("%s", U_("unable to create pipe"));
-	    io_buf_new(STDIN_FILENO, io_pipe[STDIN_FILENO][1],
+	    iob = io_buf_new(STDIN_FILENO, io_pipe[STDIN_FILENO][1],
 		log_stdin, read_callback, write_callback, ec);
+	    (void)io_buf_splice(iob);
 	    io_fds[SFD_STDIN] = io_pipe[STDIN_FILENO][0];
 	} else if (ISSET(details->flags, CD_BACKGROUND) && S_ISCHR(sb.st_mode)) {
 	    /*
@@ -1273,8 +1300,9 @@ exec_pty(struct command_details *details,
 	    term_raw_flags = SUDO_TERM_OFLAG;
 	    if (pipe2(io_pipe[STDOUT_FILENO], O_CLOEXEC) != 0)
 		sudo_fatal("%s", U_("unable to create pipe"));
-	    io_buf_new(io_pipe[STDOUT_FILENO][0], STDOUT_FILENO,
+	    iob = io_buf_new(io_pipe[STDOUT_FILENO][0], STDOUT_FILENO,
 		log_stdout, read_callback, write_callback, ec);
+	    (void)io_buf_splice(iob);
 	    io_fds[SFD_STDOUT] = io_pipe[STDOUT_FILENO][1];
 	} else {
 	    /* Not logging stdout, do not interpose. */
@@ -1295,8 +1323,9 @@ exec_pty(struct command_details *details,
 		"stderr not user's tty, creating a pipe");
 	    if (pipe2(io_pipe[STDERR_FILENO], O_CLOEXEC) != 0)
 		sudo_fatal("%s", U_("unable to create pipe"));
-	    io_buf_new(io_pipe[STDERR_FILENO][0], STDERR_FILENO,
+	    iob = io_buf_new(io_pipe[STDERR_FILENO][0], STDERR_FILENO,
 		log_stderr, read_callback, write_callback, ec);
+	    (void)io_buf_splice(iob);
 	    io_fds[SFD_STDERR] = io_pipe[STDERR_FILENO][1];
 	} else {
 	    /* Not logging stderr, do not interpose. */
@@ -1410,6 +1439,8 @@ exec_pty(struct command_details *details,
     if (io_pipe[STDERR_FILENO][1] != -1)
 	close(io_pipe[STDERR_FILENO][1]);
     close(sv[1]);
+    if (intercept_sv[1] != -1)
+	close(intercept_sv[1]);
 
     /* No longer need execfd. */
     if (details->execfd != -1) {
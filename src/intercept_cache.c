@@ -0,0 +1,395 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Cache of policy decisions for intercepted commands.
+ *
+ * Builds tend to run the same commands with the same arguments over
+ * and over again.  Rather than calling the policy plugin's check_policy
+ * function each time, we remember the command_info[] and run_argv[]
+ * of accepted commands for a limited time.  An entry is keyed by the
+ * command path, working directory and the complete argument vector.
+ * It is only used if the command's device, inode, size, mode, owner,
+ * mtime and ctime are unchanged, so a modified or replaced command
+ * (which may no longer match a digest) is checked again.  Rejected
+ * commands are not cached.  The audit and approval plugins are still
+ * called for every command.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sudo.h>
+#include <sudo_exec.h>
+#include <exec_intercept.h>
+
+#define INTERCEPT_CACHE_BUCKETS	256	/* must be a power of 2 */
+#define INTERCEPT_CACHE_MAX	1024	/* max number of entries */
+
+struct intercept_cache_entry {
+    TAILQ_ENTRY(intercept_cache_entry) entries;
+    TAILQ_ENTRY(intercept_cache_entry) lru;
+    unsigned int hash;
+    int argc;
+    char *command;
+    char *runcwd;
+    char **argv;
+    char **command_info;
+    char **run_argv;
+    struct timespec expires;
+    struct timespec mtime;
+    time_t ctime;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+};
+TAILQ_HEAD(intercept_cache_list, intercept_cache_entry);
+
+static struct intercept_cache {
+    struct intercept_cache_list buckets[INTERCEPT_CACHE_BUCKETS];
+    struct intercept_cache_list lru;	/* most recently used first */
+    unsigned int timeout;		/* in seconds, 0 if disabled */
+    unsigned int nentries;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int expired;
+    unsigned int stale;
+    unsigned int evicted;
+} cache;
+
+/* FNV-1a hash of the command, working directory and arguments. */
+static unsigned int
+intercept_cache_hash(const char *command, const char *runcwd, int argc,
+    char * const argv[])
+{
+    unsigned int h = 2166136261U;
+    const char *cp;
+    int i;
+
+    for (cp = command; *cp != '\0'; cp++) {
+	h ^= (unsigned char)*cp;
+	h *= 16777619U;
+    }
+    h *= 16777619U;
+    for (cp = runcwd; *cp != '\0'; cp++) {
+	h ^= (unsigned char)*cp;
+	h *= 16777619U;
+    }
+    for (i = 0; i < argc; i++) {
+	h *= 16777619U;
+	for (cp = argv[i]; *cp != '\0'; cp++) {
+	    h ^= (unsigned char)*cp;
+	    h *= 16777619U;
+	}
+    }
+    return h;
+}
+
+static void
+free_vector(char **vec)
+{
+    char **cur;
+
+    if (vec != NULL) {
+	for (cur = vec; *cur != NULL; cur++)
+	    free(*cur);
+	free(vec);
+    }
+}
+
+/*
+ * Copy a NULL-terminated vector, or the first len entries if len >= 0.
+ */
+static char **
+copy_vector(char * const vec[], int len)
+{
+    char **copy;
+    size_t i, n;
+
+    if (len >= 0) {
+	n = (size_t)len;
+    } else {
+	for (n = 0; vec[n] != NULL; n++)
+	    continue;
+    }
+    if ((copy = reallocarray(NULL, n + 1, sizeof(char *))) == NULL)
+	return NULL;
+    for (i = 0; i < n; i++) {
+	if ((copy[i] = strdup(vec[i])) == NULL) {
+	    copy[i] = NULL;
+	    free_vector(copy);
+	    return NULL;
+	}
+    }
+    copy[i] = NULL;
+    return copy;
+}
+
+static void
+intercept_cache_entry_free(struct intercept_cache_entry *entry)
+{
+    free(entry->command);
+    free(entry->runcwd);
+    free_vector(entry->argv);
+    free_vector(entry->command_info);
+    free_vector(entry->run_argv);
+    free(entry);
+}
+
+static void
+intercept_cache_remove(struct intercept_cache_entry *entry)
+{
+    TAILQ_REMOVE(&cache.buckets[entry->hash & (INTERCEPT_CACHE_BUCKETS - 1)],
+	entry, entries);
+    TAILQ_REMOVE(&cache.lru, entry, lru);
+    cache.nentries--;
+    intercept_cache_entry_free(entry);
+}
+
+static struct intercept_cache_entry *
+intercept_cache_find(unsigned int hash, const char *command,
+    const char *runcwd, int argc, char * const argv[])
+{
+    struct intercept_cache_list *bucket =
+	&cache.buckets[hash & (INTERCEPT_CACHE_BUCKETS - 1)];
+    struct intercept_cache_entry *entry;
+    int i;
+
+    TAILQ_FOREACH(entry, bucket, entries) {
+	if (entry->hash != hash || entry->argc != argc)
+	    continue;
+	if (strcmp(entry->command, command) != 0 ||
+		strcmp(entry->runcwd, runcwd) != 0)
+	    continue;
+	for (i = 0; i < argc; i++) {
+	    if (strcmp(entry->argv[i], argv[i]) != 0)
+		break;
+	}
+	if (i == argc)
+	    return entry;
+    }
+    return NULL;
+}
+
+/*
+ * Returns true if the command has not changed since the entry was stored.
+ */
+static bool
+intercept_cache_same_file(const struct intercept_cache_entry *entry,
+    const struct stat *sb)
+{
+    struct timespec mtime;
+
+    mtim_get(sb, mtime);
+    return entry->dev == sb->st_dev && entry->ino == sb->st_ino &&
+	entry->size == sb->st_size && entry->mode == sb->st_mode &&
+	entry->uid == sb->st_uid && entry->gid == sb->st_gid &&
+	entry->ctime == sb->st_ctime &&
+	sudo_timespeccmp(&entry->mtime, &mtime, ==);
+}
+
+/*
+ * Enable the cache, entries expire after timeout seconds.
+ */
+void
+intercept_cache_init(unsigned int timeout)
+{
+    unsigned int i;
+    debug_decl(intercept_cache_init, SUDO_DEBUG_EXEC);
+
+    if (cache.timeout == 0) {
+	for (i = 0; i < INTERCEPT_CACHE_BUCKETS; i++)
+	    TAILQ_INIT(&cache.buckets[i]);
+	TAILQ_INIT(&cache.lru);
+    }
+    cache.timeout = timeout;
+
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"caching policy decisions for %u seconds", timeout);
+
+    debug_return;
+}
+
+/*
+ * Look up a previous policy decision for command.  The sb argument
+ * is the result of stat(2) on command, argv must contain argc entries.
+ * On success, fills in command_info and run_argv, which remain valid
+ * until the cache is next modified, and returns true.
+ */
+bool
+intercept_cache_lookup(const char *command, const struct stat *sb,
+    int argc, char * const argv[], const char *runcwd,
+    char ***command_info, char ***run_argv)
+{
+    struct intercept_cache_entry *entry;
+    struct timespec now;
+    unsigned int hash;
+    debug_decl(intercept_cache_lookup, SUDO_DEBUG_EXEC);
+
+    if (cache.timeout == 0)
+	debug_return_bool(false);
+    if (runcwd == NULL)
+	runcwd = "";
+
+    hash = intercept_cache_hash(command, runcwd, argc, argv);
+    entry = intercept_cache_find(hash, command, runcwd, argc, argv);
+    if (entry == NULL) {
+	cache.misses++;
+	debug_return_bool(false);
+    }
+    if (sudo_gettime_mono(&now) == -1 ||
+	    sudo_timespeccmp(&now, &entry->expires, >=)) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "cached decision for %s has expired", command);
+	intercept_cache_remove(entry);
+	cache.expired++;
+	cache.misses++;
+	debug_return_bool(false);
+    }
+    if (!intercept_cache_same_file(entry, sb)) {
+	sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	    "%s has changed, ignoring cached decision", command);
+	intercept_cache_remove(entry);
+	cache.stale++;
+	cache.misses++;
+	debug_return_bool(false);
+    }
+
+    /* Move to the front of the LRU list. */
+    TAILQ_REMOVE(&cache.lru, entry, lru);
+    TAILQ_INSERT_HEAD(&cache.lru, entry, lru);
+    cache.hits++;
+
+    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+	"using cached decision for %s (%u hits, %u misses)", command,
+	cache.hits, cache.misses);
+
+    *command_info = entry->command_info;
+    *run_argv = entry->run_argv;
+    debug_return_bool(true);
+}
+
+/*
+ * Store the policy decision for an accepted command.
+ * The arguments are the same as for intercept_cache_lookup() with
+ * command_info and run_argv as returned by the policy plugin.
+ * Returns true on success, else false.
+ */
+bool
+intercept_cache_store(const char *command, const struct stat *sb,
+    int argc, char * const argv[], const char *runcwd,
+    char * const command_info[], char * const run_argv[])
+{
+    struct intercept_cache_entry *entry;
+    unsigned int hash;
+    debug_decl(intercept_cache_store, SUDO_DEBUG_EXEC);
+
+    if (cache.timeout == 0)
+	debug_return_bool(false);
+    if (runcwd == NULL)
+	runcwd = "";
+
+    hash = intercept_cache_hash(command, runcwd, argc, argv);
+    entry = intercept_cache_find(hash, command, runcwd, argc, argv);
+    if (entry != NULL)
+	intercept_cache_remove(entry);
+
+    if (cache.nentries >= INTERCEPT_CACHE_MAX) {
+	/* Evict the least recently used entry. */
+	intercept_cache_remove(TAILQ_LAST(&cache.lru, intercept_cache_list));
+	cache.evicted++;
+    }
+
+    if ((entry = calloc(1, sizeof(*entry))) == NULL)
+	goto oom;
+    entry->hash = hash;
+    entry->argc = argc;
+    entry->command = strdup(command);
+    entry->runcwd = strdup(runcwd);
+    entry->argv = copy_vector(argv, argc);
+    entry->command_info = copy_vector(command_info, -1);
+    entry->run_argv = copy_vector(run_argv, -1);
+    if (entry->command == NULL || entry->runcwd == NULL ||
+	    entry->argv == NULL || entry->command_info == NULL ||
+	    entry->run_argv == NULL) {
+	intercept_cache_entry_free(entry);
+	goto oom;
+    }
+    if (sudo_gettime_mono(&entry->expires) == -1) {
+	intercept_cache_entry_free(entry);
+	debug_return_bool(false);
+    }
+    entry->expires.tv_sec += (time_t)cache.timeout;
+    mtim_get(sb, entry->mtime);
+    entry->ctime = sb->st_ctime;
+    entry->dev = sb->st_dev;
+    entry->ino = sb->st_ino;
+    entry->size = sb->st_size;
+    entry->mode = sb->st_mode;
+    entry->uid = sb->st_uid;
+    entry->gid = sb->st_gid;
+
+    TAILQ_INSERT_HEAD(&cache.buckets[hash & (INTERCEPT_CACHE_BUCKETS - 1)],
+	entry, entries);
+    TAILQ_INSERT_HEAD(&cache.lru, entry, lru);
+    cache.nentries++;
+
+    debug_return_bool(true);
+oom:
+    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	"unable to allocate memory");
+    debug_return_bool(false);
+}
+
+/*
+ * Log cache statistics and free all entries.
+ */
+void
+intercept_cache_free(void)
+{
+    struct intercept_cache_entry *entry;
+    debug_decl(intercept_cache_free, SUDO_DEBUG_EXEC);
+
+    if (cache.timeout == 0)
+	debug_return;
+
+    sudo_debug_printf(SUDO_DEBUG_INFO,
+	"intercept cache: %u hits, %u misses (%u expired, %u stale), "
+	"%u evicted, %u entries", cache.hits, cache.misses, cache.expired,
+	cache.stale, cache.evicted, cache.nentries);
+
+    while ((entry = TAILQ_FIRST(&cache.lru)) != NULL)
+	intercept_cache_remove(entry);
+    memset(&cache, 0, sizeof(cache));
+
+    debug_return;
+}
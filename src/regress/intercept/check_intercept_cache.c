@@ -0,0 +1,217 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_STDINT_H)
+# include <stdint.h>
+#elif defined(HAVE_INTTYPES_H)
+# include <inttypes.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sudo.h>
+#include <sudo_exec.h>
+#include <exec_intercept.h>
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+int sudo_debug_instance = SUDO_DEBUG_INSTANCE_INITIALIZER;
+
+static int ntests, errors;
+static bool verbose;
+
+static void
+check_lookup(const char *what, const char *command, const struct stat *sb,
+    char *argv[], const char *runcwd, bool expected)
+{
+    char **command_info = NULL, **run_argv = NULL;
+    int argc;
+    bool found;
+
+    for (argc = 0; argv[argc] != NULL; argc++)
+	continue;
+
+    ntests++;
+    found = intercept_cache_lookup(command, sb, argc, argv, runcwd,
+	&command_info, &run_argv);
+    if (found != expected) {
+	printf("%s: FAIL %s: expected %s, got %s\n", getprogname(), what,
+	    expected ? "hit" : "miss", found ? "hit" : "miss");
+	errors++;
+	return;
+    }
+    if (found) {
+	/* Stored values are in the form "command=" + argv[0] */
+	if (strncmp(command_info[0], "command=", 8) != 0 ||
+		strcmp(command_info[0] + 8, command) != 0 ||
+		strcmp(run_argv[0], argv[0]) != 0 || run_argv[argc] != NULL) {
+	    printf("%s: FAIL %s: cached data mismatch\n", getprogname(), what);
+	    errors++;
+	    return;
+	}
+    }
+    if (verbose)
+	printf("%s: OK %s\n", getprogname(), what);
+}
+
+static void
+store(const char *command, const struct stat *sb, char *argv[],
+    const char *runcwd)
+{
+    char *command_info[2];
+    int argc;
+
+    for (argc = 0; argv[argc] != NULL; argc++)
+	continue;
+
+    if (asprintf(&command_info[0], "command=%s", command) == -1) {
+	fprintf(stderr, "%s: unable to allocate memory\n", getprogname());
+	exit(EXIT_FAILURE);
+    }
+    command_info[1] = NULL;
+    ntests++;
+    if (!intercept_cache_store(command, sb, argc, argv, runcwd,
+	    command_info, argv)) {
+	printf("%s: FAIL unable to store %s\n", getprogname(), command);
+	errors++;
+    }
+    free(command_info[0]);
+}
+
+int
+main(int argc, char *argv[])
+{
+    char *ls_argv[] = { "/bin/ls", "-l", NULL };
+    char *ls2_argv[] = { "/bin/ls", "-la", NULL };
+    char *ls3_argv[] = { "/bin/ls", "-l", "/", NULL };
+    char *ls4_argv[] = { "/bin/ls", NULL };
+    char *many_argv[] = { "/bin/true", NULL, NULL };
+    char numbuf[32];
+    struct stat sb, sb2;
+    int ch, i;
+
+    initprogname(argc > 0 ? argv[0] : "check_intercept_cache");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose = true;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+
+    /* The command is not actually run, any stat buffer will do. */
+    memset(&sb, 0, sizeof(sb));
+    sb.st_dev = 1;
+    sb.st_ino = 1234;
+    sb.st_mode = S_IFREG|0755;
+    sb.st_size = 4096;
+
+    /* Cache is disabled until initialized. */
+    check_lookup("disabled", ls_argv[0], &sb, ls_argv, "/tmp", false);
+    ntests++;
+    if (intercept_cache_store(ls_argv[0], &sb, 2, ls_argv, "/tmp",
+	    ls_argv, ls_argv)) {
+	printf("%s: FAIL store succeeded with cache disabled\n",
+	    getprogname());
+	errors++;
+    }
+
+    intercept_cache_init(60);
+    check_lookup("empty", ls_argv[0], &sb, ls_argv, "/tmp", false);
+    store(ls_argv[0], &sb, ls_argv, "/tmp");
+    check_lookup("hit", ls_argv[0], &sb, ls_argv, "/tmp", true);
+
+    /* Arguments and working directory are part of the key. */
+    check_lookup("different argument", ls_argv[0], &sb, ls2_argv, "/tmp",
+	false);
+    check_lookup("extra argument", ls_argv[0], &sb, ls3_argv, "/tmp", false);
+    check_lookup("missing argument", ls_argv[0], &sb, ls4_argv, "/tmp",
+	false);
+    check_lookup("different cwd", ls_argv[0], &sb, ls_argv, "/", false);
+    check_lookup("no cwd", ls_argv[0], &sb, ls_argv, NULL, false);
+
+    /* A changed command invalidates the entry. */
+    sb2 = sb;
+    sb2.st_size++;
+    check_lookup("changed size", ls_argv[0], &sb2, ls_argv, "/tmp", false);
+    check_lookup("removed after change", ls_argv[0], &sb, ls_argv, "/tmp",
+	false);
+    store(ls_argv[0], &sb, ls_argv, "/tmp");
+    sb2 = sb;
+    sb2.st_ino++;
+    check_lookup("changed inode", ls_argv[0], &sb2, ls_argv, "/tmp", false);
+    store(ls_argv[0], &sb, ls_argv, "/tmp");
+    sb2 = sb;
+    sb2.st_mode |= S_ISUID;
+    check_lookup("changed mode", ls_argv[0], &sb2, ls_argv, "/tmp", false);
+    store(ls_argv[0], &sb, ls_argv, "/tmp");
+    sb2 = sb;
+    sb2.st_ctime++;
+    check_lookup("changed ctime", ls_argv[0], &sb2, ls_argv, "/tmp", false);
+
+    /* Storing the same key twice replaces the entry. */
+    store(ls_argv[0], &sb, ls_argv, "/tmp");
+    store(ls_argv[0], &sb, ls_argv, "/tmp");
+    check_lookup("replaced", ls_argv[0], &sb, ls_argv, "/tmp", true);
+
+    /* Fill the cache, the least recently used entries are evicted. */
+    many_argv[1] = numbuf;
+    for (i = 0; i < 1500; i++) {
+	(void)snprintf(numbuf, sizeof(numbuf), "%d", i);
+	store(many_argv[0], &sb, many_argv, "/tmp");
+	if (i == 1000) {
+	    /* A hit moves the entry to the front of the LRU list. */
+	    check_lookup("hit before eviction", ls_argv[0], &sb, ls_argv,
+		"/tmp", true);
+	}
+    }
+    (void)snprintf(numbuf, sizeof(numbuf), "%d", 0);
+    check_lookup("evicted", many_argv[0], &sb, many_argv, "/tmp", false);
+    (void)snprintf(numbuf, sizeof(numbuf), "%d", 1499);
+    check_lookup("most recent", many_argv[0], &sb, many_argv, "/tmp", true);
+    check_lookup("recently used", ls_argv[0], &sb, ls_argv, "/tmp", true);
+    intercept_cache_free();
+
+    /* Entries expire after the timeout. */
+    intercept_cache_init(1);
+    store(ls_argv[0], &sb, ls_argv, "/tmp");
+    check_lookup("hit before expiry", ls_argv[0], &sb, ls_argv, "/tmp", true);
+    sleep(2);
+    check_lookup("expired", ls_argv[0], &sb, ls_argv, "/tmp", false);
+    intercept_cache_free();
+
+    /* Cache is disabled again after being freed. */
+    check_lookup("freed", ls_argv[0], &sb, ls_argv, "/tmp", false);
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+    return errors;
+}
@@ -0,0 +1,287 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (c) 2026 Todd C. Miller <Todd.Miller@sudo.ws>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Send several policy checks over a single intercept connection,
+ * the way sudo_intercept.so does, and verify that each reply only
+ * reflects the request it answers.
+ */
+
+#include "exec_intercept.c"
+
+#include <stdio.h>
+
+sudo_dso_public int main(int argc, char *argv[]);
+
+int sudo_debug_instance = SUDO_DEBUG_INSTANCE_INITIALIZER;
+
+#ifdef _PATH_SUDO_INTERCEPT
+static int ntests, errors;
+static bool verbose;
+
+/*
+ * Fake policy: accept /bin/sh and reject everything else.  A rejection
+ * only includes a message when the command has arguments.
+ */
+static int
+test_check_policy(int argc, char * const argv[], char *env_add[],
+    char **command_info[], char **argv_out[], char **user_env_out[],
+    const char **errstr)
+{
+    static char *info[] = { (char *)"command=/bin/sh", NULL };
+
+    if (strcmp(argv[0], "/bin/sh") == 0) {
+	*command_info = info;
+	*argv_out = (char **)argv;
+	return 1;
+    }
+    if (argc > 1)
+	*errstr = "rejected with arguments";
+    return 0;
+}
+
+static struct policy_plugin test_policy = {
+    SUDO_POLICY_PLUGIN,
+    SUDO_API_VERSION,
+    NULL, /* open */
+    NULL, /* close */
+    NULL, /* show_version */
+    test_check_policy
+};
+
+struct plugin_container policy_plugin = {
+    { NULL, NULL },
+    NULL,
+    (char *)"test_policy",
+    NULL,
+    NULL,
+    NULL,
+    SUDO_DEBUG_INSTANCE_INITIALIZER,
+    { (struct generic_plugin *)&test_policy }
+};
+
+bool
+audit_accept(const char *plugin_name, unsigned int plugin_type,
+    char * const command_info[], char * const run_argv[],
+    char * const run_envp[])
+{
+    return true;
+}
+
+bool
+audit_reject(const char *plugin_name, unsigned int plugin_type,
+    const char *audit_msg, char * const command_info[])
+{
+    return true;
+}
+
+bool
+audit_error(const char *plugin_name, unsigned int plugin_type,
+    const char *audit_msg, char * const command_info[])
+{
+    return true;
+}
+
+bool
+approval_check(char * const command_info[], char * const run_argv[],
+    char * const run_envp[])
+{
+    return true;
+}
+
+void
+exec_seccomp_cleanup(void)
+{
+    return;
+}
+
+/*
+ * Send a PolicyCheckRequest for argv to sudo and return the response.
+ */
+static InterceptResponse *
+policy_check(int sock, int fd, struct intercept_closure *closure,
+    char *argv[])
+{
+    PolicyCheckRequest req = POLICY_CHECK_REQUEST__INIT;
+    InterceptRequest msg = INTERCEPT_REQUEST__INIT;
+    InterceptResponse *resp = NULL;
+    char *envp[] = { (char *)"PATH=/usr/bin:/bin", NULL };
+    uint8_t *buf = NULL;
+    uint32_t len;
+    size_t n;
+
+    for (n = 0; argv[n] != NULL; n++)
+	continue;
+    req.command = argv[0];
+    req.argv = argv;
+    req.n_argv = n;
+    req.envp = envp;
+    req.n_envp = 1;
+    req.cwd = (char *)"/";
+    msg.type_case = INTERCEPT_REQUEST__TYPE_POLICY_CHECK_REQ;
+    msg.u.policy_check_req = &req;
+
+    len = (uint32_t)intercept_request__get_packed_size(&msg);
+    if ((buf = malloc(sizeof(len) + len)) == NULL)
+	sudo_fatalx_nodebug("unable to allocate memory");
+    memcpy(buf, &len, sizeof(len));
+    intercept_request__pack(&msg, buf + sizeof(len));
+    if (send(sock, buf, sizeof(len) + len, 0) != (ssize_t)(sizeof(len) + len))
+	sudo_fatal_nodebug("send");
+    free(buf);
+    buf = NULL;
+
+    /* Read the request and write the reply, as the event loop would. */
+    intercept_cb(fd, SUDO_EV_READ, closure);
+    intercept_cb(fd, SUDO_EV_WRITE, closure);
+
+    if (recv(sock, &len, sizeof(len), 0) != sizeof(len) ||
+	    len > MESSAGE_SIZE_MAX || (buf = malloc(len)) == NULL ||
+	    recv(sock, buf, len, MSG_WAITALL) != (ssize_t)len) {
+	sudo_warnx_nodebug("%s: no response", argv[0]);
+	goto done;
+    }
+    resp = intercept_response__unpack(NULL, len, buf);
+done:
+    free(buf);
+    return resp;
+}
+
+static void
+check_reject(int sock, int fd, struct intercept_closure *closure,
+    char *argv[], const char *expected)
+{
+    InterceptResponse *resp = policy_check(sock, fd, closure, argv);
+
+    ntests++;
+    if (resp == NULL ||
+	    resp->type_case != INTERCEPT_RESPONSE__TYPE_REJECT_MSG ||
+	    strcmp(resp->u.reject_msg->reject_message, expected) != 0) {
+	printf("%s: FAIL %s: expected reject \"%s\"\n", getprogname(),
+	    argv[0], expected);
+	errors++;
+    } else if (verbose) {
+	printf("%s: OK %s rejected: %s\n", getprogname(), argv[0], expected);
+    }
+    if (resp != NULL)
+	intercept_response__free_unpacked(resp, NULL);
+}
+
+static void
+check_accept(int sock, int fd, struct intercept_closure *closure,
+    char *argv[])
+{
+    InterceptResponse *resp = policy_check(sock, fd, closure, argv);
+    PolicyAcceptMessage *msg;
+    size_t n;
+
+    ntests++;
+    if (resp == NULL ||
+	    resp->type_case != INTERCEPT_RESPONSE__TYPE_ACCEPT_MSG) {
+	printf("%s: FAIL %s: expected accept\n", getprogname(), argv[0]);
+	errors++;
+	goto done;
+    }
+    msg = resp->u.accept_msg;
+    for (n = 0; argv[n] != NULL; n++) {
+	if (n >= msg->n_run_argv || strcmp(msg->run_argv[n], argv[n]) != 0)
+	    break;
+    }
+    if (strcmp(msg->run_command, argv[0]) != 0 || argv[n] != NULL ||
+	    msg->n_run_argv != n || msg->n_run_envp != 1) {
+	printf("%s: FAIL %s: accept message does not match request\n",
+	    getprogname(), argv[0]);
+	errors++;
+	goto done;
+    }
+    if (verbose)
+	printf("%s: OK %s accepted\n", getprogname(), argv[0]);
+done:
+    if (resp != NULL)
+	intercept_response__free_unpacked(resp, NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+    char *ls_args[] = { (char *)"/bin/ls", (char *)"-l", NULL };
+    char *ls_noargs[] = { (char *)"/bin/ls", NULL };
+    char *sh_one[] = { (char *)"/bin/sh", (char *)"-c", (char *)"one", NULL };
+    char *sh_two[] = { (char *)"/bin/sh", (char *)"two", NULL };
+    struct command_details details;
+    struct intercept_closure *closure;
+    struct sudo_event_base *evbase;
+    int ch, sv[2];
+
+    initprogname(argc > 0 ? argv[0] : "check_intercept_reuse");
+
+    while ((ch = getopt(argc, argv, "v")) != -1) {
+	switch (ch) {
+	case 'v':
+	    verbose = true;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-v]\n", getprogname());
+	    return EXIT_FAILURE;
+	}
+    }
+
+    if ((evbase = sudo_ev_base_alloc()) == NULL)
+	sudo_fatalx_nodebug("unable to allocate memory");
+    sudo_ev_base_setdef(evbase);
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+	sudo_fatal_nodebug("socketpair");
+
+    memset(&details, 0, sizeof(details));
+    details.flags = CD_INTERCEPT;
+    closure = intercept_connection_setup(sv[1], evbase, &details,
+	RECV_POLICY_CHECK, intercept_cb, false);
+    if (closure == NULL)
+	sudo_fatalx_nodebug("unable to set up intercept connection");
+
+    /* A rejection message must not carry over to the next check. */
+    check_reject(sv[0], sv[1], closure, ls_args, "rejected with arguments");
+    check_reject(sv[0], sv[1], closure, ls_noargs,
+	"command rejected by policy");
+
+    /* A new check may replace InterceptHello after an accepted command. */
+    check_accept(sv[0], sv[1], closure, sh_one);
+    check_accept(sv[0], sv[1], closure, sh_two);
+    check_reject(sv[0], sv[1], closure, ls_noargs,
+	"command rejected by policy");
+
+    /* Closing the client end frees the closure. */
+    close(sv[0]);
+    intercept_cb(sv[1], SUDO_EV_READ, closure);
+    sudo_ev_base_free(evbase);
+
+    if (ntests != 0) {
+	printf("%s: %d tests run, %d errors, %d%% success rate\n",
+	    getprogname(), ntests, errors, (ntests - errors) * 100 / ntests);
+    }
+
+    return errors;
+}
+#else
+int
+main(int argc, char *argv[])
+{
+    /* Intercept support not enabled, nothing to test. */
+    return EXIT_SUCCESS;
+}
+#endif /* _PATH_SUDO_INTERCEPT */
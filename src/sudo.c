@@ -768,6 +768,15 @@ command_info_to_details(char * const info[], struct command_details *details)
 	    case 'i':
 		SET_FLAG("intercept=", CD_INTERCEPT)
 		SET_FLAG("intercept_verify=", CD_INTERCEPT_VERIFY)
+		if (strncmp("intercept_cache_timeout=", info[i],
+			sizeof("intercept_cache_timeout=") - 1) == 0) {
+		    cp = info[i] + sizeof("intercept_cache_timeout=") - 1;
+		    details->intercept_cache_timeout =
+			(unsigned int)sudo_strtonum(cp, 0, UINT_MAX, &errstr);
+		    if (errstr != NULL)
+			sudo_fatalx(U_("%s: %s"), info[i], U_(errstr));
+		    break;
+		}
 		break;
 	    case 'l':
 		SET_STRING("login_class=", login_class)
@@ -910,12 +919,13 @@ command_info_to_details(char * const info[], struct command_details *details)
 		SET_FLAG("umask_override=", CD_OVERRIDE_UMASK)
 		SET_FLAG("use_ptrace=", CD_USE_PTRACE)
 		SET_FLAG("use_pty=", CD_USE_PTY)
+		SET_FLAG("use_seccomp=", CD_USE_SECCOMP)
 		SET_STRING("utmp_user=", utmp_user)
 		break;
 	}
     }
 
-    /* Only use ptrace(2) for intercept/log_subcmds if supported. */
+    /* Only use ptrace(2) or seccomp(2) for intercept/log_subcmds if supported. */
     exec_ptrace_fix_flags(details);
 
     if (!ISSET(details->flags, CD_SET_EUID))
@@ -176,6 +176,7 @@ struct user_details {
 #define CD_INTERCEPT_VERIFY	0x01000000U
 #define CD_RBAC_SET_CWD		0x02000000U
 #define CD_CWD_OPTIONAL		0x04000000U
+#define CD_USE_SECCOMP		0x08000000U
 
 struct preserved_fd {
     TAILQ_ENTRY(preserved_fd) entries;
@@ -191,6 +192,7 @@ struct command_details {
     int argc;
     int priority;
     unsigned int timeout;
+    unsigned int intercept_cache_timeout;
     int closefrom;
     unsigned int flags;
     int execfd;
@@ -348,5 +350,6 @@ bool parse_policy_rlimit(const char *str);
 void exec_ptrace_fix_flags(struct command_details *details);
 bool exec_ptrace_intercept_supported(void);
 bool exec_ptrace_subcmds_supported(void);
+bool exec_seccomp_notify_supported(void);
 
 #endif /* SUDO_SUDO_H */
@@ -96,12 +96,21 @@ struct io_buffer {
     struct sudo_event *revent;
     struct sudo_event *wevent;
     sudo_io_action_t action;
+    int tee_pipe[2]; /* pipe used to copy spliced data for logging */
+    bool splice; /* data stays in the reader's pipe, buf holds a copy */
     unsigned int len; /* buffer length (how much produced) */
     unsigned int off; /* write position (how much already consumed) */
     char buf[64 * 1024];
 };
 SLIST_HEAD(io_buffer_list, io_buffer);
 
+/*
+ * True if the reader must wait for the writer to drain the buffer.
+ * In splice mode, only one chunk may be outstanding at a time.
+ */
+#define IOB_FULL(_iob)	((_iob)->len == sizeof((_iob)->buf) || \
+    ((_iob)->splice && (_iob)->len != 0))
+
 /*
  * Indices into io_fds[] when logging I/O.
  */
@@ -199,7 +208,10 @@ bool log_stdout(const char *buf, unsigned int n, struct io_buffer *iob);
 bool log_stderr(const char *buf, unsigned int n, struct io_buffer *iob);
 void log_suspend(void *v, int signo);
 void log_winchange(struct exec_closure *ec, unsigned int rows, unsigned int cols);
-void io_buf_new(int rfd, int wfd, bool (*action)(const char *, unsigned int, struct io_buffer *), void (*read_cb)(int fd, int what, void *v), void (*write_cb)(int fd, int what, void *v), struct exec_closure *ec);
+struct io_buffer *io_buf_new(int rfd, int wfd, bool (*action)(const char *, unsigned int, struct io_buffer *), void (*read_cb)(int fd, int what, void *v), void (*write_cb)(int fd, int what, void *v), struct exec_closure *ec);
+bool io_buf_splice(struct io_buffer *iob);
+ssize_t io_buf_splice_read(int fd, struct io_buffer *iob);
+ssize_t io_buf_splice_write(int fd, struct io_buffer *iob);
 int safe_close(int fd);
 void ev_free_by_fd(struct sudo_event_base *evbase, int fd);
 void free_io_bufs(void);
@@ -229,7 +241,10 @@ char **sudo_preload_dso_mmap(char *const envp[], const char *dso_file, int inter
 /* exec_ptrace.c */
 bool exec_ptrace_stopped(pid_t pid, int status, void *intercept);
 bool set_exec_filter(void);
+bool set_exec_notify_filter(int intercept_fd);
 int exec_ptrace_seize(pid_t child, int intercept_fd);
+int exec_seccomp_listen(int intercept_fd, struct sudo_event_base *evbase, void *intercept);
+void exec_seccomp_cleanup(void);
 
 /* suspend_parent.c */
 void sudo_suspend_parent(int signo, pid_t my_pid, pid_t my_pgrp, pid_t cmnd_pid, void *closure, void (*callback)(void *, int));
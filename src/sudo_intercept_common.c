@@ -20,6 +20,8 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
@@ -65,6 +67,38 @@ static union sudo_token_un intercept_token;
 static in_port_t intercept_port;
 static bool log_only;
 
+/*
+ * Connection to sudo, kept open for policy checks by the process that
+ * ran the ctor.  A forked child must not share it with the parent.
+ */
+static int intercept_sock = -1;
+static pid_t intercept_sock_pid;
+static dev_t intercept_sock_dev;
+static ino_t intercept_sock_ino;
+
+/* Channel used to pass sudo new connections, inherited via fork. */
+static int intercept_channel = -1;
+static dev_t intercept_channel_dev;
+static ino_t intercept_channel_ino;
+
+/*
+ * Check that fd still refers to the socket we saved, the command
+ * may have closed or replaced it.
+ */
+static bool
+intercept_fd_valid(int fd, dev_t dev, ino_t ino)
+{
+    struct stat sb;
+    debug_decl(intercept_fd_valid, SUDO_DEBUG_EXEC);
+
+    if (fstat(fd, &sb) == -1 || sb.st_dev != dev || sb.st_ino != ino) {
+	sudo_debug_printf(SUDO_DEBUG_WARN|SUDO_DEBUG_LINENO,
+	    "intercept fd %d is no longer valid", fd);
+	debug_return_bool(false);
+    }
+    debug_return_bool(true);
+}
+
 /* Send entire request to sudo (blocking). */
 static bool
 send_req(int sock, const void *buf, size_t len)
@@ -127,11 +161,60 @@ done:
     debug_return_bool(ret);
 }
 
+/*
+ * Read the size of an InterceptResponse, which may be accompanied by
+ * a file descriptor.  If fdp is not NULL, it is filled in with the
+ * received descriptor, or -1 if there was none.
+ */
+static ssize_t
+recv_response_size(int fd, uint32_t *res_len, int *fdp)
+{
+#ifdef SCM_RIGHTS
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int))];
+    } cmsgbuf;
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov;
+    ssize_t nread;
+    debug_decl(recv_response_size, SUDO_DEBUG_EXEC);
+
+    if (fdp == NULL)
+	debug_return_ssize_t(recv(fd, res_len, sizeof(*res_len), 0));
+
+    *fdp = -1;
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = res_len;
+    iov.iov_len = sizeof(*res_len);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsgbuf.buf;
+    msg.msg_controllen = sizeof(cmsgbuf.buf);
+    nread = recvmsg(fd, &msg, 0);
+    if (nread > 0) {
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+		cmsg->cmsg_type == SCM_RIGHTS &&
+		cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+	    memcpy(fdp, CMSG_DATA(cmsg), sizeof(int));
+	}
+    }
+    debug_return_ssize_t(nread);
+#else
+    if (fdp != NULL)
+	*fdp = -1;
+    return recv(fd, res_len, sizeof(*res_len), 0);
+#endif /* SCM_RIGHTS */
+}
+
 /*
  * Receive InterceptResponse from sudo over fd.
+ * If fdp is not NULL, it is filled in with a descriptor sent
+ * along with the response, or -1 if there was none.
  */
 static InterceptResponse *
-recv_intercept_response(int fd)
+recv_intercept_response(int fd, int *fdp)
 {
     InterceptResponse *res = NULL;
     ssize_t nread;
@@ -141,7 +224,7 @@ recv_intercept_response(int fd)
 
     /* Read message size (uint32_t in host byte order). */
     for (;;) {
-	nread = recv(fd, &res_len, sizeof(res_len), 0);
+	nread = recv_response_size(fd, &res_len, fdp);
 	if (nread == ssizeof(res_len))
 	    break;
 	switch (nread) {
@@ -217,7 +300,8 @@ sudo_interposer_init(void)
 {
     InterceptResponse *res = NULL;
     static bool initialized;
-    int flags, fd = -1;
+    int flags, fd = -1, chan = -1;
+    struct stat sb;
     char **p;
     debug_decl(sudo_interposer_init, SUDO_DEBUG_EXEC);
 
@@ -270,13 +354,31 @@ sudo_interposer_init(void)
     if (!send_client_hello(fd))
 	goto done;
 
-    res = recv_intercept_response(fd);
+    res = recv_intercept_response(fd, &chan);
     if (res != NULL) {
 	if (res->type_case == INTERCEPT_RESPONSE__TYPE_HELLO_RESP) {
 	    intercept_token.u64[0] = res->u.hello_resp->token_lo;
 	    intercept_token.u64[1] = res->u.hello_resp->token_hi;
 	    intercept_port = (in_port_t)res->u.hello_resp->portno;
 	    log_only = res->u.hello_resp->log_only;
+
+	    /* Keep the connection for our own policy checks. */
+	    if (fcntl(fd, F_SETFD, FD_CLOEXEC) != -1 && fstat(fd, &sb) == 0) {
+		intercept_sock = fd;
+		intercept_sock_pid = getpid();
+		intercept_sock_dev = sb.st_dev;
+		intercept_sock_ino = sb.st_ino;
+		fd = -1;
+	    }
+
+	    /* Not inherited by exec, sudo sends a new one with each hello. */
+	    if (chan != -1 && fcntl(chan, F_SETFD, FD_CLOEXEC) != -1 &&
+		    fstat(chan, &sb) == 0) {
+		intercept_channel = chan;
+		intercept_channel_dev = sb.st_dev;
+		intercept_channel_ino = sb.st_ino;
+		chan = -1;
+	    }
 	} else {
 	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 		"unexpected type_case value %d in %s from %s",
@@ -288,6 +390,8 @@ sudo_interposer_init(void)
 done:
     if (fd != -1)
 	close(fd);
+    if (chan != -1)
+	close(chan);
 
     debug_return;
 }
@@ -306,13 +410,6 @@ send_policy_check_req(int sock, const char *cmnd, char * const argv[],
     size_t len;
     debug_decl(fmt_policy_check_req, SUDO_DEBUG_EXEC);
 
-    /* Send token first (out of band) to initiate connection. */
-    if (!send_req(sock, &intercept_token, sizeof(intercept_token))) {
-	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
-	    "unable to send token back to sudo");
-	goto done;
-    }
-
     /* Setup policy check request. */
     req.intercept_fd = sock;
     req.command = (char *)cmnd;
@@ -389,10 +486,81 @@ intercept_connect(void)
 	goto done;
     }
 
+    /* Send token first (out of band) to initiate connection. */
+    if (!send_req(sock, &intercept_token, sizeof(intercept_token))) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+	    "unable to send token back to sudo");
+	close(sock);
+	sock = -1;
+	goto done;
+    }
+
 done:
     debug_return_int(sock);
 }
 
+/*
+ * Create a new connection to sudo by passing it one end of a socketpair
+ * over the intercept channel, along with the token.  There is no need
+ * to wait for sudo to pick up the connection before sending a request.
+ * Returns the socket on success or -1 if the channel is not available.
+ */
+static int
+intercept_channel_connect(void)
+{
+#ifdef SCM_RIGHTS
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int))];
+    } cmsgbuf;
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov;
+    ssize_t nwritten;
+    int sv[2];
+    debug_decl(intercept_channel_connect, SUDO_DEBUG_EXEC);
+
+    if (intercept_channel == -1 || !intercept_fd_valid(intercept_channel,
+	    intercept_channel_dev, intercept_channel_ino))
+	debug_return_int(-1);
+
+    if (socketpair(PF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	    "unable to create socketpair");
+	debug_return_int(-1);
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+    iov.iov_base = &intercept_token;
+    iov.iov_len = sizeof(intercept_token);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsgbuf.buf;
+    msg.msg_controllen = sizeof(cmsgbuf.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &sv[1], sizeof(int));
+
+    do {
+	nwritten = sendmsg(intercept_channel, &msg, 0);
+    } while (nwritten == -1 && errno == EINTR);
+    close(sv[1]);
+    if (nwritten != ssizeof(intercept_token)) {
+	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
+	    "unable to send socket over intercept channel");
+	close(sv[0]);
+	debug_return_int(-1);
+    }
+
+    debug_return_int(sv[0]);
+#else
+    return -1;
+#endif /* SCM_RIGHTS */
+}
+
 /* Called from sudo_intercept.c */
 bool command_allowed(const char *cmnd, char * const argv[], char * const envp[], char **ncmndp, char ***nargvp, char ***nenvpp);
 
@@ -402,9 +570,9 @@ command_allowed(const char *cmnd, char * const argv[],
 {
     char *ncmnd = NULL, **nargv = NULL, **nenvp = NULL;
     InterceptResponse *res = NULL;
-    bool ret = false;
+    bool cached = false, ret = false;
     size_t idx, len = 0;
-    int sock;
+    int sock = -1;
     debug_decl(command_allowed, SUDO_DEBUG_EXEC);
 
     if (sudo_debug_needed(SUDO_DEBUG_INFO)) {
@@ -418,18 +586,39 @@ command_allowed(const char *cmnd, char * const argv[],
 	}
     }
 
-    sock = intercept_connect();
-    if (sock == -1)
-	goto done;
+    /*
+     * Reuse our connection to sudo if we have one, else create a new one.
+     * We cannot update the cache when not its owner, we may be running
+     * in a vfork(2) child that shares memory with the parent.
+     */
+    if (intercept_sock != -1 && intercept_sock_pid == getpid()) {
+	if (intercept_fd_valid(intercept_sock, intercept_sock_dev,
+		intercept_sock_ino)) {
+	    sock = intercept_sock;
+	    cached = true;
+	} else {
+	    /* Descriptor no longer belongs to us, do not close it. */
+	    intercept_sock = -1;
+	}
+    }
+    if (sock == -1) {
+	sock = intercept_channel_connect();
+	if (sock == -1)
+	    sock = intercept_connect();
+	if (sock == -1)
+	    goto done;
+    }
 
     if (!send_policy_check_req(sock, cmnd, argv, envp))
-	goto done;
+	goto bad;
 
     if (log_only) {
 	/* Just logging, no policy check. */
 	nenvp = sudo_preload_dso_mmap(envp, sudo_conf_intercept_path(), sock);
 	if (nenvp == NULL)
 	    goto oom;
+	if (cached)
+	    (void)fcntl(sock, F_SETFD, 0);
 	*ncmndp = (char *)cmnd;		/* safe */
 	*nargvp = (char **)argv;	/* safe */
 	*nenvpp = nenvp;
@@ -437,9 +626,9 @@ command_allowed(const char *cmnd, char * const argv[],
 	goto done;
     }
 
-    res = recv_intercept_response(sock);
+    res = recv_intercept_response(sock, NULL);
     if (res == NULL)
-	goto done;
+	goto bad;
 
     switch (res->type_case) {
     case INTERCEPT_RESPONSE__TYPE_ACCEPT_MSG:
@@ -467,6 +656,8 @@ command_allowed(const char *cmnd, char * const argv[],
 	nenvp = sudo_preload_dso_mmap(envp, sudo_conf_intercept_path(), sock);
 	if (nenvp == NULL)
 	    goto oom;
+	if (cached)
+	    (void)fcntl(sock, F_SETFD, 0);
 	*ncmndp = ncmnd;
 	*nargvp = nargv;
 	*nenvpp = nenvp;
@@ -480,12 +671,12 @@ command_allowed(const char *cmnd, char * const argv[],
 	/* Policy module may display error message but we are in raw mode. */
 	fputc('\r', stderr);
 	sudo_warnx("%s", res->u.error_msg->error_message);
-	goto done;
+	goto bad;
     default:
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unexpected type_case value %d in %s from %s",
 	    res->type_case, "InterceptResponse", "sudo");
-	goto done;
+	goto bad;
     }
 
 oom:
@@ -494,9 +685,21 @@ oom:
 	sudo_mmap_free(nargv[--len]);
     sudo_mmap_free(nargv);
 
+bad:
+    /* Connection state is unknown, do not reuse it. */
+    if (cached) {
+	close(sock);
+	intercept_sock = -1;
+	cached = false;
+	sock = -1;
+    }
+
 done:
-    /* Keep socket open for ctor when we execute the command. */
-    if (!ret && sock != -1)
+    /*
+     * Keep socket open for ctor when we execute the command.
+     * A cached connection stays open for the next policy check.
+     */
+    if (!ret && !cached && sock != -1)
 	close(sock);
     intercept_response__free_unpacked(res, NULL);
 